@@ -0,0 +1,64 @@
+#ifndef MOSDEF_BENCH_H
+#define MOSDEF_BENCH_H
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Shared helpers for the benchmark executables. Every benchmark accepts
+// --quick, which ctest passes to run a few iterations as a smoke test;
+// without it the iteration counts are sized for stable numbers.
+
+static inline double bench_now(void) {
+    static LARGE_INTEGER frequency;
+    if (frequency.QuadPart == 0) QueryPerformanceFrequency(&frequency);
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+}
+
+static inline bool bench_quick(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) return true;
+    }
+    return false;
+}
+
+static inline int bench_compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Sorts samples in place and returns the requested percentile (0-100)
+static inline double bench_percentile(double* samples, size_t count, double percentile) {
+    if (count == 0) return 0.0;
+    qsort(samples, count, sizeof(double), bench_compare_doubles);
+    size_t index = (size_t)(percentile / 100.0 * (double)(count - 1) + 0.5);
+    return samples[index < count ? index : count - 1];
+}
+
+// Keeps a computed value alive so the measured loop is not optimized away
+static inline void bench_consume(ULONG64 value) {
+    static volatile ULONG64 sink;
+    sink += value;
+}
+
+#ifdef MOSDEF_FIXTURE_DIR
+// Reads tests/fixtures/<name> into buffer; returns the size, 0 on failure
+static inline DWORD bench_read_fixture(const char* name, BYTE* buffer, DWORD buffer_size) {
+    char path[512];
+    sprintf_s(path, sizeof(path), "%s/%s", MOSDEF_FIXTURE_DIR, name);
+    FILE* file = NULL;
+    if (fopen_s(&file, path, "rb") != 0 || !file) {
+        fprintf(stderr, "Cannot open fixture %s\n", path);
+        return 0;
+    }
+    size_t size = fread(buffer, 1, buffer_size, file);
+    fclose(file);
+    return (DWORD)size;
+}
+#endif
+
+#endif // MOSDEF_BENCH_H
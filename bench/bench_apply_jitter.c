@@ -0,0 +1,129 @@
+#include "bench.h"
+#include "mosdef.h"
+#include <sim.h>
+#include <math.h>
+#include <unistd.h>
+
+// Batch completion jitter under CPU load: a 16-monitor plan applied against
+// the simulated backend, each mode change doing 200 us of work and then
+// waiting on the driver for 1 ms, while normal-priority threads spin on
+// every CPU. Compares the loop inline on the caller's thread with the
+// context's apply thread (time-critical, and SCHED_FIFO on Linux when the
+// process may use it).
+
+#define MONITOR_COUNT 16
+#define CHANGE_WORK_US 200
+
+static volatile LONG g_stop_spinners = 0;
+
+static DWORD WINAPI spinner(LPVOID param) {
+    (void)param;
+    ULONG64 counter = 0;
+    while (!g_stop_spinners) counter++;
+    bench_consume(counter);
+    return 0;
+}
+
+// Stands in for the driver's own CPU time in each mode change
+static void work_log(LogLevel level, const char* message, void* user_data) {
+    (void)level;
+    (void)user_data;
+    if (strncmp(message, "Rotating monitor ", 17) != 0) return;
+    double end = bench_now() + CHANGE_WORK_US * 1e-6;
+    while (bench_now() < end) {
+    }
+}
+
+static bool set_wall(void) {
+    SimMonitor monitors[MONITOR_COUNT];
+    for (int i = 0; i < MONITOR_COUNT; i++) {
+        static char connectors[MONITOR_COUNT][24];
+        sprintf_s(connectors[i], sizeof(connectors[i]), "card%d-DP-%d", i / 4, i % 4 + 1);
+        monitors[i].model = "GSM5B7F";
+        monitors[i].connector = connectors[i];
+        monitors[i].width = 1920;
+        monitors[i].height = 1080;
+        monitors[i].orientation = DMDO_DEFAULT;
+        monitors[i].refresh_hz = 60;
+        monitors[i].x = 1920 * i;
+        monitors[i].y = 0;
+    }
+    return sim_set_monitors(monitors, MONITOR_COUNT);
+}
+
+// Applies and rolls back rounds times; fills samples with apply times in ms
+static bool measure(bool apply_thread, int rounds, double* samples) {
+    MosDefOptions options = { 0 };
+    options.verbose = true;     // The work hook keys off the per-monitor message
+    options.apply_thread = apply_thread;
+    LogSink sink = { work_log, NULL, true };
+    MosDefContext* ctx = mosdef_create(&options, NULL, &sink);
+    if (!ctx) return false;
+
+    RotationPlan* plan = NULL;
+    bool ok = mosdef_plan(ctx, ROTATION_PORTRAIT, NULL, NULL, &plan) == MOSDEF_OK && plan->count == MONITOR_COUNT;
+    for (int r = 0; ok && r < rounds; r++) {
+        double start = bench_now();
+        ok = mosdef_apply(ctx, plan, NULL) == MOSDEF_OK;
+        samples[r] = (bench_now() - start) * 1e3;
+        ok = ok && mosdef_rollback(ctx, plan) == MOSDEF_OK;
+    }
+
+    mosdef_free_plan(ctx, plan);
+    mosdef_destroy(ctx);
+    return ok;
+}
+
+static void report(const char* label, int spinners, double* samples, int rounds) {
+    double sum = 0.0;
+    for (int r = 0; r < rounds; r++) sum += samples[r];
+    double mean = sum / rounds;
+    double variance = 0.0;
+    for (int r = 0; r < rounds; r++) variance += (samples[r] - mean) * (samples[r] - mean);
+    double stddev = sqrt(variance / rounds);
+    double p50 = bench_percentile(samples, (size_t)rounds, 50.0);
+    double p99 = bench_percentile(samples, (size_t)rounds, 99.0);
+    printf("%8d  %-12s  %7.2f  %7.2f  %7.2f  %7.2f\n", spinners, label, mean, stddev, p50, p99);
+}
+
+int main(int argc, char** argv) {
+    bool quick = bench_quick(argc, argv);
+    int rounds = quick ? 3 : 100;
+    int cpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int loads[] = { 0, cpus, 4 * cpus };
+
+    sim_reset();
+    sim_set_change_latency(1);
+    if (!set_wall()) return EXIT_FAILURE;
+
+    double* samples = (double*)malloc((size_t)rounds * sizeof(double));
+    if (!samples) return EXIT_FAILURE;
+
+    printf("%d monitors, %d us work + 1 ms wait per change, %d CPU(s), %d rounds\n\n",
+           MONITOR_COUNT, CHANGE_WORK_US, cpus, rounds);
+    printf("spinners  loop          mean ms  stddev   p50 ms   p99 ms\n");
+    for (size_t l = 0; l < sizeof(loads) / sizeof(loads[0]); l++) {
+        g_stop_spinners = 0;
+        HANDLE threads[256];
+        int spinners = loads[l] < 256 ? loads[l] : 256;
+        for (int i = 0; i < spinners; i++) {
+            threads[i] = CreateThread(NULL, 0, spinner, NULL, 0, NULL);
+            if (!threads[i]) return EXIT_FAILURE;
+        }
+
+        if (!measure(false, rounds, samples)) return EXIT_FAILURE;
+        report("inline", spinners, samples, rounds);
+        if (!measure(true, rounds, samples)) return EXIT_FAILURE;
+        report("apply thread", spinners, samples, rounds);
+
+        InterlockedExchange(&g_stop_spinners, 1);
+        for (int i = 0; i < spinners; i++) {
+            WaitForSingleObject(threads[i], INFINITE);
+            CloseHandle(threads[i]);
+        }
+    }
+
+    free(samples);
+    sim_reset();
+    return EXIT_SUCCESS;
+}
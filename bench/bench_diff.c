@@ -0,0 +1,123 @@
+#include "bench.h"
+#include "diff.h"
+
+// Drift detection at fleet scale: expected and actual topologies of 1k to
+// 50k monitors each, the actual one enumerated in a different order with 1%
+// removed, 1% added and 2% changed. Diffs with the lists' hash indexes
+// (what mos-def diff uses) against the same lists without them, which fall
+// back to linear scans; the scan join is skipped where it would take minutes.
+
+static char* format_string(const char* format, int value) {
+    char text[96];
+    sprintf_s(text, sizeof(text), format, value);
+    return _strdup(text);
+}
+
+static void set_monitor(MonitorInfo* monitor, int panel, int slot) {
+    monitor->id = format_string("M%d", slot + 1);
+    monitor->device_name = format_string("Kiosk Panel %d", panel % 4);
+    monitor->device_path = format_string("\\\\.\\DISPLAY%d", panel + 1);
+    monitor->device_id = format_string("MONITOR\\GSM5B7F\\%04d", panel);
+    monitor->stable_id = format_string("GSM5B7F-%08X", panel);
+    monitor->monitor_interface = _strdup("");
+    monitor->model_name = _strdup("LG HDR 4K");
+    monitor->width = 1920;
+    monitor->height = 1080;
+    monitor->orientation = DMDO_DEFAULT;
+    monitor->position_x = 1920 * (panel % 8);
+    monitor->position_y = 1080 * (panel / 8);
+    monitor->refresh_hz = 60;
+}
+
+static MonitorList* make_list(int count) {
+    MonitorList* list = (MonitorList*)calloc(1, sizeof(MonitorList));
+    if (!list) return NULL;
+    list->monitors = (MonitorInfo*)calloc((size_t)count, sizeof(MonitorInfo));
+    if (!list->monitors) {
+        free(list);
+        return NULL;
+    }
+    list->count = count;
+    return list;
+}
+
+static MonitorList* make_expected(int count) {
+    MonitorList* list = make_list(count);
+    for (int i = 0; list && i < count; i++) set_monitor(&list->monitors[i], i, i);
+    return list;
+}
+
+// Panels in a scrambled order: every 100th is gone, as many new ones are
+// plugged in, and every 50th is rotated or moved
+static MonitorList* make_actual(int count) {
+    MonitorList* list = make_list(count);
+    if (!list) return NULL;
+
+    int slot = 0;
+    for (int i = 0; i < count; i++) {
+        int panel = (int)(((ULONG64)i * 7919) % (ULONG64)count);
+        if (panel % 100 == 42) panel = count + panel;
+        MonitorInfo* monitor = &list->monitors[slot];
+        set_monitor(monitor, panel, slot);
+        if (panel % 50 == 7) {
+            monitor->orientation = DMDO_90;
+            monitor->width = 1080;
+            monitor->height = 1920;
+        } else if (panel % 50 == 21) {
+            monitor->position_x += 100;
+        }
+        slot++;
+    }
+    return list;
+}
+
+static double time_diff(const MonitorList* expected, const MonitorList* actual, int iterations, int* out_changes) {
+    double start = bench_now();
+    for (int i = 0; i < iterations; i++) {
+        TopologyDiff* diff = diff_topologies(expected, actual);
+        if (diff) {
+            *out_changes = diff->count;
+            bench_consume((ULONG64)diff->added_count);
+        }
+        free_topology_diff(diff);
+    }
+    return (bench_now() - start) / iterations;
+}
+
+int main(int argc, char** argv) {
+    bool quick = bench_quick(argc, argv);
+    int sizes[] = { 1000, 5000, 20000, 50000 };
+    int size_count = quick ? 1 : 4;
+
+    printf("monitors/side  changes  indexed ms/diff  scan ms/diff\n");
+    for (int s = 0; s < size_count; s++) {
+        int count = sizes[s];
+        MonitorList* expected = make_expected(count);
+        MonitorList* actual = make_actual(count);
+        if (!expected || !actual) return EXIT_FAILURE;
+
+        int changes = 0;
+        int scan_changes = 0;
+        double scan = 0.0;
+        if (count <= 5000) {
+            scan = time_diff(expected, actual, quick ? 1 : 3, &scan_changes);
+        }
+
+        if (!build_monitor_index(expected, NULL) || !build_monitor_index(actual, NULL)) return EXIT_FAILURE;
+        double indexed = time_diff(expected, actual, quick ? 2 : 50, &changes);
+        if (scan > 0.0 && scan_changes != changes) {
+            fprintf(stderr, "Indexed and scan diffs disagree: %d vs %d changes\n", changes, scan_changes);
+            return EXIT_FAILURE;
+        }
+
+        if (scan > 0.0) {
+            printf("%13d  %7d  %15.3f  %12.3f\n", count, changes, indexed * 1e3, scan * 1e3);
+        } else {
+            printf("%13d  %7d  %15.3f  %12s\n", count, changes, indexed * 1e3, "-");
+        }
+
+        free_monitor_list(expected);
+        free_monitor_list(actual);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,108 @@
+#include "bench.h"
+#include "edid.h"
+
+// EDID costs per fixture: a full parse, the content hash that keys the
+// parse cache, and (off Windows, against a temporary sysfs tree) a cached
+// edid_lookup_monitor compared with one that misses and parses.
+
+static const char* g_fixtures[] = {
+    "edid/lg_no_serial.bin",
+    "edid/dell_u2720q.bin",
+    "edid/cta_only_timing.bin",
+    "edid/displayid_panel.bin"
+};
+#define FIXTURE_COUNT ((int)(sizeof(g_fixtures) / sizeof(g_fixtures[0])))
+
+static void bench_parse(const char* fixture, const BYTE* edid, DWORD size, int iterations) {
+    EdidInfo info;
+    double start = bench_now();
+    for (int i = 0; i < iterations; i++) {
+        edid_parse(edid, size, &info);
+        bench_consume(info.native_width);
+    }
+    double parse_seconds = bench_now() - start;
+
+    start = bench_now();
+    for (int i = 0; i < iterations; i++) {
+        bench_consume(edid_content_hash(edid, size));
+    }
+    double hash_seconds = bench_now() - start;
+
+    printf("%-28s %5lu  %10.1f  %9.1f\n", fixture, (unsigned long)size,
+           parse_seconds * 1e9 / iterations, hash_seconds * 1e9 / iterations);
+}
+
+#ifndef _WIN32
+#define LOOKUP_INTERFACE "\\\\?\\DISPLAY#BENCH01#card0-DP-1#{e6f07b5f-ee97-4a90-b076-33f57bf4eaa7}"
+
+static bool write_sysfs_edid(const BYTE* edid, DWORD size) {
+    char root[] = "/tmp/mosdef-bench-XXXXXX";
+    if (!mkdtemp(root)) return false;
+    setenv("MOSDEF_DRM_ROOT", root, 1);
+
+    char path[MAX_PATH];
+    snprintf(path, sizeof(path), "%s/card0-DP-1", root);
+    if (!CreateDirectoryA(path, NULL)) return false;
+    snprintf(path, sizeof(path), "%s/card0-DP-1/edid", root);
+    FILE* file = NULL;
+    if (fopen_s(&file, path, "wb") != 0 || !file) return false;
+    bool written = fwrite(edid, 1, size, file) == size;
+    fclose(file);
+    return written;
+}
+
+static void bench_lookup(const BYTE* edid, DWORD size, int iterations) {
+    if (!write_sysfs_edid(edid, size)) {
+        fprintf(stderr, "Cannot create the sysfs tree\n");
+        return;
+    }
+
+    EdidInfo info;
+    edid_cache_clear();
+    double start = bench_now();
+    for (int i = 0; i < iterations; i++) {
+        edid_lookup_monitor(LOOKUP_INTERFACE, &info);
+        bench_consume(info.native_width);
+    }
+    double cached_seconds = bench_now() - start;
+
+    start = bench_now();
+    for (int i = 0; i < iterations; i++) {
+        edid_cache_clear();
+        edid_lookup_monitor(LOOKUP_INTERFACE, &info);
+        bench_consume(info.native_width);
+    }
+    double miss_seconds = bench_now() - start;
+
+    printf("sysfs lookup: cached %.2f us, miss + parse %.2f us\n",
+           cached_seconds * 1e6 / iterations, miss_seconds * 1e6 / iterations);
+}
+#endif
+
+int main(int argc, char** argv) {
+    bool quick = bench_quick(argc, argv);
+    int iterations = quick ? 1000 : 2000000;
+
+    BYTE* edid = (BYTE*)malloc(EDID_MAX_SIZE);
+    if (!edid) return EXIT_FAILURE;
+
+    printf("%d iterations\n", iterations);
+    printf("fixture                      bytes  ns/parse    ns/hash\n");
+    for (int i = 0; i < FIXTURE_COUNT; i++) {
+        DWORD size = bench_read_fixture(g_fixtures[i], edid, EDID_MAX_SIZE);
+        if (size == 0) {
+            free(edid);
+            return EXIT_FAILURE;
+        }
+        bench_parse(g_fixtures[i], edid, size, iterations);
+    }
+
+#ifndef _WIN32
+    // The largest fixture, read through the file system as enumeration does
+    DWORD size = bench_read_fixture("edid/dell_u2720q.bin", edid, EDID_MAX_SIZE);
+    bench_lookup(edid, size, quick ? 100 : 50000);
+#endif
+
+    free(edid);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,187 @@
+#include "bench.h"
+#include "event_ring.h"
+
+// Event handoff microbenchmarks. Throughput: one producer pushes as fast as
+// it can while one consumer drains in batches, compared with a
+// CRITICAL_SECTION-protected queue of the same capacity. Latency: the
+// producer pushes one timestamped event at a time and the consumer, blocked
+// in event_ring_wait, records push-to-drain time.
+
+#define RING_CAPACITY 1024
+#define DRAIN_BATCH 64
+
+typedef struct {
+    EventRing* ring;
+    LONG64 events;
+    LONG64 received;
+    volatile LONG producer_done;
+} ThroughputRun;
+
+static DWORD WINAPI ring_consumer(LPVOID parameter) {
+    ThroughputRun* run = (ThroughputRun*)parameter;
+    DisplayEvent batch[DRAIN_BATCH];
+    for (;;) {
+        int count = event_ring_drain(run->ring, batch, DRAIN_BATCH);
+        run->received += count;
+        if (count == 0) {
+            // The producer's last events may land between the drain and this check
+            if (ReadAcquire(&run->producer_done)) {
+                int rest = event_ring_drain(run->ring, batch, DRAIN_BATCH);
+                run->received += rest;
+                if (rest == 0) break;
+                continue;
+            }
+            event_ring_wait(run->ring, 1);
+        }
+    }
+    return 0;
+}
+
+static void bench_ring_throughput(LONG64 events) {
+    ThroughputRun run = { event_ring_create(RING_CAPACITY), events, 0, 0 };
+    if (!run.ring) return;
+
+    HANDLE consumer = CreateThread(NULL, 0, ring_consumer, &run, 0, NULL);
+    DisplayEvent event = { DISPLAY_EVENT_KEY, 0, 0 };
+    double start = bench_now();
+    for (LONG64 i = 0; i < events; i++) {
+        event.param = (DWORD)i;
+        event_ring_push(run.ring, &event);
+    }
+    InterlockedExchange(&run.producer_done, 1);
+    WaitForSingleObject(consumer, INFINITE);
+    double seconds = bench_now() - start;
+    CloseHandle(consumer);
+
+    EventRingStats stats = event_ring_get_stats(run.ring);
+    printf("ring          %8.2f Mpush/s  %8.2f Mdelivered/s  dropped %lld  high water %lld\n",
+           (double)events / seconds / 1e6, (double)run.received / seconds / 1e6,
+           (long long)stats.dropped, (long long)stats.high_water);
+    event_ring_destroy(run.ring);
+}
+
+// Baseline: the mutex-protected bounded queue the ring replaced
+typedef struct {
+    CRITICAL_SECTION lock;
+    DisplayEvent slots[RING_CAPACITY];
+    int head;
+    int count;
+    LONG64 dropped;
+    LONG64 received;
+    volatile LONG producer_done;
+} LockedQueue;
+
+static DWORD WINAPI locked_consumer(LPVOID parameter) {
+    LockedQueue* queue = (LockedQueue*)parameter;
+    DisplayEvent batch[DRAIN_BATCH];
+    for (;;) {
+        EnterCriticalSection(&queue->lock);
+        int count = 0;
+        while (count < DRAIN_BATCH && queue->count > 0) {
+            batch[count++] = queue->slots[queue->head];
+            queue->head = (queue->head + 1) % RING_CAPACITY;
+            queue->count--;
+        }
+        LeaveCriticalSection(&queue->lock);
+
+        queue->received += count;
+        bench_consume(count > 0 ? batch[0].param : 0);
+        if (count == 0) {
+            if (ReadAcquire(&queue->producer_done)) {
+                EnterCriticalSection(&queue->lock);
+                bool empty = queue->count == 0;
+                LeaveCriticalSection(&queue->lock);
+                if (empty) break;
+            }
+            Sleep(0);
+        }
+    }
+    return 0;
+}
+
+static void bench_locked_throughput(LONG64 events) {
+    LockedQueue* queue = (LockedQueue*)calloc(1, sizeof(LockedQueue));
+    if (!queue) return;
+    InitializeCriticalSection(&queue->lock);
+
+    HANDLE consumer = CreateThread(NULL, 0, locked_consumer, queue, 0, NULL);
+    DisplayEvent event = { DISPLAY_EVENT_KEY, 0, 0 };
+    double start = bench_now();
+    for (LONG64 i = 0; i < events; i++) {
+        event.param = (DWORD)i;
+        EnterCriticalSection(&queue->lock);
+        if (queue->count < RING_CAPACITY) {
+            queue->slots[(queue->head + queue->count) % RING_CAPACITY] = event;
+            queue->count++;
+        } else {
+            queue->dropped++;
+        }
+        LeaveCriticalSection(&queue->lock);
+    }
+    InterlockedExchange(&queue->producer_done, 1);
+    WaitForSingleObject(consumer, INFINITE);
+    double seconds = bench_now() - start;
+    CloseHandle(consumer);
+
+    printf("mutex queue   %8.2f Mpush/s  %8.2f Mdelivered/s  dropped %lld\n",
+           (double)events / seconds / 1e6, (double)queue->received / seconds / 1e6,
+           (long long)queue->dropped);
+    DeleteCriticalSection(&queue->lock);
+    free(queue);
+}
+
+typedef struct {
+    EventRing* ring;
+    int events;
+    double* samples_us;
+    int received;
+} LatencyRun;
+
+static DWORD WINAPI latency_consumer(LPVOID parameter) {
+    LatencyRun* run = (LatencyRun*)parameter;
+    DisplayEvent batch[DRAIN_BATCH];
+    while (run->received < run->events) {
+        if (!event_ring_wait(run->ring, 1000)) continue;
+        int count = event_ring_drain(run->ring, batch, DRAIN_BATCH);
+        LONG64 now = event_timestamp_now();
+        for (int i = 0; i < count && run->received < run->events; i++) {
+            run->samples_us[run->received++] = event_timestamp_elapsed_us(batch[i].timestamp, now);
+        }
+    }
+    return 0;
+}
+
+static void bench_ring_latency(int events) {
+    LatencyRun run = { event_ring_create(RING_CAPACITY), events,
+                       (double*)malloc((size_t)events * sizeof(double)), 0 };
+    if (!run.ring || !run.samples_us) return;
+
+    HANDLE consumer = CreateThread(NULL, 0, latency_consumer, &run, 0, NULL);
+    for (int i = 0; i < events; i++) {
+        // Spaced out so the consumer is asleep in event_ring_wait, as in use
+        Sleep(1);
+        DisplayEvent event = { DISPLAY_EVENT_HOTKEY, (DWORD)i, event_timestamp_now() };
+        event_ring_push(run.ring, &event);
+    }
+    WaitForSingleObject(consumer, INFINITE);
+    CloseHandle(consumer);
+
+    printf("wake latency  p50 %.1f us  p99 %.1f us  max %.1f us (%d events)\n",
+           bench_percentile(run.samples_us, (size_t)events, 50.0),
+           bench_percentile(run.samples_us, (size_t)events, 99.0),
+           bench_percentile(run.samples_us, (size_t)events, 100.0), events);
+    free(run.samples_us);
+    event_ring_destroy(run.ring);
+}
+
+int main(int argc, char** argv) {
+    bool quick = bench_quick(argc, argv);
+    LONG64 events = quick ? 100000 : 20000000;
+    int latency_events = quick ? 50 : 2000;
+
+    printf("capacity %d, drain batch %d, %lld events\n", RING_CAPACITY, DRAIN_BATCH, (long long)events);
+    bench_ring_throughput(events);
+    bench_locked_throughput(events);
+    bench_ring_latency(latency_events);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,131 @@
+#include "bench.h"
+#include "fleet.h"
+#include "agent_pool.h"
+#include <fcntl.h>
+#include <unistd.h>
+
+// Fleet rollouts against local agents, each a separate mos-def process with
+// its own simulated displays: for a few hundred hosts, the wall time of a
+// rotation rolled out with 1 to 256 hosts in flight, and the per-host
+// latency (connect to verified response) the controller reports. Rollouts
+// alternate portrait and landscape, so every one changes every host.
+
+static void quiet_log(LogLevel level, const char* message, void* user_data) {
+    (void)level;
+    (void)message;
+    (void)user_data;
+}
+
+typedef struct {
+    double elapsed_ms;
+    double p50_ms;
+    double p95_ms;
+    double max_ms;
+    int ok;
+} RolloutTimes;
+
+// Runs one rollout with its records sent to records_path, then reads the
+// timings back from the summary record
+static bool run_rollout(const AgentPool* pool, const char* records_path, const char* action, int window,
+                        RolloutTimes* times) {
+    LogSink quiet = { quiet_log, NULL, false };
+    MosDefContext* ctx = mosdef_create(NULL, NULL, &quiet);
+    if (!ctx) return false;
+
+    FleetOptions options;
+    memset(&options, 0, sizeof(options));
+    options.hosts_path = pool->hosts_path;
+    options.key_path = pool->key_path;
+    options.action = action;
+    options.window = window;
+    options.deadline_ms = 30000;
+
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    int records = open(records_path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (saved < 0 || records < 0) return false;
+    dup2(records, STDOUT_FILENO);
+    int result = run_fleet(ctx, &options);
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+    close(records);
+    mosdef_destroy(ctx);
+    if (result != 0) return false;
+
+    FILE* file = NULL;
+    if (fopen_s(&file, records_path, "r") != 0 || !file) return false;
+    char line[512];
+    bool found = false;
+    while (!found && fgets(line, sizeof(line), file)) {
+        const char* summary = strstr(line, "\"event\":\"summary\"");
+        const char* ok = strstr(line, "\"ok\":");
+        const char* elapsed = strstr(line, "\"elapsed_ms\":");
+        const char* p50 = strstr(line, "\"p50_ms\":");
+        const char* p95 = strstr(line, "\"p95_ms\":");
+        const char* max = strstr(line, "\"max_ms\":");
+        if (!summary || !ok || !elapsed || !p50 || !p95 || !max) continue;
+        times->ok = atoi(ok + 5);
+        times->elapsed_ms = atof(elapsed + 13);
+        times->p50_ms = atof(p50 + 9);
+        times->p95_ms = atof(p95 + 9);
+        times->max_ms = atof(max + 9);
+        found = true;
+    }
+    fclose(file);
+    return found;
+}
+
+int main(int argc, char** argv) {
+    bool quick = bench_quick(argc, argv);
+    int counts[] = { 100, 300 };
+    int quick_counts[] = { 20 };
+    int windows[] = { 1, 16, 64, 256 };
+    int quick_windows[] = { 4, 16 };
+    int* sizes = quick ? quick_counts : counts;
+    int size_count = quick ? 1 : 2;
+    int* window_sizes = quick ? quick_windows : windows;
+    int window_count = quick ? 2 : 4;
+    int rounds = quick ? 1 : 3;
+
+    char directory[] = "/tmp/mosdef-bench-XXXXXX";
+    if (!mkdtemp(directory)) return EXIT_FAILURE;
+    setenv("LOCALAPPDATA", directory, 1);
+    LogSink quiet = { quiet_log, NULL, false };
+    log_set_thread_sink(&quiet);
+    char records_path[MAX_PATH];
+    sprintf_s(records_path, sizeof(records_path), "%s/records.ndjson", directory);
+
+    printf("hosts  start ms  window  rollout ms  hosts/s  p50 ms  p95 ms  max ms\n");
+    for (int s = 0; s < size_count; s++) {
+        AgentPool pool;
+        double start = bench_now();
+        if (!agent_pool_start(&pool, directory, sizes[s])) return EXIT_FAILURE;
+        double startup = bench_now() - start;
+
+        bool portrait = true;
+        for (int w = 0; w < window_count; w++) {
+            // Best of rounds, each a full rollout
+            RolloutTimes best = { 0 };
+            for (int r = 0; r < rounds; r++) {
+                RolloutTimes times;
+                const char* action = portrait ? "portrait --only M2" : "landscape --only M2";
+                portrait = !portrait;
+                if (!run_rollout(&pool, records_path, action, window_sizes[w], &times) || times.ok != sizes[s]) {
+                    fprintf(stderr, "rollout to %d hosts with window %d failed\n", sizes[s], window_sizes[w]);
+                    agent_pool_stop(&pool);
+                    return EXIT_FAILURE;
+                }
+                if (r == 0 || times.elapsed_ms < best.elapsed_ms) best = times;
+            }
+            printf("%5d  %8.1f  %6d  %10.1f  %7.0f  %6.2f  %6.2f  %6.2f\n", sizes[s], startup * 1e3,
+                   window_sizes[w], best.elapsed_ms, sizes[s] / (best.elapsed_ms / 1e3), best.p50_ms,
+                   best.p95_ms, best.max_ms);
+        }
+
+        if (!agent_pool_stop(&pool)) return EXIT_FAILURE;
+    }
+
+    remove(records_path);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,171 @@
+#include "bench.h"
+#include "modeldb.h"
+
+// Model database at fleet scale: for 100k to 1M distinct models, the cost
+// of model_db_build on records, of compiling the equivalent text source the
+// way the build does (parse, duplicate check, build, write), of mapping the
+// result, and of lookups of present and absent models in random order,
+// against a binary search over the same sorted records. Every hit must
+// return its own record; a wrong answer fails the run.
+
+#define KEY_SPACE (26u * 26u * 26u * 65536u)
+#define KEY_STRIDE 2654435761u          // Odd and coprime with 13, so i -> key is a bijection
+#define LOOKUPS 4000000
+
+static const char* k_orientation_names[] = { "landscape", "portrait", "landscape-flipped", "portrait-flipped", "-" };
+static const BYTE k_orientations[] = { DMDO_DEFAULT, DMDO_90, DMDO_180, DMDO_270, MODEL_ORIENTATION_NONE };
+
+// The i-th model: a PNP ID and product code, distinct for every i < KEY_SPACE
+static void model_name(DWORD i, char manufacturer[4], WORD* product_code) {
+    DWORD index = (DWORD)(((ULONG64)i * KEY_STRIDE) % KEY_SPACE);
+    DWORD letters = index >> 16;
+    manufacturer[0] = (char)('A' + letters / (26 * 26));
+    manufacturer[1] = (char)('A' + letters / 26 % 26);
+    manufacturer[2] = (char)('A' + letters % 26);
+    manufacturer[3] = '\0';
+    *product_code = (WORD)(index & 0xFFFF);
+}
+
+static int compare_records(const void* a, const void* b) {
+    DWORD x = ((const ModelRecord*)a)->key;
+    DWORD y = ((const ModelRecord*)b)->key;
+    return (x > y) - (x < y);
+}
+
+static ModelRecord* make_records(DWORD count) {
+    ModelRecord* records = (ModelRecord*)calloc(count, sizeof(ModelRecord));
+    for (DWORD i = 0; records && i < count; i++) {
+        char manufacturer[4];
+        WORD product_code;
+        model_name(i, manufacturer, &product_code);
+        records[i].key = model_db_key(manufacturer, product_code);
+        records[i].preferred_orientation = k_orientations[i % 5];
+        records[i].flags = (WORD)(i % 8);
+    }
+    return records;
+}
+
+static bool write_source(const char* path, const ModelRecord* records, DWORD count) {
+    FILE* file = NULL;
+    if (fopen_s(&file, path, "w") != 0 || !file) return false;
+    fprintf(file, "# Model   Orientation  Flags\n");
+    for (DWORD i = 0; i < count; i++) {
+        char manufacturer[4];
+        WORD product_code;
+        model_name(i, manufacturer, &product_code);
+        fprintf(file, "%s%04X %s%s%s%s\n", manufacturer, product_code, k_orientation_names[i % 5],
+                (records[i].flags & MODEL_FLAG_SLOW_MODESET) ? " slow-modeset" : "",
+                (records[i].flags & MODEL_FLAG_REFRESH_RESET) ? " refresh-reset" : "",
+                (records[i].flags & MODEL_FLAG_NO_ROTATE) ? " no-rotate" : "");
+    }
+    return fclose(file) == 0;
+}
+
+static ULONG g_seed = 0x0DDB1A5Eu;
+
+static DWORD next_random(void) {
+    g_seed = g_seed * 1103515245u + 12345u;
+    return g_seed >> 1;
+}
+
+int main(int argc, char** argv) {
+    bool quick = bench_quick(argc, argv);
+    DWORD counts[] = { 100000, 300000, 1000000 };
+    DWORD quick_counts[] = { 10000 };
+    DWORD* sizes = quick ? quick_counts : counts;
+    int size_count = quick ? 1 : 3;
+    int lookups = quick ? 100000 : LOOKUPS;
+    const char* source_path = "bench_modeldb.txt";
+    const char* db_path = "bench_modeldb.db";
+
+    printf("models    build ms  compile ms  file MB  open us  hit ns  miss ns  bsearch ns\n");
+    for (int s = 0; s < size_count; s++) {
+        DWORD count = sizes[s];
+        ModelRecord* records = make_records(count);
+        if (!records || !write_source(source_path, records, count)) return EXIT_FAILURE;
+
+        BYTE* image = NULL;
+        size_t image_size = 0;
+        double start = bench_now();
+        if (!model_db_build(records, count, &image, &image_size)) return EXIT_FAILURE;
+        double build = bench_now() - start;
+        free(image);
+
+        start = bench_now();
+        if (!model_db_compile_file(source_path, db_path)) return EXIT_FAILURE;
+        double compile = bench_now() - start;
+
+        start = bench_now();
+        ModelDb* db = model_db_open(db_path);
+        double open = bench_now() - start;
+        if (!db || model_db_count(db) != count) return EXIT_FAILURE;
+
+        // Queries drawn up front, so the timed loops are lookups only
+        DWORD* queries = (DWORD*)malloc((size_t)lookups * sizeof(DWORD));
+        if (!queries) return EXIT_FAILURE;
+        for (int q = 0; q < lookups; q++) queries[q] = next_random() % count;
+
+        ULONG64 found = 0;
+        start = bench_now();
+        for (int q = 0; q < lookups; q++) {
+            char manufacturer[4];
+            WORD product_code;
+            model_name(queries[q], manufacturer, &product_code);
+            ModelRecord record;
+            if (!model_db_lookup(db, manufacturer, product_code, &record) ||
+                record.flags != records[queries[q]].flags) {
+                fprintf(stderr, "lookup of model %lu returned the wrong record\n", (unsigned long)queries[q]);
+                return EXIT_FAILURE;
+            }
+            found += record.preferred_orientation;
+        }
+        double hit = (bench_now() - start) / lookups;
+
+        // Models i >= count are absent
+        start = bench_now();
+        for (int q = 0; q < lookups; q++) {
+            char manufacturer[4];
+            WORD product_code;
+            model_name(count + queries[q], manufacturer, &product_code);
+            if (model_db_lookup(db, manufacturer, product_code, NULL)) {
+                fprintf(stderr, "absent model %lu found\n", (unsigned long)(count + queries[q]));
+                return EXIT_FAILURE;
+            }
+        }
+        double miss = (bench_now() - start) / lookups;
+
+        qsort(records, count, sizeof(ModelRecord), compare_records);
+        start = bench_now();
+        for (int q = 0; q < lookups; q++) {
+            char manufacturer[4];
+            WORD product_code;
+            model_name(queries[q], manufacturer, &product_code);
+            ModelRecord probe = { model_db_key(manufacturer, product_code), 0, 0, 0 };
+            const ModelRecord* record = (const ModelRecord*)bsearch(&probe, records, count, sizeof(ModelRecord),
+                                                                    compare_records);
+            found += record ? record->preferred_orientation : 0;
+        }
+        double binary = (bench_now() - start) / lookups;
+        bench_consume(found);
+
+        FILE* file = NULL;
+        long file_size = 0;
+        if (fopen_s(&file, db_path, "rb") == 0 && file) {
+            fseek(file, 0, SEEK_END);
+            file_size = ftell(file);
+            fclose(file);
+        }
+
+        printf("%7lu  %9.1f  %10.1f  %7.1f  %7.1f  %6.1f  %7.1f  %10.1f\n", (unsigned long)count,
+               build * 1e3, compile * 1e3, file_size / 1048576.0, open * 1e6, hit * 1e9, miss * 1e9,
+               binary * 1e9);
+
+        model_db_close(db);
+        free(queries);
+        free(records);
+    }
+
+    remove(source_path);
+    remove(db_path);
+    return EXIT_SUCCESS;
+}
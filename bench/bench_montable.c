@@ -0,0 +1,195 @@
+#include "bench.h"
+#include "enum.h"
+#include "montable.h"
+
+// Filters and sorts over 10k monitors: walking the MonitorInfo array (strcmp
+// on each monitor's strings, monitor_matches_selector for native:, qsort by
+// position) against the columnar MonitorTable (dense columns, atoms, radix
+// sort). Both paths must select and order the same monitors; a mismatch
+// fails the run.
+
+#define MONITOR_COUNT 10000
+#define WORDS MONITOR_BITSET_WORDS(MONITOR_COUNT)
+
+static const char* k_models[] = { "DELL U2720Q", "LG HDR 4K", "Odyssey OLED G8", "HP E24 G5", "BenQ PD3220U" };
+
+static char* format_string(const char* format, int value) {
+    char text[96];
+    sprintf_s(text, sizeof(text), format, value);
+    return _strdup(text);
+}
+
+// A wall of panels enumerated out of position order, in mixed modes
+static MonitorList* make_monitors(void) {
+    MonitorList* list = (MonitorList*)calloc(1, sizeof(MonitorList));
+    if (!list) return NULL;
+    list->monitors = (MonitorInfo*)calloc(MONITOR_COUNT, sizeof(MonitorInfo));
+    if (!list->monitors) return NULL;
+    list->count = MONITOR_COUNT;
+
+    for (int i = 0; i < MONITOR_COUNT; i++) {
+        MonitorInfo* monitor = &list->monitors[i];
+        int slot = (int)(((ULONG64)i * 7919) % MONITOR_COUNT);
+        monitor->id = format_string("M%d", i + 1);
+        monitor->device_name = _strdup(k_models[i % 5]);
+        monitor->device_path = format_string("\\\\.\\DISPLAY%d", i + 1);
+        monitor->device_id = _strdup("");
+        monitor->stable_id = format_string("GSM5B7F-%08X", i);
+        monitor->monitor_interface = _strdup("");
+        monitor->model_name = _strdup(k_models[(i / 7) % 5]);
+        monitor->orientation = (DWORD)(i % 4);
+        bool native = i % 3 == 0;
+        monitor->width = native ? 2560 : 1920;
+        monitor->height = native ? 1440 : 1080;
+        if (monitor->orientation == DMDO_90 || monitor->orientation == DMDO_270) {
+            DWORD width = monitor->width;
+            monitor->width = monitor->height;
+            monitor->height = width;
+        }
+        monitor->native_width = (i % 5 < 3) ? 2560 : 3840;
+        monitor->native_height = (i % 5 < 3) ? 1440 : 2160;
+        monitor->position_x = 2560 * (slot % 100) - 2560 * 50;
+        monitor->position_y = 1440 * (slot / 100);
+        monitor->refresh_hz = 60;
+    }
+    return list;
+}
+
+static bool same_bits(const ULONG64* a, const ULONG64* b) {
+    return memcmp(a, b, WORDS * sizeof(ULONG64)) == 0;
+}
+
+static int count_bits(const ULONG64* bits) {
+    int count = 0;
+    for (int i = 0; i < MONITOR_COUNT; i++) count += (int)MONITOR_BITSET_TEST(bits, i);
+    return count;
+}
+
+static const MonitorInfo* g_sort_monitors;
+
+static int compare_position(const void* a, const void* b) {
+    int left = *(const int*)a;
+    int right = *(const int*)b;
+    const MonitorInfo* x = &g_sort_monitors[left];
+    const MonitorInfo* y = &g_sort_monitors[right];
+    if (x->position_x != y->position_x) return x->position_x < y->position_x ? -1 : 1;
+    if (x->position_y != y->position_y) return x->position_y < y->position_y ? -1 : 1;
+    return (left > right) - (left < right);
+}
+
+typedef enum { FILTER_ORIENTATION, FILTER_RESOLUTION, FILTER_NATIVE, FILTER_DEVICE, FILTER_MODEL } Filter;
+
+static const char* k_filter_names[] = {
+    "orientation==90", "resolution 1440x2560", "native:2560x1440", "device:\\\\.\\DISPLAY5000", "same model as M1"
+};
+
+static void filter_rows(Filter filter, const MonitorList* list, const Selector* native, ULONG64* bits) {
+    const MonitorInfo* monitors = list->monitors;
+    const char* model = monitors[0].model_name;
+    for (int i = 0; i < list->count; i++) {
+        const MonitorInfo* monitor = &monitors[i];
+        bool match;
+        switch (filter) {
+            case FILTER_ORIENTATION: match = monitor->orientation == DMDO_90; break;
+            case FILTER_RESOLUTION:  match = monitor->width == 1440 && monitor->height == 2560; break;
+            case FILTER_NATIVE:      match = monitor_matches_selector(monitor, native); break;
+            case FILTER_DEVICE:      match = strcmp(monitor->device_path, "\\\\.\\DISPLAY5000") == 0; break;
+            default:                 match = strcmp(monitor->model_name, model) == 0; break;
+        }
+        if (match) MONITOR_BITSET_SET(bits, i);
+    }
+}
+
+static void filter_table(Filter filter, const MonitorTable* table, ULONG64* bits) {
+    switch (filter) {
+        case FILTER_ORIENTATION: monitor_table_select_orientation(table, DMDO_90, bits); break;
+        case FILTER_RESOLUTION:  monitor_table_select_resolution(table, 1440, 2560, bits); break;
+        case FILTER_NATIVE:      monitor_table_select_native(table, 2560, 1440, bits); break;
+        case FILTER_DEVICE: {
+            MonitorAtom atom = monitor_table_find_atom(table, "\\\\.\\DISPLAY5000");
+            if (atom != MONITOR_ATOM_NONE) monitor_table_select_atom(table, table->device_path, atom, bits);
+            break;
+        }
+        default:
+            monitor_table_select_atom(table, table->model_name, table->model_name[0], bits);
+            break;
+    }
+}
+
+int main(int argc, char** argv) {
+    bool quick = bench_quick(argc, argv);
+    int rounds = quick ? 2 : 200;
+
+    MonitorList* list = make_monitors();
+    Selector* native = parse_selector("native:2560x1440");
+    if (!list || !native) return EXIT_FAILURE;
+
+    double start = bench_now();
+    for (int r = 0; r < rounds; r++) {
+        MonitorTable* table = build_monitor_table(list, NULL);
+        if (!table) return EXIT_FAILURE;
+        free_monitor_table(table, NULL);
+    }
+    printf("%d monitors, table build %.3f ms\n\n", MONITOR_COUNT, (bench_now() - start) / rounds * 1e3);
+
+    MonitorTable* table = build_monitor_table(list, NULL);
+    if (!table) return EXIT_FAILURE;
+
+    static ULONG64 row_bits[WORDS];
+    static ULONG64 table_bits[WORDS];
+    printf("operation                 rows ms  table ms  selected\n");
+    for (int f = 0; f <= FILTER_MODEL; f++) {
+        start = bench_now();
+        for (int r = 0; r < rounds; r++) {
+            memset(row_bits, 0, sizeof(row_bits));
+            filter_rows((Filter)f, list, native, row_bits);
+            bench_consume(row_bits[0]);
+        }
+        double rows = (bench_now() - start) / rounds;
+
+        start = bench_now();
+        for (int r = 0; r < rounds; r++) {
+            memset(table_bits, 0, sizeof(table_bits));
+            filter_table((Filter)f, table, table_bits);
+            bench_consume(table_bits[0]);
+        }
+        double columns = (bench_now() - start) / rounds;
+
+        if (!same_bits(row_bits, table_bits)) {
+            fprintf(stderr, "%s: table and rows disagree\n", k_filter_names[f]);
+            return EXIT_FAILURE;
+        }
+        printf("%-24s  %7.3f  %8.3f  %8d\n", k_filter_names[f], rows * 1e3, columns * 1e3, count_bits(row_bits));
+    }
+
+    int* row_order = (int*)malloc(MONITOR_COUNT * sizeof(int));
+    int* table_order = (int*)malloc(MONITOR_COUNT * sizeof(int));
+    if (!row_order || !table_order) return EXIT_FAILURE;
+
+    g_sort_monitors = list->monitors;
+    start = bench_now();
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < MONITOR_COUNT; i++) row_order[i] = i;
+        qsort(row_order, MONITOR_COUNT, sizeof(int), compare_position);
+    }
+    double rows = (bench_now() - start) / rounds;
+
+    start = bench_now();
+    for (int r = 0; r < rounds; r++) {
+        if (!monitor_table_sort(table, MONITOR_SORT_POSITION, table_order)) return EXIT_FAILURE;
+    }
+    double columns = (bench_now() - start) / rounds;
+
+    if (memcmp(row_order, table_order, MONITOR_COUNT * sizeof(int)) != 0) {
+        fprintf(stderr, "sort by position: table and rows disagree\n");
+        return EXIT_FAILURE;
+    }
+    printf("%-24s  %7.3f  %8.3f  %8d\n", "sort by position", rows * 1e3, columns * 1e3, MONITOR_COUNT);
+
+    free(row_order);
+    free(table_order);
+    free_monitor_table(table, NULL);
+    free_selector(native);
+    free_monitor_list(list);
+    return EXIT_SUCCESS;
+}
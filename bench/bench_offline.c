@@ -0,0 +1,114 @@
+#include "bench.h"
+#include "mosdef.h"
+
+// Offline planning throughput: a fleet of saved kiosk topologies (1 to 8
+// monitors each, as list --export writes them) planned one after another
+// the way "mos-def --topology <file> plan portrait --only M2" does: load the
+// file, resolve the selector, plan. No display API is involved.
+
+#define FLEET_SIZE 1000
+
+static void quiet_log(LogLevel level, const char* message, void* user_data) {
+    (void)level;
+    (void)message;
+    (void)user_data;
+}
+
+static bool write_topology(const char* path, int index) {
+    FILE* file = NULL;
+    if (fopen_s(&file, path, "wb") != 0 || !file) return false;
+
+    int count = 1 + index % 8;
+    fprintf(file, "{\n  \"version\": 1,\n  \"monitors\": [\n");
+    for (int i = 0; i < count; i++) {
+        bool portrait = (index + i) % 3 == 0;
+        fprintf(file,
+                "    {\n"
+                "      \"id\": \"M%d\",\n"
+                "      \"device_name\": \"Kiosk Panel\",\n"
+                "      \"device_path\": \"\\\\\\\\.\\\\DISPLAY%d\",\n"
+                "      \"device_id\": \"MONITOR\\\\GSM5B7F\\\\{4d36e96e-e325-11ce-bfc1-08002be10318}\\\\%04d\",\n"
+                "      \"monitor_interface\": \"\\\\\\\\?\\\\DISPLAY#GSM5B7F#5&%08x&0&UID%d#{e6f07b5f-ee97-4a90-b076-33f57bf4eaa7}\",\n"
+                "      \"stable_id\": \"GSM5B7F-%08X\",\n"
+                "      \"model_name\": \"LG HDR 4K\",\n"
+                "      \"width\": %d,\n"
+                "      \"height\": %d,\n"
+                "      \"orientation\": %d,\n"
+                "      \"position_x\": %d,\n"
+                "      \"position_y\": 0,\n"
+                "      \"refresh_hz\": 60,\n"
+                "      \"native_width\": 1920,\n"
+                "      \"native_height\": 1080,\n"
+                "      \"width_mm\": 600,\n"
+                "      \"height_mm\": 340,\n"
+                "      \"preferred_orientation\": -1,\n"
+                "      \"model_flags\": 0\n"
+                "    }%s\n",
+                i + 1, i + 1, i, (unsigned)index, i, (unsigned)(index * 8 + i),
+                portrait ? 1080 : 1920, portrait ? 1920 : 1080, portrait ? 90 : 0, 1920 * i,
+                i + 1 < count ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    fclose(file);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    int rounds = bench_quick(argc, argv) ? 1 : 20;
+    int fleet = bench_quick(argc, argv) ? 50 : FLEET_SIZE;
+
+    char directory[] = "/tmp/mosdef-bench-XXXXXX";
+    if (!mkdtemp(directory)) return EXIT_FAILURE;
+    setenv("LOCALAPPDATA", directory, 1);
+
+    char (*paths)[64] = malloc(sizeof(*paths) * fleet);
+    if (!paths) return EXIT_FAILURE;
+    for (int i = 0; i < fleet; i++) {
+        sprintf_s(paths[i], sizeof(paths[i]), "%s/kiosk%04d.json", directory, i);
+        if (!write_topology(paths[i], i)) return EXIT_FAILURE;
+    }
+
+    MosDefOptions options;
+    memset(&options, 0, sizeof(options));
+    options.dry_run = true;
+    LogSink quiet = { quiet_log, NULL, false };
+    MosDefContext* ctx = mosdef_create(&options, NULL, &quiet);
+    if (!ctx) return EXIT_FAILURE;
+
+    double load_seconds = 0.0;
+    double plan_seconds = 0.0;
+    int planned = 0;
+    for (int round = 0; round < rounds; round++) {
+        for (int i = 0; i < fleet; i++) {
+            double start = bench_now();
+            if (mosdef_load_topology(ctx, paths[i]) != MOSDEF_OK) return EXIT_FAILURE;
+            double loaded = bench_now();
+
+            // Selector parsing is part of each run, as it is per invocation
+            SelectorList* selectors = mosdef_parse_selectors(ctx, "M2");
+            RotationPlan* plan = NULL;
+            if (mosdef_plan(ctx, ROTATION_PORTRAIT, selectors, NULL, &plan) == MOSDEF_OK) {
+                planned++;
+                bench_consume((ULONG64)plan->count);
+            }
+            double end = bench_now();
+
+            mosdef_free_plan(ctx, plan);
+            mosdef_free_selectors(ctx, selectors);
+            load_seconds += loaded - start;
+            plan_seconds += end - loaded;
+        }
+    }
+
+    int runs = rounds * fleet;
+    double total = load_seconds + plan_seconds;
+    printf("%d topologies x %d rounds, %d planned (1-monitor kiosks have no M2)\n", fleet, rounds, planned);
+    printf("load %.1f us  plan %.1f us  total %.1f us per topology\n",
+           load_seconds * 1e6 / runs, plan_seconds * 1e6 / runs, total * 1e6 / runs);
+    printf("%.0f topologies/s\n", total > 0.0 ? runs / total : 0.0);
+
+    mosdef_destroy(ctx);
+    for (int i = 0; i < fleet; i++) remove(paths[i]);
+    free(paths);
+    return EXIT_SUCCESS;
+}
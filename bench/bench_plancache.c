@@ -0,0 +1,126 @@
+#include "bench.h"
+#include "mosdef.h"
+#include "edid.h"
+#include <sim.h>
+
+// Plan cache hit path against a full resolve on the simulated backend, for
+// topologies of 2 to 64 monitors with EDIDs in a temporary sysfs tree. The
+// full path parses the selectors, enumerates (EDID lookups included) and
+// plans; the hit path fingerprints the displays and decodes the stored plan.
+// Both are followed by the same apply, shown separately.
+
+#define SELECTORS "M2,model:LG*"
+
+static void quiet_log(LogLevel level, const char* message, void* user_data) {
+    (void)level;
+    (void)message;
+    (void)user_data;
+}
+
+// n monitors in a row, each with its own EDID
+static bool set_topology(const char* root, int count, const BYTE* edid_template) {
+    static char models[SIM_MAX_MONITORS][16];
+    static char connectors[SIM_MAX_MONITORS][32];
+    SimMonitor monitors[SIM_MAX_MONITORS];
+
+    for (int i = 0; i < count; i++) {
+        sprintf_s(models[i], sizeof(models[i]), "GSM5B7F");
+        sprintf_s(connectors[i], sizeof(connectors[i]), "card0-DP-%d", i + 1);
+        SimMonitor monitor = { models[i], connectors[i], 1920, 1080, DMDO_DEFAULT, 60, (LONG)(1920 * i), 0 };
+        monitors[i] = monitor;
+
+        BYTE edid[EDID_BLOCK_SIZE];
+        memcpy(edid, edid_template, EDID_BLOCK_SIZE);
+        DWORD serial = (DWORD)i + 1;
+        memcpy(edid + 12, &serial, sizeof(serial));
+        BYTE sum = 0;
+        for (int j = 0; j < EDID_BLOCK_SIZE - 1; j++) sum += edid[j];
+        edid[EDID_BLOCK_SIZE - 1] = (BYTE)(0x100 - sum);
+
+        char path[MAX_PATH];
+        sprintf_s(path, sizeof(path), "%s/%s", root, connectors[i]);
+        CreateDirectoryA(path, NULL);
+        sprintf_s(path, sizeof(path), "%s/%s/edid", root, connectors[i]);
+        FILE* file = NULL;
+        if (fopen_s(&file, path, "wb") != 0 || !file) return false;
+        fwrite(edid, 1, sizeof(edid), file);
+        fclose(file);
+    }
+    return sim_set_monitors(monitors, count);
+}
+
+static void run(MosDefContext* ctx, int monitors, int iterations) {
+    char key[64];
+    sprintf_s(key, sizeof(key), "landscape include=%s n=%d", SELECTORS, monitors);
+
+    double full_seconds = 0.0;
+    double apply_seconds = 0.0;
+    for (int i = 0; i < iterations; i++) {
+        double start = bench_now();
+        SelectorList* selectors = mosdef_parse_selectors(ctx, SELECTORS);
+        RotationPlan* plan = NULL;
+        mosdef_plan(ctx, ROTATION_LANDSCAPE, selectors, NULL, &plan);
+        full_seconds += bench_now() - start;
+
+        if (i == 0) mosdef_store_cached_plan(ctx, key, plan);
+
+        start = bench_now();
+        BatchRotationResult result = { 0, 0, NULL, 0 };
+        mosdef_apply(ctx, plan, &result);
+        apply_seconds += bench_now() - start;
+
+        mosdef_free_result(ctx, &result);
+        mosdef_free_plan(ctx, plan);
+        mosdef_free_selectors(ctx, selectors);
+    }
+
+    double hit_seconds = 0.0;
+    int hits = 0;
+    for (int i = 0; i < iterations; i++) {
+        double start = bench_now();
+        RotationPlan* plan = NULL;
+        hits += mosdef_lookup_cached_plan(ctx, key, &plan) == MOSDEF_OK;
+        hit_seconds += bench_now() - start;
+        mosdef_free_plan(ctx, plan);
+    }
+
+    printf("%8d  %12.1f  %11.1f  %8.1fx  %11.1f  %d/%d\n", monitors,
+           full_seconds * 1e6 / iterations, hit_seconds * 1e6 / iterations,
+           full_seconds / (hit_seconds > 0.0 ? hit_seconds : 1e-9),
+           apply_seconds * 1e6 / iterations, hits, iterations);
+}
+
+int main(int argc, char** argv) {
+    int iterations = bench_quick(argc, argv) ? 20 : 2000;
+
+    char directory[] = "/tmp/mosdef-bench-XXXXXX";
+    if (!mkdtemp(directory)) return EXIT_FAILURE;
+    setenv("LOCALAPPDATA", directory, 1);
+    char root[sizeof(directory) + 8];
+    sprintf_s(root, sizeof(root), "%s/drm", directory);
+    CreateDirectoryA(root, NULL);
+    setenv("MOSDEF_DRM_ROOT", root, 1);
+
+    BYTE edid_template[EDID_MAX_SIZE];
+    if (bench_read_fixture("edid/lg_no_serial.bin", edid_template, sizeof(edid_template)) != EDID_BLOCK_SIZE) {
+        return EXIT_FAILURE;
+    }
+
+    LogSink quiet = { quiet_log, NULL, false };
+    MosDefContext* ctx = mosdef_create(NULL, NULL, &quiet);
+    if (!ctx) return EXIT_FAILURE;
+
+    printf("selectors \"%s\", %d iterations\n", SELECTORS, iterations);
+    printf("monitors  full us/plan  hit us/plan   speedup  apply us/op  hits\n");
+    int sizes[] = { 2, 8, 16, 64 };
+    for (int i = 0; i < 4; i++) {
+        if (!set_topology(root, sizes[i], edid_template)) {
+            fprintf(stderr, "Failed to set up %d monitors\n", sizes[i]);
+            break;
+        }
+        run(ctx, sizes[i], iterations);
+    }
+
+    mosdef_destroy(ctx);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,88 @@
+#include "bench.h"
+#include "util.h"
+#include "cli.h"
+
+// Selector list parsing at scale: generated lists of thousands of mixed
+// entries (M#, device:, quoted name:, edid:, native:) parsed directly, copied
+// as get_applicable_selectors does, and parsed through parse_args as an
+// --include value. Also times rejecting a list whose last entry is invalid,
+// which has to scan the whole list to report the error column.
+
+static const int k_counts[] = { 1000, 5000, 20000 };
+
+// "M1,device:\\.\DISPLAY2,name:"Dell U2703",edid:DEL1004,native:2560x1440,..."
+static char* generate_list(int count, bool broken_tail) {
+    size_t capacity = (size_t)count * 32 + 64;
+    char* text = (char*)malloc(capacity);
+    if (!text) return NULL;
+
+    size_t pos = 0;
+    for (int i = 0; i < count; i++) {
+        const char* separator = i > 0 ? "," : "";
+        switch (i % 5) {
+            case 0:  pos += sprintf_s(text + pos, capacity - pos, "%sM%d", separator, i % 64 + 1); break;
+            case 1:  pos += sprintf_s(text + pos, capacity - pos, "%sdevice:\\\\.\\DISPLAY%d", separator, i % 16 + 1); break;
+            case 2:  pos += sprintf_s(text + pos, capacity - pos, "%sname:\"Dell U27%02d\"", separator, i % 100); break;
+            case 3:  pos += sprintf_s(text + pos, capacity - pos, "%sedid:DEL%04X", separator, i & 0xFFFF); break;
+            default: pos += sprintf_s(text + pos, capacity - pos, "%snative:2560x1440", separator); break;
+        }
+    }
+    if (broken_tail) {
+        sprintf_s(text + pos, capacity - pos, ",native:2560");
+    }
+    return text;
+}
+
+int main(int argc, char** argv) {
+    bool quick = bench_quick(argc, argv);
+
+    printf("entries  bytes     parse ms  copy ms  parse_args ms  reject ms  error column\n");
+    for (size_t c = 0; c < sizeof(k_counts) / sizeof(k_counts[0]); c++) {
+        int count = k_counts[c];
+        int rounds = quick ? 1 : (int)(2000000 / count);
+        char* list = generate_list(count, false);
+        char* broken = generate_list(count, true);
+        if (!list || !broken) return EXIT_FAILURE;
+
+        SelectorParseError error;
+        double start = bench_now();
+        for (int r = 0; r < rounds; r++) {
+            SelectorList* selectors = parse_selector_list_with_error(list, &error);
+            if (!selectors || selectors->count != count) return EXIT_FAILURE;
+            free_selector_list(selectors);
+        }
+        double parse = (bench_now() - start) / rounds;
+
+        SelectorList* parsed = parse_selector_list_with_error(list, &error);
+        if (!parsed) return EXIT_FAILURE;
+        start = bench_now();
+        for (int r = 0; r < rounds; r++) {
+            SelectorList* copy = copy_selector_list(parsed);
+            if (!copy) return EXIT_FAILURE;
+            free_selector_list(copy);
+        }
+        double copy = (bench_now() - start) / rounds;
+        free_selector_list(parsed);
+
+        char* arguments[] = { "mos-def", "portrait", "--include", list };
+        start = bench_now();
+        for (int r = 0; r < rounds; r++) {
+            CliArgs* args = parse_args(4, arguments);
+            if (!args || !args->include_selectors || args->include_selectors->count != count) return EXIT_FAILURE;
+            free_cli_args(args);
+        }
+        double cli = (bench_now() - start) / rounds;
+
+        start = bench_now();
+        for (int r = 0; r < rounds; r++) {
+            if (parse_selector_list_with_error(broken, &error)) return EXIT_FAILURE;
+        }
+        double reject = (bench_now() - start) / rounds;
+
+        printf("%7d  %8zu  %8.3f  %7.3f  %13.3f  %9.3f  %12d\n", count, strlen(list),
+               parse * 1e3, copy * 1e3, cli * 1e3, reject * 1e3, error.column);
+        free(list);
+        free(broken);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,90 @@
+#include "bench.h"
+#include "selexpr.h"
+
+// Selector expression cost: compiling each expression cold (unique text, so
+// the program cache misses) and evaluating it against 10k synthetic
+// monitors with varied names and models. Evaluation walks bytecode and DFAs
+// and should stay in the tens of nanoseconds whatever the regex.
+
+#define MONITOR_COUNT 10000
+
+static const char* k_expressions[] = {
+    "width>=2560 && orientation==0",
+    "name~\"dell\"",
+    "name~\"^dell u27\\d\\d\"",
+    "model~\"(hdr|oled)\" || name~\"lg|samsung|hp\"",
+    "name~\"^(dell|hp) .*[13579]$\" && x<0 && !(refresh==144)",
+};
+
+static const char* k_vendors[] = { "DELL", "LG", "Samsung", "HP", "BenQ", "ASUS" };
+static const char* k_models[] = { "U2720Q", "HDR 4K", "Odyssey OLED G8", "E24 G5", "PD3220U", "ProArt PA32" };
+
+static char* format_name(int i) {
+    char text[64];
+    sprintf_s(text, sizeof(text), "%s %s %d", k_vendors[i % 6], k_models[(i / 6) % 6], i);
+    return _strdup(text);
+}
+
+static MonitorInfo* make_monitors(void) {
+    MonitorInfo* monitors = (MonitorInfo*)calloc(MONITOR_COUNT, sizeof(MonitorInfo));
+    for (int i = 0; monitors && i < MONITOR_COUNT; i++) {
+        MonitorInfo* monitor = &monitors[i];
+        monitor->id = "M1";
+        monitor->device_name = format_name(i);
+        monitor->device_path = "\\\\.\\DISPLAY1";
+        monitor->device_id = "";
+        monitor->stable_id = "GSM5B7F-00000000";
+        monitor->monitor_interface = "";
+        monitor->model_name = (char*)k_models[(i / 6) % 6];
+        monitor->width = (i % 3) ? 2560 : 1920;
+        monitor->height = 1440;
+        monitor->orientation = (DWORD)(i % 4);     // DMDO_*
+        monitor->position_x = (i % 5 - 2) * 2560;
+        monitor->refresh_hz = (i % 2) ? 60 : 144;
+    }
+    return monitors;
+}
+
+int main(int argc, char** argv) {
+    bool quick = bench_quick(argc, argv);
+    int compile_rounds = quick ? 10 : 2000;
+    int eval_rounds = quick ? 1 : 50;
+
+    MonitorInfo* monitors = make_monitors();
+    if (!monitors) return EXIT_FAILURE;
+
+    printf("expression                                               compile us  eval ns/monitor  matched\n");
+    int count = (int)(sizeof(k_expressions) / sizeof(k_expressions[0]));
+    for (int e = 0; e < count; e++) {
+        // Cold compiles: a unique suffix defeats the program cache
+        char source[256];
+        double start = bench_now();
+        for (int r = 0; r < compile_rounds; r++) {
+            sprintf_s(source, sizeof(source), "(%s) || width==%d", k_expressions[e], 100000 + r);
+            SelectorProgram* program = selector_program_compile(source);
+            if (!program) return EXIT_FAILURE;
+            selector_program_release(program);
+        }
+        double compile = (bench_now() - start) / compile_rounds;
+
+        SelectorProgram* program = selector_program_compile(k_expressions[e]);
+        if (!program) return EXIT_FAILURE;
+        int matched = 0;
+        start = bench_now();
+        for (int r = 0; r < eval_rounds; r++) {
+            matched = 0;
+            for (int i = 0; i < MONITOR_COUNT; i++) {
+                matched += selector_program_matches(program, &monitors[i]) ? 1 : 0;
+            }
+            bench_consume((ULONG64)matched);
+        }
+        double eval = (bench_now() - start) / ((double)eval_rounds * MONITOR_COUNT);
+        selector_program_release(program);
+
+        printf("%-55s  %10.2f  %15.1f  %7d\n", k_expressions[e], compile * 1e6, eval * 1e9, matched);
+    }
+
+    for (int i = 0; i < MONITOR_COUNT; i++) free(monitors[i].device_name);
+    free(monitors);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,64 @@
+#include "bench.h"
+#include "strsearch.h"
+
+// Substring kernels: ns per search for the scalar loop, SSE2 and AVX2 over
+// monitor-name-sized and longer haystacks. The needle's first byte is common
+// in the text and its last byte is not, which is the case where the vector
+// kernels' first-and-last filter pays off; "hit" puts the needle at the end.
+
+static const size_t k_lengths[] = { 16, 32, 64, 256, 4096 };
+
+typedef bool (*SearchKernel)(const char* haystack, size_t haystack_length,
+                             const char* needle, size_t needle_length);
+
+static double time_kernel(SearchKernel kernel, const char* haystack, size_t length,
+                          const char* needle, size_t needle_length, int iterations) {
+    ULONG64 found = 0;
+    double start = bench_now();
+    for (int i = 0; i < iterations; i++) {
+        found += kernel(haystack, length, needle, needle_length) ? 1 : 0;
+    }
+    double elapsed = bench_now() - start;
+    bench_consume(found);
+    return elapsed / iterations;
+}
+
+int main(int argc, char** argv) {
+    bool quick = bench_quick(argc, argv);
+    const char* needle = "dell u2720q";
+    size_t needle_length = strlen(needle);
+    bool avx2 = strsearch_has_avx2();
+
+    size_t max_length = k_lengths[sizeof(k_lengths) / sizeof(k_lengths[0]) - 1];
+    char* buffer = (char*)_aligned_malloc(max_length + STRSEARCH_PADDING, 64);
+    if (!buffer) return EXIT_FAILURE;
+
+    printf("length  case  scalar ns  sse2 ns  avx2 ns\n");
+    for (size_t l = 0; l < sizeof(k_lengths) / sizeof(k_lengths[0]); l++) {
+        size_t length = k_lengths[l];
+        int iterations = quick ? 100 : (int)(200000000 / (length + 64));
+
+        for (int hit = 0; hit < 2; hit++) {
+            // "dell p2419h dell s2721d ..." with the real model last on a hit
+            for (size_t i = 0; i < length + STRSEARCH_PADDING; i++) {
+                buffer[i] = "dell p2419h "[i % 12];
+            }
+            if (hit) memcpy(buffer + length - needle_length, needle, needle_length);
+
+            double scalar = time_kernel(strsearch_contains_scalar, buffer, length, needle, needle_length, iterations);
+            double sse2 = time_kernel(strsearch_contains_sse2, buffer, length, needle, needle_length, iterations);
+            double avx = avx2 ? time_kernel(strsearch_contains_avx2, buffer, length, needle, needle_length, iterations)
+                              : 0.0;
+            if (avx2) {
+                printf("%6zu  %-4s  %9.1f  %7.1f  %7.1f\n", length, hit ? "hit" : "miss",
+                       scalar * 1e9, sse2 * 1e9, avx * 1e9);
+            } else {
+                printf("%6zu  %-4s  %9.1f  %7.1f  %7s\n", length, hit ? "hit" : "miss",
+                       scalar * 1e9, sse2 * 1e9, "-");
+            }
+        }
+    }
+
+    _aligned_free(buffer);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,99 @@
+#include "bench.h"
+#include "topology.h"
+
+// Read-side cost of topology snapshots: pin + release pairs on one thread,
+// then with several readers contending on the packed word, each with and
+// without a writer publishing a new snapshot continuously.
+
+static MonitorList* make_monitors(int count) {
+    MonitorList* list = (MonitorList*)malloc(sizeof(MonitorList));
+    if (!list) return NULL;
+    list->count = count;
+    list->index = NULL;
+    list->monitors = (MonitorInfo*)calloc((size_t)count, sizeof(MonitorInfo));
+    return list;
+}
+
+typedef struct {
+    TopologyStore* store;
+    int pins;
+    double seconds;
+} Reader;
+
+static volatile LONG g_stop_writer = 0;
+
+static DWORD WINAPI reader_thread(LPVOID parameter) {
+    Reader* reader = (Reader*)parameter;
+    double start = bench_now();
+    for (int i = 0; i < reader->pins; i++) {
+        const TopologySnapshot* snapshot = topology_store_pin(reader->store);
+        bench_consume((ULONG64)snapshot->monitors->count);
+        topology_store_release(reader->store, snapshot);
+    }
+    reader->seconds = bench_now() - start;
+    return 0;
+}
+
+static DWORD WINAPI writer_thread(LPVOID parameter) {
+    TopologyStore* store = (TopologyStore*)parameter;
+    LONG publishes = 0;
+    while (!ReadAcquire(&g_stop_writer)) {
+        topology_store_publish(store, make_monitors(4));
+        publishes++;
+    }
+    return (DWORD)publishes;
+}
+
+static void run(TopologyStore* store, int readers, bool writer, int pins) {
+    Reader state[16];
+    HANDLE threads[16];
+    HANDLE writer_handle = NULL;
+
+    g_stop_writer = 0;
+    if (writer) writer_handle = CreateThread(NULL, 0, writer_thread, store, 0, NULL);
+    for (int i = 0; i < readers; i++) {
+        state[i].store = store;
+        state[i].pins = pins;
+        threads[i] = CreateThread(NULL, 0, reader_thread, &state[i], 0, NULL);
+    }
+
+    double worst = 0.0;
+    for (int i = 0; i < readers; i++) {
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+        if (state[i].seconds > worst) worst = state[i].seconds;
+    }
+
+    DWORD publishes = 0;
+    if (writer_handle) {
+        InterlockedExchange(&g_stop_writer, 1);
+        WaitForSingleObject(writer_handle, INFINITE);
+        GetExitCodeThread(writer_handle, &publishes);
+        CloseHandle(writer_handle);
+    }
+
+    double total_pins = (double)pins * readers;
+    printf("%7d  %-6s  %12.1f  %14.2f  %10lu\n", readers, writer ? "yes" : "no",
+           worst * 1e9 / pins, total_pins / worst / 1e6, (unsigned long)publishes);
+}
+
+int main(int argc, char** argv) {
+    int pins = bench_quick(argc, argv) ? 20000 : 5000000;
+
+    TopologyStore* store = topology_store_create();
+    if (!store || !topology_store_publish(store, make_monitors(4))) {
+        fprintf(stderr, "Failed to create the topology store\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("pin + release, %d pairs per reader\n", pins);
+    printf("readers  writer  ns/pair (max)  Mpairs/s total  publishes\n");
+    int reader_counts[] = { 1, 2, 4, 8 };
+    for (int i = 0; i < 4; i++) {
+        run(store, reader_counts[i], false, pins);
+        run(store, reader_counts[i], true, pins);
+    }
+
+    topology_store_destroy(store);
+    return EXIT_SUCCESS;
+}
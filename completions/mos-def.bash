@@ -0,0 +1,38 @@
+# bash completion for mos-def (Git Bash, MSYS2, Cygwin). Source it from
+# ~/.bashrc:
+#
+#   source /path/to/completions/mos-def.bash
+#
+# Candidates come from "mos-def __complete", which answers from a cached
+# topology, so completing selectors never enumerates monitors.
+
+_mos_def() {
+    local cur cword
+    local -a words
+    if declare -F _get_comp_words_by_ref >/dev/null; then
+        # Keep selectors such as device:"\\.\DISPLAY1" in one word
+        _get_comp_words_by_ref -n =: cur words cword
+    else
+        cur=${COMP_WORDS[COMP_CWORD]}
+        words=("${COMP_WORDS[@]}")
+        cword=$COMP_CWORD
+    fi
+
+    # Typed selectors arrive shell-escaped; mos-def matches the raw text
+    cur=${cur//\\\"/\"}
+
+    local IFS=$'\n'
+    local -a candidates
+    candidates=($("${words[0]}" __complete "$((cword - 1))" -- "${words[@]:1:cword-1}" "$cur" 2>/dev/null))
+
+    COMPREPLY=()
+    local candidate
+    for candidate in "${candidates[@]}"; do
+        COMPREPLY+=("$(printf '%q' "$candidate")")
+    done
+    if declare -F __ltrim_colon_completions >/dev/null; then
+        __ltrim_colon_completions "$cur"
+    fi
+}
+
+complete -o default -F _mos_def mos-def mos-def.exe
@@ -0,0 +1,29 @@
+# PowerShell completion for mos-def. Dot-source it from your profile:
+#
+#   . C:\path\to\completions\mos-def.ps1
+#
+# Candidates come from "mos-def __complete", which answers from a cached
+# topology, so completing selectors never enumerates monitors.
+
+Register-ArgumentCompleter -Native -CommandName mos-def, mos-def.exe -ScriptBlock {
+    param($wordToComplete, $commandAst, $cursorPosition)
+
+    # Words before the one being completed, as typed
+    $words = @()
+    foreach ($element in ($commandAst.CommandElements | Select-Object -Skip 1)) {
+        if ($element.Extent.StartOffset -ge $cursorPosition) { break }
+        if ($wordToComplete -and $element.Extent.EndOffset -ge $cursorPosition) { break }
+        $words += $element.Extent.Text
+    }
+
+    # The index tells mos-def where the current word is, since Windows
+    # PowerShell drops empty arguments to native commands
+    $program = $commandAst.CommandElements[0].Extent.Text
+    $candidates = & $program __complete $words.Count '--' @words $wordToComplete 2>$null
+
+    foreach ($candidate in $candidates) {
+        # Selectors such as name:"DELL U2720Q" must reach mos-def with their quotes
+        $text = if ($candidate -match '[\s"''`$]') { "'" + ($candidate -replace "'", "''") + "'" } else { $candidate }
+        [System.Management.Automation.CompletionResult]::new($text, $candidate, 'ParameterValue', $candidate)
+    }
+}
@@ -0,0 +1,531 @@
+// Winsock 2 must precede windows.h
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include "fleet.h"
+#include "cli.h"
+#include "config.h"
+#include "event_ring.h"
+#include "hmac.h"
+#include "util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Each connection has its own thread, so a stalled controller holds only
+// itself. The header must arrive soon after the challenge; the rest of the
+// request has longer, and so does the reply, timed from when the request
+// has run rather than from accept so time queued behind other requests
+// does not count against it.
+#define AGENT_MAX_CONNECTIONS 64
+#define AGENT_HEADER_TIMEOUT_MS 2000
+#define AGENT_IO_TIMEOUT_MS 10000
+#define AGENT_ERROR_SIZE 256
+
+typedef struct {
+    CRITICAL_SECTION lock;          // Serializes requests; guards the fields below
+    MosDefContext* ctx;
+    MosDefContext* dry_ctx;         // Created on the first dry-run request
+    const MosDefConfig* config;     // Saved default selector for rotate requests; borrowed
+    char error[AGENT_ERROR_SIZE];   // Last error logged while serving a request
+
+    MosDefOptions options;
+    LogSink log_sink;               // Captures errors into error; held with lock
+    const char* topology_path;
+    FleetKey key;
+
+    CRITICAL_SECTION connections_lock;
+    CONDITION_VARIABLE connections_done;
+    int connections;                // Connection threads still running
+} AgentSession;
+
+typedef struct {
+    AgentSession* session;
+    SOCKET socket;
+    ULONGLONG accepted;             // GetTickCount64
+    char peer[64];
+} AgentConnection;
+
+typedef struct {
+    MosDefStatus status;
+    int changed;
+} AgentReply;
+
+// Console control handlers carry no context; one agent receives Ctrl+C
+static HANDLE volatile g_agent_stop = NULL;
+
+static BOOL WINAPI agent_ctrl_handler(DWORD ctrl_type) {
+    (void)ctrl_type;
+    HANDLE stop = g_agent_stop;
+    if (stop) {
+        SetEvent(stop);
+        return TRUE;
+    }
+    return FALSE;
+}
+
+// Diagnostics go to stderr; while a request runs, errors are also kept for
+// its response
+static void agent_log_write(LogLevel level, const char* message, void* user_data) {
+    AgentSession* session = (AgentSession*)user_data;
+    if (session && level == LOG_LEVEL_ERROR) {
+        strncpy_s(session->error, sizeof(session->error), message, _TRUNCATE);
+    }
+
+    const char* prefix = (level == LOG_LEVEL_ERROR) ? "ERROR: " :
+                         (level == LOG_LEVEL_VERBOSE) ? "VERBOSE: " : "";
+    fprintf(stderr, "%s%s\n", prefix, message);
+}
+
+static MosDefContext* create_agent_context(AgentSession* session, bool dry_run) {
+    MosDefOptions options = session->options;
+    options.dry_run = options.dry_run || dry_run;
+
+    MosDefContext* ctx = mosdef_create(&options, NULL, &session->log_sink);
+    if (ctx && session->topology_path && mosdef_load_topology(ctx, session->topology_path) != MOSDEF_OK) {
+        mosdef_destroy(ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+// CLI exit codes, so a fleet result reads like the local command's
+static int exit_code_for_status(MosDefStatus status) {
+    switch (status) {
+        case MOSDEF_OK:
+            return 0;
+        case MOSDEF_ERR_INVALID_ARG:
+        case MOSDEF_ERR_NO_MONITORS:
+        case MOSDEF_ERR_NO_MATCH:
+        case MOSDEF_ERR_BAD_PLAN:
+            return 2;
+        case MOSDEF_ERR_STALE_PLAN:
+            return 4;
+        default:
+            return 3;
+    }
+}
+
+// Applies a plan without confirmation. The prior state is journaled (dry
+// runs journal nothing), so `snapshot undo` on the machine reverts a step.
+static AgentReply apply_agent_plan(MosDefContext* ctx, const RotationPlan* plan) {
+    AgentReply reply = { MOSDEF_OK, 0 };
+
+    DisplaySetup* before = NULL;
+    mosdef_capture_setup(ctx, &before);
+
+    BatchRotationResult result = { 0, 0, NULL, 0 };
+    reply.status = mosdef_apply(ctx, plan, &result);
+    reply.changed = result.success_count;
+
+    if (before && result.success_count > 0) {
+        mosdef_journal_setup(ctx, before);
+    }
+
+    mosdef_free_result(ctx, &result);
+    mosdef_free_setup(ctx, before);
+    return reply;
+}
+
+static AgentReply handle_rotate_request(AgentSession* session, MosDefContext* ctx,
+                                        const BYTE* payload, DWORD length) {
+    AgentReply reply = { MOSDEF_ERR_INVALID_ARG, 0 };
+
+    char* text = (char*)malloc(length + 1);
+    if (!text) {
+        reply.status = MOSDEF_ERR_NO_MEMORY;
+        return reply;
+    }
+    memcpy(text, payload, length);
+    text[length] = '\0';
+
+    RotationAction action;
+    if (!parse_rotation_action(text, session->config, &action)) {
+        log_error("Not a rotation: %s", text);
+        free(text);
+        return reply;
+    }
+
+    const SelectorList* include = action.include_selectors->count > 0 ? action.include_selectors : NULL;
+    RotationPlan* plan = NULL;
+    reply.status = mosdef_plan(ctx, action.command, include, action.args->exclude_selectors, &plan);
+    if (reply.status == MOSDEF_OK) {
+        reply = apply_agent_plan(ctx, plan);
+    } else if (reply.status == MOSDEF_ERR_NO_MATCH) {
+        log_error("No monitors match: %s", text);
+    }
+
+    mosdef_free_plan(ctx, plan);
+    free_rotation_action(&action);
+    free(text);
+    return reply;
+}
+
+static AgentReply handle_apply_request(MosDefContext* ctx, const BYTE* payload, DWORD length) {
+    AgentReply reply = { MOSDEF_OK, 0 };
+
+    RotationPlan* plan = NULL;
+    reply.status = mosdef_decode_plan(ctx, payload, length, &plan);
+    if (reply.status == MOSDEF_OK) {
+        reply.status = mosdef_verify_plan(ctx, plan);
+        if (reply.status == MOSDEF_ERR_STALE_PLAN) {
+            log_error("Display topology changed since the plan was created");
+        } else if (reply.status == MOSDEF_OK) {
+            reply = apply_agent_plan(ctx, plan);
+        }
+    }
+
+    mosdef_free_plan(ctx, plan);
+    return reply;
+}
+
+static AgentReply handle_layout_request(MosDefContext* ctx, const BYTE* payload, DWORD length) {
+    AgentReply reply = { MOSDEF_OK, 0 };
+
+    MonitorList* layout = NULL;
+    reply.status = mosdef_parse_topology(ctx, (const char*)payload, length, &layout);
+    if (reply.status == MOSDEF_OK) {
+        reply.status = mosdef_restore_layout(ctx, layout, &reply.changed);
+    }
+
+    mosdef_free_monitor_list(ctx, layout);
+    return reply;
+}
+
+// Blocking socket I/O; each call is bounded by what is left until deadline
+// (GetTickCount64)
+static bool set_remaining_timeout(SOCKET socket, int option, ULONGLONG deadline) {
+    ULONGLONG now = GetTickCount64();
+    if (now >= deadline) return false;
+    DWORD timeout = (DWORD)(deadline - now);
+    return setsockopt(socket, SOL_SOCKET, option, (const char*)&timeout, sizeof(timeout)) != SOCKET_ERROR;
+}
+
+static bool recv_all(SOCKET socket, BYTE* buffer, DWORD length, ULONGLONG deadline) {
+    DWORD received = 0;
+    while (received < length) {
+        if (!set_remaining_timeout(socket, SO_RCVTIMEO, deadline)) return false;
+        int count = recv(socket, (char*)buffer + received, (int)(length - received), 0);
+        if (count <= 0) return false;
+        received += (DWORD)count;
+    }
+    return true;
+}
+
+static bool send_all(SOCKET socket, const BYTE* buffer, DWORD length, ULONGLONG deadline) {
+    DWORD sent = 0;
+    while (sent < length) {
+        if (!set_remaining_timeout(socket, SO_SNDTIMEO, deadline)) return false;
+        int count = send(socket, (const char*)buffer + sent, (int)(length - sent), 0);
+        if (count <= 0) return false;
+        sent += (DWORD)count;
+    }
+    return true;
+}
+
+// Encodes and signs the response to the request whose header is
+// request_header; returns the frame length
+static DWORD build_reply(const AgentSession* session, const BYTE* challenge, const BYTE* request_header,
+                         const AgentReply* reply, BYTE* frame) {
+    size_t error_length = strlen(session->error);
+    fleet_write_header(frame, FLEET_RESPONSE, 0, (DWORD)(6 + error_length));
+
+    // The changed count is a WORD on the wire; a larger count saturates
+    // rather than wrapping
+    BYTE* body = frame + FLEET_HEADER_SIZE;
+    WORD changed = (WORD)(reply->changed > 0xFFFF ? 0xFFFF : (reply->changed < 0 ? 0 : reply->changed));
+    WORD message_length = (WORD)error_length;
+    body[0] = (BYTE)reply->status;
+    body[1] = (BYTE)exit_code_for_status(reply->status);
+    memcpy(body + 2, &changed, sizeof(changed));
+    memcpy(body + 4, &message_length, sizeof(message_length));
+    memcpy(body + 6, session->error, error_length);
+
+    fleet_sign_frame(&session->key, challenge, request_header + FLEET_SIGNED_HEADER_SIZE,
+                     frame, body, (DWORD)(6 + error_length));
+    return (DWORD)(FLEET_HEADER_SIZE + 6 + error_length);
+}
+
+static AgentReply execute_request(AgentSession* session, FleetMessageType type, BYTE flags,
+                                  const BYTE* payload, DWORD length) {
+    MosDefContext* ctx = session->ctx;
+    if (flags & FLEET_FLAG_DRY_RUN) {
+        if (!session->dry_ctx) {
+            session->dry_ctx = create_agent_context(session, true);
+        }
+        ctx = session->dry_ctx;
+    }
+
+    AgentReply reply = { MOSDEF_ERR_INVALID_ARG, 0 };
+    if (!ctx) {
+        reply.status = MOSDEF_ERR_NO_MEMORY;
+    } else if (type == FLEET_REQUEST_ROTATE) {
+        reply = handle_rotate_request(session, ctx, payload, length);
+    } else if (type == FLEET_REQUEST_APPLY) {
+        reply = handle_apply_request(ctx, payload, length);
+    } else if (type == FLEET_REQUEST_LAYOUT) {
+        reply = handle_layout_request(ctx, payload, length);
+    }
+    return reply;
+}
+
+static bool is_request_type(FleetMessageType type) {
+    return type == FLEET_REQUEST_ROTATE || type == FLEET_REQUEST_APPLY || type == FLEET_REQUEST_LAYOUT;
+}
+
+static void serve_connection(AgentSession* session, SOCKET client, const char* peer, ULONGLONG accepted) {
+    ULONGLONG header_deadline = accepted + AGENT_HEADER_TIMEOUT_MS;
+    ULONGLONG deadline = accepted + AGENT_IO_TIMEOUT_MS;
+
+    // The challenge makes every MAC good for this connection only, so a
+    // captured request cannot be replayed
+    BYTE challenge_frame[FLEET_HEADER_SIZE + FLEET_CHALLENGE_SIZE];
+    BYTE* challenge = challenge_frame + FLEET_HEADER_SIZE;
+    fleet_write_header(challenge_frame, FLEET_CHALLENGE, 0, FLEET_CHALLENGE_SIZE);
+    if (!random_bytes(challenge, FLEET_CHALLENGE_SIZE)) {
+        log_error("Failed to generate a challenge for %s", peer);
+        return;
+    }
+    if (!send_all(client, challenge_frame, sizeof(challenge_frame), header_deadline)) {
+        log_verbose("Failed to send challenge to %s", peer);
+        return;
+    }
+
+    BYTE header[FLEET_HEADER_SIZE];
+    FleetMessageType type;
+    BYTE flags;
+    DWORD length;
+    if (!recv_all(client, header, sizeof(header), header_deadline) ||
+        !fleet_parse_header(header, &type, &flags, &length) || !is_request_type(type)) {
+        log_verbose("Dropped malformed or late request from %s", peer);
+        return;
+    }
+
+    BYTE* payload = (BYTE*)malloc(length ? length : 1);
+    if (!payload || !recv_all(client, payload, length, deadline)) {
+        log_verbose("Incomplete request from %s", peer);
+        free(payload);
+        return;
+    }
+
+    if (!fleet_verify_frame(&session->key, challenge, NULL, header, payload, length)) {
+        log_info("%s: rejected request with a bad signature", peer);
+        free(payload);
+
+        BYTE rejected[FLEET_HEADER_SIZE];
+        fleet_write_header(rejected, FLEET_RESPONSE, FLEET_FLAG_REJECTED, 0);
+        send_all(client, rejected, sizeof(rejected), deadline);
+        return;
+    }
+
+    BYTE frame[FLEET_HEADER_SIZE + 6 + AGENT_ERROR_SIZE];
+    DWORD frame_length;
+    LONG64 started = event_timestamp_now();
+
+    EnterCriticalSection(&session->lock);
+    const LogSink* previous_sink = log_set_thread_sink(&session->log_sink);
+    session->error[0] = '\0';
+    AgentReply reply = execute_request(session, type, flags, payload, length);
+    log_info("%s: request %d%s, %s, %d changed (%.1f ms)", peer, (int)type,
+             (flags & FLEET_FLAG_DRY_RUN) ? " (dry run)" : "", mosdef_status_string(reply.status),
+             reply.changed, event_timestamp_elapsed_us(started, event_timestamp_now()) / 1000.0);
+    frame_length = build_reply(session, challenge, header, &reply, frame);
+    log_set_thread_sink(previous_sink);
+    LeaveCriticalSection(&session->lock);
+    free(payload);
+
+    if (!send_all(client, frame, frame_length, GetTickCount64() + AGENT_IO_TIMEOUT_MS)) {
+        if (reply.changed > 0 && !(flags & FLEET_FLAG_DRY_RUN)) {
+            log_info("%s: %d monitor(s) changed but the reply could not be sent (error %d)", peer,
+                     reply.changed, WSAGetLastError());
+        } else {
+            log_verbose("Failed to send response to %s (error %d)", peer, WSAGetLastError());
+        }
+    }
+}
+
+static DWORD WINAPI connection_thread(LPVOID parameter) {
+    AgentConnection* connection = (AgentConnection*)parameter;
+    AgentSession* session = connection->session;
+
+    // Errors are captured for a response only while a request holds the lock
+    LogSink sink = { agent_log_write, NULL, session->options.verbose };
+    log_set_thread_sink(&sink);
+
+    serve_connection(session, connection->socket, connection->peer, connection->accepted);
+    shutdown(connection->socket, SD_BOTH);
+    closesocket(connection->socket);
+    free(connection);
+
+    log_set_thread_sink(NULL);
+    EnterCriticalSection(&session->connections_lock);
+    session->connections--;
+    WakeAllConditionVariable(&session->connections_done);
+    LeaveCriticalSection(&session->connections_lock);
+    return 0;
+}
+
+// Hands the client to a thread of its own; over the limit it is dropped
+static void start_connection(AgentSession* session, SOCKET client, const SOCKADDR_STORAGE* address, int length) {
+    AgentConnection* connection = (AgentConnection*)calloc(1, sizeof(AgentConnection));
+    if (!connection) {
+        closesocket(client);
+        return;
+    }
+    connection->session = session;
+    connection->socket = client;
+    connection->accepted = GetTickCount64();
+    strcpy_s(connection->peer, sizeof(connection->peer), "?");
+    getnameinfo((const SOCKADDR*)address, length, connection->peer, sizeof(connection->peer), NULL, 0, NI_NUMERICHOST);
+
+    EnterCriticalSection(&session->connections_lock);
+    bool admitted = session->connections < AGENT_MAX_CONNECTIONS;
+    if (admitted) session->connections++;
+    LeaveCriticalSection(&session->connections_lock);
+
+    HANDLE thread = admitted ? CreateThread(NULL, 0, connection_thread, connection, 0, NULL) : NULL;
+    if (thread) {
+        CloseHandle(thread);
+        return;
+    }
+
+    if (admitted) {
+        log_error("Failed to start a thread for %s", connection->peer);
+        EnterCriticalSection(&session->connections_lock);
+        session->connections--;
+        LeaveCriticalSection(&session->connections_lock);
+    } else {
+        log_verbose("Dropped connection from %s: %d already open", connection->peer, AGENT_MAX_CONNECTIONS);
+    }
+    closesocket(client);
+    free(connection);
+}
+
+static SOCKET open_listener(const char* address) {
+    char host[256] = "127.0.0.1";
+    USHORT port = FLEET_DEFAULT_PORT;
+    if (address && !fleet_parse_address(address, host, sizeof(host), &port)) {
+        log_error("Invalid listen address: %s", address);
+        return INVALID_SOCKET;
+    }
+
+    char service[8];
+    sprintf_s(service, sizeof(service), "%u", (unsigned)port);
+
+    ADDRINFOA hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+    hints.ai_flags = AI_PASSIVE;
+
+    ADDRINFOA* resolved = NULL;
+    if (getaddrinfo(host[0] ? host : NULL, service, &hints, &resolved) != 0 || !resolved) {
+        log_error("Cannot resolve listen address %s", address ? address : host);
+        return INVALID_SOCKET;
+    }
+
+    SOCKET listener = socket(resolved->ai_family, resolved->ai_socktype, resolved->ai_protocol);
+#ifndef _WIN32
+    // A restarted agent rebinds while its last connections sit in TIME_WAIT.
+    // On Windows the option would let another process take the port.
+    int reuse = 1;
+    if (listener != INVALID_SOCKET) {
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+    }
+#endif
+    if (listener == INVALID_SOCKET ||
+        bind(listener, resolved->ai_addr, (int)resolved->ai_addrlen) == SOCKET_ERROR ||
+        listen(listener, SOMAXCONN) == SOCKET_ERROR) {
+        log_error("Cannot listen on %s:%u (error %d)", host, (unsigned)port, WSAGetLastError());
+        if (listener != INVALID_SOCKET) closesocket(listener);
+        listener = INVALID_SOCKET;
+    } else {
+        log_info("Agent listening on %s:%u. Press Ctrl+C to exit.", host, (unsigned)port);
+    }
+
+    freeaddrinfo(resolved);
+    return listener;
+}
+
+int run_agent(const MosDefOptions* options, const MosDefConfig* config, const char* topology_path,
+              const char* address, const char* key_path) {
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
+        log_error("Failed to initialize Winsock");
+        return 3;
+    }
+
+    AgentSession session;
+    memset(&session, 0, sizeof(session));
+    if (!fleet_load_key(key_path, true, &session.key)) {
+        WSACleanup();
+        return 2;
+    }
+    InitializeCriticalSection(&session.lock);
+    InitializeCriticalSection(&session.connections_lock);
+    InitializeConditionVariable(&session.connections_done);
+    session.options = *options;
+    session.topology_path = topology_path;
+    session.config = config;
+
+    session.log_sink.write = agent_log_write;
+    session.log_sink.user_data = &session;
+    session.log_sink.verbose = options->verbose;
+    const LogSink* previous_sink = log_set_thread_sink(&session.log_sink);
+
+    // Only the main thread runs until connections start
+    int result = 3;
+    session.ctx = create_agent_context(&session, false);
+    SOCKET listener = session.ctx ? open_listener(address) : INVALID_SOCKET;
+    WSAEVENT accept_event = WSACreateEvent();
+    HANDLE stop_event = CreateEventA(NULL, TRUE, FALSE, NULL);
+
+    if (listener != INVALID_SOCKET && accept_event != WSA_INVALID_EVENT && stop_event &&
+        WSAEventSelect(listener, accept_event, FD_ACCEPT) != SOCKET_ERROR) {
+        result = 0;
+        g_agent_stop = stop_event;
+        SetConsoleCtrlHandler(agent_ctrl_handler, TRUE);
+
+        // Idle until a connection or Ctrl+C; nothing is polled
+        HANDLE waits[2] = { stop_event, accept_event };
+        while (WaitForMultipleObjects(2, waits, FALSE, INFINITE) == WAIT_OBJECT_0 + 1) {
+            WSAResetEvent(accept_event);
+
+            SOCKADDR_STORAGE peer_address;
+            int peer_length = sizeof(peer_address);
+            SOCKET client;
+            while ((client = accept(listener, (SOCKADDR*)&peer_address, &peer_length)) != INVALID_SOCKET) {
+                // Accepted sockets inherit the listener's event selection
+                u_long blocking = 0;
+                WSAEventSelect(client, NULL, 0);
+                ioctlsocket(client, FIONBIO, &blocking);
+
+                start_connection(&session, client, &peer_address, peer_length);
+                peer_length = sizeof(peer_address);
+            }
+        }
+
+        SetConsoleCtrlHandler(agent_ctrl_handler, FALSE);
+        g_agent_stop = NULL;
+    }
+
+    if (stop_event) CloseHandle(stop_event);
+    if (accept_event != WSA_INVALID_EVENT) WSACloseEvent(accept_event);
+    if (listener != INVALID_SOCKET) closesocket(listener);
+
+    // Connections end within their I/O deadlines once their request has run
+    EnterCriticalSection(&session.connections_lock);
+    while (session.connections > 0) {
+        SleepConditionVariableCS(&session.connections_done, &session.connections_lock, INFINITE);
+    }
+    LeaveCriticalSection(&session.connections_lock);
+
+    if (session.dry_ctx) mosdef_destroy(session.dry_ctx);
+    if (session.ctx) mosdef_destroy(session.ctx);
+    DeleteCriticalSection(&session.connections_lock);
+    DeleteCriticalSection(&session.lock);
+    SecureZeroMemory(&session.key, sizeof(session.key));
+    log_set_thread_sink(previous_sink);
+    WSACleanup();
+    return result;
+}
@@ -0,0 +1,405 @@
+#include "mosdef.h"
+#include "mosdef_internal.h"
+#include "util.h"
+#include <stdlib.h>
+#include <string.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Asynchronous operations run on a single worker thread per context, in
+// submission order. State transitions:
+//
+//   PENDING --worker picks up--> RUNNING --finished--> COMPLETED
+//      |                            |
+//      +--cancel--> CANCELLED       +--cancel flag--> COMPLETED (MOSDEF_ERR_CANCELLED)
+//
+// A completion callback may destroy its context. The worker cannot join
+// itself, so mosdef_destroy only marks the teardown and the worker performs
+// it once the callback returns, cancelling whatever is still queued.
+//
+// Each operation holds a reference on its context until it is released, so
+// the context's memory (and the allocator operations are carved from)
+// outlives mosdef_destroy until the last operation is released.
+
+typedef enum {
+    ASYNC_OP_ENUMERATE,
+    ASYNC_OP_APPLY,
+    ASYNC_OP_ROLLBACK
+} AsyncOperationKind;
+
+struct MosDefOperation {
+    MosDefContext* ctx;
+    AsyncOperationKind kind;
+    const RotationPlan* plan;
+    MosDefCompletionCallback callback;
+    void* user_data;
+
+    volatile LONG state;            // MosDefOperationState
+    volatile LONG cancel_requested;
+    volatile LONG refs;             // Caller + worker queue
+    MosDefStatus status;
+    MonitorList* monitors;
+    BatchRotationResult result;
+    HANDLE done_event;
+#ifndef _WIN32
+    int poll_fds[2];                // Pipe written once on finish (mosdef_operation_poll_fd)
+#endif
+
+    MosDefOperation* next;
+};
+
+struct AsyncWorker {
+    HANDLE thread;
+    DWORD thread_id;
+    CONDITION_VARIABLE wake;
+    MosDefOperation* head;
+    MosDefOperation* tail;
+    bool stopping;
+    bool destroy_deferred;      // mosdef_destroy called from a callback on the worker
+};
+
+#ifndef _WIN32
+static bool operation_open_poll_fd(MosDefOperation* operation) {
+    return pipe2(operation->poll_fds, O_CLOEXEC | O_NONBLOCK) == 0;
+}
+
+static void operation_close_poll_fd(MosDefOperation* operation) {
+    close(operation->poll_fds[0]);
+    close(operation->poll_fds[1]);
+}
+#endif
+
+static void operation_release_ref(MosDefOperation* operation) {
+    if (InterlockedDecrement(&operation->refs) != 0) return;
+
+    MosDefContext* ctx = operation->ctx;
+    free_monitor_list_with(operation->monitors, &ctx->allocator);
+    mem_free(&ctx->allocator, operation->result.results);
+    CloseHandle(operation->done_event);
+#ifndef _WIN32
+    operation_close_poll_fd(operation);
+#endif
+    mem_free(&ctx->allocator, operation);
+    context_release(ctx);
+}
+
+static void operation_finish(MosDefOperation* operation, MosDefOperationState state, MosDefStatus status) {
+    operation->status = status;
+    InterlockedExchange(&operation->state, state);
+
+    if (operation->callback) {
+        operation->callback(operation, operation->user_data);
+    }
+    // The descriptor turns readable before the event is set, so a thread
+    // woken by either signal sees both
+#ifndef _WIN32
+    ssize_t written = write(operation->poll_fds[1], "", 1);
+    (void)written;  // Nonblocking and written once, so the pipe cannot be full
+#endif
+    SetEvent(operation->done_event);
+}
+
+static void operation_run(MosDefOperation* operation) {
+    MosDefContext* ctx = operation->ctx;
+    MosDefStatus status;
+
+    switch (operation->kind) {
+        case ASYNC_OP_ENUMERATE:
+            status = context_enumerate(ctx, &operation->monitors);
+            break;
+        case ASYNC_OP_APPLY:
+            status = context_apply(ctx, operation->plan, &operation->cancel_requested, &operation->result);
+            break;
+        case ASYNC_OP_ROLLBACK:
+            status = context_rollback(ctx, operation->plan, &operation->cancel_requested);
+            break;
+        default:
+            status = MOSDEF_ERR_INVALID_ARG;
+            break;
+    }
+
+    operation_finish(operation, MOSDEF_OP_COMPLETED, status);
+}
+
+// Stops accepting work and cancels everything still queued; the running
+// operation stops early. Returns the worker, NULL if there is none.
+static AsyncWorker* async_worker_stop(MosDefContext* ctx) {
+    EnterCriticalSection(&ctx->worker_lock);
+    AsyncWorker* worker = ctx->worker;
+    if (!worker) {
+        LeaveCriticalSection(&ctx->worker_lock);
+        return NULL;
+    }
+
+    MosDefOperation* pending = worker->head;
+    worker->head = NULL;
+    worker->tail = NULL;
+    worker->stopping = true;
+    WakeConditionVariable(&worker->wake);
+    LeaveCriticalSection(&ctx->worker_lock);
+
+    while (pending) {
+        MosDefOperation* next = pending->next;
+        pending->next = NULL;
+        operation_finish(pending, MOSDEF_OP_CANCELLED, MOSDEF_ERR_CANCELLED);
+        operation_release_ref(pending);
+        pending = next;
+    }
+    return worker;
+}
+
+static DWORD WINAPI async_worker_main(LPVOID param) {
+    MosDefContext* ctx = (MosDefContext*)param;
+    AsyncWorker* worker = ctx->worker;
+
+    for (;;) {
+        EnterCriticalSection(&ctx->worker_lock);
+        while (!worker->head && !worker->stopping) {
+            SleepConditionVariableCS(&worker->wake, &ctx->worker_lock, INFINITE);
+        }
+
+        MosDefOperation* operation = worker->head;
+        if (!operation) {
+            LeaveCriticalSection(&ctx->worker_lock);
+            break; // Stopping with an empty queue
+        }
+
+        worker->head = operation->next;
+        if (!worker->head) {
+            worker->tail = NULL;
+        }
+        operation->next = NULL;
+        InterlockedExchange(&operation->state, MOSDEF_OP_RUNNING);
+        LeaveCriticalSection(&ctx->worker_lock);
+
+        operation_run(operation);
+        operation_release_ref(operation);
+        if (worker->destroy_deferred) break;
+    }
+
+    if (worker->destroy_deferred) {
+        async_worker_stop(ctx);
+        CloseHandle(worker->thread);
+        ctx->worker = NULL;
+        mem_free(&ctx->allocator, worker);
+        context_release(ctx);
+    }
+    return 0;
+}
+
+static bool async_worker_ensure(MosDefContext* ctx) {
+    if (ctx->worker) return true;
+
+    AsyncWorker* worker = (AsyncWorker*)mem_alloc(&ctx->allocator, sizeof(AsyncWorker));
+    if (!worker) return false;
+
+    memset(worker, 0, sizeof(AsyncWorker));
+    InitializeConditionVariable(&worker->wake);
+    ctx->worker = worker;
+
+    worker->thread = CreateThread(NULL, 0, async_worker_main, ctx, 0, &worker->thread_id);
+    if (!worker->thread) {
+        log_error("Failed to start asynchronous worker thread: error %lu", GetLastError());
+        ctx->worker = NULL;
+        mem_free(&ctx->allocator, worker);
+        return false;
+    }
+
+    return true;
+}
+
+static MosDefOperation* async_submit(MosDefContext* ctx, AsyncOperationKind kind,
+                                     const RotationPlan* plan,
+                                     MosDefCompletionCallback callback, void* user_data) {
+    if (!ctx) return NULL;
+    if (kind != ASYNC_OP_ENUMERATE && !plan) return NULL;
+
+    MosDefOperation* operation = (MosDefOperation*)mem_alloc(&ctx->allocator, sizeof(MosDefOperation));
+    if (!operation) return NULL;
+
+    memset(operation, 0, sizeof(MosDefOperation));
+    operation->ctx = ctx;
+    operation->kind = kind;
+    operation->plan = plan;
+    operation->callback = callback;
+    operation->user_data = user_data;
+    operation->state = MOSDEF_OP_PENDING;
+    operation->refs = 2;
+    operation->status = MOSDEF_OK;
+
+    operation->done_event = CreateEventA(NULL, TRUE, FALSE, NULL);
+    if (!operation->done_event) {
+        mem_free(&ctx->allocator, operation);
+        return NULL;
+    }
+#ifndef _WIN32
+    if (!operation_open_poll_fd(operation)) {
+        CloseHandle(operation->done_event);
+        mem_free(&ctx->allocator, operation);
+        return NULL;
+    }
+#endif
+
+    EnterCriticalSection(&ctx->worker_lock);
+    if (!async_worker_ensure(ctx) || ctx->worker->stopping) {
+        LeaveCriticalSection(&ctx->worker_lock);
+        CloseHandle(operation->done_event);
+#ifndef _WIN32
+        operation_close_poll_fd(operation);
+#endif
+        mem_free(&ctx->allocator, operation);
+        return NULL;
+    }
+
+    InterlockedIncrement(&ctx->refs);
+    AsyncWorker* worker = ctx->worker;
+    if (worker->tail) {
+        worker->tail->next = operation;
+    } else {
+        worker->head = operation;
+    }
+    worker->tail = operation;
+    WakeConditionVariable(&worker->wake);
+    LeaveCriticalSection(&ctx->worker_lock);
+
+    return operation;
+}
+
+// Removes a still-pending operation from the queue. Caller holds worker_lock.
+static bool async_unlink_pending(AsyncWorker* worker, MosDefOperation* operation) {
+    MosDefOperation* previous = NULL;
+    for (MosDefOperation* it = worker->head; it; previous = it, it = it->next) {
+        if (it != operation) continue;
+
+        if (previous) {
+            previous->next = it->next;
+        } else {
+            worker->head = it->next;
+        }
+        if (worker->tail == it) {
+            worker->tail = previous;
+        }
+        it->next = NULL;
+        return true;
+    }
+    return false;
+}
+
+void async_worker_shutdown(MosDefContext* ctx) {
+    AsyncWorker* worker = async_worker_stop(ctx);
+    if (!worker) return;
+
+    WaitForSingleObject(worker->thread, INFINITE);
+    CloseHandle(worker->thread);
+
+    ctx->worker = NULL;
+    mem_free(&ctx->allocator, worker);
+}
+
+bool async_worker_defer_destroy(MosDefContext* ctx) {
+    EnterCriticalSection(&ctx->worker_lock);
+    AsyncWorker* worker = ctx->worker;
+    bool on_worker = worker && worker->thread_id == GetCurrentThreadId();
+    if (on_worker) {
+        worker->destroy_deferred = true;
+    }
+    LeaveCriticalSection(&ctx->worker_lock);
+    return on_worker;
+}
+
+// Public API
+MosDefOperation* mosdef_enumerate_async(MosDefContext* ctx,
+                                        MosDefCompletionCallback callback,
+                                        void* user_data) {
+    return async_submit(ctx, ASYNC_OP_ENUMERATE, NULL, callback, user_data);
+}
+
+MosDefOperation* mosdef_apply_async(MosDefContext* ctx, const RotationPlan* plan,
+                                    MosDefCompletionCallback callback,
+                                    void* user_data) {
+    return async_submit(ctx, ASYNC_OP_APPLY, plan, callback, user_data);
+}
+
+MosDefOperation* mosdef_rollback_async(MosDefContext* ctx, const RotationPlan* plan,
+                                       MosDefCompletionCallback callback,
+                                       void* user_data) {
+    return async_submit(ctx, ASYNC_OP_ROLLBACK, plan, callback, user_data);
+}
+
+MosDefOperationState mosdef_operation_state(const MosDefOperation* operation) {
+    if (!operation) return MOSDEF_OP_CANCELLED;
+    return (MosDefOperationState)ReadAcquire(&operation->state);
+}
+
+MosDefStatus mosdef_operation_status(const MosDefOperation* operation) {
+    if (!operation) return MOSDEF_ERR_INVALID_ARG;
+
+    LONG state = ReadAcquire(&operation->state);
+    if (state == MOSDEF_OP_PENDING || state == MOSDEF_OP_RUNNING) {
+        return MOSDEF_OK;
+    }
+    return operation->status;
+}
+
+HANDLE mosdef_operation_wait_handle(const MosDefOperation* operation) {
+    return operation ? operation->done_event : NULL;
+}
+
+#ifndef _WIN32
+int mosdef_operation_poll_fd(const MosDefOperation* operation) {
+    return operation ? operation->poll_fds[0] : -1;
+}
+#endif
+
+bool mosdef_operation_wait(MosDefOperation* operation, DWORD timeout_ms) {
+    if (!operation) return false;
+    return WaitForSingleObject(operation->done_event, timeout_ms) == WAIT_OBJECT_0;
+}
+
+bool mosdef_operation_cancel(MosDefOperation* operation) {
+    if (!operation) return false;
+
+    MosDefContext* ctx = operation->ctx;
+    bool unlinked = false;
+
+    EnterCriticalSection(&ctx->worker_lock);
+    LONG state = ReadAcquire(&operation->state);
+    if (state == MOSDEF_OP_PENDING && ctx->worker) {
+        unlinked = async_unlink_pending(ctx->worker, operation);
+    } else if (state == MOSDEF_OP_RUNNING) {
+        InterlockedExchange(&operation->cancel_requested, 1);
+        LeaveCriticalSection(&ctx->worker_lock);
+        return true;
+    }
+    LeaveCriticalSection(&ctx->worker_lock);
+
+    if (!unlinked) return false;
+
+    operation_finish(operation, MOSDEF_OP_CANCELLED, MOSDEF_ERR_CANCELLED);
+    operation_release_ref(operation); // Queue's reference
+    return true;
+}
+
+MonitorList* mosdef_operation_take_monitors(MosDefOperation* operation) {
+    if (!operation || ReadAcquire(&operation->state) != MOSDEF_OP_COMPLETED) return NULL;
+
+    MonitorList* monitors = operation->monitors;
+    operation->monitors = NULL;
+    return monitors;
+}
+
+BatchRotationResult mosdef_operation_take_result(MosDefOperation* operation) {
+    BatchRotationResult result = { 0, 0, NULL, 0 };
+    if (!operation || ReadAcquire(&operation->state) != MOSDEF_OP_COMPLETED) return result;
+
+    result = operation->result;
+    operation->result.results = NULL;
+    return result;
+}
+
+void mosdef_operation_release(MosDefOperation* operation) {
+    if (!operation) return;
+    operation_release_ref(operation);
+}
@@ -3,101 +3,32 @@
 #include "config.h"
 #include "enum.h"
 #include "rotate.h"
+#include "mosdef.h"
+#include "hotkeys.h"
+#include "watch.h"
+#include "dashboard.h"
+#include "fleet.h"
+#include "complete.h"
+#include "selexpr.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <errno.h>
 #include <conio.h>
 #include <time.h>
 
-// Global state
-static bool g_dry_run = false;
-static bool g_no_confirm = false;
-static bool g_force_rdp = false;
-static int g_revert_seconds = 0;
-
-CliArgs* parse_args(int argc, char* argv[]);
-void free_cli_args(CliArgs* args);
-void print_usage();
-void print_version();
-
-// Main command handlers
-int handle_list_command();
-int handle_rotation_command(RotationCommand command, const CliArgs* args);
-int handle_save_default(const char* selector);
-int handle_clear_default();
-
-// Confirmation and revert logic
-bool prompt_confirmation(const char* message);
-bool start_revert_timer(int seconds, const RollbackState* rollback_state);
-
-// Selector application logic
-SelectorList* get_applicable_selectors(const CliArgs* args, const MosDefConfig* config);
-
-int main(int argc, char* argv[]) {
-    // Parse command line arguments
-    CliArgs* args = parse_args(argc, argv);
-    if (!args) {
-        return EXIT_FAILURE;
-    }
-
-    // Set global flags
-    g_verbose = true; // Will be set by argument parsing
-    g_dry_run = false; // Will be set by argument parsing
-    g_no_confirm = false; // Will be set by argument parsing
-    g_force_rdp = false; // Will be set by argument parsing
-
-    // Check for RDP session
-    if (is_rdp_session() && !g_force_rdp) {
-        log_error("MOS-DEF cannot run under RDP session. Use --force-rdp to override.");
-        free_cli_args(args);
-        return 2;
-    }
-
-    // Handle version
-    if (args->version) {
-        print_version();
-        free_cli_args(args);
-        return 0;
-    }
-
-    // Handle help
-    if (args->help || argc == 1) {
-        print_usage();
-        free_cli_args(args);
-        return 0;
-    }
-
-    // Handle config commands
-    if (args->save_default) {
-        int result = handle_save_default(args->save_default);
-        free_cli_args(args);
-        return result;
+// A whole number in [min, max] for flag; logs and returns false otherwise
+static bool parse_int_option(const char* flag, const char* text, long min, long max, int* out_value) {
+    char* end = NULL;
+    errno = 0;
+    long value = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || errno == ERANGE || value < min || value > max) {
+        log_error("Invalid value for %s: %s (expected %ld to %ld)", flag, text, min, max);
+        return false;
     }
-
-    if (args->clear_default) {
-        int result = handle_clear_default();
-        free_cli_args(args);
-        return result;
-    }
-
-    // Handle main commands
-    int result = 0;
-    if (strcmp(args->command, "list") == 0) {
-        result = handle_list_command();
-    } else if (strcmp(args->command, "landscape") == 0) {
-        result = handle_rotation_command(ROTATION_LANDSCAPE, args);
-    } else if (strcmp(args->command, "portrait") == 0) {
-        result = handle_rotation_command(ROTATION_PORTRAIT, args);
-    } else if (strcmp(args->command, "toggle") == 0) {
-        result = handle_rotation_command(ROTATION_TOGGLE, args);
-    } else {
-        log_error("Unknown command: %s", args->command);
-        result = 2;
-    }
-
-    free_cli_args(args);
-    return result;
+    *out_value = (int)value;
+    return true;
 }
 
 CliArgs* parse_args(int argc, char* argv[]) {
@@ -106,6 +37,19 @@ CliArgs* parse_args(int argc, char* argv[]) {
 
     // Initialize defaults
     args->command = NULL;
+    args->operand = NULL;
+    args->target = NULL;
+    args->output_path = NULL;
+    args->export_path = NULL;
+    args->topology_path = NULL;
+    args->since = NULL;
+    args->device = NULL;
+    args->listen_address = NULL;
+    args->key_path = NULL;
+    args->stages = NULL;
+    args->parallel = 32;
+    args->deadline_ms = 10000;
+    args->max_failure_rate = 0.0;
     args->include_selectors = NULL;
     args->exclude_selectors = NULL;
     args->only_selector = NULL;
@@ -113,6 +57,14 @@ CliArgs* parse_args(int argc, char* argv[]) {
     args->clear_default = false;
     args->version = false;
     args->help = false;
+    args->dry_run = false;
+    args->verbose = false;
+    args->no_confirm = false;
+    args->force_rdp = false;
+    args->no_plan_cache = false;
+    args->apply_thread = false;
+    args->apply_affinity = 0;
+    args->revert_seconds = 0;
 
     // Skip program name
     int i = 1;
@@ -120,25 +72,48 @@ CliArgs* parse_args(int argc, char* argv[]) {
     // Parse global flags first
     while (i < argc) {
         if (strcmp(argv[i], "--dry-run") == 0) {
-            g_dry_run = true;
+            args->dry_run = true;
             i++;
         } else if (strcmp(argv[i], "--verbose") == 0) {
-            g_verbose = true;
+            args->verbose = true;
             i++;
         } else if (strcmp(argv[i], "--no-confirm") == 0) {
-            g_no_confirm = true;
+            args->no_confirm = true;
             i++;
         } else if (strcmp(argv[i], "--force-rdp") == 0) {
-            g_force_rdp = true;
+            args->force_rdp = true;
             i++;
+        } else if (strcmp(argv[i], "--no-plan-cache") == 0) {
+            args->no_plan_cache = true;
+            i++;
+        } else if (strcmp(argv[i], "--apply-thread") == 0) {
+            args->apply_thread = true;
+            i++;
+        } else if (strcmp(argv[i], "--apply-affinity") == 0 && i + 1 < argc) {
+            char* end = NULL;
+            unsigned long long mask = strtoull(argv[i + 1], &end, 0);
+            if (mask == 0 || end == argv[i + 1] || *end != '\0') {
+                log_error("Invalid CPU mask for --apply-affinity: %s", argv[i + 1]);
+                free_cli_args(args);
+                return NULL;
+            }
+            args->apply_thread = true;
+            args->apply_affinity = (DWORD_PTR)mask;
+            i += 2;
         } else if (strcmp(argv[i], "--version") == 0) {
             args->version = true;
             i++;
         } else if (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
             args->help = true;
             i++;
+        } else if (strcmp(argv[i], "--topology") == 0 && i + 1 < argc) {
+            args->topology_path = argv[i + 1];
+            i += 2;
         } else if (strcmp(argv[i], "--revert-seconds") == 0 && i + 1 < argc) {
-            g_revert_seconds = atoi(argv[i + 1]);
+            if (!parse_int_option("--revert-seconds", argv[i + 1], 1, MAX_REVERT_SECONDS, &args->revert_seconds)) {
+                free_cli_args(args);
+                return NULL;
+            }
             i += 2;
         } else {
             break; // Not a global flag, move to command parsing
@@ -157,12 +132,25 @@ CliArgs* parse_args(int argc, char* argv[]) {
     while (i < argc) {
         if (strcmp(argv[i], "--only") == 0 && i + 1 < argc) {
             args->only_selector = parse_selector(argv[i + 1]);
+            if (!args->only_selector) {
+                // A selector that fails to parse must not widen the selection
+                free_cli_args(args);
+                return NULL;
+            }
             i += 2;
         } else if (strcmp(argv[i], "--include") == 0 && i + 1 < argc) {
             args->include_selectors = parse_selector_list(argv[i + 1]);
+            if (!args->include_selectors) {
+                free_cli_args(args);
+                return NULL;
+            }
             i += 2;
         } else if (strcmp(argv[i], "--exclude") == 0 && i + 1 < argc) {
             args->exclude_selectors = parse_selector_list(argv[i + 1]);
+            if (!args->exclude_selectors) {
+                free_cli_args(args);
+                return NULL;
+            }
             i += 2;
         } else if (strcmp(argv[i], "--save-default") == 0 && i + 1 < argc) {
             args->save_default = _strdup(argv[i + 1]);
@@ -170,6 +158,55 @@ CliArgs* parse_args(int argc, char* argv[]) {
         } else if (strcmp(argv[i], "--clear-default") == 0) {
             args->clear_default = true;
             i++;
+        } else if (strcmp(argv[i], "--export") == 0 && i + 1 < argc) {
+            args->export_path = argv[i + 1];
+            i += 2;
+        } else if (strcmp(argv[i], "--since") == 0 && i + 1 < argc) {
+            args->since = argv[i + 1];
+            i += 2;
+        } else if (strcmp(argv[i], "--device") == 0 && i + 1 < argc) {
+            args->device = argv[i + 1];
+            i += 2;
+        } else if (strcmp(argv[i], "--listen") == 0 && i + 1 < argc) {
+            args->listen_address = argv[i + 1];
+            i += 2;
+        } else if (strcmp(argv[i], "--key") == 0 && i + 1 < argc) {
+            args->key_path = argv[i + 1];
+            i += 2;
+        } else if (strcmp(argv[i], "--parallel") == 0 && i + 1 < argc) {
+            if (!parse_int_option("--parallel", argv[i + 1], 1, MAX_FLEET_PARALLEL, &args->parallel)) {
+                free_cli_args(args);
+                return NULL;
+            }
+            i += 2;
+        } else if (strcmp(argv[i], "--deadline") == 0 && i + 1 < argc) {
+            if (!parse_int_option("--deadline", argv[i + 1], 1, MAX_FLEET_DEADLINE_MS, &args->deadline_ms)) {
+                free_cli_args(args);
+                return NULL;
+            }
+            i += 2;
+        } else if (strcmp(argv[i], "--stages") == 0 && i + 1 < argc) {
+            args->stages = argv[i + 1];
+            i += 2;
+        } else if (strcmp(argv[i], "--max-failure-rate") == 0 && i + 1 < argc) {
+            args->max_failure_rate = atof(argv[i + 1]);
+            i += 2;
+        } else if ((strcmp(argv[i], "-o") == 0 || strcmp(argv[i], "--output") == 0) && i + 1 < argc) {
+            args->output_path = argv[i + 1];
+            i += 2;
+        } else if (argv[i][0] != '-' && !args->operand &&
+                   (strcmp(args->command, "plan") == 0 || strcmp(args->command, "apply") == 0 ||
+                    strcmp(args->command, "diff") == 0)) {
+            args->operand = argv[i];
+            i++;
+        } else if (argv[i][0] != '-' && (strcmp(args->command, "snapshot") == 0 || strcmp(args->command, "fleet") == 0) &&
+                   (!args->operand || !args->target)) {
+            if (!args->operand) {
+                args->operand = argv[i];
+            } else {
+                args->target = argv[i];
+            }
+            i++;
         } else {
             log_error("Unknown argument: %s", argv[i]);
             free_cli_args(args);
@@ -195,10 +232,28 @@ void print_usage() {
     printf("USAGE:\n");
     printf("  mos-def [GLOBAL_FLAGS] <COMMAND> [ARGS]\n\n");
     printf("COMMANDS:\n");
-    printf("  list                         List all active monitors\n");
+    printf("  list [--export file]         List all active monitors, or save them as JSON\n");
     printf("  landscape [selectors]        Set monitors to landscape (0°)\n");
     printf("  portrait [selectors]         Set monitors to portrait (90°)\n");
-    printf("  toggle [selectors]           Toggle between landscape and portrait\n\n");
+    printf("  toggle [selectors]           Toggle between landscape and portrait\n");
+    printf("  plan <rotation> [selectors] [-o file]\n");
+    printf("                               Resolve a rotation and optionally save it\n");
+    printf("  apply <file>                 Execute a saved plan if the topology is unchanged\n");
+    printf("  snapshot save <name>         Save the whole display setup\n");
+    printf("  snapshot restore [name]      Restore a snapshot (default: the latest saved)\n");
+    printf("  snapshot undo [N]            Undo the last N display changes (default 1)\n");
+    printf("  snapshot list                List snapshots and undo depth\n");
+    printf("  diff <expected.json>         Compare monitors with an exported topology\n");
+    printf("  history [--since T] [--device D]\n");
+    printf("                               Show recorded display changes\n");
+    printf("  agent [--listen host:port] [--key file]\n");
+    printf("                               Serve fleet requests (default 127.0.0.1:%d)\n", FLEET_DEFAULT_PORT);
+    printf("  fleet <hosts> \"<action>\" [--parallel N] [--deadline ms] [--stages 1,10%%,100%%]\n");
+    printf("        [--max-failure-rate R] [--key file]\n");
+    printf("                               Roll a rotation, apply <plan> or layout <file> out to agents\n");
+    printf("  hotkeys                      Stay resident and apply configured hotkeys\n");
+    printf("  watch                        Stream display changes as NDJSON\n");
+    printf("  top                          Live full-screen monitor dashboard\n\n");
     printf("SELECTORS:\n");
     printf("  --only <selector>            Apply to single monitor\n");
     printf("  --include <sel1,sel2,...>    Apply to specific monitors\n");
@@ -206,7 +261,13 @@ void print_usage() {
     printf("SELECTOR FORMATS:\n");
     printf("  M#                           Monitor ID (M1, M2, etc.)\n");
     printf("  device:\"\\\\.\\DISPLAYn\"      Device path\n");
-    printf("  name:\"substring\"            Device name substring (case-insensitive)\n\n");
+    printf("  name:\"substring\"            Device name substring (case-insensitive)\n");
+    printf("  edid:DEL4085-1A2B3C4D        Stable panel identity from EDID (see 'list')\n");
+    printf("  model:\"substring\"           EDID model name substring (case-insensitive)\n");
+    printf("  native:3840x2160             EDID native resolution\n");
+    printf("  expr:<expression>            Attribute expression, e.g.\n");
+    printf("                               expr:name~\"^DELL\" && width>=2560 && orientation==0\n");
+    printf("  group:left-wall              Named group from the config file\n\n");
     printf("CONFIG COMMANDS:\n");
     printf("  --save-default <selector>    Save default monitor selector\n");
     printf("  --clear-default              Clear saved default\n\n");
@@ -215,7 +276,11 @@ void print_usage() {
     printf("  --verbose                    Show detailed API calls and results\n");
     printf("  --no-confirm                 Skip confirmation prompts\n");
     printf("  --force-rdp                  Allow execution under RDP\n");
-    printf("  --revert-seconds N           Auto-revert after N seconds if not confirmed\n");
+    printf("  --no-plan-cache              Always re-resolve selectors\n");
+    printf("  --apply-thread               Apply changes on a dedicated time-critical thread\n");
+    printf("  --apply-affinity <mask>      Pin that thread to a CPU mask, e.g. 0x1 (implies --apply-thread)\n");
+    printf("  --revert-seconds N           Auto-revert after N seconds (1-3600) if not confirmed\n");
+    printf("  --topology <file>            Select and plan against a saved topology (implies --dry-run)\n");
     printf("  --version                    Show version information\n");
     printf("  --help, -h                   Show this help message\n\n");
     printf("EXAMPLES:\n");
@@ -224,6 +289,18 @@ void print_usage() {
     printf("  mos-def toggle --include M1,M3\n");
     printf("  mos-def landscape --exclude name:\"TV\"\n");
     printf("  mos-def toggle --save-default M2\n");
+    printf("  mos-def plan portrait --only M2 -o portrait.plan\n");
+    printf("  mos-def apply portrait.plan\n");
+    printf("  mos-def snapshot save desk\n");
+    printf("  mos-def snapshot undo 2\n");
+    printf("  mos-def diff kiosk.json\n");
+    printf("  mos-def history --since 7d --device M3\n");
+    printf("  mos-def list --export kiosk.json\n");
+    printf("  mos-def --topology kiosk.json plan portrait --only M2 -o kiosk.plan\n");
+    printf("  mos-def agent --listen 10.0.0.5:%d\n", FLEET_DEFAULT_PORT);
+    printf("  mos-def fleet signs.txt \"portrait --only M2\" --stages 1,10%%,100%%\n");
+    printf("  mos-def hotkeys\n");
+    printf("  mos-def watch > changes.ndjson\n");
 }
 
 void print_version() {
@@ -233,111 +310,605 @@ void print_version() {
 }
 
 // Command handlers
-int handle_list_command() {
-    MonitorList* monitors = enumerate_monitors();
-    if (!monitors) {
+int handle_list_command(MosDefContext* ctx, const CliArgs* args) {
+    MonitorList* monitors = NULL;
+    if (mosdef_enumerate(ctx, &monitors) != MOSDEF_OK) {
         log_error("Failed to enumerate monitors");
         return 3;
     }
 
-    print_monitor_table(monitors);
-    free_monitor_list(monitors);
-    return 0;
+    int result = 0;
+    if (args->export_path) {
+        if (mosdef_export_topology(ctx, monitors, args->export_path) == MOSDEF_OK) {
+            log_info("Exported %d monitor(s) to %s", monitors->count, args->export_path);
+        } else {
+            result = 3;
+        }
+    } else {
+        print_monitor_table(monitors);
+    }
+
+    mosdef_free_monitor_list(ctx, monitors);
+    return result;
 }
 
-int handle_rotation_command(RotationCommand command, const CliArgs* args) {
-    // Load configuration
-    MosDefConfig* config = load_config();
+// Normalized command line for the plan cache: the rotation plus every input
+// that can change which monitors are selected. Parsed selectors are written
+// back out canonically, so quoting and spacing differences share an entry.
+static bool append_key_text(char* key, size_t size, const char* text) {
+    return strcat_s(key, size, text) == 0;
+}
 
-    // Get monitor list
-    MonitorList* monitors = enumerate_monitors();
-    if (!monitors || monitors->count == 0) {
-        log_error("No monitors found");
-        free_config(config);
-        free_monitor_list(monitors);
-        return 3;
+static bool append_key_selectors(char* key, size_t size, const char* label, const SelectorList* selectors) {
+    bool ok = append_key_text(key, size, label);
+    for (int i = 0; selectors && i < selectors->count && ok; i++) {
+        char type[8];
+        sprintf_s(type, sizeof(type), "%d:", (int)selectors->selectors[i].type);
+        ok = append_key_text(key, size, type) &&
+             append_key_text(key, size, selectors->selectors[i].value) &&
+             append_key_text(key, size, "\x1f");
     }
+    return ok;
+}
 
-    // Determine which monitors to apply to
-    SelectorList* applicable_selectors = get_applicable_selectors(args, config);
-    if (!applicable_selectors) {
-        log_error("No monitors match the specified selectors");
-        free_config(config);
-        free_monitor_list(monitors);
-        return 2;
+static char* build_plan_cache_key(RotationCommand command, const CliArgs* args, const MosDefConfig* config) {
+    size_t size = 1024;
+    char* key = (char*)malloc(size);
+    if (!key) return NULL;
+
+    key[0] = '\0';
+    SelectorList only = { args->only_selector, args->only_selector ? 1 : 0 };
+    bool ok = append_key_text(key, size, get_rotation_command_name(command)) &&
+              append_key_selectors(key, size, "\x1e" "only=", &only) &&
+              append_key_selectors(key, size, "\x1e" "include=", args->include_selectors) &&
+              append_key_selectors(key, size, "\x1e" "exclude=", args->exclude_selectors) &&
+              append_key_text(key, size, "\x1e" "default=") &&
+              append_key_text(key, size, (config && config->default_selector) ? config->default_selector : "");
+
+    // Group definitions feed group: selectors, including ones in the default
+    ok = ok && append_key_text(key, size, "\x1e" "groups=");
+    for (int i = 0; ok && config && i < config->groups.count; i++) {
+        ok = append_key_text(key, size, config->groups.entries[i].key) &&
+             append_key_text(key, size, "=") &&
+             append_key_text(key, size, config->groups.entries[i].value) &&
+             append_key_text(key, size, "\x1f");
     }
 
-    // Create rollback state if revert is enabled
-    RollbackState* rollback_state = NULL;
-    if (g_revert_seconds > 0) {
-        rollback_state = create_rollback_state(monitors);
+    if (!ok) {
+        free(key); // Too long to be worth caching
+        return NULL;
     }
+    return key;
+}
 
-    // Perform rotation
-    BatchRotationResult result = rotate_monitors_filtered(
-        monitors, command, applicable_selectors->count > 0 ? applicable_selectors : NULL,
-        args->exclude_selectors, g_dry_run
-    );
-
-    // Handle confirmation and revert logic
-    if (!g_dry_run && !g_no_confirm && result.success_count > 0) {
-        const char* command_name = (command == ROTATION_LANDSCAPE) ? "landscape" :
-                                 (command == ROTATION_PORTRAIT) ? "portrait" : "toggle";
-
-        if (g_revert_seconds > 0) {
-            if (!start_revert_timer(g_revert_seconds, rollback_state)) {
-                log_error("Failed to start revert timer");
-            }
-        } else {
-            char message[256];
-            sprintf_s(message, sizeof(message),
-                     "Applied %s rotation to %d monitor(s). Keep changes? (y/N): ",
-                     command_name, result.success_count);
-
-            if (!prompt_confirmation(message)) {
-                if (rollback_state) {
-                    log_info("Reverting changes...");
-                    rollback_monitors(rollback_state, false);
-                }
+// State to journal for 'snapshot undo' if the change is kept; NULL for dry runs
+static DisplaySetup* capture_setup_for_undo(MosDefContext* ctx, const CliArgs* args) {
+    DisplaySetup* setup = NULL;
+    if (!args->dry_run && mosdef_capture_setup(ctx, &setup) != MOSDEF_OK) {
+        log_verbose("Could not capture the display setup; this change will not be undoable");
+    }
+    return setup;
+}
+
+static double elapsed_ms(const LARGE_INTEGER* start) {
+    LARGE_INTEGER now, frequency;
+    QueryPerformanceCounter(&now);
+    QueryPerformanceFrequency(&frequency);
+    return (double)(now.QuadPart - start->QuadPart) * 1000.0 / (double)frequency.QuadPart;
+}
+
+int handle_rotation_command(MosDefContext* ctx, RotationCommand command, const CliArgs* args,
+                            MosDefConfig* config) {
+    LARGE_INTEGER resolve_start;
+    QueryPerformanceCounter(&resolve_start);
+
+    // A cached plan for this command line and topology skips straight to apply
+    RotationPlan* plan = NULL;
+    // Offline plans never touch the cache, so fleet planning cannot evict local entries
+    bool use_cache = !args->no_plan_cache && !args->topology_path;
+    char* cache_key = use_cache ? build_plan_cache_key(command, args, config) : NULL;
+    if (cache_key && mosdef_lookup_cached_plan(ctx, cache_key, &plan) == MOSDEF_OK) {
+        log_verbose("Plan cache hit, resolved in %.3f ms", elapsed_ms(&resolve_start));
+    } else {
+        // Determine which monitors to apply to
+        SelectorList* applicable_selectors = get_applicable_selectors(args, config);
+        if (!applicable_selectors) {
+            log_error("No monitors match the specified selectors");
+            free(cache_key);
+            return 2;
+        }
+
+        // Resolve selectors against the current topology
+        MosDefStatus status = mosdef_plan(ctx, command,
+                                          applicable_selectors->count > 0 ? applicable_selectors : NULL,
+                                          args->exclude_selectors, &plan);
+        free_selector_list(applicable_selectors);
+
+        if (status != MOSDEF_OK) {
+            if (status == MOSDEF_ERR_NO_MATCH) {
+                log_error("No monitors match the specified selectors");
             }
+            free(cache_key);
+            return (status == MOSDEF_ERR_NO_MATCH) ? 2 : 3;
         }
+
+        log_verbose("Plan cache miss, resolved in %.3f ms", elapsed_ms(&resolve_start));
+        if (cache_key) {
+            mosdef_store_cached_plan(ctx, cache_key, plan);
+        }
+    }
+    free(cache_key);
+
+    // Perform rotation
+    DisplaySetup* before = capture_setup_for_undo(ctx, args);
+    BatchRotationResult result = { 0, 0, NULL, 0 };
+    mosdef_apply(ctx, plan, &result);
+
+    // Handle confirmation and revert logic; kept changes become undoable
+    if (confirm_applied_plan(ctx, plan, &result, args) && before) {
+        mosdef_journal_setup(ctx, before);
     }
+    mosdef_free_setup(ctx, before);
 
     // Save last action to config
     if (config && result.success_count > 0) {
         free(config->last_action);
-        const char* action_name = (command == ROTATION_LANDSCAPE) ? "landscape" :
-                                (command == ROTATION_PORTRAIT) ? "portrait" : "toggle";
-        config->last_action = _strdup(action_name);
+        config->last_action = _strdup(get_rotation_command_name(command));
         save_config(config);
     }
 
-    // Cleanup
-    free_rollback_state(rollback_state);
-    free_selector_list(applicable_selectors);
-    free_config(config);
-    free_monitor_list(monitors);
+    int success_count = result.success_count;
+    int failure_count = result.failure_count;
 
-    // Free batch results
-    free(result.results);
+    // Cleanup
+    mosdef_free_result(ctx, &result);
+    mosdef_free_plan(ctx, plan);
 
     // Return appropriate exit code
-    if (result.failure_count > 0) {
+    if (failure_count > 0) {
         return 3; // API failure
-    } else if (result.success_count == 0) {
+    } else if (success_count == 0) {
         return 2; // No matching monitors
     } else {
         return 0; // Success
     }
 }
 
+static bool parse_rotation_command(const char* name, RotationCommand* out_command) {
+    if (!name) return false;
+
+    if (strcmp(name, "landscape") == 0) {
+        *out_command = ROTATION_LANDSCAPE;
+    } else if (strcmp(name, "portrait") == 0) {
+        *out_command = ROTATION_PORTRAIT;
+    } else if (strcmp(name, "toggle") == 0) {
+        *out_command = ROTATION_TOGGLE;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static void print_rotation_plan(const RotationPlan* plan) {
+    printf("Plan: %s on %d monitor(s), topology %016llx\n",
+           get_rotation_command_name(plan->command), plan->count,
+           (unsigned long long)plan->topology_fingerprint);
+
+    for (int i = 0; i < plan->count; i++) {
+        const RotationPlanEntry* entry = &plan->entries[i];
+
+        // The formatting helpers share one buffer per thread; print in pieces
+        printf("  %-4s %-14s %-22s %s ", entry->id, entry->device_path, entry->stable_id,
+               get_resolution_string(entry->current_width, entry->current_height));
+        printf("%s -> ", get_orientation_string(entry->current_orientation));
+        printf("%s ", get_resolution_string(entry->target_width, entry->target_height));
+        printf("%s\n", get_orientation_string(entry->target_orientation));
+    }
+}
+
+int handle_plan_command(MosDefContext* ctx, const CliArgs* args, const MosDefConfig* config) {
+    RotationCommand command;
+    if (!parse_rotation_command(args->operand, &command)) {
+        log_error("plan requires a rotation: landscape, portrait or toggle");
+        return 2;
+    }
+
+    SelectorList* applicable_selectors = get_applicable_selectors(args, config);
+    if (!applicable_selectors) {
+        log_error("No monitors match the specified selectors");
+        return 2;
+    }
+
+    RotationPlan* plan = NULL;
+    MosDefStatus status = mosdef_plan(ctx, command,
+                                      applicable_selectors->count > 0 ? applicable_selectors : NULL,
+                                      args->exclude_selectors, &plan);
+    free_selector_list(applicable_selectors);
+
+    if (status != MOSDEF_OK) {
+        if (status == MOSDEF_ERR_NO_MATCH) {
+            log_error("No monitors match the specified selectors");
+        }
+        return (status == MOSDEF_ERR_NO_MATCH) ? 2 : 3;
+    }
+
+    print_rotation_plan(plan);
+
+    int result = 0;
+    if (args->output_path) {
+        if (mosdef_save_plan(ctx, plan, args->output_path) == MOSDEF_OK) {
+            log_info("Saved plan to %s", args->output_path);
+        } else {
+            result = 3;
+        }
+    }
+
+    mosdef_free_plan(ctx, plan);
+    return result;
+}
+
+// Executes a saved plan as recorded: no config, no selectors, no re-planning
+int handle_apply_command(MosDefContext* ctx, const CliArgs* args) {
+    if (!args->operand) {
+        log_error("apply requires a plan file");
+        return 2;
+    }
+
+    RotationPlan* plan = NULL;
+    if (mosdef_load_plan(ctx, args->operand, &plan) != MOSDEF_OK) {
+        return 2;
+    }
+
+    MosDefStatus status = mosdef_verify_plan(ctx, plan);
+    if (status != MOSDEF_OK) {
+        if (status == MOSDEF_ERR_STALE_PLAN) {
+            log_error("Display topology changed since %s was created; re-run plan", args->operand);
+        } else {
+            log_error("Failed to verify plan: %s", mosdef_status_string(status));
+        }
+        mosdef_free_plan(ctx, plan);
+        return (status == MOSDEF_ERR_STALE_PLAN) ? 4 : 3;
+    }
+
+    DisplaySetup* before = capture_setup_for_undo(ctx, args);
+    BatchRotationResult result = { 0, 0, NULL, 0 };
+    mosdef_apply(ctx, plan, &result);
+    if (confirm_applied_plan(ctx, plan, &result, args) && before) {
+        mosdef_journal_setup(ctx, before);
+    }
+    mosdef_free_setup(ctx, before);
+
+    int failure_count = result.failure_count;
+    mosdef_free_result(ctx, &result);
+    mosdef_free_plan(ctx, plan);
+    return (failure_count > 0) ? 3 : 0;
+}
+
+static void print_snapshot_listing(const SnapshotListing* listing) {
+    if (listing->count == 0) {
+        printf("No snapshots saved.\n");
+    } else {
+        printf("Snapshots:\n");
+    }
+
+    for (int i = 0; i < listing->count; i++) {
+        const SnapshotSummary* snapshot = &listing->snapshots[i];
+        FILETIME local;
+        SYSTEMTIME time;
+        FileTimeToLocalFileTime(&snapshot->saved_at, &local);
+        FileTimeToSystemTime(&local, &time);
+        printf("  %-20s %04u-%02u-%02u %02u:%02u:%02u  %d monitor(s)\n", snapshot->name,
+               time.wYear, time.wMonth, time.wDay, time.wHour, time.wMinute, time.wSecond,
+               snapshot->display_count);
+    }
+
+    printf("Undo depth: %d\n", listing->undo_depth);
+    log_verbose("Snapshot store: %d records, %ld bytes", listing->record_count, listing->file_size);
+}
+
+int handle_snapshot_command(MosDefContext* ctx, const CliArgs* args) {
+    const char* action = args->operand;
+    if (!action) {
+        log_error("snapshot requires an action: save, restore, undo or list");
+        return 2;
+    }
+
+    if (strcmp(action, "list") == 0) {
+        SnapshotListing* listing = NULL;
+        if (mosdef_snapshot_list(ctx, &listing) != MOSDEF_OK) {
+            return 3;
+        }
+        print_snapshot_listing(listing);
+        mosdef_free_snapshot_listing(ctx, listing);
+        return 0;
+    }
+
+    if (strcmp(action, "save") == 0) {
+        if (!args->target) {
+            log_error("snapshot save requires a name");
+            return 2;
+        }
+        if (mosdef_snapshot_save(ctx, args->target) != MOSDEF_OK) {
+            return 3;
+        }
+        log_info("Saved snapshot '%s'", args->target);
+        return 0;
+    }
+
+    LARGE_INTEGER start;
+    QueryPerformanceCounter(&start);
+
+    int changed = 0;
+    MosDefStatus status;
+    if (strcmp(action, "restore") == 0) {
+        status = mosdef_snapshot_restore(ctx, args->target, &changed);
+        if (status == MOSDEF_ERR_NO_MATCH && args->target) {
+            log_error("No snapshot named '%s'", args->target);
+        } else if (status == MOSDEF_ERR_NO_MATCH) {
+            log_error("No snapshots saved");
+        }
+    } else if (strcmp(action, "undo") == 0) {
+        int depth = args->target ? atoi(args->target) : 1;
+        if (depth < 1) {
+            log_error("Invalid undo depth: %s", args->target);
+            return 2;
+        }
+        status = mosdef_snapshot_undo(ctx, depth, &changed);
+        if (status == MOSDEF_ERR_NO_MATCH) {
+            log_error("Nothing to undo %d change(s) back to", depth);
+        }
+    } else {
+        log_error("Unknown snapshot action: %s", action);
+        return 2;
+    }
+
+    if (status != MOSDEF_OK) {
+        return (status == MOSDEF_ERR_NO_MATCH) ? 2 : 3;
+    }
+
+    if (changed == 0) {
+        log_info("Display setup already matches");
+    } else {
+        log_verbose("Restored %d monitor(s) in %.1f ms", changed, elapsed_ms(&start));
+    }
+    return 0;
+}
+
+// --since: a relative age (30m, 12h, 7d, 2w) or a local date and time
+// (2026-10-01, 2026-10-01T08:30, 2026-10-01T08:30:15)
+static bool parse_since(const char* text, FILETIME* out_since) {
+    unsigned long amount = 0;
+    char unit = 0;
+    char extra = 0;
+    if (sscanf(text, "%lu%c%c", &amount, &unit, &extra) == 2) {
+        ULONG64 unit_seconds = (unit == 'm') ? 60 : (unit == 'h') ? 3600 :
+                               (unit == 'd') ? 86400 : (unit == 'w') ? 604800 : 0;
+        if (unit_seconds == 0) return false;
+
+        FILETIME now;
+        GetSystemTimeAsFileTime(&now);
+        ULONG64 value = ((ULONG64)now.dwHighDateTime << 32) | now.dwLowDateTime;
+        ULONG64 age = (ULONG64)amount * unit_seconds * 10000000ULL;
+        value = (age < value) ? value - age : 0;
+        out_since->dwLowDateTime = (DWORD)value;
+        out_since->dwHighDateTime = (DWORD)(value >> 32);
+        return true;
+    }
+
+    unsigned int year = 0, month = 0, day = 0, hour = 0, minute = 0, second = 0;
+    int fields = sscanf(text, "%4u-%2u-%2uT%2u:%2u:%2u%c", &year, &month, &day,
+                        &hour, &minute, &second, &extra);
+    if (fields != 3 && fields != 5 && fields != 6) return false;
+
+    SYSTEMTIME local = { (WORD)year, (WORD)month, 0, (WORD)day, (WORD)hour, (WORD)minute, (WORD)second, 0 };
+    SYSTEMTIME utc;
+    return TzSpecificLocalTimeToSystemTime(NULL, &local, &utc) && SystemTimeToFileTime(&utc, out_since);
+}
+
+// History records device paths and stable IDs; M# is resolved against the
+// current topology because numbering can change over the history's lifetime
+static char* resolve_history_device(MosDefContext* ctx, const char* text) {
+    Selector* selector = parse_selector(text);
+    if (!selector) return NULL;
+
+    char* device = NULL;
+    if (selector->type == SELECTOR_TYPE_MONITOR_ID) {
+        MonitorList* monitors = NULL;
+        const MonitorInfo* monitor = NULL;
+        if (mosdef_enumerate(ctx, &monitors) == MOSDEF_OK) {
+            monitor = find_monitor_by_id(monitors, selector->value);
+        }
+        if (monitor) {
+            device = _strdup(monitor->stable_id[0] ? monitor->stable_id : monitor->device_path);
+        } else {
+            device = _strdup(text);     // A raw device path or stable ID
+        }
+        mosdef_free_monitor_list(ctx, monitors);
+    } else if (selector->type == SELECTOR_TYPE_EDID || selector->type == SELECTOR_TYPE_DEVICE_PATH) {
+        device = _strdup(selector->value);
+    } else {
+        log_error("--device takes M#, device:\"...\" or edid:...");
+    }
+
+    free_selector(selector);
+    return device;
+}
+
+typedef struct {
+    int printed;
+} HistoryPrinter;
+
+static bool print_history_entry(const HistoryEntry* entry, void* user_data) {
+    HistoryPrinter* printer = (HistoryPrinter*)user_data;
+    if (printer->printed == 0) {
+        printf("%-23s %-8s %-14s %-22s %-22s %-8s %s\n",
+               "Time", "Action", "Device", "Stable ID", "Change", "Result", "Latency");
+    }
+    printer->printed++;
+
+    FILETIME local;
+    SYSTEMTIME time;
+    FileTimeToLocalFileTime(&entry->timestamp, &local);
+    FileTimeToSystemTime(&local, &time);
+
+    // The formatting helpers share one buffer per thread; build in pieces
+    char change[64];
+    char after[32];
+    sprintf_s(change, sizeof(change), "%s ", get_orientation_string(entry->old_orientation));
+    sprintf_s(after, sizeof(after), "-> %s", get_orientation_string(entry->new_orientation));
+    strcat_s(change, sizeof(change), after);
+    if (entry->old_width != entry->new_width || entry->old_height != entry->new_height) {
+        sprintf_s(after, sizeof(after), " %lux%lu", entry->new_width, entry->new_height);
+        strcat_s(change, sizeof(change), after);
+    }
+
+    char status[16];
+    if (entry->error_code == DISP_CHANGE_SUCCESSFUL) {
+        strcpy_s(status, sizeof(status), "ok");
+    } else {
+        sprintf_s(status, sizeof(status), "error %ld", entry->error_code);
+    }
+
+    printf("%04u-%02u-%02u %02u:%02u:%02u.%03u %-8s %-14s %-22s %-22s %-8s %.1f ms\n",
+           time.wYear, time.wMonth, time.wDay, time.wHour, time.wMinute, time.wSecond,
+           time.wMilliseconds, get_history_action_name(entry->action), entry->device_path,
+           entry->stable_id[0] ? entry->stable_id : "-", change, status, entry->latency_us / 1000.0);
+    return true;
+}
+
+int handle_history_command(MosDefContext* ctx, const CliArgs* args) {
+    HistoryQuery query;
+    memset(&query, 0, sizeof(query));
+
+    if (args->since && !parse_since(args->since, &query.since)) {
+        log_error("Invalid --since value: %s (use 30m, 12h, 7d, 2w or YYYY-MM-DD[THH:MM[:SS]])", args->since);
+        return 2;
+    }
+
+    char* device = NULL;
+    if (args->device) {
+        device = resolve_history_device(ctx, args->device);
+        if (!device) return 2;
+        query.device = device;
+        log_verbose("Matching history for %s", device);
+    }
+
+    LARGE_INTEGER start;
+    QueryPerformanceCounter(&start);
+
+    HistoryPrinter printer = { 0 };
+    int count = 0;
+    MosDefStatus status = mosdef_history_query(ctx, &query, print_history_entry, &printer, &count);
+    free(device);
+
+    if (status != MOSDEF_OK) {
+        log_error("Failed to read change history");
+        return 3;
+    }
+    if (count == 0) {
+        printf("No recorded changes match.\n");
+    }
+    log_verbose("%d change(s) in %.1f ms", count, elapsed_ms(&start));
+    return 0;
+}
+
+// One NDJSON record per change, then a summary; exit 0 in sync, 5 drifted
+int handle_diff_command(MosDefContext* ctx, const CliArgs* args) {
+    if (!args->operand) {
+        log_error("diff requires an expected topology file");
+        return 2;
+    }
+
+    MonitorList* expected = NULL;
+    if (mosdef_read_topology(ctx, args->operand, &expected) != MOSDEF_OK) {
+        return 2;
+    }
+
+    MonitorList* actual = NULL;
+    TopologyDiff* diff = NULL;
+    if (mosdef_diff_topology(ctx, expected, &actual, &diff) != MOSDEF_OK) {
+        log_error("Failed to compare with the current topology");
+        mosdef_free_monitor_list(ctx, expected);
+        return 3;
+    }
+
+    for (int i = 0; i < diff->count; i++) {
+        const TopologyChange* change = &diff->changes[i];
+        const MonitorInfo* monitor = change->after ? change->after : change->before;
+        // Expected IDs come from the topology file, so they are escaped too
+        char* id_json = json_escape_string(monitor->id);
+        char* stable_id_json = json_escape_string(monitor->stable_id);
+        char* device_json = json_escape_string(monitor->device_path);
+
+        printf("{\"event\":\"%s\",\"id\":%s,\"stable_id\":%s,\"device\":%s",
+               get_topology_change_name(change->type), id_json ? id_json : "null",
+               stable_id_json ? stable_id_json : "null", device_json ? device_json : "null");
+        if (change->before) {
+            printf(",\"expected\":");
+            write_topology_change_fields(stdout, change->type, change->before);
+        }
+        if (change->after) {
+            printf(",\"actual\":");
+            write_topology_change_fields(stdout, change->type, change->after);
+        }
+        printf("}\n");
+
+        free(id_json);
+        free(stable_id_json);
+        free(device_json);
+    }
+
+    bool in_sync = diff->count == 0;
+    printf("{\"event\":\"summary\",\"in_sync\":%s,\"expected\":%d,\"actual\":%d,"
+           "\"removed\":%d,\"added\":%d,\"changed\":%d}\n",
+           in_sync ? "true" : "false", expected->count, actual->count,
+           diff->removed_count, diff->added_count, diff->changed_count);
+
+    // The diff points into both lists; release it first
+    mosdef_free_diff(ctx, diff);
+    mosdef_free_monitor_list(ctx, actual);
+    mosdef_free_monitor_list(ctx, expected);
+    return in_sync ? 0 : 5;
+}
+
+int handle_agent_command(MosDefContext* ctx, const CliArgs* args, const MosDefConfig* config) {
+    return run_agent(mosdef_get_options(ctx), config, args->topology_path, args->listen_address, args->key_path);
+}
+
+int handle_fleet_command(MosDefContext* ctx, const CliArgs* args) {
+    FleetOptions options;
+    options.hosts_path = args->operand;
+    options.action = args->target;
+    options.dry_run = args->dry_run;
+    options.window = args->parallel;
+    options.deadline_ms = args->deadline_ms > 0 ? (DWORD)args->deadline_ms : 0;
+    options.stages = args->stages;
+    options.max_failure_rate = args->max_failure_rate;
+    options.key_path = args->key_path;
+    return run_fleet(ctx, &options);
+}
+
+int handle_hotkeys_command(MosDefContext* ctx, const MosDefConfig* config) {
+    if (!config) {
+        log_error("Failed to load configuration");
+        return 3;
+    }
+    return run_hotkeys(ctx, config);
+}
+
+int handle_watch_command(MosDefContext* ctx) {
+    return run_watch(ctx);
+}
+
+int handle_top_command(MosDefContext* ctx) {
+    return run_dashboard(mosdef_get_options(ctx));
+}
+
 int handle_save_default(const char* selector) {
     MosDefConfig* config = load_config();
     if (!config) {
-        config = (MosDefConfig*)malloc(sizeof(MosDefConfig));
+        config = create_config();
         if (!config) return 3;
-        config->default_selector = NULL;
-        config->last_action = NULL;
     }
 
     free(config->default_selector);
@@ -379,30 +950,117 @@ int handle_clear_default() {
 SelectorList* get_applicable_selectors(const CliArgs* args, const MosDefConfig* config) {
     // Priority: only > include > default > all
     if (args->only_selector) {
-        SelectorList* list = (SelectorList*)malloc(sizeof(SelectorList));
-        if (!list) return NULL;
-
-        list->selectors = (Selector*)malloc(sizeof(Selector));
-        if (!list->selectors) {
-            free(list);
-            return NULL;
-        }
-
-        list->selectors[0] = *args->only_selector;
-        list->count = 1;
-        return list;
+        SelectorList only = { args->only_selector, 1 };
+        return copy_selector_list(&only);
     }
 
     if (args->include_selectors) {
-        return parse_selector_list(args->include_selectors->selectors[0].value); // This is a bit hacky, but works
+        return copy_selector_list(args->include_selectors);
     }
 
     if (config && config->default_selector) {
         return parse_selector_list(config->default_selector);
     }
 
-    // No selectors specified - apply to all monitors
-    return parse_selector_list("*");
+    // No selectors specified - an empty list applies to all monitors
+    return (SelectorList*)calloc(1, sizeof(SelectorList));
+}
+
+// Rotation actions
+// Splits on whitespace outside double quotes; quotes are kept so selectors
+// such as name:"DELL U2720Q" reach parse_selector unchanged. The tokens are
+// terminated in place in one copy of the text, returned in out_buffer.
+static char** split_action(const char* action, int* out_count, char** out_buffer) {
+    static const char program[] = "mos-def";
+    size_t length = strlen(action);
+
+    // Tokens are separated by at least one character, so this bounds them
+    int capacity = 2 + (int)(length / 2);
+    char** argv = (char**)malloc(capacity * sizeof(char*));
+    char* buffer = (char*)malloc(sizeof(program) + length + 1);
+    if (!argv || !buffer) {
+        free(argv);
+        free(buffer);
+        return NULL;
+    }
+
+    memcpy(buffer, program, sizeof(program));
+    memcpy(buffer + sizeof(program), action, length + 1);
+
+    int count = 0;
+    argv[count++] = buffer;
+
+    char* p = buffer + sizeof(program);
+    while (*p) {
+        while (*p && isspace((unsigned char)*p)) p++;
+        if (!*p) break;
+
+        argv[count++] = p;
+        bool quoted = false;
+        while (*p && (quoted || !isspace((unsigned char)*p))) {
+            if (*p == '"') quoted = !quoted;
+            p++;
+        }
+        if (*p) *p++ = '\0';
+    }
+
+    *out_count = count;
+    *out_buffer = buffer;
+    return argv;
+}
+
+bool parse_rotation_action(const char* text, const MosDefConfig* config, RotationAction* out_action) {
+    memset(out_action, 0, sizeof(RotationAction));
+    if (!text) return false;
+
+    out_action->argv = split_action(text, &out_action->argc, &out_action->buffer);
+    out_action->args = out_action->argv ? parse_args(out_action->argc, out_action->argv) : NULL;
+    if (out_action->args && parse_rotation_command(out_action->args->command, &out_action->command)) {
+        out_action->include_selectors = get_applicable_selectors(out_action->args, config);
+    }
+
+    if (!out_action->include_selectors) {
+        free_rotation_action(out_action);
+        return false;
+    }
+    return true;
+}
+
+void free_rotation_action(RotationAction* action) {
+    if (!action) return;
+
+    free_selector_list(action->include_selectors);
+    free_cli_args(action->args);
+    free(action->argv);
+    free(action->buffer);
+    memset(action, 0, sizeof(RotationAction));
+}
+
+// Returns true if applied changes were kept
+bool confirm_applied_plan(MosDefContext* ctx, const RotationPlan* plan,
+                          const BatchRotationResult* result, const CliArgs* args) {
+    if (args->dry_run || result->success_count == 0) {
+        return false;
+    }
+    if (args->no_confirm) {
+        return true;
+    }
+
+    if (args->revert_seconds > 0) {
+        return start_revert_timer(args->revert_seconds, ctx, plan);
+    }
+
+    char message[256];
+    sprintf_s(message, sizeof(message),
+             "Applied %s rotation to %d monitor(s). Keep changes? (y/N): ",
+             get_rotation_command_name(plan->command), result->success_count);
+
+    if (!prompt_confirmation(message)) {
+        log_info("Reverting changes...");
+        mosdef_rollback(ctx, plan);
+        return false;
+    }
+    return true;
 }
 
 bool prompt_confirmation(const char* message) {
@@ -415,8 +1073,9 @@ bool prompt_confirmation(const char* message) {
     return (tolower(ch) == 'y');
 }
 
-bool start_revert_timer(int seconds, const RollbackState* rollback_state) {
-    if (!rollback_state) return false;
+// Returns true if the user kept the changes before the timer expired
+bool start_revert_timer(int seconds, MosDefContext* ctx, const RotationPlan* plan) {
+    if (!plan) return false;
 
     printf("Changes will revert in %d seconds unless confirmed. Press 'y' to keep: ", seconds);
     fflush(stdout);
@@ -441,5 +1100,8 @@ bool start_revert_timer(int seconds, const RollbackState* rollback_state) {
     }
 
     printf("\nTime expired, reverting changes...\n");
-    return rollback_monitors(rollback_state, false);
+    if (mosdef_rollback(ctx, plan) != MOSDEF_OK) {
+        log_error("Failed to revert changes");
+    }
+    return false;
 }
@@ -5,10 +5,29 @@
 #include "config.h"
 #include "enum.h"
 #include "rotate.h"
+#include "mosdef.h"
+
+// Upper bounds for numeric flags
+#define MAX_REVERT_SECONDS 3600
+#define MAX_FLEET_PARALLEL 4096
+#define MAX_FLEET_DEADLINE_MS 3600000
 
 // CLI argument structure
 typedef struct {
     const char* command;
+    const char* operand;        // Positional argument: plan action, plan file, snapshot action or hosts file
+    const char* target;         // Second positional: snapshot name, undo depth or fleet action
+    const char* output_path;    // -o/--output
+    const char* export_path;    // list --export
+    const char* topology_path;  // --topology: plan offline against a saved topology
+    const char* since;          // history --since
+    const char* device;         // history --device
+    const char* listen_address; // agent --listen
+    const char* key_path;       // agent and fleet --key
+    const char* stages;         // fleet --stages
+    int parallel;               // fleet --parallel
+    int deadline_ms;            // fleet --deadline
+    double max_failure_rate;    // fleet --max-failure-rate
     SelectorList* include_selectors;
     SelectorList* exclude_selectors;
     Selector* only_selector;
@@ -16,6 +35,16 @@ typedef struct {
     bool clear_default;
     bool version;
     bool help;
+
+    // Global flags
+    bool dry_run;
+    bool verbose;
+    bool no_confirm;
+    bool force_rdp;
+    bool no_plan_cache;
+    bool apply_thread;
+    DWORD_PTR apply_affinity;   // --apply-affinity CPU mask, implies apply_thread
+    int revert_seconds;
 } CliArgs;
 
 // CLI functions
@@ -24,4 +53,49 @@ void free_cli_args(CliArgs* args);
 void print_usage();
 void print_version();
 
+// Command handlers; each returns a process exit code
+int handle_list_command(MosDefContext* ctx, const CliArgs* args);
+// config is the one main loaded, NULL for none; rotations record last_action in it
+int handle_rotation_command(MosDefContext* ctx, RotationCommand command, const CliArgs* args,
+                            MosDefConfig* config);
+int handle_plan_command(MosDefContext* ctx, const CliArgs* args, const MosDefConfig* config);
+int handle_apply_command(MosDefContext* ctx, const CliArgs* args);
+int handle_snapshot_command(MosDefContext* ctx, const CliArgs* args);
+int handle_history_command(MosDefContext* ctx, const CliArgs* args);
+int handle_diff_command(MosDefContext* ctx, const CliArgs* args);
+int handle_agent_command(MosDefContext* ctx, const CliArgs* args, const MosDefConfig* config);
+int handle_fleet_command(MosDefContext* ctx, const CliArgs* args);
+int handle_hotkeys_command(MosDefContext* ctx, const MosDefConfig* config);
+int handle_watch_command(MosDefContext* ctx);
+int handle_top_command(MosDefContext* ctx);
+int handle_save_default(const char* selector);
+int handle_clear_default();
+
+// Confirmation and revert logic
+bool confirm_applied_plan(MosDefContext* ctx, const RotationPlan* plan,
+                          const BatchRotationResult* result, const CliArgs* args);
+bool prompt_confirmation(const char* message);
+bool start_revert_timer(int seconds, MosDefContext* ctx, const RotationPlan* plan);
+
+// Selector resolution shared with resident modes
+SelectorList* get_applicable_selectors(const CliArgs* args, const MosDefConfig* config);
+
+// A rotation written as a command line, e.g. "portrait --only M2", as in
+// hotkey bindings and fleet requests. argv points into buffer, which the
+// strings in args also point into; include_selectors has the saved default
+// applied.
+typedef struct {
+    char** argv;
+    int argc;
+    char* buffer;
+    CliArgs* args;
+    RotationCommand command;
+    SelectorList* include_selectors;
+} RotationAction;
+
+// Returns false (with out_action zeroed) unless text is landscape, portrait
+// or toggle with valid selectors
+bool parse_rotation_action(const char* text, const MosDefConfig* config, RotationAction* out_action);
+void free_rotation_action(RotationAction* action);
+
 #endif // CLI_H
@@ -0,0 +1,9 @@
+#ifndef MOSDEF_COMPAT_CONIO_H
+#define MOSDEF_COMPAT_CONIO_H
+
+// Unbuffered keyboard input. The terminal is switched to non-canonical,
+// no-echo mode on first use and restored at exit.
+int _kbhit(void);
+int _getch(void);
+
+#endif // MOSDEF_COMPAT_CONIO_H
@@ -0,0 +1,349 @@
+#include "win32_internal.h"
+#include "sim.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Simulated display backend: EnumDisplayDevicesA, EnumDisplaySettingsExA
+// and ChangeDisplaySettingsExA over an in-memory topology (see sim.h)
+
+#define MONITOR_INTERFACE_GUID "{e6f07b5f-ee97-4a90-b076-33f57bf4eaa7}"
+#define DBT_DEVNODES_CHANGED 0x0007
+
+typedef struct {
+    char model[16];
+    char connector[64];
+    bool has_monitor;
+    DWORD native_width;         // Landscape panel size, for mode validation
+    DWORD native_height;
+    DWORD width;
+    DWORD height;
+    DWORD orientation;
+    DWORD refresh_hz;
+    LONG x;
+    LONG y;
+    bool pending;               // CDS_NORESET change waiting for the commit
+    DEVMODEA pending_mode;
+} SimOutput;
+
+static pthread_mutex_t g_sim_lock = PTHREAD_MUTEX_INITIALIZER;
+static SimOutput g_outputs[SIM_MAX_MONITORS];
+static int g_output_count = 0;
+static bool g_initialized = false;
+static DWORD g_latency_ms = 0;
+static int g_fail_count = 0;
+static LONG g_fail_error = DISP_CHANGE_FAILED;
+static LONG g_change_count = 0;
+
+static void set_output(SimOutput* output, const SimMonitor* monitor) {
+    memset(output, 0, sizeof(*output));
+    output->has_monitor = monitor->model != NULL;
+    snprintf(output->model, sizeof(output->model), "%s", monitor->model ? monitor->model : "");
+    snprintf(output->connector, sizeof(output->connector), "%s",
+             monitor->connector ? monitor->connector : "");
+    output->width = monitor->width;
+    output->height = monitor->height;
+    output->orientation = monitor->orientation & 3;
+    output->refresh_hz = monitor->refresh_hz ? monitor->refresh_hz : 60;
+    output->x = monitor->x;
+    output->y = monitor->y;
+
+    bool portrait = output->orientation == DMDO_90 || output->orientation == DMDO_270;
+    output->native_width = portrait ? monitor->height : monitor->width;
+    output->native_height = portrait ? monitor->width : monitor->height;
+}
+
+// MODEL:CONNECTOR:WxH[@HZ][/ORIENTATION], comma-separated, laid out left to right
+static int parse_monitor_spec(const char* spec, SimMonitor* monitors, char names[][2][64]) {
+    int count = 0;
+    LONG x = 0;
+    const char* entry = spec;
+    while (entry && *entry && count < SIM_MAX_MONITORS) {
+        const char* end = strchr(entry, ',');
+        size_t length = end ? (size_t)(end - entry) : strlen(entry);
+        char text[160];
+        if (length < sizeof(text)) {
+            memcpy(text, entry, length);
+            text[length] = '\0';
+
+            unsigned width = 0, height = 0, refresh = 60, degrees = 0;
+            char* model = strtok(text, ":");
+            char* connector = model ? strtok(NULL, ":") : NULL;
+            char* mode = connector ? strtok(NULL, "") : NULL;
+            if (mode && sscanf(mode, "%ux%u", &width, &height) == 2 && width && height) {
+                const char* at = strchr(mode, '@');
+                const char* slash = strchr(mode, '/');
+                if (at) sscanf(at + 1, "%u", &refresh);
+                if (slash) sscanf(slash + 1, "%u", &degrees);
+
+                snprintf(names[count][0], 64, "%s", model);
+                snprintf(names[count][1], 64, "%s", connector);
+                SimMonitor* monitor = &monitors[count++];
+                memset(monitor, 0, sizeof(*monitor));
+                monitor->model = names[count - 1][0];
+                monitor->connector = names[count - 1][1];
+                monitor->width = width;
+                monitor->height = height;
+                monitor->orientation = (degrees / 90) & 3;
+                monitor->refresh_hz = refresh;
+                monitor->x = x;
+                x += (LONG)width;
+            }
+        }
+        entry = end ? end + 1 : NULL;
+    }
+    return count;
+}
+
+static void load_default_locked(void) {
+    static char names[SIM_MAX_MONITORS][2][64];
+    SimMonitor monitors[SIM_MAX_MONITORS];
+    const char* spec = getenv("MOSDEF_SIM_MONITORS");
+    int count = spec ? parse_monitor_spec(spec, monitors, names) : 0;
+    if (!spec) {
+        SimMonitor defaults[2] = {
+            { "DEL4085", "card0-DP-1", 2560, 1440, DMDO_DEFAULT, 60, 0, 0 },
+            { "GSM5B7F", "card0-HDMI-A-1", 1920, 1080, DMDO_DEFAULT, 60, 2560, 0 }
+        };
+        memcpy(monitors, defaults, sizeof(defaults));
+        count = 2;
+    }
+
+    for (int i = 0; i < count; i++) {
+        set_output(&g_outputs[i], &monitors[i]);
+    }
+    g_output_count = count;
+    g_initialized = true;
+}
+
+static void ensure_initialized_locked(void) {
+    if (!g_initialized) load_default_locked();
+}
+
+bool sim_set_monitors(const SimMonitor* monitors, int count) {
+    if (count < 0 || count > SIM_MAX_MONITORS || (count > 0 && !monitors)) return false;
+    pthread_mutex_lock(&g_sim_lock);
+    for (int i = 0; i < count; i++) {
+        set_output(&g_outputs[i], &monitors[i]);
+    }
+    g_output_count = count;
+    g_initialized = true;
+    pthread_mutex_unlock(&g_sim_lock);
+
+    compat_broadcast_message(WM_DEVICECHANGE, DBT_DEVNODES_CHANGED, 0);
+    compat_broadcast_message(WM_DISPLAYCHANGE, 32, 0);
+    return true;
+}
+
+void sim_reset(void) {
+    pthread_mutex_lock(&g_sim_lock);
+    load_default_locked();
+    g_latency_ms = 0;
+    g_fail_count = 0;
+    g_fail_error = DISP_CHANGE_FAILED;
+    g_change_count = 0;
+    pthread_mutex_unlock(&g_sim_lock);
+}
+
+bool sim_get_monitor(int index, SimMonitor* out_monitor) {
+    pthread_mutex_lock(&g_sim_lock);
+    ensure_initialized_locked();
+    bool found = index >= 0 && index < g_output_count && out_monitor;
+    if (found) {
+        const SimOutput* output = &g_outputs[index];
+        out_monitor->model = output->has_monitor ? output->model : NULL;
+        out_monitor->connector = output->connector;
+        out_monitor->width = output->width;
+        out_monitor->height = output->height;
+        out_monitor->orientation = output->orientation;
+        out_monitor->refresh_hz = output->refresh_hz;
+        out_monitor->x = output->x;
+        out_monitor->y = output->y;
+    }
+    pthread_mutex_unlock(&g_sim_lock);
+    return found;
+}
+
+void sim_set_change_latency(DWORD latency_ms) {
+    pthread_mutex_lock(&g_sim_lock);
+    g_latency_ms = latency_ms;
+    pthread_mutex_unlock(&g_sim_lock);
+}
+
+void sim_fail_changes(int count, LONG error) {
+    pthread_mutex_lock(&g_sim_lock);
+    g_fail_count = count;
+    g_fail_error = error;
+    pthread_mutex_unlock(&g_sim_lock);
+}
+
+LONG sim_change_count(void) {
+    pthread_mutex_lock(&g_sim_lock);
+    LONG count = g_change_count;
+    pthread_mutex_unlock(&g_sim_lock);
+    return count;
+}
+
+// "\\.\DISPLAYn" to an output index, -1 if none
+static int find_output_locked(LPCSTR device) {
+    int number = 0;
+    if (!device || sscanf(device, "\\\\.\\DISPLAY%d", &number) != 1) return -1;
+    return number >= 1 && number <= g_output_count ? number - 1 : -1;
+}
+
+BOOL EnumDisplayDevicesA(LPCSTR device, DWORD index, DISPLAY_DEVICEA* display_device, DWORD flags) {
+    if (!display_device) return FALSE;
+
+    pthread_mutex_lock(&g_sim_lock);
+    ensure_initialized_locked();
+    BOOL found = FALSE;
+    DWORD cb = display_device->cb;
+    if (!device) {
+        if (index < (DWORD)g_output_count) {
+            memset(display_device, 0, sizeof(*display_device));
+            snprintf(display_device->DeviceName, sizeof(display_device->DeviceName), "\\\\.\\DISPLAY%u",
+                     (unsigned)index + 1);
+            snprintf(display_device->DeviceString, sizeof(display_device->DeviceString),
+                     "Simulated Display");
+            snprintf(display_device->DeviceID, sizeof(display_device->DeviceID), "SIM\\VEN_1D0F&DEV_%04X",
+                     (unsigned)index + 1);
+            display_device->StateFlags = DISPLAY_DEVICE_ACTIVE | (index == 0 ? DISPLAY_DEVICE_PRIMARY_DEVICE : 0);
+            found = TRUE;
+        }
+    } else {
+        int output = find_output_locked(device);
+        if (output >= 0 && index == 0 && g_outputs[output].has_monitor) {
+            const SimOutput* sim = &g_outputs[output];
+            memset(display_device, 0, sizeof(*display_device));
+            snprintf(display_device->DeviceName, sizeof(display_device->DeviceName), "%s\\Monitor0", device);
+            snprintf(display_device->DeviceString, sizeof(display_device->DeviceString), "Generic PnP Monitor");
+            if (flags & EDD_GET_DEVICE_INTERFACE_NAME) {
+                snprintf(display_device->DeviceID, sizeof(display_device->DeviceID), "\\\\?\\DISPLAY#%s#%s#%s",
+                         sim->model, sim->connector, MONITOR_INTERFACE_GUID);
+            } else {
+                snprintf(display_device->DeviceID, sizeof(display_device->DeviceID), "MONITOR\\%s\\%s",
+                         sim->model, MONITOR_INTERFACE_GUID);
+            }
+            display_device->StateFlags = DISPLAY_DEVICE_ACTIVE | DISPLAY_DEVICE_ATTACHED_TO_DESKTOP;
+            found = TRUE;
+        }
+    }
+    display_device->cb = cb;
+    pthread_mutex_unlock(&g_sim_lock);
+    return found;
+}
+
+static void fill_devmode(const SimOutput* output, DEVMODEA* devmode) {
+    WORD size = devmode->dmSize;
+    memset(devmode, 0, sizeof(*devmode));
+    devmode->dmSize = size ? size : (WORD)sizeof(DEVMODEA);
+    devmode->dmFields = DM_POSITION | DM_DISPLAYORIENTATION | DM_BITSPERPEL | DM_PELSWIDTH |
+                        DM_PELSHEIGHT | DM_DISPLAYFREQUENCY;
+    devmode->dmPosition.x = output->x;
+    devmode->dmPosition.y = output->y;
+    devmode->dmDisplayOrientation = output->orientation;
+    devmode->dmBitsPerPel = 32;
+    devmode->dmPelsWidth = output->width;
+    devmode->dmPelsHeight = output->height;
+    devmode->dmDisplayFrequency = output->refresh_hz;
+}
+
+BOOL EnumDisplaySettingsExA(LPCSTR device, DWORD mode, DEVMODEA* devmode, DWORD flags) {
+    (void)flags;
+    if (!devmode || (mode != ENUM_CURRENT_SETTINGS && mode != ENUM_REGISTRY_SETTINGS)) return FALSE;
+
+    pthread_mutex_lock(&g_sim_lock);
+    ensure_initialized_locked();
+    int output = find_output_locked(device);
+    if (output >= 0) {
+        fill_devmode(&g_outputs[output], devmode);
+    }
+    pthread_mutex_unlock(&g_sim_lock);
+    return output >= 0;
+}
+
+// The new mode with devmode's fields applied; BADMODE when the size does not
+// fit the orientation, as a driver rejects a rotation without the swap
+static LONG resolve_mode(const SimOutput* output, const DEVMODEA* devmode, SimOutput* out_mode) {
+    *out_mode = *output;
+    if (devmode->dmFields & DM_PELSWIDTH) out_mode->width = devmode->dmPelsWidth;
+    if (devmode->dmFields & DM_PELSHEIGHT) out_mode->height = devmode->dmPelsHeight;
+    if (devmode->dmFields & DM_DISPLAYORIENTATION) out_mode->orientation = devmode->dmDisplayOrientation;
+    if (devmode->dmFields & DM_DISPLAYFREQUENCY) out_mode->refresh_hz = devmode->dmDisplayFrequency;
+    if (devmode->dmFields & DM_POSITION) {
+        out_mode->x = devmode->dmPosition.x;
+        out_mode->y = devmode->dmPosition.y;
+    }
+
+    if (out_mode->orientation > DMDO_270) return DISP_CHANGE_BADPARAM;
+    if (out_mode->width == 0 || out_mode->height == 0) return DISP_CHANGE_BADMODE;
+
+    bool native_landscape = output->native_width >= output->native_height;
+    bool portrait = out_mode->orientation == DMDO_90 || out_mode->orientation == DMDO_270;
+    bool landscape_size = out_mode->width >= out_mode->height;
+    if (output->native_width != output->native_height && landscape_size != (native_landscape != portrait)) {
+        return DISP_CHANGE_BADMODE;
+    }
+    return DISP_CHANGE_SUCCESSFUL;
+}
+
+static bool commit_pending_locked(void) {
+    bool changed = false;
+    for (int i = 0; i < g_output_count; i++) {
+        SimOutput* output = &g_outputs[i];
+        if (!output->pending) continue;
+        SimOutput mode;
+        if (resolve_mode(output, &output->pending_mode, &mode) == DISP_CHANGE_SUCCESSFUL) {
+            *output = mode;
+            g_change_count++;
+            changed = true;
+        }
+        output->pending = false;
+    }
+    return changed;
+}
+
+LONG ChangeDisplaySettingsExA(LPCSTR device, DEVMODEA* devmode, HWND hwnd, DWORD flags, LPVOID param) {
+    (void)hwnd;
+    (void)param;
+
+    pthread_mutex_lock(&g_sim_lock);
+    ensure_initialized_locked();
+    DWORD latency = g_latency_ms;
+    pthread_mutex_unlock(&g_sim_lock);
+    if (latency) Sleep(latency);
+
+    pthread_mutex_lock(&g_sim_lock);
+    LONG result = DISP_CHANGE_SUCCESSFUL;
+    bool changed = false;
+    if (g_fail_count > 0 && !(flags & CDS_TEST)) {
+        g_fail_count--;
+        result = g_fail_error;
+    } else if (!device && !devmode) {
+        changed = commit_pending_locked();
+    } else {
+        int index = find_output_locked(device);
+        SimOutput mode;
+        if (index < 0 || !devmode) {
+            result = DISP_CHANGE_BADPARAM;
+        } else if ((result = resolve_mode(&g_outputs[index], devmode, &mode)) == DISP_CHANGE_SUCCESSFUL &&
+                   !(flags & CDS_TEST)) {
+            if (flags & CDS_NORESET) {
+                g_outputs[index].pending = true;
+                g_outputs[index].pending_mode = *devmode;
+            } else {
+                mode.pending = false;
+                g_outputs[index] = mode;
+                g_change_count++;
+                changed = true;
+            }
+        }
+    }
+    DWORD width = g_output_count > 0 ? g_outputs[0].width : 0;
+    DWORD height = g_output_count > 0 ? g_outputs[0].height : 0;
+    pthread_mutex_unlock(&g_sim_lock);
+
+    if (changed) {
+        compat_broadcast_message(WM_DISPLAYCHANGE, 32, MAKELPARAM(width, height));
+    }
+    return result;
+}
@@ -0,0 +1,203 @@
+#include <X11/Xlib.h>
+#include <X11/XKBlib.h>
+#include <X11/keysym.h>
+#include "win32_internal.h"
+#include <poll.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// RegisterHotKey on an X server: each chord is an XGrabKey on the root
+// window, repeated for every Caps Lock / Num Lock combination so the locks
+// do not swallow it. A thread watches the connection and turns grabbed
+// KeyPress events into WM_HOTKEY through compat_post_hotkey. Every Xlib call
+// happens under g_x11_lock; the event thread releases it before posting so
+// the lock order is always g_compat_lock, then g_x11_lock.
+
+typedef struct {
+    UINT chord;
+    UINT vk;
+    KeyCode keycode;
+    unsigned int modifiers;
+} X11Grab;
+
+#define MAX_X11_GRABS 256
+
+static pthread_mutex_t g_x11_lock = PTHREAD_MUTEX_INITIALIZER;
+static Display* g_display = NULL;
+static bool g_display_tried = false;
+static pthread_t g_event_thread;
+static X11Grab g_grabs[MAX_X11_GRABS];
+static int g_grab_count = 0;
+static KeyCode g_held = 0;              // Grabbed key currently down, for MOD_NOREPEAT
+static int g_grab_error = Success;
+
+static const unsigned int g_lock_masks[] = { 0, LockMask, Mod2Mask, LockMask | Mod2Mask };
+
+static KeySym vk_to_keysym(UINT vk) {
+    if (vk >= 'A' && vk <= 'Z') return XK_a + (vk - 'A');
+    if (vk >= '0' && vk <= '9') return XK_0 + (vk - '0');
+    if (vk >= VK_F1 && vk <= VK_F24) return XK_F1 + (vk - VK_F1);
+
+    switch (vk) {
+        case VK_SPACE: return XK_space;
+        case VK_TAB: return XK_Tab;
+        case VK_RETURN: return XK_Return;
+        case VK_ESCAPE: return XK_Escape;
+        case VK_BACK: return XK_BackSpace;
+        case VK_INSERT: return XK_Insert;
+        case VK_DELETE: return XK_Delete;
+        case VK_HOME: return XK_Home;
+        case VK_END: return XK_End;
+        case VK_PRIOR: return XK_Prior;
+        case VK_NEXT: return XK_Next;
+        case VK_UP: return XK_Up;
+        case VK_DOWN: return XK_Down;
+        case VK_LEFT: return XK_Left;
+        case VK_RIGHT: return XK_Right;
+        case VK_PAUSE: return XK_Pause;
+        case VK_SNAPSHOT: return XK_Print;
+        default: return NoSymbol;
+    }
+}
+
+static unsigned int chord_to_x11(UINT chord) {
+    unsigned int modifiers = 0;
+    if (chord & MOD_ALT) modifiers |= Mod1Mask;
+    if (chord & MOD_CONTROL) modifiers |= ControlMask;
+    if (chord & MOD_SHIFT) modifiers |= ShiftMask;
+    if (chord & MOD_WIN) modifiers |= Mod4Mask;
+    return modifiers;
+}
+
+// XGrabKey reports BadAccess asynchronously; the handler records it for the
+// XSync that follows
+static int record_grab_error(Display* display, XErrorEvent* error) {
+    (void)display;
+    g_grab_error = error->error_code;
+    return 0;
+}
+
+static void* x11_event_thread(void* parameter) {
+    (void)parameter;
+    int fd = ConnectionNumber(g_display);
+    for (;;) {
+        struct pollfd poll_fd = { fd, POLLIN, 0 };
+        poll(&poll_fd, 1, 100);
+
+        UINT chords[16];
+        UINT vks[16];
+        int pressed = 0;
+
+        pthread_mutex_lock(&g_x11_lock);
+        while (XPending(g_display) > 0) {
+            XEvent event;
+            XNextEvent(g_display, &event);
+            if (event.type == KeyRelease && event.xkey.keycode == g_held) {
+                g_held = 0;
+                continue;
+            }
+            if (event.type != KeyPress || event.xkey.keycode == g_held) continue;
+
+            unsigned int modifiers = event.xkey.state & ~(unsigned int)(LockMask | Mod2Mask);
+            for (int i = 0; i < g_grab_count; i++) {
+                if (g_grabs[i].keycode == event.xkey.keycode && g_grabs[i].modifiers == modifiers) {
+                    g_held = (KeyCode)event.xkey.keycode;
+                    if (pressed < 16) {
+                        chords[pressed] = g_grabs[i].chord;
+                        vks[pressed] = g_grabs[i].vk;
+                        pressed++;
+                    }
+                    break;
+                }
+            }
+        }
+        pthread_mutex_unlock(&g_x11_lock);
+
+        for (int i = 0; i < pressed; i++) {
+            compat_post_hotkey(chords[i], vks[i]);
+        }
+    }
+    return NULL;
+}
+
+// Opens the display on first use. Callers hold g_x11_lock.
+static bool open_display_locked(void) {
+    if (g_display_tried) return g_display != NULL;
+    g_display_tried = true;
+
+    const char* name = getenv("DISPLAY");
+    if (!name || !*name) return false;
+
+    g_display = XOpenDisplay(name);
+    if (!g_display) return false;
+
+    // Held keys then repeat as presses without releases in between, which
+    // is what MOD_NOREPEAT filtering relies on
+    XkbSetDetectableAutoRepeat(g_display, True, NULL);
+    if (pthread_create(&g_event_thread, NULL, x11_event_thread, NULL) != 0) {
+        XCloseDisplay(g_display);
+        g_display = NULL;
+        return false;
+    }
+    pthread_detach(g_event_thread);
+    return true;
+}
+
+bool compat_hotkey_grab(UINT chord, UINT vk) {
+    pthread_mutex_lock(&g_x11_lock);
+    if (!open_display_locked()) {
+        pthread_mutex_unlock(&g_x11_lock);
+        return true;
+    }
+
+    KeySym keysym = vk_to_keysym(vk);
+    KeyCode keycode = keysym != NoSymbol ? XKeysymToKeycode(g_display, keysym) : 0;
+    if (keycode == 0 || g_grab_count == MAX_X11_GRABS) {
+        pthread_mutex_unlock(&g_x11_lock);
+        return false;
+    }
+
+    Window root = DefaultRootWindow(g_display);
+    unsigned int modifiers = chord_to_x11(chord);
+    XErrorHandler previous = XSetErrorHandler(record_grab_error);
+    g_grab_error = Success;
+    for (size_t i = 0; i < sizeof(g_lock_masks) / sizeof(g_lock_masks[0]); i++) {
+        XGrabKey(g_display, keycode, modifiers | g_lock_masks[i], root, False, GrabModeAsync, GrabModeAsync);
+    }
+    XSync(g_display, False);
+    XSetErrorHandler(previous);
+
+    bool grabbed = g_grab_error == Success;
+    if (grabbed) {
+        X11Grab* grab = &g_grabs[g_grab_count++];
+        grab->chord = chord;
+        grab->vk = vk;
+        grab->keycode = keycode;
+        grab->modifiers = modifiers;
+    } else {
+        // Drop whichever lock combinations did succeed
+        for (size_t i = 0; i < sizeof(g_lock_masks) / sizeof(g_lock_masks[0]); i++) {
+            XUngrabKey(g_display, keycode, modifiers | g_lock_masks[i], root);
+        }
+        XSync(g_display, False);
+    }
+    pthread_mutex_unlock(&g_x11_lock);
+    return grabbed;
+}
+
+void compat_hotkey_ungrab(UINT chord, UINT vk) {
+    pthread_mutex_lock(&g_x11_lock);
+    for (int i = 0; g_display && i < g_grab_count; i++) {
+        if (g_grabs[i].chord != chord || g_grabs[i].vk != vk) continue;
+
+        Window root = DefaultRootWindow(g_display);
+        for (size_t j = 0; j < sizeof(g_lock_masks) / sizeof(g_lock_masks[0]); j++) {
+            XUngrabKey(g_display, g_grabs[i].keycode, g_grabs[i].modifiers | g_lock_masks[j], root);
+        }
+        XFlush(g_display);
+        if (g_held == g_grabs[i].keycode) g_held = 0;
+        g_grabs[i] = g_grabs[--g_grab_count];
+        break;
+    }
+    pthread_mutex_unlock(&g_x11_lock);
+}
@@ -0,0 +1,7 @@
+#ifndef MOSDEF_COMPAT_SHLOBJ_H
+#define MOSDEF_COMPAT_SHLOBJ_H
+
+// Shell folders are found through the environment (see _dupenv_s)
+#include <windows.h>
+
+#endif // MOSDEF_COMPAT_SHLOBJ_H
@@ -0,0 +1,64 @@
+#ifndef MOSDEF_COMPAT_SIM_H
+#define MOSDEF_COMPAT_SIM_H
+
+#include <windows.h>
+
+// Simulated display backend behind the compat layer's display, hotkey and
+// console functions. Tests script topologies, inject failures and latency,
+// press hotkeys and keys, capture the terminal and deliver Ctrl+C through
+// it; everything else sees only the Win32 API.
+//
+// Monitors are outputs \\.\DISPLAY1.. in order, each with one monitor whose
+// interface name is \\?\DISPLAY#<model>#<connector>#{guid}. Mode changes
+// take effect at once unless CDS_NORESET defers them to the next
+// ChangeDisplaySettingsExA(NULL, ...), and every applied change posts
+// WM_DISPLAYCHANGE to all windows.
+//
+// Without a scripted topology the backend starts from MOSDEF_SIM_MONITORS,
+// comma-separated MODEL:CONNECTOR:WxH[@HZ][/ORIENTATION], for example
+// "DEL4085:card0-DP-1:2560x1440@60/90,GSM5B7F:card0-HDMI-A-1:1920x1080", or
+// two landscape monitors if it is unset.
+
+typedef struct {
+    const char* model;          // PNP ID and product code, e.g. "DEL4085"; NULL for no monitor interface
+    const char* connector;      // Connector instance, e.g. "card0-DP-1" (sysfs name on Linux)
+    DWORD width;
+    DWORD height;
+    DWORD orientation;          // DMDO_*
+    DWORD refresh_hz;
+    LONG x;
+    LONG y;
+} SimMonitor;
+
+// Replaces the topology (at most SIM_MAX_MONITORS) and posts
+// WM_DEVICECHANGE/WM_DISPLAYCHANGE. sim_reset restores the default topology
+// and clears latency, failures and counters.
+#define SIM_MAX_MONITORS 64
+bool sim_set_monitors(const SimMonitor* monitors, int count);
+void sim_reset(void);
+
+// Current mode of output index (0-based); false if out of range
+bool sim_get_monitor(int index, SimMonitor* out_monitor);
+
+// Each mode change sleeps latency_ms; the next count changes fail with error
+void sim_set_change_latency(DWORD latency_ms);
+void sim_fail_changes(int count, LONG error);
+LONG sim_change_count(void);     // Mode changes applied since the last reset
+
+// Delivers WM_HOTKEY for a chord registered with RegisterHotKey (MOD_* and
+// VK_*); false if nothing is registered for it
+bool sim_press_hotkey(UINT modifiers, UINT vk);
+
+// Console input records read by ReadConsoleInputA, _kbhit and _getch
+void sim_push_key(WORD vk);
+void sim_push_resize(void);
+
+// Captures STD_OUTPUT_HANDLE writes and reports a width x height console.
+// NULL write restores the real terminal.
+typedef void (*SimTerminalWrite)(const char* data, size_t size, void* user_data);
+void sim_set_terminal(int width, int height, SimTerminalWrite write, void* user_data);
+
+// Runs the SetConsoleCtrlHandler chain as Ctrl+C would
+void sim_send_ctrl_c(void);
+
+#endif // MOSDEF_COMPAT_SIM_H
@@ -0,0 +1,1065 @@
+#include "win32_internal.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/random.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+// Objects, threads, synchronization, time and the CRT extensions
+
+#define POLL_TICK_MS 5
+#define FILETIME_UNIX_EPOCH 116444736000000000ULL   // 1970-01-01 in 100 ns ticks since 1601
+
+pthread_mutex_t g_compat_lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t g_compat_signal;
+
+static _Thread_local DWORD t_last_error = 0;
+static _Thread_local DWORD t_thread_id = 0;
+static volatile LONG g_next_thread_id = 0;
+
+__attribute__((constructor)) static void compat_init(void) {
+    pthread_condattr_t attributes;
+    pthread_condattr_init(&attributes);
+    pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);
+    pthread_cond_init(&g_compat_signal, &attributes);
+    pthread_condattr_destroy(&attributes);
+}
+
+// Errors
+DWORD GetLastError(void) {
+    return t_last_error;
+}
+
+void SetLastError(DWORD error) {
+    t_last_error = error;
+}
+
+void compat_set_error_from_errno(int error) {
+    switch (error) {
+        case 0: t_last_error = ERROR_SUCCESS; break;
+        case ENOENT: t_last_error = ERROR_FILE_NOT_FOUND; break;
+        case ENOTDIR: t_last_error = ERROR_PATH_NOT_FOUND; break;
+        case EACCES:
+        case EPERM: t_last_error = ERROR_ACCESS_DENIED; break;
+        case EBADF: t_last_error = ERROR_INVALID_HANDLE; break;
+        case ENOMEM: t_last_error = ERROR_NOT_ENOUGH_MEMORY; break;
+        case EEXIST: t_last_error = ERROR_ALREADY_EXISTS; break;
+        case EINVAL: t_last_error = ERROR_INVALID_PARAMETER; break;
+        case ETIMEDOUT: t_last_error = ERROR_TIMEOUT; break;
+        default: t_last_error = 0x20000000u | (DWORD)error; break;   // Customer bit: raw errno
+    }
+}
+
+char* compat_path(const char* path) {
+    if (!path) return NULL;
+    char* copy = strdup(path);
+    if (copy) {
+        for (char* p = copy; *p; p++) {
+            if (*p == '\\') *p = '/';
+        }
+    }
+    return copy;
+}
+
+// Objects
+CompatObject* compat_object_create(ObjectType type) {
+    CompatObject* object = (CompatObject*)calloc(1, sizeof(CompatObject));
+    if (!object) {
+        t_last_error = ERROR_NOT_ENOUGH_MEMORY;
+        return NULL;
+    }
+    object->type = type;
+    object->refs = 1;
+    return object;
+}
+
+static void object_destroy(CompatObject* object) {
+    switch (object->type) {
+        case OBJECT_MUTEX:
+            if (object->u.mutex.fd >= 0) close(object->u.mutex.fd);
+            break;
+        case OBJECT_PROCESS:
+            if (object->u.process.resume_fd >= 0) close(object->u.process.resume_fd);
+            break;
+        case OBJECT_PROCESS_THREAD:
+            compat_object_release_locked(object->u.process_thread.process);
+            break;
+        case OBJECT_JOB:
+            free(object->u.job.groups);
+            break;
+        case OBJECT_FILE:
+            if (object->u.file.fd >= 0) close(object->u.file.fd);
+            break;
+        case OBJECT_MAPPING:
+            if (object->u.mapping.fd >= 0) close(object->u.mapping.fd);
+            break;
+        case OBJECT_FIND:
+            if (object->u.find.dir) closedir(object->u.find.dir);
+            free(object->u.find.directory);
+            free(object->u.find.pattern);
+            break;
+        default:
+            break;
+    }
+    free(object);
+}
+
+void compat_object_release_locked(CompatObject* object) {
+    if (object && --object->refs == 0) {
+        object_destroy(object);
+    }
+}
+
+// A thread waiting only on socket events blocks in poll() rather than
+// ticking; signals reach it through a pipe of its own, registered here for
+// the length of the wait
+typedef struct SocketWaiter {
+    int wake[2];
+    struct SocketWaiter* next;
+} SocketWaiter;
+
+static SocketWaiter* g_socket_waiters = NULL;   // Guarded by g_compat_lock
+static pthread_key_t g_socket_waiter_key;
+static pthread_once_t g_socket_waiter_once = PTHREAD_ONCE_INIT;
+static _Thread_local SocketWaiter* t_socket_waiter = NULL;
+
+void compat_signal_locked(void) {
+    pthread_cond_broadcast(&g_compat_signal);
+    for (SocketWaiter* waiter = g_socket_waiters; waiter; waiter = waiter->next) {
+        // Non-blocking: a full pipe already wakes its waiter
+        char byte = 0;
+        ssize_t written = write(waiter->wake[1], &byte, 1);
+        (void)written;
+    }
+}
+
+static void release_socket_waiter(void* value) {
+    SocketWaiter* waiter = (SocketWaiter*)value;
+    close(waiter->wake[0]);
+    close(waiter->wake[1]);
+    free(waiter);
+}
+
+static void create_socket_waiter_key(void) {
+    pthread_key_create(&g_socket_waiter_key, release_socket_waiter);
+}
+
+// The calling thread's waiter, created on its first socket wait; NULL if no
+// pipe is available, in which case the wait ticks
+static SocketWaiter* current_socket_waiter(void) {
+    if (t_socket_waiter) return t_socket_waiter;
+    SocketWaiter* waiter = (SocketWaiter*)calloc(1, sizeof(SocketWaiter));
+    if (!waiter) return NULL;
+    if (pipe2(waiter->wake, O_NONBLOCK | O_CLOEXEC) != 0) {
+        free(waiter);
+        return NULL;
+    }
+    pthread_once(&g_socket_waiter_once, create_socket_waiter_key);
+    pthread_setspecific(g_socket_waiter_key, waiter);
+    t_socket_waiter = waiter;
+    return waiter;
+}
+
+static bool is_object(HANDLE handle) {
+    return handle && handle != INVALID_HANDLE_VALUE;
+}
+
+BOOL CloseHandle(HANDLE handle) {
+    if (!is_object(handle)) {
+        t_last_error = ERROR_INVALID_HANDLE;
+        return FALSE;
+    }
+    CompatObject* object = (CompatObject*)handle;
+    if (object->type == OBJECT_CONSOLE_INPUT || object->type == OBJECT_CONSOLE_OUTPUT) {
+        return TRUE;    // Standard handles are static
+    }
+    pthread_mutex_lock(&g_compat_lock);
+    compat_object_release_locked(object);
+    pthread_mutex_unlock(&g_compat_lock);
+    return TRUE;
+}
+
+// Threads
+static void* thread_main(void* param) {
+    CompatObject* object = (CompatObject*)param;
+
+    pthread_mutex_lock(&g_compat_lock);
+    while (object->u.thread.suspended) {
+        pthread_cond_wait(&g_compat_signal, &g_compat_lock);
+    }
+    t_thread_id = object->u.thread.id;
+    DWORD_PTR affinity = object->u.thread.affinity;
+    int priority = object->u.thread.priority;
+    pthread_mutex_unlock(&g_compat_lock);
+
+    // Real-time scheduling where the process may use it; recorded only otherwise
+    if (priority >= THREAD_PRIORITY_HIGHEST) {
+        struct sched_param schedule;
+        memset(&schedule, 0, sizeof(schedule));
+        schedule.sched_priority = sched_get_priority_min(SCHED_FIFO) +
+                                  (priority >= THREAD_PRIORITY_TIME_CRITICAL ? 1 : 0);
+        pthread_setschedparam(pthread_self(), SCHED_FIFO, &schedule);
+    }
+
+    if (affinity) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu = 0; cpu < (int)(sizeof(DWORD_PTR) * 8) && cpu < CPU_SETSIZE; cpu++) {
+            if (affinity & ((DWORD_PTR)1 << cpu)) CPU_SET(cpu, &set);
+        }
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+
+    DWORD exit_code = object->u.thread.start(object->u.thread.parameter);
+
+    pthread_mutex_lock(&g_compat_lock);
+    object->u.thread.finished = true;
+    object->u.thread.exit_code = exit_code;
+    compat_signal_locked();
+    compat_object_release_locked(object);
+    pthread_mutex_unlock(&g_compat_lock);
+    return NULL;
+}
+
+HANDLE CreateThread(SECURITY_ATTRIBUTES* attributes, SIZE_T stack_size, LPTHREAD_START_ROUTINE start,
+                    LPVOID parameter, DWORD flags, LPDWORD thread_id) {
+    (void)attributes;
+    CompatObject* object = compat_object_create(OBJECT_THREAD);
+    if (!object) return NULL;
+
+    object->refs = 2;   // The handle and the running thread
+    object->u.thread.start = start;
+    object->u.thread.parameter = parameter;
+    object->u.thread.suspended = (flags & CREATE_SUSPENDED) != 0;
+    object->u.thread.id = (DWORD)InterlockedIncrement(&g_next_thread_id) + 1;
+
+    pthread_attr_t thread_attributes;
+    pthread_attr_init(&thread_attributes);
+    pthread_attr_setdetachstate(&thread_attributes, PTHREAD_CREATE_DETACHED);
+    if (stack_size) {
+        pthread_attr_setstacksize(&thread_attributes, stack_size);
+    }
+    int error = pthread_create(&object->u.thread.thread, &thread_attributes, thread_main, object);
+    pthread_attr_destroy(&thread_attributes);
+    if (error != 0) {
+        compat_set_error_from_errno(error);
+        free(object);
+        return NULL;
+    }
+
+    if (thread_id) *thread_id = object->u.thread.id;
+    return object;
+}
+
+DWORD ResumeThread(HANDLE thread) {
+    CompatObject* object = (CompatObject*)thread;
+    if (!is_object(thread)) return (DWORD)-1;
+
+    pthread_mutex_lock(&g_compat_lock);
+    DWORD previous = 0;
+    if (object->type == OBJECT_THREAD) {
+        previous = object->u.thread.suspended ? 1 : 0;
+        object->u.thread.suspended = false;
+        compat_signal_locked();
+    } else if (object->type == OBJECT_PROCESS_THREAD) {
+        CompatObject* process = object->u.process_thread.process;
+        if (process->u.process.resume_fd >= 0) {
+            char go = 1;
+            ssize_t ignored = write(process->u.process.resume_fd, &go, 1);
+            (void)ignored;
+            close(process->u.process.resume_fd);
+            process->u.process.resume_fd = -1;
+            previous = 1;
+        }
+    }
+    pthread_mutex_unlock(&g_compat_lock);
+    return previous;
+}
+
+// Priorities are recorded, and a thread created suspended starts with
+// HIGHEST or TIME_CRITICAL as SCHED_FIFO when the process holds
+// CAP_SYS_NICE. Without it they stay recorded only: Windows grants
+// TIME_CRITICAL within a process regardless, so failing here would be wrong.
+BOOL SetThreadPriority(HANDLE thread, int priority) {
+    CompatObject* object = (CompatObject*)thread;
+    if (!is_object(thread) || object->type != OBJECT_THREAD) {
+        t_last_error = ERROR_INVALID_HANDLE;
+        return FALSE;
+    }
+    pthread_mutex_lock(&g_compat_lock);
+    object->u.thread.priority = priority;
+    pthread_mutex_unlock(&g_compat_lock);
+    return TRUE;
+}
+
+int GetThreadPriority(HANDLE thread) {
+    CompatObject* object = (CompatObject*)thread;
+    if (!is_object(thread) || object->type != OBJECT_THREAD) return THREAD_PRIORITY_NORMAL;
+    return object->u.thread.priority;
+}
+
+DWORD_PTR SetThreadAffinityMask(HANDLE thread, DWORD_PTR mask) {
+    CompatObject* object = (CompatObject*)thread;
+    if (!is_object(thread) || object->type != OBJECT_THREAD || mask == 0) {
+        t_last_error = ERROR_INVALID_PARAMETER;
+        return 0;
+    }
+
+    cpu_set_t available;
+    CPU_ZERO(&available);
+    sched_getaffinity(0, sizeof(available), &available);
+    DWORD_PTR valid = 0;
+    for (int cpu = 0; cpu < (int)(sizeof(DWORD_PTR) * 8) && cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &available)) valid |= (DWORD_PTR)1 << cpu;
+    }
+    if ((mask & valid) == 0) {
+        t_last_error = ERROR_INVALID_PARAMETER;
+        return 0;
+    }
+
+    pthread_mutex_lock(&g_compat_lock);
+    DWORD_PTR previous = object->u.thread.affinity ? object->u.thread.affinity : valid;
+    object->u.thread.affinity = mask;
+    bool running = !object->u.thread.suspended && !object->u.thread.finished;
+    pthread_mutex_unlock(&g_compat_lock);
+
+    if (running) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu = 0; cpu < (int)(sizeof(DWORD_PTR) * 8) && cpu < CPU_SETSIZE; cpu++) {
+            if (mask & ((DWORD_PTR)1 << cpu)) CPU_SET(cpu, &set);
+        }
+        pthread_setaffinity_np(object->u.thread.thread, sizeof(set), &set);
+    }
+    return previous;
+}
+
+BOOL GetExitCodeThread(HANDLE thread, LPDWORD exit_code) {
+    CompatObject* object = (CompatObject*)thread;
+    if (!is_object(thread) || object->type != OBJECT_THREAD || !exit_code) return FALSE;
+    pthread_mutex_lock(&g_compat_lock);
+    *exit_code = object->u.thread.finished ? object->u.thread.exit_code : STILL_ACTIVE;
+    pthread_mutex_unlock(&g_compat_lock);
+    return TRUE;
+}
+
+DWORD GetCurrentThreadId(void) {
+    if (t_thread_id == 0) {
+        t_thread_id = (DWORD)InterlockedIncrement(&g_next_thread_id) + 1;
+    }
+    return t_thread_id;
+}
+
+DWORD GetCurrentProcessId(void) {
+    return (DWORD)getpid();
+}
+
+void Sleep(DWORD milliseconds) {
+    if (milliseconds == 0) {
+        sched_yield();
+        return;
+    }
+    struct timespec delay = { (time_t)(milliseconds / 1000), (long)(milliseconds % 1000) * 1000000L };
+    while (nanosleep(&delay, &delay) != 0 && errno == EINTR) {
+    }
+}
+
+// Events and mutexes
+HANDLE CreateEventA(SECURITY_ATTRIBUTES* attributes, BOOL manual_reset, BOOL initial_state, LPCSTR name) {
+    (void)attributes;
+    (void)name;
+    CompatObject* object = compat_object_create(OBJECT_EVENT);
+    if (!object) return NULL;
+    object->u.event.manual_reset = manual_reset != 0;
+    object->u.event.signaled = initial_state != 0;
+    object->u.event.socket = -1;
+    return object;
+}
+
+static BOOL set_event_state(HANDLE event, bool signaled) {
+    CompatObject* object = (CompatObject*)event;
+    if (!is_object(event) || object->type != OBJECT_EVENT) {
+        t_last_error = ERROR_INVALID_HANDLE;
+        return FALSE;
+    }
+    pthread_mutex_lock(&g_compat_lock);
+    object->u.event.signaled = signaled;
+    if (signaled) compat_signal_locked();
+    pthread_mutex_unlock(&g_compat_lock);
+    return TRUE;
+}
+
+BOOL SetEvent(HANDLE event) {
+    return set_event_state(event, true);
+}
+
+BOOL ResetEvent(HANDLE event) {
+    return set_event_state(event, false);
+}
+
+// Named mutexes are shared between processes through flock() on a lock
+// file; each handle is its own open file, so handles exclude each other
+HANDLE CreateMutexA(SECURITY_ATTRIBUTES* attributes, BOOL initial_owner, LPCSTR name) {
+    (void)attributes;
+    CompatObject* object = compat_object_create(OBJECT_MUTEX);
+    if (!object) return NULL;
+
+    char path[MAX_PATH];
+    const char* tmp = getenv("TMPDIR");
+    int length = snprintf(path, sizeof(path), "%s/mosdef-%u-", tmp && tmp[0] ? tmp : "/tmp", (unsigned)getuid());
+    for (const char* p = name ? name : "anonymous"; *p && length < (int)sizeof(path) - 6; p++) {
+        path[length++] = (*p == '\\' || *p == '/') ? '_' : *p;
+    }
+    strcpy(path + length, ".lock");
+
+    object->u.mutex.fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (object->u.mutex.fd < 0) {
+        compat_set_error_from_errno(errno);
+        free(object);
+        return NULL;
+    }
+    if (initial_owner && flock(object->u.mutex.fd, LOCK_EX) == 0) {
+        object->u.mutex.depth = 1;
+    }
+    return object;
+}
+
+BOOL ReleaseMutex(HANDLE mutex) {
+    CompatObject* object = (CompatObject*)mutex;
+    if (!is_object(mutex) || object->type != OBJECT_MUTEX) {
+        t_last_error = ERROR_INVALID_HANDLE;
+        return FALSE;
+    }
+    pthread_mutex_lock(&g_compat_lock);
+    bool owned = object->u.mutex.depth > 0;
+    if (owned && --object->u.mutex.depth == 0) {
+        flock(object->u.mutex.fd, LOCK_UN);
+        compat_signal_locked();
+    }
+    pthread_mutex_unlock(&g_compat_lock);
+    return owned ? TRUE : FALSE;
+}
+
+// Waits
+static bool is_polled(const CompatObject* object) {
+    switch (object->type) {
+        case OBJECT_MUTEX:
+        case OBJECT_PROCESS:
+        case OBJECT_PROCESS_THREAD:
+        case OBJECT_CONSOLE_INPUT:
+            return true;
+        case OBJECT_EVENT:
+            return object->u.event.socket >= 0;
+        default:
+            return false;
+    }
+}
+
+static bool reap_process_locked(CompatObject* process) {
+    if (process->u.process.exited) return true;
+
+    int status = 0;
+    pid_t result = waitpid(process->u.process.pid, &status, WNOHANG);
+    if (result == process->u.process.pid) {
+        process->u.process.exited = true;
+        if (WIFEXITED(status)) {
+            process->u.process.exit_code = (DWORD)WEXITSTATUS(status);
+        } else if (process->u.process.exit_code == STILL_ACTIVE) {
+            process->u.process.exit_code = 128u + (DWORD)WTERMSIG(status);
+        }
+    } else if (result < 0 && errno == ECHILD) {
+        process->u.process.exited = true;   // Reaped elsewhere
+    }
+    return process->u.process.exited;
+}
+
+// Tests without consuming; mutexes are acquired here since flock() is the test
+static bool object_ready_locked(CompatObject* object) {
+    switch (object->type) {
+        case OBJECT_THREAD:
+            return object->u.thread.finished;
+        case OBJECT_EVENT:
+            if (object->u.event.signaled) return true;
+            if (object->u.event.socket >= 0) {
+                struct pollfd poll_fd = { object->u.event.socket, POLLIN, 0 };
+                return poll(&poll_fd, 1, 0) > 0;
+            }
+            return false;
+        case OBJECT_MUTEX:
+            if (object->u.mutex.depth > 0) {
+                object->u.mutex.depth++;
+                return true;
+            }
+            if (flock(object->u.mutex.fd, LOCK_EX | LOCK_NB) == 0) {
+                object->u.mutex.depth = 1;
+                return true;
+            }
+            return false;
+        case OBJECT_PROCESS:
+            return reap_process_locked(object);
+        case OBJECT_PROCESS_THREAD:
+            return reap_process_locked(object->u.process_thread.process);
+        case OBJECT_CONSOLE_INPUT:
+            return compat_console_input_ready();
+        default:
+            return false;
+    }
+}
+
+static void object_consume_locked(CompatObject* object) {
+    if (object->type == OBJECT_EVENT && !object->u.event.manual_reset) {
+        object->u.event.signaled = false;
+    }
+}
+
+static void deadline_after(struct timespec* deadline, DWORD milliseconds) {
+    clock_gettime(CLOCK_MONOTONIC, deadline);
+    deadline->tv_sec += milliseconds / 1000;
+    deadline->tv_nsec += (long)(milliseconds % 1000) * 1000000L;
+    if (deadline->tv_nsec >= 1000000000L) {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000L;
+    }
+}
+
+static bool deadline_passed(const struct timespec* deadline) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec > deadline->tv_sec ||
+           (now.tv_sec == deadline->tv_sec && now.tv_nsec >= deadline->tv_nsec);
+}
+
+// Blocks until a socket of handles is readable, the waiter is signaled or
+// deadline (NULL for none) passes. Entered and left with g_compat_lock held.
+static void wait_sockets_locked(SocketWaiter* waiter, DWORD count, const HANDLE* handles,
+                                const struct timespec* deadline) {
+    struct pollfd fds[MAXIMUM_WAIT_OBJECTS + 1];
+    nfds_t used = 0;
+    for (DWORD i = 0; i < count && used < MAXIMUM_WAIT_OBJECTS; i++) {
+        const CompatObject* object = (const CompatObject*)handles[i];
+        if (object->type == OBJECT_EVENT && object->u.event.socket >= 0) {
+            fds[used].fd = object->u.event.socket;
+            fds[used].events = POLLIN;
+            fds[used].revents = 0;
+            used++;
+        }
+    }
+    fds[used].fd = waiter->wake[0];
+    fds[used].events = POLLIN;
+    fds[used].revents = 0;
+
+    int timeout = -1;
+    if (deadline) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        LONG64 remaining = ((LONG64)deadline->tv_sec - now.tv_sec) * 1000 +
+                           (deadline->tv_nsec - now.tv_nsec + 999999L) / 1000000L;
+        timeout = remaining > 0 ? (remaining < INT_MAX ? (int)remaining : INT_MAX) : 0;
+    }
+
+    waiter->next = g_socket_waiters;
+    g_socket_waiters = waiter;
+    pthread_mutex_unlock(&g_compat_lock);
+
+    poll(fds, used + 1, timeout);
+    char drain[64];
+    while (read(waiter->wake[0], drain, sizeof(drain)) > 0) {
+    }
+
+    pthread_mutex_lock(&g_compat_lock);
+    for (SocketWaiter** link = &g_socket_waiters; *link; link = &(*link)->next) {
+        if (*link == waiter) {
+            *link = waiter->next;
+            break;
+        }
+    }
+}
+
+DWORD compat_wait(DWORD count, const HANDLE* handles, BOOL wait_all, DWORD milliseconds, bool messages) {
+    if (wait_all && count > 1) {
+        t_last_error = ERROR_NOT_SUPPORTED;     // Nothing in MOS-DEF waits for all
+        return WAIT_FAILED;
+    }
+    for (DWORD i = 0; i < count; i++) {
+        if (!is_object(handles[i])) {
+            t_last_error = ERROR_INVALID_HANDLE;
+            return WAIT_FAILED;
+        }
+    }
+
+    bool polled = false;
+    bool sockets_only = count <= MAXIMUM_WAIT_OBJECTS;
+    for (DWORD i = 0; i < count; i++) {
+        const CompatObject* object = (const CompatObject*)handles[i];
+        if (is_polled(object)) {
+            polled = true;
+            sockets_only = sockets_only && object->type == OBJECT_EVENT;
+        }
+    }
+    SocketWaiter* waiter = polled && sockets_only ? current_socket_waiter() : NULL;
+
+    struct timespec deadline;
+    if (milliseconds != INFINITE) {
+        deadline_after(&deadline, milliseconds);
+    }
+
+    DWORD result = WAIT_TIMEOUT;
+    pthread_mutex_lock(&g_compat_lock);
+    for (;;) {
+        bool found = false;
+        for (DWORD i = 0; i < count && !found; i++) {
+            CompatObject* object = (CompatObject*)handles[i];
+            if (object_ready_locked(object)) {
+                object_consume_locked(object);
+                result = WAIT_OBJECT_0 + i;
+                found = true;
+            }
+        }
+        if (found) break;
+
+        if (messages && compat_thread_has_messages_locked()) {
+            result = WAIT_OBJECT_0 + count;
+            break;
+        }
+        if (milliseconds != INFINITE && deadline_passed(&deadline)) {
+            result = WAIT_TIMEOUT;
+            break;
+        }
+
+        if (waiter) {
+            wait_sockets_locked(waiter, count, handles, milliseconds != INFINITE ? &deadline : NULL);
+        } else if (polled) {
+            struct timespec tick;
+            deadline_after(&tick, POLL_TICK_MS);
+            if (milliseconds != INFINITE && (tick.tv_sec > deadline.tv_sec ||
+                (tick.tv_sec == deadline.tv_sec && tick.tv_nsec > deadline.tv_nsec))) {
+                tick = deadline;
+            }
+            pthread_cond_timedwait(&g_compat_signal, &g_compat_lock, &tick);
+        } else if (milliseconds != INFINITE) {
+            pthread_cond_timedwait(&g_compat_signal, &g_compat_lock, &deadline);
+        } else {
+            pthread_cond_wait(&g_compat_signal, &g_compat_lock);
+        }
+    }
+    pthread_mutex_unlock(&g_compat_lock);
+    return result;
+}
+
+DWORD WaitForSingleObject(HANDLE handle, DWORD milliseconds) {
+    return compat_wait(1, &handle, FALSE, milliseconds, false);
+}
+
+DWORD WaitForMultipleObjects(DWORD count, const HANDLE* handles, BOOL wait_all, DWORD milliseconds) {
+    return compat_wait(count, handles, wait_all, milliseconds, false);
+}
+
+// Critical sections
+void InitializeCriticalSection(CRITICAL_SECTION* section) {
+    pthread_mutexattr_t attributes;
+    pthread_mutexattr_init(&attributes);
+    pthread_mutexattr_settype(&attributes, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&section->mutex, &attributes);
+    pthread_mutexattr_destroy(&attributes);
+}
+
+void EnterCriticalSection(CRITICAL_SECTION* section) {
+    pthread_mutex_lock(&section->mutex);
+}
+
+BOOL TryEnterCriticalSection(CRITICAL_SECTION* section) {
+    return pthread_mutex_trylock(&section->mutex) == 0;
+}
+
+void LeaveCriticalSection(CRITICAL_SECTION* section) {
+    pthread_mutex_unlock(&section->mutex);
+}
+
+void DeleteCriticalSection(CRITICAL_SECTION* section) {
+    pthread_mutex_destroy(&section->mutex);
+}
+
+// Slim reader/writer locks
+void InitializeSRWLock(SRWLOCK* lock) {
+    pthread_rwlock_init(lock, NULL);
+}
+
+void AcquireSRWLockExclusive(SRWLOCK* lock) {
+    pthread_rwlock_wrlock(lock);
+}
+
+void ReleaseSRWLockExclusive(SRWLOCK* lock) {
+    pthread_rwlock_unlock(lock);
+}
+
+void AcquireSRWLockShared(SRWLOCK* lock) {
+    pthread_rwlock_rdlock(lock);
+}
+
+void ReleaseSRWLockShared(SRWLOCK* lock) {
+    pthread_rwlock_unlock(lock);
+}
+
+// Condition variables
+void InitializeConditionVariable(CONDITION_VARIABLE* variable) {
+    pthread_mutex_init(&variable->mutex, NULL);
+    pthread_cond_init(&variable->cond, NULL);
+    variable->sequence = 0;
+}
+
+// Called with variable->mutex held and the caller's lock released
+static BOOL sleep_on(CONDITION_VARIABLE* variable, DWORD milliseconds) {
+    unsigned long sequence = variable->sequence;
+    struct timespec deadline;
+    if (milliseconds != INFINITE) {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += milliseconds / 1000;
+        deadline.tv_nsec += (long)(milliseconds % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+    }
+
+    BOOL woken = TRUE;
+    while (variable->sequence == sequence) {
+        if (milliseconds == INFINITE) {
+            pthread_cond_wait(&variable->cond, &variable->mutex);
+        } else if (pthread_cond_timedwait(&variable->cond, &variable->mutex, &deadline) == ETIMEDOUT) {
+            woken = variable->sequence != sequence;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&variable->mutex);
+    if (!woken) t_last_error = ERROR_TIMEOUT;
+    return woken;
+}
+
+BOOL SleepConditionVariableCS(CONDITION_VARIABLE* variable, CRITICAL_SECTION* section, DWORD milliseconds) {
+    pthread_mutex_lock(&variable->mutex);
+    LeaveCriticalSection(section);
+    BOOL woken = sleep_on(variable, milliseconds);
+    EnterCriticalSection(section);
+    return woken;
+}
+
+BOOL SleepConditionVariableSRW(CONDITION_VARIABLE* variable, SRWLOCK* lock, DWORD milliseconds, ULONG flags) {
+    pthread_mutex_lock(&variable->mutex);
+    pthread_rwlock_unlock(lock);
+    BOOL woken = sleep_on(variable, milliseconds);
+    if (flags & CONDITION_VARIABLE_LOCKMODE_SHARED) {
+        AcquireSRWLockShared(lock);
+    } else {
+        AcquireSRWLockExclusive(lock);
+    }
+    return woken;
+}
+
+void WakeConditionVariable(CONDITION_VARIABLE* variable) {
+    pthread_mutex_lock(&variable->mutex);
+    variable->sequence++;
+    pthread_cond_signal(&variable->cond);
+    pthread_mutex_unlock(&variable->mutex);
+}
+
+void WakeAllConditionVariable(CONDITION_VARIABLE* variable) {
+    pthread_mutex_lock(&variable->mutex);
+    variable->sequence++;
+    pthread_cond_broadcast(&variable->cond);
+    pthread_mutex_unlock(&variable->mutex);
+}
+
+// Time
+static ULONGLONG monotonic_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (ULONGLONG)now.tv_sec * 1000000000ULL + (ULONGLONG)now.tv_nsec;
+}
+
+DWORD GetTickCount(void) {
+    return (DWORD)(monotonic_ns() / 1000000ULL);
+}
+
+ULONGLONG GetTickCount64(void) {
+    return monotonic_ns() / 1000000ULL;
+}
+
+BOOL QueryPerformanceCounter(LARGE_INTEGER* counter) {
+    counter->QuadPart = (LONGLONG)monotonic_ns();
+    return TRUE;
+}
+
+BOOL QueryPerformanceFrequency(LARGE_INTEGER* frequency) {
+    frequency->QuadPart = 1000000000LL;
+    return TRUE;
+}
+
+static void set_filetime(FILETIME* file_time, ULONGLONG ticks) {
+    file_time->dwLowDateTime = (DWORD)ticks;
+    file_time->dwHighDateTime = (DWORD)(ticks >> 32);
+}
+
+static ULONGLONG get_filetime(const FILETIME* file_time) {
+    return ((ULONGLONG)file_time->dwHighDateTime << 32) | file_time->dwLowDateTime;
+}
+
+void GetSystemTimeAsFileTime(FILETIME* file_time) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    set_filetime(file_time, FILETIME_UNIX_EPOCH + (ULONGLONG)now.tv_sec * 10000000ULL +
+                            (ULONGLONG)now.tv_nsec / 100);
+}
+
+static void tm_to_systemtime(const struct tm* tm, WORD milliseconds, SYSTEMTIME* system_time) {
+    system_time->wYear = (WORD)(tm->tm_year + 1900);
+    system_time->wMonth = (WORD)(tm->tm_mon + 1);
+    system_time->wDayOfWeek = (WORD)tm->tm_wday;
+    system_time->wDay = (WORD)tm->tm_mday;
+    system_time->wHour = (WORD)tm->tm_hour;
+    system_time->wMinute = (WORD)tm->tm_min;
+    system_time->wSecond = (WORD)tm->tm_sec;
+    system_time->wMilliseconds = milliseconds;
+}
+
+static void systemtime_to_tm(const SYSTEMTIME* system_time, struct tm* tm) {
+    memset(tm, 0, sizeof(*tm));
+    tm->tm_year = system_time->wYear - 1900;
+    tm->tm_mon = system_time->wMonth - 1;
+    tm->tm_mday = system_time->wDay;
+    tm->tm_hour = system_time->wHour;
+    tm->tm_min = system_time->wMinute;
+    tm->tm_sec = system_time->wSecond;
+    tm->tm_isdst = -1;
+}
+
+BOOL FileTimeToSystemTime(const FILETIME* file_time, SYSTEMTIME* system_time) {
+    ULONGLONG ticks = get_filetime(file_time);
+    if (ticks < FILETIME_UNIX_EPOCH) {
+        t_last_error = ERROR_INVALID_PARAMETER;
+        return FALSE;
+    }
+    time_t seconds = (time_t)((ticks - FILETIME_UNIX_EPOCH) / 10000000ULL);
+    struct tm tm;
+    if (!gmtime_r(&seconds, &tm)) return FALSE;
+    tm_to_systemtime(&tm, (WORD)((ticks / 10000ULL) % 1000ULL), system_time);
+    return TRUE;
+}
+
+BOOL SystemTimeToFileTime(const SYSTEMTIME* system_time, FILETIME* file_time) {
+    struct tm tm;
+    systemtime_to_tm(system_time, &tm);
+    tm.tm_isdst = 0;
+    time_t seconds = timegm(&tm);
+    if (seconds == (time_t)-1 || seconds < 0) {
+        t_last_error = ERROR_INVALID_PARAMETER;
+        return FALSE;
+    }
+    set_filetime(file_time, FILETIME_UNIX_EPOCH + (ULONGLONG)seconds * 10000000ULL +
+                            (ULONGLONG)system_time->wMilliseconds * 10000ULL);
+    return TRUE;
+}
+
+BOOL FileTimeToLocalFileTime(const FILETIME* file_time, FILETIME* local_time) {
+    ULONGLONG ticks = get_filetime(file_time);
+    time_t seconds = (time_t)((ticks - FILETIME_UNIX_EPOCH) / 10000000ULL);
+    struct tm tm;
+    if (!localtime_r(&seconds, &tm)) return FALSE;
+    set_filetime(local_time, ticks + (ULONGLONG)((LONGLONG)tm.tm_gmtoff * 10000000LL));
+    return TRUE;
+}
+
+BOOL TzSpecificLocalTimeToSystemTime(const void* time_zone, const SYSTEMTIME* local_time, SYSTEMTIME* system_time) {
+    (void)time_zone;
+    struct tm tm;
+    systemtime_to_tm(local_time, &tm);
+    time_t seconds = mktime(&tm);
+    if (seconds == (time_t)-1) {
+        t_last_error = ERROR_INVALID_PARAMETER;
+        return FALSE;
+    }
+    struct tm utc;
+    if (!gmtime_r(&seconds, &utc)) return FALSE;
+    tm_to_systemtime(&utc, local_time->wMilliseconds, system_time);
+    return TRUE;
+}
+
+void GetSystemTime(SYSTEMTIME* system_time) {
+    FILETIME now;
+    GetSystemTimeAsFileTime(&now);
+    FileTimeToSystemTime(&now, system_time);
+}
+
+void GetLocalTime(SYSTEMTIME* system_time) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    struct tm tm;
+    localtime_r(&now.tv_sec, &tm);
+    tm_to_systemtime(&tm, (WORD)(now.tv_nsec / 1000000L), system_time);
+}
+
+LONG CompareFileTime(const FILETIME* first, const FILETIME* second) {
+    ULONGLONG left = get_filetime(first);
+    ULONGLONG right = get_filetime(second);
+    return (left > right) - (left < right);
+}
+
+// Processor features
+BOOL IsProcessorFeaturePresent(DWORD feature) {
+#if defined(__x86_64__) || defined(__i386__)
+    switch (feature) {
+        case PF_XMMI64_INSTRUCTIONS_AVAILABLE: return __builtin_cpu_supports("sse2");
+        case PF_AVX2_INSTRUCTIONS_AVAILABLE: return __builtin_cpu_supports("avx2");
+        default: return FALSE;
+    }
+#else
+    (void)feature;
+    return FALSE;
+#endif
+}
+
+// CRT extensions
+int sprintf_s(char* buffer, size_t size, const char* format, ...) {
+    if (!buffer || size == 0 || !format) return -1;
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buffer, size, format, args);
+    va_end(args);
+    if (length < 0 || (size_t)length >= size) {
+        buffer[0] = '\0';
+        return -1;
+    }
+    return length;
+}
+
+errno_t strcpy_s(char* destination, size_t size, const char* source) {
+    if (!destination || size == 0) return EINVAL;
+    if (!source) {
+        destination[0] = '\0';
+        return EINVAL;
+    }
+    size_t length = strlen(source);
+    if (length >= size) {
+        destination[0] = '\0';
+        return ERANGE;
+    }
+    memcpy(destination, source, length + 1);
+    return 0;
+}
+
+errno_t strcat_s(char* destination, size_t size, const char* source) {
+    if (!destination || size == 0) return EINVAL;
+    size_t used = strnlen(destination, size);
+    if (used == size || !source) {
+        destination[0] = '\0';
+        return EINVAL;
+    }
+    size_t length = strlen(source);
+    if (used + length >= size) {
+        destination[0] = '\0';
+        return ERANGE;
+    }
+    memcpy(destination + used, source, length + 1);
+    return 0;
+}
+
+#define STRUNCATE 80
+
+errno_t strncpy_s(char* destination, size_t size, const char* source, size_t count) {
+    if (!destination || size == 0) return EINVAL;
+    if (!source) {
+        destination[0] = '\0';
+        return EINVAL;
+    }
+    size_t length = strnlen(source, count == _TRUNCATE ? (size_t)-1 : count);
+    if (length >= size) {
+        if (count != _TRUNCATE) {
+            destination[0] = '\0';
+            return ERANGE;
+        }
+        memcpy(destination, source, size - 1);
+        destination[size - 1] = '\0';
+        return STRUNCATE;
+    }
+    memcpy(destination, source, length);
+    destination[length] = '\0';
+    return 0;
+}
+
+char* strtok_s(char* str, const char* delimiters, char** context) {
+    return strtok_r(str, delimiters, context);
+}
+
+errno_t fopen_s(FILE** file, const char* path, const char* mode) {
+    if (!file) return EINVAL;
+    *file = NULL;
+    char* native = compat_path(path);
+    if (!native) return path ? ENOMEM : EINVAL;
+    *file = fopen(native, mode);
+    int error = *file ? 0 : errno;
+    free(native);
+    return error;
+}
+
+// %APPDATA% and %LOCALAPPDATA% fall back to the XDG directories
+static char* xdg_directory(const char* variable, const char* fallback) {
+    const char* value = getenv(variable);
+    if (value && value[0]) return strdup(value);
+
+    const char* home = getenv("HOME");
+    if (!home || !home[0]) return NULL;
+    size_t length = strlen(home) + strlen(fallback) + 2;
+    char* path = (char*)malloc(length);
+    if (path) snprintf(path, length, "%s/%s", home, fallback);
+    return path;
+}
+
+errno_t _dupenv_s(char** buffer, size_t* length, const char* name) {
+    if (!buffer || !name) return EINVAL;
+    *buffer = NULL;
+    if (length) *length = 0;
+
+    const char* value = getenv(name);
+    char* copy = NULL;
+    if (value) {
+        copy = strdup(value);
+    } else if (strcmp(name, "APPDATA") == 0) {
+        copy = xdg_directory("XDG_CONFIG_HOME", ".config");
+    } else if (strcmp(name, "LOCALAPPDATA") == 0) {
+        copy = xdg_directory("XDG_DATA_HOME", ".local/share");
+    } else {
+        return 0;
+    }
+
+    if (!copy) return value ? ENOMEM : 0;
+    *buffer = copy;
+    if (length) *length = strlen(copy) + 1;
+    return 0;
+}
+
+void* _aligned_malloc(size_t size, size_t alignment) {
+    void* ptr = NULL;
+    if (alignment < sizeof(void*)) alignment = sizeof(void*);
+    return posix_memalign(&ptr, alignment, size ? size : 1) == 0 ? ptr : NULL;
+}
+
+void _aligned_free(void* ptr) {
+    free(ptr);
+}
+
+errno_t rand_s(unsigned int* value) {
+    if (!value) return EINVAL;
+    ssize_t count;
+    do {
+        count = getrandom(value, sizeof(*value), 0);
+    } while (count < 0 && errno == EINTR);
+    return count == (ssize_t)sizeof(*value) ? 0 : EIO;
+}
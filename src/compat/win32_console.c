@@ -0,0 +1,483 @@
+#include "win32_internal.h"
+#include "sim.h"
+#include <conio.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+// Console handles on the terminal, or on the simulated console once a test
+// pushes input or installs a terminal. Ctrl+C runs the handler chain on a
+// dispatcher thread, as Windows runs it on a thread of its own.
+
+#define INPUT_QUEUE_CAPACITY 256
+#define MAX_CTRL_HANDLERS 16
+
+static CompatObject g_stdin = { OBJECT_CONSOLE_INPUT, 1, { .console = { 0 } } };
+static CompatObject g_stdout = { OBJECT_CONSOLE_OUTPUT, 1, { .console = { 1 } } };
+static CompatObject g_stderr = { OBJECT_CONSOLE_OUTPUT, 1, { .console = { 2 } } };
+
+// Lock order: g_compat_lock before g_console_lock
+static pthread_mutex_t g_console_lock = PTHREAD_MUTEX_INITIALIZER;
+static INPUT_RECORD g_input[INPUT_QUEUE_CAPACITY];
+static int g_input_head = 0;
+static int g_input_count = 0;
+static bool g_sim_console = false;
+static SimTerminalWrite g_terminal_write = NULL;
+static void* g_terminal_user_data = NULL;
+static int g_terminal_width = 80;
+static int g_terminal_height = 25;
+static DWORD g_input_mode = ENABLE_PROCESSED_INPUT | ENABLE_LINE_INPUT | ENABLE_ECHO_INPUT;
+static DWORD g_output_mode = ENABLE_PROCESSED_OUTPUT;
+static volatile sig_atomic_t g_resize_pending = 0;
+
+static struct termios g_saved_termios;
+static bool g_termios_saved = false;
+static bool g_conio_raw = false;
+
+HANDLE GetStdHandle(DWORD which) {
+    switch (which) {
+        case STD_INPUT_HANDLE: return &g_stdin;
+        case STD_OUTPUT_HANDLE: return &g_stdout;
+        case STD_ERROR_HANDLE: return &g_stderr;
+        default:
+            SetLastError(ERROR_INVALID_PARAMETER);
+            return INVALID_HANDLE_VALUE;
+    }
+}
+
+static bool is_console(HANDLE handle, ObjectType type) {
+    return handle && handle != INVALID_HANDLE_VALUE && ((CompatObject*)handle)->type == type;
+}
+
+static bool using_sim_input(void) {
+    pthread_mutex_lock(&g_console_lock);
+    bool sim = g_sim_console;
+    pthread_mutex_unlock(&g_console_lock);
+    return sim;
+}
+
+// Terminal modes
+static void restore_termios(void) {
+    if (g_termios_saved) {
+        tcsetattr(0, TCSANOW, &g_saved_termios);
+    }
+}
+
+static bool set_raw_termios(bool processed) {
+    if (!isatty(0)) return false;
+    if (!g_termios_saved) {
+        if (tcgetattr(0, &g_saved_termios) != 0) return false;
+        g_termios_saved = true;
+        atexit(restore_termios);
+    }
+    struct termios raw = g_saved_termios;
+    raw.c_lflag &= ~(tcflag_t)(ICANON | ECHO);
+    if (!processed) raw.c_lflag &= ~(tcflag_t)ISIG;
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+    return tcsetattr(0, TCSANOW, &raw) == 0;
+}
+
+static void on_resize(int signal_number) {
+    (void)signal_number;
+    g_resize_pending = 1;
+}
+
+BOOL GetConsoleMode(HANDLE console, LPDWORD mode) {
+    if (!mode) return FALSE;
+    if (is_console(console, OBJECT_CONSOLE_INPUT)) {
+        if (!using_sim_input() && !isatty(0)) {
+            SetLastError(ERROR_INVALID_HANDLE);
+            return FALSE;
+        }
+        *mode = g_input_mode;
+        return TRUE;
+    }
+    if (is_console(console, OBJECT_CONSOLE_OUTPUT)) {
+        pthread_mutex_lock(&g_console_lock);
+        bool terminal = g_terminal_write != NULL;
+        pthread_mutex_unlock(&g_console_lock);
+        if (!terminal && !isatty(((CompatObject*)console)->u.console.fd)) {
+            SetLastError(ERROR_INVALID_HANDLE);
+            return FALSE;
+        }
+        *mode = g_output_mode;
+        return TRUE;
+    }
+    SetLastError(ERROR_INVALID_HANDLE);
+    return FALSE;
+}
+
+BOOL SetConsoleMode(HANDLE console, DWORD mode) {
+    if (is_console(console, OBJECT_CONSOLE_OUTPUT)) {
+        g_output_mode = mode;
+        return TRUE;
+    }
+    if (!is_console(console, OBJECT_CONSOLE_INPUT)) {
+        SetLastError(ERROR_INVALID_HANDLE);
+        return FALSE;
+    }
+
+    g_input_mode = mode;
+    if (using_sim_input()) return TRUE;
+
+    if (mode & ENABLE_LINE_INPUT) {
+        signal(SIGWINCH, SIG_DFL);
+        restore_termios();
+        return TRUE;
+    }
+    if (mode & ENABLE_WINDOW_INPUT) {
+        signal(SIGWINCH, on_resize);
+    }
+    return set_raw_termios((mode & ENABLE_PROCESSED_INPUT) != 0);
+}
+
+BOOL GetConsoleScreenBufferInfo(HANDLE console, CONSOLE_SCREEN_BUFFER_INFO* info) {
+    if (!is_console(console, OBJECT_CONSOLE_OUTPUT) || !info) {
+        SetLastError(ERROR_INVALID_HANDLE);
+        return FALSE;
+    }
+
+    int width = 0, height = 0;
+    pthread_mutex_lock(&g_console_lock);
+    if (g_terminal_write) {
+        width = g_terminal_width;
+        height = g_terminal_height;
+    }
+    pthread_mutex_unlock(&g_console_lock);
+
+    struct winsize size;
+    if (width == 0) {
+        if (ioctl(((CompatObject*)console)->u.console.fd, TIOCGWINSZ, &size) != 0 || size.ws_col == 0) {
+            SetLastError(ERROR_INVALID_HANDLE);
+            return FALSE;
+        }
+        width = size.ws_col;
+        height = size.ws_row;
+    }
+
+    memset(info, 0, sizeof(*info));
+    info->dwSize.X = (short)width;
+    info->dwSize.Y = (short)height;
+    info->srWindow.Right = (short)(width - 1);
+    info->srWindow.Bottom = (short)(height - 1);
+    info->dwMaximumWindowSize = info->dwSize;
+    return TRUE;
+}
+
+bool compat_console_write(const void* data, size_t size) {
+    pthread_mutex_lock(&g_console_lock);
+    SimTerminalWrite write_terminal = g_terminal_write;
+    void* user_data = g_terminal_user_data;
+    pthread_mutex_unlock(&g_console_lock);
+    if (!write_terminal) return false;
+    write_terminal((const char*)data, size, user_data);
+    return true;
+}
+
+// Input
+static void push_record(const INPUT_RECORD* record) {
+    pthread_mutex_lock(&g_compat_lock);
+    pthread_mutex_lock(&g_console_lock);
+    g_sim_console = true;
+    if (g_input_count < INPUT_QUEUE_CAPACITY) {
+        g_input[(g_input_head + g_input_count) % INPUT_QUEUE_CAPACITY] = *record;
+        g_input_count++;
+    }
+    pthread_mutex_unlock(&g_console_lock);
+    compat_signal_locked();
+    pthread_mutex_unlock(&g_compat_lock);
+}
+
+static INPUT_RECORD key_record(WORD vk, char ascii) {
+    INPUT_RECORD record;
+    memset(&record, 0, sizeof(record));
+    record.EventType = KEY_EVENT;
+    record.Event.KeyEvent.bKeyDown = TRUE;
+    record.Event.KeyEvent.wRepeatCount = 1;
+    record.Event.KeyEvent.wVirtualKeyCode = vk;
+    record.Event.KeyEvent.uChar.AsciiChar = ascii;
+    return record;
+}
+
+void sim_push_key(WORD vk) {
+    char ascii = 0;
+    if (vk >= 'A' && vk <= 'Z') {
+        ascii = (char)tolower(vk);
+    } else if ((vk >= '0' && vk <= '9') || vk == VK_SPACE || vk == VK_RETURN || vk == VK_ESCAPE) {
+        ascii = (char)vk;
+    }
+    INPUT_RECORD record = key_record(vk, ascii);
+    push_record(&record);
+}
+
+void sim_push_resize(void) {
+    INPUT_RECORD record;
+    memset(&record, 0, sizeof(record));
+    record.EventType = WINDOW_BUFFER_SIZE_EVENT;
+    pthread_mutex_lock(&g_console_lock);
+    record.Event.WindowBufferSizeEvent.dwSize.X = (short)g_terminal_width;
+    record.Event.WindowBufferSizeEvent.dwSize.Y = (short)g_terminal_height;
+    pthread_mutex_unlock(&g_console_lock);
+    push_record(&record);
+}
+
+void sim_set_terminal(int width, int height, SimTerminalWrite write, void* user_data) {
+    pthread_mutex_lock(&g_console_lock);
+    g_terminal_write = write;
+    g_terminal_user_data = user_data;
+    g_terminal_width = width > 0 ? width : 80;
+    g_terminal_height = height > 0 ? height : 25;
+    g_sim_console = write != NULL || g_input_count > 0;
+    pthread_mutex_unlock(&g_console_lock);
+}
+
+static bool stdin_readable(void) {
+    if (!isatty(0)) return false;
+    struct pollfd poll_fd = { 0, POLLIN, 0 };
+    return poll(&poll_fd, 1, 0) > 0;
+}
+
+// Called with g_compat_lock held
+bool compat_console_input_ready(void) {
+    pthread_mutex_lock(&g_console_lock);
+    bool sim = g_sim_console;
+    bool queued = g_input_count > 0;
+    pthread_mutex_unlock(&g_console_lock);
+    if (sim) return queued;
+    return g_resize_pending || stdin_readable();
+}
+
+static bool pop_record(INPUT_RECORD* record) {
+    pthread_mutex_lock(&g_console_lock);
+    bool popped = g_input_count > 0;
+    if (popped) {
+        *record = g_input[g_input_head];
+        g_input_head = (g_input_head + 1) % INPUT_QUEUE_CAPACITY;
+        g_input_count--;
+    }
+    pthread_mutex_unlock(&g_console_lock);
+    return popped;
+}
+
+// Terminal bytes to key events: printable keys, Enter, Tab, Backspace, Esc
+// and the usual VT sequences for arrows and the navigation block
+static DWORD decode_keys(const unsigned char* bytes, size_t length, INPUT_RECORD* records, DWORD capacity) {
+    DWORD count = 0;
+    size_t i = 0;
+    while (i < length && count < capacity) {
+        unsigned char c = bytes[i++];
+        WORD vk = 0;
+        if (c == 0x1b && i < length && (bytes[i] == '[' || bytes[i] == 'O')) {
+            i++;
+            unsigned char code = i < length ? bytes[i++] : 0;
+            if (code >= '0' && code <= '9' && i < length && bytes[i] == '~') {
+                i++;
+                switch (code) {
+                    case '1': case '7': vk = VK_HOME; break;
+                    case '2': vk = VK_INSERT; break;
+                    case '3': vk = VK_DELETE; break;
+                    case '4': case '8': vk = VK_END; break;
+                    case '5': vk = VK_PRIOR; break;
+                    case '6': vk = VK_NEXT; break;
+                }
+            } else {
+                switch (code) {
+                    case 'A': vk = VK_UP; break;
+                    case 'B': vk = VK_DOWN; break;
+                    case 'C': vk = VK_RIGHT; break;
+                    case 'D': vk = VK_LEFT; break;
+                    case 'H': vk = VK_HOME; break;
+                    case 'F': vk = VK_END; break;
+                }
+            }
+            if (vk) records[count++] = key_record(vk, 0);
+            continue;
+        }
+
+        if (c == 0x1b) vk = VK_ESCAPE;
+        else if (c == '\r' || c == '\n') vk = VK_RETURN;
+        else if (c == '\t') vk = VK_TAB;
+        else if (c == 0x7f || c == 0x08) vk = VK_BACK;
+        else if (c == ' ') vk = VK_SPACE;
+        else if (isalpha(c)) vk = (WORD)toupper(c);
+        else if (isdigit(c)) vk = c;
+        records[count++] = key_record(vk, (char)c);
+    }
+    return count;
+}
+
+BOOL ReadConsoleInputA(HANDLE console, INPUT_RECORD* records, DWORD length, LPDWORD read_count) {
+    if (!is_console(console, OBJECT_CONSOLE_INPUT) || !records || length == 0 || !read_count) {
+        SetLastError(ERROR_INVALID_PARAMETER);
+        return FALSE;
+    }
+    *read_count = 0;
+
+    if (using_sim_input()) {
+        // Blocks like the real call until input arrives
+        while (!pop_record(&records[0])) {
+            WaitForSingleObject(console, INFINITE);
+        }
+        DWORD count = 1;
+        while (count < length && pop_record(&records[count])) count++;
+        *read_count = count;
+        return TRUE;
+    }
+
+    if (g_resize_pending) {
+        g_resize_pending = 0;
+        memset(&records[0], 0, sizeof(records[0]));
+        records[0].EventType = WINDOW_BUFFER_SIZE_EVENT;
+        *read_count = 1;
+        return TRUE;
+    }
+
+    unsigned char bytes[64];
+    ssize_t count;
+    do {
+        count = read(0, bytes, sizeof(bytes));
+    } while (count < 0 && errno == EINTR);
+    if (count <= 0) {
+        SetLastError(ERROR_INVALID_HANDLE);
+        return FALSE;
+    }
+    *read_count = decode_keys(bytes, (size_t)count, records, length);
+    return TRUE;
+}
+
+// conio
+static void ensure_conio_raw(void) {
+    if (!g_conio_raw && !using_sim_input() && set_raw_termios(true)) {
+        g_conio_raw = true;
+    }
+}
+
+int _kbhit(void) {
+    if (using_sim_input()) {
+        pthread_mutex_lock(&g_console_lock);
+        bool queued = g_input_count > 0;
+        pthread_mutex_unlock(&g_console_lock);
+        return queued;
+    }
+    ensure_conio_raw();
+    return stdin_readable();
+}
+
+int _getch(void) {
+    if (using_sim_input()) {
+        INPUT_RECORD record;
+        for (;;) {
+            while (!pop_record(&record)) {
+                WaitForSingleObject(&g_stdin, INFINITE);
+            }
+            if (record.EventType == KEY_EVENT && record.Event.KeyEvent.uChar.AsciiChar) {
+                return (unsigned char)record.Event.KeyEvent.uChar.AsciiChar;
+            }
+        }
+    }
+    ensure_conio_raw();
+    unsigned char c;
+    ssize_t count;
+    do {
+        count = read(0, &c, 1);
+    } while (count < 0 && errno == EINTR);
+    return count == 1 ? c : -1;
+}
+
+// Ctrl+C
+static PHANDLER_ROUTINE g_handlers[MAX_CTRL_HANDLERS];
+static int g_handler_count = 0;
+static int g_ctrl_pipe[2] = { -1, -1 };
+static pthread_once_t g_ctrl_once = PTHREAD_ONCE_INIT;
+
+static void dispatch_ctrl(DWORD ctrl_type) {
+    PHANDLER_ROUTINE handlers[MAX_CTRL_HANDLERS];
+    pthread_mutex_lock(&g_console_lock);
+    int count = g_handler_count;
+    memcpy(handlers, g_handlers, sizeof(handlers));
+    pthread_mutex_unlock(&g_console_lock);
+
+    // Most recently added first; the default handler ends the process
+    for (int i = count - 1; i >= 0; i--) {
+        if (handlers[i](ctrl_type)) return;
+    }
+    restore_termios();
+    _exit(128 + SIGINT);
+}
+
+static void* ctrl_dispatcher(void* param) {
+    (void)param;
+    unsigned char ctrl_type;
+    for (;;) {
+        ssize_t count = read(g_ctrl_pipe[0], &ctrl_type, 1);
+        if (count == 1) {
+            dispatch_ctrl(ctrl_type);
+        } else if (count < 0 && errno != EINTR) {
+            return NULL;
+        }
+    }
+}
+
+static void on_interrupt(int signal_number) {
+    unsigned char ctrl_type = signal_number == SIGINT ? CTRL_C_EVENT : CTRL_CLOSE_EVENT;
+    ssize_t ignored = write(g_ctrl_pipe[1], &ctrl_type, 1);
+    (void)ignored;
+}
+
+static void start_ctrl_dispatcher(void) {
+    if (pipe2(g_ctrl_pipe, O_CLOEXEC) != 0) return;
+    pthread_t thread;
+    pthread_attr_t attributes;
+    pthread_attr_init(&attributes);
+    pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+    pthread_create(&thread, &attributes, ctrl_dispatcher, NULL);
+    pthread_attr_destroy(&attributes);
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = on_interrupt;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+}
+
+BOOL SetConsoleCtrlHandler(PHANDLER_ROUTINE handler, BOOL add) {
+    if (!handler) {
+        SetLastError(ERROR_INVALID_PARAMETER);
+        return FALSE;
+    }
+    pthread_once(&g_ctrl_once, start_ctrl_dispatcher);
+
+    pthread_mutex_lock(&g_console_lock);
+    BOOL success = FALSE;
+    if (add && g_handler_count < MAX_CTRL_HANDLERS) {
+        g_handlers[g_handler_count++] = handler;
+        success = TRUE;
+    } else if (!add) {
+        for (int i = g_handler_count - 1; i >= 0; i--) {
+            if (g_handlers[i] == handler) {
+                memmove(&g_handlers[i], &g_handlers[i + 1], (g_handler_count - i - 1) * sizeof(PHANDLER_ROUTINE));
+                g_handler_count--;
+                success = TRUE;
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock(&g_console_lock);
+    return success;
+}
+
+void sim_send_ctrl_c(void) {
+    pthread_once(&g_ctrl_once, start_ctrl_dispatcher);
+    unsigned char ctrl_type = CTRL_C_EVENT;
+    ssize_t ignored = write(g_ctrl_pipe[1], &ctrl_type, 1);
+    (void)ignored;
+}
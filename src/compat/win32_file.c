@@ -0,0 +1,668 @@
+#include "win32_internal.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+// Files, directories, mappings, processes, job objects and the registry
+
+#define FILETIME_UNIX_EPOCH 116444736000000000ULL
+
+extern char** environ;
+
+static CompatObject* file_object(HANDLE handle, ObjectType type) {
+    CompatObject* object = (CompatObject*)handle;
+    if (!handle || handle == INVALID_HANDLE_VALUE || object->type != type) {
+        SetLastError(ERROR_INVALID_HANDLE);
+        return NULL;
+    }
+    return object;
+}
+
+static void timespec_to_filetime(const struct timespec* time, FILETIME* file_time) {
+    ULONGLONG ticks = FILETIME_UNIX_EPOCH + (ULONGLONG)time->tv_sec * 10000000ULL + (ULONGLONG)time->tv_nsec / 100;
+    file_time->dwLowDateTime = (DWORD)ticks;
+    file_time->dwHighDateTime = (DWORD)(ticks >> 32);
+}
+
+static void stat_to_attributes(const struct stat* status, DWORD* attributes, FILETIME* creation,
+                               FILETIME* access, FILETIME* write, DWORD* size_high, DWORD* size_low) {
+    *attributes = S_ISDIR(status->st_mode) ? FILE_ATTRIBUTE_DIRECTORY : FILE_ATTRIBUTE_NORMAL;
+    timespec_to_filetime(&status->st_mtim, creation);
+    timespec_to_filetime(&status->st_atim, access);
+    timespec_to_filetime(&status->st_mtim, write);
+    *size_high = (DWORD)((ULONGLONG)status->st_size >> 32);
+    *size_low = (DWORD)status->st_size;
+}
+
+// Files
+HANDLE CreateFileA(LPCSTR path, DWORD access, DWORD share_mode, SECURITY_ATTRIBUTES* attributes,
+                   DWORD disposition, DWORD flags, HANDLE template_file) {
+    (void)share_mode;
+    (void)attributes;
+    (void)flags;
+    (void)template_file;
+
+    int open_flags = O_CLOEXEC;
+    if ((access & GENERIC_READ) && (access & GENERIC_WRITE)) {
+        open_flags |= O_RDWR;
+    } else if (access & GENERIC_WRITE) {
+        open_flags |= O_WRONLY;
+    } else {
+        open_flags |= O_RDONLY;
+    }
+    switch (disposition) {
+        case CREATE_NEW: open_flags |= O_CREAT | O_EXCL; break;
+        case CREATE_ALWAYS: open_flags |= O_CREAT | O_TRUNC; break;
+        case OPEN_ALWAYS: open_flags |= O_CREAT; break;
+        case TRUNCATE_EXISTING: open_flags |= O_TRUNC; break;
+        default: break;
+    }
+
+    char* native = compat_path(path);
+    if (!native) {
+        SetLastError(ERROR_INVALID_PARAMETER);
+        return INVALID_HANDLE_VALUE;
+    }
+    int fd = open(native, open_flags, 0644);
+    int error = errno;
+    free(native);
+    if (fd < 0) {
+        compat_set_error_from_errno(error == EEXIST ? EEXIST : error);
+        if (error == EEXIST) SetLastError(ERROR_FILE_EXISTS);
+        return INVALID_HANDLE_VALUE;
+    }
+
+    CompatObject* object = compat_object_create(OBJECT_FILE);
+    if (!object) {
+        close(fd);
+        return INVALID_HANDLE_VALUE;
+    }
+    object->u.file.fd = fd;
+    return object;
+}
+
+static int handle_fd(HANDLE handle) {
+    CompatObject* object = (CompatObject*)handle;
+    if (!handle || handle == INVALID_HANDLE_VALUE) return -1;
+    switch (object->type) {
+        case OBJECT_FILE: return object->u.file.fd;
+        case OBJECT_CONSOLE_INPUT:
+        case OBJECT_CONSOLE_OUTPUT: return object->u.console.fd;
+        default: return -1;
+    }
+}
+
+BOOL ReadFile(HANDLE file, LPVOID buffer, DWORD size, LPDWORD read_count, void* overlapped) {
+    (void)overlapped;
+    int fd = handle_fd(file);
+    if (fd < 0) {
+        SetLastError(ERROR_INVALID_HANDLE);
+        return FALSE;
+    }
+    ssize_t count;
+    do {
+        count = read(fd, buffer, size);
+    } while (count < 0 && errno == EINTR);
+    if (count < 0) {
+        compat_set_error_from_errno(errno);
+        return FALSE;
+    }
+    if (read_count) *read_count = (DWORD)count;
+    return TRUE;
+}
+
+BOOL WriteFile(HANDLE file, LPCVOID buffer, DWORD size, LPDWORD written, void* overlapped) {
+    (void)overlapped;
+    CompatObject* object = (CompatObject*)file;
+    if (file && file != INVALID_HANDLE_VALUE && object->type == OBJECT_CONSOLE_OUTPUT &&
+        compat_console_write(buffer, size)) {
+        if (written) *written = size;
+        return TRUE;
+    }
+
+    int fd = handle_fd(file);
+    if (fd < 0) {
+        SetLastError(ERROR_INVALID_HANDLE);
+        return FALSE;
+    }
+    size_t total = 0;
+    while (total < size) {
+        ssize_t count = write(fd, (const char*)buffer + total, size - total);
+        if (count < 0 && errno == EINTR) continue;
+        if (count < 0) {
+            compat_set_error_from_errno(errno);
+            if (written) *written = (DWORD)total;
+            return FALSE;
+        }
+        total += (size_t)count;
+    }
+    if (written) *written = (DWORD)total;
+    return TRUE;
+}
+
+BOOL FlushFileBuffers(HANDLE file) {
+    int fd = handle_fd(file);
+    return fd >= 0 && fsync(fd) == 0;
+}
+
+BOOL GetFileSizeEx(HANDLE file, LARGE_INTEGER* size) {
+    CompatObject* object = file_object(file, OBJECT_FILE);
+    struct stat status;
+    if (!object || fstat(object->u.file.fd, &status) != 0) return FALSE;
+    size->QuadPart = (LONGLONG)status.st_size;
+    return TRUE;
+}
+
+BOOL SetFileTime(HANDLE file, const FILETIME* creation, const FILETIME* access, const FILETIME* write) {
+    (void)creation;
+    CompatObject* object = file_object(file, OBJECT_FILE);
+    if (!object) return FALSE;
+
+    struct timespec times[2];
+    const FILETIME* sources[2] = { access, write };
+    for (int i = 0; i < 2; i++) {
+        if (!sources[i]) {
+            times[i].tv_sec = 0;
+            times[i].tv_nsec = UTIME_OMIT;
+            continue;
+        }
+        ULONGLONG ticks = ((ULONGLONG)sources[i]->dwHighDateTime << 32) | sources[i]->dwLowDateTime;
+        ULONGLONG since_epoch = ticks > FILETIME_UNIX_EPOCH ? ticks - FILETIME_UNIX_EPOCH : 0;
+        times[i].tv_sec = (time_t)(since_epoch / 10000000ULL);
+        times[i].tv_nsec = (long)(since_epoch % 10000000ULL) * 100;
+    }
+    if (futimens(object->u.file.fd, times) != 0) {
+        compat_set_error_from_errno(errno);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+BOOL GetFileAttributesExA(LPCSTR path, GET_FILEEX_INFO_LEVELS level, LPVOID information) {
+    (void)level;
+    char* native = compat_path(path);
+    struct stat status;
+    int result = native ? stat(native, &status) : -1;
+    int error = errno;
+    free(native);
+    if (result != 0) {
+        compat_set_error_from_errno(error);
+        return FALSE;
+    }
+
+    WIN32_FILE_ATTRIBUTE_DATA* data = (WIN32_FILE_ATTRIBUTE_DATA*)information;
+    stat_to_attributes(&status, &data->dwFileAttributes, &data->ftCreationTime, &data->ftLastAccessTime,
+                       &data->ftLastWriteTime, &data->nFileSizeHigh, &data->nFileSizeLow);
+    return TRUE;
+}
+
+DWORD GetFileAttributesA(LPCSTR path) {
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    return GetFileAttributesExA(path, GetFileExInfoStandard, &data) ? data.dwFileAttributes : INVALID_FILE_ATTRIBUTES;
+}
+
+static BOOL path_call(LPCSTR path, int (*call)(const char*)) {
+    char* native = compat_path(path);
+    int result = native ? call(native) : -1;
+    int error = errno;
+    free(native);
+    if (result != 0) {
+        compat_set_error_from_errno(error);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static int make_directory(const char* path) {
+    return mkdir(path, 0755);
+}
+
+BOOL MoveFileExA(LPCSTR existing, LPCSTR replacement, DWORD flags) {
+    char* from = compat_path(existing);
+    char* to = compat_path(replacement);
+    int result = -1;
+    if (from && to) {
+        struct stat status;
+        if (!(flags & MOVEFILE_REPLACE_EXISTING) && stat(to, &status) == 0) {
+            errno = EEXIST;
+        } else {
+            result = rename(from, to);
+        }
+    }
+    int error = errno;
+    free(from);
+    free(to);
+    if (result != 0) {
+        compat_set_error_from_errno(error);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+BOOL DeleteFileA(LPCSTR path) {
+    return path_call(path, unlink);
+}
+
+BOOL CreateDirectoryA(LPCSTR path, SECURITY_ATTRIBUTES* attributes) {
+    (void)attributes;
+    return path_call(path, make_directory);
+}
+
+BOOL RemoveDirectoryA(LPCSTR path) {
+    return path_call(path, rmdir);
+}
+
+// Directory search: the pattern applies to the last path component
+static bool next_match(CompatObject* object, WIN32_FIND_DATAA* find_data) {
+    struct dirent* entry;
+    while ((entry = readdir(object->u.find.dir)) != NULL) {
+        if (fnmatch(object->u.find.pattern, entry->d_name, FNM_PERIOD) != 0) continue;
+
+        memset(find_data, 0, sizeof(*find_data));
+        snprintf(find_data->cFileName, sizeof(find_data->cFileName), "%s", entry->d_name);
+
+        size_t length = strlen(object->u.find.directory) + strlen(entry->d_name) + 2;
+        char* full = (char*)malloc(length);
+        struct stat status;
+        if (full) {
+            snprintf(full, length, "%s/%s", object->u.find.directory, entry->d_name);
+            if (stat(full, &status) == 0) {
+                stat_to_attributes(&status, &find_data->dwFileAttributes, &find_data->ftCreationTime,
+                                   &find_data->ftLastAccessTime, &find_data->ftLastWriteTime,
+                                   &find_data->nFileSizeHigh, &find_data->nFileSizeLow);
+            }
+            free(full);
+        }
+        return true;
+    }
+    return false;
+}
+
+HANDLE FindFirstFileA(LPCSTR pattern, WIN32_FIND_DATAA* find_data) {
+    char* native = compat_path(pattern);
+    if (!native) {
+        SetLastError(ERROR_INVALID_PARAMETER);
+        return INVALID_HANDLE_VALUE;
+    }
+
+    char* slash = strrchr(native, '/');
+    char* directory = strdup(slash ? (slash == native ? "/" : native) : ".");
+    if (directory && slash && slash != native) directory[slash - native] = '\0';
+    char* name = strdup(slash ? slash + 1 : native);
+    free(native);
+
+    CompatObject* object = compat_object_create(OBJECT_FIND);
+    DIR* dir = directory ? opendir(directory) : NULL;
+    if (!object || !dir || !name) {
+        int error = errno;
+        if (dir) closedir(dir);
+        free(object);
+        free(directory);
+        free(name);
+        compat_set_error_from_errno(error ? error : ENOMEM);
+        return INVALID_HANDLE_VALUE;
+    }
+    object->u.find.dir = dir;
+    object->u.find.directory = directory;
+    object->u.find.pattern = name;
+
+    if (!next_match(object, find_data)) {
+        CloseHandle(object);
+        SetLastError(ERROR_FILE_NOT_FOUND);
+        return INVALID_HANDLE_VALUE;
+    }
+    return object;
+}
+
+BOOL FindNextFileA(HANDLE find, WIN32_FIND_DATAA* find_data) {
+    CompatObject* object = file_object(find, OBJECT_FIND);
+    if (!object) return FALSE;
+    if (!next_match(object, find_data)) {
+        SetLastError(ERROR_NO_MORE_FILES);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+BOOL FindClose(HANDLE find) {
+    return CloseHandle(find);
+}
+
+// Read-only mappings. Views are whole-file mmap()s; their sizes are kept so
+// UnmapViewOfFile can take just the address.
+typedef struct MappedView {
+    const void* address;
+    size_t size;
+    struct MappedView* next;
+} MappedView;
+
+static MappedView* g_views = NULL;
+
+HANDLE CreateFileMappingA(HANDLE file, SECURITY_ATTRIBUTES* attributes, DWORD protect,
+                          DWORD size_high, DWORD size_low, LPCSTR name) {
+    (void)attributes;
+    (void)name;
+    CompatObject* source = file_object(file, OBJECT_FILE);
+    if (!source) return NULL;
+    if (protect != PAGE_READONLY) {
+        SetLastError(ERROR_NOT_SUPPORTED);
+        return NULL;
+    }
+
+    struct stat status;
+    if (fstat(source->u.file.fd, &status) != 0) {
+        compat_set_error_from_errno(errno);
+        return NULL;
+    }
+    size_t size = ((size_t)size_high << 32) | size_low;
+    if (size == 0) size = (size_t)status.st_size;
+    if (size == 0) {
+        SetLastError(ERROR_INVALID_PARAMETER);  // Windows cannot map an empty file either
+        return NULL;
+    }
+
+    CompatObject* object = compat_object_create(OBJECT_MAPPING);
+    if (!object) return NULL;
+    object->u.mapping.fd = fcntl(source->u.file.fd, F_DUPFD_CLOEXEC, 0);
+    object->u.mapping.size = size;
+    if (object->u.mapping.fd < 0) {
+        compat_set_error_from_errno(errno);
+        free(object);
+        return NULL;
+    }
+    return object;
+}
+
+LPVOID MapViewOfFile(HANDLE mapping, DWORD access, DWORD offset_high, DWORD offset_low, SIZE_T size) {
+    (void)access;
+    CompatObject* object = file_object(mapping, OBJECT_MAPPING);
+    if (!object) return NULL;
+
+    off_t offset = (off_t)(((ULONGLONG)offset_high << 32) | offset_low);
+    if (size == 0) size = object->u.mapping.size - (size_t)offset;
+
+    MappedView* view = (MappedView*)malloc(sizeof(MappedView));
+    void* address = view ? mmap(NULL, size, PROT_READ, MAP_SHARED, object->u.mapping.fd, offset) : MAP_FAILED;
+    if (address == MAP_FAILED) {
+        compat_set_error_from_errno(view ? errno : ENOMEM);
+        free(view);
+        return NULL;
+    }
+
+    view->address = address;
+    view->size = size;
+    pthread_mutex_lock(&g_compat_lock);
+    view->next = g_views;
+    g_views = view;
+    pthread_mutex_unlock(&g_compat_lock);
+    return address;
+}
+
+BOOL UnmapViewOfFile(LPCVOID address) {
+    pthread_mutex_lock(&g_compat_lock);
+    MappedView** link = &g_views;
+    while (*link && (*link)->address != address) {
+        link = &(*link)->next;
+    }
+    MappedView* view = *link;
+    if (view) *link = view->next;
+    pthread_mutex_unlock(&g_compat_lock);
+
+    if (!view) {
+        SetLastError(ERROR_INVALID_PARAMETER);
+        return FALSE;
+    }
+    munmap((void*)view->address, view->size);
+    free(view);
+    return TRUE;
+}
+
+// Modules
+DWORD GetModuleFileNameA(HMODULE module, LPSTR path, DWORD size) {
+    (void)module;
+    if (!path || size == 0) return 0;
+    ssize_t length = readlink("/proc/self/exe", path, size);
+    if (length < 0) {
+        compat_set_error_from_errno(errno);
+        return 0;
+    }
+    if ((DWORD)length >= size) {
+        path[size - 1] = '\0';
+        SetLastError(ERROR_INSUFFICIENT_BUFFER);
+        return size;
+    }
+    path[length] = '\0';
+    return (DWORD)length;
+}
+
+HMODULE GetModuleHandleA(LPCSTR name) {
+    static int self;
+    return name ? NULL : (HMODULE)&self;
+}
+
+// Environment blocks: NUL-separated strings ending in an empty string
+LPCH GetEnvironmentStringsA(void) {
+    size_t length = 1;
+    for (char** variable = environ; variable && *variable; variable++) {
+        length += strlen(*variable) + 1;
+    }
+    char* block = (char*)malloc(length + 1);
+    if (!block) return NULL;
+
+    size_t pos = 0;
+    for (char** variable = environ; variable && *variable; variable++) {
+        size_t size = strlen(*variable) + 1;
+        memcpy(block + pos, *variable, size);
+        pos += size;
+    }
+    block[pos++] = '\0';
+    block[pos] = '\0';
+    return block;
+}
+
+BOOL FreeEnvironmentStringsA(LPCH block) {
+    free(block);
+    return TRUE;
+}
+
+static char** environment_array(const char* block) {
+    int count = 0;
+    for (const char* p = block; *p; p += strlen(p) + 1) count++;
+    char** array = (char**)malloc((count + 1) * sizeof(char*));
+    if (!array) return NULL;
+    int i = 0;
+    for (const char* p = block; *p; p += strlen(p) + 1) array[i++] = (char*)p;
+    array[i] = NULL;
+    return array;
+}
+
+// Processes. The child leads its own process group, so a job can end
+// everything it started; CREATE_SUSPENDED holds it on a pipe until
+// ResumeThread.
+BOOL CreateProcessA(LPCSTR application, LPSTR command_line, SECURITY_ATTRIBUTES* process_attributes,
+                    SECURITY_ATTRIBUTES* thread_attributes, BOOL inherit_handles, DWORD flags,
+                    LPVOID environment, LPCSTR directory, STARTUPINFOA* startup,
+                    PROCESS_INFORMATION* information) {
+    (void)process_attributes;
+    (void)thread_attributes;
+    (void)inherit_handles;
+    (void)startup;
+
+    const char* command = command_line ? command_line : application;
+    if (!command || !information) {
+        SetLastError(ERROR_INVALID_PARAMETER);
+        return FALSE;
+    }
+
+    char** envp = environment ? environment_array((const char*)environment) : environ;
+    char* native_directory = directory ? compat_path(directory) : NULL;
+    CompatObject* process = compat_object_create(OBJECT_PROCESS);
+    CompatObject* thread = compat_object_create(OBJECT_PROCESS_THREAD);
+    int gate[2] = { -1, -1 };
+    bool suspended = (flags & CREATE_SUSPENDED) != 0;
+    if (!envp || !process || !thread || (directory && !native_directory) ||
+        (suspended && pipe2(gate, O_CLOEXEC) != 0)) {
+        if (environment) free(envp);
+        free(native_directory);
+        free(process);
+        free(thread);
+        SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+        return FALSE;
+    }
+
+    char* argv[] = { "/bin/sh", "-c", (char*)command, NULL };
+    pid_t pid = fork();
+    if (pid == 0) {
+        setpgid(0, 0);
+        if (suspended) {
+            char go;
+            close(gate[1]);
+            if (read(gate[0], &go, 1) != 1) _exit(127);
+            close(gate[0]);
+        }
+        if (native_directory && chdir(native_directory) != 0) _exit(127);
+        if (flags & DETACHED_PROCESS) {
+            int null_fd = open("/dev/null", O_RDWR);
+            if (null_fd >= 0) {
+                dup2(null_fd, 0);
+                dup2(null_fd, 1);
+                dup2(null_fd, 2);
+            }
+        }
+        execve("/bin/sh", argv, envp);
+        _exit(127);
+    }
+
+    int error = errno;
+    if (environment) free(envp);
+    free(native_directory);
+    if (suspended) close(gate[0]);
+    if (pid < 0) {
+        if (suspended) close(gate[1]);
+        free(process);
+        free(thread);
+        compat_set_error_from_errno(error);
+        return FALSE;
+    }
+    setpgid(pid, pid);  // Also from the parent, so the group exists before any kill
+
+    process->refs = 2;  // The process handle and its thread handle
+    process->u.process.pid = pid;
+    process->u.process.exit_code = STILL_ACTIVE;
+    process->u.process.resume_fd = suspended ? gate[1] : -1;
+    thread->u.process_thread.process = process;
+
+    information->hProcess = process;
+    information->hThread = thread;
+    information->dwProcessId = (DWORD)pid;
+    information->dwThreadId = (DWORD)pid;
+    return TRUE;
+}
+
+BOOL GetExitCodeProcess(HANDLE handle, LPDWORD exit_code) {
+    CompatObject* process = file_object(handle, OBJECT_PROCESS);
+    if (!process || !exit_code) return FALSE;
+    WaitForSingleObject(handle, 0);     // Reaps it if it has exited
+    pthread_mutex_lock(&g_compat_lock);
+    *exit_code = process->u.process.exit_code;
+    pthread_mutex_unlock(&g_compat_lock);
+    return TRUE;
+}
+
+BOOL TerminateProcess(HANDLE handle, UINT exit_code) {
+    CompatObject* process = file_object(handle, OBJECT_PROCESS);
+    if (!process) return FALSE;
+    pthread_mutex_lock(&g_compat_lock);
+    bool running = !process->u.process.exited;
+    if (running) process->u.process.exit_code = exit_code;
+    pthread_mutex_unlock(&g_compat_lock);
+    if (running && kill(process->u.process.pid, SIGKILL) != 0 && errno != ESRCH) {
+        compat_set_error_from_errno(errno);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+// Job objects
+HANDLE CreateJobObjectA(SECURITY_ATTRIBUTES* attributes, LPCSTR name) {
+    (void)attributes;
+    (void)name;
+    return compat_object_create(OBJECT_JOB);
+}
+
+BOOL AssignProcessToJobObject(HANDLE job, HANDLE handle) {
+    CompatObject* object = file_object(job, OBJECT_JOB);
+    CompatObject* process = object ? file_object(handle, OBJECT_PROCESS) : NULL;
+    if (!process) return FALSE;
+
+    pthread_mutex_lock(&g_compat_lock);
+    pid_t* grown = (pid_t*)realloc(object->u.job.groups, (object->u.job.count + 1) * sizeof(pid_t));
+    if (grown) {
+        object->u.job.groups = grown;
+        object->u.job.groups[object->u.job.count++] = process->u.process.pid;
+    }
+    pthread_mutex_unlock(&g_compat_lock);
+    if (!grown) SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+    return grown != NULL;
+}
+
+BOOL TerminateJobObject(HANDLE job, UINT exit_code) {
+    (void)exit_code;
+    CompatObject* object = file_object(job, OBJECT_JOB);
+    if (!object) return FALSE;
+    pthread_mutex_lock(&g_compat_lock);
+    for (int i = 0; i < object->u.job.count; i++) {
+        kill(-object->u.job.groups[i], SIGKILL);
+    }
+    pthread_mutex_unlock(&g_compat_lock);
+    return TRUE;
+}
+
+// Registry: no keys
+LSTATUS RegOpenKeyExA(HKEY key, LPCSTR sub_key, DWORD options, DWORD access, HKEY* result) {
+    (void)key;
+    (void)sub_key;
+    (void)options;
+    (void)access;
+    if (result) *result = NULL;
+    return ERROR_FILE_NOT_FOUND;
+}
+
+LSTATUS RegQueryValueExA(HKEY key, LPCSTR value_name, LPDWORD reserved, LPDWORD type, BYTE* data, LPDWORD size) {
+    (void)key;
+    (void)value_name;
+    (void)reserved;
+    (void)type;
+    (void)data;
+    (void)size;
+    return ERROR_FILE_NOT_FOUND;
+}
+
+LSTATUS RegQueryInfoKeyA(HKEY key, LPSTR class_name, LPDWORD class_size, LPDWORD reserved,
+                         LPDWORD sub_keys, LPDWORD max_sub_key, LPDWORD max_class, LPDWORD values,
+                         LPDWORD max_value_name, LPDWORD max_value, LPDWORD security, FILETIME* last_write) {
+    (void)key;
+    (void)class_name;
+    (void)class_size;
+    (void)reserved;
+    (void)sub_keys;
+    (void)max_sub_key;
+    (void)max_class;
+    (void)values;
+    (void)max_value_name;
+    (void)max_value;
+    (void)security;
+    (void)last_write;
+    return ERROR_INVALID_HANDLE;
+}
+
+LSTATUS RegCloseKey(HKEY key) {
+    (void)key;
+    return ERROR_SUCCESS;
+}
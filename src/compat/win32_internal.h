@@ -0,0 +1,132 @@
+#ifndef MOSDEF_COMPAT_WIN32_INTERNAL_H
+#define MOSDEF_COMPAT_WIN32_INTERNAL_H
+
+#include <windows.h>
+#include <dirent.h>
+#include <sys/types.h>
+
+// Kernel objects behind HANDLE. Every state change happens under
+// g_compat_lock and broadcasts g_compat_signal, which all waits sleep on.
+// Objects whose state lives outside the process (child processes, named
+// mutexes, sockets and console input) are polled on a short tick.
+
+typedef enum {
+    OBJECT_THREAD,
+    OBJECT_EVENT,
+    OBJECT_MUTEX,
+    OBJECT_PROCESS,
+    OBJECT_PROCESS_THREAD,
+    OBJECT_JOB,
+    OBJECT_FILE,
+    OBJECT_MAPPING,
+    OBJECT_FIND,
+    OBJECT_CONSOLE_INPUT,
+    OBJECT_CONSOLE_OUTPUT
+} ObjectType;
+
+typedef struct CompatObject CompatObject;
+
+struct CompatObject {
+    ObjectType type;
+    LONG refs;                  // Handles plus internal references (guarded by g_compat_lock)
+    union {
+        struct {
+            pthread_t thread;
+            LPTHREAD_START_ROUTINE start;
+            LPVOID parameter;
+            bool suspended;
+            bool finished;
+            DWORD exit_code;
+            DWORD id;
+            int priority;
+            DWORD_PTR affinity;
+        } thread;
+        struct {
+            bool manual_reset;
+            bool signaled;
+            int socket;         // WSAEventSelect source, -1 if none
+        } event;
+        struct {
+            int fd;             // flock()ed lock file shared across processes
+            int depth;
+        } mutex;
+        struct {
+            pid_t pid;
+            bool exited;
+            DWORD exit_code;
+            int resume_fd;      // Write end of the CREATE_SUSPENDED gate, -1 once resumed
+        } process;
+        struct {
+            CompatObject* process;
+        } process_thread;
+        struct {
+            pid_t* groups;
+            int count;
+        } job;
+        struct {
+            int fd;
+        } file;
+        struct {
+            int fd;
+            size_t size;
+        } mapping;
+        struct {
+            DIR* dir;
+            char* directory;
+            char* pattern;
+        } find;
+        struct {
+            int fd;
+        } console;
+    } u;
+};
+
+extern pthread_mutex_t g_compat_lock;
+extern pthread_cond_t g_compat_signal;
+
+CompatObject* compat_object_create(ObjectType type);
+void compat_object_release_locked(CompatObject* object);
+void compat_signal_locked(void);        // Broadcast after a state change
+void compat_set_error_from_errno(int error);
+
+// Converts '\' to '/' into a caller-freed copy
+char* compat_path(const char* path);
+
+// Console input for waits, and output through the simulated terminal when
+// one is installed (win32_console.c)
+bool compat_console_input_ready(void);
+bool compat_console_write(const void* data, size_t size);
+
+// Current thread's message queue, for MsgWaitForMultipleObjects
+bool compat_thread_has_messages_locked(void);
+
+// Broadcasts a message to every window (display and device changes)
+void compat_broadcast_message(UINT message, WPARAM wparam, LPARAM lparam);
+
+// Posts WM_HOTKEY to the window that registered chord + vk; false if none
+// did (win32_window.c)
+bool compat_post_hotkey(UINT chord, UINT vk);
+
+// System-wide key grabs on the X server named by DISPLAY (hotkeys_x11.c).
+// Grabbed chords arrive through compat_post_hotkey. Without X11 support or
+// a DISPLAY there is nothing to grab, and hotkeys are delivered only by
+// sim_press_hotkey.
+#ifdef MOSDEF_HAVE_X11
+bool compat_hotkey_grab(UINT chord, UINT vk);
+void compat_hotkey_ungrab(UINT chord, UINT vk);
+#else
+static inline bool compat_hotkey_grab(UINT chord, UINT vk) {
+    (void)chord;
+    (void)vk;
+    return true;
+}
+static inline void compat_hotkey_ungrab(UINT chord, UINT vk) {
+    (void)chord;
+    (void)vk;
+}
+#endif
+
+// Generic wait used by WaitFor*/MsgWaitFor*
+DWORD compat_wait(DWORD count, const HANDLE* handles, BOOL wait_all, DWORD milliseconds, bool messages);
+
+#endif // MOSDEF_COMPAT_WIN32_INTERNAL_H
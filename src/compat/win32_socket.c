@@ -0,0 +1,106 @@
+#include "win32_internal.h"
+#include <winsock2.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/time.h>
+
+#undef setsockopt
+#undef getsockopt
+#undef accept
+
+int WSAStartup(WORD version, WSADATA* data) {
+    // A peer closing mid-send reports EPIPE like WSAECONNRESET, not a signal
+    signal(SIGPIPE, SIG_IGN);
+    if (data) {
+        data->wVersion = version;
+        data->wHighVersion = version;
+    }
+    return 0;
+}
+
+int WSACleanup(void) {
+    return 0;
+}
+
+int WSAGetLastError(void) {
+    return errno == EINPROGRESS ? WSAEWOULDBLOCK : errno;
+}
+
+int closesocket(SOCKET socket) {
+    return close(socket);
+}
+
+int ioctlsocket(SOCKET socket, long command, u_long* argument) {
+    if (command != (long)FIONBIO || !argument) {
+        errno = EINVAL;
+        return SOCKET_ERROR;
+    }
+    int flags = fcntl(socket, F_GETFL, 0);
+    if (flags < 0) return SOCKET_ERROR;
+    flags = *argument ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+    return fcntl(socket, F_SETFL, flags) < 0 ? SOCKET_ERROR : 0;
+}
+
+int WSAPoll(WSAPOLLFD* fds, ULONG count, int timeout) {
+    int result;
+    do {
+        result = poll(fds, (nfds_t)count, timeout);
+    } while (result < 0 && errno == EINTR);
+    return result;
+}
+
+int compat_setsockopt(SOCKET socket, int level, int name, const void* value, socklen_t length) {
+    if (level == SOL_SOCKET && (name == SO_RCVTIMEO || name == SO_SNDTIMEO) && length == sizeof(DWORD)) {
+        DWORD milliseconds = *(const DWORD*)value;
+        struct timeval timeout = { (time_t)(milliseconds / 1000), (suseconds_t)(milliseconds % 1000) * 1000 };
+        return setsockopt(socket, level, name, &timeout, sizeof(timeout));
+    }
+    return setsockopt(socket, level, name, value, length);
+}
+
+int compat_getsockopt(SOCKET socket, int level, int name, void* value, int* length) {
+    socklen_t size = length ? (socklen_t)*length : 0;
+    int result = getsockopt(socket, level, name, value, &size);
+    if (length) *length = (int)size;
+    return result;
+}
+
+SOCKET compat_accept(SOCKET socket, struct sockaddr* address, int* length) {
+    socklen_t size = length ? (socklen_t)*length : 0;
+    SOCKET client = accept(socket, address, length ? &size : NULL);
+    if (length) *length = (int)size;
+    return client;
+}
+
+WSAEVENT WSACreateEvent(void) {
+    return CreateEventA(NULL, TRUE, FALSE, NULL);
+}
+
+BOOL WSACloseEvent(WSAEVENT event) {
+    return CloseHandle(event);
+}
+
+BOOL WSAResetEvent(WSAEVENT event) {
+    return ResetEvent(event);
+}
+
+int WSAEventSelect(SOCKET socket, WSAEVENT event, long network_events) {
+    CompatObject* object = (CompatObject*)event;
+    if (!event) {
+        // Clearing the association; the descriptor stays as it is
+        return 0;
+    }
+    if (object->type != OBJECT_EVENT) {
+        errno = EINVAL;
+        return SOCKET_ERROR;
+    }
+
+    pthread_mutex_lock(&g_compat_lock);
+    object->u.event.socket = network_events ? socket : -1;
+    compat_signal_locked();
+    pthread_mutex_unlock(&g_compat_lock);
+
+    // Winsock puts a selected socket in non-blocking mode
+    u_long non_blocking = 1;
+    return network_events ? ioctlsocket(socket, FIONBIO, &non_blocking) : 0;
+}
@@ -0,0 +1,409 @@
+#include "win32_internal.h"
+#include "sim.h"
+#include <stdlib.h>
+
+// Windows, per-thread message queues and hotkeys. A window belongs to the
+// thread that created it; posted messages go to that thread's queue and are
+// dispatched by its PeekMessageA loop. Everything is guarded by
+// g_compat_lock, which is never held while a window procedure runs.
+
+typedef struct QueuedMessage {
+    MSG message;
+    struct QueuedMessage* next;
+} QueuedMessage;
+
+typedef struct {
+    QueuedMessage* head;
+    QueuedMessage* tail;
+    bool orphaned;              // Its thread exited while it still had windows
+} MessageQueue;
+
+struct CompatWindow {
+    WNDPROC proc;
+    LONG_PTR user_data;
+    MessageQueue* queue;
+    struct CompatWindow* next;
+};
+
+typedef struct WindowClass {
+    char* name;
+    WNDPROC proc;
+    struct WindowClass* next;
+} WindowClass;
+
+typedef struct {
+    HWND hwnd;
+    int id;
+    UINT modifiers;
+    UINT vk;
+} Hotkey;
+
+#define MAX_HOTKEYS 256
+
+static _Thread_local MessageQueue* t_queue = NULL;
+static pthread_key_t g_queue_key;
+static pthread_once_t g_queue_key_once = PTHREAD_ONCE_INIT;
+static struct CompatWindow* g_windows = NULL;
+static WindowClass* g_classes = NULL;
+static Hotkey g_hotkeys[MAX_HOTKEYS];
+static int g_hotkey_count = 0;
+
+static bool queue_has_windows_locked(const MessageQueue* queue) {
+    for (struct CompatWindow* window = g_windows; window; window = window->next) {
+        if (window->queue == queue) return true;
+    }
+    return false;
+}
+
+static void free_queue_locked(MessageQueue* queue) {
+    while (queue->head) {
+        QueuedMessage* next = queue->head->next;
+        free(queue->head);
+        queue->head = next;
+    }
+    free(queue);
+}
+
+// Thread exit: the queue goes with its thread, unless windows created there
+// are still alive, in which case the last DestroyWindow frees it
+static void release_thread_queue(void* value) {
+    MessageQueue* queue = (MessageQueue*)value;
+    pthread_mutex_lock(&g_compat_lock);
+    if (queue_has_windows_locked(queue)) {
+        queue->orphaned = true;
+    } else {
+        free_queue_locked(queue);
+    }
+    pthread_mutex_unlock(&g_compat_lock);
+}
+
+static void create_queue_key(void) {
+    pthread_key_create(&g_queue_key, release_thread_queue);
+}
+
+static MessageQueue* current_queue_locked(void) {
+    if (!t_queue) {
+        pthread_once(&g_queue_key_once, create_queue_key);
+        t_queue = (MessageQueue*)calloc(1, sizeof(MessageQueue));
+        if (t_queue) pthread_setspecific(g_queue_key, t_queue);
+    }
+    return t_queue;
+}
+
+static bool window_alive_locked(HWND hwnd) {
+    for (struct CompatWindow* window = g_windows; window; window = window->next) {
+        if (window == hwnd) return true;
+    }
+    return false;
+}
+
+static bool post_locked(MessageQueue* queue, HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam) {
+    QueuedMessage* queued = queue ? (QueuedMessage*)calloc(1, sizeof(QueuedMessage)) : NULL;
+    if (!queued) {
+        SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+        return false;
+    }
+    queued->message.hwnd = hwnd;
+    queued->message.message = message;
+    queued->message.wParam = wparam;
+    queued->message.lParam = lparam;
+    queued->message.time = GetTickCount();
+    if (queue->tail) {
+        queue->tail->next = queued;
+    } else {
+        queue->head = queued;
+    }
+    queue->tail = queued;
+    compat_signal_locked();
+    return true;
+}
+
+bool compat_thread_has_messages_locked(void) {
+    return t_queue && t_queue->head;
+}
+
+ATOM RegisterClassA(const WNDCLASSA* window_class) {
+    if (!window_class || !window_class->lpszClassName || !window_class->lpfnWndProc) {
+        SetLastError(ERROR_INVALID_PARAMETER);
+        return 0;
+    }
+
+    pthread_mutex_lock(&g_compat_lock);
+    ATOM atom = 0xC000;
+    for (WindowClass* existing = g_classes; existing; existing = existing->next, atom++) {
+        if (strcmp(existing->name, window_class->lpszClassName) == 0) {
+            pthread_mutex_unlock(&g_compat_lock);
+            SetLastError(ERROR_CLASS_ALREADY_EXISTS);
+            return 0;
+        }
+    }
+    WindowClass* registered = (WindowClass*)calloc(1, sizeof(WindowClass));
+    char* name = strdup(window_class->lpszClassName);
+    if (!registered || !name) {
+        pthread_mutex_unlock(&g_compat_lock);
+        free(registered);
+        free(name);
+        SetLastError(ERROR_NOT_ENOUGH_MEMORY);
+        return 0;
+    }
+    registered->name = name;
+    registered->proc = window_class->lpfnWndProc;
+    registered->next = g_classes;
+    g_classes = registered;
+    pthread_mutex_unlock(&g_compat_lock);
+    return atom;
+}
+
+HWND CreateWindowExA(DWORD ex_style, LPCSTR class_name, LPCSTR window_name, DWORD style, int x, int y,
+                     int width, int height, HWND parent, HMENU menu, HINSTANCE instance, LPVOID param) {
+    pthread_mutex_lock(&g_compat_lock);
+    WNDPROC proc = NULL;
+    for (WindowClass* registered = g_classes; registered; registered = registered->next) {
+        if (class_name && strcmp(registered->name, class_name) == 0) {
+            proc = registered->proc;
+            break;
+        }
+    }
+    MessageQueue* queue = current_queue_locked();
+    struct CompatWindow* window = proc && queue ? (struct CompatWindow*)calloc(1, sizeof(struct CompatWindow)) : NULL;
+    pthread_mutex_unlock(&g_compat_lock);
+    if (!window) {
+        SetLastError(proc ? ERROR_NOT_ENOUGH_MEMORY : ERROR_INVALID_PARAMETER);
+        return NULL;
+    }
+    window->proc = proc;
+    window->queue = queue;
+
+    CREATESTRUCTA create;
+    memset(&create, 0, sizeof(create));
+    create.lpCreateParams = param;
+    create.hInstance = instance;
+    create.hMenu = menu;
+    create.hwndParent = parent;
+    create.x = x;
+    create.y = y;
+    create.cx = width;
+    create.cy = height;
+    create.style = (LONG)style;
+    create.lpszName = window_name;
+    create.lpszClass = class_name;
+    create.dwExStyle = ex_style;
+    if (proc(window, WM_CREATE, 0, (LPARAM)&create) == -1) {
+        free(window);
+        return NULL;
+    }
+
+    pthread_mutex_lock(&g_compat_lock);
+    window->next = g_windows;
+    g_windows = window;
+    pthread_mutex_unlock(&g_compat_lock);
+    return window;
+}
+
+BOOL DestroyWindow(HWND hwnd) {
+    pthread_mutex_lock(&g_compat_lock);
+    bool alive = window_alive_locked(hwnd);
+    pthread_mutex_unlock(&g_compat_lock);
+    if (!alive) {
+        SetLastError(ERROR_INVALID_HANDLE);
+        return FALSE;
+    }
+
+    hwnd->proc(hwnd, WM_DESTROY, 0, 0);
+
+    pthread_mutex_lock(&g_compat_lock);
+    struct CompatWindow** link = &g_windows;
+    while (*link && *link != hwnd) link = &(*link)->next;
+    if (*link) *link = hwnd->next;
+
+    // Drop its queued messages and hotkeys
+    MessageQueue* queue = hwnd->queue;
+    QueuedMessage** entry = &queue->head;
+    QueuedMessage* last = NULL;
+    while (*entry) {
+        if ((*entry)->message.hwnd == hwnd) {
+            QueuedMessage* dropped = *entry;
+            *entry = dropped->next;
+            free(dropped);
+        } else {
+            last = *entry;
+            entry = &(*entry)->next;
+        }
+    }
+    queue->tail = last;
+
+    // A thread's queue goes with its last window, unless thread messages
+    // such as WM_QUIT are still waiting for its message loop
+    if (!queue_has_windows_locked(queue)) {
+        if (queue->orphaned) {
+            free_queue_locked(queue);
+        } else if (queue == t_queue && !queue->head) {
+            pthread_setspecific(g_queue_key, NULL);
+            free_queue_locked(queue);
+            t_queue = NULL;
+        }
+    }
+
+    int kept = 0;
+    for (int i = 0; i < g_hotkey_count; i++) {
+        if (g_hotkeys[i].hwnd != hwnd) {
+            g_hotkeys[kept++] = g_hotkeys[i];
+        } else {
+            compat_hotkey_ungrab(g_hotkeys[i].modifiers, g_hotkeys[i].vk);
+        }
+    }
+    g_hotkey_count = kept;
+    pthread_mutex_unlock(&g_compat_lock);
+
+    free(hwnd);
+    return TRUE;
+}
+
+LRESULT DefWindowProcA(HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam) {
+    (void)hwnd;
+    (void)message;
+    (void)wparam;
+    (void)lparam;
+    return 0;
+}
+
+LONG_PTR GetWindowLongPtrA(HWND hwnd, int index) {
+    return hwnd && index == GWLP_USERDATA ? hwnd->user_data : 0;
+}
+
+LONG_PTR SetWindowLongPtrA(HWND hwnd, int index, LONG_PTR value) {
+    if (!hwnd || index != GWLP_USERDATA) return 0;
+    LONG_PTR previous = hwnd->user_data;
+    hwnd->user_data = value;
+    return previous;
+}
+
+BOOL PostMessageA(HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam) {
+    pthread_mutex_lock(&g_compat_lock);
+    bool posted = false;
+    if (!hwnd) {
+        posted = post_locked(current_queue_locked(), NULL, message, wparam, lparam);
+    } else if (window_alive_locked(hwnd)) {
+        posted = post_locked(hwnd->queue, hwnd, message, wparam, lparam);
+    } else {
+        SetLastError(ERROR_INVALID_HANDLE);
+    }
+    pthread_mutex_unlock(&g_compat_lock);
+    return posted;
+}
+
+void PostQuitMessage(int exit_code) {
+    pthread_mutex_lock(&g_compat_lock);
+    post_locked(current_queue_locked(), NULL, WM_QUIT, (WPARAM)exit_code, 0);
+    pthread_mutex_unlock(&g_compat_lock);
+}
+
+BOOL PeekMessageA(MSG* message, HWND hwnd, UINT filter_min, UINT filter_max, UINT remove) {
+    (void)hwnd;
+    (void)filter_min;
+    (void)filter_max;
+
+    pthread_mutex_lock(&g_compat_lock);
+    MessageQueue* queue = t_queue;
+    QueuedMessage* head = queue ? queue->head : NULL;
+    if (head) {
+        *message = head->message;
+        if (remove & PM_REMOVE) {
+            queue->head = head->next;
+            if (!queue->head) queue->tail = NULL;
+            free(head);
+        }
+    }
+    pthread_mutex_unlock(&g_compat_lock);
+    return head != NULL;
+}
+
+BOOL TranslateMessage(const MSG* message) {
+    (void)message;
+    return FALSE;
+}
+
+LRESULT DispatchMessageA(const MSG* message) {
+    if (!message->hwnd) return 0;
+    pthread_mutex_lock(&g_compat_lock);
+    bool alive = window_alive_locked(message->hwnd);
+    pthread_mutex_unlock(&g_compat_lock);
+    return alive ? message->hwnd->proc(message->hwnd, message->message, message->wParam, message->lParam) : 0;
+}
+
+DWORD MsgWaitForMultipleObjects(DWORD count, const HANDLE* handles, BOOL wait_all, DWORD milliseconds,
+                                DWORD wake_mask) {
+    (void)wake_mask;
+    pthread_mutex_lock(&g_compat_lock);
+    current_queue_locked();
+    pthread_mutex_unlock(&g_compat_lock);
+    return compat_wait(count, handles, wait_all, milliseconds, true);
+}
+
+void compat_broadcast_message(UINT message, WPARAM wparam, LPARAM lparam) {
+    pthread_mutex_lock(&g_compat_lock);
+    for (struct CompatWindow* window = g_windows; window; window = window->next) {
+        post_locked(window->queue, window, message, wparam, lparam);
+    }
+    pthread_mutex_unlock(&g_compat_lock);
+}
+
+// Hotkeys
+BOOL RegisterHotKey(HWND hwnd, int id, UINT modifiers, UINT vk) {
+    UINT chord = modifiers & ~(UINT)MOD_NOREPEAT;
+    pthread_mutex_lock(&g_compat_lock);
+    BOOL registered = FALSE;
+    bool taken = false;
+    for (int i = 0; i < g_hotkey_count; i++) {
+        taken = taken || (g_hotkeys[i].modifiers == chord && g_hotkeys[i].vk == vk);
+    }
+    if (taken) {
+        SetLastError(ERROR_HOTKEY_ALREADY_REGISTERED);
+    } else if (!window_alive_locked(hwnd) || g_hotkey_count == MAX_HOTKEYS) {
+        SetLastError(ERROR_INVALID_PARAMETER);
+    } else if (!compat_hotkey_grab(chord, vk)) {
+        // Another X client holds the chord
+        SetLastError(ERROR_HOTKEY_ALREADY_REGISTERED);
+    } else {
+        Hotkey* hotkey = &g_hotkeys[g_hotkey_count++];
+        hotkey->hwnd = hwnd;
+        hotkey->id = id;
+        hotkey->modifiers = chord;
+        hotkey->vk = vk;
+        registered = TRUE;
+    }
+    pthread_mutex_unlock(&g_compat_lock);
+    return registered;
+}
+
+BOOL UnregisterHotKey(HWND hwnd, int id) {
+    pthread_mutex_lock(&g_compat_lock);
+    BOOL found = FALSE;
+    for (int i = 0; i < g_hotkey_count; i++) {
+        if (g_hotkeys[i].hwnd == hwnd && g_hotkeys[i].id == id) {
+            compat_hotkey_ungrab(g_hotkeys[i].modifiers, g_hotkeys[i].vk);
+            g_hotkeys[i] = g_hotkeys[--g_hotkey_count];
+            found = TRUE;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_compat_lock);
+    return found;
+}
+
+bool compat_post_hotkey(UINT chord, UINT vk) {
+    pthread_mutex_lock(&g_compat_lock);
+    bool delivered = false;
+    for (int i = 0; i < g_hotkey_count && !delivered; i++) {
+        if (g_hotkeys[i].modifiers == chord && g_hotkeys[i].vk == vk) {
+            delivered = post_locked(g_hotkeys[i].hwnd->queue, g_hotkeys[i].hwnd, WM_HOTKEY,
+                                    (WPARAM)g_hotkeys[i].id, MAKELPARAM(chord, vk));
+        }
+    }
+    pthread_mutex_unlock(&g_compat_lock);
+    return delivered;
+}
+
+bool sim_press_hotkey(UINT modifiers, UINT vk) {
+    return compat_post_hotkey(modifiers & ~(UINT)MOD_NOREPEAT, vk);
+}
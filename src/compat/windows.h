@@ -0,0 +1,684 @@
+#ifndef MOSDEF_COMPAT_WINDOWS_H
+#define MOSDEF_COMPAT_WINDOWS_H
+
+// POSIX stand-in for the parts of the Win32 API MOS-DEF uses, so the library,
+// the CLI and the tests build and run on Linux. Only on the include path for
+// non-Windows builds. Threads, synchronization, files, processes, sockets and
+// windows map onto pthreads and POSIX; the display API, hotkeys and the
+// console are served by the simulated backend in sim.h.
+//
+// Types keep their LLP64 widths (DWORD and LONG are 32 bits), because file
+// formats and hashes depend on them.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <pthread.h>
+
+// Calling conventions and annotations
+#define WINAPI
+#define CALLBACK
+#define APIENTRY
+#define __stdcall
+#define __cdecl
+
+// Basic types
+typedef int BOOL;
+typedef unsigned char BYTE;
+typedef unsigned short WORD;
+typedef unsigned short USHORT;
+typedef uint32_t DWORD;
+typedef int32_t LONG;
+typedef uint32_t ULONG;
+typedef unsigned int UINT;
+typedef int INT;
+typedef int64_t LONG64;
+typedef int64_t LONGLONG;
+typedef uint64_t ULONG64;
+typedef uint64_t ULONGLONG;
+typedef uint64_t DWORD64;
+typedef uintptr_t DWORD_PTR;
+typedef uintptr_t ULONG_PTR;
+typedef uintptr_t UINT_PTR;
+typedef intptr_t LONG_PTR;
+typedef intptr_t INT_PTR;
+typedef uintptr_t SIZE_T;
+typedef char CHAR;
+typedef char* LPSTR;
+typedef const char* LPCSTR;
+typedef char* LPCH;
+typedef void* LPVOID;
+typedef const void* LPCVOID;
+typedef DWORD* LPDWORD;
+typedef LONG LSTATUS;
+typedef int errno_t;
+
+typedef void* HANDLE;
+typedef HANDLE* PHANDLE;
+typedef void* HMODULE;
+typedef void* HINSTANCE;
+typedef void* HKEY;
+typedef void* HICON;
+typedef void* HCURSOR;
+typedef void* HBRUSH;
+typedef void* HMENU;
+typedef struct CompatWindow* HWND;
+
+typedef UINT_PTR WPARAM;
+typedef LONG_PTR LPARAM;
+typedef LONG_PTR LRESULT;
+typedef WORD ATOM;
+
+#define TRUE 1
+#define FALSE 0
+
+#define MAKEWORD(low, high) ((WORD)(((BYTE)(low)) | ((WORD)((BYTE)(high))) << 8))
+#define LOWORD(value) ((WORD)((DWORD_PTR)(value) & 0xFFFF))
+#define HIWORD(value) ((WORD)(((DWORD_PTR)(value) >> 16) & 0xFFFF))
+#define MAKELPARAM(low, high) ((LPARAM)(DWORD)(((WORD)(low)) | ((DWORD)((WORD)(high))) << 16))
+
+typedef union {
+    struct {
+        DWORD LowPart;
+        LONG HighPart;
+    } u;
+    LONGLONG QuadPart;
+} LARGE_INTEGER;
+
+typedef struct {
+    DWORD dwLowDateTime;
+    DWORD dwHighDateTime;
+} FILETIME;
+
+typedef struct {
+    WORD wYear;
+    WORD wMonth;
+    WORD wDayOfWeek;
+    WORD wDay;
+    WORD wHour;
+    WORD wMinute;
+    WORD wSecond;
+    WORD wMilliseconds;
+} SYSTEMTIME;
+
+typedef struct {
+    LONG x;
+    LONG y;
+} POINT, POINTL;
+
+typedef struct {
+    LONG nLength;
+    LPVOID lpSecurityDescriptor;
+    BOOL bInheritHandle;
+} SECURITY_ATTRIBUTES;
+
+// Limits and sentinels
+#define MAX_PATH 260
+#define INFINITE 0xFFFFFFFFu
+#define INVALID_HANDLE_VALUE ((HANDLE)(intptr_t)-1)
+
+// Error codes (GetLastError)
+#define ERROR_SUCCESS 0L
+#define ERROR_FILE_NOT_FOUND 2L
+#define ERROR_PATH_NOT_FOUND 3L
+#define ERROR_ACCESS_DENIED 5L
+#define ERROR_INVALID_HANDLE 6L
+#define ERROR_NOT_ENOUGH_MEMORY 8L
+#define ERROR_NO_MORE_FILES 18L
+#define ERROR_FILE_EXISTS 80L
+#define ERROR_INVALID_PARAMETER 87L
+#define ERROR_INSUFFICIENT_BUFFER 122L
+#define ERROR_ALREADY_EXISTS 183L
+#define ERROR_NOT_SUPPORTED 50L
+#define ERROR_HOTKEY_ALREADY_REGISTERED 1409L
+#define ERROR_CLASS_ALREADY_EXISTS 1410L
+#define ERROR_TIMEOUT 1460L
+
+DWORD GetLastError(void);
+void SetLastError(DWORD error);
+
+// CRT extensions
+#define _TRUNCATE ((size_t)-1)
+#define _strdup strdup
+#define _stricmp strcasecmp
+#define _strnicmp strncasecmp
+
+int sprintf_s(char* buffer, size_t size, const char* format, ...);
+errno_t strcpy_s(char* destination, size_t size, const char* source);
+errno_t strcat_s(char* destination, size_t size, const char* source);
+errno_t strncpy_s(char* destination, size_t size, const char* source, size_t count);
+char* strtok_s(char* str, const char* delimiters, char** context);
+errno_t fopen_s(FILE** file, const char* path, const char* mode);
+errno_t _dupenv_s(char** buffer, size_t* length, const char* name);
+void* _aligned_malloc(size_t size, size_t alignment);
+void _aligned_free(void* ptr);
+errno_t rand_s(unsigned int* value);   // Kernel CSPRNG, like RtlGenRandom
+
+// Not elided even when the memory is never read again
+static inline LPVOID SecureZeroMemory(LPVOID destination, SIZE_T length) {
+    explicit_bzero(destination, length);
+    return destination;
+}
+
+// Interlocked operations (sequentially consistent, like their Win32 namesakes)
+static inline LONG InterlockedIncrement(volatile LONG* target) {
+    return __atomic_add_fetch(target, 1, __ATOMIC_SEQ_CST);
+}
+static inline LONG InterlockedDecrement(volatile LONG* target) {
+    return __atomic_sub_fetch(target, 1, __ATOMIC_SEQ_CST);
+}
+static inline LONG InterlockedExchange(volatile LONG* target, LONG value) {
+    return __atomic_exchange_n(target, value, __ATOMIC_SEQ_CST);
+}
+static inline LONG InterlockedExchangeAdd(volatile LONG* target, LONG value) {
+    return __atomic_fetch_add(target, value, __ATOMIC_SEQ_CST);
+}
+static inline LONG InterlockedCompareExchange(volatile LONG* target, LONG exchange, LONG comparand) {
+    __atomic_compare_exchange_n(target, &comparand, exchange, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return comparand;
+}
+static inline LONG64 InterlockedIncrement64(volatile LONG64* target) {
+    return __atomic_add_fetch(target, 1, __ATOMIC_SEQ_CST);
+}
+static inline LONG64 InterlockedDecrement64(volatile LONG64* target) {
+    return __atomic_sub_fetch(target, 1, __ATOMIC_SEQ_CST);
+}
+static inline LONG64 InterlockedExchange64(volatile LONG64* target, LONG64 value) {
+    return __atomic_exchange_n(target, value, __ATOMIC_SEQ_CST);
+}
+static inline LONG64 InterlockedExchangeAdd64(volatile LONG64* target, LONG64 value) {
+    return __atomic_fetch_add(target, value, __ATOMIC_SEQ_CST);
+}
+static inline LONG64 InterlockedAdd64(volatile LONG64* target, LONG64 value) {
+    return __atomic_add_fetch(target, value, __ATOMIC_SEQ_CST);
+}
+static inline LONG64 InterlockedCompareExchange64(volatile LONG64* target, LONG64 exchange, LONG64 comparand) {
+    __atomic_compare_exchange_n(target, &comparand, exchange, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    return comparand;
+}
+static inline LONG ReadNoFence(const volatile LONG* source) {
+    return __atomic_load_n(source, __ATOMIC_RELAXED);
+}
+static inline LONG64 ReadNoFence64(const volatile LONG64* source) {
+    return __atomic_load_n(source, __ATOMIC_RELAXED);
+}
+static inline LONG ReadAcquire(const volatile LONG* source) {
+    return __atomic_load_n(source, __ATOMIC_ACQUIRE);
+}
+static inline LONG64 ReadAcquire64(const volatile LONG64* source) {
+    return __atomic_load_n(source, __ATOMIC_ACQUIRE);
+}
+static inline void WriteNoFence64(volatile LONG64* destination, LONG64 value) {
+    __atomic_store_n(destination, value, __ATOMIC_RELAXED);
+}
+static inline void WriteRelease64(volatile LONG64* destination, LONG64 value) {
+    __atomic_store_n(destination, value, __ATOMIC_RELEASE);
+}
+#define MemoryBarrier() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#if defined(__x86_64__) || defined(__i386__)
+#define YieldProcessor() __builtin_ia32_pause()
+#else
+#define YieldProcessor() ((void)0)
+#endif
+
+// Processor features
+#define PF_XMMI64_INSTRUCTIONS_AVAILABLE 10
+#define PF_AVX2_INSTRUCTIONS_AVAILABLE 40
+BOOL IsProcessorFeaturePresent(DWORD feature);
+
+// Critical sections are recursive, as on Windows
+typedef struct {
+    pthread_mutex_t mutex;
+} CRITICAL_SECTION;
+
+void InitializeCriticalSection(CRITICAL_SECTION* section);
+void EnterCriticalSection(CRITICAL_SECTION* section);
+BOOL TryEnterCriticalSection(CRITICAL_SECTION* section);
+void LeaveCriticalSection(CRITICAL_SECTION* section);
+void DeleteCriticalSection(CRITICAL_SECTION* section);
+
+// Slim reader/writer locks
+typedef pthread_rwlock_t SRWLOCK;
+#define SRWLOCK_INIT PTHREAD_RWLOCK_INITIALIZER
+
+void InitializeSRWLock(SRWLOCK* lock);
+void AcquireSRWLockExclusive(SRWLOCK* lock);
+void ReleaseSRWLockExclusive(SRWLOCK* lock);
+void AcquireSRWLockShared(SRWLOCK* lock);
+void ReleaseSRWLockShared(SRWLOCK* lock);
+
+// Condition variables. The wait takes the variable's own mutex before it
+// releases the caller's lock, so a wake between the two is not lost.
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    unsigned long sequence;
+} CONDITION_VARIABLE;
+#define CONDITION_VARIABLE_INIT { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0 }
+#define CONDITION_VARIABLE_LOCKMODE_SHARED 0x1
+
+void InitializeConditionVariable(CONDITION_VARIABLE* variable);
+BOOL SleepConditionVariableCS(CONDITION_VARIABLE* variable, CRITICAL_SECTION* section, DWORD milliseconds);
+BOOL SleepConditionVariableSRW(CONDITION_VARIABLE* variable, SRWLOCK* lock, DWORD milliseconds, ULONG flags);
+void WakeConditionVariable(CONDITION_VARIABLE* variable);
+void WakeAllConditionVariable(CONDITION_VARIABLE* variable);
+
+// Threads
+typedef DWORD (WINAPI *LPTHREAD_START_ROUTINE)(LPVOID parameter);
+
+#define CREATE_SUSPENDED 0x00000004
+#define THREAD_PRIORITY_LOWEST (-2)
+#define THREAD_PRIORITY_BELOW_NORMAL (-1)
+#define THREAD_PRIORITY_NORMAL 0
+#define THREAD_PRIORITY_ABOVE_NORMAL 1
+#define THREAD_PRIORITY_HIGHEST 2
+#define THREAD_PRIORITY_TIME_CRITICAL 15
+#define STILL_ACTIVE 259
+
+HANDLE CreateThread(SECURITY_ATTRIBUTES* attributes, SIZE_T stack_size, LPTHREAD_START_ROUTINE start,
+                    LPVOID parameter, DWORD flags, LPDWORD thread_id);
+DWORD ResumeThread(HANDLE thread);
+BOOL SetThreadPriority(HANDLE thread, int priority);
+int GetThreadPriority(HANDLE thread);
+DWORD_PTR SetThreadAffinityMask(HANDLE thread, DWORD_PTR mask);
+BOOL GetExitCodeThread(HANDLE thread, LPDWORD exit_code);
+DWORD GetCurrentThreadId(void);
+DWORD GetCurrentProcessId(void);
+void Sleep(DWORD milliseconds);
+
+// Waitable objects
+#define WAIT_OBJECT_0 0x00000000u
+#define WAIT_ABANDONED 0x00000080u
+#define WAIT_TIMEOUT 0x00000102u
+#define WAIT_FAILED 0xFFFFFFFFu
+#define MAXIMUM_WAIT_OBJECTS 64
+
+HANDLE CreateEventA(SECURITY_ATTRIBUTES* attributes, BOOL manual_reset, BOOL initial_state, LPCSTR name);
+BOOL SetEvent(HANDLE event);
+BOOL ResetEvent(HANDLE event);
+HANDLE CreateMutexA(SECURITY_ATTRIBUTES* attributes, BOOL initial_owner, LPCSTR name);
+BOOL ReleaseMutex(HANDLE mutex);
+BOOL CloseHandle(HANDLE handle);
+DWORD WaitForSingleObject(HANDLE handle, DWORD milliseconds);
+DWORD WaitForMultipleObjects(DWORD count, const HANDLE* handles, BOOL wait_all, DWORD milliseconds);
+
+// Time
+DWORD GetTickCount(void);
+ULONGLONG GetTickCount64(void);
+BOOL QueryPerformanceCounter(LARGE_INTEGER* counter);
+BOOL QueryPerformanceFrequency(LARGE_INTEGER* frequency);
+void GetSystemTimeAsFileTime(FILETIME* time);
+void GetSystemTime(SYSTEMTIME* time);
+void GetLocalTime(SYSTEMTIME* time);
+BOOL FileTimeToSystemTime(const FILETIME* file_time, SYSTEMTIME* system_time);
+BOOL SystemTimeToFileTime(const SYSTEMTIME* system_time, FILETIME* file_time);
+BOOL FileTimeToLocalFileTime(const FILETIME* file_time, FILETIME* local_time);
+BOOL TzSpecificLocalTimeToSystemTime(const void* time_zone, const SYSTEMTIME* local_time, SYSTEMTIME* system_time);
+LONG CompareFileTime(const FILETIME* first, const FILETIME* second);
+
+// Files. Paths may use either separator; backslashes are converted.
+#define GENERIC_READ 0x80000000u
+#define GENERIC_WRITE 0x40000000u
+#define FILE_WRITE_ATTRIBUTES 0x0100
+#define FILE_SHARE_READ 0x00000001
+#define FILE_SHARE_WRITE 0x00000002
+#define FILE_SHARE_DELETE 0x00000004
+#define CREATE_NEW 1
+#define CREATE_ALWAYS 2
+#define OPEN_EXISTING 3
+#define OPEN_ALWAYS 4
+#define TRUNCATE_EXISTING 5
+#define FILE_ATTRIBUTE_READONLY 0x00000001
+#define FILE_ATTRIBUTE_DIRECTORY 0x00000010
+#define FILE_ATTRIBUTE_NORMAL 0x00000080
+#define INVALID_FILE_ATTRIBUTES ((DWORD)-1)
+#define MOVEFILE_REPLACE_EXISTING 0x00000001
+#define MOVEFILE_WRITE_THROUGH 0x00000008
+#define PAGE_READONLY 0x02
+#define FILE_MAP_READ 0x0004
+
+typedef enum {
+    GetFileExInfoStandard
+} GET_FILEEX_INFO_LEVELS;
+
+typedef struct {
+    DWORD dwFileAttributes;
+    FILETIME ftCreationTime;
+    FILETIME ftLastAccessTime;
+    FILETIME ftLastWriteTime;
+    DWORD nFileSizeHigh;
+    DWORD nFileSizeLow;
+} WIN32_FILE_ATTRIBUTE_DATA;
+
+typedef struct {
+    DWORD dwFileAttributes;
+    FILETIME ftCreationTime;
+    FILETIME ftLastAccessTime;
+    FILETIME ftLastWriteTime;
+    DWORD nFileSizeHigh;
+    DWORD nFileSizeLow;
+    CHAR cFileName[MAX_PATH];
+} WIN32_FIND_DATAA;
+
+HANDLE CreateFileA(LPCSTR path, DWORD access, DWORD share_mode, SECURITY_ATTRIBUTES* attributes,
+                   DWORD disposition, DWORD flags, HANDLE template_file);
+BOOL ReadFile(HANDLE file, LPVOID buffer, DWORD size, LPDWORD read, void* overlapped);
+BOOL WriteFile(HANDLE file, LPCVOID buffer, DWORD size, LPDWORD written, void* overlapped);
+BOOL FlushFileBuffers(HANDLE file);
+BOOL GetFileSizeEx(HANDLE file, LARGE_INTEGER* size);
+BOOL SetFileTime(HANDLE file, const FILETIME* creation, const FILETIME* access, const FILETIME* write);
+BOOL GetFileAttributesExA(LPCSTR path, GET_FILEEX_INFO_LEVELS level, LPVOID information);
+DWORD GetFileAttributesA(LPCSTR path);
+BOOL MoveFileExA(LPCSTR existing, LPCSTR replacement, DWORD flags);
+BOOL DeleteFileA(LPCSTR path);
+BOOL CreateDirectoryA(LPCSTR path, SECURITY_ATTRIBUTES* attributes);
+BOOL RemoveDirectoryA(LPCSTR path);
+HANDLE FindFirstFileA(LPCSTR pattern, WIN32_FIND_DATAA* find_data);
+BOOL FindNextFileA(HANDLE find, WIN32_FIND_DATAA* find_data);
+BOOL FindClose(HANDLE find);
+HANDLE CreateFileMappingA(HANDLE file, SECURITY_ATTRIBUTES* attributes, DWORD protect,
+                          DWORD size_high, DWORD size_low, LPCSTR name);
+LPVOID MapViewOfFile(HANDLE mapping, DWORD access, DWORD offset_high, DWORD offset_low, SIZE_T size);
+BOOL UnmapViewOfFile(LPCVOID view);
+DWORD GetModuleFileNameA(HMODULE module, LPSTR path, DWORD size);
+HMODULE GetModuleHandleA(LPCSTR name);
+
+// Environment and processes. Command lines run through /bin/sh -c.
+#define CREATE_NEW_PROCESS_GROUP 0x00000200
+#define CREATE_NO_WINDOW 0x08000000
+#define DETACHED_PROCESS 0x00000008
+
+typedef struct {
+    DWORD cb;
+    LPSTR lpReserved;
+    LPSTR lpDesktop;
+    LPSTR lpTitle;
+    DWORD dwFlags;
+    WORD wShowWindow;
+    HANDLE hStdInput;
+    HANDLE hStdOutput;
+    HANDLE hStdError;
+} STARTUPINFOA;
+
+typedef struct {
+    HANDLE hProcess;
+    HANDLE hThread;
+    DWORD dwProcessId;
+    DWORD dwThreadId;
+} PROCESS_INFORMATION;
+
+LPCH GetEnvironmentStringsA(void);
+BOOL FreeEnvironmentStringsA(LPCH block);
+BOOL CreateProcessA(LPCSTR application, LPSTR command_line, SECURITY_ATTRIBUTES* process_attributes,
+                    SECURITY_ATTRIBUTES* thread_attributes, BOOL inherit_handles, DWORD flags,
+                    LPVOID environment, LPCSTR directory, STARTUPINFOA* startup,
+                    PROCESS_INFORMATION* information);
+BOOL GetExitCodeProcess(HANDLE process, LPDWORD exit_code);
+BOOL TerminateProcess(HANDLE process, UINT exit_code);
+
+// Job objects: each assigned process leads its own process group
+HANDLE CreateJobObjectA(SECURITY_ATTRIBUTES* attributes, LPCSTR name);
+BOOL AssignProcessToJobObject(HANDLE job, HANDLE process);
+BOOL TerminateJobObject(HANDLE job, UINT exit_code);
+
+// Registry (empty: EDID comes from sysfs outside Windows, see edid.c)
+#define HKEY_LOCAL_MACHINE ((HKEY)(ULONG_PTR)0x80000002)
+#define KEY_READ 0x20019
+#define KEY_QUERY_VALUE 0x0001
+#define KEY_ENUMERATE_SUB_KEYS 0x0008
+#define REG_BINARY 3
+
+LSTATUS RegOpenKeyExA(HKEY key, LPCSTR sub_key, DWORD options, DWORD access, HKEY* result);
+LSTATUS RegQueryValueExA(HKEY key, LPCSTR value_name, LPDWORD reserved, LPDWORD type, BYTE* data, LPDWORD size);
+LSTATUS RegQueryInfoKeyA(HKEY key, LPSTR class_name, LPDWORD class_size, LPDWORD reserved,
+                         LPDWORD sub_keys, LPDWORD max_sub_key, LPDWORD max_class, LPDWORD values,
+                         LPDWORD max_value_name, LPDWORD max_value, LPDWORD security, FILETIME* last_write);
+LSTATUS RegCloseKey(HKEY key);
+
+// Console (see sim.h for scripted input and a captured terminal)
+#define STD_INPUT_HANDLE ((DWORD)-10)
+#define STD_OUTPUT_HANDLE ((DWORD)-11)
+#define STD_ERROR_HANDLE ((DWORD)-12)
+#define ENABLE_PROCESSED_INPUT 0x0001
+#define ENABLE_LINE_INPUT 0x0002
+#define ENABLE_ECHO_INPUT 0x0004
+#define ENABLE_WINDOW_INPUT 0x0008
+#define ENABLE_PROCESSED_OUTPUT 0x0001
+#define ENABLE_VIRTUAL_TERMINAL_PROCESSING 0x0004
+#define KEY_EVENT 0x0001
+#define WINDOW_BUFFER_SIZE_EVENT 0x0004
+#define CTRL_C_EVENT 0
+#define CTRL_BREAK_EVENT 1
+#define CTRL_CLOSE_EVENT 2
+
+typedef struct {
+    short X;
+    short Y;
+} COORD;
+
+typedef struct {
+    short Left;
+    short Top;
+    short Right;
+    short Bottom;
+} SMALL_RECT;
+
+typedef struct {
+    COORD dwSize;
+    COORD dwCursorPosition;
+    WORD wAttributes;
+    SMALL_RECT srWindow;
+    COORD dwMaximumWindowSize;
+} CONSOLE_SCREEN_BUFFER_INFO;
+
+typedef struct {
+    BOOL bKeyDown;
+    WORD wRepeatCount;
+    WORD wVirtualKeyCode;
+    WORD wVirtualScanCode;
+    union {
+        char AsciiChar;
+    } uChar;
+    DWORD dwControlKeyState;
+} KEY_EVENT_RECORD;
+
+typedef struct {
+    COORD dwSize;
+} WINDOW_BUFFER_SIZE_RECORD;
+
+typedef struct {
+    WORD EventType;
+    union {
+        KEY_EVENT_RECORD KeyEvent;
+        WINDOW_BUFFER_SIZE_RECORD WindowBufferSizeEvent;
+    } Event;
+} INPUT_RECORD;
+
+typedef BOOL (WINAPI *PHANDLER_ROUTINE)(DWORD ctrl_type);
+
+HANDLE GetStdHandle(DWORD which);
+BOOL GetConsoleMode(HANDLE console, LPDWORD mode);
+BOOL SetConsoleMode(HANDLE console, DWORD mode);
+BOOL GetConsoleScreenBufferInfo(HANDLE console, CONSOLE_SCREEN_BUFFER_INFO* info);
+BOOL ReadConsoleInputA(HANDLE console, INPUT_RECORD* records, DWORD length, LPDWORD read);
+BOOL SetConsoleCtrlHandler(PHANDLER_ROUTINE handler, BOOL add);
+
+// Windows and messages. Messages are queued per thread, as on Windows.
+#define WM_CREATE 0x0001
+#define WM_DESTROY 0x0002
+#define WM_CLOSE 0x0010
+#define WM_QUIT 0x0012
+#define WM_DISPLAYCHANGE 0x007E
+#define WM_HOTKEY 0x0312
+#define WM_DEVICECHANGE 0x0219
+#define WM_USER 0x0400
+#define PM_NOREMOVE 0x0000
+#define PM_REMOVE 0x0001
+#define QS_ALLINPUT 0x04FF
+#define GWLP_USERDATA (-21)
+#define HWND_MESSAGE ((HWND)(intptr_t)-3)
+
+typedef LRESULT (CALLBACK *WNDPROC)(HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam);
+
+typedef struct {
+    UINT style;
+    WNDPROC lpfnWndProc;
+    int cbClsExtra;
+    int cbWndExtra;
+    HINSTANCE hInstance;
+    HICON hIcon;
+    HCURSOR hCursor;
+    HBRUSH hbrBackground;
+    LPCSTR lpszMenuName;
+    LPCSTR lpszClassName;
+} WNDCLASSA;
+
+typedef struct {
+    LPVOID lpCreateParams;
+    HINSTANCE hInstance;
+    HMENU hMenu;
+    HWND hwndParent;
+    int cy;
+    int cx;
+    int y;
+    int x;
+    LONG style;
+    LPCSTR lpszName;
+    LPCSTR lpszClass;
+    DWORD dwExStyle;
+} CREATESTRUCTA;
+
+typedef struct {
+    HWND hwnd;
+    UINT message;
+    WPARAM wParam;
+    LPARAM lParam;
+    DWORD time;
+    POINT pt;
+} MSG;
+
+ATOM RegisterClassA(const WNDCLASSA* window_class);
+HWND CreateWindowExA(DWORD ex_style, LPCSTR class_name, LPCSTR window_name, DWORD style, int x, int y,
+                     int width, int height, HWND parent, HMENU menu, HINSTANCE instance, LPVOID param);
+BOOL DestroyWindow(HWND hwnd);
+LRESULT DefWindowProcA(HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam);
+LONG_PTR GetWindowLongPtrA(HWND hwnd, int index);
+LONG_PTR SetWindowLongPtrA(HWND hwnd, int index, LONG_PTR value);
+BOOL PostMessageA(HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam);
+void PostQuitMessage(int exit_code);
+BOOL PeekMessageA(MSG* message, HWND hwnd, UINT filter_min, UINT filter_max, UINT remove);
+BOOL TranslateMessage(const MSG* message);
+LRESULT DispatchMessageA(const MSG* message);
+DWORD MsgWaitForMultipleObjects(DWORD count, const HANDLE* handles, BOOL wait_all, DWORD milliseconds,
+                                DWORD wake_mask);
+
+// Hotkeys
+#define MOD_ALT 0x0001
+#define MOD_CONTROL 0x0002
+#define MOD_SHIFT 0x0004
+#define MOD_WIN 0x0008
+#define MOD_NOREPEAT 0x4000
+
+BOOL RegisterHotKey(HWND hwnd, int id, UINT modifiers, UINT vk);
+BOOL UnregisterHotKey(HWND hwnd, int id);
+
+// Virtual key codes
+#define VK_BACK 0x08
+#define VK_TAB 0x09
+#define VK_RETURN 0x0D
+#define VK_PAUSE 0x13
+#define VK_ESCAPE 0x1B
+#define VK_SPACE 0x20
+#define VK_PRIOR 0x21
+#define VK_NEXT 0x22
+#define VK_END 0x23
+#define VK_HOME 0x24
+#define VK_LEFT 0x25
+#define VK_UP 0x26
+#define VK_RIGHT 0x27
+#define VK_DOWN 0x28
+#define VK_SNAPSHOT 0x2C
+#define VK_INSERT 0x2D
+#define VK_DELETE 0x2E
+#define VK_F1 0x70
+#define VK_F24 0x87
+
+// Display settings
+#define CCHDEVICENAME 32
+#define CCHFORMNAME 32
+#define ENUM_CURRENT_SETTINGS ((DWORD)-1)
+#define ENUM_REGISTRY_SETTINGS ((DWORD)-2)
+#define EDD_GET_DEVICE_INTERFACE_NAME 0x00000001
+
+#define DISPLAY_DEVICE_ATTACHED_TO_DESKTOP 0x00000001
+#define DISPLAY_DEVICE_ACTIVE 0x00000001
+#define DISPLAY_DEVICE_PRIMARY_DEVICE 0x00000004
+#define DISPLAY_DEVICE_MIRRORING_DRIVER 0x00000008
+
+#define DM_POSITION 0x00000020
+#define DM_DISPLAYORIENTATION 0x00000080
+#define DM_BITSPERPEL 0x00040000
+#define DM_PELSWIDTH 0x00080000
+#define DM_PELSHEIGHT 0x00100000
+#define DM_DISPLAYFREQUENCY 0x00400000
+
+#define DMDO_DEFAULT 0
+#define DMDO_90 1
+#define DMDO_180 2
+#define DMDO_270 3
+
+#define CDS_UPDATEREGISTRY 0x00000001
+#define CDS_TEST 0x00000002
+#define CDS_GLOBAL 0x00000008
+#define CDS_NORESET 0x10000000
+
+#define DISP_CHANGE_SUCCESSFUL 0
+#define DISP_CHANGE_RESTART 1
+#define DISP_CHANGE_FAILED (-1)
+#define DISP_CHANGE_BADMODE (-2)
+#define DISP_CHANGE_NOTUPDATED (-3)
+#define DISP_CHANGE_BADFLAGS (-4)
+#define DISP_CHANGE_BADPARAM (-5)
+#define DISP_CHANGE_BADDUALVIEW (-6)
+
+typedef struct {
+    DWORD cb;
+    CHAR DeviceName[32];
+    CHAR DeviceString[128];
+    DWORD StateFlags;
+    CHAR DeviceID[128];
+    CHAR DeviceKey[128];
+} DISPLAY_DEVICEA;
+
+typedef struct {
+    BYTE dmDeviceName[CCHDEVICENAME];
+    WORD dmSpecVersion;
+    WORD dmDriverVersion;
+    WORD dmSize;
+    WORD dmDriverExtra;
+    DWORD dmFields;
+    POINTL dmPosition;
+    DWORD dmDisplayOrientation;
+    DWORD dmDisplayFixedOutput;
+    short dmColor;
+    short dmDuplex;
+    short dmYResolution;
+    short dmTTOption;
+    short dmCollate;
+    BYTE dmFormName[CCHFORMNAME];
+    WORD dmLogPixels;
+    DWORD dmBitsPerPel;
+    DWORD dmPelsWidth;
+    DWORD dmPelsHeight;
+    DWORD dmDisplayFlags;
+    DWORD dmDisplayFrequency;
+} DEVMODEA;
+
+BOOL EnumDisplayDevicesA(LPCSTR device, DWORD index, DISPLAY_DEVICEA* display_device, DWORD flags);
+BOOL EnumDisplaySettingsExA(LPCSTR device, DWORD mode, DEVMODEA* devmode, DWORD flags);
+LONG ChangeDisplaySettingsExA(LPCSTR device, DEVMODEA* devmode, HWND hwnd, DWORD flags, LPVOID param);
+
+#endif // MOSDEF_COMPAT_WINDOWS_H
@@ -0,0 +1,68 @@
+#ifndef MOSDEF_COMPAT_WINSOCK2_H
+#define MOSDEF_COMPAT_WINSOCK2_H
+
+// Winsock on BSD sockets (see windows.h). SOCKET is a file descriptor and
+// WSAGetLastError() reads errno, with EINPROGRESS reported as WSAEWOULDBLOCK
+// like a non-blocking connect on Windows.
+
+#include <windows.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+typedef int SOCKET;
+typedef unsigned long u_long;
+typedef struct sockaddr SOCKADDR;
+typedef struct sockaddr_in SOCKADDR_IN;
+typedef struct sockaddr_storage SOCKADDR_STORAGE;
+typedef struct pollfd WSAPOLLFD;
+typedef HANDLE WSAEVENT;
+
+#define INVALID_SOCKET (-1)
+#define SOCKET_ERROR (-1)
+#define SD_RECEIVE SHUT_RD
+#define SD_SEND SHUT_WR
+#define SD_BOTH SHUT_RDWR
+#define WSAEWOULDBLOCK EWOULDBLOCK
+#define WSAEINTR EINTR
+#define WSAECONNRESET ECONNRESET
+#define WSAETIMEDOUT ETIMEDOUT
+#define WSA_INVALID_EVENT ((WSAEVENT)NULL)
+#define FD_READ 0x01
+#define FD_ACCEPT 0x08
+#define FD_CLOSE 0x20
+
+typedef struct {
+    WORD wVersion;
+    WORD wHighVersion;
+} WSADATA;
+
+int WSAStartup(WORD version, WSADATA* data);
+int WSACleanup(void);
+int WSAGetLastError(void);
+int closesocket(SOCKET socket);
+int ioctlsocket(SOCKET socket, long command, u_long* argument);
+int WSAPoll(WSAPOLLFD* fds, ULONG count, int timeout);
+
+// Winsock takes SO_RCVTIMEO and SO_SNDTIMEO as a DWORD of milliseconds
+int compat_setsockopt(SOCKET socket, int level, int name, const void* value, socklen_t length);
+#define setsockopt compat_setsockopt
+
+// Winsock option and address lengths are int
+int compat_getsockopt(SOCKET socket, int level, int name, void* value, int* length);
+SOCKET compat_accept(SOCKET socket, struct sockaddr* address, int* length);
+#define getsockopt compat_getsockopt
+#define accept compat_accept
+
+// Event selection: the event is signaled while the socket has input
+WSAEVENT WSACreateEvent(void);
+BOOL WSACloseEvent(WSAEVENT event);
+BOOL WSAResetEvent(WSAEVENT event);
+int WSAEventSelect(SOCKET socket, WSAEVENT event, long network_events);
+
+#endif // MOSDEF_COMPAT_WINSOCK2_H
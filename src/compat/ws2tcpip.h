@@ -0,0 +1,9 @@
+#ifndef MOSDEF_COMPAT_WS2TCPIP_H
+#define MOSDEF_COMPAT_WS2TCPIP_H
+
+#include <winsock2.h>
+#include <netdb.h>
+
+typedef struct addrinfo ADDRINFOA;
+
+#endif // MOSDEF_COMPAT_WS2TCPIP_H
@@ -0,0 +1,440 @@
+#include "complete.h"
+#include "config.h"
+#include "enum.h"
+#include "topofile.h"
+#include "util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define COMPLETION_CACHE_FILE "completion.json"
+#define COMPLETION_CACHE_TTL_SECONDS 30
+#define FILETIME_TICKS_PER_SECOND 10000000ULL
+
+typedef enum {
+    VALUE_NONE,
+    VALUE_SELECTOR,
+    VALUE_SELECTOR_LIST,
+    VALUE_DEVICE,       // history --device: M#, device:"..." or edid:...
+    VALUE_FILE,
+    VALUE_TEXT
+} ValueKind;
+
+typedef struct {
+    const char* name;
+    ValueKind value;
+} FlagSpec;
+
+// The flags parse_args() accepts; keep the two in step
+static const FlagSpec g_global_flags[] = {
+    { "--dry-run", VALUE_NONE },
+    { "--verbose", VALUE_NONE },
+    { "--no-confirm", VALUE_NONE },
+    { "--force-rdp", VALUE_NONE },
+    { "--no-plan-cache", VALUE_NONE },
+    { "--apply-thread", VALUE_NONE },
+    { "--apply-affinity", VALUE_TEXT },
+    { "--version", VALUE_NONE },
+    { "--help", VALUE_NONE },
+    { "-h", VALUE_NONE },
+    { "--topology", VALUE_FILE },
+    { "--revert-seconds", VALUE_TEXT },
+};
+
+static const FlagSpec g_command_flags[] = {
+    { "--only", VALUE_SELECTOR },
+    { "--include", VALUE_SELECTOR_LIST },
+    { "--exclude", VALUE_SELECTOR_LIST },
+    { "--save-default", VALUE_SELECTOR },
+    { "--clear-default", VALUE_NONE },
+    { "--export", VALUE_FILE },
+    { "--since", VALUE_TEXT },
+    { "--device", VALUE_DEVICE },
+    { "--listen", VALUE_TEXT },
+    { "--key", VALUE_FILE },
+    { "--parallel", VALUE_TEXT },
+    { "--deadline", VALUE_TEXT },
+    { "--stages", VALUE_TEXT },
+    { "--max-failure-rate", VALUE_TEXT },
+    { "-o", VALUE_FILE },
+    { "--output", VALUE_FILE },
+};
+
+#define ROTATION_FLAGS "--only --include --exclude --save-default --clear-default"
+
+// parse_args() takes any command flag after any command; completion only
+// offers the ones each command uses
+typedef struct {
+    const char* name;
+    const char* flags;          // Space-separated g_command_flags names
+    const char* operands;       // Words for the first positional; NULL for a file or none
+} CommandSpec;
+
+static const CommandSpec g_commands[] = {
+    { "list", "--export", NULL },
+    { "landscape", ROTATION_FLAGS, NULL },
+    { "portrait", ROTATION_FLAGS, NULL },
+    { "toggle", ROTATION_FLAGS, NULL },
+    { "plan", "--only --include --exclude -o --output", "landscape portrait toggle" },
+    { "apply", "", NULL },
+    { "snapshot", "", "list save restore undo" },
+    { "diff", "", NULL },
+    { "history", "--since --device", NULL },
+    { "agent", "--listen --key", NULL },
+    { "fleet", "--parallel --deadline --stages --max-failure-rate --key", NULL },
+    { "hotkeys", "", NULL },
+    { "watch", "", NULL },
+    { "top", "", NULL },
+};
+
+#define COUNT_OF(array) ((int)(sizeof(array) / sizeof((array)[0])))
+
+static const FlagSpec* find_flag(const FlagSpec* flags, int count, const char* name) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(flags[i].name, name) == 0) return &flags[i];
+    }
+    return NULL;
+}
+
+static const CommandSpec* find_command(const char* name) {
+    for (int i = 0; i < COUNT_OF(g_commands); i++) {
+        if (strcmp(g_commands[i].name, name) == 0) return &g_commands[i];
+    }
+    return NULL;
+}
+
+// Candidate output: prefix-filtered (case-insensitive, like selector
+// matching) and de-duplicated, since many monitors share a name or model
+typedef struct {
+    const char* lead;           // Printed before each candidate, e.g. "M1," inside a list
+    const char* prefix;
+    size_t prefix_length;
+    ULONG64* seen;
+    size_t seen_mask;
+} Completer;
+
+static bool completer_init(Completer* completer, const char* lead, const char* prefix, int expected) {
+    size_t capacity = 64;
+    while (capacity < (size_t)expected * 2) {
+        capacity *= 2;
+    }
+
+    completer->lead = lead;
+    completer->prefix = prefix;
+    completer->prefix_length = strlen(prefix);
+    completer->seen = (ULONG64*)calloc(capacity, sizeof(ULONG64));
+    completer->seen_mask = capacity - 1;
+    return completer->seen != NULL;
+}
+
+static void emit(Completer* completer, const char* candidate) {
+    if (!candidate || !candidate[0]) return;
+    if (_strnicmp(candidate, completer->prefix, completer->prefix_length) != 0) return;
+
+    // Zero marks an empty slot; the table never fills (see completer_init)
+    ULONG64 hash = hash_bytes(HASH_SEED, candidate, strlen(candidate)) | 1;
+    size_t slot = (size_t)hash & completer->seen_mask;
+    while (completer->seen[slot]) {
+        if (completer->seen[slot] == hash) return;
+        slot = (slot + 1) & completer->seen_mask;
+    }
+    completer->seen[slot] = hash;
+
+    printf("%s%s\n", completer->lead, candidate);
+}
+
+static void emit_words(Completer* completer, const char* words) {
+    char word[64];
+    while (*words) {
+        size_t length = strcspn(words, " ");
+        if (length > 0 && length < sizeof(word)) {
+            memcpy(word, words, length);
+            word[length] = '\0';
+            emit(completer, word);
+        }
+        words += length;
+        while (*words == ' ') {
+            words++;
+        }
+    }
+}
+
+static void emit_quoted(Completer* completer, const char* kind, const char* value) {
+    if (!value || !value[0]) return;
+
+    char candidate[512];
+    if (sprintf_s(candidate, sizeof(candidate), "%s:\"%s\"", kind, value) > 0) {
+        emit(completer, candidate);
+    }
+}
+
+static void emit_selectors(Completer* completer, const MonitorList* monitors, const ConfigMap* groups,
+                           bool devices_only) {
+    char candidate[512];
+    for (int i = 0; monitors && i < monitors->count; i++) {
+        const MonitorInfo* monitor = &monitors->monitors[i];
+        emit(completer, monitor->id);
+        emit_quoted(completer, "device", monitor->device_path);
+        if (monitor->stable_id[0] && sprintf_s(candidate, sizeof(candidate), "edid:%s", monitor->stable_id) > 0) {
+            emit(completer, candidate);
+        }
+        if (devices_only) continue;
+
+        emit_quoted(completer, "name", monitor->device_name);
+        emit_quoted(completer, "model", monitor->model_name);
+        if (monitor->native_width && monitor->native_height &&
+            sprintf_s(candidate, sizeof(candidate), "native:%lux%lu", monitor->native_width, monitor->native_height) > 0) {
+            emit(completer, candidate);
+        }
+    }
+    if (devices_only) return;
+
+    for (int i = 0; i < groups->count; i++) {
+        if (sprintf_s(candidate, sizeof(candidate), "group:%s", groups->entries[i].key) > 0) {
+            emit(completer, candidate);
+        }
+    }
+    emit(completer, "expr:");
+}
+
+// Start of the last list element: after the last comma outside quotes
+static size_t last_list_element(const char* text) {
+    size_t start = 0;
+    bool in_quotes = false;
+    for (size_t i = 0; text[i]; i++) {
+        if (text[i] == '"') {
+            in_quotes = !in_quotes;
+        } else if (text[i] == ',' && !in_quotes) {
+            start = i + 1;
+        }
+    }
+    return start;
+}
+
+// Cache freshness is judged by modification time alone, which costs one
+// attribute read; the refresh process decides whether anything changed
+static ULONG64 filetime_ticks(const FILETIME* time) {
+    return ((ULONG64)time->dwHighDateTime << 32) | time->dwLowDateTime;
+}
+
+static bool cache_is_fresh(const char* path, bool* out_exists) {
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    *out_exists = GetFileAttributesExA(path, GetFileExInfoStandard, &attributes) != 0;
+    if (!*out_exists) return false;
+
+    FILETIME now;
+    GetSystemTimeAsFileTime(&now);
+    ULONG64 written = filetime_ticks(&attributes.ftLastWriteTime);
+    ULONG64 current = filetime_ticks(&now);
+    return current < written || current - written < COMPLETION_CACHE_TTL_SECONDS * FILETIME_TICKS_PER_SECOND;
+}
+
+static void touch_cache(const char* path) {
+    HANDLE file = CreateFileA(path, FILE_WRITE_ATTRIBUTES, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return;
+
+    FILETIME now;
+    GetSystemTimeAsFileTime(&now);
+    SetFileTime(file, NULL, NULL, &now);
+    CloseHandle(file);
+}
+
+static void start_background_refresh() {
+    char executable[MAX_PATH];
+    DWORD length = GetModuleFileNameA(NULL, executable, MAX_PATH);
+    if (length == 0 || length >= MAX_PATH) return;
+
+    char command_line[MAX_PATH + 32];
+    sprintf_s(command_line, sizeof(command_line), "\"%s\" __complete --refresh", executable);
+
+    STARTUPINFOA startup;
+    PROCESS_INFORMATION process;
+    memset(&startup, 0, sizeof(startup));
+    startup.cb = sizeof(startup);
+    if (CreateProcessA(executable, command_line, NULL, NULL, FALSE, DETACHED_PROCESS | CREATE_NEW_PROCESS_GROUP,
+                       NULL, NULL, &startup, &process)) {
+        CloseHandle(process.hThread);
+        CloseHandle(process.hProcess);
+    }
+}
+
+// Serves whatever is cached. A stale cache is re-stamped before the refresh
+// starts, and a missing one is claimed with an empty placeholder
+// (CREATE_NEW), so a burst of keypresses starts one refresh, not one each.
+static MonitorList* load_completion_cache(const char* path) {
+    bool exists = false;
+    if (!cache_is_fresh(path, &exists)) {
+        if (exists) {
+            touch_cache(path);
+            start_background_refresh();
+        } else {
+            HANDLE placeholder = CreateFileA(path, GENERIC_WRITE, 0, NULL, CREATE_NEW, FILE_ATTRIBUTE_NORMAL, NULL);
+            if (placeholder != INVALID_HANDLE_VALUE) {
+                CloseHandle(placeholder);
+                start_background_refresh();
+            }
+            return NULL;
+        }
+    }
+    return load_topology_file(path);
+}
+
+static int refresh_completion_cache(const char* path) {
+    // An unchanged topology only needs a new timestamp, not EDID reads
+    MonitorList* cached = load_topology_file(path);
+    ULONG64 live = 0;
+    bool unchanged = cached && read_display_fingerprint(&live) && live == display_fingerprint(cached);
+    free_monitor_list(cached);
+    if (unchanged) {
+        touch_cache(path);
+        return 0;
+    }
+
+    MonitorList* monitors = enumerate_monitors();
+    if (!monitors) return 3;
+
+    size_t temp_len = strlen(path) + 32;
+    char* temp_path = (char*)malloc(temp_len);
+    bool success = temp_path != NULL;
+    if (success) {
+        sprintf_s(temp_path, temp_len, "%s.%lu.tmp", path, GetCurrentProcessId());
+        success = save_topology_file(monitors, temp_path) &&
+                  MoveFileExA(temp_path, path, MOVEFILE_REPLACE_EXISTING) != 0;
+        if (!success) {
+            DeleteFileA(temp_path);
+        }
+    }
+
+    free(temp_path);
+    free_monitor_list(monitors);
+    return success ? 0 : 3;
+}
+
+static void complete_value(ValueKind kind, const char* current) {
+    if (kind != VALUE_SELECTOR && kind != VALUE_SELECTOR_LIST && kind != VALUE_DEVICE) return;
+
+    char* path = get_local_data_path(COMPLETION_CACHE_FILE);
+    if (!path) return;
+    MonitorList* monitors = load_completion_cache(path);
+    free(path);
+
+    // Only group names are needed from the config
+    ConfigMap groups = { NULL, 0 };
+    if (kind != VALUE_DEVICE) {
+        load_config_groups(&groups);
+    }
+
+    // Inside a list only the last element is completed; the rest is kept
+    char* lead = _strdup(current);
+    size_t split = kind == VALUE_SELECTOR_LIST ? last_list_element(current) : 0;
+    int expected = (monitors ? monitors->count * 6 : 0) + groups.count + 1;
+
+    Completer completer;
+    if (lead) {
+        lead[split] = '\0';
+        if (completer_init(&completer, lead, current + split, expected)) {
+            emit_selectors(&completer, monitors, &groups, kind == VALUE_DEVICE);
+            free(completer.seen);
+        }
+    }
+
+    free(lead);
+    config_map_clear(&groups);
+    free_monitor_list(monitors);
+}
+
+static void complete_flags(const CommandSpec* command, const char* current) {
+    Completer completer;
+    if (!completer_init(&completer, "", current, COUNT_OF(g_global_flags))) return;
+
+    if (command) {
+        emit_words(&completer, command->flags);
+    } else {
+        for (int i = 0; i < COUNT_OF(g_global_flags); i++) {
+            emit(&completer, g_global_flags[i].name);
+        }
+    }
+    free(completer.seen);
+}
+
+static void complete_words(const char* words, const char* current) {
+    Completer completer;
+    if (!completer_init(&completer, "", current, 0)) return;
+
+    emit_words(&completer, words);
+    free(completer.seen);
+}
+
+static void discard_log(LogLevel level, const char* message, void* user_data) {
+    (void)level;
+    (void)message;
+    (void)user_data;
+}
+
+static int complete_command_line(int argc, char* argv[]) {
+    if (argc == 3 && strcmp(argv[2], "--refresh") == 0) {
+        char* path = get_local_data_path(COMPLETION_CACHE_FILE);
+        int result = path ? refresh_completion_cache(path) : 3;
+        free(path);
+        return result;
+    }
+
+    if (argc < 4 || strcmp(argv[3], "--") != 0) return 2;
+    char** words = argv + 4;
+    int word_count = argc - 4;
+    int index = atoi(argv[2]);
+    if (index < 0 || index > word_count) return 2;
+    const char* current = index < word_count ? words[index] : "";
+
+    // Replay the words before the cursor the way parse_args() reads them
+    const CommandSpec* command = NULL;
+    ValueKind pending = VALUE_NONE;
+    int positionals = 0;
+    for (int i = 0; i < index; i++) {
+        const char* word = words[i];
+        if (pending != VALUE_NONE) {
+            pending = VALUE_NONE;
+            continue;
+        }
+
+        const FlagSpec* flag = command ? find_flag(g_command_flags, COUNT_OF(g_command_flags), word)
+                                       : find_flag(g_global_flags, COUNT_OF(g_global_flags), word);
+        if (flag) {
+            pending = flag->value;
+        } else if (word[0] == '-') {
+            continue;
+        } else if (!command) {
+            command = find_command(word);
+            if (!command) return 0;   // Unknown command, nothing to offer
+        } else {
+            positionals++;
+        }
+    }
+
+    if (pending != VALUE_NONE) {
+        complete_value(pending, current);
+    } else if (current[0] == '-') {
+        complete_flags(command, current);
+    } else if (!command) {
+        Completer completer;
+        if (completer_init(&completer, "", current, COUNT_OF(g_commands))) {
+            for (int i = 0; i < COUNT_OF(g_commands); i++) {
+                emit(&completer, g_commands[i].name);
+            }
+            free(completer.seen);
+        }
+    } else if (positionals == 0 && command->operands) {
+        complete_words(command->operands, current);
+    }
+    return 0;
+}
+
+int run_complete(int argc, char* argv[]) {
+    // Nothing but candidates may reach the shell
+    LogSink silent = { discard_log, NULL, false };
+    const LogSink* previous_sink = log_set_thread_sink(&silent);
+    int result = complete_command_line(argc, argv);
+    log_set_thread_sink(previous_sink);
+    return result;
+}
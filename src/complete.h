@@ -0,0 +1,18 @@
+#ifndef COMPLETE_H
+#define COMPLETE_H
+
+// Shell completion back end, invoked by the scripts in completions/ as
+//
+//   mos-def __complete <index> -- <words...>
+//
+// where words are the command line after the program name and index is the
+// position of the word being completed (one past the end when it is empty,
+// since some shells drop empty arguments). Candidates are printed one per
+// line; no output lets the shell fall back to file names.
+//
+// Monitor selectors come from a topology cached under %LOCALAPPDATA%, never
+// from a live enumeration. A stale cache is still served while a detached
+// "mos-def __complete --refresh" rewrites it in the background.
+int run_complete(int argc, char* argv[]);
+
+#endif // COMPLETE_H
@@ -1,9 +1,12 @@
 #include "config.h"
 #include "util.h"
+#include "groups.h"
+#include "hooks.h"
 #include <windows.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <shlobj.h>
 
 // Config file operations
@@ -43,20 +46,34 @@ char* get_config_file_path() {
     return config_path;
 }
 
-MosDefConfig* load_config() {
+MosDefConfig* create_config() {
+    MosDefConfig* config = (MosDefConfig*)malloc(sizeof(MosDefConfig));
+    if (config) {
+        config->default_selector = NULL;
+        config->last_action = NULL;
+        config->hotkeys.entries = NULL;
+        config->hotkeys.count = 0;
+        config->groups.entries = NULL;
+        config->groups.count = 0;
+        config->hooks.entries = NULL;
+        config->hooks.count = 0;
+    }
+    return config;
+}
+
+static MosDefConfig* parse_config_json(const char* json, bool groups_only);
+
+// Reads the whole config file; NULL with *out_missing set if there is none
+static char* read_config_text(bool* out_missing) {
+    *out_missing = false;
     char* config_path = get_config_file_path();
     if (!config_path) return NULL;
 
     FILE* file = NULL;
     if (fopen_s(&file, config_path, "r") != 0 || !file) {
         free(config_path);
-        // Return empty config if file doesn't exist
-        MosDefConfig* config = (MosDefConfig*)malloc(sizeof(MosDefConfig));
-        if (config) {
-            config->default_selector = NULL;
-            config->last_action = NULL;
-        }
-        return config;
+        *out_missing = true;
+        return NULL;
     }
 
     // Read entire file
@@ -75,13 +92,48 @@ MosDefConfig* load_config() {
     json_content[bytes_read] = '\0';
     fclose(file);
     free(config_path);
+    return json_content;
+}
+
+MosDefConfig* load_config() {
+    bool missing = false;
+    char* json_content = read_config_text(&missing);
+    if (!json_content) {
+        // Return empty config if file doesn't exist
+        return missing ? create_config() : NULL;
+    }
 
     MosDefConfig* config = json_to_config(json_content);
     free(json_content);
-
     return config;
 }
 
+bool load_config_groups(ConfigMap* out_groups) {
+    out_groups->entries = NULL;
+    out_groups->count = 0;
+
+    bool missing = false;
+    char* json_content = read_config_text(&missing);
+    if (!json_content) return missing;
+
+    MosDefConfig* config = parse_config_json(json_content, true);
+    free(json_content);
+    if (!config) return false;
+
+    *out_groups = config->groups;
+    config->groups.entries = NULL;
+    config->groups.count = 0;
+    free_config(config);
+    return true;
+}
+
+bool register_config_definitions(const MosDefConfig* config) {
+    static const ConfigMap empty = { NULL, 0 };
+    bool groups_ok = monitor_groups_define(config ? &config->groups : &empty);
+    bool hooks_ok = hooks_define(config ? &config->hooks : &empty);
+    return groups_ok && hooks_ok;
+}
+
 bool save_config(const MosDefConfig* config) {
     if (!config) return false;
 
@@ -113,17 +165,74 @@ void free_config(MosDefConfig* config) {
     if (config) {
         free(config->default_selector);
         free(config->last_action);
+        config_map_clear(&config->hotkeys);
+        config_map_clear(&config->groups);
+        config_map_clear(&config->hooks);
         free(config);
     }
 }
 
+// Config maps
+bool config_map_set(ConfigMap* map, const char* key, const char* value) {
+    if (!map || !key || !value) return false;
+
+    char* value_copy = _strdup(value);
+    if (!value_copy) return false;
+
+    // Later duplicates win, matching how JSON objects are usually read
+    for (int i = 0; i < map->count; i++) {
+        if (strcmp(map->entries[i].key, key) == 0) {
+            free(map->entries[i].value);
+            map->entries[i].value = value_copy;
+            return true;
+        }
+    }
+
+    char* key_copy = _strdup(key);
+    ConfigEntry* entries = key_copy ? (ConfigEntry*)realloc(map->entries, (map->count + 1) * sizeof(ConfigEntry)) : NULL;
+    if (!entries) {
+        free(key_copy);
+        free(value_copy);
+        return false;
+    }
+
+    map->entries = entries;
+    map->entries[map->count].key = key_copy;
+    map->entries[map->count].value = value_copy;
+    map->count++;
+    return true;
+}
+
+const char* config_map_get(const ConfigMap* map, const char* key) {
+    if (!map || !key) return NULL;
+
+    for (int i = 0; i < map->count; i++) {
+        if (strcmp(map->entries[i].key, key) == 0) {
+            return map->entries[i].value;
+        }
+    }
+    return NULL;
+}
+
+void config_map_clear(ConfigMap* map) {
+    if (!map) return;
+
+    for (int i = 0; i < map->count; i++) {
+        free(map->entries[i].key);
+        free(map->entries[i].value);
+    }
+    free(map->entries);
+    map->entries = NULL;
+    map->count = 0;
+}
+
 // JSON parsing (simple implementation for our specific format)
 char* json_escape_string(const char* str) {
     if (!str) return _strdup("null");
 
-    // Calculate required size (worst case: every char escaped)
+    // Calculate required size (worst case: every char a \u00XX escape)
     size_t len = strlen(str);
-    char* escaped = (char*)malloc(len * 2 + 3); // +3 for quotes and null terminator
+    char* escaped = (char*)malloc(len * 6 + 3); // +3 for quotes and null terminator
     if (!escaped) return NULL;
 
     char* dest = escaped;
@@ -152,7 +261,11 @@ char* json_escape_string(const char* str) {
                 *dest++ = 't';
                 break;
             default:
-                *dest++ = *src;
+                if ((unsigned char)*src < 0x20) {
+                    dest += sprintf_s(dest, 7, "\\u%04x", (unsigned char)*src);
+                } else {
+                    *dest++ = *src;
+                }
                 break;
         }
     }
@@ -200,6 +313,20 @@ char* json_unescape_string(const char* json_str) {
                     *dest++ = '\t';
                     i++;
                     break;
+                case 'u': {
+                    // Only the \u00XX control escapes json_escape_string writes
+                    char hex[5] = { 0 };
+                    char* end = NULL;
+                    if (i + 5 < len) memcpy(hex, start + i + 2, 4);
+                    unsigned long code = strtoul(hex, &end, 16);
+                    if (end == hex + 4 && code < 0x20) {
+                        *dest++ = (char)code;
+                        i += 5;
+                    } else {
+                        *dest++ = start[i];
+                    }
+                    break;
+                }
                 default:
                     *dest++ = start[i];
                     break;
@@ -213,6 +340,40 @@ char* json_unescape_string(const char* json_str) {
     return unescaped;
 }
 
+// Appends a JSON object of string pairs, or nothing for an empty map
+static char* append_config_map(char* json, const char* name, const ConfigMap* map) {
+    if (!json || map->count == 0) return json;
+
+    size_t len = strlen(json) + strlen(name) + 16;
+    for (int i = 0; i < map->count; i++) {
+        len += (strlen(map->entries[i].key) + strlen(map->entries[i].value)) * 2 + 16;
+    }
+
+    char* result = (char*)realloc(json, len);
+    if (!result) {
+        free(json);
+        return NULL;
+    }
+
+    // Drop the closing "\n}" and reopen the object
+    size_t pos = strlen(result) - 2;
+    pos += sprintf_s(result + pos, len - pos, ",\n  \"%s\": {", name);
+
+    for (int i = 0; i < map->count; i++) {
+        char* key_json = json_escape_string(map->entries[i].key);
+        char* value_json = json_escape_string(map->entries[i].value);
+        if (key_json && value_json) {
+            pos += sprintf_s(result + pos, len - pos, "%s\n    %s: %s",
+                             i > 0 ? "," : "", key_json, value_json);
+        }
+        free(key_json);
+        free(value_json);
+    }
+
+    sprintf_s(result + pos, len - pos, "\n  }\n}");
+    return result;
+}
+
 char* config_to_json(const MosDefConfig* config) {
     if (!config) return _strdup("{}");
 
@@ -232,18 +393,87 @@ char* config_to_json(const MosDefConfig* config) {
 
     free(default_selector_json);
     free(last_action_json);
-    return json;
+
+    json = append_config_map(json, "hotkeys", &config->hotkeys);
+    json = append_config_map(json, "groups", &config->groups);
+    return append_config_map(json, "hooks", &config->hooks);
+}
+
+// Parses a quoted JSON string at *pos and advances past the closing quote
+static char* parse_json_string(const char** pos) {
+    const char* p = *pos;
+    if (*p != '"') return NULL;
+    p++;
+
+    const char* value_start = p;
+    bool escaped = false;
+    while (*p) {
+        if (*p == '"' && !escaped) break;
+        escaped = (*p == '\\') && !escaped;
+        p++;
+    }
+    if (!*p) return NULL;
+
+    size_t value_len = p - value_start;
+    char* value_json = (char*)malloc(value_len + 3); // +3 for quotes and null
+    if (!value_json) return NULL;
+
+    value_json[0] = '"';
+    memcpy(value_json + 1, value_start, value_len);
+    value_json[value_len + 1] = '"';
+    value_json[value_len + 2] = '\0';
+
+    char* value = json_unescape_string(value_json);
+    free(value_json);
+
+    *pos = p + 1;
+    return value;
+}
+
+// Parses { "key": "value", ... } at *pos into map
+static bool parse_json_string_map(const char** pos, ConfigMap* map) {
+    const char* p = *pos;
+    if (*p != '{') return false;
+    p++;
+
+    while (*p) {
+        while (*p && (isspace((unsigned char)*p) || *p == ',')) p++;
+        if (*p == '}') {
+            *pos = p + 1;
+            return true;
+        }
+
+        char* key = parse_json_string(&p);
+        if (!key) return false;
+
+        while (*p && (isspace((unsigned char)*p) || *p == ':')) p++;
+
+        char* value = parse_json_string(&p);
+        if (!value) {
+            free(key);
+            return false;
+        }
+
+        bool stored = config_map_set(map, key, value);
+        free(key);
+        free(value);
+        if (!stored) return false;
+    }
+
+    return false;
 }
 
 MosDefConfig* json_to_config(const char* json) {
+    return parse_config_json(json, false);
+}
+
+// groups_only keeps the groups object and skips everything else
+static MosDefConfig* parse_config_json(const char* json, bool groups_only) {
     if (!json) return NULL;
 
-    MosDefConfig* config = (MosDefConfig*)malloc(sizeof(MosDefConfig));
+    MosDefConfig* config = create_config();
     if (!config) return NULL;
 
-    config->default_selector = NULL;
-    config->last_action = NULL;
-
     // Simple JSON parser for our specific format
     const char* pos = json;
 
@@ -263,72 +493,46 @@ MosDefConfig* json_to_config(const char* json) {
         if (*pos == '}') break;
 
         // Parse key
-        if (*pos != '"') {
-            free_config(config);
-            return NULL;
-        }
-        pos++;
-
-        const char* key_start = pos;
-        while (*pos && *pos != '"') pos++;
-        if (!*pos) {
-            free_config(config);
-            return NULL;
-        }
-
-        size_t key_len = pos - key_start;
-        char* key = (char*)malloc(key_len + 1);
+        char* key = parse_json_string(&pos);
         if (!key) {
             free_config(config);
             return NULL;
         }
-        memcpy(key, key_start, key_len);
-        key[key_len] = '\0';
-        pos++;
 
         // Skip whitespace and colon
         while (*pos && (isspace((unsigned char)*pos) || *pos == ':')) pos++;
 
         // Parse value
         if (*pos == '"') {
-            pos++;
-            const char* value_start = pos;
-            bool escaped = false;
-            while (*pos) {
-                if (*pos == '"' && !escaped) break;
-                escaped = (*pos == '\\');
-                pos++;
-            }
-            if (!*pos) {
+            char* value = parse_json_string(&pos);
+            if (!value) {
                 free(key);
                 free_config(config);
                 return NULL;
             }
 
-            size_t value_len = pos - value_start;
-            char* value_json = (char*)malloc(value_len + 3); // +3 for quotes and null
-            if (!value_json) {
-                free(key);
-                free_config(config);
-                return NULL;
-            }
-            value_json[0] = '"';
-            memcpy(value_json + 1, value_start, value_len);
-            value_json[value_len + 1] = '"';
-            value_json[value_len + 2] = '\0';
-
-            char* value = json_unescape_string(value_json);
-            free(value_json);
-
-            if (strcmp(key, "default_selector") == 0) {
+            if (groups_only) {
+                free(value);
+            } else if (strcmp(key, "default_selector") == 0) {
                 config->default_selector = value;
             } else if (strcmp(key, "last_action") == 0) {
                 config->last_action = value;
             } else {
                 free(value);
             }
-
-            pos++;
+        } else if (*pos == '{') {
+            ConfigMap scratch = { NULL, 0 };
+            ConfigMap* target = (strcmp(key, "groups") == 0) ? &config->groups :
+                                groups_only ? &scratch :
+                                (strcmp(key, "hotkeys") == 0) ? &config->hotkeys :
+                                (strcmp(key, "hooks") == 0) ? &config->hooks : &scratch;
+            bool parsed = parse_json_string_map(&pos, target);
+            config_map_clear(&scratch);
+            if (!parsed) {
+                free(key);
+                free_config(config);
+                return NULL;
+            }
         } else if (strncmp(pos, "null", 4) == 0) {
             pos += 4;
         }
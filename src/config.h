@@ -3,18 +3,47 @@
 
 #include <stdbool.h>
 
+// String-to-string JSON object, e.g. "hotkeys": { "Ctrl+Alt+P": "toggle --only M2" }
+typedef struct {
+    char* key;
+    char* value;
+} ConfigEntry;
+
+typedef struct {
+    ConfigEntry* entries;
+    int count;
+} ConfigMap;
+
 // Configuration structure
 typedef struct {
     char* default_selector;
     char* last_action;
+    ConfigMap hotkeys;      // Key chord -> command line
+    ConfigMap groups;       // Group name -> selector list, see groups.h
+    ConfigMap hooks;        // Event[:label] -> command line, see hooks.h
 } MosDefConfig;
 
 // Config file operations
 char* get_config_file_path();
-MosDefConfig* load_config();
+MosDefConfig* create_config();
+MosDefConfig* load_config();    // Changes no process-wide state
+// Reads only the "groups" object, for callers such as shell completion that
+// need nothing else. out_groups is empty if the file or the object is
+// missing; false if the file cannot be read or parsed.
+bool load_config_groups(ConfigMap* out_groups);
 bool save_config(const MosDefConfig* config);
 void free_config(MosDefConfig* config);
 
+// Installs config's groups and hooks (none for NULL) as the process-wide
+// definitions behind group: selectors and hooks.h. Commands call this once
+// during setup; loading a config never does.
+bool register_config_definitions(const MosDefConfig* config);
+
+// Config maps
+bool config_map_set(ConfigMap* map, const char* key, const char* value);
+const char* config_map_get(const ConfigMap* map, const char* key);
+void config_map_clear(ConfigMap* map);
+
 // JSON parsing (simple implementation for our specific format)
 char* json_escape_string(const char* str);
 char* json_unescape_string(const char* str);
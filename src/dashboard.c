@@ -0,0 +1,393 @@
+#include "dashboard.h"
+#include "diff.h"
+#include "event_ring.h"
+#include "listener.h"
+#include "screen.h"
+#include "util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+
+#define DASHBOARD_EVENT_CAPACITY 256
+#define DASHBOARD_MAX_OPERATIONS 64
+#define DASHBOARD_MAX_OPERATION_ROWS 8
+
+typedef struct {
+    char time[16];
+    char text[120];
+} DashboardOperation;
+
+typedef struct {
+    MosDefContext* ctx;
+    DisplayListener* listener;
+    EventRing* ring;
+    Screen* screen;
+    HANDLE output;
+    bool dry_run;
+
+    MonitorList* monitors;
+    unsigned long long probes;
+    double last_probe_ms;
+    int selected;
+    int scroll;
+
+    // Newest at operations[(head - 1) % MAX]
+    DashboardOperation operations[DASHBOARD_MAX_OPERATIONS];
+    int operation_head;
+    int operation_count;
+
+    int modesets;
+    double modeset_ms_last;
+    double modeset_ms_total;
+    double modeset_ms_max;
+} Dashboard;
+
+// Operations panel
+static void add_operation(Dashboard* dashboard, const char* format, ...) {
+    DashboardOperation* operation = &dashboard->operations[dashboard->operation_head];
+
+    SYSTEMTIME now;
+    GetLocalTime(&now);
+    sprintf_s(operation->time, sizeof(operation->time), "%02u:%02u:%02u",
+              now.wHour, now.wMinute, now.wSecond);
+
+    va_list args;
+    va_start(args, format);
+    vsnprintf(operation->text, sizeof(operation->text), format, args);
+    va_end(args);
+
+    dashboard->operation_head = (dashboard->operation_head + 1) % DASHBOARD_MAX_OPERATIONS;
+    if (dashboard->operation_count < DASHBOARD_MAX_OPERATIONS) {
+        dashboard->operation_count++;
+    }
+}
+
+// Library diagnostics for the dashboard's context
+static void dashboard_log_write(LogLevel level, const char* message, void* user_data) {
+    Dashboard* dashboard = (Dashboard*)user_data;
+    add_operation(dashboard, "%s%s", level == LOG_LEVEL_ERROR ? "error: " : "", message);
+}
+
+// Terminal
+static void write_terminal(const char* data, size_t size, void* user_data) {
+    Dashboard* dashboard = (Dashboard*)user_data;
+    DWORD written = 0;
+    WriteFile(dashboard->output, data, (DWORD)size, &written, NULL);
+}
+
+static void get_terminal_size(HANDLE output, int* width, int* height) {
+    CONSOLE_SCREEN_BUFFER_INFO info;
+    if (GetConsoleScreenBufferInfo(output, &info)) {
+        *width = info.srWindow.Right - info.srWindow.Left + 1;
+        *height = info.srWindow.Bottom - info.srWindow.Top + 1;
+    } else {
+        *width = 80;
+        *height = 25;
+    }
+}
+
+// Topology
+static void describe_change(Dashboard* dashboard, const TopologyChange* change) {
+    const MonitorInfo* monitor = change->after ? change->after : change->before;
+
+    switch (change->type) {
+        case TOPOLOGY_CHANGE_ORIENTATION:
+            add_operation(dashboard, "%-5s orientation %lu -> %lu", monitor->id,
+                          get_orientation_degrees(change->before->orientation),
+                          get_orientation_degrees(change->after->orientation));
+            break;
+        case TOPOLOGY_CHANGE_RESOLUTION:
+            add_operation(dashboard, "%-5s resolution %lux%lu -> %lux%lu", monitor->id,
+                          change->before->width, change->before->height,
+                          change->after->width, change->after->height);
+            break;
+        case TOPOLOGY_CHANGE_POSITION:
+            add_operation(dashboard, "%-5s position %ld,%ld -> %ld,%ld", monitor->id,
+                          change->before->position_x, change->before->position_y,
+                          change->after->position_x, change->after->position_y);
+            break;
+        case TOPOLOGY_CHANGE_REFRESH:
+            add_operation(dashboard, "%-5s refresh %lu -> %lu Hz", monitor->id,
+                          change->before->refresh_hz, change->after->refresh_hz);
+            break;
+        default:
+            add_operation(dashboard, "%-5s %s (%s)", monitor->id,
+                          get_topology_change_name(change->type), monitor->stable_id);
+            break;
+    }
+}
+
+static void refresh_topology(Dashboard* dashboard, LONG64 intake) {
+    MonitorList* updated = NULL;
+    if (mosdef_enumerate(dashboard->ctx, &updated) != MOSDEF_OK) {
+        return; // The sink already recorded why
+    }
+    dashboard->probes++;
+    dashboard->last_probe_ms = event_timestamp_elapsed_us(intake, event_timestamp_now()) / 1000.0;
+
+    if (dashboard->monitors) {
+        TopologyDiff* diff = diff_topologies(dashboard->monitors, updated);
+        if (diff) {
+            for (int i = 0; i < diff->count; i++) {
+                describe_change(dashboard, &diff->changes[i]);
+            }
+            free_topology_diff(diff);
+        }
+        mosdef_free_monitor_list(dashboard->ctx, dashboard->monitors);
+    }
+
+    dashboard->monitors = updated;
+    if (dashboard->selected >= updated->count) {
+        dashboard->selected = updated->count > 0 ? updated->count - 1 : 0;
+    }
+}
+
+static void rotate_selected(Dashboard* dashboard, RotationCommand command) {
+    if (!dashboard->monitors || dashboard->monitors->count == 0) return;
+
+    const MonitorInfo* monitor = &dashboard->monitors->monitors[dashboard->selected];
+    Selector selector = { SELECTOR_TYPE_EDID, monitor->stable_id, NULL };
+    SelectorList only = { &selector, 1 };
+
+    RotationPlan* plan = NULL;
+    if (mosdef_plan(dashboard->ctx, command, &only, NULL, &plan) != MOSDEF_OK) {
+        return;
+    }
+
+    LONG64 start = event_timestamp_now();
+    BatchRotationResult result = { 0, 0, NULL, 0 };
+    MosDefStatus status = mosdef_apply(dashboard->ctx, plan, &result);
+    double modeset_ms = event_timestamp_elapsed_us(start, event_timestamp_now()) / 1000.0;
+
+    if (status == MOSDEF_OK && !dashboard->dry_run) {
+        dashboard->modesets++;
+        dashboard->modeset_ms_last = modeset_ms;
+        dashboard->modeset_ms_total += modeset_ms;
+        if (modeset_ms > dashboard->modeset_ms_max) {
+            dashboard->modeset_ms_max = modeset_ms;
+        }
+    }
+
+    add_operation(dashboard, "%-5s %s%s: %s in %.1f ms", monitor->id, get_rotation_command_name(command),
+                  dashboard->dry_run ? " (dry run)" : "", mosdef_status_string(status), modeset_ms);
+
+    mosdef_free_result(dashboard->ctx, &result);
+    mosdef_free_plan(dashboard->ctx, plan);
+}
+
+// Rendering
+static void render(Dashboard* dashboard) {
+    Screen* screen = dashboard->screen;
+    screen_clear(screen);
+
+    int count = dashboard->monitors ? dashboard->monitors->count : 0;
+    int operation_rows = screen->height / 3;
+    if (operation_rows > DASHBOARD_MAX_OPERATION_ROWS) operation_rows = DASHBOARD_MAX_OPERATION_ROWS;
+    if (operation_rows < 1) operation_rows = 1;
+
+    // Title, column header, monitor rows, operations header, operations, help
+    int table_rows = screen->height - 4 - operation_rows;
+    if (table_rows < 1) table_rows = 1;
+
+    // Keep the selection visible
+    if (dashboard->selected < dashboard->scroll) {
+        dashboard->scroll = dashboard->selected;
+    } else if (dashboard->selected >= dashboard->scroll + table_rows) {
+        dashboard->scroll = dashboard->selected - table_rows + 1;
+    }
+
+    char line[512];
+    int row = 0;
+
+    double modeset_avg = dashboard->modesets > 0 ? dashboard->modeset_ms_total / dashboard->modesets : 0.0;
+    sprintf_s(line, sizeof(line),
+              " MOS-DEF top  %d monitor(s)  probe #%llu (%.1f ms)  modesets %d  last %.1f ms  avg %.1f ms  max %.1f ms%s",
+              count, dashboard->probes, dashboard->last_probe_ms, dashboard->modesets,
+              dashboard->modeset_ms_last, modeset_avg, dashboard->modeset_ms_max,
+              dashboard->dry_run ? "  [dry run]" : "");
+    screen_put_line(screen, row++, line, SCREEN_ATTR_BOLD | SCREEN_ATTR_REVERSE);
+
+    sprintf_s(line, sizeof(line), "  %-5s %-28s %-11s %-4s %-13s %-4s %s",
+              "ID", "Name", "Resolution", "Rot", "Position", "Hz", "Stable ID");
+    screen_put_line(screen, row++, line, SCREEN_ATTR_BOLD);
+
+    for (int i = 0; i < table_rows; i++, row++) {
+        int index = dashboard->scroll + i;
+        if (index >= count) continue;
+
+        const MonitorInfo* monitor = &dashboard->monitors->monitors[index];
+        char position[24];
+        sprintf_s(position, sizeof(position), "%ld,%ld", monitor->position_x, monitor->position_y);
+
+        sprintf_s(line, sizeof(line), "%c %-5s %-28.28s %-11s %-4lu %-13s %-4lu %s",
+                  index == dashboard->selected ? '>' : ' ', monitor->id, monitor->device_name,
+                  get_resolution_string(monitor->width, monitor->height),
+                  get_orientation_degrees(monitor->orientation), position,
+                  monitor->refresh_hz, monitor->stable_id);
+        screen_put_line(screen, row, line,
+                        index == dashboard->selected ? SCREEN_ATTR_REVERSE : SCREEN_ATTR_NORMAL);
+    }
+
+    screen_put_line(screen, row++, " Recent operations", SCREEN_ATTR_BOLD);
+    for (int i = 0; i < operation_rows && i < dashboard->operation_count; i++, row++) {
+        int index = (dashboard->operation_head - 1 - i + DASHBOARD_MAX_OPERATIONS) % DASHBOARD_MAX_OPERATIONS;
+        const DashboardOperation* operation = &dashboard->operations[index];
+        sprintf_s(line, sizeof(line), "  %s  %s", operation->time, operation->text);
+        screen_put_line(screen, row, line, SCREEN_ATTR_NORMAL);
+    }
+
+    screen_put_line(screen, screen->height - 1,
+                    " q quit  Up/Down select  l landscape  p portrait  t toggle", SCREEN_ATTR_REVERSE);
+
+    screen_flush(screen, write_terminal, dashboard);
+}
+
+// Returns false when the dashboard should exit
+static bool handle_key(Dashboard* dashboard, DWORD virtual_key) {
+    int count = dashboard->monitors ? dashboard->monitors->count : 0;
+
+    switch (virtual_key) {
+        case 'Q':
+        case VK_ESCAPE:
+            return false;
+        case VK_UP:
+            if (dashboard->selected > 0) dashboard->selected--;
+            break;
+        case VK_DOWN:
+            if (dashboard->selected < count - 1) dashboard->selected++;
+            break;
+        case VK_HOME:
+            dashboard->selected = 0;
+            break;
+        case VK_END:
+            dashboard->selected = count > 0 ? count - 1 : 0;
+            break;
+        case 'L':
+            rotate_selected(dashboard, ROTATION_LANDSCAPE);
+            break;
+        case 'P':
+            rotate_selected(dashboard, ROTATION_PORTRAIT);
+            break;
+        case 'T':
+            rotate_selected(dashboard, ROTATION_TOGGLE);
+            break;
+        default:
+            break;
+    }
+    return true;
+}
+
+static DWORD WINAPI render_thread(LPVOID param) {
+    Dashboard* dashboard = (Dashboard*)param;
+    DisplayEvent events[32];
+
+    refresh_topology(dashboard, event_timestamp_now());
+    render(dashboard);
+
+    for (;;) {
+        event_ring_wait(dashboard->ring, INFINITE);
+
+        LONG64 first_intake = 0;
+        bool topology_changed = false;
+        bool resized = false;
+        bool redraw = false;
+
+        int count;
+        while ((count = event_ring_drain(dashboard->ring, events, 32)) > 0) {
+            for (int i = 0; i < count; i++) {
+                switch (events[i].type) {
+                    case DISPLAY_EVENT_TOPOLOGY_CHANGED:
+                        if (!topology_changed) first_intake = events[i].timestamp;
+                        topology_changed = true;
+                        break;
+                    case DISPLAY_EVENT_RESIZE:
+                        resized = true;
+                        break;
+                    case DISPLAY_EVENT_KEY:
+                        if (!handle_key(dashboard, events[i].param)) {
+                            display_listener_stop(dashboard->listener);
+                        }
+                        redraw = true;
+                        break;
+                    case DISPLAY_EVENT_SHUTDOWN:
+                        return 0;
+                    default:
+                        break;
+                }
+            }
+        }
+
+        if (topology_changed) {
+            refresh_topology(dashboard, first_intake);
+        }
+        if (resized) {
+            int width, height;
+            get_terminal_size(dashboard->output, &width, &height);
+            screen_resize(dashboard->screen, width, height);
+        }
+        if (topology_changed || resized || redraw) {
+            render(dashboard);
+        }
+    }
+}
+
+int run_dashboard(const MosDefOptions* options) {
+    Dashboard* dashboard = (Dashboard*)calloc(1, sizeof(Dashboard));
+    if (!dashboard) return 3;
+
+    dashboard->dry_run = options && options->dry_run;
+    dashboard->output = GetStdHandle(STD_OUTPUT_HANDLE);
+
+    LogSink sink = { dashboard_log_write, dashboard, options && options->verbose };
+    dashboard->ctx = mosdef_create(options, NULL, &sink);
+
+    int width, height;
+    get_terminal_size(dashboard->output, &width, &height);
+    dashboard->screen = screen_create(width, height);
+    dashboard->ring = event_ring_create(DASHBOARD_EVENT_CAPACITY);
+    dashboard->listener = dashboard->ring ? display_listener_create(dashboard->ring) : NULL;
+
+    int result = 0;
+    if (!dashboard->ctx || !dashboard->screen || !dashboard->listener) {
+        log_error("Failed to initialize dashboard");
+        result = 3;
+    } else {
+        display_listener_forward_console_input(dashboard->listener, true);
+
+        // VT output, alternate screen, hidden cursor
+        DWORD saved_mode = 0;
+        bool restore_mode = GetConsoleMode(dashboard->output, &saved_mode) != 0;
+        if (restore_mode) {
+            SetConsoleMode(dashboard->output, saved_mode | ENABLE_VIRTUAL_TERMINAL_PROCESSING);
+        }
+        write_terminal("\x1b[?1049h\x1b[?25l", 14, dashboard);
+
+        HANDLE renderer = CreateThread(NULL, 0, render_thread, dashboard, 0, NULL);
+        if (!renderer) {
+            result = 3;
+        } else {
+            display_listener_run(dashboard->listener);
+            WaitForSingleObject(renderer, INFINITE);
+            CloseHandle(renderer);
+        }
+
+        write_terminal("\x1b[0m\x1b[?25h\x1b[?1049l", 18, dashboard);
+        if (restore_mode) {
+            SetConsoleMode(dashboard->output, saved_mode);
+        }
+        if (!renderer) {
+            log_error("Failed to start dashboard thread (error %lu)", GetLastError());
+        }
+    }
+
+    display_listener_destroy(dashboard->listener);
+    event_ring_destroy(dashboard->ring);
+    screen_destroy(dashboard->screen);
+    if (dashboard->ctx) {
+        mosdef_free_monitor_list(dashboard->ctx, dashboard->monitors);
+        mosdef_destroy(dashboard->ctx);
+    }
+    free(dashboard);
+    return result;
+}
@@ -0,0 +1,12 @@
+#ifndef DASHBOARD_H
+#define DASHBOARD_H
+
+#include "mosdef.h"
+
+// Full-screen live view of every monitor, recent topology changes and
+// modeset latencies. Redraws on display notifications and key presses only.
+// Uses its own context so library diagnostics land in the operations panel
+// instead of scribbling over the screen. Returns a process exit code.
+int run_dashboard(const MosDefOptions* options);
+
+#endif // DASHBOARD_H
@@ -0,0 +1,170 @@
+#include "diff.h"
+#include "util.h"
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static bool append_change(TopologyDiff* diff, int* capacity, TopologyChangeType type,
+                          const MonitorInfo* before, const MonitorInfo* after) {
+    if (diff->count == *capacity) {
+        int new_capacity = (*capacity == 0) ? 8 : *capacity * 2;
+        TopologyChange* changes = (TopologyChange*)realloc(diff->changes, new_capacity * sizeof(TopologyChange));
+        if (!changes) return false;
+        diff->changes = changes;
+        *capacity = new_capacity;
+    }
+
+    diff->changes[diff->count].type = type;
+    diff->changes[diff->count].before = before;
+    diff->changes[diff->count].after = after;
+    diff->count++;
+    return true;
+}
+
+// The monitor in list that other joins to, by stable ID or else device path
+static const MonitorInfo* find_counterpart(const MonitorList* list, const MonitorInfo* other) {
+    if (other->stable_id && other->stable_id[0]) {
+        return find_monitor_by_stable_id(list, other->stable_id);
+    }
+
+    const MonitorInfo* monitor = find_monitor_by_device_path(list, other->device_path);
+    return (monitor && (!monitor->stable_id || !monitor->stable_id[0])) ? monitor : NULL;
+}
+
+static bool refresh_differs(DWORD before, DWORD after) {
+    return before > 1 && after > 1 && before != after;
+}
+
+TopologyDiff* diff_topologies(const MonitorList* before, const MonitorList* after) {
+    TopologyDiff* diff = (TopologyDiff*)malloc(sizeof(TopologyDiff));
+    if (!diff) return NULL;
+
+    memset(diff, 0, sizeof(TopologyDiff));
+    int capacity = 0;
+    bool ok = true;
+
+    int before_count = before ? before->count : 0;
+    int after_count = after ? after->count : 0;
+
+    // Removed: present before, no stable ID match after
+    for (int i = 0; i < before_count && ok; i++) {
+        const MonitorInfo* old_monitor = &before->monitors[i];
+        if (!find_counterpart(after, old_monitor)) {
+            ok = append_change(diff, &capacity, TOPOLOGY_CHANGE_REMOVED, old_monitor, NULL);
+            diff->removed_count++;
+        }
+    }
+
+    // Added or changed, in the new enumeration order
+    for (int i = 0; i < after_count && ok; i++) {
+        const MonitorInfo* new_monitor = &after->monitors[i];
+        const MonitorInfo* old_monitor = find_counterpart(before, new_monitor);
+
+        if (!old_monitor) {
+            ok = append_change(diff, &capacity, TOPOLOGY_CHANGE_ADDED, NULL, new_monitor);
+            diff->added_count++;
+            continue;
+        }
+
+        int previous_count = diff->count;
+        if (old_monitor->orientation != new_monitor->orientation) {
+            ok = ok && append_change(diff, &capacity, TOPOLOGY_CHANGE_ORIENTATION, old_monitor, new_monitor);
+        }
+        if (old_monitor->width != new_monitor->width || old_monitor->height != new_monitor->height) {
+            ok = ok && append_change(diff, &capacity, TOPOLOGY_CHANGE_RESOLUTION, old_monitor, new_monitor);
+        }
+        if (old_monitor->position_x != new_monitor->position_x ||
+            old_monitor->position_y != new_monitor->position_y) {
+            ok = ok && append_change(diff, &capacity, TOPOLOGY_CHANGE_POSITION, old_monitor, new_monitor);
+        }
+        if (refresh_differs(old_monitor->refresh_hz, new_monitor->refresh_hz)) {
+            ok = ok && append_change(diff, &capacity, TOPOLOGY_CHANGE_REFRESH, old_monitor, new_monitor);
+        }
+        if (diff->count > previous_count) {
+            diff->changed_count++;
+        }
+    }
+
+    if (!ok) {
+        log_error("Failed to allocate topology diff");
+        free_topology_diff(diff);
+        return NULL;
+    }
+
+    return diff;
+}
+
+void free_topology_diff(TopologyDiff* diff) {
+    if (!diff) return;
+
+    free(diff->changes);
+    free(diff);
+}
+
+const char* get_topology_change_name(TopologyChangeType type) {
+    switch (type) {
+        case TOPOLOGY_CHANGE_REMOVED:     return "monitor_removed";
+        case TOPOLOGY_CHANGE_ADDED:       return "monitor_added";
+        case TOPOLOGY_CHANGE_ORIENTATION: return "orientation_changed";
+        case TOPOLOGY_CHANGE_RESOLUTION:  return "resolution_changed";
+        case TOPOLOGY_CHANGE_POSITION:    return "position_changed";
+        case TOPOLOGY_CHANGE_REFRESH:     return "refresh_changed";
+        default:                          return "unknown";
+    }
+}
+
+// JSON output
+static void write_monitor_state(FILE* out, const MonitorInfo* monitor) {
+    char* name_json = json_escape_string(monitor->device_name);
+    fprintf(out, "{\"name\":%s,\"width\":%lu,\"height\":%lu,\"orientation\":%lu,\"x\":%ld,\"y\":%ld,\"refresh_hz\":%lu}",
+            name_json ? name_json : "null", monitor->width, monitor->height,
+            get_orientation_degrees(monitor->orientation),
+            monitor->position_x, monitor->position_y, monitor->refresh_hz);
+    free(name_json);
+}
+
+void write_topology_change_fields(FILE* out, TopologyChangeType type, const MonitorInfo* monitor) {
+    switch (type) {
+        case TOPOLOGY_CHANGE_ORIENTATION:
+            fprintf(out, "{\"orientation\":%lu}", get_orientation_degrees(monitor->orientation));
+            break;
+        case TOPOLOGY_CHANGE_RESOLUTION:
+            fprintf(out, "{\"width\":%lu,\"height\":%lu}", monitor->width, monitor->height);
+            break;
+        case TOPOLOGY_CHANGE_POSITION:
+            fprintf(out, "{\"x\":%ld,\"y\":%ld}", monitor->position_x, monitor->position_y);
+            break;
+        case TOPOLOGY_CHANGE_REFRESH:
+            fprintf(out, "{\"refresh_hz\":%lu}", monitor->refresh_hz);
+            break;
+        default:
+            write_monitor_state(out, monitor);
+            break;
+    }
+}
+
+// Topology fingerprint
+// Strings include their terminator so adjacent fields cannot run together
+static ULONG64 fingerprint_string(ULONG64 hash, const char* value) {
+    if (!value) value = "";
+    return hash_bytes(hash, value, strlen(value) + 1);
+}
+
+ULONG64 topology_fingerprint(const MonitorList* monitors) {
+    ULONG64 hash = HASH_SEED;
+    if (!monitors) return hash;
+
+    for (int i = 0; i < monitors->count; i++) {
+        const MonitorInfo* monitor = &monitors->monitors[i];
+        DWORD fields[4] = { monitor->width, monitor->height, monitor->orientation, monitor->refresh_hz };
+        LONG position[2] = { monitor->position_x, monitor->position_y };
+
+        hash = fingerprint_string(hash, monitor->device_path);
+        hash = fingerprint_string(hash, monitor->stable_id);
+        hash = hash_bytes(hash, position, sizeof(position));
+        hash = hash_bytes(hash, fields, sizeof(fields));
+    }
+
+    return hash;
+}
@@ -0,0 +1,54 @@
+#ifndef DIFF_H
+#define DIFF_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include "enum.h"
+
+// Topology change kinds, in the order they are reported for one monitor
+typedef enum {
+    TOPOLOGY_CHANGE_REMOVED,
+    TOPOLOGY_CHANGE_ADDED,
+    TOPOLOGY_CHANGE_ORIENTATION,
+    TOPOLOGY_CHANGE_RESOLUTION,
+    TOPOLOGY_CHANGE_POSITION,
+    TOPOLOGY_CHANGE_REFRESH
+} TopologyChangeType;
+
+typedef struct {
+    TopologyChangeType type;
+    const MonitorInfo* before;  // NULL for TOPOLOGY_CHANGE_ADDED
+    const MonitorInfo* after;   // NULL for TOPOLOGY_CHANGE_REMOVED
+} TopologyChange;
+
+typedef struct {
+    TopologyChange* changes;
+    int count;
+    int removed_count;      // Monitors, not changes
+    int added_count;
+    int changed_count;      // Monitors present on both sides with any field change
+} TopologyDiff;
+
+// Matches monitors by stable ID through the lists' hash indexes, so M#
+// renumbering after a hotplug is not reported as a change. Monitors without
+// a stable ID (hand-written topology files) are matched by device path.
+// Lists without an index fall back to linear scans. Removals come first in
+// the old enumeration order, then additions and field changes in the new
+// order. Refresh changes are reported only when both rates are explicit
+// (above 1). The diff points into both lists, which must outlive it.
+TopologyDiff* diff_topologies(const MonitorList* before, const MonitorList* after);
+void free_topology_diff(TopologyDiff* diff);
+
+const char* get_topology_change_name(TopologyChangeType type);
+
+// Writes the JSON object for one side of a change: the changed fields only,
+// or the whole monitor state for additions and removals
+void write_topology_change_fields(FILE* out, TopologyChangeType type, const MonitorInfo* monitor);
+
+// 64-bit FNV-1a over every monitor's device path, stable ID, position,
+// resolution, orientation and refresh rate, in enumeration order. Equal
+// fingerprints mean a plan resolved against one topology still addresses
+// the same panels in the same state on the other.
+ULONG64 topology_fingerprint(const MonitorList* monitors);
+
+#endif // DIFF_H
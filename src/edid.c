@@ -0,0 +1,681 @@
+#include "edid.h"
+#include "util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+static const BYTE EDID_HEADER[8] = { 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00 };
+
+// EDID sources. A monitor interface name maps to a source key (registry
+// path or sysfs file) and a change stamp; a stamp of 0 means the source has
+// none and is read on every lookup, with only the parse cached.
+typedef struct {
+    char key[256];
+    ULONG64 stamp;
+#ifdef _WIN32
+    HKEY handle;
+#endif
+} EdidSource;
+
+#ifdef _WIN32
+// "\\?\DISPLAY#DEL4085#5&2a2e1c6&0&UID4354#{e6f07b5f-...}" maps to
+// "SYSTEM\CurrentControlSet\Enum\DISPLAY\DEL4085\5&2a2e1c6&0&UID4354\Device Parameters"
+static bool interface_name_to_registry_path(const char* interface_name, char* path, size_t path_size) {
+    const char* prefix = "SYSTEM\\CurrentControlSet\\Enum\\";
+    const char* suffix = "\\Device Parameters";
+
+    const char* start = interface_name;
+    if (str_starts_with(start, "\\\\?\\")) {
+        start += 4;
+    }
+
+    const char* end = strstr(start, "#{");
+    if (!end || end == start) return false;
+
+    size_t instance_len = end - start;
+    if (strlen(prefix) + instance_len + strlen(suffix) + 1 > path_size) return false;
+
+    size_t pos = 0;
+    memcpy(path, prefix, strlen(prefix));
+    pos += strlen(prefix);
+
+    for (size_t i = 0; i < instance_len; i++) {
+        path[pos++] = (start[i] == '#') ? '\\' : start[i];
+    }
+
+    memcpy(path + pos, suffix, strlen(suffix) + 1);
+    return true;
+}
+
+static bool edid_source_open(const char* monitor_interface_name, EdidSource* source) {
+    memset(source, 0, sizeof(EdidSource));
+    if (!interface_name_to_registry_path(monitor_interface_name, source->key, sizeof(source->key))) {
+        log_verbose("Unrecognized monitor interface name: %s", monitor_interface_name);
+        return false;
+    }
+
+    LSTATUS status = RegOpenKeyExA(HKEY_LOCAL_MACHINE, source->key, 0, KEY_READ, &source->handle);
+    if (status != ERROR_SUCCESS) {
+        log_verbose("Cannot open %s (registry status %ld)", source->key, status);
+        return false;
+    }
+
+    FILETIME last_write = { 0, 0 };
+    if (RegQueryInfoKeyA(source->handle, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+                         &last_write) == ERROR_SUCCESS) {
+        source->stamp = ((ULONG64)last_write.dwHighDateTime << 32) | last_write.dwLowDateTime;
+    }
+    return true;
+}
+
+static DWORD edid_source_read(EdidSource* source, BYTE* buffer, DWORD buffer_size) {
+    DWORD type = 0;
+    DWORD size = buffer_size;
+    LSTATUS status = RegQueryValueExA(source->handle, "EDID", NULL, &type, buffer, &size);
+    if (status != ERROR_SUCCESS || type != REG_BINARY) {
+        log_verbose("No EDID value (registry status %ld)", status);
+        return 0;
+    }
+    return size;
+}
+
+static void edid_source_close(EdidSource* source) {
+    RegCloseKey(source->handle);
+}
+#else
+// DRM connectors under /sys/class/drm (MOSDEF_DRM_ROOT overrides the root).
+// The instance segment of the interface name is the connector, so
+// "\\?\DISPLAY#DEL4085#card0-DP-1#{...}" reads /sys/class/drm/card0-DP-1/edid.
+// sysfs attributes carry no change time, so the stamp stays 0.
+static bool edid_source_open(const char* monitor_interface_name, EdidSource* source) {
+    memset(source, 0, sizeof(EdidSource));
+
+    const char* start = strchr(monitor_interface_name, '#');
+    start = start ? strchr(start + 1, '#') : NULL;
+    const char* end = start ? strchr(start + 1, '#') : NULL;
+    if (!end || end == start + 1 || memchr(start + 1, '/', end - start - 1)) {
+        log_verbose("Unrecognized monitor interface name: %s", monitor_interface_name);
+        return false;
+    }
+
+    const char* root = getenv("MOSDEF_DRM_ROOT");
+    if (!root || !*root) root = "/sys/class/drm";
+    int length = snprintf(source->key, sizeof(source->key), "%s/%.*s/edid", root,
+                          (int)(end - start - 1), start + 1);
+    return length > 0 && (size_t)length < sizeof(source->key);
+}
+
+static DWORD edid_source_read(EdidSource* source, BYTE* buffer, DWORD buffer_size) {
+    FILE* file = NULL;
+    if (fopen_s(&file, source->key, "rb") != 0 || !file) {
+        log_verbose("Cannot open %s", source->key);
+        return 0;
+    }
+
+    // Disconnected connectors expose an empty attribute
+    size_t size = fread(buffer, 1, buffer_size, file);
+    fclose(file);
+    if (size < EDID_BLOCK_SIZE) {
+        log_verbose("No EDID in %s", source->key);
+        return 0;
+    }
+    return (DWORD)size;
+}
+
+static void edid_source_close(EdidSource* source) {
+    (void)source;
+}
+#endif
+
+DWORD edid_read_for_monitor(const char* monitor_interface_name, BYTE* buffer, DWORD buffer_size) {
+    if (!monitor_interface_name || !buffer || buffer_size < EDID_BLOCK_SIZE) return 0;
+
+    EdidSource source;
+    if (!edid_source_open(monitor_interface_name, &source)) return 0;
+
+    DWORD size = edid_source_read(&source, buffer, buffer_size);
+    edid_source_close(&source);
+    return size;
+}
+
+// Parsing
+bool edid_parse_identity(const BYTE* edid, DWORD size, EdidIdentity* identity) {
+    if (!edid || !identity || size < EDID_BLOCK_SIZE) return false;
+    if (memcmp(edid, EDID_HEADER, sizeof(EDID_HEADER)) != 0) return false;
+
+    memset(identity, 0, sizeof(EdidIdentity));
+
+    // Manufacturer: three 5-bit letters, big-endian ('A' == 1)
+    WORD packed = (WORD)((edid[8] << 8) | edid[9]);
+    identity->manufacturer[0] = (char)('A' - 1 + ((packed >> 10) & 0x1F));
+    identity->manufacturer[1] = (char)('A' - 1 + ((packed >> 5) & 0x1F));
+    identity->manufacturer[2] = (char)('A' - 1 + (packed & 0x1F));
+    identity->manufacturer[3] = '\0';
+
+    identity->product_code = (WORD)(edid[10] | (edid[11] << 8));
+    identity->serial_number = (DWORD)edid[12] | ((DWORD)edid[13] << 8) |
+                              ((DWORD)edid[14] << 16) | ((DWORD)edid[15] << 24);
+
+    // Display descriptors at 54, 72, 90, 108; tag 0xFF is the serial string
+    for (int offset = 54; offset <= 108; offset += 18) {
+        const BYTE* descriptor = edid + offset;
+        if (descriptor[0] != 0 || descriptor[1] != 0 || descriptor[3] != 0xFF) continue;
+
+        int len = 0;
+        for (int i = 5; i < 18 && descriptor[i] != 0x0A && descriptor[i] != 0x00; i++) {
+            identity->serial_string[len++] = (char)descriptor[i];
+        }
+        identity->serial_string[len] = '\0';
+        str_trim(identity->serial_string);
+        break;
+    }
+
+    return true;
+}
+
+static bool block_checksum_valid(const BYTE* block) {
+    BYTE sum = 0;
+    for (int i = 0; i < EDID_BLOCK_SIZE; i++) {
+        sum = (BYTE)(sum + block[i]);
+    }
+    return sum == 0;
+}
+
+static void copy_descriptor_text(const BYTE* text, int max_len, char* out, size_t out_size) {
+    size_t len = 0;
+    for (int i = 0; i < max_len && len + 1 < out_size; i++) {
+        if (text[i] == 0x0A || text[i] == 0x00) break;
+        out[len++] = (text[i] >= 0x20 && text[i] < 0x7F) ? (char)text[i] : '?';
+    }
+    out[len] = '\0';
+
+    while (len > 0 && out[len - 1] == ' ') {
+        out[--len] = '\0';
+    }
+}
+
+// 18-byte detailed timing descriptor shared by the base block and CTA-861
+static bool parse_detailed_timing(const BYTE* dtd, EdidInfo* info, bool set_size) {
+    DWORD pixel_clock_10khz = (DWORD)dtd[0] | ((DWORD)dtd[1] << 8);
+    if (pixel_clock_10khz == 0) return false; // Display descriptor, not a timing
+
+    DWORD h_active = dtd[2] | ((DWORD)(dtd[4] & 0xF0) << 4);
+    DWORD h_blank = dtd[3] | ((DWORD)(dtd[4] & 0x0F) << 8);
+    DWORD v_active = dtd[5] | ((DWORD)(dtd[7] & 0xF0) << 4);
+    DWORD v_blank = dtd[6] | ((DWORD)(dtd[7] & 0x0F) << 8);
+    if (h_active == 0 || v_active == 0) return false;
+
+    info->native_width = h_active;
+    info->native_height = v_active;
+
+    ULONG64 total = (ULONG64)(h_active + h_blank) * (v_active + v_blank);
+    if (total > 0) {
+        info->native_refresh_hz = (DWORD)(((ULONG64)pixel_clock_10khz * 10000 + total / 2) / total);
+    }
+
+    if (set_size) {
+        DWORD h_mm = dtd[12] | ((DWORD)(dtd[14] & 0xF0) << 4);
+        DWORD v_mm = dtd[13] | ((DWORD)(dtd[14] & 0x0F) << 8);
+        if (h_mm > 0 && v_mm > 0) {
+            info->width_mm = h_mm;
+            info->height_mm = v_mm;
+        }
+    }
+    return true;
+}
+
+// Native resolutions for common CTA-861 video identification codes
+static bool lookup_vic(BYTE vic, DWORD* width, DWORD* height, DWORD* refresh) {
+    static const struct { BYTE vic; WORD width; WORD height; BYTE refresh; } vics[] = {
+        { 1, 640, 480, 60 },    { 4, 1280, 720, 60 },   { 16, 1920, 1080, 60 },
+        { 19, 1280, 720, 50 },  { 31, 1920, 1080, 50 }, { 32, 1920, 1080, 24 },
+        { 34, 1920, 1080, 30 }, { 63, 1920, 1080, 120 },{ 93, 3840, 2160, 24 },
+        { 95, 3840, 2160, 30 }, { 96, 3840, 2160, 50 }, { 97, 3840, 2160, 60 },
+        { 117, 3840, 2160, 100 },{ 118, 3840, 2160, 120 },{ 194, 7680, 4320, 24 },
+        { 199, 7680, 4320, 60 },
+    };
+
+    for (size_t i = 0; i < sizeof(vics) / sizeof(vics[0]); i++) {
+        if (vics[i].vic == vic) {
+            *width = vics[i].width;
+            *height = vics[i].height;
+            *refresh = vics[i].refresh;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void parse_cta_extension(const BYTE* block, EdidInfo* info) {
+    info->has_cta_extension = true;
+
+    BYTE dtd_offset = block[2];
+    if (dtd_offset < 4 || dtd_offset > 127) dtd_offset = 127;
+
+    // Data block collection: only consulted when the base block had no preferred timing
+    for (int pos = 4; pos < dtd_offset;) {
+        BYTE tag = block[pos] >> 5;
+        BYTE len = block[pos] & 0x1F;
+        if (pos + 1 + len > dtd_offset) break;
+
+        if (tag == 2 && info->native_width == 0) { // Video data block
+            for (int i = 0; i < len; i++) {
+                BYTE svd = block[pos + 1 + i];
+                bool native = (svd & 0x80) && (svd & 0x7F) <= 64;
+                BYTE vic = native ? (svd & 0x7F) : svd;
+                if (native || i == 0) {
+                    lookup_vic(vic, &info->native_width, &info->native_height, &info->native_refresh_hz);
+                    if (native) break;
+                }
+            }
+        }
+        pos += 1 + len;
+    }
+
+    // Detailed timings after the data block collection
+    if (info->native_width == 0) {
+        for (int pos = dtd_offset; pos + 18 <= 127; pos += 18) {
+            if (parse_detailed_timing(block + pos, info, info->width_mm == 0)) break;
+        }
+    }
+}
+
+static void parse_displayid_extension(const BYTE* block, EdidInfo* info) {
+    info->has_displayid_extension = true;
+
+    // Extension tag 0x70, then the DisplayID section header
+    const BYTE* section = block + 1;
+    BYTE version = section[0];
+    int section_bytes = section[1];
+    if (section_bytes > EDID_BLOCK_SIZE - 1 - 5) {
+        section_bytes = EDID_BLOCK_SIZE - 1 - 5;
+    }
+
+    const BYTE* data = section + 4;
+    for (int pos = 0; pos + 3 <= section_bytes;) {
+        BYTE tag = data[pos];
+        BYTE payload_len = data[pos + 2];
+        const BYTE* payload = data + pos + 3;
+        if (pos + 3 + payload_len > section_bytes) break;
+
+        switch (tag) {
+            case 0x00:   // Product identification (1.x)
+            case 0x20: { // Product identification (2.x)
+                if (payload_len >= 12 && info->model_name[0] == '\0') {
+                    BYTE name_len = payload[11];
+                    if (12 + name_len <= payload_len) {
+                        copy_descriptor_text(payload + 12, name_len, info->model_name, sizeof(info->model_name));
+                    }
+                }
+                break;
+            }
+            case 0x01:   // Display parameters (1.x), sizes in 0.1 mm
+            case 0x21: { // Display parameters (2.x)
+                if (payload_len >= 8) {
+                    DWORD h_size = payload[0] | ((DWORD)payload[1] << 8);
+                    DWORD v_size = payload[2] | ((DWORD)payload[3] << 8);
+                    DWORD h_pixels = payload[4] | ((DWORD)payload[5] << 8);
+                    DWORD v_pixels = payload[6] | ((DWORD)payload[7] << 8);
+                    if (h_size > 0 && v_size > 0) {
+                        info->width_mm = (h_size + 5) / 10;
+                        info->height_mm = (v_size + 5) / 10;
+                    }
+                    if (h_pixels > 0 && v_pixels > 0) {
+                        info->native_width = h_pixels;
+                        info->native_height = v_pixels;
+                    }
+                }
+                break;
+            }
+            case 0x03:   // Type I detailed timing (1.x)
+            case 0x22: { // Type VII detailed timing (2.x)
+                for (int t = 0; t + 20 <= payload_len; t += 20) {
+                    const BYTE* timing = payload + t;
+                    bool preferred = (timing[3] & 0x80) != 0;
+                    if (!preferred && info->native_width != 0) continue;
+
+                    DWORD clock = timing[0] | ((DWORD)timing[1] << 8) | ((DWORD)timing[2] << 16);
+                    DWORD h_active = (timing[4] | ((DWORD)timing[5] << 8)) + 1;
+                    DWORD h_blank = (timing[6] | ((DWORD)timing[7] << 8)) + 1;
+                    DWORD v_active = (timing[12] | ((DWORD)timing[13] << 8)) + 1;
+                    DWORD v_blank = (timing[14] | ((DWORD)timing[15] << 8)) + 1;
+
+                    info->native_width = h_active;
+                    info->native_height = v_active;
+
+                    // Type I counts the clock in 10 kHz units, type VII in 1 kHz units
+                    ULONG64 hz = (ULONG64)(clock + 1) * (tag == 0x03 ? 10000 : 1000);
+                    ULONG64 total = (ULONG64)(h_active + h_blank) * (v_active + v_blank);
+                    if (total > 0) {
+                        info->native_refresh_hz = (DWORD)((hz + total / 2) / total);
+                    }
+                    if (preferred) break;
+                }
+                break;
+            }
+            default:
+                break;
+        }
+
+        pos += 3 + payload_len;
+    }
+
+    (void)version;
+}
+
+bool edid_parse(const BYTE* edid, DWORD size, EdidInfo* info) {
+    if (!edid || !info) return false;
+
+    memset(info, 0, sizeof(EdidInfo));
+    if (!edid_parse_identity(edid, size, &info->identity)) return false;
+
+    info->version = edid[18];
+    info->revision = edid[19];
+    info->checksum_valid = block_checksum_valid(edid);
+
+    // Week 0xFF means byte 17 is a model year
+    info->manufacture_week = (edid[16] == 0xFF) ? 0 : edid[16];
+    info->manufacture_year = (WORD)(edid[17] + 1990);
+
+    // Base block size in cm, refined by the preferred timing's mm size
+    info->width_mm = edid[21] * 10;
+    info->height_mm = edid[22] * 10;
+
+    // First detailed timing is the preferred mode
+    for (int offset = 54; offset <= 108; offset += 18) {
+        const BYTE* descriptor = edid + offset;
+        if (offset == 54 && parse_detailed_timing(descriptor, info, true)) {
+            continue;
+        }
+        if (descriptor[0] == 0 && descriptor[1] == 0 && descriptor[3] == 0xFC) {
+            copy_descriptor_text(descriptor + 5, 13, info->model_name, sizeof(info->model_name));
+        }
+    }
+
+    // Extension blocks that actually arrived
+    int declared = edid[126];
+    int available = (int)(size / EDID_BLOCK_SIZE) - 1;
+    info->extension_count = (declared < available) ? declared : available;
+
+    for (int i = 1; i <= info->extension_count; i++) {
+        const BYTE* block = edid + i * EDID_BLOCK_SIZE;
+        if (!block_checksum_valid(block)) {
+            info->checksum_valid = false;
+        }
+
+        switch (block[0]) {
+            case 0x02: parse_cta_extension(block, info); break;
+            case 0x70: parse_displayid_extension(block, info); break;
+            default: break;
+        }
+    }
+
+    return true;
+}
+
+ULONG64 edid_content_hash(const BYTE* edid, DWORD size) {
+    ULONG64 hash = 14695981039346656037ULL; // FNV-1a 64
+    for (DWORD i = 0; i < size; i++) {
+        hash ^= edid[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Process-wide caches: source key -> content hash, content hash -> parsed
+// info. Open addressing with linear probing, kept at most half full; past
+// that the least recently used entry is evicted.
+#define EDID_CACHE_SLOTS 128
+#define EDID_CACHE_LIMIT (EDID_CACHE_SLOTS / 2)
+#define EDID_SLOT_MASK (EDID_CACHE_SLOTS - 1)
+
+typedef struct {
+    bool used;
+    char source[256];
+    ULONG64 stamp;
+    ULONG64 content_hash;
+    volatile LONG64 last_used;
+} EdidPathEntry;
+
+typedef struct {
+    bool used;
+    ULONG64 content_hash;
+    EdidInfo info;
+    volatile LONG64 last_used;
+} EdidInfoEntry;
+
+static SRWLOCK g_edid_cache_lock = SRWLOCK_INIT;
+static EdidPathEntry g_path_cache[EDID_CACHE_SLOTS];
+static EdidInfoEntry g_info_cache[EDID_CACHE_SLOTS];
+static int g_path_cache_count = 0;
+static int g_info_cache_count = 0;
+static volatile LONG64 g_cache_clock = 0;
+static volatile LONG64 g_cache_lookups = 0;
+static volatile LONG64 g_cache_parses = 0;
+static volatile LONG64 g_cache_evictions = 0;
+
+static DWORD path_slot(const char* path) {
+    return (DWORD)edid_content_hash((const BYTE*)path, (DWORD)strlen(path)) & EDID_SLOT_MASK;
+}
+
+static DWORD info_slot(ULONG64 content_hash) {
+    return (DWORD)content_hash & EDID_SLOT_MASK;
+}
+
+// Hits happen under the shared lock, hence the interlocked stamp
+static void touch(volatile LONG64* last_used) {
+    InterlockedExchange64(last_used, InterlockedIncrement64(&g_cache_clock));
+}
+
+// Callers hold the lock (shared or exclusive)
+static EdidPathEntry* find_path_entry(const char* path) {
+    for (DWORD slot = path_slot(path), n = 0; n < EDID_CACHE_SLOTS; slot = (slot + 1) & EDID_SLOT_MASK, n++) {
+        if (!g_path_cache[slot].used) return NULL;
+        if (strcmp(g_path_cache[slot].source, path) == 0) return &g_path_cache[slot];
+    }
+    return NULL;
+}
+
+static EdidInfoEntry* find_info_entry(ULONG64 content_hash) {
+    for (DWORD slot = info_slot(content_hash), n = 0; n < EDID_CACHE_SLOTS; slot = (slot + 1) & EDID_SLOT_MASK, n++) {
+        if (!g_info_cache[slot].used) return NULL;
+        if (g_info_cache[slot].content_hash == content_hash) return &g_info_cache[slot];
+    }
+    return NULL;
+}
+
+// Whether an entry whose home slot is home must stay put rather than fill
+// the hole, i.e. home lies cyclically in (hole, slot]
+static bool probe_stays(DWORD home, DWORD hole, DWORD slot) {
+    return hole <= slot ? (hole < home && home <= slot) : (hole < home || home <= slot);
+}
+
+// Eviction closes the gap by shifting later entries of the probe run back,
+// so lookups never stop early at the freed slot. Callers hold the lock
+// exclusively.
+static void evict_path_entry(void) {
+    DWORD hole = 0;
+    for (DWORD slot = 1; slot < EDID_CACHE_SLOTS; slot++) {
+        if (g_path_cache[slot].used &&
+            (!g_path_cache[hole].used || g_path_cache[slot].last_used < g_path_cache[hole].last_used)) {
+            hole = slot;
+        }
+    }
+
+    for (DWORD slot = (hole + 1) & EDID_SLOT_MASK; g_path_cache[slot].used; slot = (slot + 1) & EDID_SLOT_MASK) {
+        if (probe_stays(path_slot(g_path_cache[slot].source), hole, slot)) continue;
+        g_path_cache[hole] = g_path_cache[slot];
+        hole = slot;
+    }
+    memset(&g_path_cache[hole], 0, sizeof(g_path_cache[hole]));
+    g_path_cache_count--;
+    InterlockedIncrement64(&g_cache_evictions);
+}
+
+static void evict_info_entry(void) {
+    DWORD hole = 0;
+    for (DWORD slot = 1; slot < EDID_CACHE_SLOTS; slot++) {
+        if (g_info_cache[slot].used &&
+            (!g_info_cache[hole].used || g_info_cache[slot].last_used < g_info_cache[hole].last_used)) {
+            hole = slot;
+        }
+    }
+
+    for (DWORD slot = (hole + 1) & EDID_SLOT_MASK; g_info_cache[slot].used; slot = (slot + 1) & EDID_SLOT_MASK) {
+        if (probe_stays(info_slot(g_info_cache[slot].content_hash), hole, slot)) continue;
+        g_info_cache[hole] = g_info_cache[slot];
+        hole = slot;
+    }
+    memset(&g_info_cache[hole], 0, sizeof(g_info_cache[hole]));
+    g_info_cache_count--;
+    InterlockedIncrement64(&g_cache_evictions);
+}
+
+// Callers hold the lock exclusively
+static void store_entries(const char* path, ULONG64 stamp, ULONG64 content_hash, const EdidInfo* info) {
+    EdidInfoEntry* info_entry = find_info_entry(content_hash);
+    if (info && !info_entry) {
+        if (g_info_cache_count >= EDID_CACHE_LIMIT) evict_info_entry();
+
+        DWORD slot = info_slot(content_hash);
+        while (g_info_cache[slot].used) slot = (slot + 1) & EDID_SLOT_MASK;
+        info_entry = &g_info_cache[slot];
+        info_entry->used = true;
+        info_entry->content_hash = content_hash;
+        info_entry->info = *info;
+        g_info_cache_count++;
+    }
+    if (info_entry) touch(&info_entry->last_used);
+
+    // Sources without a change stamp are re-read anyway
+    if (stamp == 0 || strlen(path) >= sizeof(g_path_cache[0].source)) return;
+
+    EdidPathEntry* entry = find_path_entry(path);
+    if (!entry) {
+        if (g_path_cache_count >= EDID_CACHE_LIMIT) evict_path_entry();
+
+        DWORD slot = path_slot(path);
+        while (g_path_cache[slot].used) slot = (slot + 1) & EDID_SLOT_MASK;
+        entry = &g_path_cache[slot];
+        entry->used = true;
+        strcpy_s(entry->source, sizeof(entry->source), path);
+        g_path_cache_count++;
+    }
+    entry->stamp = stamp;
+    entry->content_hash = content_hash;
+    touch(&entry->last_used);
+}
+
+bool edid_lookup_monitor(const char* monitor_interface_name, EdidInfo* info) {
+    if (!monitor_interface_name || !info) return false;
+
+    EdidSource source;
+    if (!edid_source_open(monitor_interface_name, &source)) return false;
+
+    // Fast path: source unchanged since we last read it
+    if (source.stamp != 0) {
+        AcquireSRWLockShared(&g_edid_cache_lock);
+        EdidPathEntry* path_entry = find_path_entry(source.key);
+        if (path_entry && path_entry->stamp == source.stamp) {
+            EdidInfoEntry* info_entry = find_info_entry(path_entry->content_hash);
+            if (info_entry) {
+                *info = info_entry->info;
+                touch(&path_entry->last_used);
+                touch(&info_entry->last_used);
+                ReleaseSRWLockShared(&g_edid_cache_lock);
+                edid_source_close(&source);
+                InterlockedIncrement64(&g_cache_lookups);
+                return true;
+            }
+        }
+        ReleaseSRWLockShared(&g_edid_cache_lock);
+    }
+
+    BYTE* edid = (BYTE*)malloc(EDID_MAX_SIZE);
+    if (!edid) {
+        edid_source_close(&source);
+        return false;
+    }
+
+    DWORD size = edid_source_read(&source, edid, EDID_MAX_SIZE);
+    edid_source_close(&source);
+
+    bool found = false;
+    if (size > 0) {
+        ULONG64 content_hash = edid_content_hash(edid, size);
+
+        AcquireSRWLockShared(&g_edid_cache_lock);
+        EdidInfoEntry* info_entry = find_info_entry(content_hash);
+        if (info_entry) {
+            *info = info_entry->info;
+            found = true;
+        }
+        ReleaseSRWLockShared(&g_edid_cache_lock);
+
+        if (!found) {
+            InterlockedIncrement64(&g_cache_parses);
+            found = edid_parse(edid, size, info);
+            if (found && !info->checksum_valid) {
+                log_verbose("EDID checksum mismatch for %s, using parsed data anyway", source.key);
+            }
+        }
+
+        if (found) {
+            AcquireSRWLockExclusive(&g_edid_cache_lock);
+            store_entries(source.key, source.stamp, content_hash, info);
+            ReleaseSRWLockExclusive(&g_edid_cache_lock);
+            InterlockedIncrement64(&g_cache_lookups);
+        }
+    }
+
+    free(edid);
+    return found;
+}
+
+void edid_cache_clear() {
+    AcquireSRWLockExclusive(&g_edid_cache_lock);
+    memset(g_path_cache, 0, sizeof(g_path_cache));
+    memset(g_info_cache, 0, sizeof(g_info_cache));
+    g_path_cache_count = 0;
+    g_info_cache_count = 0;
+    InterlockedExchange64(&g_cache_lookups, 0);
+    InterlockedExchange64(&g_cache_parses, 0);
+    InterlockedExchange64(&g_cache_evictions, 0);
+    ReleaseSRWLockExclusive(&g_edid_cache_lock);
+}
+
+EdidCacheStats edid_cache_get_stats() {
+    EdidCacheStats stats;
+    stats.lookups = ReadAcquire64(&g_cache_lookups);
+    stats.parses = ReadAcquire64(&g_cache_parses);
+    stats.evictions = ReadAcquire64(&g_cache_evictions);
+    return stats;
+}
+
+void edid_format_stable_id(const EdidIdentity* identity, char* buffer, size_t buffer_size) {
+    if (!buffer || buffer_size == 0) return;
+
+    if (identity->serial_number != 0) {
+        sprintf_s(buffer, buffer_size, "%s%04X-%08lX", identity->manufacturer,
+                  identity->product_code, (unsigned long)identity->serial_number);
+        return;
+    }
+
+    // Fall back to the printable serial descriptor, keeping only [A-Z0-9]
+    char serial[sizeof(identity->serial_string)];
+    size_t len = 0;
+    for (const char* p = identity->serial_string; *p; p++) {
+        if (isalnum((unsigned char)*p)) {
+            serial[len++] = (char)toupper((unsigned char)*p);
+        }
+    }
+    serial[len] = '\0';
+
+    if (len > 0) {
+        sprintf_s(buffer, buffer_size, "%s%04X-%s", identity->manufacturer,
+                  identity->product_code, serial);
+    } else {
+        sprintf_s(buffer, buffer_size, "%s%04X", identity->manufacturer, identity->product_code);
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef EDID_H
+#define EDID_H
+
+#include <windows.h>
+#include <stdbool.h>
+
+#define EDID_BLOCK_SIZE 128
+#define EDID_MAX_SIZE (EDID_BLOCK_SIZE * 256)
+
+// Panel identity from the EDID base block
+typedef struct {
+    char manufacturer[4];     // PNP ID, e.g. "DEL"
+    WORD product_code;
+    DWORD serial_number;      // 0 when the panel does not report one
+    char serial_string[14];   // Display descriptor 0xFF, empty if absent
+} EdidIdentity;
+
+// Parsed EDID (base block plus CTA-861 and DisplayID extensions)
+typedef struct {
+    EdidIdentity identity;
+    BYTE version;
+    BYTE revision;
+    WORD manufacture_year;    // 0 if unknown
+    BYTE manufacture_week;
+    char model_name[14];      // Display descriptor 0xFC or DisplayID product name
+    DWORD width_mm;           // Physical image size, 0 if unknown
+    DWORD height_mm;
+    DWORD native_width;       // Preferred timing, 0 if unknown
+    DWORD native_height;
+    DWORD native_refresh_hz;
+    int extension_count;      // Extension blocks actually present
+    bool has_cta_extension;
+    bool has_displayid_extension;
+    bool checksum_valid;      // All present blocks sum to zero
+} EdidInfo;
+
+// Reads the raw EDID for a monitor-level device interface name
+// (EnumDisplayDevicesA with EDD_GET_DEVICE_INTERFACE_NAME).
+// Returns the number of bytes read, or 0 if no EDID is available.
+DWORD edid_read_for_monitor(const char* monitor_interface_name, BYTE* buffer, DWORD buffer_size);
+
+// Parsing
+bool edid_parse_identity(const BYTE* edid, DWORD size, EdidIdentity* identity);
+bool edid_parse(const BYTE* edid, DWORD size, EdidInfo* info);
+ULONG64 edid_content_hash(const BYTE* edid, DWORD size);
+
+// Cached lookup by monitor interface name. Unchanged registry keys are not
+// re-read (sysfs has no change stamp and is always re-read), and identical blobs (same content hash) are parsed only once per
+// process. Thread-safe.
+bool edid_lookup_monitor(const char* monitor_interface_name, EdidInfo* info);
+void edid_cache_clear();
+
+// Cache counters since the last edid_cache_clear
+typedef struct {
+    LONG64 lookups;           // edid_lookup_monitor calls that found an EDID
+    LONG64 parses;            // Blobs parsed because no cached info matched
+    LONG64 evictions;         // Least recently used entries dropped to make room
+} EdidCacheStats;
+
+EdidCacheStats edid_cache_get_stats();
+
+// Formats a stable identifier such as "DEL4085-1A2B3C4D". Panels without a
+// serial number yield just manufacturer and product ("DEL4085").
+void edid_format_stable_id(const EdidIdentity* identity, char* buffer, size_t buffer_size);
+
+#endif // EDID_H
@@ -1,8 +1,141 @@
 #include "enum.h"
 #include "util.h"
+#include "edid.h"
+#include "selexpr.h"
+#include "strsearch.h"
+#include "diff.h"
+#include "groups.h"
+#include "montable.h"
+#include "modeldb.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
+
+struct MonitorIndex {
+    int mask;
+    int* id_slots;          // Monitor index + 1, 0 = empty
+    int* stable_id_slots;
+    int* device_path_slots;
+    ULONG64 fingerprint;    // topology_fingerprint at build time
+
+    // Device and model names interned once, lower-cased, NUL-separated and
+    // padded for vector loads (strsearch.h)
+    char* names;
+    int* name_offsets;      // name_count + 1 entries
+    int name_count;
+    int* device_name_ids;   // Per monitor
+    int* model_name_ids;
+
+    MonitorTable* table;    // Columnar copy for scans, see montable.h
+};
+
+typedef enum {
+    INDEX_KEY_ID,
+    INDEX_KEY_STABLE_ID,
+    INDEX_KEY_DEVICE_PATH
+} IndexKey;
+
+static void free_monitor_index(MonitorIndex* index, const MosDefAllocator* allocator);
+
+static void free_monitor_fields(MonitorInfo* monitor, const MosDefAllocator* allocator) {
+    mem_free(allocator, monitor->id);
+    mem_free(allocator, monitor->device_name);
+    mem_free(allocator, monitor->device_path);
+    mem_free(allocator, monitor->device_id);
+    mem_free(allocator, monitor->stable_id);
+    mem_free(allocator, monitor->monitor_interface);
+    mem_free(allocator, monitor->model_name);
+}
+
+// Stable identity: EDID manufacturer/product/serial, falling back to the
+// hardware ID embedded in the monitor interface name ("DISPLAY#DEL4085#...")
+static char* derive_stable_id(const char* monitor_interface, const EdidInfo* edid) {
+    char stable_id[64] = "UNKNOWN";
+
+    if (edid) {
+        edid_format_stable_id(&edid->identity, stable_id, sizeof(stable_id));
+    } else if (monitor_interface) {
+        const char* start = strchr(monitor_interface, '#');
+        const char* end = start ? strchr(start + 1, '#') : NULL;
+        if (end && end - start - 1 > 0 && (size_t)(end - start - 1) < sizeof(stable_id)) {
+            memcpy(stable_id, start + 1, end - start - 1);
+            stable_id[end - start - 1] = '\0';
+        }
+    }
+
+    return _strdup(stable_id);
+}
+
+// Connector instance of \\?\DISPLAY#<hardware id>#<instance>#{guid}: the
+// segment after the second '#'. It names the port, so unlike enumeration
+// order it is the same on every boot and reconnect.
+static const char* connector_instance(const char* monitor_interface, size_t* out_length) {
+    const char* start = monitor_interface ? strchr(monitor_interface, '#') : NULL;
+    start = start ? strchr(start + 1, '#') : NULL;
+    if (!start) {
+        *out_length = 0;
+        return "";
+    }
+    start++;
+    const char* end = strchr(start, '#');
+    *out_length = end ? (size_t)(end - start) : strlen(start);
+    return start;
+}
+
+// Orders identical panels by connector instance, then by device path
+static int compare_connectors(const MonitorInfo* a, const MonitorInfo* b) {
+    size_t a_length = 0;
+    size_t b_length = 0;
+    const char* a_instance = connector_instance(a->monitor_interface, &a_length);
+    const char* b_instance = connector_instance(b->monitor_interface, &b_length);
+
+    int result = strncmp(a_instance, b_instance, a_length < b_length ? a_length : b_length);
+    if (result == 0 && a_length != b_length) {
+        result = a_length < b_length ? -1 : 1;
+    }
+    if (result == 0) {
+        result = strcmp(a->device_path ? a->device_path : "", b->device_path ? b->device_path : "");
+    }
+    return result;
+}
+
+// Identical panels without serial numbers keep the bare ID on the lowest
+// connector and get "#2", "#3", ... on the others in connector order
+static void make_stable_ids_unique(MonitorList* list) {
+    if (list->count < 2) return;
+
+    int* ranks = (int*)calloc(list->count, sizeof(int));
+    if (!ranks) return;
+
+    bool any_duplicates = false;
+    for (int i = 0; i < list->count; i++) {
+        const MonitorInfo* monitor = &list->monitors[i];
+        for (int j = 0; j < list->count; j++) {
+            const MonitorInfo* other = &list->monitors[j];
+            if (j == i || strcmp(other->stable_id, monitor->stable_id) != 0) continue;
+
+            int order = compare_connectors(other, monitor);
+            if (order < 0 || (order == 0 && j < i)) {
+                ranks[i]++;
+            }
+            any_duplicates = true;
+        }
+    }
+
+    for (int i = 0; any_duplicates && i < list->count; i++) {
+        if (ranks[i] == 0) continue;
+
+        size_t len = strlen(list->monitors[i].stable_id) + 16;
+        char* unique_id = (char*)malloc(len);
+        if (!unique_id) continue;
+
+        sprintf_s(unique_id, len, "%s#%d", list->monitors[i].stable_id, ranks[i] + 1);
+        free(list->monitors[i].stable_id);
+        list->monitors[i].stable_id = unique_id;
+    }
+    free(ranks);
+}
 
 // Monitor enumeration
 MonitorList* enumerate_monitors() {
@@ -11,6 +144,7 @@ MonitorList* enumerate_monitors() {
 
     list->monitors = NULL;
     list->count = 0;
+    list->index = NULL;
 
     // Enumerate all display devices
     DISPLAY_DEVICEA display_device;
@@ -57,19 +191,47 @@ MonitorList* enumerate_monitors() {
             sprintf_s(monitor->id, id_len, "M%d", monitor_index);
         }
 
+        // Monitor-level device attached to this adapter output
+        DISPLAY_DEVICEA monitor_device;
+        memset(&monitor_device, 0, sizeof(DISPLAY_DEVICEA));
+        monitor_device.cb = sizeof(DISPLAY_DEVICEA);
+        if (!EnumDisplayDevicesA(display_device.DeviceName, 0, &monitor_device, EDD_GET_DEVICE_INTERFACE_NAME)) {
+            monitor_device.DeviceID[0] = '\0';
+        }
+
         // Copy device information
         monitor->device_name = _strdup(display_device.DeviceString);
         monitor->device_path = _strdup(display_device.DeviceName);
         monitor->device_id = _strdup(display_device.DeviceID);
+        monitor->monitor_interface = _strdup(monitor_device.DeviceID);
         monitor->width = devmode.dmPelsWidth;
         monitor->height = devmode.dmPelsHeight;
         monitor->orientation = devmode.dmDisplayOrientation;
-
-        if (!monitor->device_name || !monitor->device_path || !monitor->device_id) {
-            free(monitor->id);
-            free(monitor->device_name);
-            free(monitor->device_path);
-            free(monitor->device_id);
+        monitor->position_x = devmode.dmPosition.x;
+        monitor->position_y = devmode.dmPosition.y;
+        monitor->refresh_hz = devmode.dmDisplayFrequency;
+
+        // EDID is cached by source and content hash, so re-enumeration is cheap
+        EdidInfo edid;
+        bool has_edid = monitor_device.DeviceID[0] && edid_lookup_monitor(monitor_device.DeviceID, &edid);
+        monitor->stable_id = derive_stable_id(monitor_device.DeviceID[0] ? monitor_device.DeviceID : NULL,
+                                              has_edid ? &edid : NULL);
+        monitor->model_name = _strdup(has_edid ? edid.model_name : "");
+        monitor->native_width = has_edid ? edid.native_width : 0;
+        monitor->native_height = has_edid ? edid.native_height : 0;
+        monitor->width_mm = has_edid ? edid.width_mm : 0;
+        monitor->height_mm = has_edid ? edid.height_mm : 0;
+
+        // One probe into the mapped model database
+        ModelRecord model;
+        bool has_model = has_edid && model_db_lookup_default(edid.identity.manufacturer,
+                                                             edid.identity.product_code, &model);
+        monitor->preferred_orientation = has_model ? model.preferred_orientation : MODEL_ORIENTATION_NONE;
+        monitor->model_flags = has_model ? model.flags : 0;
+
+        if (!monitor->device_name || !monitor->device_path || !monitor->device_id ||
+            !monitor->monitor_interface || !monitor->stable_id || !monitor->model_name) {
+            free_monitor_fields(monitor, NULL);
             free(monitor);
             continue;
         }
@@ -77,10 +239,7 @@ MonitorList* enumerate_monitors() {
         // Add to list
         MonitorInfo* new_monitors = (MonitorInfo*)realloc(list->monitors, (list->count + 1) * sizeof(MonitorInfo));
         if (!new_monitors) {
-            free(monitor->id);
-            free(monitor->device_name);
-            free(monitor->device_path);
-            free(monitor->device_id);
+            free_monitor_fields(monitor, NULL);
             free(monitor);
             continue;
         }
@@ -91,29 +250,81 @@ MonitorList* enumerate_monitors() {
         list->count++;
         monitor_index++;
 
-        log_verbose("Enumerated monitor: ID=%s, Name='%s', Path='%s', Resolution=%dx%d, Orientation=%d",
+        log_verbose("Enumerated monitor: ID=%s, Name='%s', Path='%s', Stable ID=%s, Resolution=%dx%d, Orientation=%d",
                    list->monitors[list->count - 1].id,
                    list->monitors[list->count - 1].device_name,
                    list->monitors[list->count - 1].device_path,
+                   list->monitors[list->count - 1].stable_id,
                    list->monitors[list->count - 1].width,
                    list->monitors[list->count - 1].height,
                    list->monitors[list->count - 1].orientation);
     }
 
+    make_stable_ids_unique(list);
+    if (!build_monitor_index(list, NULL)) {
+        log_verbose("Failed to build monitor index, falling back to linear lookups");
+    }
+
     return list;
 }
 
 void free_monitor_list(MonitorList* list) {
+    free_monitor_list_with(list, NULL);
+}
+
+MonitorList* clone_monitor_list(const MonitorList* list, const MosDefAllocator* allocator) {
+    if (!list) return NULL;
+
+    MonitorList* copy = (MonitorList*)mem_alloc(allocator, sizeof(MonitorList));
+    if (!copy) return NULL;
+
+    copy->count = 0;
+    copy->monitors = NULL;
+    copy->index = NULL;
+    if (list->count == 0) {
+        return copy;
+    }
+
+    copy->monitors = (MonitorInfo*)mem_alloc(allocator, list->count * sizeof(MonitorInfo));
+    if (!copy->monitors) {
+        mem_free(allocator, copy);
+        return NULL;
+    }
+
+    for (int i = 0; i < list->count; i++) {
+        const MonitorInfo* src = &list->monitors[i];
+        MonitorInfo* dst = &copy->monitors[i];
+
+        *dst = *src;
+        dst->id = mem_strdup(allocator, src->id);
+        dst->device_name = mem_strdup(allocator, src->device_name);
+        dst->device_path = mem_strdup(allocator, src->device_path);
+        dst->device_id = mem_strdup(allocator, src->device_id);
+        dst->stable_id = mem_strdup(allocator, src->stable_id);
+        dst->monitor_interface = mem_strdup(allocator, src->monitor_interface);
+        dst->model_name = mem_strdup(allocator, src->model_name);
+        copy->count++;
+
+        if (!dst->id || !dst->device_name || !dst->device_path || !dst->device_id ||
+            !dst->stable_id || !dst->monitor_interface || !dst->model_name) {
+            free_monitor_list_with(copy, allocator);
+            return NULL;
+        }
+    }
+
+    build_monitor_index(copy, allocator);
+    return copy;
+}
+
+void free_monitor_list_with(MonitorList* list, const MosDefAllocator* allocator) {
     if (!list) return;
 
     for (int i = 0; i < list->count; i++) {
-        free(list->monitors[i].id);
-        free(list->monitors[i].device_name);
-        free(list->monitors[i].device_path);
-        free(list->monitors[i].device_id);
+        free_monitor_fields(&list->monitors[i], allocator);
     }
-    free(list->monitors);
-    free(list);
+    free_monitor_index(list->index, allocator);
+    mem_free(allocator, list->monitors);
+    mem_free(allocator, list);
 }
 
 // Monitor listing and formatting
@@ -124,8 +335,10 @@ void print_monitor_table(const MonitorList* monitors) {
     }
 
     // Print header
-    printf("%-5s %-30s %-20s %-15s %-12s\n", "ID", "Name", "Device", "Resolution", "Rotation");
-    printf("%-5s %-30s %-20s %-15s %-12s\n", "----", "----", "------", "----------", "--------");
+    printf("%-5s %-30s %-20s %-15s %-12s %-14s %-11s %-7s %s\n",
+           "ID", "Name", "Device", "Resolution", "Rotation", "Model", "Native", "Size", "Stable ID");
+    printf("%-5s %-30s %-20s %-15s %-12s %-14s %-11s %-7s %s\n",
+           "----", "----", "------", "----------", "--------", "-----", "------", "----", "---------");
 
     // Print each monitor
     for (int i = 0; i < monitors->count; i++) {
@@ -140,12 +353,29 @@ void print_monitor_table(const MonitorList* monitors) {
             strcpy_s(device_path_short, sizeof(device_path_short), monitor->device_path);
         }
 
-        printf("%-5s %-30s %-20s %-15s %-12s\n",
+        char native[16] = "-";
+        if (monitor->native_width > 0 && monitor->native_height > 0) {
+            sprintf_s(native, sizeof(native), "%lux%lu", monitor->native_width, monitor->native_height);
+        }
+
+        // Diagonal in inches from the EDID image size
+        char size[16] = "-";
+        if (monitor->width_mm > 0 && monitor->height_mm > 0) {
+            double diagonal_mm = sqrt((double)monitor->width_mm * monitor->width_mm +
+                                      (double)monitor->height_mm * monitor->height_mm);
+            sprintf_s(size, sizeof(size), "%.1f\"", diagonal_mm / 25.4);
+        }
+
+        printf("%-5s %-30s %-20s %-15s %-12s %-14s %-11s %-7s %s\n",
                monitor->id,
                monitor->device_name,
                device_path_short,
                get_resolution_string(monitor->width, monitor->height),
-               get_orientation_string(monitor->orientation));
+               get_orientation_string(monitor->orientation),
+               monitor->model_name[0] ? monitor->model_name : "-",
+               native,
+               size,
+               monitor->stable_id);
     }
 }
 
@@ -156,23 +386,272 @@ char* get_orientation_string(DWORD orientation) {
         case DMDO_180:     return "180°";
         case DMDO_270:     return "270°";
         default: {
-            static char buffer[16];
+            static MOSDEF_THREAD_LOCAL char buffer[16];
             sprintf_s(buffer, sizeof(buffer), "%lu°", orientation);
             return buffer;
         }
     }
 }
 
+DWORD get_orientation_degrees(DWORD orientation) {
+    switch (orientation) {
+        case DMDO_90:  return 90;
+        case DMDO_180: return 180;
+        case DMDO_270: return 270;
+        default:       return 0;
+    }
+}
+
 char* get_resolution_string(DWORD width, DWORD height) {
-    static char buffer[32];
+    static MOSDEF_THREAD_LOCAL char buffer[32];
     sprintf_s(buffer, sizeof(buffer), "%lux%lu", width, height);
     return buffer;
 }
 
+// Display fingerprints
+static ULONG64 fingerprint_display(ULONG64 hash, const char* device_path, const char* monitor_interface,
+                                   const DEVMODEA* settings) {
+    LONG fields[6] = {
+        settings->dmPosition.x, settings->dmPosition.y,
+        (LONG)settings->dmPelsWidth, (LONG)settings->dmPelsHeight,
+        (LONG)settings->dmDisplayOrientation, (LONG)settings->dmDisplayFrequency
+    };
+
+    hash = hash_bytes(hash, device_path, strlen(device_path) + 1);
+    hash = hash_bytes(hash, monitor_interface, strlen(monitor_interface) + 1);
+    return hash_bytes(hash, fields, sizeof(fields));
+}
+
+ULONG64 display_fingerprint(const MonitorList* monitors) {
+    ULONG64 hash = HASH_SEED;
+    if (!monitors) return hash;
+
+    for (int i = 0; i < monitors->count; i++) {
+        const MonitorInfo* monitor = &monitors->monitors[i];
+
+        // Same field set and order as the live walk
+        DEVMODEA settings;
+        memset(&settings, 0, sizeof(DEVMODEA));
+        settings.dmPosition.x = monitor->position_x;
+        settings.dmPosition.y = monitor->position_y;
+        settings.dmPelsWidth = monitor->width;
+        settings.dmPelsHeight = monitor->height;
+        settings.dmDisplayOrientation = monitor->orientation;
+        settings.dmDisplayFrequency = monitor->refresh_hz;
+
+        hash = fingerprint_display(hash, monitor->device_path, monitor->monitor_interface, &settings);
+    }
+
+    return hash;
+}
+
+// Mirrors the device filtering in enumerate_monitors
+bool read_display_fingerprint(ULONG64* out_fingerprint) {
+    if (!out_fingerprint) return false;
+
+    ULONG64 hash = HASH_SEED;
+    DISPLAY_DEVICEA display_device;
+    display_device.cb = sizeof(DISPLAY_DEVICEA);
+
+    for (DWORD device_index = 0; EnumDisplayDevicesA(NULL, device_index, &display_device, 0); device_index++) {
+        if (!(display_device.StateFlags & DISPLAY_DEVICE_ACTIVE) ||
+            (display_device.StateFlags & DISPLAY_DEVICE_MIRRORING_DRIVER)) {
+            continue;
+        }
+
+        DEVMODEA settings;
+        memset(&settings, 0, sizeof(DEVMODEA));
+        settings.dmSize = sizeof(DEVMODEA);
+        if (!EnumDisplaySettingsExA(display_device.DeviceName, ENUM_CURRENT_SETTINGS, &settings, 0)) {
+            continue;
+        }
+
+        DISPLAY_DEVICEA monitor_device;
+        memset(&monitor_device, 0, sizeof(DISPLAY_DEVICEA));
+        monitor_device.cb = sizeof(DISPLAY_DEVICEA);
+        if (!EnumDisplayDevicesA(display_device.DeviceName, 0, &monitor_device, EDD_GET_DEVICE_INTERFACE_NAME)) {
+            monitor_device.DeviceID[0] = '\0';
+        }
+
+        hash = fingerprint_display(hash, display_device.DeviceName, monitor_device.DeviceID, &settings);
+    }
+
+    *out_fingerprint = hash;
+    return true;
+}
+
 // Monitor finding utilities
+static DWORD hash_key(const char* key) {
+    DWORD hash = 2166136261u; // FNV-1a
+    for (const unsigned char* p = (const unsigned char*)key; *p; p++) {
+        hash ^= *p;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static void index_insert(int* slots, int mask, const char* key, int monitor_index) {
+    DWORD slot = hash_key(key) & mask;
+    while (slots[slot] != 0) {
+        slot = (slot + 1) & mask;
+    }
+    slots[slot] = monitor_index + 1;
+}
+
+static MonitorInfo* index_lookup(const MonitorList* monitors, const int* slots, IndexKey kind, const char* key) {
+    int mask = monitors->index->mask;
+    DWORD slot = hash_key(key) & mask;
+    while (slots[slot] != 0) {
+        MonitorInfo* candidate = &monitors->monitors[slots[slot] - 1];
+        const char* candidate_key = (kind == INDEX_KEY_ID) ? candidate->id :
+                                    (kind == INDEX_KEY_STABLE_ID) ? candidate->stable_id : candidate->device_path;
+        if (strcmp(candidate_key, key) == 0) {
+            return candidate;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return NULL;
+}
+
+static void free_monitor_index(MonitorIndex* index, const MosDefAllocator* allocator) {
+    if (!index) return;
+    mem_free(allocator, index->id_slots);
+    mem_free(allocator, index->stable_id_slots);
+    mem_free(allocator, index->device_path_slots);
+    mem_free(allocator, index->names);
+    mem_free(allocator, index->name_offsets);
+    mem_free(allocator, index->device_name_ids);
+    mem_free(allocator, index->model_name_ids);
+    free_monitor_table(index->table, allocator);
+    mem_free(allocator, index);
+}
+
+// Returns the ID of name in the table, appending it if new. Lookups compare
+// the folded text, so names differing only in case share one entry.
+static int intern_name(MonitorIndex* index, int* slots, int mask, char* folded, size_t* used, const char* name) {
+    if (!name) name = "";
+    size_t length = strlen(name);
+    char* candidate = folded + *used;
+    strsearch_fold(candidate, name, length);
+    candidate[length] = '\0';
+
+    DWORD slot = hash_key(candidate) & mask;
+    while (slots[slot] != 0) {
+        int id = slots[slot] - 1;
+        if (strcmp(folded + index->name_offsets[id], candidate) == 0) {
+            return id;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    int id = index->name_count++;
+    index->name_offsets[id] = (int)*used;
+    slots[slot] = id + 1;
+    *used += length + 1;
+    index->name_offsets[index->name_count] = (int)*used;
+    return id;
+}
+
+static bool build_name_table(MonitorIndex* index, const MonitorList* monitors, const MosDefAllocator* allocator) {
+    int count = monitors->count;
+    size_t total = STRSEARCH_PADDING;
+    for (int i = 0; i < count; i++) {
+        const MonitorInfo* monitor = &monitors->monitors[i];
+        total += (monitor->device_name ? strlen(monitor->device_name) : 0) + 1;
+        total += (monitor->model_name ? strlen(monitor->model_name) : 0) + 1;
+    }
+
+    // At most two distinct names per monitor; load factor <= 0.5
+    int capacity = 4;
+    while (capacity < count * 4) {
+        capacity <<= 1;
+    }
+
+    index->names = (char*)mem_alloc(allocator, total);
+    index->name_offsets = (int*)mem_alloc(allocator, (count * 2 + 1) * sizeof(int));
+    index->device_name_ids = (int*)mem_alloc(allocator, (count > 0 ? count : 1) * sizeof(int));
+    index->model_name_ids = (int*)mem_alloc(allocator, (count > 0 ? count : 1) * sizeof(int));
+    int* slots = (int*)mem_alloc(allocator, capacity * sizeof(int));
+    if (!index->names || !index->name_offsets || !index->device_name_ids || !index->model_name_ids || !slots) {
+        mem_free(allocator, slots);
+        return false;
+    }
+    memset(slots, 0, capacity * sizeof(int));
+
+    size_t used = 0;
+    index->name_count = 0;
+    index->name_offsets[0] = 0;
+    for (int i = 0; i < count; i++) {
+        index->device_name_ids[i] = intern_name(index, slots, capacity - 1, index->names, &used,
+                                                monitors->monitors[i].device_name);
+        index->model_name_ids[i] = intern_name(index, slots, capacity - 1, index->names, &used,
+                                               monitors->monitors[i].model_name);
+    }
+    memset(index->names + used, 0, total - used);
+
+    mem_free(allocator, slots);
+    return true;
+}
+
+bool build_monitor_index(MonitorList* monitors, const MosDefAllocator* allocator) {
+    if (!monitors || monitors->index) return monitors != NULL;
+
+    // Power of two with load factor <= 0.5
+    int capacity = 4;
+    while (capacity < monitors->count * 2) {
+        capacity <<= 1;
+    }
+
+    MonitorIndex* index = (MonitorIndex*)mem_alloc(allocator, sizeof(MonitorIndex));
+    if (!index) return false;
+    memset(index, 0, sizeof(MonitorIndex));
+
+    index->mask = capacity - 1;
+    index->id_slots = (int*)mem_alloc(allocator, capacity * sizeof(int));
+    index->stable_id_slots = (int*)mem_alloc(allocator, capacity * sizeof(int));
+    index->device_path_slots = (int*)mem_alloc(allocator, capacity * sizeof(int));
+    index->table = build_monitor_table(monitors, allocator);
+    if (!index->id_slots || !index->stable_id_slots || !index->device_path_slots || !index->table ||
+        !build_name_table(index, monitors, allocator)) {
+        free_monitor_index(index, allocator);
+        return false;
+    }
+
+    memset(index->id_slots, 0, capacity * sizeof(int));
+    memset(index->stable_id_slots, 0, capacity * sizeof(int));
+    memset(index->device_path_slots, 0, capacity * sizeof(int));
+
+    for (int i = 0; i < monitors->count; i++) {
+        index_insert(index->id_slots, index->mask, monitors->monitors[i].id, i);
+        if (monitors->monitors[i].stable_id) {
+            index_insert(index->stable_id_slots, index->mask, monitors->monitors[i].stable_id, i);
+        }
+        index_insert(index->device_path_slots, index->mask, monitors->monitors[i].device_path, i);
+    }
+
+    index->fingerprint = topology_fingerprint(monitors);
+    monitors->index = index;
+    return true;
+}
+
+ULONG64 monitor_list_fingerprint(const MonitorList* monitors) {
+    if (monitors && monitors->index) {
+        return monitors->index->fingerprint;
+    }
+    return topology_fingerprint(monitors);
+}
+
+const MonitorTable* monitor_list_table(const MonitorList* monitors) {
+    return (monitors && monitors->index) ? monitors->index->table : NULL;
+}
+
 MonitorInfo* find_monitor_by_id(const MonitorList* monitors, const char* id) {
     if (!monitors || !id) return NULL;
 
+    if (monitors->index) {
+        return index_lookup(monitors, monitors->index->id_slots, INDEX_KEY_ID, id);
+    }
+
     for (int i = 0; i < monitors->count; i++) {
         if (strcmp(monitors->monitors[i].id, id) == 0) {
             return &monitors->monitors[i];
@@ -181,9 +660,28 @@ MonitorInfo* find_monitor_by_id(const MonitorList* monitors, const char* id) {
     return NULL;
 }
 
+MonitorInfo* find_monitor_by_stable_id(const MonitorList* monitors, const char* stable_id) {
+    if (!monitors || !stable_id) return NULL;
+
+    if (monitors->index) {
+        return index_lookup(monitors, monitors->index->stable_id_slots, INDEX_KEY_STABLE_ID, stable_id);
+    }
+
+    for (int i = 0; i < monitors->count; i++) {
+        if (monitors->monitors[i].stable_id && strcmp(monitors->monitors[i].stable_id, stable_id) == 0) {
+            return &monitors->monitors[i];
+        }
+    }
+    return NULL;
+}
+
 MonitorInfo* find_monitor_by_device_path(const MonitorList* monitors, const char* device_path) {
     if (!monitors || !device_path) return NULL;
 
+    if (monitors->index) {
+        return index_lookup(monitors, monitors->index->device_path_slots, INDEX_KEY_DEVICE_PATH, device_path);
+    }
+
     for (int i = 0; i < monitors->count; i++) {
         if (strcmp(monitors->monitors[i].device_path, device_path) == 0) {
             return &monitors->monitors[i];
@@ -202,3 +700,68 @@ int get_monitor_index(const MonitorList* monitors, const MonitorInfo* monitor) {
     }
     return -1;
 }
+
+bool monitor_matches_selector(const MonitorInfo* monitor, const Selector* selector) {
+    if (!monitor || !selector || !selector->value) return false;
+
+    switch (selector->type) {
+        case SELECTOR_TYPE_MODEL:
+            if (!monitor->model_name || !monitor->model_name[0]) return false;
+            return str_contains_nocase(monitor->model_name, selector->value);
+
+        case SELECTOR_TYPE_NATIVE: {
+            unsigned long width = 0, height = 0;
+            if (sscanf(selector->value, "%lux%lu", &width, &height) != 2) return false;
+            return monitor->native_width == width && monitor->native_height == height;
+        }
+
+        case SELECTOR_TYPE_EXPRESSION:
+            return selector_program_matches(selector->program, monitor);
+
+        case SELECTOR_TYPE_GROUP:
+            return monitor_group_matches(selector->value, monitor);
+
+        default:
+            return matches_monitor(selector, monitor->id, monitor->device_path,
+                                   monitor->device_name, monitor->stable_id);
+    }
+}
+
+bool apply_name_selector(const MonitorList* monitors, const Selector* selector, ULONG64* bits) {
+    if (!monitors || !monitors->index || !selector || !selector->value ||
+        (selector->type != SELECTOR_TYPE_DEVICE_NAME && selector->type != SELECTOR_TYPE_MODEL)) {
+        return false;
+    }
+
+    const MonitorIndex* index = monitors->index;
+    size_t needle_length = strlen(selector->value);
+    char needle_buffer[128];
+    char* needle = needle_length < sizeof(needle_buffer) ? needle_buffer : (char*)malloc(needle_length + 1);
+    signed char* results = (signed char*)malloc(index->name_count > 0 ? index->name_count : 1);
+    if (!needle || !results) {
+        if (needle != needle_buffer) free(needle);
+        free(results);
+        return false;
+    }
+    strsearch_fold(needle, selector->value, needle_length);
+    memset(results, -1, index->name_count > 0 ? index->name_count : 1);
+
+    const int* name_ids = (selector->type == SELECTOR_TYPE_MODEL) ? index->model_name_ids : index->device_name_ids;
+    for (int i = 0; i < monitors->count; i++) {
+        int id = name_ids[i];
+        if (results[id] < 0) {
+            const char* name = index->names + index->name_offsets[id];
+            size_t name_length = index->name_offsets[id + 1] - index->name_offsets[id] - 1;
+            // Monitors without an EDID model name never match model:
+            results[id] = (selector->type == SELECTOR_TYPE_MODEL && name_length == 0) ? 0 :
+                          strsearch_folded_contains(name, name_length, needle, needle_length);
+        }
+        if (results[id]) {
+            MONITOR_BITSET_SET(bits, i);
+        }
+    }
+
+    if (needle != needle_buffer) free(needle);
+    free(results);
+    return true;
+}
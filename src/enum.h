@@ -3,6 +3,7 @@
 
 #include <windows.h>
 #include <stdbool.h>
+#include "util.h"
 
 // Monitor information structure
 typedef struct {
@@ -12,26 +13,77 @@ typedef struct {
     DWORD width;
     DWORD height;
     DWORD orientation;  // 0, 90, 180, 270
+    LONG position_x;    // Desktop coordinates of the top-left corner
+    LONG position_y;
+    DWORD refresh_hz;   // Current refresh rate, 0 or 1 means hardware default
     char* device_id;    // DeviceID from DISPLAY_DEVICE
+    char* stable_id;    // EDID manufacturer/product/serial, e.g. DEL4085-1A2B3C4D
+    char* monitor_interface; // Monitor-level device interface name (may be empty)
+    char* model_name;   // EDID model name, empty if the panel does not report one
+    DWORD native_width; // EDID preferred timing, 0 if unknown
+    DWORD native_height;
+    DWORD width_mm;     // Physical image size, 0 if unknown
+    DWORD height_mm;
+    DWORD preferred_orientation; // DMDO_* from the model database, MODEL_ORIENTATION_NONE if none
+    DWORD model_flags;  // MODEL_FLAG_* from the model database
 } MonitorInfo;
 
+// Hash index over monitor IDs, stable IDs and device paths
+typedef struct MonitorIndex MonitorIndex;
+
 typedef struct {
     MonitorInfo* monitors;
     int count;
+    MonitorIndex* index;    // Built by enumerate/clone; NULL falls back to linear scans
 } MonitorList;
 
 // Monitor enumeration
 MonitorList* enumerate_monitors();
 void free_monitor_list(MonitorList* list);
 
+// Deep copies owned by a caller-supplied allocator
+MonitorList* clone_monitor_list(const MonitorList* list, const MosDefAllocator* allocator);
+void free_monitor_list_with(MonitorList* list, const MosDefAllocator* allocator);
+
 // Monitor listing and formatting
+// The string helpers return thread-local buffers, valid until the next call on the same thread.
 void print_monitor_table(const MonitorList* monitors);
 char* get_orientation_string(DWORD orientation);
+DWORD get_orientation_degrees(DWORD orientation);   // DMDO_* to 0, 90, 180, 270
 char* get_resolution_string(DWORD width, DWORD height);
 
+// Cheap topology fingerprint: device path, monitor interface, position,
+// resolution, orientation and refresh rate of each active display. The
+// list form and the live form agree for the same topology; the live form
+// reads only EnumDisplayDevices/EnumDisplaySettings, no EDID or registry.
+ULONG64 display_fingerprint(const MonitorList* monitors);
+bool read_display_fingerprint(ULONG64* out_fingerprint);
+
 // Monitor finding utilities
+bool build_monitor_index(MonitorList* monitors, const MosDefAllocator* allocator);
 MonitorInfo* find_monitor_by_id(const MonitorList* monitors, const char* id);
+MonitorInfo* find_monitor_by_stable_id(const MonitorList* monitors, const char* stable_id);
 MonitorInfo* find_monitor_by_device_path(const MonitorList* monitors, const char* device_path);
 int get_monitor_index(const MonitorList* monitors, const MonitorInfo* monitor);
 
+// Selector matching against every MonitorInfo field, including model: and native:
+bool monitor_matches_selector(const MonitorInfo* monitor, const Selector* selector);
+
+// Monitor bitsets: bit i is monitors->monitors[i]
+#define MONITOR_BITSET_WORDS(count) (((count) + 63) / 64)
+#define MONITOR_BITSET_SET(bits, i) ((bits)[(i) >> 6] |= 1ULL << ((i) & 63))
+#define MONITOR_BITSET_TEST(bits, i) (((bits)[(i) >> 6] >> ((i) & 63)) & 1)
+
+// Sets the bit of every monitor matching a name: or model: selector, testing
+// each distinct name in the index once. Returns false, touching nothing, for
+// other selector types or a list without an index.
+bool apply_name_selector(const MonitorList* monitors, const Selector* selector, ULONG64* bits);
+
+// topology_fingerprint (diff.h), computed once when the index is built
+ULONG64 monitor_list_fingerprint(const MonitorList* monitors);
+
+// Columnar table built with the index (montable.h), NULL without one
+struct MonitorTable;
+const struct MonitorTable* monitor_list_table(const MonitorList* monitors);
+
 #endif // ENUM_H
@@ -0,0 +1,136 @@
+#include "event_ring.h"
+#include "util.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+_Static_assert(offsetof(EventRing, tail) == EVENT_RING_CACHE_LINE, "consumer fields must start a cache line");
+_Static_assert(offsetof(EventRing, mask) == 2 * EVENT_RING_CACHE_LINE, "shared fields must start a cache line");
+
+EventRing* event_ring_create(DWORD capacity) {
+    DWORD size = 2;
+    while (size < capacity && size < 0x40000000) {
+        size <<= 1;
+    }
+
+    // The producer and consumer lines only stay apart if the ring starts on
+    // a cache line boundary
+    EventRing* ring = (EventRing*)_aligned_malloc(sizeof(EventRing), EVENT_RING_CACHE_LINE);
+    if (!ring) return NULL;
+
+    memset(ring, 0, sizeof(EventRing));
+    ring->mask = (LONG64)size - 1;
+    ring->slots = (DisplayEvent*)calloc(size, sizeof(DisplayEvent));
+    ring->ready_event = CreateEventA(NULL, FALSE, FALSE, NULL);
+
+    if (!ring->slots || !ring->ready_event) {
+        log_error("Failed to allocate event ring of %lu slots", size);
+        event_ring_destroy(ring);
+        return NULL;
+    }
+
+    return ring;
+}
+
+void event_ring_destroy(EventRing* ring) {
+    if (!ring) return;
+
+    if (ring->ready_event) {
+        CloseHandle(ring->ready_event);
+    }
+    free(ring->slots);
+    _aligned_free(ring);
+}
+
+// Producer side
+bool event_ring_push(EventRing* ring, const DisplayEvent* event) {
+    LONG64 head = ReadNoFence64(&ring->head);
+    LONG64 capacity = ring->mask + 1;
+
+    // Only re-read the consumer's tail when the cached view says we are full
+    if (head - ring->cached_tail >= capacity) {
+        ring->cached_tail = ReadAcquire64(&ring->tail);
+        if (head - ring->cached_tail >= capacity) {
+            WriteNoFence64(&ring->dropped, ReadNoFence64(&ring->dropped) + 1);
+            return false;
+        }
+    }
+
+    ring->slots[head & ring->mask] = *event;
+    WriteRelease64(&ring->head, head + 1);
+
+    LONG64 backlog = head + 1 - ring->cached_tail;
+    if (backlog > ReadNoFence64(&ring->high_water)) {
+        WriteNoFence64(&ring->high_water, backlog);
+    }
+
+    // Full fence so the head store is visible before we look for a sleeper
+    MemoryBarrier();
+    if (ReadNoFence(&ring->consumer_waiting) &&
+        InterlockedExchange(&ring->consumer_waiting, 0) != 0) {
+        SetEvent(ring->ready_event);
+    }
+
+    return true;
+}
+
+// Consumer side
+int event_ring_drain(EventRing* ring, DisplayEvent* out_events, int max_events) {
+    if (max_events <= 0) return 0;
+
+    LONG64 tail = ReadNoFence64(&ring->tail);
+    if (ring->cached_head == tail) {
+        ring->cached_head = ReadAcquire64(&ring->head);
+        if (ring->cached_head == tail) {
+            return 0;
+        }
+    }
+
+    LONG64 available = ring->cached_head - tail;
+    int count = (available < max_events) ? (int)available : max_events;
+
+    for (int i = 0; i < count; i++) {
+        out_events[i] = ring->slots[(tail + i) & ring->mask];
+    }
+
+    WriteRelease64(&ring->tail, tail + count);
+    return count;
+}
+
+bool event_ring_wait(EventRing* ring, DWORD timeout_ms) {
+    InterlockedExchange(&ring->consumer_waiting, 1);
+
+    // Re-check after announcing ourselves; the producer fences before reading the flag
+    if (ReadAcquire64(&ring->head) != ReadNoFence64(&ring->tail)) {
+        InterlockedExchange(&ring->consumer_waiting, 0);
+        return true;
+    }
+
+    DWORD wait_result = WaitForSingleObject(ring->ready_event, timeout_ms);
+    InterlockedExchange(&ring->consumer_waiting, 0);
+    return wait_result == WAIT_OBJECT_0 || ReadAcquire64(&ring->head) != ReadNoFence64(&ring->tail);
+}
+
+EventRingStats event_ring_get_stats(const EventRing* ring) {
+    EventRingStats stats;
+    stats.pushed = ReadAcquire64(&ring->head);
+    stats.dropped = ReadNoFence64(&ring->dropped);
+    stats.high_water = ReadNoFence64(&ring->high_water);
+    return stats;
+}
+
+// Timestamp helpers
+LONG64 event_timestamp_now() {
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return counter.QuadPart;
+}
+
+double event_timestamp_elapsed_us(LONG64 from, LONG64 to) {
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    return (double)(to - from) * 1000000.0 / (double)frequency.QuadPart;
+}
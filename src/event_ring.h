@@ -0,0 +1,74 @@
+#ifndef EVENT_RING_H
+#define EVENT_RING_H
+
+#include <windows.h>
+#include <stdbool.h>
+
+// Events handed from the OS listener thread to the applier thread
+typedef enum {
+    DISPLAY_EVENT_TOPOLOGY_CHANGED,   // WM_DISPLAYCHANGE / device arrival or removal
+    DISPLAY_EVENT_HOTKEY,             // param = hotkey binding index
+    DISPLAY_EVENT_KEY,                // Console key press, param = virtual-key code
+    DISPLAY_EVENT_RESIZE,             // Console window resized
+    DISPLAY_EVENT_SHUTDOWN            // Listener is exiting
+} DisplayEventType;
+
+typedef struct {
+    DisplayEventType type;
+    DWORD param;
+    LONG64 timestamp;                 // QueryPerformanceCounter ticks at intake
+} DisplayEvent;
+
+typedef struct {
+    LONG64 pushed;                    // Events accepted since creation
+    LONG64 dropped;                   // Events rejected because the ring was full
+    LONG64 high_water;                // Largest backlog observed by the producer
+} EventRingStats;
+
+// Bounded single-producer/single-consumer ring. Push and drain never take a
+// lock, so a stalled consumer cannot block the producer; overflow is counted
+// instead. Exactly one thread may push and exactly one thread may drain.
+// event_ring_create allocates the ring on a cache line boundary so the
+// producer and consumer fields never share a line.
+#define EVENT_RING_CACHE_LINE 64
+
+typedef struct {
+    // Producer cache line
+    volatile LONG64 head;             // Next slot to write
+    LONG64 cached_tail;               // Producer's last view of tail
+    volatile LONG64 dropped;
+    volatile LONG64 high_water;
+    char producer_pad[EVENT_RING_CACHE_LINE - 4 * sizeof(LONG64)];
+
+    // Consumer cache line
+    volatile LONG64 tail;             // Next slot to read
+    LONG64 cached_head;               // Consumer's last view of head
+    volatile LONG consumer_waiting;
+    char consumer_pad[EVENT_RING_CACHE_LINE - 2 * sizeof(LONG64) - sizeof(LONG)];
+
+    // Shared, read-only after creation
+    LONG64 mask;
+    DisplayEvent* slots;
+    HANDLE ready_event;               // Auto-reset; signaled when a waiting consumer has work
+} EventRing;
+
+// Capacity is rounded up to a power of two.
+EventRing* event_ring_create(DWORD capacity);
+void event_ring_destroy(EventRing* ring);
+
+// Producer side. Returns false (and counts a drop) when the ring is full.
+bool event_ring_push(EventRing* ring, const DisplayEvent* event);
+
+// Consumer side. Drains up to max_events queued events in FIFO order.
+int event_ring_drain(EventRing* ring, DisplayEvent* out_events, int max_events);
+
+// Consumer side. Blocks until events are queued or the timeout expires.
+bool event_ring_wait(EventRing* ring, DWORD timeout_ms);
+
+EventRingStats event_ring_get_stats(const EventRing* ring);
+
+// Timestamp helpers
+LONG64 event_timestamp_now();
+double event_timestamp_elapsed_us(LONG64 from, LONG64 to);
+
+#endif // EVENT_RING_H
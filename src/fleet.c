@@ -0,0 +1,839 @@
+// Winsock 2 must precede windows.h
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include "fleet.h"
+#include "cli.h"
+#include "config.h"
+#include "event_ring.h"
+#include "hmac.h"
+#include "util.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FLEET_MAGIC "MDFL"
+#define FLEET_MAX_HOSTS 65536
+#define FLEET_MAX_RESPONSE (6 + 0xFFFF)
+
+// Frame header
+void fleet_write_header(BYTE* header, FleetMessageType type, BYTE flags, DWORD length) {
+    memcpy(header, FLEET_MAGIC, 4);
+    header[4] = FLEET_PROTOCOL_VERSION;
+    header[5] = (BYTE)type;
+    header[6] = flags;
+    header[7] = 0;
+    memcpy(header + 8, &length, sizeof(length));
+    memset(header + FLEET_SIGNED_HEADER_SIZE, 0, FLEET_HEADER_SIZE - FLEET_SIGNED_HEADER_SIZE);
+}
+
+bool fleet_parse_header(const BYTE* header, FleetMessageType* out_type, BYTE* out_flags, DWORD* out_length) {
+    if (memcmp(header, FLEET_MAGIC, 4) != 0 || header[4] != FLEET_PROTOCOL_VERSION) {
+        return false;
+    }
+
+    DWORD length;
+    memcpy(&length, header + 8, sizeof(length));
+    if (length > FLEET_MAX_PAYLOAD) return false;
+
+    *out_type = (FleetMessageType)header[5];
+    *out_flags = header[6];
+    *out_length = length;
+    return true;
+}
+
+// Shared key
+static bool write_new_key(const char* path) {
+    BYTE bytes[32];
+    if (!random_bytes(bytes, sizeof(bytes))) {
+        log_error("Failed to generate a fleet key");
+        return false;
+    }
+
+    char text[sizeof(bytes) * 2 + 2];
+    for (size_t i = 0; i < sizeof(bytes); i++) {
+        sprintf_s(text + i * 2, 3, "%02x", bytes[i]);
+    }
+    strcat_s(text, sizeof(text), "\n");
+    SecureZeroMemory(bytes, sizeof(bytes));
+
+    FILE* file = NULL;
+    bool success = fopen_s(&file, path, "wx") == 0 && file;
+    if (success) {
+        success = fputs(text, file) >= 0;
+        success = (fclose(file) == 0) && success;
+    }
+    SecureZeroMemory(text, sizeof(text));
+
+    if (success) {
+        log_info("Created fleet key %s; copy it to the controller", path);
+    } else {
+        log_error("Failed to create fleet key %s", path);
+    }
+    return success;
+}
+
+bool fleet_load_key(const char* path, bool create, FleetKey* out_key) {
+    memset(out_key, 0, sizeof(FleetKey));
+
+    char* default_path = path ? NULL : get_local_data_path(FLEET_KEY_FILE);
+    const char* key_path = path ? path : default_path;
+    if (!key_path) {
+        log_error("No fleet key file: pass --key or set LOCALAPPDATA");
+        return false;
+    }
+
+    FILE* file = NULL;
+    if (fopen_s(&file, key_path, "rb") != 0 && create && !path && write_new_key(key_path)) {
+        fopen_s(&file, key_path, "rb");
+    }
+    if (!file) {
+        log_error("Cannot read fleet key %s", key_path);
+        free(default_path);
+        return false;
+    }
+
+    BYTE buffer[FLEET_MAX_KEY_SIZE + 2];
+    size_t size = fread(buffer, 1, sizeof(buffer), file);
+    fclose(file);
+
+    size_t start = 0;
+    while (start < size && isspace(buffer[start])) start++;
+    while (size > start && isspace(buffer[size - 1])) size--;
+
+    bool success = size - start >= FLEET_MIN_KEY_SIZE && size - start <= FLEET_MAX_KEY_SIZE;
+    if (success) {
+        out_key->size = size - start;
+        memcpy(out_key->bytes, buffer + start, out_key->size);
+    } else {
+        log_error("Fleet key %s must hold %d to %d bytes", key_path, FLEET_MIN_KEY_SIZE, FLEET_MAX_KEY_SIZE);
+    }
+
+    SecureZeroMemory(buffer, sizeof(buffer));
+    free(default_path);
+    return success;
+}
+
+// Frame MACs
+static void compute_frame_mac(const FleetKey* key, const BYTE* challenge, const BYTE* request_mac,
+                              const BYTE* header, const BYTE* body, DWORD length, BYTE* mac) {
+    HmacSha256 hmac;
+    hmac_sha256_init(&hmac, key->bytes, key->size);
+    hmac_sha256_update(&hmac, challenge, FLEET_CHALLENGE_SIZE);
+    if (request_mac) {
+        hmac_sha256_update(&hmac, request_mac, SHA256_SIZE);
+    }
+    hmac_sha256_update(&hmac, header, FLEET_SIGNED_HEADER_SIZE);
+    hmac_sha256_update(&hmac, body, length);
+    hmac_sha256_final(&hmac, mac);
+}
+
+void fleet_sign_frame(const FleetKey* key, const BYTE* challenge, const BYTE* request_mac,
+                      BYTE* header, const BYTE* body, DWORD length) {
+    compute_frame_mac(key, challenge, request_mac, header, body, length, header + FLEET_SIGNED_HEADER_SIZE);
+}
+
+bool fleet_verify_frame(const FleetKey* key, const BYTE* challenge, const BYTE* request_mac,
+                        const BYTE* header, const BYTE* body, DWORD length) {
+    BYTE mac[SHA256_SIZE];
+    compute_frame_mac(key, challenge, request_mac, header, body, length, mac);
+    return hmac_equal(mac, header + FLEET_SIGNED_HEADER_SIZE, SHA256_SIZE);
+}
+
+bool fleet_parse_address(const char* text, char* host, size_t host_size, USHORT* port) {
+    if (!text || !*text) return false;
+
+    const char* host_start = text;
+    size_t host_length;
+    const char* port_text = NULL;
+
+    if (text[0] == '[') {
+        // [IPv6]:port
+        const char* close = strchr(text, ']');
+        if (!close) return false;
+        host_start = text + 1;
+        host_length = (size_t)(close - host_start);
+        if (close[1] == ':') {
+            port_text = close + 2;
+        } else if (close[1] != '\0') {
+            return false;
+        }
+    } else {
+        // A second colon means a bare IPv6 address with no port
+        const char* colon = strrchr(text, ':');
+        if (colon && strchr(text, ':') == colon) {
+            host_length = (size_t)(colon - text);
+            port_text = colon + 1;
+        } else {
+            host_length = strlen(text);
+        }
+    }
+
+    if (host_length >= host_size) return false;
+    if (host_length > 0) {
+        memcpy(host, host_start, host_length);
+        host[host_length] = '\0';
+    }
+
+    if (port_text) {
+        char* end = NULL;
+        unsigned long value = strtoul(port_text, &end, 10);
+        if (!*port_text || *end || value == 0 || value > 0xFFFF) return false;
+        *port = (USHORT)value;
+    }
+    return host_length > 0 || port_text;
+}
+
+// Controller
+typedef enum {
+    HOST_PENDING,
+    HOST_CONNECTING,
+    HOST_AWAITING_CHALLENGE,
+    HOST_SENDING,
+    HOST_RECEIVING,
+    HOST_DONE
+} HostPhase;
+
+typedef enum {
+    HOST_RESULT_OK,
+    HOST_RESULT_FAILED,         // The agent ran the request and it failed
+    HOST_RESULT_TIMEOUT,
+    HOST_RESULT_UNREACHABLE,    // Unresolvable, refused, reset or malformed reply
+    HOST_RESULT_REJECTED,       // The agent refused our MAC, or we refused its
+    HOST_RESULT_SKIPPED         // Never started: the rollout halted first
+} HostResult;
+
+typedef struct {
+    char* name;                 // As written in the hosts file
+    char host[256];
+    USHORT port;
+
+    HostPhase phase;
+    SOCKET socket;
+    ULONGLONG deadline;         // GetTickCount64
+    LONG64 started;             // event_timestamp_now
+    BYTE challenge[FLEET_HEADER_SIZE + FLEET_CHALLENGE_SIZE];   // The agent's challenge frame
+    BYTE request_header[FLEET_HEADER_SIZE];                     // Signed for that challenge
+    DWORD sent;
+
+    BYTE header[FLEET_HEADER_SIZE];
+    BYTE* body;
+    DWORD body_length;
+    DWORD received;
+
+    HostResult result;
+    int stage;
+    double elapsed_ms;
+} FleetHost;
+
+typedef struct {
+    const FleetOptions* options;
+    FleetHost* hosts;
+    int count;
+    FleetKey key;
+    FleetMessageType type;      // The request every host is sent; only the
+    BYTE flags;                 // header's MAC differs between hosts
+    BYTE* payload;
+    DWORD payload_length;
+    int* stage_ends;            // Cumulative host counts
+    int stage_count;
+} FleetRun;
+
+static const char* get_host_result_name(HostResult result) {
+    switch (result) {
+        case HOST_RESULT_OK:          return "ok";
+        case HOST_RESULT_FAILED:      return "failed";
+        case HOST_RESULT_TIMEOUT:     return "timeout";
+        case HOST_RESULT_UNREACHABLE: return "unreachable";
+        case HOST_RESULT_REJECTED:    return "rejected";
+        case HOST_RESULT_SKIPPED:     return "skipped";
+        default:                      return "unknown";
+    }
+}
+
+static bool load_hosts(FleetRun* run, const char* path) {
+    FILE* file = NULL;
+    if (fopen_s(&file, path, "r") != 0 || !file) {
+        log_error("Failed to open hosts file: %s", path);
+        return false;
+    }
+
+    int capacity = 0;
+    bool ok = true;
+    char line[512];
+    int line_number = 0;
+    while (ok && fgets(line, sizeof(line), file)) {
+        line_number++;
+        char* comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+        char* entry = str_trim(line);
+        if (!*entry) continue;
+
+        if (run->count == FLEET_MAX_HOSTS) {
+            log_error("Too many hosts in %s", path);
+            ok = false;
+            break;
+        }
+        if (run->count == capacity) {
+            int grown_capacity = capacity ? capacity * 2 : 64;
+            FleetHost* grown = (FleetHost*)realloc(run->hosts, grown_capacity * sizeof(FleetHost));
+            if (!grown) {
+                ok = false;
+                break;
+            }
+            run->hosts = grown;
+            capacity = grown_capacity;
+        }
+
+        FleetHost* host = &run->hosts[run->count];
+        memset(host, 0, sizeof(FleetHost));
+        host->socket = INVALID_SOCKET;
+        host->port = FLEET_DEFAULT_PORT;
+        host->name = _strdup(entry);
+        if (!host->name || !fleet_parse_address(entry, host->host, sizeof(host->host), &host->port) ||
+            !host->host[0]) {
+            log_error("%s:%d: invalid host '%s'", path, line_number, entry);
+            free(host->name);
+            ok = false;
+            break;
+        }
+        run->count++;
+    }
+
+    fclose(file);
+    if (ok && run->count == 0) {
+        log_error("No hosts in %s", path);
+        ok = false;
+    }
+    return ok;
+}
+
+// "1,10%,100%" -> cumulative host counts. A final stage covers any hosts the
+// list leaves out.
+static bool parse_stages(FleetRun* run, const char* stages) {
+    int capacity = 1;
+    for (const char* p = stages; p && *p; p++) {
+        if (*p == ',') capacity++;
+    }
+    capacity++;
+
+    run->stage_ends = (int*)malloc(capacity * sizeof(int));
+    if (!run->stage_ends) return false;
+
+    int previous = 0;
+    const char* p = stages;
+    while (p && *p) {
+        char* end = NULL;
+        double value = strtod(p, &end);
+        int hosts;
+        if (end && *end == '%') {
+            hosts = (int)((value * run->count + 99.0) / 100.0);
+            end++;
+        } else {
+            hosts = (int)value;
+        }
+        if (end == p || value <= 0 || (*end != ',' && *end != '\0')) {
+            log_error("Invalid --stages value: %s", stages);
+            return false;
+        }
+
+        if (hosts > run->count) hosts = run->count;
+        if (hosts > previous) {
+            run->stage_ends[run->stage_count++] = hosts;
+            previous = hosts;
+        }
+        p = *end ? end + 1 : end;
+    }
+
+    if (previous < run->count) {
+        run->stage_ends[run->stage_count++] = run->count;
+    }
+
+    int stage = 0;
+    for (int i = 0; i < run->count; i++) {
+        if (i == run->stage_ends[stage]) stage++;
+        run->hosts[i].stage = stage + 1;
+    }
+    return true;
+}
+
+// Plans and topologies travel verbatim; the agent decodes them
+static BYTE* read_request_file(const char* path, DWORD* out_length) {
+    FILE* file = NULL;
+    if (fopen_s(&file, path, "rb") != 0 || !file) {
+        log_error("Failed to open %s", path);
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long file_size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    BYTE* data = NULL;
+    if (file_size <= 0 || file_size > FLEET_MAX_PAYLOAD) {
+        log_error("%s is too large to send", path);
+    } else if ((data = (BYTE*)malloc((size_t)file_size)) != NULL) {
+        *out_length = (DWORD)fread(data, 1, (size_t)file_size, file);
+    }
+
+    fclose(file);
+    return data;
+}
+
+// Checks the action locally, so a typo fails once instead of on every host,
+// and encodes the request payload every host is sent
+static bool build_request(FleetRun* run, MosDefContext* ctx) {
+    const char* action = run->options->action;
+    while (*action == ' ') action++;
+
+    const char* rest = strchr(action, ' ');
+    size_t verb_length = rest ? (size_t)(rest - action) : strlen(action);
+
+    char path[MAX_PATH] = "";
+    if (rest) {
+        while (*rest == ' ' || *rest == '"') rest++;
+        strncpy_s(path, sizeof(path), rest, _TRUNCATE);
+        size_t length = strlen(path);
+        while (length > 0 && (path[length - 1] == ' ' || path[length - 1] == '"')) {
+            path[--length] = '\0';
+        }
+    }
+
+    FleetMessageType type = FLEET_REQUEST_ROTATE;
+    BYTE* body = NULL;
+    DWORD body_length = 0;
+
+    if (verb_length == 5 && strncmp(action, "apply", 5) == 0) {
+        RotationPlan* plan = NULL;
+        if (!path[0] || mosdef_load_plan(ctx, path, &plan) != MOSDEF_OK) {
+            log_error("apply requires a valid plan file");
+            return false;
+        }
+        mosdef_free_plan(ctx, plan);
+        type = FLEET_REQUEST_APPLY;
+        body = read_request_file(path, &body_length);
+    } else if (verb_length == 6 && strncmp(action, "layout", 6) == 0) {
+        MonitorList* layout = NULL;
+        if (!path[0] || mosdef_read_topology(ctx, path, &layout) != MOSDEF_OK) {
+            log_error("layout requires a valid topology file");
+            return false;
+        }
+        mosdef_free_monitor_list(ctx, layout);
+        type = FLEET_REQUEST_LAYOUT;
+        body = read_request_file(path, &body_length);
+    } else {
+        RotationAction parsed;
+        if (!parse_rotation_action(action, NULL, &parsed)) {
+            log_error("Fleet action must be a rotation with selectors, apply <plan> or layout <file>: %s",
+                      run->options->action);
+            return false;
+        }
+        free_rotation_action(&parsed);
+        body_length = (DWORD)strlen(action);
+        body = (BYTE*)_strdup(action);
+    }
+
+    if (!body) return false;
+
+    run->type = type;
+    run->flags = run->options->dry_run ? FLEET_FLAG_DRY_RUN : 0;
+    run->payload = body;
+    run->payload_length = body_length;
+    return true;
+}
+
+static void finish_host(FleetHost* host, HostResult result) {
+    if (host->socket != INVALID_SOCKET) {
+        closesocket(host->socket);
+        host->socket = INVALID_SOCKET;
+    }
+    host->phase = HOST_DONE;
+    host->result = result;
+    host->elapsed_ms = event_timestamp_elapsed_us(host->started, event_timestamp_now()) / 1000.0;
+}
+
+static void start_host(FleetHost* host, DWORD deadline_ms) {
+    host->started = event_timestamp_now();
+    host->deadline = GetTickCount64() + deadline_ms;
+
+    char service[8];
+    sprintf_s(service, sizeof(service), "%u", (unsigned)host->port);
+
+    ADDRINFOA hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+    hints.ai_flags = AI_NUMERICSERV;
+
+    ADDRINFOA* resolved = NULL;
+    if (getaddrinfo(host->host, service, &hints, &resolved) != 0 || !resolved) {
+        finish_host(host, HOST_RESULT_UNREACHABLE);
+        return;
+    }
+
+    host->socket = socket(resolved->ai_family, resolved->ai_socktype, resolved->ai_protocol);
+    u_long non_blocking = 1;
+    BOOL no_delay = TRUE;
+    if (host->socket == INVALID_SOCKET || ioctlsocket(host->socket, FIONBIO, &non_blocking) == SOCKET_ERROR) {
+        freeaddrinfo(resolved);
+        finish_host(host, HOST_RESULT_UNREACHABLE);
+        return;
+    }
+    setsockopt(host->socket, IPPROTO_TCP, TCP_NODELAY, (const char*)&no_delay, sizeof(no_delay));
+
+    host->phase = HOST_CONNECTING;
+    if (connect(host->socket, resolved->ai_addr, (int)resolved->ai_addrlen) == SOCKET_ERROR &&
+        WSAGetLastError() != WSAEWOULDBLOCK) {
+        finish_host(host, HOST_RESULT_UNREACHABLE);
+    }
+    freeaddrinfo(resolved);
+}
+
+// Moves one host as far as its socket allows without blocking
+static void advance_host(FleetRun* run, FleetHost* host, short revents) {
+    if (host->phase == HOST_CONNECTING) {
+        int error = 0;
+        int error_size = sizeof(error);
+        getsockopt(host->socket, SOL_SOCKET, SO_ERROR, (char*)&error, &error_size);
+        if (error != 0 || (revents & (POLLERR | POLLHUP))) {
+            finish_host(host, HOST_RESULT_UNREACHABLE);
+            return;
+        }
+        host->phase = HOST_AWAITING_CHALLENGE;
+        return;
+    }
+
+    if (host->phase == HOST_AWAITING_CHALLENGE) {
+        DWORD frame_size = (DWORD)sizeof(host->challenge);
+        int count = recv(host->socket, (char*)host->challenge + host->received, (int)(frame_size - host->received), 0);
+        if (count == SOCKET_ERROR && WSAGetLastError() == WSAEWOULDBLOCK) return;
+        if (count <= 0) {
+            finish_host(host, HOST_RESULT_UNREACHABLE);
+            return;
+        }
+        host->received += (DWORD)count;
+        if (host->received < frame_size) return;
+
+        FleetMessageType type;
+        BYTE flags;
+        DWORD length;
+        if (!fleet_parse_header(host->challenge, &type, &flags, &length) ||
+            type != FLEET_CHALLENGE || length != FLEET_CHALLENGE_SIZE) {
+            finish_host(host, HOST_RESULT_UNREACHABLE);
+            return;
+        }
+
+        fleet_write_header(host->request_header, run->type, run->flags, run->payload_length);
+        fleet_sign_frame(&run->key, host->challenge + FLEET_HEADER_SIZE, NULL,
+                         host->request_header, run->payload, run->payload_length);
+        host->received = 0;
+        host->phase = HOST_SENDING;
+    }
+
+    if (host->phase == HOST_SENDING) {
+        // The signed header, then the shared payload
+        DWORD total = FLEET_HEADER_SIZE + run->payload_length;
+        bool in_header = host->sent < FLEET_HEADER_SIZE;
+        const BYTE* data = in_header ? host->request_header + host->sent
+                                     : run->payload + (host->sent - FLEET_HEADER_SIZE);
+        DWORD remaining = in_header ? FLEET_HEADER_SIZE - host->sent : total - host->sent;
+
+        int count = send(host->socket, (const char*)data, (int)remaining, 0);
+        if (count == SOCKET_ERROR) {
+            if (WSAGetLastError() != WSAEWOULDBLOCK) finish_host(host, HOST_RESULT_UNREACHABLE);
+            return;
+        }
+        host->sent += (DWORD)count;
+        if (host->sent == total) {
+            host->phase = HOST_RECEIVING;
+        }
+        return;
+    }
+
+    if (host->phase != HOST_RECEIVING) return;
+
+    for (;;) {
+        // Header first, then a body of the length it announces
+        bool in_header = host->received < FLEET_HEADER_SIZE;
+        BYTE* target = in_header ? host->header + host->received
+                                 : host->body + (host->received - FLEET_HEADER_SIZE);
+        DWORD wanted = in_header ? FLEET_HEADER_SIZE - host->received
+                                 : FLEET_HEADER_SIZE + host->body_length - host->received;
+
+        int count = recv(host->socket, (char*)target, (int)wanted, 0);
+        if (count == SOCKET_ERROR && WSAGetLastError() == WSAEWOULDBLOCK) return;
+        if (count <= 0) {
+            finish_host(host, HOST_RESULT_UNREACHABLE);
+            return;
+        }
+        host->received += (DWORD)count;
+
+        if (in_header && host->received == FLEET_HEADER_SIZE) {
+            FleetMessageType type;
+            BYTE flags;
+            if (!fleet_parse_header(host->header, &type, &flags, &host->body_length) || type != FLEET_RESPONSE) {
+                finish_host(host, HOST_RESULT_UNREACHABLE);
+                return;
+            }
+            if (flags & FLEET_FLAG_REJECTED) {
+                finish_host(host, HOST_RESULT_REJECTED);
+                return;
+            }
+            if (host->body_length < 6 || host->body_length > FLEET_MAX_RESPONSE) {
+                finish_host(host, HOST_RESULT_UNREACHABLE);
+                return;
+            }
+            host->body = (BYTE*)malloc(host->body_length);
+            if (!host->body) {
+                finish_host(host, HOST_RESULT_UNREACHABLE);
+                return;
+            }
+        } else if (!in_header && host->received == FLEET_HEADER_SIZE + host->body_length) {
+            if (!fleet_verify_frame(&run->key, host->challenge + FLEET_HEADER_SIZE,
+                                    host->request_header + FLEET_SIGNED_HEADER_SIZE,
+                                    host->header, host->body, host->body_length)) {
+                log_verbose("Response from %s has a bad MAC", host->name);
+                finish_host(host, HOST_RESULT_REJECTED);
+                return;
+            }
+            finish_host(host, host->body[0] == MOSDEF_OK ? HOST_RESULT_OK : HOST_RESULT_FAILED);
+            return;
+        }
+    }
+}
+
+static void print_host_record(const FleetHost* host) {
+    char* host_json = json_escape_string(host->name);
+    printf("{\"event\":\"host\",\"host\":%s,\"stage\":%d,\"result\":\"%s\"",
+           host_json ? host_json : "null", host->stage, get_host_result_name(host->result));
+    free(host_json);
+
+    if (host->result == HOST_RESULT_OK || host->result == HOST_RESULT_FAILED) {
+        WORD changed;
+        WORD message_length;
+        memcpy(&changed, host->body + 2, sizeof(changed));
+        memcpy(&message_length, host->body + 4, sizeof(message_length));
+        if (message_length > host->body_length - 6) {
+            message_length = (WORD)(host->body_length - 6);
+        }
+
+        printf(",\"status\":\"%s\",\"exit\":%d,\"changed\":%u",
+               mosdef_status_string((MosDefStatus)host->body[0]), (int)host->body[1], (unsigned)changed);
+
+        if (message_length > 0) {
+            char* message = (char*)malloc(message_length + 1);
+            if (message) {
+                memcpy(message, host->body + 6, message_length);
+                message[message_length] = '\0';
+                char* message_json = json_escape_string(message);
+                printf(",\"error\":%s", message_json ? message_json : "null");
+                free(message_json);
+                free(message);
+            }
+        }
+    }
+
+    if (host->result != HOST_RESULT_SKIPPED) {
+        printf(",\"ms\":%.1f", host->elapsed_ms);
+    }
+    printf("}\n");
+    fflush(stdout);
+}
+
+// Runs hosts [first, last) with at most options->window in flight, streaming
+// each result as it lands. Every host in the range is done on return.
+static void run_stage(FleetRun* run, int first, int last) {
+    int window = run->options->window;
+    WSAPOLLFD* fds = (WSAPOLLFD*)malloc(window * sizeof(WSAPOLLFD));
+    int* slots = (int*)malloc(window * sizeof(int));     // Host index per fds entry
+    if (!fds || !slots) {
+        for (int i = first; i < last; i++) {
+            finish_host(&run->hosts[i], HOST_RESULT_UNREACHABLE);
+            print_host_record(&run->hosts[i]);
+        }
+        free(fds);
+        free(slots);
+        return;
+    }
+
+    int next = first;
+    int in_flight = 0;
+    for (;;) {
+        // Refill the window
+        while (in_flight < window && next < last) {
+            FleetHost* host = &run->hosts[next];
+            start_host(host, run->options->deadline_ms);
+            if (host->phase == HOST_DONE) {
+                print_host_record(host);
+            } else {
+                fds[in_flight].fd = host->socket;
+                slots[in_flight++] = next;
+            }
+            next++;
+        }
+        if (in_flight == 0) break;
+
+        // Wait on every host in flight until the nearest deadline
+        ULONGLONG now = GetTickCount64();
+        ULONGLONG nearest = ~0ULL;
+        for (int i = 0; i < in_flight; i++) {
+            const FleetHost* host = &run->hosts[slots[i]];
+            fds[i].events = (host->phase == HOST_RECEIVING || host->phase == HOST_AWAITING_CHALLENGE)
+                ? POLLRDNORM : POLLWRNORM;
+            fds[i].revents = 0;
+            if (host->deadline < nearest) nearest = host->deadline;
+        }
+
+        int timeout = nearest > now ? (int)(nearest - now) : 0;
+        if (WSAPoll(fds, (ULONG)in_flight, timeout) == SOCKET_ERROR) {
+            log_verbose("WSAPoll failed (error %d)", WSAGetLastError());
+        }
+
+        // Advance ready hosts; finished ones leave the window by swapping in
+        // the last entry
+        now = GetTickCount64();
+        for (int i = 0; i < in_flight;) {
+            FleetHost* host = &run->hosts[slots[i]];
+            if (fds[i].revents) {
+                advance_host(run, host, fds[i].revents);
+            }
+            if (host->phase != HOST_DONE && now >= host->deadline) {
+                finish_host(host, HOST_RESULT_TIMEOUT);
+            }
+
+            if (host->phase == HOST_DONE) {
+                print_host_record(host);
+                in_flight--;
+                fds[i] = fds[in_flight];
+                slots[i] = slots[in_flight];
+            } else {
+                i++;
+            }
+        }
+    }
+
+    free(fds);
+    free(slots);
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a;
+    double y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static void print_summary(const FleetRun* run, bool halted, double elapsed_ms) {
+    int ok = 0;
+    int failed = 0;
+    int skipped = 0;
+    double* latencies = (double*)malloc(run->count * sizeof(double));
+
+    for (int i = 0; i < run->count; i++) {
+        const FleetHost* host = &run->hosts[i];
+        if (host->result == HOST_RESULT_OK) {
+            if (latencies) latencies[ok] = host->elapsed_ms;
+            ok++;
+        } else if (host->result == HOST_RESULT_SKIPPED) {
+            skipped++;
+        } else {
+            failed++;
+        }
+    }
+
+    printf("{\"event\":\"summary\",\"hosts\":%d,\"ok\":%d,\"failed\":%d,\"skipped\":%d,\"halted\":%s,"
+           "\"elapsed_ms\":%.1f",
+           run->count, ok, failed, skipped, halted ? "true" : "false", elapsed_ms);
+    if (latencies && ok > 0) {
+        qsort(latencies, ok, sizeof(double), compare_doubles);
+        printf(",\"p50_ms\":%.1f,\"p95_ms\":%.1f,\"max_ms\":%.1f",
+               latencies[(ok - 1) / 2], latencies[(ok * 95 - 1) / 100], latencies[ok - 1]);
+    }
+    printf("}\n");
+    fflush(stdout);
+    free(latencies);
+}
+
+static void free_fleet_run(FleetRun* run) {
+    for (int i = 0; i < run->count; i++) {
+        free(run->hosts[i].name);
+        free(run->hosts[i].body);
+        if (run->hosts[i].socket != INVALID_SOCKET) {
+            closesocket(run->hosts[i].socket);
+        }
+    }
+    free(run->hosts);
+    free(run->payload);
+    free(run->stage_ends);
+    SecureZeroMemory(&run->key, sizeof(run->key));
+}
+
+int run_fleet(MosDefContext* ctx, const FleetOptions* options) {
+    if (!options->hosts_path || !options->action || options->window < 1 || options->deadline_ms == 0 ||
+        options->max_failure_rate < 0.0 || options->max_failure_rate > 1.0) {
+        log_error("fleet requires a hosts file and an action; --parallel and --deadline must be "
+                  "positive and --max-failure-rate between 0 and 1");
+        return 2;
+    }
+
+    FleetRun run;
+    memset(&run, 0, sizeof(run));
+    run.options = options;
+    if (!load_hosts(&run, options->hosts_path) || !parse_stages(&run, options->stages) ||
+        !fleet_load_key(options->key_path, false, &run.key) || !build_request(&run, ctx)) {
+        free_fleet_run(&run);
+        return 2;
+    }
+
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
+        log_error("Failed to initialize Winsock");
+        free_fleet_run(&run);
+        return 3;
+    }
+
+    LONG64 started = event_timestamp_now();
+    bool halted = false;
+    int completed = 0;
+    int failed = 0;
+
+    for (int stage = 0; stage < run.stage_count && !halted; stage++) {
+        int first = stage > 0 ? run.stage_ends[stage - 1] : 0;
+        int last = run.stage_ends[stage];
+        run_stage(&run, first, last);
+
+        int stage_ok = 0;
+        for (int i = first; i < last; i++) {
+            if (run.hosts[i].result == HOST_RESULT_OK) stage_ok++;
+        }
+        completed += last - first;
+        failed += (last - first) - stage_ok;
+
+        // The threshold is checked on everything rolled out so far, so a
+        // bad canary stops the rollout before the next stage starts
+        double failure_rate = (double)failed / completed;
+        halted = failure_rate > options->max_failure_rate && last < run.count;
+
+        printf("{\"event\":\"stage\",\"stage\":%d,\"hosts\":%d,\"ok\":%d,\"failed\":%d,"
+               "\"completed\":%d,\"failure_rate\":%.3f,\"halted\":%s}\n",
+               stage + 1, last - first, stage_ok, (last - first) - stage_ok,
+               completed, failure_rate, halted ? "true" : "false");
+        fflush(stdout);
+
+        if (halted) {
+            log_error("Failure rate %.1f%% exceeds %.1f%%; halting after stage %d",
+                      failure_rate * 100.0, options->max_failure_rate * 100.0, stage + 1);
+            for (int i = last; i < run.count; i++) {
+                run.hosts[i].result = HOST_RESULT_SKIPPED;
+                print_host_record(&run.hosts[i]);
+            }
+        }
+    }
+
+    print_summary(&run, halted, event_timestamp_elapsed_us(started, event_timestamp_now()) / 1000.0);
+
+    WSACleanup();
+    int result = (failed > 0 || halted) ? 6 : 0;
+    free_fleet_run(&run);
+    return result;
+}
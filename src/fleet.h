@@ -0,0 +1,108 @@
+#ifndef FLEET_H
+#define FLEET_H
+
+#include <windows.h>
+#include <stdbool.h>
+#include "mosdef.h"
+#include "config.h"
+
+// Fleet rollout: a controller fans one command out to many agents over TCP.
+// Each exchange is a challenge, a request frame and a response frame on a
+// fresh connection. Frames are little-endian:
+//
+//   header    "MDFL", u8 version, u8 type, u8 flags, u8 reserved, u32 length,
+//             32-byte HMAC-SHA256
+//   challenge 16 random bytes, sent unsigned by the agent on connect
+//   rotate    a rotation command line, e.g. "portrait --only M2", resolved
+//             by the agent as a hotkey action would be
+//   apply     a plan file, byte for byte (planfile.h)
+//   layout    a topology file, byte for byte (topofile.h)
+//   response  u8 status (MosDefStatus), u8 exit code, u16 monitors changed,
+//             u16 length + error message
+//
+// Both ends share a key file. A request is signed over the challenge, the
+// first 12 header bytes and the payload; a response over the challenge, the
+// request's MAC, its own first 12 header bytes and its body. A fresh
+// challenge per connection means a captured request cannot be replayed, to
+// the same agent or another one. An agent answers a request with a bad MAC
+// with an empty, unsigned response flagged FLEET_FLAG_REJECTED.
+//
+// Agents read requests from many connections at once but run them one at a
+// time; display changes are never concurrent.
+
+#define FLEET_PROTOCOL_VERSION 2
+#define FLEET_DEFAULT_PORT 47600
+#define FLEET_HEADER_SIZE 44
+#define FLEET_SIGNED_HEADER_SIZE 12
+#define FLEET_CHALLENGE_SIZE 16
+#define FLEET_MAX_PAYLOAD (1024 * 1024)
+
+typedef enum {
+    FLEET_REQUEST_ROTATE = 1,
+    FLEET_REQUEST_APPLY = 2,
+    FLEET_REQUEST_LAYOUT = 3,
+    FLEET_RESPONSE = 0x80,
+    FLEET_CHALLENGE = 0x81
+} FleetMessageType;
+
+#define FLEET_FLAG_DRY_RUN 0x01
+#define FLEET_FLAG_REJECTED 0x02
+
+// Frame header helpers shared by both ends. write leaves the MAC zeroed;
+// parse returns false for a bad magic, version or length.
+void fleet_write_header(BYTE* header, FleetMessageType type, BYTE flags, DWORD length);
+bool fleet_parse_header(const BYTE* header, FleetMessageType* out_type, BYTE* out_flags, DWORD* out_length);
+
+// Shared key: the contents of a key file, surrounding whitespace trimmed,
+// FLEET_MIN_KEY_SIZE to FLEET_MAX_KEY_SIZE bytes. The default file is
+// %LOCALAPPDATA%\MOS-DEF\fleet.key; with create, a missing default file is
+// generated with 32 random bytes in hex. Returns false, logging why, if no
+// usable key was read.
+#define FLEET_MIN_KEY_SIZE 16
+#define FLEET_MAX_KEY_SIZE 1024
+#define FLEET_KEY_FILE "fleet.key"
+
+typedef struct {
+    BYTE bytes[FLEET_MAX_KEY_SIZE];
+    size_t size;
+} FleetKey;
+
+bool fleet_load_key(const char* path, bool create, FleetKey* out_key);
+
+// Signs or checks a frame in place (the MAC field of header). request_mac is
+// the MAC of the request a response answers, NULL for a request.
+void fleet_sign_frame(const FleetKey* key, const BYTE* challenge, const BYTE* request_mac,
+                      BYTE* header, const BYTE* body, DWORD length);
+bool fleet_verify_frame(const FleetKey* key, const BYTE* challenge, const BYTE* request_mac,
+                        const BYTE* header, const BYTE* body, DWORD length);
+
+// Parses "host", "host:port" or ":port"
+bool fleet_parse_address(const char* text, char* host, size_t host_size, USHORT* port);
+
+// Agent: serves requests on address ("host:port", NULL or ":port" for
+// loopback) until Ctrl+C, with contexts created from options. config (NULL
+// for none) supplies the default selector for rotate requests and must
+// outlive the call. key_path NULL uses (and creates) the default key file. A topology file makes the agent
+// simulated: requests are resolved against the file and nothing is applied.
+// Returns a process exit code.
+int run_agent(const MosDefOptions* options, const MosDefConfig* config, const char* topology_path,
+              const char* address, const char* key_path);
+
+typedef struct {
+    const char* hosts_path;     // One "host[:port]" per line, # comments
+    const char* key_path;       // NULL for the default key file
+    const char* action;         // "portrait --only M2", "apply <plan>" or "layout <topology.json>"
+    bool dry_run;               // Agents resolve and report without applying
+    int window;                 // Hosts in flight at once
+    DWORD deadline_ms;          // Per host, connect to response
+    const char* stages;         // "1,10%,100%": cumulative hosts per stage; NULL for one
+    double max_failure_rate;    // Halt after a stage above this (0..1)
+} FleetOptions;
+
+// Controller: checks the action locally (ctx loads plans and topologies),
+// then streams one NDJSON record per host as it finishes, a record per
+// completed stage and a summary. Returns 0 if every host succeeded, 6 if any
+// failed or the rollout halted, 2 for a bad action or options.
+int run_fleet(MosDefContext* ctx, const FleetOptions* options);
+
+#endif // FLEET_H
@@ -0,0 +1,199 @@
+#include "groups.h"
+#include "rotate.h"
+#include "util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    char* name;
+    char* definition;
+    SelectorList* members;      // Parsed on first use
+    bool resolved;              // bits hold membership for fingerprint
+    ULONG64 fingerprint;
+    int monitor_count;
+    ULONG64* bits;
+} MonitorGroup;
+
+// One exclusive lock covers definitions and caches. Nested groups resolve on
+// the thread that already holds it, tracked by t_group_depth.
+static SRWLOCK g_groups_lock = SRWLOCK_INIT;
+static MonitorGroup* g_groups = NULL;
+static int g_group_count = 0;
+static MOSDEF_THREAD_LOCAL int t_group_depth = 0;
+
+static void free_group(MonitorGroup* group) {
+    free(group->name);
+    free(group->definition);
+    free_selector_list(group->members);
+    free(group->bits);
+}
+
+static MonitorGroup* find_group(const char* name) {
+    for (int i = 0; i < g_group_count; i++) {
+        if (g_groups[i].name && strcmp(g_groups[i].name, name) == 0) {
+            return &g_groups[i];
+        }
+    }
+    return NULL;
+}
+
+bool monitor_groups_define(const ConfigMap* definitions) {
+    if (!definitions) return false;
+    if (t_group_depth > 0) return false;
+
+    int count = definitions->count;
+    MonitorGroup* groups = (MonitorGroup*)calloc(count > 0 ? count : 1, sizeof(MonitorGroup));
+    int* reused = (int*)malloc((count > 0 ? count : 1) * sizeof(int));
+    if (!groups || !reused) {
+        free(groups);
+        free(reused);
+        return false;
+    }
+
+    AcquireSRWLockExclusive(&g_groups_lock);
+
+    // Unchanged groups keep their parsed members
+    bool success = true;
+    bool changed = count != g_group_count;
+    for (int i = 0; i < count && success; i++) {
+        const ConfigEntry* entry = &definitions->entries[i];
+        MonitorGroup* existing = find_group(entry->key);
+        reused[i] = (existing && strcmp(existing->definition, entry->value) == 0) ? (int)(existing - g_groups) : -1;
+        if (reused[i] < 0) {
+            changed = true;
+            groups[i].name = _strdup(entry->key);
+            groups[i].definition = _strdup(entry->value);
+            success = groups[i].name && groups[i].definition;
+        }
+    }
+
+    if (success) {
+        for (int i = 0; i < count; i++) {
+            if (reused[i] >= 0) {
+                groups[i] = g_groups[reused[i]];
+                memset(&g_groups[reused[i]], 0, sizeof(MonitorGroup));
+            }
+
+            // A group's membership depends on every group it nests, so
+            // after any change none of the cached ones can be trusted
+            if (changed && groups[i].resolved) {
+                free(groups[i].bits);
+                groups[i].bits = NULL;
+                groups[i].resolved = false;
+            }
+        }
+        for (int i = 0; i < g_group_count; i++) {
+            free_group(&g_groups[i]);
+        }
+        free(g_groups);
+        g_groups = groups;
+        g_group_count = count;
+    } else {
+        for (int i = 0; i < count; i++) {
+            free_group(&groups[i]);
+        }
+        free(groups);
+    }
+
+    ReleaseSRWLockExclusive(&g_groups_lock);
+    free(reused);
+    return success;
+}
+
+// Looks up a group and parses its members; call with the lock held
+static MonitorGroup* prepare_group(const char* name) {
+    MonitorGroup* group = find_group(name);
+    if (!group) {
+        log_error("Unknown monitor group: %s", name);
+        return NULL;
+    }
+
+    if (t_group_depth >= MONITOR_GROUP_MAX_DEPTH) {
+        log_error("Monitor group %s nests more than %d levels deep (is it part of a cycle?)",
+                  name, MONITOR_GROUP_MAX_DEPTH);
+        return NULL;
+    }
+
+    if (!group->members) {
+        group->members = parse_selector_list(group->definition);
+        if (!group->members) {
+            log_error("Invalid definition for monitor group %s: %s", name, group->definition);
+            return NULL;
+        }
+    }
+    return group;
+}
+
+static bool resolve_group(MonitorGroup* group, const MonitorList* monitors) {
+    ULONG64 fingerprint = monitor_list_fingerprint(monitors);
+    if (group->resolved && group->fingerprint == fingerprint && group->monitor_count == monitors->count) {
+        return true;
+    }
+
+    int words = MONITOR_BITSET_WORDS(monitors->count);
+    ULONG64* bits = (ULONG64*)calloc(words > 0 ? words : 1, sizeof(ULONG64));
+    if (!bits) return false;
+
+    if (!select_monitors(monitors, group->members, bits)) {
+        free(bits);
+        return false;
+    }
+
+    free(group->bits);
+    group->bits = bits;
+    group->fingerprint = fingerprint;
+    group->monitor_count = monitors->count;
+    group->resolved = true;
+
+    int members = 0;
+    for (int i = 0; i < monitors->count; i++) {
+        members += MONITOR_BITSET_TEST(bits, i) ? 1 : 0;
+    }
+    log_verbose("Resolved monitor group %s: %d of %d monitor(s)", group->name, members, monitors->count);
+    return true;
+}
+
+bool monitor_group_select(const char* name, const MonitorList* monitors, ULONG64* bits) {
+    if (!name || !monitors || !bits) return false;
+
+    bool outermost = t_group_depth == 0;
+    if (outermost) AcquireSRWLockExclusive(&g_groups_lock);
+
+    MonitorGroup* group = prepare_group(name);
+    bool success = false;
+    if (group) {
+        t_group_depth++;
+        success = resolve_group(group, monitors);
+        t_group_depth--;
+    }
+
+    if (success) {
+        for (int w = 0; w < MONITOR_BITSET_WORDS(monitors->count); w++) {
+            bits[w] |= group->bits[w];
+        }
+    }
+
+    if (outermost) ReleaseSRWLockExclusive(&g_groups_lock);
+    return success;
+}
+
+bool monitor_group_matches(const char* name, const MonitorInfo* monitor) {
+    if (!name || !monitor) return false;
+
+    bool outermost = t_group_depth == 0;
+    if (outermost) AcquireSRWLockExclusive(&g_groups_lock);
+
+    MonitorGroup* group = prepare_group(name);
+    bool matched = false;
+    if (group) {
+        t_group_depth++;
+        for (int i = 0; i < group->members->count && !matched; i++) {
+            matched = monitor_matches_selector(monitor, &group->members->selectors[i]);
+        }
+        t_group_depth--;
+    }
+
+    if (outermost) ReleaseSRWLockExclusive(&g_groups_lock);
+    return matched;
+}
@@ -0,0 +1,36 @@
+#ifndef GROUPS_H
+#define GROUPS_H
+
+#include <windows.h>
+#include <stdbool.h>
+#include "enum.h"
+#include "config.h"
+
+// Named monitor groups from the "groups" config object, referenced as
+// group:NAME in any selector position:
+//
+//   "groups": { "left-wall": "M1,M3,M5", "dells": "name:\"DELL\",group:left-wall" }
+//
+// A group's members are a selector list, parsed on first use. Membership is
+// resolved once per topology fingerprint into a bitset (bit i is
+// monitors->monitors[i]) and reused until the topology changes. Groups may
+// nest up to MONITOR_GROUP_MAX_DEPTH; deeper nesting is treated as a cycle.
+// Definitions and cached memberships are process-wide, shared by every
+// context. Thread-safe.
+
+#define MONITOR_GROUP_MAX_DEPTH 8
+
+// Replaces the process-wide definitions. Groups whose name and definition
+// are unchanged keep their parsed members; if anything changed, every cached
+// membership is dropped, since a group may nest one that changed.
+bool monitor_groups_define(const ConfigMap* definitions);
+
+// ORs the group's membership into bits (MONITOR_BITSET_WORDS(count) words).
+// Returns false after logging for an unknown group, a bad definition or a
+// cycle.
+bool monitor_group_select(const char* name, const MonitorList* monitors, ULONG64* bits);
+
+// Single-monitor form, evaluating the members directly
+bool monitor_group_matches(const char* name, const MonitorInfo* monitor);
+
+#endif // GROUPS_H
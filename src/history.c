@@ -0,0 +1,686 @@
+#include "history.h"
+#include "util.h"
+#include "event_ring.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Segment log:   "MOSHIST\0", u32 version, u32 record size, then records
+// Record:        u64 timestamp, u16 device, u8 action, u8 orientations
+//                (old | new << 4), i32 error code, u32 latency_us,
+//                u16 old width, old height, new width, new height
+// Sidecar index: "MOSHIDX\0", u32 version, then tagged entries
+//                'D' u16 device, u8 length + device path, u8 length + stable ID
+//                'T' u32 record number, u64 timestamp of that record
+#define HISTORY_LOG_MAGIC "MOSHIST"
+#define HISTORY_INDEX_MAGIC "MOSHIDX"
+#define HISTORY_MAGIC_SIZE 8
+#define HISTORY_VERSION 1
+#define HISTORY_LOG_HEADER_SIZE 16
+#define HISTORY_INDEX_HEADER_SIZE 12
+#define HISTORY_RECORD_SIZE 28
+#define HISTORY_MAX_DEVICES 0xFFFF
+#define HISTORY_LOCK_TIMEOUT_MS 5000
+
+#define INDEX_TAG_DEVICE 'D'
+#define INDEX_TAG_TIME   'T'
+
+typedef struct {
+    char* device_path;
+    char* stable_id;
+} HistoryDevice;
+
+typedef struct {
+    DWORD record;
+    ULONG64 timestamp;
+} IndexMark;
+
+typedef struct {
+    ULONG64 start;              // Timestamp in the file name
+    char* log_path;
+    char* index_path;
+    HistoryDevice* devices;
+    int device_count;
+    IndexMark* marks;
+    int mark_count;
+    long index_size;            // Bytes of intact index entries
+    bool index_torn;            // Damaged entries follow index_size
+    DWORD count;                // Whole records in the log
+} Segment;
+
+typedef struct {
+    BYTE* data;
+    size_t length;
+    size_t capacity;
+    bool failed;
+} HistoryBuffer;
+
+const char* get_history_action_name(HistoryAction action) {
+    switch (action) {
+        case HISTORY_ROTATE:   return "rotate";
+        case HISTORY_ROLLBACK: return "rollback";
+        case HISTORY_RESTORE:  return "restore";
+        default:               return "unknown";
+    }
+}
+
+static ULONG64 filetime_value(FILETIME time) {
+    return ((ULONG64)time.dwHighDateTime << 32) | time.dwLowDateTime;
+}
+
+static FILETIME filetime_from_value(ULONG64 value) {
+    FILETIME time = { (DWORD)value, (DWORD)(value >> 32) };
+    return time;
+}
+
+// Buffers
+static void put_bytes(HistoryBuffer* buffer, const void* data, size_t size) {
+    if (buffer->failed) return;
+
+    if (buffer->length + size > buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity * 2 : 512;
+        while (capacity < buffer->length + size) {
+            capacity *= 2;
+        }
+        BYTE* grown = (BYTE*)realloc(buffer->data, capacity);
+        if (!grown) {
+            buffer->failed = true;
+            return;
+        }
+        buffer->data = grown;
+        buffer->capacity = capacity;
+    }
+
+    memcpy(buffer->data + buffer->length, data, size);
+    buffer->length += size;
+}
+
+static void put_u8(HistoryBuffer* buffer, BYTE value)     { put_bytes(buffer, &value, sizeof(value)); }
+static void put_u16(HistoryBuffer* buffer, WORD value)    { put_bytes(buffer, &value, sizeof(value)); }
+static void put_u32(HistoryBuffer* buffer, DWORD value)   { put_bytes(buffer, &value, sizeof(value)); }
+static void put_u64(HistoryBuffer* buffer, ULONG64 value) { put_bytes(buffer, &value, sizeof(value)); }
+
+static void put_short_string(HistoryBuffer* buffer, const char* value) {
+    size_t length = value ? strlen(value) : 0;
+    if (length > 0xFF) length = 0xFF;
+    put_u8(buffer, (BYTE)length);
+    put_bytes(buffer, value, length);
+}
+
+static WORD clamp_u16(DWORD value) {
+    return (WORD)(value > 0xFFFF ? 0xFFFF : value);
+}
+
+static void put_record(HistoryBuffer* buffer, const HistoryEntry* entry, WORD device) {
+    put_u64(buffer, filetime_value(entry->timestamp));
+    put_u16(buffer, device);
+    put_u8(buffer, (BYTE)entry->action);
+    put_u8(buffer, (BYTE)((entry->old_orientation & 0x0F) | ((entry->new_orientation & 0x0F) << 4)));
+    put_u32(buffer, (DWORD)entry->error_code);
+    put_u32(buffer, entry->latency_us);
+    put_u16(buffer, clamp_u16(entry->old_width));
+    put_u16(buffer, clamp_u16(entry->old_height));
+    put_u16(buffer, clamp_u16(entry->new_width));
+    put_u16(buffer, clamp_u16(entry->new_height));
+}
+
+static void put_index_header(HistoryBuffer* buffer) {
+    put_bytes(buffer, HISTORY_INDEX_MAGIC, HISTORY_MAGIC_SIZE);
+    put_u32(buffer, HISTORY_VERSION);
+}
+
+static void put_device_entry(HistoryBuffer* buffer, WORD device, const char* device_path, const char* stable_id) {
+    put_u8(buffer, INDEX_TAG_DEVICE);
+    put_u16(buffer, device);
+    put_short_string(buffer, device_path);
+    put_short_string(buffer, stable_id);
+}
+
+static void put_time_entry(HistoryBuffer* buffer, DWORD record, ULONG64 timestamp) {
+    put_u8(buffer, INDEX_TAG_TIME);
+    put_u32(buffer, record);
+    put_u64(buffer, timestamp);
+}
+
+static WORD read_u16(const BYTE* data)  { WORD v;    memcpy(&v, data, sizeof(v)); return v; }
+static DWORD read_u32(const BYTE* data) { DWORD v;   memcpy(&v, data, sizeof(v)); return v; }
+static ULONG64 read_u64(const BYTE* data) { ULONG64 v; memcpy(&v, data, sizeof(v)); return v; }
+
+// Decodes a record; device strings are filled in by the caller
+static void get_record(const BYTE* data, HistoryEntry* entry, WORD* out_device) {
+    memset(entry, 0, sizeof(HistoryEntry));
+    entry->timestamp = filetime_from_value(read_u64(data));
+    *out_device = read_u16(data + 8);
+    entry->action = (HistoryAction)data[10];
+    entry->old_orientation = data[11] & 0x0F;
+    entry->new_orientation = data[11] >> 4;
+    entry->error_code = (LONG)read_u32(data + 12);
+    entry->latency_us = read_u32(data + 16);
+    entry->old_width = read_u16(data + 20);
+    entry->old_height = read_u16(data + 22);
+    entry->new_width = read_u16(data + 24);
+    entry->new_height = read_u16(data + 26);
+}
+
+// Segments
+static char* get_history_dir() {
+    char* dir = get_local_data_path("history");
+    if (dir) {
+        CreateDirectoryA(dir, NULL);
+    }
+    return dir;
+}
+
+static char* segment_file_path(const char* dir, ULONG64 start, const char* extension) {
+    size_t length = strlen(dir) + 32;
+    char* path = (char*)malloc(length);
+    if (path) {
+        sprintf_s(path, length, "%s\\seg-%016llx.%s", dir, (unsigned long long)start, extension);
+    }
+    return path;
+}
+
+static int compare_starts(const void* a, const void* b) {
+    ULONG64 left = *(const ULONG64*)a;
+    ULONG64 right = *(const ULONG64*)b;
+    return (left > right) - (left < right);
+}
+
+// Segment start timestamps, oldest first
+static ULONG64* list_segments(const char* dir, int* out_count) {
+    *out_count = 0;
+
+    size_t pattern_len = strlen(dir) + sizeof("\\seg-*.log");
+    char* pattern = (char*)malloc(pattern_len);
+    if (!pattern) return NULL;
+    sprintf_s(pattern, pattern_len, "%s\\seg-*.log", dir);
+
+    WIN32_FIND_DATAA find_data;
+    HANDLE find = FindFirstFileA(pattern, &find_data);
+    free(pattern);
+    if (find == INVALID_HANDLE_VALUE) return NULL;
+
+    ULONG64* starts = NULL;
+    int count = 0;
+    int capacity = 0;
+    do {
+        unsigned long long start;
+        if (sscanf(find_data.cFileName, "seg-%16llx.log", &start) != 1) continue;
+
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 16;
+            ULONG64* grown = (ULONG64*)realloc(starts, capacity * sizeof(ULONG64));
+            if (!grown) break;
+            starts = grown;
+        }
+        starts[count++] = start;
+    } while (FindNextFileA(find, &find_data));
+    FindClose(find);
+
+    if (starts) {
+        qsort(starts, count, sizeof(ULONG64), compare_starts);
+    }
+    *out_count = count;
+    return starts;
+}
+
+static void free_segment(Segment* segment) {
+    for (int i = 0; i < segment->device_count; i++) {
+        free(segment->devices[i].device_path);
+        free(segment->devices[i].stable_id);
+    }
+    free(segment->devices);
+    free(segment->marks);
+    free(segment->log_path);
+    free(segment->index_path);
+    memset(segment, 0, sizeof(Segment));
+}
+
+static bool add_device(Segment* segment, const char* device_path, const char* stable_id) {
+    if ((segment->device_count & 15) == 0) {
+        HistoryDevice* grown = (HistoryDevice*)realloc(segment->devices,
+                                                       (segment->device_count + 16) * sizeof(HistoryDevice));
+        if (!grown) return false;
+        segment->devices = grown;
+    }
+
+    HistoryDevice* device = &segment->devices[segment->device_count];
+    device->device_path = _strdup(device_path ? device_path : "");
+    device->stable_id = _strdup(stable_id ? stable_id : "");
+    if (!device->device_path || !device->stable_id) {
+        free(device->device_path);
+        free(device->stable_id);
+        return false;
+    }
+    segment->device_count++;
+    return true;
+}
+
+static bool add_mark(Segment* segment, DWORD record, ULONG64 timestamp) {
+    if ((segment->mark_count & 63) == 0) {
+        IndexMark* grown = (IndexMark*)realloc(segment->marks, (segment->mark_count + 64) * sizeof(IndexMark));
+        if (!grown) return false;
+        segment->marks = grown;
+    }
+    segment->marks[segment->mark_count].record = record;
+    segment->marks[segment->mark_count].timestamp = timestamp;
+    segment->mark_count++;
+    return true;
+}
+
+static BYTE* read_whole_file(const char* path, size_t* out_size) {
+    *out_size = 0;
+    FILE* file = NULL;
+    if (fopen_s(&file, path, "rb") != 0 || !file) return NULL;
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    BYTE* data = (size > 0) ? (BYTE*)malloc((size_t)size) : NULL;
+    if (data) {
+        *out_size = fread(data, 1, (size_t)size, file);
+    }
+    fclose(file);
+    return data;
+}
+
+// Parses the sidecar index up to its first torn entry
+static bool load_index(Segment* segment) {
+    size_t size = 0;
+    BYTE* data = read_whole_file(segment->index_path, &size);
+    if (!data || size < HISTORY_INDEX_HEADER_SIZE ||
+        memcmp(data, HISTORY_INDEX_MAGIC, HISTORY_MAGIC_SIZE) != 0 ||
+        read_u32(data + HISTORY_MAGIC_SIZE) != HISTORY_VERSION) {
+        free(data);
+        return false;
+    }
+
+    size_t offset = HISTORY_INDEX_HEADER_SIZE;
+    bool ok = true;
+    while (ok && offset < size) {
+        size_t start = offset;
+        BYTE tag = data[offset++];
+
+        if (tag == INDEX_TAG_TIME && size - offset >= 12) {
+            DWORD record = read_u32(data + offset);
+            ok = add_mark(segment, record, read_u64(data + offset + 4));
+            offset += 12;
+        } else if (tag == INDEX_TAG_DEVICE && size - offset >= 3) {
+            WORD index = read_u16(data + offset);
+            size_t path_len = data[offset + 2];
+            offset += 3;
+            if (index != segment->device_count || size - offset < path_len + 1) break;
+            size_t stable_len = data[offset + path_len];
+            if (size - offset < path_len + 1 + stable_len) break;
+
+            char path[256];
+            char stable_id[256];
+            memcpy(path, data + offset, path_len);
+            path[path_len] = '\0';
+            memcpy(stable_id, data + offset + path_len + 1, stable_len);
+            stable_id[stable_len] = '\0';
+            ok = add_device(segment, path, stable_id);
+            offset += path_len + 1 + stable_len;
+        } else {
+            offset = start;
+            break;
+        }
+
+        if (ok) segment->index_size = (long)offset;
+    }
+
+    segment->index_torn = (size_t)segment->index_size < size;
+    free(data);
+    return ok;
+}
+
+static bool load_segment(const char* dir, ULONG64 start, Segment* segment) {
+    memset(segment, 0, sizeof(Segment));
+    segment->start = start;
+    segment->log_path = segment_file_path(dir, start, "log");
+    segment->index_path = segment_file_path(dir, start, "idx");
+    if (!segment->log_path || !segment->index_path || !load_index(segment)) {
+        free_segment(segment);
+        return false;
+    }
+
+    FILE* file = NULL;
+    if (fopen_s(&file, segment->log_path, "rb") != 0 || !file) {
+        free_segment(segment);
+        return false;
+    }
+
+    BYTE header[HISTORY_LOG_HEADER_SIZE];
+    bool valid = fread(header, 1, sizeof(header), file) == sizeof(header) &&
+                 memcmp(header, HISTORY_LOG_MAGIC, HISTORY_MAGIC_SIZE) == 0 &&
+                 read_u32(header + 8) == HISTORY_VERSION &&
+                 read_u32(header + 12) == HISTORY_RECORD_SIZE;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fclose(file);
+
+    if (!valid) {
+        free_segment(segment);
+        return false;
+    }
+    segment->count = (DWORD)((size - HISTORY_LOG_HEADER_SIZE) / HISTORY_RECORD_SIZE);
+
+    // Marks written ahead of records that never made it to the log
+    while (segment->mark_count > 0 && segment->marks[segment->mark_count - 1].record >= segment->count) {
+        segment->mark_count--;
+        segment->index_torn = true;
+    }
+    return true;
+}
+
+static bool create_segment(const char* dir, ULONG64 start, Segment* segment) {
+    memset(segment, 0, sizeof(Segment));
+    segment->start = start;
+    segment->log_path = segment_file_path(dir, start, "log");
+    segment->index_path = segment_file_path(dir, start, "idx");
+    if (!segment->log_path || !segment->index_path) {
+        free_segment(segment);
+        return false;
+    }
+
+    HistoryBuffer log_header = { NULL, 0, 0, false };
+    put_bytes(&log_header, HISTORY_LOG_MAGIC, HISTORY_MAGIC_SIZE);
+    put_u32(&log_header, HISTORY_VERSION);
+    put_u32(&log_header, HISTORY_RECORD_SIZE);
+
+    HistoryBuffer index_header = { NULL, 0, 0, false };
+    put_index_header(&index_header);
+
+    bool success = !log_header.failed && !index_header.failed;
+    FILE* file = NULL;
+    if (success && fopen_s(&file, segment->index_path, "wb") == 0 && file) {
+        success = fwrite(index_header.data, 1, index_header.length, file) == index_header.length;
+        success = (fclose(file) == 0) && success;
+    } else {
+        success = false;
+    }
+    if (success && fopen_s(&file, segment->log_path, "wb") == 0 && file) {
+        success = fwrite(log_header.data, 1, log_header.length, file) == log_header.length;
+        success = (fclose(file) == 0) && success;
+    } else {
+        success = false;
+    }
+
+    segment->index_size = (long)index_header.length;
+    free(log_header.data);
+    free(index_header.data);
+    if (!success) {
+        free_segment(segment);
+    }
+    return success;
+}
+
+static bool write_at(const char* path, long offset, const HistoryBuffer* buffer) {
+    if (buffer->length == 0) return true;
+
+    FILE* file = NULL;
+    if (fopen_s(&file, path, "r+b") != 0 || !file) return false;
+
+    bool success = fseek(file, offset, SEEK_SET) == 0 &&
+                   fwrite(buffer->data, 1, buffer->length, file) == buffer->length;
+    return (fclose(file) == 0) && success;
+}
+
+// Replaces a damaged index with one rebuilt from memory, which already holds
+// the entries being appended
+static bool rewrite_index(Segment* segment) {
+    HistoryBuffer buffer = { NULL, 0, 0, false };
+    put_index_header(&buffer);
+    for (int i = 0; i < segment->device_count; i++) {
+        put_device_entry(&buffer, (WORD)i, segment->devices[i].device_path, segment->devices[i].stable_id);
+    }
+    for (int i = 0; i < segment->mark_count; i++) {
+        put_time_entry(&buffer, segment->marks[i].record, segment->marks[i].timestamp);
+    }
+
+    FILE* file = NULL;
+    bool success = !buffer.failed && fopen_s(&file, segment->index_path, "wb") == 0 && file;
+    if (success) {
+        success = fwrite(buffer.data, 1, buffer.length, file) == buffer.length;
+        success = (fclose(file) == 0) && success;
+    }
+    if (success) {
+        segment->index_size = (long)buffer.length;
+        segment->index_torn = false;
+    }
+    free(buffer.data);
+    return success;
+}
+
+// Index entries go first so a record never refers to a missing device
+static bool flush_segment(Segment* segment, DWORD first_record, HistoryBuffer* index, HistoryBuffer* log) {
+    if (segment->index_torn && !index->failed) {
+        index->length = 0;
+        index->failed = !rewrite_index(segment);
+    }
+
+    bool success = !index->failed && !log->failed &&
+                   write_at(segment->index_path, segment->index_size, index) &&
+                   write_at(segment->log_path, HISTORY_LOG_HEADER_SIZE + (long)first_record * HISTORY_RECORD_SIZE, log);
+    if (success) {
+        segment->index_size += (long)index->length;
+    }
+    index->length = 0;
+    log->length = 0;
+    return success;
+}
+
+static int find_device(const Segment* segment, const char* device_path, const char* stable_id) {
+    for (int i = 0; i < segment->device_count; i++) {
+        if (strcmp(segment->devices[i].device_path, device_path ? device_path : "") == 0 &&
+            strcmp(segment->devices[i].stable_id, stable_id ? stable_id : "") == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Appending
+bool history_append(const HistoryEntry* entries, int count) {
+    if (!entries || count <= 0) return true;
+
+    char* dir = get_history_dir();
+    if (!dir) return false;
+
+    // Resident hotkeys and one-shot commands may append at the same time
+    HANDLE lock = CreateMutexA(NULL, FALSE, "Local\\MOS-DEF-history");
+    if (lock && WaitForSingleObject(lock, HISTORY_LOCK_TIMEOUT_MS) == WAIT_TIMEOUT) {
+        log_verbose("History is locked by another process; not recorded");
+        CloseHandle(lock);
+        free(dir);
+        return false;
+    }
+
+    int segment_count = 0;
+    ULONG64* starts = list_segments(dir, &segment_count);
+    Segment segment;
+    bool open = segment_count > 0 && load_segment(dir, starts[segment_count - 1], &segment);
+    ULONG64 last_start = segment_count > 0 ? starts[segment_count - 1] : 0;
+    free(starts);
+
+    HistoryBuffer index = { NULL, 0, 0, false };
+    HistoryBuffer log = { NULL, 0, 0, false };
+    DWORD first_record = open ? segment.count : 0;
+    bool success = true;
+
+    for (int i = 0; i < count && success; i++) {
+        const HistoryEntry* entry = &entries[i];
+        ULONG64 timestamp = filetime_value(entry->timestamp);
+
+        // Start a new segment when the current one is full, damaged or missing
+        if (!open || segment.count >= HISTORY_SEGMENT_RECORDS || segment.device_count >= HISTORY_MAX_DEVICES) {
+            if (open) {
+                success = flush_segment(&segment, first_record, &index, &log);
+                free_segment(&segment);
+            }
+            ULONG64 start = (timestamp > last_start) ? timestamp : last_start + 1;
+            open = success && create_segment(dir, start, &segment);
+            success = open;
+            last_start = start;
+            first_record = 0;
+            if (!success) break;
+        }
+
+        int device = find_device(&segment, entry->device_path, entry->stable_id);
+        if (device < 0) {
+            device = segment.device_count;
+            success = add_device(&segment, entry->device_path, entry->stable_id);
+            put_device_entry(&index, (WORD)device, entry->device_path, entry->stable_id);
+        }
+
+        if (segment.count % HISTORY_INDEX_INTERVAL == 0) {
+            put_time_entry(&index, segment.count, timestamp);
+            add_mark(&segment, segment.count, timestamp);
+        }
+
+        put_record(&log, entry, (WORD)device);
+        segment.count++;
+    }
+
+    if (open) {
+        success = flush_segment(&segment, first_record, &index, &log) && success;
+        free_segment(&segment);
+    }
+    if (!success) {
+        log_verbose("Failed to append %d change(s) to history in %s", count, dir);
+    }
+
+    if (lock) {
+        ReleaseMutex(lock);
+        CloseHandle(lock);
+    }
+    free(index.data);
+    free(log.data);
+    free(dir);
+    return success;
+}
+
+// Queries
+static bool device_matches(const HistoryDevice* device, const char* filter) {
+    return _stricmp(device->device_path, filter) == 0 ||
+           (device->stable_id[0] && _stricmp(device->stable_id, filter) == 0);
+}
+
+// First record that can be at or after since, via the sidecar time marks
+static DWORD seek_record(const Segment* segment, ULONG64 since) {
+    int low = 0;
+    int high = segment->mark_count - 1;
+    DWORD record = 0;
+    while (low <= high) {
+        int mid = low + (high - low) / 2;
+        if (segment->marks[mid].timestamp <= since) {
+            record = segment->marks[mid].record;
+            low = mid + 1;
+        } else {
+            high = mid - 1;
+        }
+    }
+    return record;
+}
+
+#define HISTORY_READ_RECORDS 256
+
+// Returns false if the callback stopped the query
+static bool query_segment(const Segment* segment, const HistoryQuery* query, const bool* devices,
+                          HistoryCallback callback, void* user_data, int* matches) {
+    ULONG64 since = filetime_value(query->since);
+    DWORD record = since ? seek_record(segment, since) : 0;
+
+    FILE* file = NULL;
+    if (fopen_s(&file, segment->log_path, "rb") != 0 || !file) return true;
+    if (fseek(file, HISTORY_LOG_HEADER_SIZE + (long)record * HISTORY_RECORD_SIZE, SEEK_SET) != 0) {
+        fclose(file);
+        return true;
+    }
+
+    BYTE chunk[HISTORY_READ_RECORDS * HISTORY_RECORD_SIZE];
+    bool stopped = false;
+    while (!stopped && record < segment->count) {
+        DWORD wanted = segment->count - record;
+        if (wanted > HISTORY_READ_RECORDS) wanted = HISTORY_READ_RECORDS;
+        size_t read = fread(chunk, HISTORY_RECORD_SIZE, wanted, file);
+        if (read == 0) break;
+
+        for (size_t i = 0; i < read && !stopped; i++) {
+            HistoryEntry entry;
+            WORD device;
+            get_record(chunk + i * HISTORY_RECORD_SIZE, &entry, &device);
+            if (device >= segment->device_count || !devices[device] ||
+                filetime_value(entry.timestamp) < since) {
+                continue;
+            }
+
+            entry.device_path = segment->devices[device].device_path;
+            entry.stable_id = segment->devices[device].stable_id;
+            (*matches)++;
+            stopped = !callback(&entry, user_data);
+        }
+        record += (DWORD)read;
+    }
+
+    fclose(file);
+    return !stopped;
+}
+
+int history_query(const HistoryQuery* query, HistoryCallback callback, void* user_data) {
+    if (!query || !callback) return -1;
+
+    char* dir = get_history_dir();
+    if (!dir) return -1;
+
+    int segment_count = 0;
+    ULONG64* starts = list_segments(dir, &segment_count);
+    ULONG64 since = filetime_value(query->since);
+
+    // Segments starting before since hold nothing newer than the next segment's start
+    int first = 0;
+    for (int i = 0; i < segment_count; i++) {
+        if (starts[i] <= since) first = i;
+    }
+
+    int matches = 0;
+    for (int i = first; i < segment_count; i++) {
+        Segment segment;
+        if (!load_segment(dir, starts[i], &segment)) {
+            log_verbose("Skipping unreadable history segment %016llx", (unsigned long long)starts[i]);
+            continue;
+        }
+
+        bool* devices = (bool*)calloc(segment.device_count > 0 ? segment.device_count : 1, sizeof(bool));
+        bool any = false;
+        for (int d = 0; devices && d < segment.device_count; d++) {
+            devices[d] = !query->device || device_matches(&segment.devices[d], query->device);
+            any = any || devices[d];
+        }
+
+        bool more = !any || query_segment(&segment, query, devices, callback, user_data, &matches);
+        free(devices);
+        free_segment(&segment);
+        if (!more) break;
+    }
+
+    free(starts);
+    free(dir);
+    return matches;
+}
+
+// Recording helpers
+LONG64 history_begin(HistoryEntry* entry, HistoryAction action, const char* device_path, const char* stable_id) {
+    memset(entry, 0, sizeof(HistoryEntry));
+    GetSystemTimeAsFileTime(&entry->timestamp);
+    entry->action = action;
+    entry->device_path = device_path;
+    entry->stable_id = stable_id ? stable_id : "";
+    return event_timestamp_now();
+}
+
+void history_finish(HistoryEntry* entry, LONG64 started, LONG error_code) {
+    entry->error_code = error_code;
+    entry->latency_us = (DWORD)event_timestamp_elapsed_us(started, event_timestamp_now());
+}
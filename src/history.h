@@ -0,0 +1,66 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include <windows.h>
+#include <stdbool.h>
+
+// Change history: every display change issued by rotate.c and snapshot
+// restore, appended to %LOCALAPPDATA%\MOS-DEF\history\.
+//
+// The log is split into segments of HISTORY_SEGMENT_RECORDS fixed-size
+// records, named after the timestamp of their first record. Each segment has
+// a sidecar index holding its device table (records refer to devices by
+// index) and the timestamp of every HISTORY_INDEX_INTERVAL-th record. A time
+// query skips whole segments by name, then seeks inside the first one by
+// binary search over the sidecar; a device query skips segments whose device
+// table has no match. A torn record at the end of a segment is ignored and
+// overwritten by the next append.
+#define HISTORY_SEGMENT_RECORDS 65536
+#define HISTORY_INDEX_INTERVAL 256
+
+typedef enum {
+    HISTORY_ROTATE = 1,
+    HISTORY_ROLLBACK = 2,
+    HISTORY_RESTORE = 3
+} HistoryAction;
+
+typedef struct {
+    FILETIME timestamp;         // When the change was issued, UTC
+    HistoryAction action;
+    const char* device_path;
+    const char* stable_id;      // Empty if unknown
+    DWORD old_orientation;      // DMDO_*
+    DWORD new_orientation;
+    DWORD old_width;
+    DWORD old_height;
+    DWORD new_width;
+    DWORD new_height;
+    LONG error_code;            // DISP_CHANGE_SUCCESSFUL on success
+    DWORD latency_us;           // Time spent in ChangeDisplaySettingsExA
+} HistoryEntry;
+
+// Appends entries in one write per segment. Failures are logged verbosely and
+// never affect the change being recorded.
+bool history_append(const HistoryEntry* entries, int count);
+
+typedef struct {
+    FILETIME since;             // Zero for the whole history
+    const char* device;         // NULL for all; device path or stable ID, case-insensitive
+} HistoryQuery;
+
+// Return false to stop the query
+typedef bool (*HistoryCallback)(const HistoryEntry* entry, void* user_data);
+
+// Calls callback for matching entries, oldest first. Returns the number of
+// matches, or -1 if the history could not be read.
+int history_query(const HistoryQuery* query, HistoryCallback callback, void* user_data);
+
+// Recording a change: begin stamps the entry before the change is issued and
+// returns a start time for finish, which adds the result and latency. The
+// caller fills in the old/new state.
+LONG64 history_begin(HistoryEntry* entry, HistoryAction action, const char* device_path, const char* stable_id);
+void history_finish(HistoryEntry* entry, LONG64 started, LONG error_code);
+
+const char* get_history_action_name(HistoryAction action);
+
+#endif // HISTORY_H
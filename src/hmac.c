@@ -0,0 +1,169 @@
+// rand_s is declared only with _CRT_RAND_S, before any CRT header
+#define _CRT_RAND_S
+#include "hmac.h"
+#include <stdlib.h>
+#include <string.h>
+
+static const DWORD k_sha256_rounds[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static DWORD rotate_right(DWORD value, int bits) {
+    return (value >> bits) | (value << (32 - bits));
+}
+
+static void sha256_block(Sha256* sha, const BYTE* block) {
+    DWORD w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = ((DWORD)block[i * 4] << 24) | ((DWORD)block[i * 4 + 1] << 16) |
+               ((DWORD)block[i * 4 + 2] << 8) | (DWORD)block[i * 4 + 3];
+    }
+    for (int i = 16; i < 64; i++) {
+        DWORD s0 = rotate_right(w[i - 15], 7) ^ rotate_right(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        DWORD s1 = rotate_right(w[i - 2], 17) ^ rotate_right(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    DWORD a = sha->state[0], b = sha->state[1], c = sha->state[2], d = sha->state[3];
+    DWORD e = sha->state[4], f = sha->state[5], g = sha->state[6], h = sha->state[7];
+    for (int i = 0; i < 64; i++) {
+        DWORD s1 = rotate_right(e, 6) ^ rotate_right(e, 11) ^ rotate_right(e, 25);
+        DWORD choose = (e & f) ^ (~e & g);
+        DWORD t1 = h + s1 + choose + k_sha256_rounds[i] + w[i];
+        DWORD s0 = rotate_right(a, 2) ^ rotate_right(a, 13) ^ rotate_right(a, 22);
+        DWORD majority = (a & b) ^ (a & c) ^ (b & c);
+        DWORD t2 = s0 + majority;
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    sha->state[0] += a;
+    sha->state[1] += b;
+    sha->state[2] += c;
+    sha->state[3] += d;
+    sha->state[4] += e;
+    sha->state[5] += f;
+    sha->state[6] += g;
+    sha->state[7] += h;
+}
+
+void sha256_init(Sha256* sha) {
+    static const DWORD initial[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    memcpy(sha->state, initial, sizeof(initial));
+    sha->length = 0;
+    sha->used = 0;
+}
+
+void sha256_update(Sha256* sha, const void* data, size_t size) {
+    const BYTE* bytes = (const BYTE*)data;
+    sha->length += size;
+
+    if (sha->used > 0) {
+        size_t take = SHA256_BLOCK_SIZE - sha->used;
+        if (take > size) take = size;
+        memcpy(sha->block + sha->used, bytes, take);
+        sha->used += take;
+        bytes += take;
+        size -= take;
+        if (sha->used < SHA256_BLOCK_SIZE) return;
+        sha256_block(sha, sha->block);
+        sha->used = 0;
+    }
+
+    for (; size >= SHA256_BLOCK_SIZE; bytes += SHA256_BLOCK_SIZE, size -= SHA256_BLOCK_SIZE) {
+        sha256_block(sha, bytes);
+    }
+    memcpy(sha->block, bytes, size);
+    sha->used = size;
+}
+
+void sha256_final(Sha256* sha, BYTE digest[SHA256_SIZE]) {
+    ULONG64 bits = sha->length * 8;
+
+    sha->block[sha->used++] = 0x80;
+    if (sha->used > SHA256_BLOCK_SIZE - 8) {
+        memset(sha->block + sha->used, 0, SHA256_BLOCK_SIZE - sha->used);
+        sha256_block(sha, sha->block);
+        sha->used = 0;
+    }
+    memset(sha->block + sha->used, 0, SHA256_BLOCK_SIZE - 8 - sha->used);
+    for (int i = 0; i < 8; i++) {
+        sha->block[SHA256_BLOCK_SIZE - 1 - i] = (BYTE)(bits >> (i * 8));
+    }
+    sha256_block(sha, sha->block);
+
+    for (int i = 0; i < 8; i++) {
+        digest[i * 4] = (BYTE)(sha->state[i] >> 24);
+        digest[i * 4 + 1] = (BYTE)(sha->state[i] >> 16);
+        digest[i * 4 + 2] = (BYTE)(sha->state[i] >> 8);
+        digest[i * 4 + 3] = (BYTE)sha->state[i];
+    }
+}
+
+void hmac_sha256_init(HmacSha256* hmac, const BYTE* key, size_t key_size) {
+    BYTE block[SHA256_BLOCK_SIZE];
+    memset(block, 0, sizeof(block));
+
+    // Keys longer than a block are hashed first
+    if (key_size > SHA256_BLOCK_SIZE) {
+        Sha256 sha;
+        sha256_init(&sha);
+        sha256_update(&sha, key, key_size);
+        sha256_final(&sha, block);
+    } else if (key_size > 0) {
+        memcpy(block, key, key_size);
+    }
+
+    BYTE pad[SHA256_BLOCK_SIZE];
+    for (int i = 0; i < SHA256_BLOCK_SIZE; i++) pad[i] = block[i] ^ 0x36;
+    sha256_init(&hmac->inner);
+    sha256_update(&hmac->inner, pad, sizeof(pad));
+
+    for (int i = 0; i < SHA256_BLOCK_SIZE; i++) pad[i] = block[i] ^ 0x5c;
+    sha256_init(&hmac->outer);
+    sha256_update(&hmac->outer, pad, sizeof(pad));
+}
+
+void hmac_sha256_update(HmacSha256* hmac, const void* data, size_t size) {
+    sha256_update(&hmac->inner, data, size);
+}
+
+void hmac_sha256_final(HmacSha256* hmac, BYTE mac[SHA256_SIZE]) {
+    BYTE inner[SHA256_SIZE];
+    sha256_final(&hmac->inner, inner);
+    sha256_update(&hmac->outer, inner, sizeof(inner));
+    sha256_final(&hmac->outer, mac);
+}
+
+bool hmac_equal(const BYTE* a, const BYTE* b, size_t size) {
+    BYTE difference = 0;
+    for (size_t i = 0; i < size; i++) {
+        difference |= a[i] ^ b[i];
+    }
+    return difference == 0;
+}
+
+bool random_bytes(BYTE* buffer, size_t size) {
+    for (size_t i = 0; i < size; i += sizeof(unsigned int)) {
+        unsigned int value;
+        if (rand_s(&value) != 0) return false;
+        size_t take = size - i < sizeof(value) ? size - i : sizeof(value);
+        memcpy(buffer + i, &value, take);
+    }
+    return true;
+}
@@ -0,0 +1,40 @@
+#ifndef HMAC_H
+#define HMAC_H
+
+#include <windows.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// SHA-256 and HMAC-SHA256 (FIPS 180-4, RFC 2104), for authenticating fleet
+// frames. Messages are fed in parts, so a frame's header and payload need
+// not be contiguous.
+#define SHA256_SIZE 32
+#define SHA256_BLOCK_SIZE 64
+
+typedef struct {
+    DWORD state[8];
+    ULONG64 length;             // Bytes hashed so far
+    BYTE block[SHA256_BLOCK_SIZE];
+    size_t used;
+} Sha256;
+
+void sha256_init(Sha256* sha);
+void sha256_update(Sha256* sha, const void* data, size_t size);
+void sha256_final(Sha256* sha, BYTE digest[SHA256_SIZE]);
+
+typedef struct {
+    Sha256 inner;
+    Sha256 outer;
+} HmacSha256;
+
+void hmac_sha256_init(HmacSha256* hmac, const BYTE* key, size_t key_size);
+void hmac_sha256_update(HmacSha256* hmac, const void* data, size_t size);
+void hmac_sha256_final(HmacSha256* hmac, BYTE mac[SHA256_SIZE]);
+
+// Compares in time independent of where the inputs differ
+bool hmac_equal(const BYTE* a, const BYTE* b, size_t size);
+
+// Fills buffer from the system CSPRNG; false if it is unavailable
+bool random_bytes(BYTE* buffer, size_t size);
+
+#endif // HMAC_H
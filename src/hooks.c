@@ -0,0 +1,425 @@
+#include "hooks.h"
+#include "util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    char* name;                 // Config key, e.g. post-apply:retile
+    HookEvent event;
+    char* command;
+    DWORD timeout_ms;
+} HookDefinition;
+
+struct HookScope {
+    LogSink sink;
+    bool has_sink;
+    int pending;                // Queued and running hooks fired through it
+};
+
+// Everything a worker needs, copied at fire time so definitions can change
+// and the plan can be freed while the hook waits in the queue. The scope
+// outlives the job: closing it waits for its pending count to reach zero.
+typedef struct HookJob {
+    char* name;
+    char* command;
+    DWORD timeout_ms;
+    HookEvent event;
+    char* monitors;             // Comma-separated plan monitor IDs
+    int failures;               // -1 outside post-apply
+    HookScope* scope;
+    struct HookJob* next;
+} HookJob;
+
+// One lock covers definitions, the queue and the worker and scope counts
+static SRWLOCK g_hooks_lock = SRWLOCK_INIT;
+static CONDITION_VARIABLE g_hooks_wake = CONDITION_VARIABLE_INIT;
+static CONDITION_VARIABLE g_hooks_idle = CONDITION_VARIABLE_INIT;
+static HookDefinition* g_hooks = NULL;
+static int g_hook_count = 0;
+static HookJob* g_queue_head = NULL;
+static HookJob* g_queue_tail = NULL;
+static int g_queued = 0;
+static int g_workers = 0;
+static int g_idle_workers = 0;
+
+static const char* g_event_names[] = { "pre-apply", "post-apply", "rollback" };
+
+static void free_definitions(HookDefinition* hooks, int count) {
+    for (int i = 0; i < count; i++) {
+        free(hooks[i].name);
+        free(hooks[i].command);
+    }
+    free(hooks);
+}
+
+static void free_job(HookJob* job) {
+    if (!job) return;
+    free(job->name);
+    free(job->command);
+    free(job->monitors);
+    free(job);
+}
+
+static bool parse_event(const char* key, HookEvent* out_event) {
+    size_t length = strcspn(key, ":");
+    for (int i = 0; i < (int)(sizeof(g_event_names) / sizeof(g_event_names[0])); i++) {
+        if (strlen(g_event_names[i]) == length && strncmp(key, g_event_names[i], length) == 0) {
+            *out_event = (HookEvent)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// "timeout=2000 command" or just "command"
+static bool parse_hook_value(const char* value, DWORD* out_timeout_ms, const char** out_command) {
+    *out_timeout_ms = HOOK_DEFAULT_TIMEOUT_MS;
+    if (str_starts_with(value, "timeout=")) {
+        char* end = NULL;
+        unsigned long timeout = strtoul(value + 8, &end, 10);
+        if (end == value + 8 || *end != ' ' || timeout == 0) return false;
+        *out_timeout_ms = (DWORD)timeout;
+        value = end;
+    }
+
+    while (*value == ' ') {
+        value++;
+    }
+    *out_command = value;
+    return *value != '\0';
+}
+
+bool hooks_define(const ConfigMap* definitions) {
+    if (!definitions) return false;
+
+    int count = definitions->count;
+    HookDefinition* hooks = (HookDefinition*)calloc(count > 0 ? count : 1, sizeof(HookDefinition));
+    if (!hooks) return false;
+
+    bool valid = true;
+    int defined = 0;
+    for (int i = 0; i < count; i++) {
+        const ConfigEntry* entry = &definitions->entries[i];
+        HookDefinition* hook = &hooks[defined];
+        const char* command = NULL;
+
+        if (!parse_event(entry->key, &hook->event)) {
+            log_error("Unknown hook event %s (expected pre-apply, post-apply or rollback)", entry->key);
+            valid = false;
+            continue;
+        }
+        if (!parse_hook_value(entry->value, &hook->timeout_ms, &command)) {
+            log_error("Invalid hook %s: %s", entry->key, entry->value);
+            valid = false;
+            continue;
+        }
+
+        hook->name = _strdup(entry->key);
+        hook->command = _strdup(command);
+        if (!hook->name || !hook->command) {
+            free_definitions(hooks, defined + 1);
+            return false;
+        }
+        defined++;
+    }
+
+    AcquireSRWLockExclusive(&g_hooks_lock);
+    HookDefinition* previous = g_hooks;
+    int previous_count = g_hook_count;
+    g_hooks = hooks;
+    g_hook_count = defined;
+    ReleaseSRWLockExclusive(&g_hooks_lock);
+
+    free_definitions(previous, previous_count);
+    return valid;
+}
+
+// The inherited environment plus the event variables, as a CreateProcess block
+static char* build_environment(const HookJob* job) {
+    char failures[32] = "";
+    if (job->failures >= 0) {
+        sprintf_s(failures, sizeof(failures), "MOSDEF_FAILURES=%d", job->failures);
+    }
+
+    LPCH inherited = GetEnvironmentStringsA();
+    size_t inherited_length = 0;
+    if (inherited) {
+        while (inherited[inherited_length] || inherited[inherited_length + 1]) {
+            inherited_length++;
+        }
+        inherited_length += 1;  // Keep the last string's terminator
+    }
+
+    const char* event_name = g_event_names[job->event];
+    size_t length = inherited_length + strlen(event_name) + strlen(job->monitors) + strlen(failures) + 64;
+    char* block = (char*)malloc(length);
+    if (block) {
+        size_t pos = 0;
+        if (inherited_length > 0) {
+            memcpy(block, inherited, inherited_length);
+            pos = inherited_length;
+        }
+        pos += sprintf_s(block + pos, length - pos, "MOSDEF_EVENT=%s", event_name) + 1;
+        pos += sprintf_s(block + pos, length - pos, "MOSDEF_MONITORS=%s", job->monitors) + 1;
+        if (failures[0]) {
+            pos += sprintf_s(block + pos, length - pos, "%s", failures) + 1;
+        }
+        block[pos] = '\0';
+    }
+
+    if (inherited) {
+        FreeEnvironmentStringsA(inherited);
+    }
+    return block;
+}
+
+// Runs the hook in a job object, so a timeout also ends whatever the command
+// started. Processes it leaves behind after exiting normally keep running.
+static void run_hook(const HookJob* job) {
+    size_t command_length = strlen(job->command) + 32;
+    char* command_line = (char*)malloc(command_length);
+    char* environment = build_environment(job);
+    HANDLE job_object = CreateJobObjectA(NULL, NULL);
+    if (!command_line || !environment || !job_object) {
+        log_error("Failed to start hook %s: out of resources", job->name);
+        free(command_line);
+        free(environment);
+        if (job_object) CloseHandle(job_object);
+        return;
+    }
+#ifdef _WIN32
+    sprintf_s(command_line, command_length, "cmd.exe /d /s /c \"%s\"", job->command);
+#else
+    // CreateProcessA already runs its command line through /bin/sh -c
+    sprintf_s(command_line, command_length, "%s", job->command);
+#endif
+
+    STARTUPINFOA startup;
+    PROCESS_INFORMATION process;
+    memset(&startup, 0, sizeof(startup));
+    startup.cb = sizeof(startup);
+
+    ULONGLONG started = GetTickCount64();
+    if (!CreateProcessA(NULL, command_line, NULL, NULL, FALSE, CREATE_SUSPENDED | CREATE_NO_WINDOW,
+                        environment, NULL, &startup, &process)) {
+        log_error("Failed to start hook %s: error %lu", job->name, GetLastError());
+        free(command_line);
+        free(environment);
+        CloseHandle(job_object);
+        return;
+    }
+
+    // Without the job (e.g. a nested job forbids it) a timeout ends cmd.exe only
+    bool in_job = AssignProcessToJobObject(job_object, process.hProcess) != 0;
+    ResumeThread(process.hThread);
+    log_verbose("Hook %s started: %s", job->name, job->command);
+
+    DWORD wait = WaitForSingleObject(process.hProcess, job->timeout_ms);
+    ULONGLONG elapsed = GetTickCount64() - started;
+    if (wait == WAIT_TIMEOUT) {
+        if (in_job) {
+            TerminateJobObject(job_object, 1);
+        } else {
+            TerminateProcess(process.hProcess, 1);
+        }
+        WaitForSingleObject(process.hProcess, INFINITE);
+        log_error("Hook %s timed out after %lu ms and was terminated", job->name, job->timeout_ms);
+    } else {
+        DWORD exit_code = 1;
+        GetExitCodeProcess(process.hProcess, &exit_code);
+        if (exit_code == 0) {
+            log_verbose("Hook %s finished in %llu ms", job->name, elapsed);
+        } else {
+            log_error("Hook %s exited with code %lu after %llu ms", job->name, exit_code, elapsed);
+        }
+    }
+
+    CloseHandle(process.hThread);
+    CloseHandle(process.hProcess);
+    CloseHandle(job_object);
+    free(command_line);
+    free(environment);
+}
+
+static DWORD WINAPI hook_worker_main(LPVOID param) {
+    (void)param;
+
+    for (;;) {
+        AcquireSRWLockExclusive(&g_hooks_lock);
+        g_idle_workers++;
+        while (!g_queue_head) {
+            if (!SleepConditionVariableSRW(&g_hooks_wake, &g_hooks_lock, HOOK_WORKER_IDLE_MS, 0) && !g_queue_head) {
+                break;
+            }
+        }
+        g_idle_workers--;
+
+        // Idle workers retire; the next fire starts new ones
+        if (!g_queue_head) {
+            g_workers--;
+            ReleaseSRWLockExclusive(&g_hooks_lock);
+            return 0;
+        }
+
+        HookJob* job = g_queue_head;
+        g_queue_head = job->next;
+        if (!g_queue_head) {
+            g_queue_tail = NULL;
+        }
+        g_queued--;
+        ReleaseSRWLockExclusive(&g_hooks_lock);
+
+        HookScope* scope = job->scope;
+        const LogSink* previous = log_set_thread_sink(scope->has_sink ? &scope->sink : NULL);
+        run_hook(job);
+        log_set_thread_sink(previous);
+        free_job(job);
+
+        // The scope may be freed as soon as the lock is released
+        AcquireSRWLockExclusive(&g_hooks_lock);
+        if (--scope->pending == 0) {
+            WakeAllConditionVariable(&g_hooks_idle);
+        }
+        ReleaseSRWLockExclusive(&g_hooks_lock);
+    }
+}
+
+static char* join_plan_monitors(const RotationPlan* plan) {
+    size_t length = 1;
+    for (int i = 0; i < plan->count; i++) {
+        length += strlen(plan->entries[i].id) + 1;
+    }
+
+    char* monitors = (char*)malloc(length);
+    if (!monitors) return NULL;
+
+    size_t pos = 0;
+    monitors[0] = '\0';
+    for (int i = 0; i < plan->count; i++) {
+        pos += sprintf_s(monitors + pos, length - pos, "%s%s", i > 0 ? "," : "", plan->entries[i].id);
+    }
+    return monitors;
+}
+
+static HookJob* create_job(const HookDefinition* hook, const char* monitors, int failures, HookScope* scope) {
+    HookJob* job = (HookJob*)calloc(1, sizeof(HookJob));
+    if (!job) return NULL;
+
+    job->name = _strdup(hook->name);
+    job->command = _strdup(hook->command);
+    job->monitors = _strdup(monitors);
+    job->timeout_ms = hook->timeout_ms;
+    job->event = hook->event;
+    job->failures = failures;
+    job->scope = scope;
+
+    if (!job->name || !job->command || !job->monitors) {
+        free_job(job);
+        return NULL;
+    }
+    return job;
+}
+
+HookScope* hooks_scope_create(const LogSink* sink) {
+    HookScope* scope = (HookScope*)calloc(1, sizeof(HookScope));
+    if (scope && sink) {
+        scope->sink = *sink;
+        scope->has_sink = true;
+    }
+    return scope;
+}
+
+// Removes the scope's jobs from the queue; caller holds the lock
+static void discard_queued_jobs(HookScope* scope) {
+    HookJob** link = &g_queue_head;
+    g_queue_tail = NULL;
+    while (*link) {
+        HookJob* job = *link;
+        if (job->scope == scope) {
+            *link = job->next;
+            g_queued--;
+            scope->pending--;
+            free_job(job);
+        } else {
+            g_queue_tail = job;
+            link = &job->next;
+        }
+    }
+}
+
+void hooks_scope_close(HookScope* scope) {
+    if (!scope) return;
+
+    AcquireSRWLockExclusive(&g_hooks_lock);
+    while (scope->pending > 0) {
+        // Without workers its queued hooks would never run
+        if (g_workers == 0) {
+            discard_queued_jobs(scope);
+            break;
+        }
+        SleepConditionVariableSRW(&g_hooks_idle, &g_hooks_lock, INFINITE, 0);
+    }
+    ReleaseSRWLockExclusive(&g_hooks_lock);
+    free(scope);
+}
+
+void hooks_fire(HookScope* scope, HookEvent event, const RotationPlan* plan, const BatchRotationResult* result) {
+    if (!scope || !plan) return;
+
+    // Most configurations have no hooks for most events
+    AcquireSRWLockShared(&g_hooks_lock);
+    bool wanted = false;
+    for (int i = 0; i < g_hook_count && !wanted; i++) {
+        wanted = g_hooks[i].event == event;
+    }
+    ReleaseSRWLockShared(&g_hooks_lock);
+    if (!wanted) return;
+
+    char* monitors = join_plan_monitors(plan);
+    if (!monitors) return;
+    int failures = result ? result->failure_count : -1;
+
+    int dropped = 0;
+    AcquireSRWLockExclusive(&g_hooks_lock);
+    for (int i = 0; i < g_hook_count; i++) {
+        if (g_hooks[i].event != event) continue;
+
+        if (g_queued >= HOOK_QUEUE_CAPACITY) {
+            dropped++;
+            continue;
+        }
+        HookJob* job = create_job(&g_hooks[i], monitors, failures, scope);
+        if (!job) continue;
+
+        if (g_queue_tail) {
+            g_queue_tail->next = job;
+        } else {
+            g_queue_head = job;
+        }
+        g_queue_tail = job;
+        g_queued++;
+        scope->pending++;
+
+        // Grow the pool only while every worker is busy
+        if (g_idle_workers < g_queued && g_workers < HOOK_WORKER_COUNT) {
+            HANDLE thread = CreateThread(NULL, 0, hook_worker_main, NULL, 0, NULL);
+            if (thread) {
+                CloseHandle(thread);
+                g_workers++;
+            }
+        }
+    }
+    int workers = g_workers;
+    WakeAllConditionVariable(&g_hooks_wake);
+    ReleaseSRWLockExclusive(&g_hooks_lock);
+
+    if (workers == 0) {
+        log_error("Failed to start hook worker thread: error %lu", GetLastError());
+    }
+    if (dropped > 0) {
+        log_error("Hook queue full (%d pending); dropped %d %s hook(s)", HOOK_QUEUE_CAPACITY, dropped,
+                  g_event_names[event]);
+    }
+    free(monitors);
+}
@@ -0,0 +1,62 @@
+#ifndef HOOKS_H
+#define HOOKS_H
+
+#include <windows.h>
+#include <stdbool.h>
+#include "config.h"
+#include "rotate.h"
+
+// Commands from the "hooks" config object, run when a plan is applied or
+// rolled back. Keys name the event, optionally with a label so one event can
+// have several hooks; a value may start with a timeout in milliseconds:
+//
+//   "hooks": {
+//     "post-apply": "C:\\tools\\restart-player.cmd",
+//     "post-apply:retile": "timeout=2000 komorebic retile",
+//     "rollback": "notify-dashboard.cmd"
+//   }
+//
+// Hooks run through cmd.exe on Windows and /bin/sh elsewhere. Every hook is
+// only queued, on a pool of up to HOOK_WORKER_COUNT threads, so none delays
+// a modeset. Pre-apply hooks are queued before the modeset starts but not
+// waited for; they may still be running when it ends. A full queue drops
+// new hooks instead of waiting. A hook still running at its timeout is
+// terminated with its child processes. Each run's exit code and duration are
+// logged through the sink of the scope that fired it. Hooks see
+// MOSDEF_EVENT, MOSDEF_MONITORS (plan monitor IDs) and, after an apply,
+// MOSDEF_FAILURES in their environment.
+//
+// Definitions, the queue and the pool are process-wide, shared by every
+// context; scopes keep each context's hooks apart. Thread-safe.
+
+#define HOOK_WORKER_COUNT 4
+#define HOOK_QUEUE_CAPACITY 32
+#define HOOK_DEFAULT_TIMEOUT_MS 10000
+#define HOOK_WORKER_IDLE_MS 30000     // Idle workers exit after this long
+
+typedef enum {
+    HOOK_EVENT_PRE_APPLY,
+    HOOK_EVENT_POST_APPLY,
+    HOOK_EVENT_ROLLBACK
+} HookEvent;
+
+// Replaces the process-wide definitions. Invalid entries are logged and
+// skipped; returns false if any were.
+bool hooks_define(const ConfigMap* definitions);
+
+// The hooks one owner (a context) has fired. Its queued hooks log through
+// its sink, which must stay valid until the scope is closed.
+typedef struct HookScope HookScope;
+
+HookScope* hooks_scope_create(const LogSink* sink);
+
+// Waits until every hook fired through the scope has finished, so the owner
+// can go away without cutting them short, then frees it. Bounded by the
+// hooks' timeouts; hooks fired through other scopes are not waited for.
+void hooks_scope_close(HookScope* scope);
+
+// Queues the event's hooks and returns. result is NULL except for
+// post-apply.
+void hooks_fire(HookScope* scope, HookEvent event, const RotationPlan* plan, const BatchRotationResult* result);
+
+#endif // HOOKS_H
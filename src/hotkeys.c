@@ -0,0 +1,328 @@
+#include "hotkeys.h"
+#include "cli.h"
+#include "event_ring.h"
+#include "listener.h"
+#include "util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#define HOTKEY_EVENT_CAPACITY 64
+
+typedef struct {
+    const char* chord;          // Borrowed from the config
+    const char* action;
+    UINT modifiers;
+    UINT virtual_key;
+    bool registered;
+
+    RotationAction parsed;
+
+    // Pre-resolved plan, owned by the applier thread once it starts
+    RotationPlan* plan;
+
+    // Latency statistics, applier thread only
+    int presses;
+    double dispatch_us_total;
+    double dispatch_us_max;
+    double modeset_ms_total;
+} HotkeyBinding;
+
+typedef struct {
+    MosDefContext* ctx;
+    HotkeyBinding* bindings;
+    int count;
+    EventRing* ring;            // Listener thread produces, applier thread consumes
+} HotkeySession;
+
+// Key chord parsing
+static const struct {
+    const char* name;
+    UINT virtual_key;
+} g_key_names[] = {
+    { "Space", VK_SPACE },     { "Tab", VK_TAB },         { "Enter", VK_RETURN },
+    { "Escape", VK_ESCAPE },   { "Esc", VK_ESCAPE },      { "Backspace", VK_BACK },
+    { "Insert", VK_INSERT },   { "Delete", VK_DELETE },   { "Home", VK_HOME },
+    { "End", VK_END },         { "PageUp", VK_PRIOR },    { "PageDown", VK_NEXT },
+    { "Up", VK_UP },           { "Down", VK_DOWN },       { "Left", VK_LEFT },
+    { "Right", VK_RIGHT },     { "Pause", VK_PAUSE },     { "PrintScreen", VK_SNAPSHOT },
+};
+
+static bool parse_key_name(const char* name, UINT* virtual_key) {
+    size_t len = strlen(name);
+
+    // Letters and digits map to their upper-case ASCII code
+    if (len == 1 && isalnum((unsigned char)name[0])) {
+        *virtual_key = (UINT)toupper((unsigned char)name[0]);
+        return true;
+    }
+
+    // F1 - F24
+    if ((name[0] == 'F' || name[0] == 'f') && len >= 2 && len <= 3 &&
+        isdigit((unsigned char)name[1]) && (len == 2 || isdigit((unsigned char)name[2]))) {
+        int n = atoi(name + 1);
+        if (n >= 1 && n <= 24) {
+            *virtual_key = VK_F1 + (UINT)(n - 1);
+            return true;
+        }
+        return false;
+    }
+
+    for (size_t i = 0; i < sizeof(g_key_names) / sizeof(g_key_names[0]); i++) {
+        if (_stricmp(name, g_key_names[i].name) == 0) {
+            *virtual_key = g_key_names[i].virtual_key;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parse_hotkey_chord(const char* chord, UINT* modifiers, UINT* virtual_key) {
+    if (!chord || !modifiers || !virtual_key) return false;
+
+    char** parts = NULL;
+    int count = 0;
+    str_split(chord, "+", &parts, &count);
+    if (!parts || count == 0) {
+        free(parts); // An empty chord still gets an empty array
+        return false;
+    }
+
+    bool valid = true;
+    bool have_key = false;
+    *modifiers = 0;
+
+    for (int i = 0; i < count && valid; i++) {
+        char* part = str_trim(parts[i]);
+
+        if (_stricmp(part, "Ctrl") == 0 || _stricmp(part, "Control") == 0) {
+            *modifiers |= MOD_CONTROL;
+        } else if (_stricmp(part, "Alt") == 0) {
+            *modifiers |= MOD_ALT;
+        } else if (_stricmp(part, "Shift") == 0) {
+            *modifiers |= MOD_SHIFT;
+        } else if (_stricmp(part, "Win") == 0) {
+            *modifiers |= MOD_WIN;
+        } else if (!have_key && i == count - 1 && parse_key_name(part, virtual_key)) {
+            have_key = true;
+        } else {
+            valid = false;
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        free(parts[i]);
+    }
+    free(parts);
+
+    return valid && have_key;
+}
+
+// Binding setup
+static bool prepare_binding(HotkeyBinding* binding, const MosDefConfig* config) {
+    if (!parse_hotkey_chord(binding->chord, &binding->modifiers, &binding->virtual_key)) {
+        log_error("Invalid hotkey '%s'", binding->chord);
+        return false;
+    }
+
+    if (!parse_rotation_action(binding->action, config, &binding->parsed)) {
+        log_error("Hotkey '%s': action must be landscape, portrait or toggle with selectors: %s",
+                  binding->chord, binding->action);
+        return false;
+    }
+
+    return true;
+}
+
+static void free_binding(HotkeyBinding* binding, MosDefContext* ctx) {
+    mosdef_free_plan(ctx, binding->plan);
+    free_rotation_action(&binding->parsed);
+}
+
+// Resolves selectors against the current topology so a keypress goes straight
+// to the modeset. Toggle plans depend on the current orientation, so they are
+// rebuilt after every press and every topology change.
+static void replan_binding(HotkeySession* session, HotkeyBinding* binding) {
+    mosdef_free_plan(session->ctx, binding->plan);
+    binding->plan = NULL;
+
+    const RotationAction* parsed = &binding->parsed;
+    const SelectorList* include = parsed->include_selectors->count > 0 ? parsed->include_selectors : NULL;
+    MosDefStatus status = mosdef_plan(session->ctx, parsed->command, include,
+                                      parsed->args->exclude_selectors, &binding->plan);
+    if (status != MOSDEF_OK) {
+        log_verbose("Hotkey '%s': no plan (%s)", binding->chord, mosdef_status_string(status));
+    }
+}
+
+static void replan_all(HotkeySession* session) {
+    for (int i = 0; i < session->count; i++) {
+        if (session->bindings[i].registered) {
+            replan_binding(session, &session->bindings[i]);
+        }
+    }
+}
+
+// Applier thread
+static void fire_binding(HotkeySession* session, HotkeyBinding* binding, LONG64 intake) {
+    if (!binding->plan) {
+        log_error("Hotkey '%s': no monitors match '%s'", binding->chord, binding->action);
+        return;
+    }
+
+    // Keypress intake to the first ChangeDisplaySettingsExA call
+    LONG64 dispatch = event_timestamp_now();
+    BatchRotationResult result = { 0, 0, NULL, 0 };
+    mosdef_apply(session->ctx, binding->plan, &result);
+    LONG64 done = event_timestamp_now();
+
+    double dispatch_us = event_timestamp_elapsed_us(intake, dispatch);
+    double modeset_ms = event_timestamp_elapsed_us(dispatch, done) / 1000.0;
+
+    binding->presses++;
+    binding->dispatch_us_total += dispatch_us;
+    if (dispatch_us > binding->dispatch_us_max) {
+        binding->dispatch_us_max = dispatch_us;
+    }
+    binding->modeset_ms_total += modeset_ms;
+
+    log_info("%s -> %s: %d rotated, %d failed (dispatch %.0f us, modeset %.1f ms)",
+             binding->chord, get_rotation_command_name(binding->parsed.command),
+             result.success_count, result.failure_count, dispatch_us, modeset_ms);
+
+    mosdef_free_result(session->ctx, &result);
+    replan_binding(session, binding);
+}
+
+static DWORD WINAPI applier_thread(LPVOID param) {
+    HotkeySession* session = (HotkeySession*)param;
+    DisplayEvent events[16];
+
+    for (;;) {
+        event_ring_wait(session->ring, INFINITE);
+
+        int count;
+        while ((count = event_ring_drain(session->ring, events, 16)) > 0) {
+            bool topology_changed = false;
+
+            for (int i = 0; i < count; i++) {
+                switch (events[i].type) {
+                    case DISPLAY_EVENT_HOTKEY:
+                        if (events[i].param < (DWORD)session->count) {
+                            fire_binding(session, &session->bindings[events[i].param], events[i].timestamp);
+                        }
+                        break;
+                    case DISPLAY_EVENT_TOPOLOGY_CHANGED:
+                        topology_changed = true;
+                        break;
+                    case DISPLAY_EVENT_SHUTDOWN:
+                        return 0;
+                    default:
+                        break;
+                }
+            }
+
+            if (topology_changed) {
+                log_verbose("Display topology changed, re-resolving hotkey plans");
+                replan_all(session);
+            }
+        }
+    }
+}
+
+static void print_latency_summary(const HotkeySession* session) {
+    for (int i = 0; i < session->count; i++) {
+        const HotkeyBinding* binding = &session->bindings[i];
+        if (binding->presses == 0) continue;
+
+        log_info("%s: %d press(es), dispatch avg %.0f us / max %.0f us, modeset avg %.1f ms",
+                 binding->chord, binding->presses,
+                 binding->dispatch_us_total / binding->presses, binding->dispatch_us_max,
+                 binding->modeset_ms_total / binding->presses);
+    }
+
+    EventRingStats stats = event_ring_get_stats(session->ring);
+    log_verbose("Hotkey events: %lld queued, %lld dropped, backlog high water %lld",
+                stats.pushed, stats.dropped, stats.high_water);
+}
+
+int run_hotkeys(MosDefContext* ctx, const MosDefConfig* config) {
+    if (!config || config->hotkeys.count == 0) {
+        char* config_path = get_config_file_path();
+        log_error("No hotkeys configured. Add a \"hotkeys\" object to %s", config_path ? config_path : "config.json");
+        free(config_path);
+        return 2;
+    }
+
+    HotkeySession session;
+    session.ctx = ctx;
+    session.count = config->hotkeys.count;
+    session.bindings = (HotkeyBinding*)calloc(session.count, sizeof(HotkeyBinding));
+    session.ring = event_ring_create(HOTKEY_EVENT_CAPACITY);
+    if (!session.bindings || !session.ring) {
+        free(session.bindings);
+        event_ring_destroy(session.ring);
+        return 3;
+    }
+
+    DisplayListener* listener = display_listener_create(session.ring);
+    if (!listener) {
+        free(session.bindings);
+        event_ring_destroy(session.ring);
+        return 3;
+    }
+    HWND window = display_listener_window(listener);
+
+    // Register chords; binding i uses hotkey ID i + 1
+    int registered = 0;
+    for (int i = 0; i < session.count; i++) {
+        HotkeyBinding* binding = &session.bindings[i];
+        binding->chord = config->hotkeys.entries[i].key;
+        binding->action = config->hotkeys.entries[i].value;
+
+        if (!prepare_binding(binding, config)) continue;
+
+        if (!RegisterHotKey(window, i + 1, binding->modifiers | MOD_NOREPEAT, binding->virtual_key)) {
+            log_error("Failed to register hotkey '%s' (error %lu, already in use?)", binding->chord, GetLastError());
+            continue;
+        }
+
+        binding->registered = true;
+        registered++;
+        replan_binding(&session, binding);
+        log_info("Registered %s -> %s", binding->chord, binding->action);
+    }
+
+    int result = 0;
+    if (registered == 0) {
+        log_error("No hotkeys could be registered");
+        result = 3;
+    } else {
+        HANDLE applier = CreateThread(NULL, 0, applier_thread, &session, 0, NULL);
+        if (!applier) {
+            log_error("Failed to start hotkey applier thread (error %lu)", GetLastError());
+            result = 3;
+        } else {
+            log_info("Listening for %d hotkey(s). Press Ctrl+C to exit.", registered);
+            display_listener_run(listener);
+
+            WaitForSingleObject(applier, INFINITE);
+            CloseHandle(applier);
+
+            print_latency_summary(&session);
+        }
+    }
+
+    for (int i = 0; i < session.count; i++) {
+        if (session.bindings[i].registered) {
+            UnregisterHotKey(window, i + 1);
+        }
+        free_binding(&session.bindings[i], ctx);
+    }
+    display_listener_destroy(listener);
+
+    free(session.bindings);
+    event_ring_destroy(session.ring);
+    return result;
+}
@@ -0,0 +1,18 @@
+#ifndef HOTKEYS_H
+#define HOTKEYS_H
+
+#include <windows.h>
+#include <stdbool.h>
+#include "config.h"
+#include "mosdef.h"
+
+// Parses a key chord such as "Ctrl+Alt+P" or "Win+Shift+F9" into
+// RegisterHotKey modifiers and a virtual-key code.
+bool parse_hotkey_chord(const char* chord, UINT* modifiers, UINT* virtual_key);
+
+// Resident hotkey mode. Registers every binding in the config's "hotkeys"
+// map, pre-resolves a rotation plan for each, and applies the plan when the
+// chord is pressed. Blocks until Ctrl+C; returns a process exit code.
+int run_hotkeys(MosDefContext* ctx, const MosDefConfig* config);
+
+#endif // HOTKEYS_H
@@ -0,0 +1,193 @@
+#include "listener.h"
+#include "util.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define LISTENER_WINDOW_CLASS "MosDefListenerWindow"
+
+// WM_DEVICECHANGE / DBT_DEVNODES_CHANGED (dbt.h)
+#ifndef DBT_DEVNODES_CHANGED
+#define DBT_DEVNODES_CHANGED 0x0007
+#endif
+
+struct DisplayListener {
+    HWND window;
+    EventRing* ring;
+    bool forward_console_input;
+};
+
+// Console control handlers carry no context; one listener receives Ctrl+C
+static DisplayListener* volatile g_console_listener = NULL;
+
+static void push_event(DisplayListener* listener, DisplayEventType type, DWORD param) {
+    DisplayEvent event;
+    event.type = type;
+    event.param = param;
+    event.timestamp = event_timestamp_now();
+
+    if (!event_ring_push(listener->ring, &event)) {
+        log_verbose("Listener event queue full, dropping event %d", (int)type);
+    }
+}
+
+static LRESULT CALLBACK listener_window_proc(HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam) {
+    DisplayListener* listener = (DisplayListener*)GetWindowLongPtrA(hwnd, GWLP_USERDATA);
+
+    switch (message) {
+        case WM_CREATE: {
+            CREATESTRUCTA* create = (CREATESTRUCTA*)lparam;
+            SetWindowLongPtrA(hwnd, GWLP_USERDATA, (LONG_PTR)create->lpCreateParams);
+            return 0;
+        }
+        case WM_HOTKEY:
+            if (listener) push_event(listener, DISPLAY_EVENT_HOTKEY, (DWORD)wparam - 1);
+            return 0;
+        case WM_DISPLAYCHANGE:
+            if (listener) push_event(listener, DISPLAY_EVENT_TOPOLOGY_CHANGED, 0);
+            return 0;
+        case WM_DEVICECHANGE:
+            // Monitors plugged into an output that is not yet part of the desktop
+            if (listener && wparam == DBT_DEVNODES_CHANGED) {
+                push_event(listener, DISPLAY_EVENT_TOPOLOGY_CHANGED, 0);
+            }
+            return TRUE;
+        case WM_CLOSE:
+            // Owners unregister hotkeys before the window is destroyed
+            PostQuitMessage(0);
+            return 0;
+    }
+
+    return DefWindowProcA(hwnd, message, wparam, lparam);
+}
+
+static BOOL WINAPI console_ctrl_handler(DWORD ctrl_type) {
+    (void)ctrl_type;
+    DisplayListener* listener = g_console_listener;
+    if (listener) {
+        display_listener_stop(listener);
+        return TRUE;
+    }
+    return FALSE;
+}
+
+DisplayListener* display_listener_create(EventRing* ring) {
+    if (!ring) return NULL;
+
+    DisplayListener* listener = (DisplayListener*)malloc(sizeof(DisplayListener));
+    if (!listener) return NULL;
+
+    listener->ring = ring;
+    listener->forward_console_input = false;
+
+    WNDCLASSA window_class;
+    memset(&window_class, 0, sizeof(window_class));
+    window_class.lpfnWndProc = listener_window_proc;
+    window_class.hInstance = GetModuleHandleA(NULL);
+    window_class.lpszClassName = LISTENER_WINDOW_CLASS;
+
+    if (!RegisterClassA(&window_class) && GetLastError() != ERROR_CLASS_ALREADY_EXISTS) {
+        log_error("Failed to register listener window class (error %lu)", GetLastError());
+        free(listener);
+        return NULL;
+    }
+
+    // Hidden top-level window: message-only windows do not receive the
+    // WM_DISPLAYCHANGE broadcast
+    listener->window = CreateWindowExA(0, LISTENER_WINDOW_CLASS, "MOS-DEF Listener", 0, 0, 0, 0, 0,
+                                       NULL, NULL, window_class.hInstance, listener);
+    if (!listener->window) {
+        log_error("Failed to create listener window (error %lu)", GetLastError());
+        free(listener);
+        return NULL;
+    }
+
+    return listener;
+}
+
+void display_listener_destroy(DisplayListener* listener) {
+    if (!listener) return;
+
+    DestroyWindow(listener->window);
+    free(listener);
+}
+
+HWND display_listener_window(const DisplayListener* listener) {
+    return listener ? listener->window : NULL;
+}
+
+void display_listener_forward_console_input(DisplayListener* listener, bool enable) {
+    if (listener) {
+        listener->forward_console_input = enable;
+    }
+}
+
+static void forward_console_input(DisplayListener* listener, HANDLE input) {
+    INPUT_RECORD records[16];
+    DWORD count = 0;
+    if (!ReadConsoleInputA(input, records, 16, &count)) return;
+
+    for (DWORD i = 0; i < count; i++) {
+        if (records[i].EventType == KEY_EVENT && records[i].Event.KeyEvent.bKeyDown) {
+            push_event(listener, DISPLAY_EVENT_KEY, records[i].Event.KeyEvent.wVirtualKeyCode);
+        } else if (records[i].EventType == WINDOW_BUFFER_SIZE_EVENT) {
+            push_event(listener, DISPLAY_EVENT_RESIZE, 0);
+        }
+    }
+}
+
+void display_listener_run(DisplayListener* listener) {
+    if (!listener) return;
+
+    g_console_listener = listener;
+    SetConsoleCtrlHandler(console_ctrl_handler, TRUE);
+
+    // Raw console input: no line buffering or echo, Ctrl+C still handled
+    HANDLE input = NULL;
+    DWORD saved_mode = 0;
+    if (listener->forward_console_input) {
+        input = GetStdHandle(STD_INPUT_HANDLE);
+        if (input == INVALID_HANDLE_VALUE || !GetConsoleMode(input, &saved_mode)) {
+            input = NULL;
+        } else {
+            SetConsoleMode(input, ENABLE_WINDOW_INPUT | ENABLE_PROCESSED_INPUT);
+        }
+    }
+
+    bool running = true;
+    while (running) {
+        DWORD wait = MsgWaitForMultipleObjects(input ? 1 : 0, &input, FALSE, INFINITE, QS_ALLINPUT);
+        if (input && wait == WAIT_OBJECT_0) {
+            forward_console_input(listener, input);
+            continue;
+        }
+
+        MSG message;
+        while (PeekMessageA(&message, NULL, 0, 0, PM_REMOVE)) {
+            if (message.message == WM_QUIT) {
+                running = false;
+                break;
+            }
+            TranslateMessage(&message);
+            DispatchMessageA(&message);
+        }
+    }
+
+    if (input) {
+        SetConsoleMode(input, saved_mode);
+    }
+
+    SetConsoleCtrlHandler(console_ctrl_handler, FALSE);
+    g_console_listener = NULL;
+
+    // This thread is the only producer, so it also delivers the stop
+    DisplayEvent shutdown = { DISPLAY_EVENT_SHUTDOWN, 0, event_timestamp_now() };
+    while (!event_ring_push(listener->ring, &shutdown)) {
+        Sleep(1);
+    }
+}
+
+void display_listener_stop(DisplayListener* listener) {
+    if (listener) {
+        PostMessageA(listener->window, WM_CLOSE, 0, 0);
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef LISTENER_H
+#define LISTENER_H
+
+#include <windows.h>
+#include <stdbool.h>
+#include "event_ring.h"
+
+// OS notification listener. Owns a hidden top-level window on the creating
+// thread and turns WM_DISPLAYCHANGE, monitor device arrival/removal and
+// WM_HOTKEY into events on the ring. The creating thread is the ring's only
+// producer; nothing is polled, so an idle listener uses no CPU.
+typedef struct DisplayListener DisplayListener;
+
+DisplayListener* display_listener_create(EventRing* ring);
+void display_listener_destroy(DisplayListener* listener);
+
+// Window handle for RegisterHotKey. Hotkey ID n is delivered as
+// DISPLAY_EVENT_HOTKEY with param n - 1.
+HWND display_listener_window(const DisplayListener* listener);
+
+// Also forward console key presses (DISPLAY_EVENT_KEY) and window resizes
+// (DISPLAY_EVENT_RESIZE) while running. Call before display_listener_run.
+void display_listener_forward_console_input(DisplayListener* listener, bool enable);
+
+// Pumps messages on the creating thread until display_listener_stop or
+// Ctrl+C, then pushes DISPLAY_EVENT_SHUTDOWN.
+void display_listener_run(DisplayListener* listener);
+
+// Safe to call from any thread.
+void display_listener_stop(DisplayListener* listener);
+
+#endif // LISTENER_H
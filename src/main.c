@@ -0,0 +1,156 @@
+#include "cli.h"
+#include "complete.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Entry point: shell completion, argument parsing and command dispatch.
+// Command handlers live in cli.c so the tests can link them.
+
+static void stderr_log_write(LogLevel level, const char* message, void* user_data) {
+    (void)user_data;
+    const char* prefix = (level == LOG_LEVEL_ERROR) ? "ERROR: " :
+                         (level == LOG_LEVEL_VERBOSE) ? "VERBOSE: " : "";
+    fprintf(stderr, "%s%s\n", prefix, message);
+}
+
+int main(int argc, char* argv[]) {
+    // Shell completion answers before anything that could print or block
+    if (argc > 1 && strcmp(argv[1], "__complete") == 0) {
+        return run_complete(argc, argv);
+    }
+
+    // Parse command line arguments
+    CliArgs* args = parse_args(argc, argv);
+    if (!args) {
+        return EXIT_FAILURE;
+    }
+
+    g_verbose = args->verbose;
+
+    // Check for RDP session
+    if (is_rdp_session() && !args->force_rdp) {
+        log_error("MOS-DEF cannot run under RDP session. Use --force-rdp to override.");
+        free_cli_args(args);
+        return 2;
+    }
+
+    // Handle version
+    if (args->version) {
+        print_version();
+        free_cli_args(args);
+        return 0;
+    }
+
+    // Handle help
+    if (args->help || argc == 1 || !args->command) {
+        print_usage();
+        free_cli_args(args);
+        return 0;
+    }
+
+    // Handle config commands
+    if (args->save_default) {
+        int result = handle_save_default(args->save_default);
+        free_cli_args(args);
+        return result;
+    }
+
+    if (args->clear_default) {
+        int result = handle_clear_default();
+        free_cli_args(args);
+        return result;
+    }
+
+    // Machine-readable commands keep stdout for records; diagnostics go to stderr
+    LogSink stderr_sink = { stderr_log_write, NULL, args->verbose };
+    bool machine_output = args->command &&
+                          (strcmp(args->command, "watch") == 0 || strcmp(args->command, "diff") == 0 ||
+                           strcmp(args->command, "fleet") == 0);
+    if (machine_output) {
+        log_set_thread_sink(&stderr_sink);
+    }
+
+    // Offline topologies can be listed and planned against, never applied
+    if (args->topology_path) {
+        const char* offline_commands[] = { "list", "landscape", "portrait", "toggle", "plan", "apply", "diff", "agent" };
+        bool supported = false;
+        for (size_t c = 0; c < sizeof(offline_commands) / sizeof(offline_commands[0]); c++) {
+            supported = supported || strcmp(args->command, offline_commands[c]) == 0;
+        }
+        if (!supported) {
+            log_error("%s cannot be used with --topology", args->command);
+            free_cli_args(args);
+            return 2;
+        }
+        args->dry_run = true;
+    }
+
+    // Create library context
+    MosDefOptions options = { args->dry_run, args->verbose, args->apply_thread, args->apply_affinity };
+    MosDefContext* ctx = mosdef_create(&options, NULL, machine_output ? &stderr_sink : NULL);
+    if (!ctx) {
+        log_error("Failed to initialize MOS-DEF context");
+        free_cli_args(args);
+        return 3;
+    }
+
+    if (args->topology_path && mosdef_load_topology(ctx, args->topology_path) != MOSDEF_OK) {
+        mosdef_destroy(ctx);
+        free_cli_args(args);
+        return 2;
+    }
+
+    // Commands that resolve group: selectors or fire hooks read the config
+    // once and get it passed down. The rest, apply among them, never touch
+    // the config file.
+    const char* config_commands[] = { "landscape", "portrait", "toggle", "plan", "agent", "hotkeys" };
+    MosDefConfig* config = NULL;
+    for (size_t c = 0; c < sizeof(config_commands) / sizeof(config_commands[0]); c++) {
+        if (strcmp(args->command, config_commands[c]) == 0) {
+            config = load_config();
+            register_config_definitions(config);
+            break;
+        }
+    }
+
+    // Handle main commands
+    int result = 0;
+    if (strcmp(args->command, "list") == 0) {
+        result = handle_list_command(ctx, args);
+    } else if (strcmp(args->command, "landscape") == 0) {
+        result = handle_rotation_command(ctx, ROTATION_LANDSCAPE, args, config);
+    } else if (strcmp(args->command, "portrait") == 0) {
+        result = handle_rotation_command(ctx, ROTATION_PORTRAIT, args, config);
+    } else if (strcmp(args->command, "toggle") == 0) {
+        result = handle_rotation_command(ctx, ROTATION_TOGGLE, args, config);
+    } else if (strcmp(args->command, "plan") == 0) {
+        result = handle_plan_command(ctx, args, config);
+    } else if (strcmp(args->command, "apply") == 0) {
+        result = handle_apply_command(ctx, args);
+    } else if (strcmp(args->command, "snapshot") == 0) {
+        result = handle_snapshot_command(ctx, args);
+    } else if (strcmp(args->command, "diff") == 0) {
+        result = handle_diff_command(ctx, args);
+    } else if (strcmp(args->command, "history") == 0) {
+        result = handle_history_command(ctx, args);
+    } else if (strcmp(args->command, "agent") == 0) {
+        result = handle_agent_command(ctx, args, config);
+    } else if (strcmp(args->command, "fleet") == 0) {
+        result = handle_fleet_command(ctx, args);
+    } else if (strcmp(args->command, "hotkeys") == 0) {
+        result = handle_hotkeys_command(ctx, config);
+    } else if (strcmp(args->command, "watch") == 0) {
+        result = handle_watch_command(ctx);
+    } else if (strcmp(args->command, "top") == 0) {
+        result = handle_top_command(ctx);
+    } else {
+        log_error("Unknown command: %s", args->command);
+        result = 2;
+    }
+
+    mosdef_destroy(ctx);
+    free_config(config);
+    free_cli_args(args);
+    return result;
+}
@@ -0,0 +1,585 @@
+#include "modeldb.h"
+#include "util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#define MODEL_DB_MAGIC "MOSMODL"
+#define MODEL_DB_MAGIC_SIZE 8
+#define MODEL_DB_VERSION 1
+#define MODEL_DB_DIRECT 0x80000000u         // Displacement holds a slot
+#define MODEL_DB_BUCKET_SIZE 4              // Average keys per bucket
+#define MODEL_DB_MAX_DISPLACEMENT (1u << 20)
+#define MODEL_DB_MAX_SEEDS 16
+
+typedef struct {
+    char magic[MODEL_DB_MAGIC_SIZE];
+    DWORD version;
+    DWORD record_count;
+    DWORD bucket_count;
+    DWORD seed;
+} ModelDbHeader;
+
+struct ModelDb {
+    const BYTE* view;
+    DWORD record_count;
+    DWORD bucket_count;
+    DWORD seed;
+    const DWORD* displacements;
+    const ModelRecord* records;
+};
+
+static const struct {
+    const char* name;
+    BYTE orientation;
+} g_orientations[] = {
+    { "landscape", DMDO_DEFAULT },
+    { "portrait", DMDO_90 },
+    { "landscape-flipped", DMDO_180 },
+    { "portrait-flipped", DMDO_270 },
+    { "-", MODEL_ORIENTATION_NONE }
+};
+
+static const struct {
+    const char* name;
+    WORD flag;
+} g_flags[] = {
+    { "slow-modeset", MODEL_FLAG_SLOW_MODESET },
+    { "refresh-reset", MODEL_FLAG_REFRESH_RESET },
+    { "no-rotate", MODEL_FLAG_NO_ROTATE }
+};
+
+// Keys. Five bits per PNP letter above the product code.
+DWORD model_db_key(const char* manufacturer, WORD product_code) {
+    if (!manufacturer) return 0;
+
+    DWORD key = 0;
+    for (int i = 0; i < 3; i++) {
+        char c = (char)toupper((unsigned char)manufacturer[i]);
+        if (c < 'A' || c > 'Z') return 0;
+        key = (key << 5) | (DWORD)(c - 'A' + 1);
+    }
+    if (manufacturer[3] != '\0') return 0;
+    return (key << 16) | product_code;
+}
+
+static void format_model_key(DWORD key, char* buffer, size_t buffer_size) {
+    sprintf_s(buffer, buffer_size, "%c%c%c%04X", 'A' - 1 + (int)((key >> 26) & 31),
+              'A' - 1 + (int)((key >> 21) & 31), 'A' - 1 + (int)((key >> 16) & 31), (unsigned)(key & 0xFFFF));
+}
+
+// Hashing. The seed and key go through a 64-bit finalizer once for the
+// bucket and again for the slot function; fastrange maps to [0, n) without
+// a division.
+static ULONG64 mix64(ULONG64 x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+static DWORD fastrange(DWORD value, DWORD range) {
+    return (DWORD)(((ULONG64)value * range) >> 32);
+}
+
+typedef struct {
+    DWORD bucket;
+    DWORD f1;
+    DWORD f2;       // Odd, so each displacement gives a distinct f1 + d * f2
+} KeyHash;
+
+static KeyHash hash_key(DWORD key, DWORD seed, DWORD bucket_count) {
+    ULONG64 h = mix64(((ULONG64)seed << 32) | key);
+    ULONG64 g = mix64(h);
+    KeyHash hash;
+    hash.bucket = fastrange((DWORD)(h >> 32), bucket_count);
+    hash.f1 = (DWORD)g;
+    hash.f2 = (DWORD)(g >> 32) | 1;
+    return hash;
+}
+
+static DWORD displaced_slot(const KeyHash* hash, DWORD displacement, DWORD record_count) {
+    return fastrange(hash->f1 + displacement * hash->f2, record_count);
+}
+
+// Building (hash and displace). Keys are grouped by bucket and buckets are
+// placed largest first, each with the smallest displacement that sends all
+// of its keys to free slots. Lone keys go last, straight into the remaining
+// free slots, so the table is minimal without a long search for the final
+// few. A bucket with no displacement below the limit restarts with a new
+// seed.
+typedef struct {
+    DWORD record_count;
+    DWORD bucket_count;
+    KeyHash* hashes;        // Per record
+    DWORD* bucket_start;    // bucket_count + 1 offsets into members
+    DWORD* members;         // Record indices grouped by bucket
+    DWORD* order;           // Buckets, largest first
+    BYTE* taken;            // Per slot
+    DWORD* slots;           // Per record, the slot it was placed in
+    DWORD* displacements;
+} ModelDbBuilder;
+
+// Returns false on a duplicate key, which no seed can place
+static bool group_buckets(ModelDbBuilder* builder, const ModelRecord* records, DWORD seed) {
+    DWORD n = builder->record_count;
+    DWORD buckets = builder->bucket_count;
+
+    memset(builder->bucket_start, 0, (buckets + 1) * sizeof(DWORD));
+    for (DWORD i = 0; i < n; i++) {
+        builder->hashes[i] = hash_key(records[i].key, seed, buckets);
+        builder->bucket_start[builder->hashes[i].bucket + 1]++;
+    }
+
+    DWORD largest = 0;
+    for (DWORD b = 0; b < buckets; b++) {
+        DWORD size = builder->bucket_start[b + 1];
+        if (size > largest) largest = size;
+        builder->bucket_start[b + 1] += builder->bucket_start[b];
+    }
+
+    // Members by bucket, with the slot array as each bucket's fill cursor
+    DWORD* fill = builder->slots;
+    memcpy(fill, builder->bucket_start, buckets * sizeof(DWORD));
+    for (DWORD i = 0; i < n; i++) {
+        builder->members[fill[builder->hashes[i].bucket]++] = i;
+    }
+
+    for (DWORD b = 0; b < buckets; b++) {
+        const DWORD* member = builder->members + builder->bucket_start[b];
+        DWORD size = builder->bucket_start[b + 1] - builder->bucket_start[b];
+        for (DWORD i = 0; i < size; i++) {
+            for (DWORD j = i + 1; j < size; j++) {
+                if (records[member[i]].key == records[member[j]].key) {
+                    char name[16];
+                    format_model_key(records[member[i]].key, name, sizeof(name));
+                    log_error("Duplicate model %s", name);
+                    return false;
+                }
+            }
+        }
+    }
+
+    DWORD* size_start = (DWORD*)calloc((size_t)largest + 2, sizeof(DWORD));
+    if (!size_start) return false;
+    for (DWORD b = 0; b < buckets; b++) {
+        size_start[largest - (builder->bucket_start[b + 1] - builder->bucket_start[b]) + 1]++;
+    }
+    for (DWORD s = 0; s <= largest; s++) {
+        size_start[s + 1] += size_start[s];
+    }
+    for (DWORD b = 0; b < buckets; b++) {
+        builder->order[size_start[largest - (builder->bucket_start[b + 1] - builder->bucket_start[b])]++] = b;
+    }
+    free(size_start);
+    return true;
+}
+
+static bool place_buckets(ModelDbBuilder* builder) {
+    DWORD n = builder->record_count;
+    memset(builder->taken, 0, n);
+    memset(builder->displacements, 0, builder->bucket_count * sizeof(DWORD));
+
+    DWORD next_free = 0;
+    for (DWORD k = 0; k < builder->bucket_count; k++) {
+        DWORD b = builder->order[k];
+        const DWORD* member = builder->members + builder->bucket_start[b];
+        DWORD size = builder->bucket_start[b + 1] - builder->bucket_start[b];
+        if (size == 0) break;
+
+        if (size == 1) {
+            while (builder->taken[next_free]) next_free++;
+            builder->taken[next_free] = 1;
+            builder->slots[member[0]] = next_free;
+            builder->displacements[b] = MODEL_DB_DIRECT | next_free;
+            continue;
+        }
+
+        bool placed = false;
+        for (DWORD d = 0; d < MODEL_DB_MAX_DISPLACEMENT && !placed; d++) {
+            DWORD i = 0;
+            for (; i < size; i++) {
+                DWORD slot = displaced_slot(&builder->hashes[member[i]], d, n);
+                if (builder->taken[slot]) break;
+                builder->taken[slot] = 1;
+                builder->slots[member[i]] = slot;
+            }
+            if (i == size) {
+                builder->displacements[b] = d;
+                placed = true;
+            } else {
+                while (i-- > 0) builder->taken[builder->slots[member[i]]] = 0;
+            }
+        }
+        if (!placed) return false;
+    }
+    return true;
+}
+
+bool model_db_build(const ModelRecord* records, DWORD count, BYTE** out_image, size_t* out_size) {
+    if (!out_image || !out_size || (count > 0 && !records)) return false;
+    *out_image = NULL;
+    *out_size = 0;
+
+    if (count > MODEL_DB_MAX_RECORDS) {
+        log_error("Too many models (%lu, at most %d)", (unsigned long)count, MODEL_DB_MAX_RECORDS);
+        return false;
+    }
+    for (DWORD i = 0; i < count; i++) {
+        if (records[i].key == 0) {
+            log_error("Invalid model key in record %lu", (unsigned long)i);
+            return false;
+        }
+    }
+
+    ModelDbBuilder builder;
+    memset(&builder, 0, sizeof(builder));
+    builder.record_count = count;
+    builder.bucket_count = count / MODEL_DB_BUCKET_SIZE + 1;
+
+    size_t rows = count > 0 ? count : 1;
+    builder.hashes = (KeyHash*)malloc(rows * sizeof(KeyHash));
+    builder.bucket_start = (DWORD*)malloc((builder.bucket_count + 1) * sizeof(DWORD));
+    builder.members = (DWORD*)malloc(rows * sizeof(DWORD));
+    builder.order = (DWORD*)malloc(builder.bucket_count * sizeof(DWORD));
+    builder.taken = (BYTE*)malloc(rows);
+    builder.slots = (DWORD*)malloc((rows > builder.bucket_count ? rows : builder.bucket_count) * sizeof(DWORD));
+    builder.displacements = (DWORD*)malloc(builder.bucket_count * sizeof(DWORD));
+
+    size_t size = sizeof(ModelDbHeader) + builder.bucket_count * sizeof(DWORD) + (size_t)count * sizeof(ModelRecord);
+    BYTE* image = (BYTE*)malloc(size);
+
+    bool success = builder.hashes && builder.bucket_start && builder.members && builder.order &&
+                   builder.taken && builder.slots && builder.displacements && image;
+    bool built = false;
+    DWORD seed = 0;
+    for (DWORD attempt = 0; success && !built && attempt < MODEL_DB_MAX_SEEDS; attempt++) {
+        seed = (DWORD)mix64(HASH_SEED + attempt);
+        success = group_buckets(&builder, records, seed);
+        built = success && place_buckets(&builder);
+        if (success && !built) {
+            log_verbose("Model table seed %lu left a bucket unplaced, retrying", (unsigned long)attempt);
+        }
+    }
+
+    if (built) {
+        ModelDbHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, MODEL_DB_MAGIC, MODEL_DB_MAGIC_SIZE);
+        header.version = MODEL_DB_VERSION;
+        header.record_count = count;
+        header.bucket_count = builder.bucket_count;
+        header.seed = seed;
+        memcpy(image, &header, sizeof(header));
+        memcpy(image + sizeof(header), builder.displacements, builder.bucket_count * sizeof(DWORD));
+
+        ModelRecord* table = (ModelRecord*)(image + sizeof(header) + builder.bucket_count * sizeof(DWORD));
+        for (DWORD i = 0; i < count; i++) {
+            table[builder.slots[i]] = records[i];
+        }
+
+        *out_image = image;
+        *out_size = size;
+        image = NULL;
+    } else if (success) {
+        log_error("Could not build the model table after %d seeds", MODEL_DB_MAX_SEEDS);
+    }
+
+    free(builder.hashes);
+    free(builder.bucket_start);
+    free(builder.members);
+    free(builder.order);
+    free(builder.taken);
+    free(builder.slots);
+    free(builder.displacements);
+    free(image);
+    return built;
+}
+
+// Text source
+typedef struct {
+    DWORD key;
+    int line;
+} SourceKey;
+
+static int compare_source_keys(const void* a, const void* b) {
+    const SourceKey* left = (const SourceKey*)a;
+    const SourceKey* right = (const SourceKey*)b;
+    if (left->key != right->key) return left->key < right->key ? -1 : 1;
+    return left->line - right->line;
+}
+
+// "DEL4085": a three-letter PNP ID and a four-digit hex product code
+static bool parse_model_name(const char* text, DWORD* out_key) {
+    if (strlen(text) != 7) return false;
+    for (int i = 3; i < 7; i++) {
+        if (!isxdigit((unsigned char)text[i])) return false;
+    }
+
+    char manufacturer[4] = { text[0], text[1], text[2], '\0' };
+    *out_key = model_db_key(manufacturer, (WORD)strtoul(text + 3, NULL, 16));
+    return *out_key != 0;
+}
+
+static bool parse_model_line(char* line, const char* path, int line_number, ModelRecord* record) {
+    char* context = NULL;
+    char* name = strtok_s(line, " \t\r\n", &context);
+    char* orientation = strtok_s(NULL, " \t\r\n", &context);
+
+    memset(record, 0, sizeof(ModelRecord));
+    if (!parse_model_name(name, &record->key)) {
+        log_error("%s:%d: expected a model such as DEL4085, got '%s'", path, line_number, name);
+        return false;
+    }
+    if (!orientation) {
+        log_error("%s:%d: missing orientation for %s", path, line_number, name);
+        return false;
+    }
+
+    size_t i = 0;
+    for (; i < sizeof(g_orientations) / sizeof(g_orientations[0]); i++) {
+        if (_stricmp(orientation, g_orientations[i].name) == 0) break;
+    }
+    if (i == sizeof(g_orientations) / sizeof(g_orientations[0])) {
+        log_error("%s:%d: unknown orientation '%s' (landscape, portrait, landscape-flipped, portrait-flipped or -)",
+                  path, line_number, orientation);
+        return false;
+    }
+    record->preferred_orientation = g_orientations[i].orientation;
+
+    for (char* flag = strtok_s(NULL, " \t\r\n", &context); flag; flag = strtok_s(NULL, " \t\r\n", &context)) {
+        size_t f = 0;
+        for (; f < sizeof(g_flags) / sizeof(g_flags[0]); f++) {
+            if (_stricmp(flag, g_flags[f].name) == 0) break;
+        }
+        if (f == sizeof(g_flags) / sizeof(g_flags[0])) {
+            log_error("%s:%d: unknown flag '%s' (slow-modeset, refresh-reset or no-rotate)", path, line_number, flag);
+            return false;
+        }
+        record->flags |= g_flags[f].flag;
+    }
+    return true;
+}
+
+static bool write_image(const char* path, const BYTE* image, size_t size) {
+    size_t temp_len = strlen(path) + 32;
+    char* temp_path = (char*)malloc(temp_len);
+    if (!temp_path) return false;
+    sprintf_s(temp_path, temp_len, "%s.%lu.tmp", path, GetCurrentProcessId());
+
+    FILE* file = NULL;
+    bool success = fopen_s(&file, temp_path, "wb") == 0 && file;
+    if (success) {
+        success = fwrite(image, 1, size, file) == size;
+        success = (fclose(file) == 0) && success;
+    }
+    success = success && MoveFileExA(temp_path, path, MOVEFILE_REPLACE_EXISTING);
+    if (!success) DeleteFileA(temp_path);
+    free(temp_path);
+    return success;
+}
+
+bool model_db_compile_file(const char* source_path, const char* output_path) {
+    if (!source_path || !output_path) return false;
+
+    FILE* file = NULL;
+    if (fopen_s(&file, source_path, "r") != 0 || !file) {
+        log_error("Cannot open model list: %s", source_path);
+        return false;
+    }
+
+    ModelRecord* records = NULL;
+    SourceKey* keys = NULL;
+    DWORD count = 0;
+    DWORD capacity = 0;
+    bool ok = true;
+    char line[512];
+    int line_number = 0;
+    while (fgets(line, sizeof(line), file)) {
+        line_number++;
+        char* comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+        char* entry = str_trim(line);
+        if (!*entry) continue;
+
+        ModelRecord record;
+        if (!parse_model_line(entry, source_path, line_number, &record)) {
+            ok = false;
+            continue;
+        }
+
+        if (count == MODEL_DB_MAX_RECORDS) {
+            log_error("Too many models in %s (at most %d)", source_path, MODEL_DB_MAX_RECORDS);
+            ok = false;
+            break;
+        }
+        if (count == capacity) {
+            DWORD grown_capacity = capacity ? capacity * 2 : 1024;
+            ModelRecord* grown_records = (ModelRecord*)realloc(records, grown_capacity * sizeof(ModelRecord));
+            if (grown_records) records = grown_records;
+            SourceKey* grown_keys = (SourceKey*)realloc(keys, grown_capacity * sizeof(SourceKey));
+            if (grown_keys) keys = grown_keys;
+            if (!grown_records || !grown_keys) {
+                log_error("Out of memory reading %s", source_path);
+                ok = false;
+                break;
+            }
+            capacity = grown_capacity;
+        }
+        records[count] = record;
+        keys[count].key = record.key;
+        keys[count].line = line_number;
+        count++;
+    }
+    fclose(file);
+
+    // Report every duplicate with both lines before building
+    if (keys && count > 1) {
+        qsort(keys, count, sizeof(SourceKey), compare_source_keys);
+        for (DWORD i = 1; i < count; i++) {
+            if (keys[i].key != keys[i - 1].key) continue;
+            DWORD first = i - 1;
+            while (first > 0 && keys[first - 1].key == keys[i].key) first--;
+
+            char name[16];
+            format_model_key(keys[i].key, name, sizeof(name));
+            log_error("%s:%d: duplicate model %s (first on line %d)", source_path, keys[i].line, name,
+                      keys[first].line);
+            ok = false;
+        }
+    }
+    free(keys);
+
+    BYTE* image = NULL;
+    size_t size = 0;
+    ok = ok && model_db_build(records, count, &image, &size);
+    free(records);
+
+    if (ok && !write_image(output_path, image, size)) {
+        log_error("Failed to write model database: %s", output_path);
+        ok = false;
+    }
+    free(image);
+    return ok;
+}
+
+// Mapped files
+ModelDb* model_db_open(const char* path) {
+    if (!path) return NULL;
+
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        log_verbose("No model database at %s", path);
+        return NULL;
+    }
+
+    LARGE_INTEGER file_size;
+    file_size.QuadPart = 0;
+    HANDLE mapping = NULL;
+    const BYTE* view = NULL;
+    if (GetFileSizeEx(file, &file_size) && file_size.QuadPart >= (LONGLONG)sizeof(ModelDbHeader)) {
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    }
+    if (mapping) {
+        view = (const BYTE*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+    }
+    CloseHandle(file);     // The view keeps the file mapped
+
+    ModelDbHeader header;
+    memset(&header, 0, sizeof(header));
+    if (view) memcpy(&header, view, sizeof(header));
+    if (!view || memcmp(header.magic, MODEL_DB_MAGIC, MODEL_DB_MAGIC_SIZE) != 0 ||
+        header.version != MODEL_DB_VERSION || header.record_count > MODEL_DB_MAX_RECORDS ||
+        header.bucket_count == 0 || header.bucket_count > MODEL_DB_MAX_RECORDS ||
+        (ULONG64)file_size.QuadPart != sizeof(ModelDbHeader) + (ULONG64)header.bucket_count * sizeof(DWORD) +
+                                           (ULONG64)header.record_count * sizeof(ModelRecord)) {
+        log_error("Ignoring unrecognized model database: %s", path);
+        if (view) UnmapViewOfFile(view);
+        return NULL;
+    }
+
+    ModelDb* db = (ModelDb*)malloc(sizeof(ModelDb));
+    if (!db) {
+        UnmapViewOfFile(view);
+        return NULL;
+    }
+    db->view = view;
+    db->record_count = header.record_count;
+    db->bucket_count = header.bucket_count;
+    db->seed = header.seed;
+    db->displacements = (const DWORD*)(view + sizeof(ModelDbHeader));
+    db->records = (const ModelRecord*)(db->displacements + header.bucket_count);
+    return db;
+}
+
+void model_db_close(ModelDb* db) {
+    if (!db) return;
+    UnmapViewOfFile(db->view);
+    free(db);
+}
+
+DWORD model_db_count(const ModelDb* db) {
+    return db ? db->record_count : 0;
+}
+
+bool model_db_lookup(const ModelDb* db, const char* manufacturer, WORD product_code, ModelRecord* out_record) {
+    DWORD key = model_db_key(manufacturer, product_code);
+    if (!db || key == 0 || db->record_count == 0) return false;
+
+    KeyHash hash = hash_key(key, db->seed, db->bucket_count);
+    DWORD displacement = db->displacements[hash.bucket];
+    DWORD slot = (displacement & MODEL_DB_DIRECT) ? displacement & ~MODEL_DB_DIRECT
+                                                  : displaced_slot(&hash, displacement, db->record_count);
+
+    // Slots from the file are bounds-checked here rather than all at open
+    if (slot >= db->record_count || db->records[slot].key != key) return false;
+    if (out_record) *out_record = db->records[slot];
+    return true;
+}
+
+// Process-wide database
+static SRWLOCK g_default_db_lock = SRWLOCK_INIT;
+static ModelDb* g_default_db = NULL;
+static bool g_default_db_opened = false;
+
+static ModelDb* open_default_db() {
+    char* path = get_local_data_path(MODEL_DB_FILE);
+    ModelDb* db = path ? model_db_open(path) : NULL;
+    free(path);
+    if (db) return db;
+
+    char executable[MAX_PATH];
+    DWORD length = GetModuleFileNameA(NULL, executable, MAX_PATH);
+    if (length == 0 || length >= MAX_PATH) return NULL;
+
+    char* slash = strrchr(executable, '\\');
+    size_t directory_len = slash ? (size_t)(slash + 1 - executable) : 0;
+    if (directory_len + sizeof(MODEL_DB_FILE) > MAX_PATH) return NULL;
+    memcpy(executable + directory_len, MODEL_DB_FILE, sizeof(MODEL_DB_FILE));
+    return model_db_open(executable);
+}
+
+bool model_db_lookup_default(const char* manufacturer, WORD product_code, ModelRecord* out_record) {
+    AcquireSRWLockShared(&g_default_db_lock);
+    bool opened = g_default_db_opened;
+    bool found = opened && model_db_lookup(g_default_db, manufacturer, product_code, out_record);
+    ReleaseSRWLockShared(&g_default_db_lock);
+    if (opened) return found;
+
+    AcquireSRWLockExclusive(&g_default_db_lock);
+    if (!g_default_db_opened) {
+        g_default_db = open_default_db();
+        g_default_db_opened = true;
+        if (g_default_db) {
+            log_verbose("Loaded model database (%lu models)", (unsigned long)g_default_db->record_count);
+        }
+    }
+    found = model_db_lookup(g_default_db, manufacturer, product_code, out_record);
+    ReleaseSRWLockExclusive(&g_default_db_lock);
+    return found;
+}
@@ -0,0 +1,68 @@
+#ifndef MODELDB_H
+#define MODELDB_H
+
+#include <windows.h>
+#include <stdbool.h>
+
+// Monitor model database: per-model hints keyed by EDID manufacturer and
+// product code. The source is text, one model per line:
+//
+//   # Model   Orientation  Flags
+//   DEL4085   portrait     slow-modeset
+//   GSM5B7F   -            refresh-reset no-rotate
+//
+// Orientation is landscape, portrait, landscape-flipped, portrait-flipped or
+// "-" for no preference; flags are any of slow-modeset, refresh-reset and
+// no-rotate. mosdef-modeldb compiles it at build time into models.db, a
+// minimal perfect hash table (hash and displace) that is memory-mapped
+// rather than read, so opening costs the same for any size and a lookup is
+// one hash, one displacement and one record, then a key compare.
+//
+// File layout (little-endian):
+//   header        "MOSMODL\0", u32 version, u32 record count, u32 bucket count, u32 seed
+//   displacements u32 per bucket; with the high bit set, the low bits are the
+//                 slot of the bucket's only key
+//   records       ModelRecord per slot, record count slots
+
+#define MODEL_DB_FILE "models.db"
+#define MODEL_DB_MAX_RECORDS (16 * 1024 * 1024)
+
+#define MODEL_ORIENTATION_NONE 0xFF     // No preferred orientation
+
+// Model flags
+#define MODEL_FLAG_SLOW_MODESET  0x0001 // Modesets take seconds; expect a long blank
+#define MODEL_FLAG_REFRESH_RESET 0x0002 // Rotation resets the refresh rate to the default
+#define MODEL_FLAG_NO_ROTATE     0x0004 // Firmware rejects or mishandles rotated modes; left out of plans that rotate it
+
+typedef struct {
+    DWORD key;                      // model_db_key()
+    BYTE preferred_orientation;     // DMDO_*, or MODEL_ORIENTATION_NONE
+    BYTE reserved;
+    WORD flags;                     // MODEL_FLAG_*
+} ModelRecord;
+
+typedef struct ModelDb ModelDb;
+
+// Packs a PNP ID ("DEL") and product code; 0 if the PNP ID is not three letters
+DWORD model_db_key(const char* manufacturer, WORD product_code);
+
+// Builds a database image from records with distinct keys. The caller frees
+// *out_image.
+bool model_db_build(const ModelRecord* records, DWORD count, BYTE** out_image, size_t* out_size);
+
+// Compiles a text source into a database file (replaced atomically). Errors
+// are logged with their line numbers.
+bool model_db_compile_file(const char* source_path, const char* output_path);
+
+// Maps a compiled database read-only. NULL if missing or malformed.
+ModelDb* model_db_open(const char* path);
+void model_db_close(ModelDb* db);
+DWORD model_db_count(const ModelDb* db);
+bool model_db_lookup(const ModelDb* db, const char* manufacturer, WORD product_code, ModelRecord* out_record);
+
+// Lookup in the process-wide database: %LOCALAPPDATA%\MOS-DEF\models.db if
+// present, else models.db next to the executable. Opened on first use and
+// kept mapped for the life of the process. Thread-safe.
+bool model_db_lookup_default(const char* manufacturer, WORD product_code, ModelRecord* out_record);
+
+#endif // MODELDB_H
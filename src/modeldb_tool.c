@@ -0,0 +1,25 @@
+#include "modeldb.h"
+#include "util.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+// Build-time compiler for the monitor model database:
+//   mosdef-modeldb data\models.txt models.db
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        fprintf(stderr, "Usage: mosdef-modeldb <models.txt> <models.db>\n");
+        return EXIT_FAILURE;
+    }
+
+    if (!model_db_compile_file(argv[1], argv[2])) {
+        return EXIT_FAILURE;
+    }
+
+    ModelDb* db = model_db_open(argv[2]);
+    if (!db) {
+        return EXIT_FAILURE;
+    }
+    log_info("Compiled %lu models into %s", (unsigned long)model_db_count(db), argv[2]);
+    model_db_close(db);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,260 @@
+#include "montable.h"
+#include "util.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Atom columns, in the order the builder interns them
+#define ATOM_COLUMNS 5
+
+static MonitorAtom intern_atom(MonitorTable* table, size_t* used, const char* text) {
+    if (!text) text = "";
+    size_t length = strlen(text);
+    ULONG64 hash = hash_bytes(HASH_SEED, text, length);
+
+    DWORD slot = (DWORD)hash & table->atom_mask;
+    while (table->atom_slots[slot] != 0) {
+        MonitorAtom atom = table->atom_slots[slot] - 1;
+        if (strcmp(table->strings + atom, text) == 0) {
+            return atom;
+        }
+        slot = (slot + 1) & table->atom_mask;
+    }
+
+    MonitorAtom atom = (MonitorAtom)*used;
+    memcpy(table->strings + *used, text, length + 1);
+    *used += length + 1;
+    table->atom_slots[slot] = atom + 1;
+    return atom;
+}
+
+static DWORD monitor_flags(const MonitorInfo* monitor) {
+    DWORD flags = 0;
+    if (monitor->orientation == DMDO_90 || monitor->orientation == DMDO_270) flags |= MONITOR_FLAG_PORTRAIT;
+    if (monitor->model_name && monitor->model_name[0]) flags |= MONITOR_FLAG_HAS_MODEL;
+    if (monitor->native_width && monitor->native_height) {
+        flags |= MONITOR_FLAG_HAS_NATIVE;
+        if ((monitor->width == monitor->native_width && monitor->height == monitor->native_height) ||
+            (monitor->width == monitor->native_height && monitor->height == monitor->native_width)) {
+            flags |= MONITOR_FLAG_NATIVE_MODE;
+        }
+    }
+    if (monitor->position_x == 0 && monitor->position_y == 0) flags |= MONITOR_FLAG_PRIMARY;
+    return flags;
+}
+
+MonitorTable* build_monitor_table(const MonitorList* monitors, const MosDefAllocator* allocator) {
+    if (!monitors) return NULL;
+
+    int count = monitors->count;
+    size_t rows = count > 0 ? (size_t)count : 1;
+    size_t strings_size = 1;
+    for (int i = 0; i < count; i++) {
+        const MonitorInfo* monitor = &monitors->monitors[i];
+        strings_size += (monitor->id ? strlen(monitor->id) : 0) + 1;
+        strings_size += (monitor->device_path ? strlen(monitor->device_path) : 0) + 1;
+        strings_size += (monitor->device_name ? strlen(monitor->device_name) : 0) + 1;
+        strings_size += (monitor->stable_id ? strlen(monitor->stable_id) : 0) + 1;
+        strings_size += (monitor->model_name ? strlen(monitor->model_name) : 0) + 1;
+    }
+
+    // Power of two with load factor <= 0.5 over the most atoms possible
+    int capacity = 4;
+    while (capacity < count * ATOM_COLUMNS * 2 + 2) {
+        capacity <<= 1;
+    }
+
+    // Columns share one block: eight 32-bit numeric columns, then the atoms
+    MonitorTable* table = (MonitorTable*)mem_alloc(allocator, sizeof(MonitorTable));
+    BYTE* columns = (BYTE*)mem_alloc(allocator, rows * (8 * sizeof(DWORD) + ATOM_COLUMNS * sizeof(MonitorAtom)));
+    char* strings = (char*)mem_alloc(allocator, strings_size);
+    MonitorAtom* slots = (MonitorAtom*)mem_alloc(allocator, capacity * sizeof(MonitorAtom));
+    if (!table || !columns || !strings || !slots) {
+        mem_free(allocator, table);
+        mem_free(allocator, columns);
+        mem_free(allocator, strings);
+        mem_free(allocator, slots);
+        return NULL;
+    }
+    memset(slots, 0, capacity * sizeof(MonitorAtom));
+
+    table->count = count;
+    table->width = (DWORD*)columns;
+    table->height = table->width + rows;
+    table->orientation = table->height + rows;
+    table->position_x = (LONG*)(table->orientation + rows);
+    table->position_y = table->position_x + rows;
+    table->native_width = (DWORD*)(table->position_y + rows);
+    table->native_height = table->native_width + rows;
+    table->flags = table->native_height + rows;
+    table->id = (MonitorAtom*)(table->flags + rows);
+    table->device_path = table->id + rows;
+    table->device_name = table->device_path + rows;
+    table->stable_id = table->device_name + rows;
+    table->model_name = table->stable_id + rows;
+    table->strings = strings;
+    table->atom_slots = slots;
+    table->atom_mask = capacity - 1;
+
+    // The empty string is always atom 0
+    size_t used = 0;
+    intern_atom(table, &used, "");
+
+    for (int i = 0; i < count; i++) {
+        const MonitorInfo* monitor = &monitors->monitors[i];
+        table->width[i] = monitor->width;
+        table->height[i] = monitor->height;
+        table->orientation[i] = monitor->orientation;
+        table->position_x[i] = monitor->position_x;
+        table->position_y[i] = monitor->position_y;
+        table->native_width[i] = monitor->native_width;
+        table->native_height[i] = monitor->native_height;
+        table->flags[i] = monitor_flags(monitor);
+
+        table->id[i] = intern_atom(table, &used, monitor->id);
+        table->device_path[i] = intern_atom(table, &used, monitor->device_path);
+        table->device_name[i] = intern_atom(table, &used, monitor->device_name);
+        table->stable_id[i] = intern_atom(table, &used, monitor->stable_id);
+        table->model_name[i] = intern_atom(table, &used, monitor->model_name);
+    }
+    table->strings_size = used;
+
+    return table;
+}
+
+void free_monitor_table(MonitorTable* table, const MosDefAllocator* allocator) {
+    if (!table) return;
+    mem_free(allocator, table->width);
+    mem_free(allocator, table->strings);
+    mem_free(allocator, table->atom_slots);
+    mem_free(allocator, table);
+}
+
+MonitorAtom monitor_table_find_atom(const MonitorTable* table, const char* text) {
+    if (!table || !text) return MONITOR_ATOM_NONE;
+
+    ULONG64 hash = hash_bytes(HASH_SEED, text, strlen(text));
+    DWORD slot = (DWORD)hash & table->atom_mask;
+    while (table->atom_slots[slot] != 0) {
+        MonitorAtom atom = table->atom_slots[slot] - 1;
+        if (strcmp(table->strings + atom, text) == 0) {
+            return atom;
+        }
+        slot = (slot + 1) & table->atom_mask;
+    }
+    return MONITOR_ATOM_NONE;
+}
+
+const char* monitor_table_string(const MonitorTable* table, MonitorAtom atom) {
+    if (!table || atom >= table->strings_size) return NULL;
+    return table->strings + atom;
+}
+
+// Filters. Each is one pass over dense columns that builds a bitset word at
+// a time without branching on the comparison, which compilers vectorize.
+#define SELECT_WHERE(count, bits, condition)                                   \
+    for (int base = 0; base < (count); base += 64) {                           \
+        int limit = ((count) - base < 64) ? (count) - base : 64;               \
+        ULONG64 word = 0;                                                      \
+        for (int bit = 0; bit < limit; bit++) {                                \
+            int i = base + bit;                                                \
+            word |= (ULONG64)((condition) ? 1 : 0) << bit;                     \
+        }                                                                      \
+        (bits)[base >> 6] |= word;                                             \
+    }
+
+void monitor_table_select_atom(const MonitorTable* table, const MonitorAtom* column, MonitorAtom atom,
+                               ULONG64* bits) {
+    if (!table || !column || !bits || atom == MONITOR_ATOM_NONE) return;
+    SELECT_WHERE(table->count, bits, column[i] == atom);
+}
+
+void monitor_table_select_orientation(const MonitorTable* table, DWORD orientation, ULONG64* bits) {
+    if (!table || !bits) return;
+    SELECT_WHERE(table->count, bits, table->orientation[i] == orientation);
+}
+
+void monitor_table_select_flags(const MonitorTable* table, DWORD flags, ULONG64* bits) {
+    if (!table || !bits) return;
+    SELECT_WHERE(table->count, bits, (table->flags[i] & flags) == flags);
+}
+
+void monitor_table_select_resolution(const MonitorTable* table, DWORD width, DWORD height, ULONG64* bits) {
+    if (!table || !bits) return;
+    SELECT_WHERE(table->count, bits, (table->width[i] == width) & (table->height[i] == height));
+}
+
+void monitor_table_select_native(const MonitorTable* table, DWORD width, DWORD height, ULONG64* bits) {
+    if (!table || !bits) return;
+    SELECT_WHERE(table->count, bits, (table->native_width[i] == width) & (table->native_height[i] == height));
+}
+
+// Sorting: keys are gathered from the columns once, then LSD radix sorted a
+// byte at a time. Each pass is stable, so equal keys keep enumeration order,
+// and passes over a byte every key shares are skipped.
+typedef struct {
+    ULONG64 key;
+    int index;
+} SortEntry;
+
+// Maps a signed coordinate onto an unsigned key with the same order
+static ULONG64 coordinate_key(LONG value) {
+    return (ULONG64)((DWORD)value ^ 0x80000000u);
+}
+
+bool monitor_table_sort(const MonitorTable* table, MonitorSortKey key, int* order) {
+    if (!table || !order) return false;
+    if (table->count == 0) return true;
+
+    int count = table->count;
+    SortEntry* entries = (SortEntry*)malloc(2 * (size_t)count * sizeof(SortEntry));
+    if (!entries) return false;
+
+    SortEntry* source = entries;
+    SortEntry* target = entries + count;
+    for (int i = 0; i < count; i++) {
+        source[i].index = i;
+        switch (key) {
+            case MONITOR_SORT_POSITION:
+                source[i].key = (coordinate_key(table->position_x[i]) << 32) | coordinate_key(table->position_y[i]);
+                break;
+            case MONITOR_SORT_RESOLUTION:
+                source[i].key = ~((ULONG64)table->width[i] * table->height[i]);
+                break;
+            case MONITOR_SORT_ORIENTATION:
+            default:
+                source[i].key = table->orientation[i];
+                break;
+        }
+    }
+
+    for (int shift = 0; shift < 64; shift += 8) {
+        int offsets[256] = { 0 };
+        for (int i = 0; i < count; i++) {
+            offsets[(source[i].key >> shift) & 0xFF]++;
+        }
+        if (offsets[(source[0].key >> shift) & 0xFF] == count) {
+            continue;
+        }
+
+        int total = 0;
+        for (int digit = 0; digit < 256; digit++) {
+            int digit_count = offsets[digit];
+            offsets[digit] = total;
+            total += digit_count;
+        }
+        for (int i = 0; i < count; i++) {
+            target[offsets[(source[i].key >> shift) & 0xFF]++] = source[i];
+        }
+
+        SortEntry* swap = source;
+        source = target;
+        target = swap;
+    }
+
+    for (int i = 0; i < count; i++) {
+        order[i] = source[i].index;
+    }
+
+    free(entries);
+    return true;
+}
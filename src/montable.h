@@ -0,0 +1,80 @@
+#ifndef MONTABLE_H
+#define MONTABLE_H
+
+#include <windows.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "enum.h"
+
+// Columnar copy of a MonitorList for scans over many monitors. Each numeric
+// field is a dense array indexed like monitors->monitors, so a filter on
+// orientation or resolution reads only those columns. Strings are interned
+// once into a single pool as 32-bit atoms: equal strings get equal atoms,
+// so comparing two monitors' fields, or a field against a string looked up
+// once, is an integer compare. The table is built alongside the monitor
+// index and read-only afterwards; MonitorInfo and its accessors are
+// unchanged and stay authoritative.
+
+typedef uint32_t MonitorAtom;           // Offset of the string in the pool
+#define MONITOR_ATOM_NONE 0xFFFFFFFFu    // Lookup of a string no monitor has
+
+// Per-monitor flags, derived once at build time
+#define MONITOR_FLAG_PORTRAIT    0x01   // Rotated 90 or 270 degrees
+#define MONITOR_FLAG_HAS_MODEL   0x02   // EDID reports a model name
+#define MONITOR_FLAG_HAS_NATIVE  0x04   // EDID reports a preferred timing
+#define MONITOR_FLAG_NATIVE_MODE 0x08   // Current mode is the native resolution
+#define MONITOR_FLAG_PRIMARY     0x10   // Desktop origin at (0, 0)
+
+typedef struct MonitorTable {
+    int count;
+
+    DWORD* width;
+    DWORD* height;
+    DWORD* orientation;     // DMDO_*, as in MonitorInfo
+    LONG* position_x;
+    LONG* position_y;
+    DWORD* native_width;
+    DWORD* native_height;
+    DWORD* flags;           // MONITOR_FLAG_*
+
+    MonitorAtom* id;
+    MonitorAtom* device_path;
+    MonitorAtom* device_name;
+    MonitorAtom* stable_id;
+    MonitorAtom* model_name;
+
+    // Interned strings, NUL-terminated and addressed by atom, with an
+    // open-addressing set over them for lookups
+    char* strings;
+    size_t strings_size;
+    MonitorAtom* atom_slots;    // Atom + 1, 0 = empty
+    int atom_mask;
+} MonitorTable;
+
+typedef enum {
+    MONITOR_SORT_POSITION,      // Left to right, then top to bottom
+    MONITOR_SORT_RESOLUTION,    // Largest pixel count first
+    MONITOR_SORT_ORIENTATION    // DMDO_* order
+} MonitorSortKey;
+
+MonitorTable* build_monitor_table(const MonitorList* monitors, const MosDefAllocator* allocator);
+void free_monitor_table(MonitorTable* table, const MosDefAllocator* allocator);
+
+// Atom of text (case-sensitive), MONITOR_ATOM_NONE if no monitor has it
+MonitorAtom monitor_table_find_atom(const MonitorTable* table, const char* text);
+const char* monitor_table_string(const MonitorTable* table, MonitorAtom atom);
+
+// Filters OR matching monitors into bits (MONITOR_BITSET_WORDS(count) words).
+// column is one of the table's atom columns.
+void monitor_table_select_atom(const MonitorTable* table, const MonitorAtom* column, MonitorAtom atom,
+                               ULONG64* bits);
+void monitor_table_select_orientation(const MonitorTable* table, DWORD orientation, ULONG64* bits);
+void monitor_table_select_flags(const MonitorTable* table, DWORD flags, ULONG64* bits);     // All of flags set
+void monitor_table_select_resolution(const MonitorTable* table, DWORD width, DWORD height, ULONG64* bits);
+void monitor_table_select_native(const MonitorTable* table, DWORD width, DWORD height, ULONG64* bits);
+
+// Fills order (count entries) with monitor indices sorted by key; ties keep
+// enumeration order. Returns false if scratch memory is unavailable.
+bool monitor_table_sort(const MonitorTable* table, MonitorSortKey key, int* order);
+
+#endif // MONTABLE_H
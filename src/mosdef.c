@@ -0,0 +1,668 @@
+#include "mosdef.h"
+#include "mosdef_internal.h"
+#include "util.h"
+#include "enum.h"
+#include "rotate.h"
+#include "diff.h"
+#include "planfile.h"
+#include "plancache.h"
+#include "topofile.h"
+#include "snapshots.h"
+#include "history.h"
+#include "hooks.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Default sink matches the CLI's historical stdout/stderr format
+static void default_log_write(LogLevel level, const char* message, void* user_data) {
+    (void)user_data;
+    switch (level) {
+        case LOG_LEVEL_ERROR:
+            fprintf(stderr, "ERROR: %s\n", message);
+            break;
+        case LOG_LEVEL_VERBOSE:
+            printf("VERBOSE: %s\n", message);
+            break;
+        default:
+            printf("%s\n", message);
+            break;
+    }
+}
+
+// Every entry point runs with the context locked and its sink installed
+static const LogSink* context_enter(MosDefContext* ctx) {
+    EnterCriticalSection(&ctx->lock);
+    return log_set_thread_sink(&ctx->log_sink);
+}
+
+static void context_leave(MosDefContext* ctx, const LogSink* previous_sink) {
+    log_set_thread_sink(previous_sink);
+    LeaveCriticalSection(&ctx->lock);
+}
+
+// Live enumeration, or a private copy of the loaded topology file
+static MonitorList* context_read_monitors(MosDefContext* ctx) {
+    if (ctx->offline_monitors) {
+        return clone_monitor_list(ctx->offline_monitors, NULL);
+    }
+    return enumerate_monitors();
+}
+
+static bool context_dry_run(const MosDefContext* ctx) {
+    return ctx->options.dry_run || ctx->offline_monitors != NULL;
+}
+
+// Modesets preempt the rest of the machine when the caller asked for it. The
+// thread is started on first use and reused until the context is destroyed;
+// if it cannot be started, the loop runs inline. Called with the context locked.
+static ApplyScheduling context_scheduling(MosDefContext* ctx) {
+    if (ctx->options.apply_thread && !ctx->apply_thread) {
+        ctx->apply_thread = apply_thread_create(THREAD_PRIORITY_TIME_CRITICAL, ctx->options.apply_affinity);
+    }
+    ApplyScheduling scheduling = { ctx->apply_thread };
+    return scheduling;
+}
+
+// Context lifetime
+MosDefContext* mosdef_create(const MosDefOptions* options,
+                             const MosDefAllocator* allocator,
+                             const LogSink* log_sink) {
+    MosDefContext* ctx = (MosDefContext*)mem_alloc(allocator, sizeof(MosDefContext));
+    if (!ctx) return NULL;
+
+    memset(ctx, 0, sizeof(MosDefContext));
+
+    if (options) {
+        ctx->options = *options;
+    }
+
+    if (allocator) {
+        ctx->allocator = *allocator;
+    }
+
+    if (log_sink && log_sink->write) {
+        ctx->log_sink = *log_sink;
+    } else {
+        ctx->log_sink.write = default_log_write;
+        ctx->log_sink.user_data = NULL;
+    }
+    ctx->log_sink.verbose = ctx->options.verbose;
+
+    ctx->topology = topology_store_create();
+    ctx->hooks = hooks_scope_create(&ctx->log_sink);
+    if (!ctx->topology || !ctx->hooks) {
+        topology_store_destroy(ctx->topology);
+        hooks_scope_close(ctx->hooks);
+        mem_free(allocator, ctx);
+        return NULL;
+    }
+
+    InitializeCriticalSection(&ctx->lock);
+    InitializeCriticalSection(&ctx->worker_lock);
+    ctx->refs = 1;
+    return ctx;
+}
+
+void mosdef_destroy(MosDefContext* ctx) {
+    if (!ctx) return;
+    if (async_worker_defer_destroy(ctx)) return;
+
+    async_worker_shutdown(ctx);
+    context_release(ctx);
+}
+
+static void context_free(MosDefContext* ctx) {
+    // Queued hooks log through this context's sink, so they finish first
+    hooks_scope_close(ctx->hooks);
+    apply_thread_destroy(ctx->apply_thread);
+    topology_store_destroy(ctx->topology);
+    free_monitor_list(ctx->offline_monitors);
+
+    MosDefAllocator allocator = ctx->allocator;
+    DeleteCriticalSection(&ctx->worker_lock);
+    DeleteCriticalSection(&ctx->lock);
+    mem_free(&allocator, ctx);
+}
+
+void context_release(MosDefContext* ctx) {
+    if (InterlockedDecrement(&ctx->refs) == 0) context_free(ctx);
+}
+
+const MosDefOptions* mosdef_get_options(const MosDefContext* ctx) {
+    return ctx ? &ctx->options : NULL;
+}
+
+// Selectors
+SelectorList* mosdef_parse_selectors(MosDefContext* ctx, const char* selector_list) {
+    if (!ctx || !selector_list) return NULL;
+
+    const LogSink* previous = context_enter(ctx);
+    SelectorList* selectors = parse_selector_list(selector_list);
+    context_leave(ctx, previous);
+    return selectors;
+}
+
+void mosdef_free_selectors(MosDefContext* ctx, SelectorList* selectors) {
+    (void)ctx;
+    free_selector_list(selectors);
+}
+
+// Enumeration
+MosDefStatus mosdef_enumerate(MosDefContext* ctx, MonitorList** out_monitors) {
+    if (!ctx || !out_monitors) return MOSDEF_ERR_INVALID_ARG;
+    return context_enumerate(ctx, out_monitors);
+}
+
+MosDefStatus context_enumerate(MosDefContext* ctx, MonitorList** out_monitors) {
+    *out_monitors = NULL;
+
+    const LogSink* previous = context_enter(ctx);
+
+    MosDefStatus status = MOSDEF_OK;
+    MonitorList* monitors = context_read_monitors(ctx);
+    if (!monitors) {
+        status = MOSDEF_ERR_API_FAILURE;
+    } else {
+        *out_monitors = clone_monitor_list(monitors, &ctx->allocator);
+        if (!*out_monitors) {
+            status = MOSDEF_ERR_NO_MEMORY;
+        }
+        free_monitor_list(monitors);
+    }
+
+    context_leave(ctx, previous);
+    return status;
+}
+
+void mosdef_free_monitor_list(MosDefContext* ctx, MonitorList* monitors) {
+    if (!ctx) return;
+    free_monitor_list_with(monitors, &ctx->allocator);
+}
+
+// Shared topology snapshots
+MosDefStatus mosdef_refresh_topology(MosDefContext* ctx) {
+    if (!ctx) return MOSDEF_ERR_INVALID_ARG;
+
+    const LogSink* previous = context_enter(ctx);
+    bool success = ctx->offline_monitors
+        ? topology_store_publish(ctx->topology, clone_monitor_list(ctx->offline_monitors, NULL))
+        : topology_store_refresh(ctx->topology);
+    context_leave(ctx, previous);
+
+    return success ? MOSDEF_OK : MOSDEF_ERR_API_FAILURE;
+}
+
+const TopologySnapshot* mosdef_pin_topology(MosDefContext* ctx) {
+    return ctx ? topology_store_pin(ctx->topology) : NULL;
+}
+
+void mosdef_release_topology(MosDefContext* ctx, const TopologySnapshot* snapshot) {
+    if (!ctx) return;
+    topology_store_release(ctx->topology, snapshot);
+}
+
+// Offline topology files
+MosDefStatus mosdef_load_topology(MosDefContext* ctx, const char* path) {
+    if (!ctx || !path) return MOSDEF_ERR_INVALID_ARG;
+
+    const LogSink* previous = context_enter(ctx);
+
+    MosDefStatus status = MOSDEF_OK;
+    MonitorList* monitors = load_topology_file(path);
+    if (!monitors) {
+        status = MOSDEF_ERR_INVALID_ARG;
+    } else {
+        free_monitor_list(ctx->offline_monitors);
+        ctx->offline_monitors = monitors;
+        log_verbose("Using offline topology %s (%d monitors)", path, monitors->count);
+    }
+
+    context_leave(ctx, previous);
+    return status;
+}
+
+MosDefStatus mosdef_export_topology(MosDefContext* ctx, const MonitorList* monitors, const char* path) {
+    if (!ctx || !monitors || !path) return MOSDEF_ERR_INVALID_ARG;
+
+    const LogSink* previous = context_enter(ctx);
+    bool success = save_topology_file(monitors, path);
+    context_leave(ctx, previous);
+
+    return success ? MOSDEF_OK : MOSDEF_ERR_API_FAILURE;
+}
+
+// Drift detection
+MosDefStatus mosdef_read_topology(MosDefContext* ctx, const char* path, MonitorList** out_monitors) {
+    if (!ctx || !path || !out_monitors) return MOSDEF_ERR_INVALID_ARG;
+
+    const LogSink* previous = context_enter(ctx);
+
+    MonitorList* loaded = load_topology_file(path);
+    *out_monitors = loaded ? clone_monitor_list(loaded, &ctx->allocator) : NULL;
+    MosDefStatus status = !loaded ? MOSDEF_ERR_INVALID_ARG : (*out_monitors ? MOSDEF_OK : MOSDEF_ERR_NO_MEMORY);
+    free_monitor_list(loaded);
+
+    context_leave(ctx, previous);
+    return status;
+}
+
+MosDefStatus mosdef_parse_topology(MosDefContext* ctx, const char* json, size_t length,
+                                   MonitorList** out_monitors) {
+    if (!ctx || !json || !out_monitors) return MOSDEF_ERR_INVALID_ARG;
+
+    const LogSink* previous = context_enter(ctx);
+
+    MonitorList* parsed = parse_topology_json(json, length);
+    *out_monitors = parsed ? clone_monitor_list(parsed, &ctx->allocator) : NULL;
+    MosDefStatus status = !parsed ? MOSDEF_ERR_INVALID_ARG : (*out_monitors ? MOSDEF_OK : MOSDEF_ERR_NO_MEMORY);
+    free_monitor_list(parsed);
+
+    context_leave(ctx, previous);
+    return status;
+}
+
+MosDefStatus mosdef_diff_topology(MosDefContext* ctx, const MonitorList* expected,
+                                  MonitorList** out_actual, TopologyDiff** out_diff) {
+    if (!ctx || !expected || !out_actual || !out_diff) return MOSDEF_ERR_INVALID_ARG;
+    *out_actual = NULL;
+    *out_diff = NULL;
+
+    MosDefStatus status = context_enumerate(ctx, out_actual);
+    if (status != MOSDEF_OK) return status;
+
+    const LogSink* previous = context_enter(ctx);
+    *out_diff = diff_topologies(expected, *out_actual);
+    context_leave(ctx, previous);
+
+    if (!*out_diff) {
+        mosdef_free_monitor_list(ctx, *out_actual);
+        *out_actual = NULL;
+        return MOSDEF_ERR_NO_MEMORY;
+    }
+    return MOSDEF_OK;
+}
+
+void mosdef_free_diff(MosDefContext* ctx, TopologyDiff* diff) {
+    if (!ctx) return;
+    free_topology_diff(diff);
+}
+
+// Planning
+MosDefStatus mosdef_plan(MosDefContext* ctx,
+                         RotationCommand command,
+                         const SelectorList* include_selectors,
+                         const SelectorList* exclude_selectors,
+                         RotationPlan** out_plan) {
+    if (!ctx || !out_plan) return MOSDEF_ERR_INVALID_ARG;
+    *out_plan = NULL;
+
+    const LogSink* previous = context_enter(ctx);
+
+    MosDefStatus status = MOSDEF_OK;
+    MonitorList* monitors = context_read_monitors(ctx);
+    if (!monitors || monitors->count == 0) {
+        log_error("No monitors found");
+        status = monitors ? MOSDEF_ERR_NO_MONITORS : MOSDEF_ERR_API_FAILURE;
+    } else {
+        RotationPlan* plan = build_rotation_plan(monitors, command, include_selectors,
+                                                 exclude_selectors, &ctx->allocator);
+        if (!plan) {
+            status = MOSDEF_ERR_NO_MEMORY;
+        } else if (plan->count == 0) {
+            free_rotation_plan(plan, &ctx->allocator);
+            status = MOSDEF_ERR_NO_MATCH;
+        } else {
+            *out_plan = plan;
+        }
+    }
+
+    free_monitor_list(monitors);
+    context_leave(ctx, previous);
+    return status;
+}
+
+void mosdef_free_plan(MosDefContext* ctx, RotationPlan* plan) {
+    if (!ctx) return;
+    free_rotation_plan(plan, &ctx->allocator);
+}
+
+// Plan files
+MosDefStatus mosdef_save_plan(MosDefContext* ctx, const RotationPlan* plan, const char* path) {
+    if (!ctx || !plan || !path) return MOSDEF_ERR_INVALID_ARG;
+
+    const LogSink* previous = context_enter(ctx);
+    bool success = save_plan_file(plan, path);
+    context_leave(ctx, previous);
+
+    return success ? MOSDEF_OK : MOSDEF_ERR_API_FAILURE;
+}
+
+MosDefStatus mosdef_load_plan(MosDefContext* ctx, const char* path, RotationPlan** out_plan) {
+    if (!ctx || !path || !out_plan) return MOSDEF_ERR_INVALID_ARG;
+
+    const LogSink* previous = context_enter(ctx);
+    *out_plan = load_plan_file(path, &ctx->allocator);
+    context_leave(ctx, previous);
+
+    return *out_plan ? MOSDEF_OK : MOSDEF_ERR_BAD_PLAN;
+}
+
+MosDefStatus mosdef_decode_plan(MosDefContext* ctx, const BYTE* data, size_t size, RotationPlan** out_plan) {
+    if (!ctx || !data || !out_plan) return MOSDEF_ERR_INVALID_ARG;
+
+    const LogSink* previous = context_enter(ctx);
+    *out_plan = decode_plan(data, size, "(memory)", &ctx->allocator);
+    context_leave(ctx, previous);
+
+    return *out_plan ? MOSDEF_OK : MOSDEF_ERR_BAD_PLAN;
+}
+
+MosDefStatus mosdef_verify_plan(MosDefContext* ctx, const RotationPlan* plan) {
+    if (!ctx || !plan) return MOSDEF_ERR_INVALID_ARG;
+
+    const LogSink* previous = context_enter(ctx);
+
+    MosDefStatus status = MOSDEF_OK;
+    MonitorList* monitors = context_read_monitors(ctx);
+    if (!monitors) {
+        status = MOSDEF_ERR_API_FAILURE;
+    } else {
+        ULONG64 current = topology_fingerprint(monitors);
+        if (current != plan->topology_fingerprint) {
+            log_verbose("Topology fingerprint %016llx does not match plan %016llx",
+                       (unsigned long long)current, (unsigned long long)plan->topology_fingerprint);
+            status = MOSDEF_ERR_STALE_PLAN;
+        }
+        free_monitor_list(monitors);
+    }
+
+    context_leave(ctx, previous);
+    return status;
+}
+
+// Plan cache
+MosDefStatus mosdef_lookup_cached_plan(MosDefContext* ctx, const char* key, RotationPlan** out_plan) {
+    if (!ctx || !key || !out_plan) return MOSDEF_ERR_INVALID_ARG;
+    *out_plan = NULL;
+
+    const LogSink* previous = context_enter(ctx);
+
+    MosDefStatus status = MOSDEF_ERR_NO_MATCH;
+    ULONG64 fingerprint = 0;
+    if (ctx->offline_monitors) {
+        fingerprint = display_fingerprint(ctx->offline_monitors);
+    } else if (!read_display_fingerprint(&fingerprint)) {
+        status = MOSDEF_ERR_API_FAILURE;
+    } else {
+        *out_plan = plan_cache_lookup(key, fingerprint, &ctx->allocator);
+        if (*out_plan) {
+            status = MOSDEF_OK;
+        }
+    }
+
+    context_leave(ctx, previous);
+    return status;
+}
+
+MosDefStatus mosdef_store_cached_plan(MosDefContext* ctx, const char* key, const RotationPlan* plan) {
+    if (!ctx || !key || !plan) return MOSDEF_ERR_INVALID_ARG;
+
+    const LogSink* previous = context_enter(ctx);
+    bool success = plan_cache_store(key, plan);
+    context_leave(ctx, previous);
+
+    return success ? MOSDEF_OK : MOSDEF_ERR_API_FAILURE;
+}
+
+// Snapshots and undo
+MosDefStatus mosdef_capture_setup(MosDefContext* ctx, DisplaySetup** out_setup) {
+    if (!ctx || !out_setup) return MOSDEF_ERR_INVALID_ARG;
+
+    const LogSink* previous = context_enter(ctx);
+
+    MonitorList* monitors = context_read_monitors(ctx);
+    *out_setup = monitors ? capture_display_setup(monitors, &ctx->allocator) : NULL;
+    MosDefStatus status = !monitors ? MOSDEF_ERR_API_FAILURE : (*out_setup ? MOSDEF_OK : MOSDEF_ERR_NO_MEMORY);
+    free_monitor_list(monitors);
+
+    context_leave(ctx, previous);
+    return status;
+}
+
+void mosdef_free_setup(MosDefContext* ctx, DisplaySetup* setup) {
+    if (!ctx) return;
+    free_display_setup(setup, &ctx->allocator);
+}
+
+MosDefStatus mosdef_journal_setup(MosDefContext* ctx, const DisplaySetup* setup) {
+    if (!ctx || !setup) return MOSDEF_ERR_INVALID_ARG;
+
+    const LogSink* previous = context_enter(ctx);
+    bool success = context_dry_run(ctx) || snapshot_store_save(NULL, setup);
+    context_leave(ctx, previous);
+
+    return success ? MOSDEF_OK : MOSDEF_ERR_API_FAILURE;
+}
+
+MosDefStatus mosdef_snapshot_save(MosDefContext* ctx, const char* name) {
+    if (!ctx || !name || !*name) return MOSDEF_ERR_INVALID_ARG;
+
+    const LogSink* previous = context_enter(ctx);
+
+    MosDefStatus status = MOSDEF_ERR_API_FAILURE;
+    MonitorList* monitors = context_read_monitors(ctx);
+    DisplaySetup* setup = monitors ? capture_display_setup(monitors, NULL) : NULL;
+    if (monitors && !setup) {
+        status = MOSDEF_ERR_NO_MEMORY;
+    } else if (setup && snapshot_store_save(name, setup)) {
+        status = MOSDEF_OK;
+    }
+    free_display_setup(setup, NULL);
+    free_monitor_list(monitors);
+
+    context_leave(ctx, previous);
+    return status;
+}
+
+// Restores target over the live topology. Journals the prior state first
+// when journal is set, so a failed restore can still be undone.
+static MosDefStatus context_restore(MosDefContext* ctx, const DisplaySetup* target,
+                                    bool journal, int* out_changed) {
+    MonitorList* monitors = context_read_monitors(ctx);
+    if (!monitors) return MOSDEF_ERR_API_FAILURE;
+
+    MosDefStatus status = MOSDEF_OK;
+    bool dry_run = context_dry_run(ctx);
+    int changed = 0;
+
+    // Count first, so an unchanged restore leaves no undo entry behind
+    restore_display_setup(monitors, target, true, &changed);
+    if (!dry_run && changed > 0) {
+        DisplaySetup* before = capture_display_setup(monitors, NULL);
+        if (journal && (!before || !snapshot_store_save(NULL, before))) {
+            log_error("Failed to journal the current display setup; not restoring");
+            status = MOSDEF_ERR_API_FAILURE;
+        } else if (!restore_display_setup(monitors, target, false, &changed)) {
+            status = MOSDEF_ERR_API_FAILURE;
+        }
+        free_display_setup(before, NULL);
+    }
+
+    if (out_changed) *out_changed = changed;
+    free_monitor_list(monitors);
+    return status;
+}
+
+MosDefStatus mosdef_snapshot_restore(MosDefContext* ctx, const char* name, int* out_changed) {
+    if (!ctx) return MOSDEF_ERR_INVALID_ARG;
+    if (out_changed) *out_changed = 0;
+
+    const LogSink* previous = context_enter(ctx);
+
+    MosDefStatus status = MOSDEF_ERR_NO_MATCH;
+    DisplaySetup* target = snapshot_store_find(name);
+    if (target) {
+        status = context_restore(ctx, target, true, out_changed);
+    }
+    free_display_setup(target, NULL);
+
+    context_leave(ctx, previous);
+    return status;
+}
+
+MosDefStatus mosdef_restore_layout(MosDefContext* ctx, const MonitorList* layout, int* out_changed) {
+    if (!ctx || !layout) return MOSDEF_ERR_INVALID_ARG;
+    if (out_changed) *out_changed = 0;
+
+    const LogSink* previous = context_enter(ctx);
+
+    MosDefStatus status = MOSDEF_ERR_NO_MEMORY;
+    DisplaySetup* target = capture_display_setup(layout, NULL);
+    if (target) {
+        status = context_restore(ctx, target, true, out_changed);
+    }
+    free_display_setup(target, NULL);
+
+    context_leave(ctx, previous);
+    return status;
+}
+
+MosDefStatus mosdef_snapshot_undo(MosDefContext* ctx, int depth, int* out_changed) {
+    if (!ctx || depth < 1) return MOSDEF_ERR_INVALID_ARG;
+    if (out_changed) *out_changed = 0;
+
+    const LogSink* previous = context_enter(ctx);
+
+    MosDefStatus status = MOSDEF_ERR_NO_MATCH;
+    int available = 0;
+    DisplaySetup* target = snapshot_store_undo_target(depth, &available);
+    if (!target) {
+        log_verbose("Undo depth %d requested, %d available", depth, available);
+    } else {
+        status = context_restore(ctx, target, false, out_changed);
+        if (status == MOSDEF_OK && !context_dry_run(ctx) && !snapshot_store_pop_undo(depth)) {
+            status = MOSDEF_ERR_API_FAILURE;
+        }
+    }
+    free_display_setup(target, NULL);
+
+    context_leave(ctx, previous);
+    return status;
+}
+
+MosDefStatus mosdef_snapshot_list(MosDefContext* ctx, SnapshotListing** out_listing) {
+    if (!ctx || !out_listing) return MOSDEF_ERR_INVALID_ARG;
+
+    const LogSink* previous = context_enter(ctx);
+    *out_listing = snapshot_store_list();
+    context_leave(ctx, previous);
+
+    return *out_listing ? MOSDEF_OK : MOSDEF_ERR_API_FAILURE;
+}
+
+void mosdef_free_snapshot_listing(MosDefContext* ctx, SnapshotListing* listing) {
+    if (!ctx) return;
+    free_snapshot_listing(listing);
+}
+
+// Change history
+MosDefStatus mosdef_history_query(MosDefContext* ctx, const HistoryQuery* query,
+                                  HistoryCallback callback, void* user_data, int* out_count) {
+    if (!ctx || !query || !callback) return MOSDEF_ERR_INVALID_ARG;
+
+    const LogSink* previous = context_enter(ctx);
+    int count = history_query(query, callback, user_data);
+    context_leave(ctx, previous);
+
+    if (out_count) *out_count = (count > 0) ? count : 0;
+    return (count >= 0) ? MOSDEF_OK : MOSDEF_ERR_API_FAILURE;
+}
+
+// Apply and rollback
+MosDefStatus mosdef_apply(MosDefContext* ctx, const RotationPlan* plan,
+                          BatchRotationResult* out_result) {
+    if (!ctx || !plan) return MOSDEF_ERR_INVALID_ARG;
+    return context_apply(ctx, plan, NULL, out_result);
+}
+
+MosDefStatus context_apply(MosDefContext* ctx, const RotationPlan* plan,
+                           volatile LONG* cancel_flag, BatchRotationResult* out_result) {
+    const LogSink* previous = context_enter(ctx);
+
+    // Hooks are only queued, so none of them delays the modeset
+    bool dry_run = context_dry_run(ctx);
+    if (!dry_run && plan->count > 0) {
+        hooks_fire(ctx->hooks, HOOK_EVENT_PRE_APPLY, plan, NULL);
+    }
+
+    ApplyOptions apply_options = { dry_run, &ctx->allocator, cancel_flag, context_scheduling(ctx) };
+    BatchRotationResult result = apply_rotation_plan(plan, &apply_options);
+    if (!dry_run && plan->count > 0 && result.results) {
+        hooks_fire(ctx->hooks, HOOK_EVENT_POST_APPLY, plan, &result);
+    }
+
+    MosDefStatus status = MOSDEF_OK;
+    if (plan->count > 0 && !result.results) {
+        status = MOSDEF_ERR_NO_MEMORY;
+    } else if (result.failure_count > 0) {
+        status = MOSDEF_ERR_API_FAILURE;
+    } else if (result.cancelled_count > 0) {
+        status = MOSDEF_ERR_CANCELLED;
+    }
+
+    if (out_result) {
+        *out_result = result;
+    } else {
+        mem_free(&ctx->allocator, result.results);
+    }
+
+    context_leave(ctx, previous);
+    return status;
+}
+
+MosDefStatus mosdef_rollback(MosDefContext* ctx, const RotationPlan* plan) {
+    if (!ctx || !plan) return MOSDEF_ERR_INVALID_ARG;
+    return context_rollback(ctx, plan, NULL);
+}
+
+MosDefStatus context_rollback(MosDefContext* ctx, const RotationPlan* plan,
+                              volatile LONG* cancel_flag) {
+    const LogSink* previous = context_enter(ctx);
+
+    bool dry_run = context_dry_run(ctx);
+    ApplyOptions apply_options = { dry_run, &ctx->allocator, cancel_flag, context_scheduling(ctx) };
+    bool success = rollback_rotation_plan(plan, &apply_options);
+    if (!dry_run && plan->count > 0) {
+        hooks_fire(ctx->hooks, HOOK_EVENT_ROLLBACK, plan, NULL);
+    }
+
+    context_leave(ctx, previous);
+
+    if (!success && cancel_flag && ReadAcquire(cancel_flag)) {
+        return MOSDEF_ERR_CANCELLED;
+    }
+    return success ? MOSDEF_OK : MOSDEF_ERR_API_FAILURE;
+}
+
+void mosdef_free_result(MosDefContext* ctx, BatchRotationResult* result) {
+    if (!ctx || !result) return;
+    mem_free(&ctx->allocator, result->results);
+    result->results = NULL;
+}
+
+// Diagnostics
+const char* mosdef_status_string(MosDefStatus status) {
+    switch (status) {
+        case MOSDEF_OK:               return "success";
+        case MOSDEF_ERR_INVALID_ARG:  return "invalid argument";
+        case MOSDEF_ERR_NO_MEMORY:    return "out of memory";
+        case MOSDEF_ERR_NO_MONITORS:  return "no monitors found";
+        case MOSDEF_ERR_NO_MATCH:     return "no monitors match the specified selectors";
+        case MOSDEF_ERR_API_FAILURE:  return "display API failure";
+        case MOSDEF_ERR_CANCELLED:    return "operation cancelled";
+        case MOSDEF_ERR_BAD_PLAN:     return "invalid plan file";
+        case MOSDEF_ERR_STALE_PLAN:   return "topology changed since the plan was created";
+        default:                      return "unknown status";
+    }
+}
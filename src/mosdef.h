@@ -0,0 +1,211 @@
+#ifndef MOSDEF_H
+#define MOSDEF_H
+
+#include "util.h"
+#include "enum.h"
+#include "rotate.h"
+#include "topology.h"
+#include "diff.h"
+#include "snapshots.h"
+#include "history.h"
+
+// Symbol visibility for the shared library build
+#if defined(MOSDEF_SHARED)
+#if defined(MOSDEF_BUILDING_DLL)
+#define MOSDEF_API __declspec(dllexport)
+#else
+#define MOSDEF_API __declspec(dllimport)
+#endif
+#else
+#define MOSDEF_API
+#endif
+
+// Opaque library context. Contexts share no per-context state, so
+// independent contexts may be used concurrently from different threads.
+// Calls on a single context are serialized internally. Two things are
+// process-wide by design, because they follow the one config file: group
+// definitions (groups.h) and hook definitions with the pool that runs hooks
+// (hooks.h). Both are thread-safe, and each context's hooks still log
+// through its own sink.
+typedef struct MosDefContext MosDefContext;
+
+// Status codes
+typedef enum {
+    MOSDEF_OK = 0,
+    MOSDEF_ERR_INVALID_ARG,
+    MOSDEF_ERR_NO_MEMORY,
+    MOSDEF_ERR_NO_MONITORS,
+    MOSDEF_ERR_NO_MATCH,
+    MOSDEF_ERR_API_FAILURE,
+    MOSDEF_ERR_CANCELLED,
+    MOSDEF_ERR_BAD_PLAN,        // Plan file unreadable, corrupt or from another version
+    MOSDEF_ERR_STALE_PLAN       // Topology changed since the plan was resolved
+} MosDefStatus;
+
+// Context options
+typedef struct {
+    bool dry_run;   // Plan and log changes without calling ChangeDisplaySettingsExA
+    bool verbose;   // Emit LOG_LEVEL_VERBOSE messages to the log sink
+    bool apply_thread;          // Apply and roll back on the context's time-critical thread (ApplyThread)
+    DWORD_PTR apply_affinity;   // CPUs for that thread, 0 = any
+} MosDefOptions;
+
+// Context lifetime. NULL options, allocator or log sink select the defaults
+// (no dry run, CRT heap, stdout/stderr). Destroying a context waits for
+// running hooks (hooks.h), which may still log through its sink.
+MOSDEF_API MosDefContext* mosdef_create(const MosDefOptions* options,
+                                        const MosDefAllocator* allocator,
+                                        const LogSink* log_sink);
+MOSDEF_API void mosdef_destroy(MosDefContext* ctx);
+MOSDEF_API const MosDefOptions* mosdef_get_options(const MosDefContext* ctx);
+
+// Selectors
+MOSDEF_API SelectorList* mosdef_parse_selectors(MosDefContext* ctx, const char* selector_list);
+MOSDEF_API void mosdef_free_selectors(MosDefContext* ctx, SelectorList* selectors);
+
+// Enumeration (result is owned by the context allocator)
+MOSDEF_API MosDefStatus mosdef_enumerate(MosDefContext* ctx, MonitorList** out_monitors);
+MOSDEF_API void mosdef_free_monitor_list(MosDefContext* ctx, MonitorList* monitors);
+
+// Shared topology snapshots. Pinning is a single atomic operation and never
+// blocks on writers; a pinned snapshot stays valid and unchanged until
+// released. Refresh re-enumerates and publishes a new snapshot. The context's
+// initial snapshot is empty until the first refresh.
+MOSDEF_API MosDefStatus mosdef_refresh_topology(MosDefContext* ctx);
+MOSDEF_API const TopologySnapshot* mosdef_pin_topology(MosDefContext* ctx);
+MOSDEF_API void mosdef_release_topology(MosDefContext* ctx, const TopologySnapshot* snapshot);
+
+// Offline topology files (see topofile.h). Loading one makes the context
+// offline: enumeration, planning, plan verification and the plan cache use
+// the file instead of the display API, and apply/rollback behave as dry runs.
+MOSDEF_API MosDefStatus mosdef_load_topology(MosDefContext* ctx, const char* path);
+MOSDEF_API MosDefStatus mosdef_export_topology(MosDefContext* ctx, const MonitorList* monitors,
+                                               const char* path);
+
+// Drift detection. Read returns a topology file as a monitor list without
+// making the context offline; parse does the same for JSON already in memory. Diff compares expected with the current (live or
+// offline) topology, joining monitors by stable ID: removed means expected but
+// absent, added means present but not expected. out_actual receives the list
+// the diff points into; free the diff before either list.
+MOSDEF_API MosDefStatus mosdef_read_topology(MosDefContext* ctx, const char* path, MonitorList** out_monitors);
+MOSDEF_API MosDefStatus mosdef_parse_topology(MosDefContext* ctx, const char* json, size_t length,
+                                              MonitorList** out_monitors);
+MOSDEF_API MosDefStatus mosdef_diff_topology(MosDefContext* ctx, const MonitorList* expected,
+                                             MonitorList** out_actual, TopologyDiff** out_diff);
+MOSDEF_API void mosdef_free_diff(MosDefContext* ctx, TopologyDiff* diff);
+
+// Planning resolves selectors against the current topology
+MOSDEF_API MosDefStatus mosdef_plan(MosDefContext* ctx,
+                                    RotationCommand command,
+                                    const SelectorList* include_selectors,
+                                    const SelectorList* exclude_selectors,
+                                    RotationPlan** out_plan);
+MOSDEF_API void mosdef_free_plan(MosDefContext* ctx, RotationPlan* plan);
+
+// Plan files (see planfile.h). Decode reads the file format from memory.
+// Load and decode return MOSDEF_ERR_BAD_PLAN for damaged files and for
+// entries with an invalid orientation or size. A loaded plan is executed as
+// recorded, with no selector resolution; verify compares the fingerprint the plan was resolved
+// against with the live topology and returns MOSDEF_ERR_STALE_PLAN if any
+// monitor was added, removed, moved, resized, rotated or re-timed since.
+MOSDEF_API MosDefStatus mosdef_save_plan(MosDefContext* ctx, const RotationPlan* plan, const char* path);
+MOSDEF_API MosDefStatus mosdef_load_plan(MosDefContext* ctx, const char* path, RotationPlan** out_plan);
+MOSDEF_API MosDefStatus mosdef_verify_plan(MosDefContext* ctx, const RotationPlan* plan);
+MOSDEF_API MosDefStatus mosdef_decode_plan(MosDefContext* ctx, const BYTE* data, size_t size,
+                                           RotationPlan** out_plan);
+
+// Plan cache (see plancache.h). key is a caller-normalized command line.
+// Lookup checks only the EDID-free display fingerprint and returns
+// MOSDEF_ERR_NO_MATCH on a miss; store records the plan under the
+// fingerprint it was resolved against.
+MOSDEF_API MosDefStatus mosdef_lookup_cached_plan(MosDefContext* ctx, const char* key, RotationPlan** out_plan);
+MOSDEF_API MosDefStatus mosdef_store_cached_plan(MosDefContext* ctx, const char* key, const RotationPlan* plan);
+
+// Snapshots and undo (see snapshots.h). Restore and undo change only the
+// fields that differ from the live topology and commit them in one mode
+// change. A restore that changes anything journals the prior state so undo
+// can return to it; callers applying plans journal with
+// mosdef_journal_setup() after the change is kept. A missing snapshot or
+// undo entry returns MOSDEF_ERR_NO_MATCH. Dry runs journal and pop nothing.
+// Restoring a layout applies a monitor list (e.g. a topology file) the same
+// way as a snapshot.
+MOSDEF_API MosDefStatus mosdef_capture_setup(MosDefContext* ctx, DisplaySetup** out_setup);
+MOSDEF_API void mosdef_free_setup(MosDefContext* ctx, DisplaySetup* setup);
+MOSDEF_API MosDefStatus mosdef_journal_setup(MosDefContext* ctx, const DisplaySetup* setup);
+MOSDEF_API MosDefStatus mosdef_snapshot_save(MosDefContext* ctx, const char* name);
+MOSDEF_API MosDefStatus mosdef_snapshot_restore(MosDefContext* ctx, const char* name, int* out_changed);
+MOSDEF_API MosDefStatus mosdef_restore_layout(MosDefContext* ctx, const MonitorList* layout, int* out_changed);
+MOSDEF_API MosDefStatus mosdef_snapshot_undo(MosDefContext* ctx, int depth, int* out_changed);
+MOSDEF_API MosDefStatus mosdef_snapshot_list(MosDefContext* ctx, SnapshotListing** out_listing);
+MOSDEF_API void mosdef_free_snapshot_listing(MosDefContext* ctx, SnapshotListing* listing);
+
+// Change history (see history.h). Every change applied, rolled back or
+// restored outside dry runs is recorded. The callback runs with the context
+// locked; out_count (optional) receives the number of matches.
+MOSDEF_API MosDefStatus mosdef_history_query(MosDefContext* ctx, const HistoryQuery* query,
+                                             HistoryCallback callback, void* user_data,
+                                             int* out_count);
+
+// Apply and rollback. out_result may be NULL; otherwise release it with
+// mosdef_free_result().
+MOSDEF_API MosDefStatus mosdef_apply(MosDefContext* ctx, const RotationPlan* plan,
+                                     BatchRotationResult* out_result);
+MOSDEF_API MosDefStatus mosdef_rollback(MosDefContext* ctx, const RotationPlan* plan);
+MOSDEF_API void mosdef_free_result(MosDefContext* ctx, BatchRotationResult* result);
+
+// Asynchronous operations. Each call queues work on the context's worker
+// thread and returns immediately. Completion is reported through the
+// optional callback (run on the worker thread, or on the cancelling thread
+// for operations cancelled before they started) and through a manual-reset
+// event suitable for WaitForMultipleObjects / MsgWaitForMultipleObjects.
+// Plans passed to apply/rollback must stay alive until the operation is done.
+// Every operation must be released exactly once, before or after its
+// context is destroyed: mosdef_destroy cancels queued operations and stops
+// the worker, and the context's memory is freed when the last operation
+// is released. A callback may destroy its own context: the worker finishes
+// the teardown after the callback returns and cancels anything still queued.
+typedef struct MosDefOperation MosDefOperation;
+
+typedef enum {
+    MOSDEF_OP_PENDING,
+    MOSDEF_OP_RUNNING,
+    MOSDEF_OP_COMPLETED,
+    MOSDEF_OP_CANCELLED
+} MosDefOperationState;
+
+typedef void (*MosDefCompletionCallback)(MosDefOperation* operation, void* user_data);
+
+MOSDEF_API MosDefOperation* mosdef_enumerate_async(MosDefContext* ctx,
+                                                   MosDefCompletionCallback callback,
+                                                   void* user_data);
+MOSDEF_API MosDefOperation* mosdef_apply_async(MosDefContext* ctx, const RotationPlan* plan,
+                                               MosDefCompletionCallback callback,
+                                               void* user_data);
+MOSDEF_API MosDefOperation* mosdef_rollback_async(MosDefContext* ctx, const RotationPlan* plan,
+                                                  MosDefCompletionCallback callback,
+                                                  void* user_data);
+
+MOSDEF_API MosDefOperationState mosdef_operation_state(const MosDefOperation* operation);
+MOSDEF_API MosDefStatus mosdef_operation_status(const MosDefOperation* operation);
+MOSDEF_API HANDLE mosdef_operation_wait_handle(const MosDefOperation* operation);
+MOSDEF_API bool mosdef_operation_wait(MosDefOperation* operation, DWORD timeout_ms);
+#ifndef _WIN32
+// Descriptor that turns readable when the operation finishes, for poll and
+// epoll loops. Owned by the operation; do not read from or close it.
+MOSDEF_API int mosdef_operation_poll_fd(const MosDefOperation* operation);
+#endif
+
+// Pending operations are cancelled immediately; running apply/rollback
+// operations stop before the next monitor. Returns false if already finished.
+MOSDEF_API bool mosdef_operation_cancel(MosDefOperation* operation);
+
+// Results of finished operations. Ownership transfers to the caller, who
+// releases them with mosdef_free_monitor_list() / mosdef_free_result().
+MOSDEF_API MonitorList* mosdef_operation_take_monitors(MosDefOperation* operation);
+MOSDEF_API BatchRotationResult mosdef_operation_take_result(MosDefOperation* operation);
+MOSDEF_API void mosdef_operation_release(MosDefOperation* operation);
+
+// Diagnostics
+MOSDEF_API const char* mosdef_status_string(MosDefStatus status);
+
+#endif // MOSDEF_H
@@ -0,0 +1,44 @@
+#ifndef MOSDEF_INTERNAL_H
+#define MOSDEF_INTERNAL_H
+
+#include "mosdef.h"
+#include "topology.h"
+
+// Library internals shared between mosdef.c and the other library modules.
+// Not part of the public API.
+
+typedef struct AsyncWorker AsyncWorker;
+typedef struct HookScope HookScope;
+
+struct MosDefContext {
+    MosDefOptions options;
+    MosDefAllocator allocator;
+    LogSink log_sink;
+    CRITICAL_SECTION lock;      // Serializes entry points on this context
+    CRITICAL_SECTION worker_lock;
+    AsyncWorker* worker;        // Created on the first asynchronous call
+    TopologyStore* topology;    // Snapshots shared with lock-free readers
+    MonitorList* offline_monitors; // Loaded topology file; NULL for the live display API
+    HookScope* hooks;           // The hooks this context fired; closed on destroy
+    ApplyThread* apply_thread;  // Started by the first apply with options.apply_thread
+    volatile LONG refs;         // The owner plus each unreleased asynchronous operation
+};
+
+// Implementations shared by the synchronous and asynchronous entry points
+MosDefStatus context_enumerate(MosDefContext* ctx, MonitorList** out_monitors);
+MosDefStatus context_apply(MosDefContext* ctx, const RotationPlan* plan,
+                           volatile LONG* cancel_flag, BatchRotationResult* out_result);
+MosDefStatus context_rollback(MosDefContext* ctx, const RotationPlan* plan,
+                              volatile LONG* cancel_flag);
+
+// Asynchronous worker teardown (async.c). Defer returns true when called
+// from a completion callback on the worker, which then finishes destroying
+// the context itself.
+void async_worker_shutdown(MosDefContext* ctx);
+bool async_worker_defer_destroy(MosDefContext* ctx);
+
+// Drops a reference; the last one releases everything but the worker
+// (mosdef.c)
+void context_release(MosDefContext* ctx);
+
+#endif // MOSDEF_INTERNAL_H
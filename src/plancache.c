@@ -0,0 +1,225 @@
+#include "plancache.h"
+#include "planfile.h"
+#include "util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Cache file layout (little-endian):
+//   header  "MOSPCACH", u32 version, u32 count
+//   entry   u16 key length + key, u64 display fingerprint, u32 plan size, plan
+// Each plan carries its own checksum, so a damaged entry only misses.
+#define PLAN_CACHE_MAGIC "MOSPCACH"
+#define PLAN_CACHE_MAGIC_SIZE 8
+#define PLAN_CACHE_VERSION 1
+#define PLAN_CACHE_MAX_SIZE (4 * 1024 * 1024)
+
+typedef struct {
+    const char* key;            // Points into the cache file data
+    WORD key_length;
+    ULONG64 fingerprint;
+    const BYTE* plan;
+    DWORD plan_size;
+} CacheEntry;
+
+typedef struct {
+    BYTE* data;
+    CacheEntry entries[PLAN_CACHE_MAX_ENTRIES];
+    int count;
+} CacheFile;
+
+static char* get_plan_cache_path() {
+    return get_local_data_path("plans.cache");
+}
+
+// Reading
+static bool take(const BYTE* data, size_t size, size_t* offset, void* out, size_t count) {
+    if (size - *offset < count) return false;
+    memcpy(out, data + *offset, count);
+    *offset += count;
+    return true;
+}
+
+// Missing or unreadable files are an empty cache
+static void read_cache_file(const char* path, CacheFile* cache) {
+    cache->data = NULL;
+    cache->count = 0;
+
+    FILE* file = NULL;
+    if (fopen_s(&file, path, "rb") != 0 || !file) return;
+
+    fseek(file, 0, SEEK_END);
+    long file_size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    if (file_size <= 0 || file_size > PLAN_CACHE_MAX_SIZE) {
+        fclose(file);
+        return;
+    }
+
+    cache->data = (BYTE*)malloc((size_t)file_size);
+    size_t size = cache->data ? fread(cache->data, 1, (size_t)file_size, file) : 0;
+    fclose(file);
+
+    size_t offset = 0;
+    char magic[PLAN_CACHE_MAGIC_SIZE];
+    DWORD version = 0;
+    DWORD count = 0;
+    if (!take(cache->data, size, &offset, magic, sizeof(magic)) ||
+        memcmp(magic, PLAN_CACHE_MAGIC, PLAN_CACHE_MAGIC_SIZE) != 0 ||
+        !take(cache->data, size, &offset, &version, sizeof(version)) ||
+        !take(cache->data, size, &offset, &count, sizeof(count)) ||
+        version != PLAN_CACHE_VERSION) {
+        log_verbose("Ignoring unrecognized plan cache: %s", path);
+        return;
+    }
+
+    for (DWORD i = 0; i < count && cache->count < PLAN_CACHE_MAX_ENTRIES; i++) {
+        CacheEntry* entry = &cache->entries[cache->count];
+        if (!take(cache->data, size, &offset, &entry->key_length, sizeof(entry->key_length)) ||
+            size - offset < entry->key_length) {
+            break;
+        }
+        entry->key = (const char*)cache->data + offset;
+        offset += entry->key_length;
+
+        if (!take(cache->data, size, &offset, &entry->fingerprint, sizeof(entry->fingerprint)) ||
+            !take(cache->data, size, &offset, &entry->plan_size, sizeof(entry->plan_size)) ||
+            size - offset < entry->plan_size) {
+            break;
+        }
+        entry->plan = cache->data + offset;
+        offset += entry->plan_size;
+        cache->count++;
+    }
+}
+
+static bool entry_matches(const CacheEntry* entry, const char* key, size_t key_length, ULONG64 fingerprint) {
+    return entry->fingerprint == fingerprint && entry->key_length == key_length &&
+           memcmp(entry->key, key, key_length) == 0;
+}
+
+RotationPlan* plan_cache_lookup(const char* key, ULONG64 display_fingerprint,
+                                const MosDefAllocator* allocator) {
+    if (!key) return NULL;
+
+    char* path = get_plan_cache_path();
+    if (!path) return NULL;
+
+    CacheFile cache;
+    read_cache_file(path, &cache);
+
+    RotationPlan* plan = NULL;
+    size_t key_length = strlen(key);
+    for (int i = 0; i < cache.count; i++) {
+        const CacheEntry* entry = &cache.entries[i];
+        if (entry_matches(entry, key, key_length, display_fingerprint)) {
+            plan = decode_plan(entry->plan, entry->plan_size, path, allocator);
+            break;
+        }
+    }
+
+    if (plan) {
+        plan->display_fingerprint = display_fingerprint;
+    }
+
+    free(cache.data);
+    free(path);
+    return plan;
+}
+
+// Writing
+static bool write_all(FILE* file, const void* data, size_t size) {
+    return fwrite(data, 1, size, file) == size;
+}
+
+static bool write_entry(FILE* file, const char* key, WORD key_length, ULONG64 fingerprint,
+                        const BYTE* plan, DWORD plan_size) {
+    return write_all(file, &key_length, sizeof(key_length)) &&
+           write_all(file, key, key_length) &&
+           write_all(file, &fingerprint, sizeof(fingerprint)) &&
+           write_all(file, &plan_size, sizeof(plan_size)) &&
+           write_all(file, plan, plan_size);
+}
+
+// Writes the whole cache to a temporary file and swaps it in, so concurrent
+// readers see either the old or the new cache, never a partial one
+static bool write_cache_file(const char* path, const char* key, WORD key_length, ULONG64 fingerprint,
+                             const BYTE* plan, DWORD plan_size, const CacheFile* previous) {
+    size_t temp_len = strlen(path) + 32;
+    char* temp_path = (char*)malloc(temp_len);
+    if (!temp_path) return false;
+    sprintf_s(temp_path, temp_len, "%s.%lu.tmp", path, GetCurrentProcessId());
+
+    FILE* file = NULL;
+    if (fopen_s(&file, temp_path, "wb") != 0 || !file) {
+        free(temp_path);
+        return false;
+    }
+
+    // Newest first; the entry being replaced and the oldest overflow are dropped
+    DWORD count = 1;
+    for (int i = 0; i < previous->count && count < PLAN_CACHE_MAX_ENTRIES; i++) {
+        if (!entry_matches(&previous->entries[i], key, key_length, fingerprint)) {
+            count++;
+        }
+    }
+
+    DWORD version = PLAN_CACHE_VERSION;
+    bool success = write_all(file, PLAN_CACHE_MAGIC, PLAN_CACHE_MAGIC_SIZE) &&
+                   write_all(file, &version, sizeof(version)) &&
+                   write_all(file, &count, sizeof(count)) &&
+                   write_entry(file, key, key_length, fingerprint, plan, plan_size);
+
+    DWORD written = 1;
+    for (int i = 0; success && i < previous->count && written < count; i++) {
+        const CacheEntry* entry = &previous->entries[i];
+        if (entry_matches(entry, key, key_length, fingerprint)) continue;
+
+        success = write_entry(file, entry->key, entry->key_length, entry->fingerprint,
+                              entry->plan, entry->plan_size);
+        written++;
+    }
+
+    success = (fclose(file) == 0) && success;
+    if (success) {
+        success = MoveFileExA(temp_path, path, MOVEFILE_REPLACE_EXISTING) != 0;
+    }
+    if (!success) {
+        DeleteFileA(temp_path);
+    }
+
+    free(temp_path);
+    return success;
+}
+
+bool plan_cache_store(const char* key, const RotationPlan* plan) {
+    if (!key || !plan) return false;
+
+    size_t key_length = strlen(key);
+    if (key_length > 0xFFFF) return false;
+
+    size_t plan_size = 0;
+    BYTE* encoded = encode_plan(plan, &plan_size);
+    if (!encoded) return false;
+
+    char* path = get_plan_cache_path();
+    if (!path) {
+        free(encoded);
+        return false;
+    }
+
+    CacheFile cache;
+    read_cache_file(path, &cache);
+
+    bool success = write_cache_file(path, key, (WORD)key_length, plan->display_fingerprint,
+                                    encoded, (DWORD)plan_size, &cache);
+    if (!success) {
+        log_verbose("Failed to update plan cache: %s", path);
+    }
+
+    free(cache.data);
+    free(encoded);
+    free(path);
+    return success;
+}
@@ -0,0 +1,24 @@
+#ifndef PLANCACHE_H
+#define PLANCACHE_H
+
+#include <stdbool.h>
+#include "rotate.h"
+#include "util.h"
+
+// Persistent cache of resolved rotation plans, for command lines that are
+// run over and over (hotkeys, scripts). Entries are keyed by a normalized
+// command line together with the EDID-free display fingerprint, so the same
+// command keeps one plan per topology (docked and undocked, say) and any
+// topology change simply misses. The most recently stored entries are kept.
+//
+// Stored in %LOCALAPPDATA%\MOS-DEF\plans.cache; each entry is a plan in the
+// plan file encoding. The cache is best-effort: failures only log verbosely.
+
+#define PLAN_CACHE_MAX_ENTRIES 32
+
+// Returns NULL on a miss. The returned plan's display_fingerprint is set.
+RotationPlan* plan_cache_lookup(const char* key, ULONG64 display_fingerprint,
+                                const MosDefAllocator* allocator);
+bool plan_cache_store(const char* key, const RotationPlan* plan);
+
+#endif // PLANCACHE_H
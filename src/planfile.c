@@ -0,0 +1,307 @@
+#include "planfile.h"
+#include "util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PLAN_FILE_MAGIC "MOSPLAN"       // Written with its terminator: 8 bytes
+#define PLAN_FILE_MAGIC_SIZE 8
+#define PLAN_FILE_MAX_SIZE (1024 * 1024)
+#define PLAN_FILE_MAX_ENTRIES 256
+#define PLAN_FILE_MAX_DIMENSION 65535   // Pixels; DEVMODE modes never come close
+
+static ULONG64 plan_checksum(const BYTE* data, size_t size) {
+    return hash_bytes(HASH_SEED, data, size);
+}
+
+static bool valid_mode(DWORD orientation, DWORD width, DWORD height) {
+    return orientation <= DMDO_270 &&
+           width > 0 && width <= PLAN_FILE_MAX_DIMENSION &&
+           height > 0 && height <= PLAN_FILE_MAX_DIMENSION;
+}
+
+// Writer
+typedef struct {
+    BYTE* data;
+    size_t length;
+    size_t capacity;
+    bool failed;
+} PlanWriter;
+
+static void write_bytes(PlanWriter* writer, const void* data, size_t size) {
+    if (writer->failed) return;
+
+    if (writer->length + size > writer->capacity) {
+        size_t capacity = writer->capacity ? writer->capacity * 2 : 512;
+        while (capacity < writer->length + size) {
+            capacity *= 2;
+        }
+        BYTE* grown = (BYTE*)realloc(writer->data, capacity);
+        if (!grown) {
+            writer->failed = true;
+            return;
+        }
+        writer->data = grown;
+        writer->capacity = capacity;
+    }
+
+    memcpy(writer->data + writer->length, data, size);
+    writer->length += size;
+}
+
+static void write_u32(PlanWriter* writer, DWORD value) {
+    write_bytes(writer, &value, sizeof(value));
+}
+
+static void write_u64(PlanWriter* writer, ULONG64 value) {
+    write_bytes(writer, &value, sizeof(value));
+}
+
+static void write_string(PlanWriter* writer, const char* value) {
+    size_t length = value ? strlen(value) : 0;
+    if (length > 0xFFFF) {
+        writer->failed = true;
+        return;
+    }
+
+    WORD encoded = (WORD)length;
+    write_bytes(writer, &encoded, sizeof(encoded));
+    write_bytes(writer, value, length);
+}
+
+BYTE* encode_plan(const RotationPlan* plan, size_t* out_size) {
+    if (!plan || !out_size) return NULL;
+
+    PlanWriter writer = { NULL, 0, 0, false };
+    write_bytes(&writer, PLAN_FILE_MAGIC, PLAN_FILE_MAGIC_SIZE);
+    write_u32(&writer, PLAN_FILE_VERSION);
+    write_u32(&writer, (DWORD)plan->command);
+    write_u64(&writer, plan->topology_fingerprint);
+    write_u32(&writer, (DWORD)plan->count);
+
+    for (int i = 0; i < plan->count; i++) {
+        const RotationPlanEntry* entry = &plan->entries[i];
+        write_u32(&writer, entry->current_orientation);
+        write_u32(&writer, entry->current_width);
+        write_u32(&writer, entry->current_height);
+        write_u32(&writer, entry->target_orientation);
+        write_u32(&writer, entry->target_width);
+        write_u32(&writer, entry->target_height);
+        write_string(&writer, entry->id);
+        write_string(&writer, entry->device_path);
+        write_string(&writer, entry->stable_id);
+    }
+
+    if (!writer.failed) {
+        write_u64(&writer, plan_checksum(writer.data, writer.length));
+    }
+
+    if (writer.failed) {
+        log_error("Failed to encode plan");
+        free(writer.data);
+        return NULL;
+    }
+
+    *out_size = writer.length;
+    return writer.data;
+}
+
+bool save_plan_file(const RotationPlan* plan, const char* path) {
+    if (!plan || !path) return false;
+
+    size_t size = 0;
+    BYTE* data = encode_plan(plan, &size);
+    if (!data) return false;
+
+    FILE* file = NULL;
+    if (fopen_s(&file, path, "wb") != 0 || !file) {
+        log_error("Failed to open plan file for writing: %s", path);
+        free(data);
+        return false;
+    }
+
+    bool success = fwrite(data, 1, size, file) == size;
+    success = (fclose(file) == 0) && success;
+    free(data);
+
+    if (!success) {
+        log_error("Failed to write plan file: %s", path);
+    }
+    return success;
+}
+
+// Reader
+typedef struct {
+    const BYTE* data;
+    size_t length;
+    size_t offset;
+    bool failed;
+} PlanReader;
+
+static bool read_bytes(PlanReader* reader, void* out, size_t size) {
+    if (reader->failed || reader->length - reader->offset < size) {
+        reader->failed = true;
+        return false;
+    }
+    memcpy(out, reader->data + reader->offset, size);
+    reader->offset += size;
+    return true;
+}
+
+static DWORD read_u32(PlanReader* reader) {
+    DWORD value = 0;
+    read_bytes(reader, &value, sizeof(value));
+    return value;
+}
+
+static ULONG64 read_u64(PlanReader* reader) {
+    ULONG64 value = 0;
+    read_bytes(reader, &value, sizeof(value));
+    return value;
+}
+
+static char* read_string(PlanReader* reader, const MosDefAllocator* allocator) {
+    WORD length = 0;
+    if (!read_bytes(reader, &length, sizeof(length))) return NULL;
+    if (reader->length - reader->offset < length) {
+        reader->failed = true;
+        return NULL;
+    }
+
+    char* value = (char*)mem_alloc(allocator, (size_t)length + 1);
+    if (!value) {
+        reader->failed = true;
+        return NULL;
+    }
+    memcpy(value, reader->data + reader->offset, length);
+    value[length] = '\0';
+    reader->offset += length;
+    return value;
+}
+
+static BYTE* read_file(const char* path, size_t* out_size) {
+    FILE* file = NULL;
+    if (fopen_s(&file, path, "rb") != 0 || !file) {
+        log_error("Failed to open plan file: %s", path);
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long file_size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    if (file_size <= 0 || file_size > PLAN_FILE_MAX_SIZE) {
+        log_error("Plan file has an invalid size: %s", path);
+        fclose(file);
+        return NULL;
+    }
+
+    BYTE* data = (BYTE*)malloc((size_t)file_size);
+    if (!data) {
+        fclose(file);
+        return NULL;
+    }
+
+    *out_size = fread(data, 1, (size_t)file_size, file);
+    fclose(file);
+    return data;
+}
+
+RotationPlan* decode_plan(const BYTE* data, size_t size, const char* source,
+                          const MosDefAllocator* allocator) {
+    if (!data) return NULL;
+
+    // Checksum first, so nothing below ever parses damaged data
+    ULONG64 stored_checksum = 0;
+    if (size < PLAN_FILE_MAGIC_SIZE + sizeof(stored_checksum) ||
+        memcmp(data, PLAN_FILE_MAGIC, PLAN_FILE_MAGIC_SIZE) != 0) {
+        log_error("Not a MOS-DEF plan file: %s", source);
+        return NULL;
+    }
+
+    size_t payload_size = size - sizeof(stored_checksum);
+    memcpy(&stored_checksum, data + payload_size, sizeof(stored_checksum));
+    if (plan_checksum(data, payload_size) != stored_checksum) {
+        log_error("Plan file is corrupt (checksum mismatch): %s", source);
+        return NULL;
+    }
+
+    PlanReader reader = { data, payload_size, PLAN_FILE_MAGIC_SIZE, false };
+    DWORD version = read_u32(&reader);
+    DWORD command = read_u32(&reader);
+    ULONG64 fingerprint = read_u64(&reader);
+    DWORD count = read_u32(&reader);
+
+    if (reader.failed || version != PLAN_FILE_VERSION) {
+        log_error("Unsupported plan file version %lu: %s", version, source);
+        return NULL;
+    }
+    if (command > ROTATION_TOGGLE || count == 0 || count > PLAN_FILE_MAX_ENTRIES) {
+        log_error("Plan file has an invalid header: %s", source);
+        return NULL;
+    }
+
+    RotationPlan* plan = (RotationPlan*)mem_alloc(allocator, sizeof(RotationPlan));
+    RotationPlanEntry* entries = (RotationPlanEntry*)mem_alloc(allocator, count * sizeof(RotationPlanEntry));
+    if (!plan || !entries) {
+        mem_free(allocator, plan);
+        mem_free(allocator, entries);
+        return NULL;
+    }
+
+    plan->command = (RotationCommand)command;
+    plan->entries = entries;
+    plan->count = 0;
+    plan->topology_fingerprint = fingerprint;
+    plan->display_fingerprint = 0;
+
+    bool out_of_range = false;
+    for (DWORD i = 0; i < count && !reader.failed && !out_of_range; i++) {
+        RotationPlanEntry* entry = &plan->entries[i];
+        entry->current_orientation = read_u32(&reader);
+        entry->current_width = read_u32(&reader);
+        entry->current_height = read_u32(&reader);
+        entry->target_orientation = read_u32(&reader);
+        entry->target_width = read_u32(&reader);
+        entry->target_height = read_u32(&reader);
+        entry->id = read_string(&reader, allocator);
+        entry->device_path = read_string(&reader, allocator);
+        entry->stable_id = read_string(&reader, allocator);
+
+        // Counted before the check so free_rotation_plan releases partial entries
+        plan->count++;
+        if (!entry->id || !entry->device_path || !entry->stable_id) {
+            reader.failed = true;
+        } else if (!valid_mode(entry->current_orientation, entry->current_width, entry->current_height) ||
+                   !valid_mode(entry->target_orientation, entry->target_width, entry->target_height)) {
+            // Entries go to the display driver as recorded
+            log_error("Plan file entry %lu (%s) has an invalid mode: %s", i + 1, entry->id, source);
+            out_of_range = true;
+        }
+    }
+
+    if (out_of_range) {
+        free_rotation_plan(plan, allocator);
+        return NULL;
+    }
+
+    if (reader.failed || reader.offset != reader.length) {
+        log_error("Plan file is truncated or malformed: %s", source);
+        free_rotation_plan(plan, allocator);
+        return NULL;
+    }
+
+    return plan;
+}
+
+RotationPlan* load_plan_file(const char* path, const MosDefAllocator* allocator) {
+    if (!path) return NULL;
+
+    size_t size = 0;
+    BYTE* data = read_file(path, &size);
+    if (!data) return NULL;
+
+    RotationPlan* plan = decode_plan(data, size, path, allocator);
+    free(data);
+    return plan;
+}
@@ -0,0 +1,33 @@
+#ifndef PLANFILE_H
+#define PLANFILE_H
+
+#include <stdbool.h>
+#include "rotate.h"
+#include "util.h"
+
+// Binary plan files for two-phase plan/apply. A file holds a resolved
+// RotationPlan exactly as it will be executed, plus the fingerprint of the
+// topology it was resolved against. Layout (little-endian):
+//
+//   header   "MOSPLAN\0", u32 version, u32 command, u64 fingerprint, u32 count
+//   entries  u32 current orientation/width/height, u32 target orientation/
+//            width/height, then id, device path and stable ID as u16 length
+//            + bytes (no terminator)
+//   trailer  u64 FNV-1a of everything before it
+//
+// Files with a bad magic, version, checksum or truncated entry are rejected,
+// as are entries with an orientation past DMDO_270 or a zero or oversized
+// dimension.
+
+#define PLAN_FILE_VERSION 1
+
+bool save_plan_file(const RotationPlan* plan, const char* path);
+RotationPlan* load_plan_file(const char* path, const MosDefAllocator* allocator);
+
+// The same encoding in memory, shared with the plan cache. encode returns a
+// CRT-heap buffer; source names the data in error messages.
+BYTE* encode_plan(const RotationPlan* plan, size_t* out_size);
+RotationPlan* decode_plan(const BYTE* data, size_t size, const char* source,
+                          const MosDefAllocator* allocator);
+
+#endif // PLANFILE_H
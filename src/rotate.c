@@ -1,278 +1,575 @@
 #include "rotate.h"
 #include "util.h"
 #include "enum.h"
+#include "diff.h"
+#include "history.h"
+#include "groups.h"
+#include "montable.h"
+#include "modeldb.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
+
+static void log_change_error_detail(LONG error_code) {
+    switch (error_code) {
+        case DISP_CHANGE_BADDUALVIEW:
+            log_error("The settings change was unsuccessful because the system is DualView capable.");
+            break;
+        case DISP_CHANGE_BADFLAGS:
+            log_error("An invalid set of flags was passed in.");
+            break;
+        case DISP_CHANGE_BADMODE:
+            log_error("The graphics mode is not supported.");
+            break;
+        case DISP_CHANGE_BADPARAM:
+            log_error("An invalid parameter was passed in.");
+            break;
+        case DISP_CHANGE_FAILED:
+            log_error("The display driver failed the specified graphics mode.");
+            break;
+        case DISP_CHANGE_NOTUPDATED:
+            log_error("Unable to write settings to the registry.");
+            break;
+        case DISP_CHANGE_RESTART:
+            log_error("The computer must be restarted for the graphics mode to work.");
+            break;
+        default:
+            log_error("Unknown error occurred.");
+            break;
+    }
+}
 
-// Single monitor rotation
-RotationResult rotate_monitor(const MonitorInfo* monitor, RotationCommand command, bool dry_run) {
-    RotationResult result = { false, 0, 0, 0 };
+static MonitorInfo* lookup_selector(const MonitorList* monitors, const Selector* selector) {
+    switch (selector->type) {
+        case SELECTOR_TYPE_MONITOR_ID:
+            return find_monitor_by_id(monitors, selector->value);
+        case SELECTOR_TYPE_EDID: {
+            MonitorInfo* monitor = find_monitor_by_stable_id(monitors, selector->value);
+            if (!monitor) {
+                // Stable IDs are case-insensitive; retry with the canonical upper case
+                char* upper = _strdup(selector->value);
+                if (upper) {
+                    for (char* p = upper; *p; p++) {
+                        *p = (char)toupper((unsigned char)*p);
+                    }
+                    monitor = find_monitor_by_stable_id(monitors, upper);
+                    free(upper);
+                }
+            }
+            return monitor;
+        }
+        default:
+            return NULL;
+    }
+}
 
-    if (!monitor) {
-        result.error_code = DISP_CHANGE_BADPARAM;
-        return result;
+// Device path and native resolution selectors compare the monitor table's
+// atom and size columns; false for other types or a list without a table
+static bool apply_table_selector(const MonitorList* monitors, const Selector* selector, ULONG64* bits) {
+    const MonitorTable* table = monitor_list_table(monitors);
+    if (!table) return false;
+
+    switch (selector->type) {
+        case SELECTOR_TYPE_DEVICE_PATH:
+            monitor_table_select_atom(table, table->device_path,
+                                      monitor_table_find_atom(table, selector->value), bits);
+            return true;
+        case SELECTOR_TYPE_NATIVE: {
+            unsigned long width = 0, height = 0;
+            if (sscanf(selector->value, "%lux%lu", &width, &height) == 2) {
+                monitor_table_select_native(table, width, height, bits);
+            }
+            return true;
+        }
+        default:
+            return false;
     }
+}
 
-    // Get current display settings
-    DEVMODEA devmode;
-    memset(&devmode, 0, sizeof(DEVMODEA));
-    devmode.dmSize = sizeof(DEVMODEA);
+static bool is_indexed_selector(const Selector* selector) {
+    return selector->type == SELECTOR_TYPE_MONITOR_ID || selector->type == SELECTOR_TYPE_EDID;
+}
 
-    if (!EnumDisplaySettingsExA(monitor->device_path, ENUM_CURRENT_SETTINGS, &devmode, 0)) {
-        result.error_code = DISP_CHANGE_BADMODE;
-        log_verbose("Failed to get current display settings for %s", monitor->device_path);
-        return result;
-    }
+bool select_monitors(const MonitorList* monitors, const SelectorList* selectors, ULONG64* bits) {
+    if (!monitors || !bits) return false;
 
-    result.old_orientation = devmode.dmDisplayOrientation;
-    result.new_orientation = get_target_orientation(devmode.dmDisplayOrientation, command);
-
-    log_verbose("Rotating monitor %s (%s) from %s to %s",
-               monitor->id, monitor->device_path,
-               get_orientation_string(result.old_orientation),
-               get_orientation_string(result.new_orientation));
-
-    // Prepare new display settings
-    DEVMODEA new_devmode = devmode;
-    new_devmode.dmDisplayOrientation = result.new_orientation;
-    new_devmode.dmFields |= DM_DISPLAYORIENTATION;
-
-    // Swap dimensions if rotating between landscape and portrait
-    if (should_swap_dimensions(result.old_orientation, result.new_orientation)) {
-        DWORD temp = new_devmode.dmPelsWidth;
-        new_devmode.dmPelsWidth = new_devmode.dmPelsHeight;
-        new_devmode.dmPelsHeight = temp;
-        new_devmode.dmFields |= (DM_PELSWIDTH | DM_PELSHEIGHT);
-
-        log_verbose("Swapping dimensions: %lux%lu -> %lux%lu",
-                   devmode.dmPelsWidth, devmode.dmPelsHeight,
-                   new_devmode.dmPelsWidth, new_devmode.dmPelsHeight);
-    }
+    for (int j = 0; selectors && j < selectors->count; j++) {
+        const Selector* selector = &selectors->selectors[j];
 
-    if (dry_run) {
-        log_info("[DRY RUN] Would rotate %s from %s to %s", monitor->id,
-                get_orientation_string(result.old_orientation),
-                get_orientation_string(result.new_orientation));
-        result.success = true;
-        return result;
-    }
+        if (is_indexed_selector(selector)) {
+            MonitorInfo* monitor = lookup_selector(monitors, selector);
+            if (monitor) {
+                MONITOR_BITSET_SET(bits, (int)(monitor - monitors->monitors));
+            }
+            continue;
+        }
+
+        // Name selectors are tested once per distinct interned name
+        if (apply_name_selector(monitors, selector, bits)) {
+            continue;
+        }
 
-    // Apply the display settings change
-    LONG change_result = ChangeDisplaySettingsExA(monitor->device_path, &new_devmode, NULL,
-                                                 CDS_UPDATEREGISTRY | CDS_GLOBAL, NULL);
+        if (apply_table_selector(monitors, selector, bits)) {
+            continue;
+        }
 
-    result.error_code = change_result;
-    result.success = (change_result == DISP_CHANGE_SUCCESSFUL);
+        // Groups contribute their cached membership bitset
+        if (selector->type == SELECTOR_TYPE_GROUP) {
+            if (!monitor_group_select(selector->value, monitors, bits)) {
+                return false;
+            }
+            continue;
+        }
 
-    if (result.success) {
-        log_verbose("Successfully rotated monitor %s", monitor->id);
-    } else {
-        log_error("Failed to rotate monitor %s: error code %ld", monitor->id, change_result);
-        switch (change_result) {
-            case DISP_CHANGE_BADDUALVIEW:
-                log_error("The settings change was unsuccessful because the system is DualView capable.");
-                break;
-            case DISP_CHANGE_BADFLAGS:
-                log_error("An invalid set of flags was passed in.");
-                break;
-            case DISP_CHANGE_BADMODE:
-                log_error("The graphics mode is not supported.");
-                break;
-            case DISP_CHANGE_BADPARAM:
-                log_error("An invalid parameter was passed in.");
-                break;
-            case DISP_CHANGE_FAILED:
-                log_error("The display driver failed the specified graphics mode.");
-                break;
-            case DISP_CHANGE_NOTUPDATED:
-                log_error("Unable to write settings to the registry.");
-                break;
-            case DISP_CHANGE_RESTART:
-                log_error("The computer must be restarted for the graphics mode to work.");
-                break;
-            default:
-                log_error("Unknown error occurred.");
-                break;
+        for (int i = 0; i < monitors->count; i++) {
+            if (monitor_matches_selector(&monitors->monitors[i], selector)) {
+                MONITOR_BITSET_SET(bits, i);
+            }
         }
     }
 
-    return result;
+    return true;
 }
 
-// Batch rotation with selector filtering
-BatchRotationResult rotate_monitors_filtered(const MonitorList* monitors,
-                                           RotationCommand command,
-                                           const SelectorList* include_selectors,
-                                           const SelectorList* exclude_selectors,
-                                           bool dry_run) {
-    BatchRotationResult batch_result = { 0, 0, NULL };
+bool* resolve_selection(const MonitorList* monitors,
+                        const SelectorList* include_selectors,
+                        const SelectorList* exclude_selectors) {
+    if (!monitors) return NULL;
+
+    int words = MONITOR_BITSET_WORDS(monitors->count);
+    bool* selected = (bool*)malloc((monitors->count > 0 ? monitors->count : 1) * sizeof(bool));
+    ULONG64* include_bits = (ULONG64*)calloc(words > 0 ? words : 1, sizeof(ULONG64));
+    ULONG64* exclude_bits = (ULONG64*)calloc(words > 0 ? words : 1, sizeof(ULONG64));
+    bool success = selected && include_bits && exclude_bits;
+
+    // selected = include & ~exclude, with no include list meaning every monitor
+    if (success && (!include_selectors || include_selectors->count == 0)) {
+        memset(include_bits, 0xFF, words * sizeof(ULONG64));
+    } else if (success) {
+        success = select_monitors(monitors, include_selectors, include_bits);
+    }
+    if (success && exclude_selectors && exclude_selectors->count > 0) {
+        success = select_monitors(monitors, exclude_selectors, exclude_bits);
+    }
 
-    if (!monitors || monitors->count == 0) {
-        return batch_result;
+    if (success) {
+        for (int w = 0; w < words; w++) {
+            include_bits[w] &= ~exclude_bits[w];
+        }
+        for (int i = 0; i < monitors->count; i++) {
+            selected[i] = MONITOR_BITSET_TEST(include_bits, i) != 0;
+        }
+    } else {
+        free(selected);
+        selected = NULL;
     }
 
-    // Allocate results array
-    batch_result.results = (RotationResult*)malloc(monitors->count * sizeof(RotationResult));
-    if (!batch_result.results) {
-        log_error("Failed to allocate memory for rotation results");
-        return batch_result;
+    free(include_bits);
+    free(exclude_bits);
+    return selected;
+}
+
+// Rotation plans
+RotationPlan* build_rotation_plan(const MonitorList* monitors,
+                                  RotationCommand command,
+                                  const SelectorList* include_selectors,
+                                  const SelectorList* exclude_selectors,
+                                  const MosDefAllocator* allocator) {
+    if (!monitors) return NULL;
+
+    RotationPlan* plan = (RotationPlan*)mem_alloc(allocator, sizeof(RotationPlan));
+    if (!plan) return NULL;
+
+    plan->command = command;
+    plan->entries = NULL;
+    plan->count = 0;
+    plan->topology_fingerprint = topology_fingerprint(monitors);
+    plan->display_fingerprint = display_fingerprint(monitors);
+
+    if (monitors->count == 0) {
+        return plan;
+    }
+
+    bool* selected = resolve_selection(monitors, include_selectors, exclude_selectors);
+    plan->entries = (RotationPlanEntry*)mem_alloc(allocator, monitors->count * sizeof(RotationPlanEntry));
+    if (!plan->entries || !selected) {
+        free(selected);
+        mem_free(allocator, plan->entries);
+        mem_free(allocator, plan);
+        return NULL;
     }
 
     for (int i = 0; i < monitors->count; i++) {
         const MonitorInfo* monitor = &monitors->monitors[i];
-        bool should_process = true;
-
-        // Check include selectors (if specified)
-        if (include_selectors && include_selectors->count > 0) {
-            should_process = false;
-            for (int j = 0; j < include_selectors->count; j++) {
-                if (matches_monitor(&include_selectors->selectors[j],
-                                  monitor->id, monitor->device_path, monitor->device_name)) {
-                    should_process = true;
-                    break;
-                }
-            }
+        if (!selected[i]) {
+            continue;
         }
 
-        // Check exclude selectors
-        if (exclude_selectors && exclude_selectors->count > 0) {
-            for (int j = 0; j < exclude_selectors->count; j++) {
-                if (matches_monitor(&exclude_selectors->selectors[j],
-                                  monitor->id, monitor->device_path, monitor->device_name)) {
-                    should_process = false;
-                    break;
-                }
-            }
+        // Models that mishandle rotated modes are only ever returned to landscape
+        DWORD target_orientation = get_target_orientation(monitor->orientation, command);
+        if ((monitor->model_flags & MODEL_FLAG_NO_ROTATE) && target_orientation != DMDO_DEFAULT &&
+            target_orientation != monitor->orientation) {
+            log_info("Skipping %s (%s): the model database marks it no-rotate", monitor->id, monitor->stable_id);
+            continue;
         }
 
-        if (should_process) {
-            batch_result.results[i] = rotate_monitor(monitor, command, dry_run);
-            if (batch_result.results[i].success) {
-                batch_result.success_count++;
-            } else {
-                batch_result.failure_count++;
-            }
-        } else {
-            // Monitor was filtered out, mark as successful (no-op)
-            batch_result.results[i].success = true;
-            batch_result.results[i].error_code = DISP_CHANGE_SUCCESSFUL;
-            batch_result.results[i].old_orientation = monitor->orientation;
-            batch_result.results[i].new_orientation = monitor->orientation;
+        RotationPlanEntry* entry = &plan->entries[plan->count];
+        entry->id = mem_strdup(allocator, monitor->id);
+        entry->device_path = mem_strdup(allocator, monitor->device_path);
+        entry->stable_id = mem_strdup(allocator, monitor->stable_id);
+        if (!entry->id || !entry->device_path || !entry->stable_id) {
+            mem_free(allocator, entry->id);
+            mem_free(allocator, entry->device_path);
+            mem_free(allocator, entry->stable_id);
+            free_rotation_plan(plan, allocator);
+            free(selected);
+            return NULL;
+        }
+
+        entry->current_orientation = monitor->orientation;
+        entry->current_width = monitor->width;
+        entry->current_height = monitor->height;
+        entry->target_orientation = target_orientation;
+        entry->target_width = monitor->width;
+        entry->target_height = monitor->height;
+
+        if (should_swap_dimensions(entry->current_orientation, entry->target_orientation)) {
+            entry->target_width = monitor->height;
+            entry->target_height = monitor->width;
         }
+
+        plan->count++;
     }
 
-    return batch_result;
+    free(selected);
+    return plan;
+}
+
+static LONG apply_display_settings(const char* device_path, DWORD orientation,
+                                   DWORD width, DWORD height) {
+    DEVMODEA devmode;
+    memset(&devmode, 0, sizeof(DEVMODEA));
+    devmode.dmSize = sizeof(DEVMODEA);
+
+    if (!EnumDisplaySettingsExA(device_path, ENUM_CURRENT_SETTINGS, &devmode, 0)) {
+        log_verbose("Failed to get current display settings for %s", device_path);
+        return DISP_CHANGE_BADMODE;
+    }
+
+    devmode.dmDisplayOrientation = orientation;
+    devmode.dmPelsWidth = width;
+    devmode.dmPelsHeight = height;
+    devmode.dmFields = DM_DISPLAYORIENTATION | DM_PELSWIDTH | DM_PELSHEIGHT;
+
+    return ChangeDisplaySettingsExA(device_path, &devmode, NULL,
+                                    CDS_UPDATEREGISTRY | CDS_GLOBAL, NULL);
 }
 
-// Rollback functionality
-RollbackState* create_rollback_state(const MonitorList* monitors) {
-    if (!monitors || monitors->count == 0) return NULL;
+static void set_change_states(HistoryEntry* change, const RotationPlanEntry* entry, bool rollback) {
+    change->old_orientation = rollback ? entry->target_orientation : entry->current_orientation;
+    change->old_width = rollback ? entry->target_width : entry->current_width;
+    change->old_height = rollback ? entry->target_height : entry->current_height;
+    change->new_orientation = rollback ? entry->current_orientation : entry->target_orientation;
+    change->new_width = rollback ? entry->current_width : entry->target_width;
+    change->new_height = rollback ? entry->current_height : entry->target_height;
+}
 
-    RollbackState* state = (RollbackState*)malloc(sizeof(RollbackState));
-    if (!state) return NULL;
+static bool is_cancelled(const ApplyOptions* options) {
+    return options && options->cancel_flag && ReadAcquire(options->cancel_flag) != 0;
+}
 
-    state->infos = (RollbackInfo*)malloc(monitors->count * sizeof(RollbackInfo));
-    if (!state->infos) {
-        free(state);
+// Dedicated apply thread. The job only records its changes; the caller
+// writes them to history afterwards, so the history file and its lock stay
+// off the time-critical thread.
+typedef struct {
+    const RotationPlan* plan;
+    const ApplyOptions* options;
+    const LogSink* log_sink;            // The caller's, so messages reach the same place
+    void (*run)(void* job);
+    BatchRotationResult result;
+    bool success;
+    HistoryEntry* changes;              // plan->count slots, NULL for dry runs
+    int change_count;
+} PlanJob;
+
+struct ApplyThread {
+    HANDLE handle;
+    CRITICAL_SECTION lock;
+    CONDITION_VARIABLE wake;            // A job was posted, or shutdown was set
+    CONDITION_VARIABLE done;            // The posted job finished
+    PlanJob* job;
+    bool shutdown;
+};
+
+static DWORD WINAPI apply_thread_main(LPVOID param) {
+    ApplyThread* thread = (ApplyThread*)param;
+
+    for (;;) {
+        EnterCriticalSection(&thread->lock);
+        while (!thread->job && !thread->shutdown) {
+            SleepConditionVariableCS(&thread->wake, &thread->lock, INFINITE);
+        }
+        PlanJob* job = thread->job;
+        LeaveCriticalSection(&thread->lock);
+        if (!job) return 0;
+
+        log_set_thread_sink(job->log_sink);
+        job->run(job);
+        log_set_thread_sink(NULL);
+
+        EnterCriticalSection(&thread->lock);
+        thread->job = NULL;
+        WakeAllConditionVariable(&thread->done);
+        LeaveCriticalSection(&thread->lock);
+    }
+}
+
+ApplyThread* apply_thread_create(int priority, DWORD_PTR affinity_mask) {
+    ApplyThread* thread = (ApplyThread*)calloc(1, sizeof(ApplyThread));
+    if (!thread) return NULL;
+
+    InitializeCriticalSection(&thread->lock);
+    InitializeConditionVariable(&thread->wake);
+    InitializeConditionVariable(&thread->done);
+    thread->handle = CreateThread(NULL, 0, apply_thread_main, thread, CREATE_SUSPENDED, NULL);
+    if (!thread->handle) {
+        log_verbose("Failed to start apply thread (error %lu)", GetLastError());
+        DeleteCriticalSection(&thread->lock);
+        free(thread);
         return NULL;
     }
 
-    state->count = 0;
+    // Set while suspended, so none of the loop runs at normal priority
+    if (!SetThreadPriority(thread->handle, priority)) {
+        log_verbose("Failed to set apply thread priority %d (error %lu)", priority, GetLastError());
+    }
+    if (affinity_mask && !SetThreadAffinityMask(thread->handle, affinity_mask)) {
+        log_verbose("Failed to set apply thread affinity 0x%llx (error %lu)",
+                    (unsigned long long)affinity_mask, GetLastError());
+    }
+    ResumeThread(thread->handle);
+    return thread;
+}
+
+void apply_thread_destroy(ApplyThread* thread) {
+    if (!thread) return;
 
-    for (int i = 0; i < monitors->count; i++) {
-        const MonitorInfo* monitor = &monitors->monitors[i];
+    EnterCriticalSection(&thread->lock);
+    thread->shutdown = true;
+    WakeAllConditionVariable(&thread->wake);
+    LeaveCriticalSection(&thread->lock);
 
-        // Get current display settings
-        DEVMODEA devmode;
-        memset(&devmode, 0, sizeof(DEVMODEA));
-        devmode.dmSize = sizeof(DEVMODEA);
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+    DeleteCriticalSection(&thread->lock);
+    free(thread);
+}
 
-        if (!EnumDisplaySettingsExA(monitor->device_path, ENUM_CURRENT_SETTINGS, &devmode, 0)) {
-            log_verbose("Failed to get current settings for rollback: %s", monitor->device_path);
+// Runs job->run on the thread ApplyOptions.scheduling names, or inline
+static void run_plan_job(PlanJob* job) {
+    ApplyThread* thread = job->options ? job->options->scheduling.thread : NULL;
+    if (!thread) {
+        job->run(job);
+        return;
+    }
+
+    job->log_sink = log_get_thread_sink();
+    EnterCriticalSection(&thread->lock);
+    thread->job = job;
+    WakeAllConditionVariable(&thread->wake);
+    while (thread->job == job) {
+        SleepConditionVariableCS(&thread->done, &thread->lock, INFINITE);
+    }
+    LeaveCriticalSection(&thread->lock);
+}
+
+// Allocates the job's change records, on the calling thread
+static void alloc_plan_changes(PlanJob* job) {
+    bool dry_run = job->options && job->options->dry_run;
+    job->changes = dry_run ? NULL : (HistoryEntry*)malloc(job->plan->count * sizeof(HistoryEntry));
+    job->change_count = 0;
+    if (!dry_run && !job->changes) {
+        log_error("Failed to allocate memory for history; these changes will not be recorded");
+    }
+}
+
+// Records the job's changes once it has finished, on the calling thread
+static void record_plan_changes(PlanJob* job) {
+    history_append(job->changes, job->change_count);
+    free(job->changes);
+    job->changes = NULL;
+    job->change_count = 0;
+}
+
+// Fills changes (when not NULL) with a record per display change
+static BatchRotationResult apply_plan_entries(const RotationPlan* plan, const ApplyOptions* options,
+                                              HistoryEntry* changes, int* out_change_count) {
+    BatchRotationResult batch_result = { 0, 0, NULL, 0 };
+    bool dry_run = options && options->dry_run;
+    const MosDefAllocator* allocator = options ? options->allocator : NULL;
+
+    if (!plan || plan->count == 0) {
+        return batch_result;
+    }
+
+    batch_result.results = (RotationResult*)mem_alloc(allocator, plan->count * sizeof(RotationResult));
+    if (!batch_result.results) {
+        log_error("Failed to allocate memory for rotation results");
+        return batch_result;
+    }
+
+    int change_count = 0;
+    for (int i = 0; i < plan->count; i++) {
+        const RotationPlanEntry* entry = &plan->entries[i];
+        RotationResult* result = &batch_result.results[i];
+
+        result->old_orientation = entry->current_orientation;
+        result->new_orientation = entry->target_orientation;
+
+        if (is_cancelled(options)) {
+            result->success = false;
+            result->error_code = DISP_CHANGE_SUCCESSFUL;
+            result->new_orientation = entry->current_orientation;
+            batch_result.cancelled_count++;
             continue;
         }
 
-        RollbackInfo* info = &state->infos[state->count];
-        info->device_path = _strdup(monitor->device_path);
-        info->original_orientation = devmode.dmDisplayOrientation;
-        info->original_width = devmode.dmPelsWidth;
-        info->original_height = devmode.dmPelsHeight;
-
-        if (!info->device_path) {
+        if (dry_run) {
+            log_info("[DRY RUN] Would rotate %s from %s to %s", entry->id,
+                    get_orientation_string(entry->current_orientation),
+                    get_orientation_string(entry->target_orientation));
+            result->success = true;
+            result->error_code = DISP_CHANGE_SUCCESSFUL;
+            batch_result.success_count++;
             continue;
         }
 
-        state->count++;
-    }
+        log_verbose("Rotating monitor %s (%s) from %s to %s",
+                   entry->id, entry->device_path,
+                   get_orientation_string(entry->current_orientation),
+                   get_orientation_string(entry->target_orientation));
+
+        HistoryEntry change;
+        LONG64 started = history_begin(&change, HISTORY_ROTATE, entry->device_path, entry->stable_id);
+        result->error_code = apply_display_settings(entry->device_path, entry->target_orientation,
+                                                    entry->target_width, entry->target_height);
+        result->success = (result->error_code == DISP_CHANGE_SUCCESSFUL);
+        if (changes) {
+            history_finish(&change, started, result->error_code);
+            set_change_states(&change, entry, false);
+            changes[change_count++] = change;
+        }
 
-    if (state->count == 0) {
-        free_rollback_state(state);
-        return NULL;
+        if (result->success) {
+            log_verbose("Successfully rotated monitor %s", entry->id);
+            batch_result.success_count++;
+        } else {
+            log_error("Failed to rotate monitor %s: error code %ld", entry->id, result->error_code);
+            log_change_error_detail(result->error_code);
+            batch_result.failure_count++;
+        }
     }
 
-    return state;
+    *out_change_count = change_count;
+    return batch_result;
 }
 
-bool rollback_monitors(const RollbackState* rollback_state, bool dry_run) {
-    if (!rollback_state || rollback_state->count == 0) return true;
+static void apply_plan_job(void* param) {
+    PlanJob* job = (PlanJob*)param;
+    job->result = apply_plan_entries(job->plan, job->options, job->changes, &job->change_count);
+}
 
-    bool all_successful = true;
+BatchRotationResult apply_rotation_plan(const RotationPlan* plan, const ApplyOptions* options) {
+    BatchRotationResult empty = { 0, 0, NULL, 0 };
+    if (!plan || plan->count == 0) {
+        return empty;
+    }
 
-    for (int i = 0; i < rollback_state->count; i++) {
-        const RollbackInfo* info = &rollback_state->infos[i];
+    PlanJob job = { plan, options, NULL, apply_plan_job, { 0, 0, NULL, 0 }, false, NULL, 0 };
+    alloc_plan_changes(&job);
+    run_plan_job(&job);
+    record_plan_changes(&job);
+    return job.result;
+}
+
+static bool rollback_plan_entries(const RotationPlan* plan, const ApplyOptions* options,
+                                  HistoryEntry* changes, int* out_change_count) {
+    bool dry_run = options && options->dry_run;
+    bool all_successful = true;
+    int change_count = 0;
 
-        // Get current display settings
-        DEVMODEA devmode;
-        memset(&devmode, 0, sizeof(DEVMODEA));
-        devmode.dmSize = sizeof(DEVMODEA);
+    for (int i = 0; i < plan->count; i++) {
+        const RotationPlanEntry* entry = &plan->entries[i];
 
-        if (!EnumDisplaySettingsExA(info->device_path, ENUM_CURRENT_SETTINGS, &devmode, 0)) {
-            log_error("Failed to get current settings for rollback of %s", info->device_path);
+        if (is_cancelled(options)) {
+            log_verbose("Rollback cancelled before %s", entry->device_path);
             all_successful = false;
-            continue;
+            break;
         }
 
-        log_verbose("Rolling back %s from %s to %s",
-                   info->device_path,
-                   get_orientation_string(devmode.dmDisplayOrientation),
-                   get_orientation_string(info->original_orientation));
-
         if (dry_run) {
-            log_info("[DRY RUN] Would rollback %s to %s", info->device_path,
-                    get_orientation_string(info->original_orientation));
+            log_info("[DRY RUN] Would rollback %s to %s", entry->device_path,
+                    get_orientation_string(entry->current_orientation));
             continue;
         }
 
-        // Prepare rollback settings
-        DEVMODEA rollback_devmode = devmode;
-        rollback_devmode.dmDisplayOrientation = info->original_orientation;
-        rollback_devmode.dmPelsWidth = info->original_width;
-        rollback_devmode.dmPelsHeight = info->original_height;
-        rollback_devmode.dmFields = DM_DISPLAYORIENTATION | DM_PELSWIDTH | DM_PELSHEIGHT;
-
-        LONG result = ChangeDisplaySettingsExA(info->device_path, &rollback_devmode, NULL,
-                                              CDS_UPDATEREGISTRY | CDS_GLOBAL, NULL);
+        HistoryEntry change;
+        LONG64 started = history_begin(&change, HISTORY_ROLLBACK, entry->device_path, entry->stable_id);
+        LONG result = apply_display_settings(entry->device_path, entry->current_orientation,
+                                             entry->current_width, entry->current_height);
+        if (changes) {
+            history_finish(&change, started, result);
+            set_change_states(&change, entry, true);
+            changes[change_count++] = change;
+        }
 
         if (result != DISP_CHANGE_SUCCESSFUL) {
-            log_error("Failed to rollback monitor %s: error %ld", info->device_path, result);
+            log_error("Failed to rollback monitor %s: error %ld", entry->device_path, result);
             all_successful = false;
         } else {
-            log_verbose("Successfully rolled back monitor %s", info->device_path);
+            log_verbose("Successfully rolled back monitor %s", entry->device_path);
         }
     }
 
+    *out_change_count = change_count;
     return all_successful;
 }
 
-void free_rollback_state(RollbackState* state) {
-    if (!state) return;
+static void rollback_plan_job(void* param) {
+    PlanJob* job = (PlanJob*)param;
+    job->success = rollback_plan_entries(job->plan, job->options, job->changes, &job->change_count);
+}
+
+bool rollback_rotation_plan(const RotationPlan* plan, const ApplyOptions* options) {
+    if (!plan || plan->count == 0) return true;
+
+    PlanJob job = { plan, options, NULL, rollback_plan_job, { 0, 0, NULL, 0 }, false, NULL, 0 };
+    alloc_plan_changes(&job);
+    run_plan_job(&job);
+    record_plan_changes(&job);
+    return job.success;
+}
+
+void free_rotation_plan(RotationPlan* plan, const MosDefAllocator* allocator) {
+    if (!plan) return;
 
-    for (int i = 0; i < state->count; i++) {
-        free(state->infos[i].device_path);
+    for (int i = 0; i < plan->count; i++) {
+        mem_free(allocator, plan->entries[i].id);
+        mem_free(allocator, plan->entries[i].device_path);
+        mem_free(allocator, plan->entries[i].stable_id);
+    }
+    mem_free(allocator, plan->entries);
+    mem_free(allocator, plan);
+}
+
+const char* get_rotation_command_name(RotationCommand command) {
+    switch (command) {
+        case ROTATION_LANDSCAPE: return "landscape";
+        case ROTATION_PORTRAIT:  return "portrait";
+        case ROTATION_TOGGLE:    return "toggle";
+        default:                 return "unknown";
     }
-    free(state->infos);
-    free(state);
 }
 
 // Orientation utilities
@@ -20,38 +20,80 @@ typedef struct {
     DWORD new_orientation;
 } RotationResult;
 
-// Single monitor rotation
-RotationResult rotate_monitor(const MonitorInfo* monitor, RotationCommand command, bool dry_run);
-
-// Batch rotation with selector filtering
+// Results of applying a plan, one per entry
 typedef struct {
     int success_count;
     int failure_count;
     RotationResult* results;
+    int cancelled_count;    // Plan entries skipped after cancellation
 } BatchRotationResult;
 
-BatchRotationResult rotate_monitors_filtered(const MonitorList* monitors,
-                                           RotationCommand command,
-                                           const SelectorList* include_selectors,
-                                           const SelectorList* exclude_selectors,
-                                           bool dry_run);
+// Sets the bit (MONITOR_BITSET_*) of every monitor matching any selector in
+// the list. M# and edid: selectors are looked up through the monitor index,
+// name:/model: are tested per distinct name, device: and native: scan the
+// monitor table's columns and group: ORs in the group's cached membership.
+// Returns false if a group cannot be resolved.
+bool select_monitors(const MonitorList* monitors, const SelectorList* selectors, ULONG64* bits);
+
+// Resolves selectors for every monitor at once into a caller-freed bool array,
+// include & ~exclude over bitsets. NULL on failure, including a bad group.
+bool* resolve_selection(const MonitorList* monitors,
+                        const SelectorList* include_selectors,
+                        const SelectorList* exclude_selectors);
 
-// Rollback functionality
+// Rotation plans: resolved monitors with their current and target settings
 typedef struct {
+    char* id;
     char* device_path;
-    DWORD original_orientation;
-    DWORD original_width;
-    DWORD original_height;
-} RollbackInfo;
+    char* stable_id;
+    DWORD current_orientation;
+    DWORD current_width;
+    DWORD current_height;
+    DWORD target_orientation;
+    DWORD target_width;
+    DWORD target_height;
+} RotationPlanEntry;
 
 typedef struct {
-    RollbackInfo* infos;
+    RotationCommand command;
+    RotationPlanEntry* entries;
     int count;
-} RollbackState;
+    ULONG64 topology_fingerprint;   // Topology the selectors were resolved against
+    ULONG64 display_fingerprint;    // Same topology, EDID-free (see read_display_fingerprint)
+} RotationPlan;
+
+// A long-lived thread for modeset loops, owned by one caller (a context)
+// that submits one plan at a time. It starts at priority (THREAD_PRIORITY_*)
+// and, when affinity_mask is non-zero, pinned to those CPUs; both are set
+// before it first runs. Destroy joins it.
+typedef struct ApplyThread ApplyThread;
+
+ApplyThread* apply_thread_create(int priority, DWORD_PTR affinity_mask);
+void apply_thread_destroy(ApplyThread* thread);
+
+// Where the modeset loop runs. With thread set, apply and rollback run on it
+// while the caller waits. Results, logging and history are the same as
+// inline.
+typedef struct {
+    ApplyThread* thread;
+} ApplyScheduling;
+
+typedef struct {
+    bool dry_run;
+    const MosDefAllocator* allocator;   // Owns BatchRotationResult.results (NULL = CRT heap)
+    volatile LONG* cancel_flag;         // Checked before each monitor when non-NULL
+    ApplyScheduling scheduling;         // Zeroed = inline on the calling thread
+} ApplyOptions;
 
-RollbackState* create_rollback_state(const MonitorList* monitors);
-bool rollback_monitors(const RollbackState* rollback_state, bool dry_run);
-void free_rollback_state(RollbackState* state);
+RotationPlan* build_rotation_plan(const MonitorList* monitors,
+                                  RotationCommand command,
+                                  const SelectorList* include_selectors,
+                                  const SelectorList* exclude_selectors,
+                                  const MosDefAllocator* allocator);
+BatchRotationResult apply_rotation_plan(const RotationPlan* plan, const ApplyOptions* options);
+bool rollback_rotation_plan(const RotationPlan* plan, const ApplyOptions* options);
+void free_rotation_plan(RotationPlan* plan, const MosDefAllocator* allocator);
+const char* get_rotation_command_name(RotationCommand command);
 
 // Orientation utilities
 DWORD get_target_orientation(DWORD current_orientation, RotationCommand command);
@@ -0,0 +1,211 @@
+#include "screen.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Unchanged cells shorter than a cursor move are rewritten instead of skipped
+#define SCREEN_MERGE_GAP 4
+
+static bool allocate_buffers(Screen* screen, int width, int height) {
+    size_t cells = (size_t)width * height;
+
+    char* chars = (char*)malloc(cells);
+    BYTE* attrs = (BYTE*)malloc(cells);
+    char* front_chars = (char*)malloc(cells);
+    BYTE* front_attrs = (BYTE*)malloc(cells);
+    if (!chars || !attrs || !front_chars || !front_attrs) {
+        free(chars);
+        free(attrs);
+        free(front_chars);
+        free(front_attrs);
+        return false;
+    }
+
+    free(screen->chars);
+    free(screen->attrs);
+    free(screen->front_chars);
+    free(screen->front_attrs);
+
+    screen->chars = chars;
+    screen->attrs = attrs;
+    screen->front_chars = front_chars;
+    screen->front_attrs = front_attrs;
+    screen->width = width;
+    screen->height = height;
+    screen->full_redraw = true;
+
+    screen_clear(screen);
+    return true;
+}
+
+Screen* screen_create(int width, int height) {
+    if (width <= 0 || height <= 0) return NULL;
+
+    Screen* screen = (Screen*)calloc(1, sizeof(Screen));
+    if (!screen) return NULL;
+
+    if (!allocate_buffers(screen, width, height)) {
+        free(screen);
+        return NULL;
+    }
+    return screen;
+}
+
+void screen_destroy(Screen* screen) {
+    if (!screen) return;
+
+    free(screen->chars);
+    free(screen->attrs);
+    free(screen->front_chars);
+    free(screen->front_attrs);
+    free(screen->output);
+    free(screen);
+}
+
+bool screen_resize(Screen* screen, int width, int height) {
+    if (!screen || width <= 0 || height <= 0) return false;
+    if (width == screen->width && height == screen->height) return true;
+    return allocate_buffers(screen, width, height);
+}
+
+// Drawing
+void screen_clear(Screen* screen) {
+    size_t cells = (size_t)screen->width * screen->height;
+    memset(screen->chars, ' ', cells);
+    memset(screen->attrs, SCREEN_ATTR_NORMAL, cells);
+}
+
+void screen_put(Screen* screen, int row, int col, const char* text, BYTE attr) {
+    if (!screen || !text || row < 0 || row >= screen->height || col < 0) return;
+
+    size_t index = (size_t)row * screen->width + col;
+    for (const unsigned char* p = (const unsigned char*)text; *p && col < screen->width; p++, col++, index++) {
+        screen->chars[index] = (*p >= 0x20 && *p < 0x7F) ? (char)*p : '?';
+        screen->attrs[index] = attr;
+    }
+}
+
+void screen_put_line(Screen* screen, int row, const char* text, BYTE attr) {
+    if (!screen || row < 0 || row >= screen->height) return;
+
+    size_t start = (size_t)row * screen->width;
+    memset(screen->chars + start, ' ', screen->width);
+    memset(screen->attrs + start, attr, screen->width);
+    screen_put(screen, row, 0, text, attr);
+}
+
+// Output
+static bool reserve_output(Screen* screen, size_t extra) {
+    if (screen->output_length + extra <= screen->output_capacity) return true;
+
+    size_t capacity = screen->output_capacity ? screen->output_capacity : 4096;
+    while (capacity < screen->output_length + extra) {
+        capacity *= 2;
+    }
+
+    char* output = (char*)realloc(screen->output, capacity);
+    if (!output) return false;
+
+    screen->output = output;
+    screen->output_capacity = capacity;
+    return true;
+}
+
+static void append_output(Screen* screen, const char* data, size_t size) {
+    if (!reserve_output(screen, size)) {
+        screen->full_redraw = true; // Frame is incomplete; repaint everything next time
+        return;
+    }
+    memcpy(screen->output + screen->output_length, data, size);
+    screen->output_length += size;
+}
+
+static void append_cursor_move(Screen* screen, int row, int col) {
+    char sequence[24];
+    int len = sprintf_s(sequence, sizeof(sequence), "\x1b[%d;%dH", row + 1, col + 1);
+    append_output(screen, sequence, (size_t)len);
+}
+
+static void append_attr(Screen* screen, BYTE attr) {
+    switch (attr) {
+        case SCREEN_ATTR_BOLD:                        append_output(screen, "\x1b[0;1m", 6); break;
+        case SCREEN_ATTR_REVERSE:                     append_output(screen, "\x1b[0;7m", 6); break;
+        case SCREEN_ATTR_BOLD | SCREEN_ATTR_REVERSE:  append_output(screen, "\x1b[0;1;7m", 8); break;
+        default:                                      append_output(screen, "\x1b[0m", 4); break;
+    }
+}
+
+static bool cell_changed(const Screen* screen, size_t index) {
+    return screen->chars[index] != screen->front_chars[index] ||
+           screen->attrs[index] != screen->front_attrs[index];
+}
+
+size_t screen_flush(Screen* screen, ScreenWriteFn write, void* user_data) {
+    if (!screen || !write) return 0;
+
+    screen->output_length = 0;
+    int current_attr = -1;      // Unknown until the first attribute is emitted
+    int cursor_row = -1;
+    int cursor_col = -1;
+
+    if (screen->full_redraw) {
+        append_output(screen, "\x1b[0m\x1b[2J", 8);
+        current_attr = SCREEN_ATTR_NORMAL;
+
+        // A cleared terminal shows blanks; only non-blank cells need writing
+        size_t cells = (size_t)screen->width * screen->height;
+        memset(screen->front_chars, ' ', cells);
+        memset(screen->front_attrs, SCREEN_ATTR_NORMAL, cells);
+        screen->full_redraw = false;
+    }
+
+    for (int row = 0; row < screen->height; row++) {
+        size_t row_start = (size_t)row * screen->width;
+        int col = 0;
+
+        while (col < screen->width) {
+            if (!cell_changed(screen, row_start + col)) {
+                col++;
+                continue;
+            }
+
+            // Extend the run across short unchanged gaps
+            int last_changed = col;
+            for (int next = col + 1; next < screen->width && next - last_changed <= SCREEN_MERGE_GAP; next++) {
+                if (cell_changed(screen, row_start + next)) {
+                    last_changed = next;
+                }
+            }
+
+            if (cursor_row != row || cursor_col != col) {
+                append_cursor_move(screen, row, col);
+            }
+
+            for (int c = col; c <= last_changed; c++) {
+                size_t index = row_start + c;
+                if (screen->attrs[index] != current_attr) {
+                    append_attr(screen, screen->attrs[index]);
+                    current_attr = screen->attrs[index];
+                }
+                append_output(screen, &screen->chars[index], 1);
+            }
+
+            cursor_row = row;
+            cursor_col = last_changed + 1;
+            col = last_changed + 1;
+        }
+    }
+
+    if (screen->output_length == 0) return 0;
+
+    if (current_attr != SCREEN_ATTR_NORMAL) {
+        append_attr(screen, SCREEN_ATTR_NORMAL);
+    }
+
+    size_t cells = (size_t)screen->width * screen->height;
+    memcpy(screen->front_chars, screen->chars, cells);
+    memcpy(screen->front_attrs, screen->attrs, cells);
+
+    write(screen->output, screen->output_length, user_data);
+    return screen->output_length;
+}
@@ -0,0 +1,46 @@
+#ifndef SCREEN_H
+#define SCREEN_H
+
+#include <windows.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Cell attributes
+#define SCREEN_ATTR_NORMAL  0x00
+#define SCREEN_ATTR_BOLD    0x01
+#define SCREEN_ATTR_REVERSE 0x02
+
+// Double-buffered character grid. Callers draw a complete frame into the
+// back buffer; screen_flush compares it with what the terminal already shows
+// and emits VT sequences only for cells that changed, as a single write.
+typedef struct {
+    int width;
+    int height;
+    char* chars;            // Back buffer, drawn by the caller
+    BYTE* attrs;
+    char* front_chars;      // What the terminal currently shows
+    BYTE* front_attrs;
+    bool full_redraw;       // Front buffer is unknown (new or resized)
+
+    char* output;           // Frame output, reused between flushes
+    size_t output_length;
+    size_t output_capacity;
+} Screen;
+
+typedef void (*ScreenWriteFn)(const char* data, size_t size, void* user_data);
+
+Screen* screen_create(int width, int height);
+void screen_destroy(Screen* screen);
+bool screen_resize(Screen* screen, int width, int height);
+
+// Drawing into the back buffer. Text is clipped to the grid; bytes outside
+// printable ASCII are drawn as '?'.
+void screen_clear(Screen* screen);
+void screen_put(Screen* screen, int row, int col, const char* text, BYTE attr);
+void screen_put_line(Screen* screen, int row, const char* text, BYTE attr); // Pads to full width
+
+// Emits the difference since the last flush with one call to write.
+// Returns the number of bytes written (0 when nothing changed).
+size_t screen_flush(Screen* screen, ScreenWriteFn write, void* user_data);
+
+#endif // SCREEN_H
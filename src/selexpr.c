@@ -0,0 +1,1135 @@
+#include "selexpr.h"
+#include "modeldb.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+#include <stdint.h>
+
+// Programs run on a single boolean accumulator. A test instruction loads the
+// result of one attribute comparison; && and || compile to conditional jumps
+// that leave the accumulator as the result, so evaluation short-circuits
+// without a stack:
+//
+//   a && b || !c    TEST a; JUMP_IF_FALSE 3; TEST b; JUMP_IF_TRUE 6; TEST c; NOT; END
+
+typedef enum {
+    ATTR_ID,
+    ATTR_NAME,
+    ATTR_DEVICE,
+    ATTR_EDID,
+    ATTR_MODEL,
+    ATTR_FIRST_NUMBER,
+    ATTR_WIDTH = ATTR_FIRST_NUMBER,
+    ATTR_HEIGHT,
+    ATTR_ORIENTATION,
+    ATTR_X,
+    ATTR_Y,
+    ATTR_REFRESH,
+    ATTR_NATIVE_WIDTH,
+    ATTR_NATIVE_HEIGHT,
+    ATTR_WIDTH_MM,
+    ATTR_HEIGHT_MM,
+    ATTR_PREFERRED,
+    ATTR_SLOW_MODESET,
+    ATTR_REFRESH_RESET,
+    ATTR_NO_ROTATE
+} SelectorAttribute;
+
+static const struct {
+    const char* name;
+    SelectorAttribute attribute;
+} g_attributes[] = {
+    { "id", ATTR_ID },
+    { "name", ATTR_NAME },
+    { "device", ATTR_DEVICE },
+    { "edid", ATTR_EDID },
+    { "model", ATTR_MODEL },
+    { "width", ATTR_WIDTH },
+    { "height", ATTR_HEIGHT },
+    { "orientation", ATTR_ORIENTATION },
+    { "x", ATTR_X },
+    { "y", ATTR_Y },
+    { "refresh", ATTR_REFRESH },
+    { "native_width", ATTR_NATIVE_WIDTH },
+    { "native_height", ATTR_NATIVE_HEIGHT },
+    { "width_mm", ATTR_WIDTH_MM },
+    { "height_mm", ATTR_HEIGHT_MM },
+    { "preferred", ATTR_PREFERRED },
+    { "slow_modeset", ATTR_SLOW_MODESET },
+    { "refresh_reset", ATTR_REFRESH_RESET },
+    { "no_rotate", ATTR_NO_ROTATE }
+};
+
+typedef enum {
+    CMP_EQ,
+    CMP_NE,
+    CMP_LT,
+    CMP_LE,
+    CMP_GT,
+    CMP_GE,
+    CMP_MATCH,
+    CMP_NOT_MATCH
+} SelectorCompare;
+
+typedef enum {
+    OP_TEST,            // acc = attribute <compare> operand
+    OP_CONST,           // acc = operand
+    OP_NOT,
+    OP_JUMP_IF_FALSE,   // operand is the target instruction
+    OP_JUMP_IF_TRUE,
+    OP_END
+} SelectorOpcode;
+
+typedef struct {
+    BYTE opcode;
+    BYTE attribute;
+    BYTE compare;
+    BYTE reserved;
+    LONG operand;       // Number, string or DFA index, jump target
+} SelectorInstruction;
+
+// DFA over byte equivalence classes. Case folding is applied to the byte
+// sets at compile time, so matching is a table walk on the raw text.
+typedef struct {
+    BYTE classes[256];
+    int class_count;
+    int state_count;
+    int start;
+    int dead;           // State with no way to accept, -1 if none
+    bool anchored_end;
+    bool* accepting;
+    WORD* transitions;  // state_count * class_count
+} SelectorDfa;
+
+struct SelectorProgram {
+    volatile LONG refs;
+    char* source;
+    ULONG64 hash;
+    SelectorInstruction* code;
+    int code_count;
+    char** strings;
+    int string_count;
+    SelectorDfa* dfas;
+    int dfa_count;
+};
+
+// Regular expressions: literals, ., [classes] with ranges and negation,
+// \d \w \s \D \W \S, * + ?, | and groups, with ^ and $ only at the ends.
+// Thompson NFA, then subset construction; both are bounded.
+
+#define REGEX_MAX_NFA_STATES 256
+#define REGEX_MAX_DFA_STATES 1024
+#define NFA_SET_WORDS (REGEX_MAX_NFA_STATES / 64)
+
+typedef struct {
+    ULONG64 bits[4];
+} ByteSet;
+
+typedef struct {
+    ULONG64 bits[NFA_SET_WORDS];
+} NfaSet;
+
+typedef enum {
+    NFA_BYTES,
+    NFA_SPLIT,
+    NFA_EMPTY,
+    NFA_MATCH
+} NfaKind;
+
+typedef struct {
+    NfaKind kind;
+    ByteSet set;
+    int out;
+    int out1;
+} NfaState;
+
+// Dangling exits are threaded through the unset out fields themselves:
+// (state << 1) | (0 for out, 1 for out1), terminated by -1
+typedef struct {
+    int start;
+    int exits;
+} NfaFragment;
+
+typedef struct {
+    const char* pattern;
+    size_t pos;
+    size_t end;
+    NfaState states[REGEX_MAX_NFA_STATES];
+    int count;
+    const char* error;
+    int depth;                  // Open groups
+    size_t top_level_bar;       // First | outside any group, or SIZE_MAX
+} RegexCompiler;
+
+static void byteset_add(ByteSet* set, BYTE value) {
+    set->bits[value >> 6] |= 1ULL << (value & 63);
+}
+
+static bool byteset_has(const ByteSet* set, BYTE value) {
+    return (set->bits[value >> 6] >> (value & 63)) & 1;
+}
+
+static void byteset_add_folded(ByteSet* set, BYTE value) {
+    byteset_add(set, value);
+    byteset_add(set, (BYTE)tolower(value));
+    byteset_add(set, (BYTE)toupper(value));
+}
+
+static void byteset_add_escape_class(ByteSet* set, char escape) {
+    ByteSet class_set = { { 0, 0, 0, 0 } };
+    char lower = (char)tolower((unsigned char)escape);
+    for (int b = 0; b < 256; b++) {
+        bool member = (lower == 'd' && isdigit(b)) ||
+                      (lower == 'w' && (isalnum(b) || b == '_')) ||
+                      (lower == 's' && isspace(b));
+        if (member) byteset_add(&class_set, (BYTE)b);
+    }
+    for (int i = 0; i < 4; i++) {
+        set->bits[i] |= isupper((unsigned char)escape) ? ~class_set.bits[i] : class_set.bits[i];
+    }
+}
+
+static bool is_escape_class(char c) {
+    return strchr("dwsDWS", c) != NULL && c != '\0';
+}
+
+static int nfa_add(RegexCompiler* compiler, NfaKind kind) {
+    if (compiler->count >= REGEX_MAX_NFA_STATES) {
+        compiler->error = "pattern is too complex";
+        return -1;
+    }
+    NfaState* state = &compiler->states[compiler->count];
+    memset(state, 0, sizeof(*state));
+    state->kind = kind;
+    state->out = -1;
+    state->out1 = -1;
+    return compiler->count++;
+}
+
+static int* nfa_exit_slot(RegexCompiler* compiler, int exit) {
+    NfaState* state = &compiler->states[exit >> 1];
+    return (exit & 1) ? &state->out1 : &state->out;
+}
+
+static void nfa_patch(RegexCompiler* compiler, int exits, int target) {
+    while (exits != -1) {
+        int* slot = nfa_exit_slot(compiler, exits);
+        exits = *slot;
+        *slot = target;
+    }
+}
+
+static int nfa_append(RegexCompiler* compiler, int first, int second) {
+    if (first == -1) return second;
+    int exit = first;
+    while (*nfa_exit_slot(compiler, exit) != -1) {
+        exit = *nfa_exit_slot(compiler, exit);
+    }
+    *nfa_exit_slot(compiler, exit) = second;
+    return first;
+}
+
+static char regex_peek(const RegexCompiler* compiler) {
+    return compiler->pos < compiler->end ? compiler->pattern[compiler->pos] : '\0';
+}
+
+static bool regex_alternation(RegexCompiler* compiler, NfaFragment* out);
+
+static bool regex_bytes(RegexCompiler* compiler, const ByteSet* set, NfaFragment* out) {
+    int state = nfa_add(compiler, NFA_BYTES);
+    if (state < 0) return false;
+    compiler->states[state].set = *set;
+    out->start = state;
+    out->exits = state << 1;
+    return true;
+}
+
+static bool regex_class(RegexCompiler* compiler, NfaFragment* out) {
+    ByteSet set = { { 0, 0, 0, 0 } };
+    bool negate = false;
+
+    compiler->pos++; // [
+    if (regex_peek(compiler) == '^') {
+        negate = true;
+        compiler->pos++;
+    }
+
+    bool first = true;
+    while (compiler->pos < compiler->end && (first || regex_peek(compiler) != ']')) {
+        first = false;
+        char c = compiler->pattern[compiler->pos++];
+        if (c == '\\' && compiler->pos < compiler->end) {
+            c = compiler->pattern[compiler->pos++];
+            if (is_escape_class(c)) {
+                byteset_add_escape_class(&set, c);
+                continue;
+            }
+        }
+
+        BYTE low = (BYTE)c;
+        BYTE high = low;
+        if (regex_peek(compiler) == '-' && compiler->pos + 1 < compiler->end &&
+            compiler->pattern[compiler->pos + 1] != ']') {
+            compiler->pos++;
+            char h = compiler->pattern[compiler->pos++];
+            if (h == '\\' && compiler->pos < compiler->end) {
+                h = compiler->pattern[compiler->pos++];
+            }
+            high = (BYTE)h;
+            if (high < low) {
+                compiler->error = "character range is out of order";
+                return false;
+            }
+        }
+        for (int b = low; b <= high; b++) {
+            byteset_add_folded(&set, (BYTE)b);
+        }
+    }
+
+    if (regex_peek(compiler) != ']') {
+        compiler->error = "missing ]";
+        return false;
+    }
+    compiler->pos++;
+
+    if (negate) {
+        for (int i = 0; i < 4; i++) {
+            set.bits[i] = ~set.bits[i];
+        }
+    }
+    return regex_bytes(compiler, &set, out);
+}
+
+static bool regex_atom(RegexCompiler* compiler, NfaFragment* out) {
+    ByteSet set = { { 0, 0, 0, 0 } };
+    char c = regex_peek(compiler);
+
+    switch (c) {
+        case '(':
+            compiler->pos++;
+            compiler->depth++;
+            if (!regex_alternation(compiler, out)) return false;
+            compiler->depth--;
+            if (regex_peek(compiler) != ')') {
+                compiler->error = "missing )";
+                return false;
+            }
+            compiler->pos++;
+            return true;
+
+        case '[':
+            return regex_class(compiler, out);
+
+        case '.':
+            compiler->pos++;
+            memset(&set, 0xFF, sizeof(set));
+            return regex_bytes(compiler, &set, out);
+
+        case '*':
+        case '+':
+        case '?':
+            compiler->error = "nothing to repeat";
+            return false;
+
+        case '^':
+        case '$':
+            compiler->error = "^ and $ are only supported at the start and end of a pattern";
+            return false;
+
+        case '{':
+            compiler->error = "{n,m} repetition is not supported; escape { to match it";
+            return false;
+
+        case '\\':
+            compiler->pos++;
+            if (compiler->pos >= compiler->end) {
+                compiler->error = "trailing backslash";
+                return false;
+            }
+            c = compiler->pattern[compiler->pos++];
+            if (is_escape_class(c)) {
+                byteset_add_escape_class(&set, c);
+            } else {
+                byteset_add_folded(&set, (BYTE)c);
+            }
+            return regex_bytes(compiler, &set, out);
+
+        default:
+            compiler->pos++;
+            byteset_add_folded(&set, (BYTE)c);
+            return regex_bytes(compiler, &set, out);
+    }
+}
+
+static bool regex_repeat(RegexCompiler* compiler, NfaFragment* out) {
+    if (!regex_atom(compiler, out)) return false;
+
+    for (;;) {
+        char c = regex_peek(compiler);
+        if (c != '*' && c != '+' && c != '?') return true;
+        compiler->pos++;
+
+        int split = nfa_add(compiler, NFA_SPLIT);
+        if (split < 0) return false;
+        compiler->states[split].out = out->start;
+
+        if (c == '*') {
+            nfa_patch(compiler, out->exits, split);
+            out->start = split;
+            out->exits = (split << 1) | 1;
+        } else if (c == '+') {
+            nfa_patch(compiler, out->exits, split);
+            out->exits = (split << 1) | 1;
+        } else {
+            out->start = split;
+            out->exits = nfa_append(compiler, out->exits, (split << 1) | 1);
+        }
+    }
+}
+
+static bool regex_concat(RegexCompiler* compiler, NfaFragment* out) {
+    bool empty = true;
+
+    while (compiler->pos < compiler->end && regex_peek(compiler) != '|' && regex_peek(compiler) != ')') {
+        NfaFragment next;
+        if (!regex_repeat(compiler, &next)) return false;
+        if (empty) {
+            *out = next;
+            empty = false;
+        } else {
+            nfa_patch(compiler, out->exits, next.start);
+            out->exits = next.exits;
+        }
+    }
+
+    if (empty) {
+        int state = nfa_add(compiler, NFA_EMPTY);
+        if (state < 0) return false;
+        out->start = state;
+        out->exits = state << 1;
+    }
+    return true;
+}
+
+static bool regex_alternation(RegexCompiler* compiler, NfaFragment* out) {
+    if (!regex_concat(compiler, out)) return false;
+
+    while (regex_peek(compiler) == '|') {
+        if (compiler->depth == 0 && compiler->top_level_bar == SIZE_MAX) {
+            compiler->top_level_bar = compiler->pos;
+        }
+        compiler->pos++;
+        NfaFragment right;
+        if (!regex_concat(compiler, &right)) return false;
+
+        int split = nfa_add(compiler, NFA_SPLIT);
+        if (split < 0) return false;
+        compiler->states[split].out = out->start;
+        compiler->states[split].out1 = right.start;
+        out->start = split;
+        out->exits = nfa_append(compiler, out->exits, right.exits);
+    }
+    return true;
+}
+
+static void nfa_closure(const RegexCompiler* compiler, NfaSet* set, int state) {
+    int stack[REGEX_MAX_NFA_STATES];
+    int depth = 0;
+
+    if (state < 0 || (set->bits[state >> 6] >> (state & 63)) & 1) return;
+    set->bits[state >> 6] |= 1ULL << (state & 63);
+    stack[depth++] = state;
+
+    while (depth > 0) {
+        const NfaState* current = &compiler->states[stack[--depth]];
+        if (current->kind != NFA_SPLIT && current->kind != NFA_EMPTY) continue;
+
+        int targets[2] = { current->out, current->kind == NFA_SPLIT ? current->out1 : -1 };
+        for (int i = 0; i < 2; i++) {
+            int target = targets[i];
+            if (target < 0 || (set->bits[target >> 6] >> (target & 63)) & 1) continue;
+            set->bits[target >> 6] |= 1ULL << (target & 63);
+            stack[depth++] = target;
+        }
+    }
+}
+
+// Partitions bytes so that every NFA byte set is a union of classes
+static void compute_byte_classes(const RegexCompiler* compiler, SelectorDfa* dfa, BYTE* representatives) {
+    memset(dfa->classes, 0, sizeof(dfa->classes));
+    dfa->class_count = 1;
+
+    for (int s = 0; s < compiler->count; s++) {
+        if (compiler->states[s].kind != NFA_BYTES) continue;
+
+        int remap[256][2];
+        memset(remap, 0xFF, sizeof(remap));
+        int count = 0;
+        for (int b = 0; b < 256; b++) {
+            int member = byteset_has(&compiler->states[s].set, (BYTE)b) ? 1 : 0;
+            int* slot = &remap[dfa->classes[b]][member];
+            if (*slot < 0) *slot = count++;
+            dfa->classes[b] = (BYTE)*slot;
+        }
+        dfa->class_count = count;
+    }
+
+    for (int b = 255; b >= 0; b--) {
+        representatives[dfa->classes[b]] = (BYTE)b;
+    }
+}
+
+static void free_dfa(SelectorDfa* dfa) {
+    free(dfa->accepting);
+    free(dfa->transitions);
+}
+
+static bool build_dfa(const RegexCompiler* compiler, int nfa_start, bool anchored_start, SelectorDfa* dfa,
+                      const char** error) {
+    BYTE representatives[256];
+    compute_byte_classes(compiler, dfa, representatives);
+
+    int capacity = 16;
+    NfaSet* sets = (NfaSet*)malloc(capacity * sizeof(NfaSet));
+    dfa->accepting = (bool*)malloc(capacity * sizeof(bool));
+    dfa->transitions = (WORD*)malloc((size_t)capacity * dfa->class_count * sizeof(WORD));
+    dfa->state_count = 0;
+    dfa->start = 0;
+    dfa->dead = -1;
+    if (!sets || !dfa->accepting || !dfa->transitions) {
+        free(sets);
+        *error = "out of memory";
+        return false;
+    }
+
+    // Unanchored patterns are searches: every step may also begin a new match
+    NfaSet start_set;
+    memset(&start_set, 0, sizeof(start_set));
+    nfa_closure(compiler, &start_set, nfa_start);
+    sets[0] = start_set;
+    dfa->state_count = 1;
+
+    for (int current = 0; current < dfa->state_count; current++) {
+        bool accepting = false;
+        for (int s = 0; s < compiler->count; s++) {
+            if (((sets[current].bits[s >> 6] >> (s & 63)) & 1) && compiler->states[s].kind == NFA_MATCH) {
+                accepting = true;
+                break;
+            }
+        }
+        dfa->accepting[current] = accepting;
+
+        bool empty = true;
+        for (int w = 0; w < NFA_SET_WORDS; w++) {
+            if (sets[current].bits[w]) empty = false;
+        }
+        if (empty) dfa->dead = current;
+
+        for (int k = 0; k < dfa->class_count; k++) {
+            NfaSet next;
+            if (anchored_start) {
+                memset(&next, 0, sizeof(next));
+            } else {
+                next = start_set;
+            }
+            for (int s = 0; s < compiler->count; s++) {
+                const NfaState* state = &compiler->states[s];
+                if (((sets[current].bits[s >> 6] >> (s & 63)) & 1) && state->kind == NFA_BYTES &&
+                    byteset_has(&state->set, representatives[k])) {
+                    nfa_closure(compiler, &next, state->out);
+                }
+            }
+
+            int target = -1;
+            for (int d = 0; d < dfa->state_count; d++) {
+                if (memcmp(&sets[d], &next, sizeof(next)) == 0) {
+                    target = d;
+                    break;
+                }
+            }
+
+            if (target < 0) {
+                if (dfa->state_count >= REGEX_MAX_DFA_STATES) {
+                    free(sets);
+                    *error = "pattern is too complex";
+                    return false;
+                }
+                if (dfa->state_count == capacity) {
+                    capacity *= 2;
+                    NfaSet* grown_sets = (NfaSet*)realloc(sets, capacity * sizeof(NfaSet));
+                    if (grown_sets) sets = grown_sets;
+                    bool* grown_accepting = (bool*)realloc(dfa->accepting, capacity * sizeof(bool));
+                    if (grown_accepting) dfa->accepting = grown_accepting;
+                    WORD* grown_transitions = (WORD*)realloc(dfa->transitions,
+                                                             (size_t)capacity * dfa->class_count * sizeof(WORD));
+                    if (grown_transitions) dfa->transitions = grown_transitions;
+                    if (!grown_sets || !grown_accepting || !grown_transitions) {
+                        free(sets);
+                        *error = "out of memory";
+                        return false;
+                    }
+                }
+                target = dfa->state_count++;
+                sets[target] = next;
+            }
+
+            dfa->transitions[current * dfa->class_count + k] = (WORD)target;
+        }
+    }
+
+    free(sets);
+    return true;
+}
+
+// Compiles pattern[0..length) case-insensitively. On failure returns false
+// with *error set and *error_offset at the failing pattern byte.
+static bool compile_regex(const char* pattern, size_t length, SelectorDfa* dfa,
+                          const char** error, size_t* error_offset) {
+    memset(dfa, 0, sizeof(*dfa));
+
+    RegexCompiler* compiler = (RegexCompiler*)malloc(sizeof(RegexCompiler));
+    if (!compiler) {
+        *error = "out of memory";
+        *error_offset = 0;
+        return false;
+    }
+    compiler->pattern = pattern;
+    compiler->pos = 0;
+    compiler->end = length;
+    compiler->count = 0;
+    compiler->error = NULL;
+    compiler->depth = 0;
+    compiler->top_level_bar = SIZE_MAX;
+
+    bool anchored_start = length > 0 && pattern[0] == '^';
+    if (anchored_start) compiler->pos = 1;
+
+    // A trailing $ anchors unless it is escaped
+    if (compiler->end > compiler->pos && pattern[compiler->end - 1] == '$') {
+        size_t backslashes = 0;
+        while (compiler->end - 1 - backslashes > compiler->pos &&
+               pattern[compiler->end - 2 - backslashes] == '\\') {
+            backslashes++;
+        }
+        if (backslashes % 2 == 0) {
+            dfa->anchored_end = true;
+            compiler->end--;
+        }
+    }
+
+    NfaFragment fragment;
+    bool ok = regex_alternation(compiler, &fragment);
+    if (ok && compiler->pos < compiler->end) {
+        compiler->error = "unmatched )";
+        ok = false;
+    }
+
+    // The anchors bind to the whole pattern, which in other dialects ^a|b
+    // does not mean; make the grouping explicit instead of guessing
+    if (ok && compiler->top_level_bar != SIZE_MAX && (anchored_start || dfa->anchored_end)) {
+        compiler->error = "anchors with a top-level |; group the alternatives, as in ^(a|b)$";
+        compiler->pos = compiler->top_level_bar;
+        ok = false;
+    }
+    if (ok) {
+        int match = nfa_add(compiler, NFA_MATCH);
+        ok = match >= 0;
+        if (ok) {
+            nfa_patch(compiler, fragment.exits, match);
+            ok = build_dfa(compiler, fragment.start, anchored_start, dfa, &compiler->error);
+        }
+    }
+
+    if (!ok) {
+        *error = compiler->error ? compiler->error : "invalid pattern";
+        *error_offset = compiler->pos;
+        free_dfa(dfa);
+        memset(dfa, 0, sizeof(*dfa));
+    }
+    free(compiler);
+    return ok;
+}
+
+static bool dfa_matches(const SelectorDfa* dfa, const char* text) {
+    int state = dfa->start;
+    if (dfa->accepting[state] && !dfa->anchored_end) return true;
+
+    for (const unsigned char* p = (const unsigned char*)text; *p; p++) {
+        state = dfa->transitions[state * dfa->class_count + dfa->classes[*p]];
+        if (state == dfa->dead) return false;
+        if (dfa->accepting[state] && !dfa->anchored_end) return true;
+    }
+
+    return dfa->accepting[state];
+}
+
+// Expression compiler: recursive descent emitting code directly
+typedef struct {
+    const char* source;
+    size_t pos;
+    SelectorProgram* program;
+    int code_capacity;
+    const char* error;
+    size_t error_pos;
+} ExprCompiler;
+
+static bool expr_fail(ExprCompiler* compiler, size_t pos, const char* error) {
+    if (!compiler->error) {
+        compiler->error = error;
+        compiler->error_pos = pos;
+    }
+    return false;
+}
+
+static void expr_skip_space(ExprCompiler* compiler) {
+    while (isspace((unsigned char)compiler->source[compiler->pos])) {
+        compiler->pos++;
+    }
+}
+
+static bool expr_accept(ExprCompiler* compiler, const char* token) {
+    expr_skip_space(compiler);
+    size_t length = strlen(token);
+    if (strncmp(compiler->source + compiler->pos, token, length) != 0) return false;
+    compiler->pos += length;
+    return true;
+}
+
+static int expr_emit(ExprCompiler* compiler, SelectorOpcode opcode, int attribute, int compare, LONG operand) {
+    SelectorProgram* program = compiler->program;
+    if (program->code_count == compiler->code_capacity) {
+        int capacity = compiler->code_capacity ? compiler->code_capacity * 2 : 16;
+        SelectorInstruction* grown = (SelectorInstruction*)realloc(program->code, capacity * sizeof(SelectorInstruction));
+        if (!grown) {
+            expr_fail(compiler, compiler->pos, "out of memory");
+            return -1;
+        }
+        program->code = grown;
+        compiler->code_capacity = capacity;
+    }
+
+    SelectorInstruction* instruction = &program->code[program->code_count];
+    instruction->opcode = (BYTE)opcode;
+    instruction->attribute = (BYTE)attribute;
+    instruction->compare = (BYTE)compare;
+    instruction->reserved = 0;
+    instruction->operand = operand;
+    return program->code_count++;
+}
+
+static bool expr_or(ExprCompiler* compiler);
+
+static bool expr_parse_string(ExprCompiler* compiler, char** out_value, size_t* out_start) {
+    expr_skip_space(compiler);
+    const char* source = compiler->source;
+    size_t start = compiler->pos;
+    *out_start = start;
+
+    size_t length = 0;
+    const char* text = source + start;
+    bool quoted = source[start] == '"';
+    if (quoted) {
+        // Only \" is an escape; other backslashes are kept for device paths and patterns
+        size_t end = start + 1;
+        while (source[end] && source[end] != '"') {
+            end += (source[end] == '\\' && source[end + 1] == '"') ? 2 : 1;
+        }
+        if (source[end] != '"') return expr_fail(compiler, start, "unterminated string");
+        text = source + start + 1;
+        length = end - start - 1;
+        *out_start = start + 1;
+        compiler->pos = end + 1;
+    } else {
+        while (source[start + length] && !isspace((unsigned char)source[start + length]) &&
+               !strchr("()&|!<>=~\"", source[start + length])) {
+            length++;
+        }
+        if (length == 0) return expr_fail(compiler, start, "expected a value");
+        compiler->pos = start + length;
+    }
+
+    char* value = (char*)malloc(length + 1);
+    if (!value) return expr_fail(compiler, start, "out of memory");
+    size_t written = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (quoted && text[i] == '\\' && i + 1 < length && text[i + 1] == '"') i++;
+        value[written++] = text[i];
+    }
+    value[written] = '\0';
+    *out_value = value;
+    return true;
+}
+
+static bool expr_compare(ExprCompiler* compiler) {
+    expr_skip_space(compiler);
+    const char* source = compiler->source;
+    size_t start = compiler->pos;
+    size_t length = 0;
+    while (isalnum((unsigned char)source[start + length]) || source[start + length] == '_') {
+        length++;
+    }
+    if (length == 0) return expr_fail(compiler, start, "expected an attribute");
+    compiler->pos += length;
+
+    if ((length == 4 && strncmp(source + start, "true", 4) == 0) ||
+        (length == 5 && strncmp(source + start, "false", 5) == 0)) {
+        return expr_emit(compiler, OP_CONST, 0, 0, length == 4) >= 0;
+    }
+
+    int attribute = -1;
+    for (size_t i = 0; i < sizeof(g_attributes) / sizeof(g_attributes[0]); i++) {
+        if (strlen(g_attributes[i].name) == length && strncmp(g_attributes[i].name, source + start, length) == 0) {
+            attribute = g_attributes[i].attribute;
+            break;
+        }
+    }
+    if (attribute < 0) return expr_fail(compiler, start, "unknown attribute");
+
+    // Longest operators first
+    static const struct { const char* text; SelectorCompare compare; } operators[] = {
+        { "==", CMP_EQ }, { "!=", CMP_NE }, { "<=", CMP_LE }, { ">=", CMP_GE },
+        { "!~", CMP_NOT_MATCH }, { "<", CMP_LT }, { ">", CMP_GT }, { "~", CMP_MATCH }
+    };
+    expr_skip_space(compiler);
+    size_t operator_pos = compiler->pos;
+    int compare = -1;
+    for (size_t i = 0; i < sizeof(operators) / sizeof(operators[0]); i++) {
+        if (expr_accept(compiler, operators[i].text)) {
+            compare = operators[i].compare;
+            break;
+        }
+    }
+    if (compare < 0) return expr_fail(compiler, operator_pos, "expected ==, !=, <, <=, >, >=, ~ or !~");
+
+    bool is_string = attribute < ATTR_FIRST_NUMBER;
+    bool is_ordering = compare == CMP_LT || compare == CMP_LE || compare == CMP_GT || compare == CMP_GE;
+    bool is_match = compare == CMP_MATCH || compare == CMP_NOT_MATCH;
+    if (is_string && is_ordering) {
+        return expr_fail(compiler, operator_pos, "string attributes support ==, !=, ~ and !~");
+    }
+    if (!is_string && is_match) {
+        return expr_fail(compiler, operator_pos, "numeric attributes support ==, !=, <, <=, > and >=");
+    }
+
+    SelectorProgram* program = compiler->program;
+    if (!is_string) {
+        expr_skip_space(compiler);
+        size_t value_pos = compiler->pos;
+        char* end = NULL;
+        long long value = strtoll(source + value_pos, &end, 10);
+        if (end == source + value_pos || value < LONG_MIN || value > LONG_MAX ||
+            isalnum((unsigned char)*end)) {
+            return expr_fail(compiler, value_pos, "expected a number");
+        }
+        compiler->pos = end - source;
+        return expr_emit(compiler, OP_TEST, attribute, compare, (LONG)value) >= 0;
+    }
+
+    char* value = NULL;
+    size_t value_pos = 0;
+    if (!expr_parse_string(compiler, &value, &value_pos)) return false;
+
+    LONG operand;
+    if (is_match) {
+        SelectorDfa* grown = (SelectorDfa*)realloc(program->dfas, (program->dfa_count + 1) * sizeof(SelectorDfa));
+        if (!grown) {
+            free(value);
+            return expr_fail(compiler, value_pos, "out of memory");
+        }
+        program->dfas = grown;
+
+        const char* error = NULL;
+        size_t error_offset = 0;
+        bool ok = compile_regex(value, strlen(value), &program->dfas[program->dfa_count], &error, &error_offset);
+        free(value);
+        if (!ok) return expr_fail(compiler, value_pos + error_offset, error);
+        operand = program->dfa_count++;
+    } else {
+        char** grown = (char**)realloc(program->strings, (program->string_count + 1) * sizeof(char*));
+        if (!grown) {
+            free(value);
+            return expr_fail(compiler, value_pos, "out of memory");
+        }
+        program->strings = grown;
+        program->strings[program->string_count] = value;
+        operand = program->string_count++;
+    }
+
+    return expr_emit(compiler, OP_TEST, attribute, compare, operand) >= 0;
+}
+
+static bool expr_unary(ExprCompiler* compiler) {
+    expr_skip_space(compiler);
+    const char* source = compiler->source;
+
+    if (source[compiler->pos] == '!' && source[compiler->pos + 1] != '=' && source[compiler->pos + 1] != '~') {
+        compiler->pos++;
+        if (!expr_unary(compiler)) return false;
+        return expr_emit(compiler, OP_NOT, 0, 0, 0) >= 0;
+    }
+
+    if (source[compiler->pos] == '(') {
+        size_t open = compiler->pos++;
+        if (!expr_or(compiler)) return false;
+        if (!expr_accept(compiler, ")")) {
+            expr_skip_space(compiler);
+            return expr_fail(compiler, source[compiler->pos] ? compiler->pos : open, "missing )");
+        }
+        return true;
+    }
+
+    return expr_compare(compiler);
+}
+
+// Shared by && and ||: operands followed by a jump to the end of the chain
+static bool expr_chain(ExprCompiler* compiler, const char* token, SelectorOpcode jump,
+                       bool (*operand)(ExprCompiler*)) {
+    if (!operand(compiler)) return false;
+
+    int first_jump = compiler->program->code_count;
+    while (expr_accept(compiler, token)) {
+        if (expr_emit(compiler, jump, 0, 0, -1) < 0) return false;
+        if (!operand(compiler)) return false;
+    }
+
+    SelectorProgram* program = compiler->program;
+    for (int i = first_jump; i < program->code_count; i++) {
+        if (program->code[i].opcode == jump && program->code[i].operand == -1) {
+            program->code[i].operand = program->code_count;
+        }
+    }
+    return true;
+}
+
+static bool expr_and(ExprCompiler* compiler) {
+    return expr_chain(compiler, "&&", OP_JUMP_IF_FALSE, expr_unary);
+}
+
+static bool expr_or(ExprCompiler* compiler) {
+    return expr_chain(compiler, "||", OP_JUMP_IF_TRUE, expr_and);
+}
+
+static void free_program(SelectorProgram* program) {
+    if (!program) return;
+    for (int i = 0; i < program->string_count; i++) {
+        free(program->strings[i]);
+    }
+    for (int i = 0; i < program->dfa_count; i++) {
+        free_dfa(&program->dfas[i]);
+    }
+    free(program->strings);
+    free(program->dfas);
+    free(program->code);
+    free(program->source);
+    free(program);
+}
+
+static SelectorProgram* compile_program(const char* source, ULONG64 hash, int* out_error_column,
+                                        const char** out_error) {
+    SelectorProgram* program = (SelectorProgram*)calloc(1, sizeof(SelectorProgram));
+    if (!program) return NULL;
+    program->refs = 1;
+    program->hash = hash;
+    program->source = _strdup(source);
+    if (!program->source) {
+        free(program);
+        *out_error_column = 1;
+        *out_error = "out of memory";
+        return NULL;
+    }
+
+    ExprCompiler compiler = { source, 0, program, 0, NULL, 0 };
+    bool ok = expr_or(&compiler);
+    expr_skip_space(&compiler);
+    if (ok && source[compiler.pos]) {
+        ok = expr_fail(&compiler, compiler.pos,
+                       source[compiler.pos] == ')' ? "unmatched )" : "expected && or ||");
+    }
+    if (ok) {
+        ok = expr_emit(&compiler, OP_END, 0, 0, 0) >= 0;
+    }
+
+    if (!ok) {
+        *out_error_column = (int)compiler.error_pos + 1;
+        *out_error = compiler.error;
+        free_program(program);
+        return NULL;
+    }
+
+    log_verbose("Compiled selector expression '%s' into %d instructions, %d patterns",
+                source, program->code_count, program->dfa_count);
+    return program;
+}
+
+// Process-wide program cache. Entries hold a reference; the oldest is
+// dropped when the cache is full.
+#define SELECTOR_PROGRAM_CACHE_SIZE 64
+
+static SRWLOCK g_program_cache_lock = SRWLOCK_INIT;
+static SelectorProgram* g_program_cache[SELECTOR_PROGRAM_CACHE_SIZE];
+static int g_program_cache_next = 0;
+
+static SelectorProgram* find_cached_program(const char* source, ULONG64 hash) {
+    for (int i = 0; i < SELECTOR_PROGRAM_CACHE_SIZE; i++) {
+        SelectorProgram* program = g_program_cache[i];
+        if (program && program->hash == hash && strcmp(program->source, source) == 0) {
+            return selector_program_retain(program);
+        }
+    }
+    return NULL;
+}
+
+SelectorProgram* selector_program_compile(const char* source) {
+    if (!source) return NULL;
+
+    int column = 0;
+    const char* error = NULL;
+    SelectorProgram* program = selector_program_compile_with_error(source, &column, &error);
+    if (!program) {
+        log_error("Invalid selector expression at column %d: %s", column, error);
+        log_error("  %s", source);
+        log_error("  %*s^", column - 1, "");
+    }
+    return program;
+}
+
+SelectorProgram* selector_program_compile_with_error(const char* source, int* out_error_column,
+                                                     const char** out_error) {
+    *out_error_column = 0;
+    *out_error = NULL;
+    if (!source) return NULL;
+
+    ULONG64 hash = hash_bytes(HASH_SEED, source, strlen(source));
+
+    AcquireSRWLockShared(&g_program_cache_lock);
+    SelectorProgram* program = find_cached_program(source, hash);
+    ReleaseSRWLockShared(&g_program_cache_lock);
+    if (program) return program;
+
+    program = compile_program(source, hash, out_error_column, out_error);
+    if (!program) return NULL;
+
+    AcquireSRWLockExclusive(&g_program_cache_lock);
+    SelectorProgram* existing = find_cached_program(source, hash);
+    if (!existing) {
+        SelectorProgram* evicted = g_program_cache[g_program_cache_next];
+        g_program_cache[g_program_cache_next] = selector_program_retain(program);
+        g_program_cache_next = (g_program_cache_next + 1) % SELECTOR_PROGRAM_CACHE_SIZE;
+        selector_program_release(evicted);
+    }
+    ReleaseSRWLockExclusive(&g_program_cache_lock);
+
+    // Another thread compiled the same text first
+    if (existing) {
+        selector_program_release(program);
+        return existing;
+    }
+    return program;
+}
+
+SelectorProgram* selector_program_retain(SelectorProgram* program) {
+    if (program) {
+        InterlockedIncrement(&program->refs);
+    }
+    return program;
+}
+
+void selector_program_release(SelectorProgram* program) {
+    if (program && InterlockedDecrement(&program->refs) == 0) {
+        free_program(program);
+    }
+}
+
+static const char* string_attribute(const MonitorInfo* monitor, int attribute) {
+    const char* value = NULL;
+    switch (attribute) {
+        case ATTR_ID:     value = monitor->id; break;
+        case ATTR_NAME:   value = monitor->device_name; break;
+        case ATTR_DEVICE: value = monitor->device_path; break;
+        case ATTR_EDID:   value = monitor->stable_id; break;
+        case ATTR_MODEL:  value = monitor->model_name; break;
+    }
+    return value ? value : "";
+}
+
+static LONG64 number_attribute(const MonitorInfo* monitor, int attribute) {
+    switch (attribute) {
+        case ATTR_WIDTH:         return monitor->width;
+        case ATTR_HEIGHT:        return monitor->height;
+        case ATTR_ORIENTATION:   return get_orientation_degrees(monitor->orientation);
+        case ATTR_X:             return monitor->position_x;
+        case ATTR_Y:             return monitor->position_y;
+        case ATTR_REFRESH:       return monitor->refresh_hz;
+        case ATTR_NATIVE_WIDTH:  return monitor->native_width;
+        case ATTR_NATIVE_HEIGHT: return monitor->native_height;
+        case ATTR_WIDTH_MM:      return monitor->width_mm;
+        case ATTR_HEIGHT_MM:     return monitor->height_mm;
+        case ATTR_PREFERRED:
+            return monitor->preferred_orientation == MODEL_ORIENTATION_NONE
+                       ? -1 : (LONG64)get_orientation_degrees(monitor->preferred_orientation);
+        case ATTR_SLOW_MODESET:  return (monitor->model_flags & MODEL_FLAG_SLOW_MODESET) != 0;
+        case ATTR_REFRESH_RESET: return (monitor->model_flags & MODEL_FLAG_REFRESH_RESET) != 0;
+        case ATTR_NO_ROTATE:     return (monitor->model_flags & MODEL_FLAG_NO_ROTATE) != 0;
+        default:                 return 0;
+    }
+}
+
+static bool run_test(const SelectorProgram* program, const SelectorInstruction* instruction,
+                     const MonitorInfo* monitor) {
+    if (instruction->attribute < ATTR_FIRST_NUMBER) {
+        const char* value = string_attribute(monitor, instruction->attribute);
+        switch (instruction->compare) {
+            case CMP_EQ:        return _stricmp(value, program->strings[instruction->operand]) == 0;
+            case CMP_NE:        return _stricmp(value, program->strings[instruction->operand]) != 0;
+            case CMP_MATCH:     return dfa_matches(&program->dfas[instruction->operand], value);
+            case CMP_NOT_MATCH: return !dfa_matches(&program->dfas[instruction->operand], value);
+            default:            return false;
+        }
+    }
+
+    LONG64 value = number_attribute(monitor, instruction->attribute);
+    LONG64 operand = instruction->operand;
+    switch (instruction->compare) {
+        case CMP_EQ: return value == operand;
+        case CMP_NE: return value != operand;
+        case CMP_LT: return value < operand;
+        case CMP_LE: return value <= operand;
+        case CMP_GT: return value > operand;
+        case CMP_GE: return value >= operand;
+        default:     return false;
+    }
+}
+
+bool selector_program_matches(const SelectorProgram* program, const MonitorInfo* monitor) {
+    if (!program || !monitor) return false;
+
+    bool acc = false;
+    int pc = 0;
+    for (;;) {
+        const SelectorInstruction* instruction = &program->code[pc];
+        switch (instruction->opcode) {
+            case OP_TEST:
+                acc = run_test(program, instruction, monitor);
+                pc++;
+                break;
+            case OP_CONST:
+                acc = instruction->operand != 0;
+                pc++;
+                break;
+            case OP_NOT:
+                acc = !acc;
+                pc++;
+                break;
+            case OP_JUMP_IF_FALSE:
+                pc = acc ? pc + 1 : instruction->operand;
+                break;
+            case OP_JUMP_IF_TRUE:
+                pc = acc ? instruction->operand : pc + 1;
+                break;
+            default:
+                return acc;
+        }
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef SELEXPR_H
+#define SELEXPR_H
+
+#include <windows.h>
+#include <stdbool.h>
+#include "enum.h"
+
+// Selector expressions (expr:...), for example
+//
+//   name~"^DELL U27" && width>=2560 && orientation==0
+//
+// Comparisons are "attribute op value", combined with &&, ||, ! and
+// parentheses. String attributes (id, name, device, edid, model) take
+// == != (case-insensitive) and ~ !~ (regular expression search); numeric
+// attributes (width, height, orientation in degrees, x, y, refresh,
+// native_width, native_height, width_mm, height_mm) take == != < <= > >=.
+//
+// Expressions compile once into a flat bytecode program with regular
+// expressions as DFAs; evaluation does not allocate. Programs are reference
+// counted and shared through a process-wide cache keyed by source text, so
+// resident modes that re-parse the same selector reuse one program.
+
+typedef struct SelectorProgram SelectorProgram;
+
+// Compiles source (without the "expr:" prefix) or returns the cached program
+// for identical text. Returns NULL after logging the column of the first
+// error. Thread-safe; release with selector_program_release.
+SelectorProgram* selector_program_compile(const char* source);
+
+// As selector_program_compile, but reports the first error's 1-based column
+// and message (a static string) instead of logging
+SelectorProgram* selector_program_compile_with_error(const char* source, int* out_error_column,
+                                                     const char** out_error);
+SelectorProgram* selector_program_retain(SelectorProgram* program);
+void selector_program_release(SelectorProgram* program);
+
+bool selector_program_matches(const SelectorProgram* program, const MonitorInfo* monitor);
+
+#endif // SELEXPR_H
@@ -0,0 +1,828 @@
+#include "snapshots.h"
+#include "util.h"
+#include "history.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// File layout (little-endian):
+//   header  "MOSSNAP\0", u32 version
+//   record  u32 body length, u32 checksum (low half of FNV-1a over the body), body
+//   body    u8 kind, u8 keyframe, u64 saved_at, u16 name length + name,
+//           u32 undo count, u16 display count, displays
+//   display keyframe: full state; delta: u16 base index into the previous
+//           record's displays (NEW_DISPLAY for a full state), u8 changed-field
+//           mask, then only the changed fields
+#define SNAPSHOT_STORE_MAGIC "MOSSNAP"
+#define SNAPSHOT_STORE_MAGIC_SIZE 8
+#define SNAPSHOT_STORE_VERSION 1
+#define SNAPSHOT_STORE_MAX_SIZE (64 * 1024 * 1024)
+#define NEW_DISPLAY 0xFFFF
+
+typedef enum {
+    RECORD_SNAPSHOT = 1,    // Named, saved by the user
+    RECORD_JOURNAL = 2,     // State before a change; an undo stack entry
+    RECORD_UNDO = 3         // Pops undo_count journal entries
+} RecordKind;
+
+// Delta field mask
+#define FIELD_POSITION_X  0x01
+#define FIELD_POSITION_Y  0x02
+#define FIELD_WIDTH       0x04
+#define FIELD_HEIGHT      0x08
+#define FIELD_ORIENTATION 0x10
+#define FIELD_REFRESH     0x20
+
+typedef struct {
+    BYTE kind;
+    char* name;
+    FILETIME saved_at;
+    DWORD undo_count;
+    DisplaySetup* setup;    // NULL for RECORD_UNDO
+} StoreRecord;
+
+typedef struct {
+    StoreRecord* records;
+    int count;
+    int capacity;
+    long file_size;
+    int since_keyframe;     // State records written since the last keyframe
+} SnapshotStore;
+
+// Display setups
+static bool copy_display_state(DisplayState* dst, const DisplayState* src, const MosDefAllocator* allocator) {
+    *dst = *src;
+    dst->stable_id = mem_strdup(allocator, src->stable_id);
+    dst->device_path = mem_strdup(allocator, src->device_path);
+    return dst->stable_id && dst->device_path;
+}
+
+static DisplaySetup* allocate_setup(int count, const MosDefAllocator* allocator) {
+    DisplaySetup* setup = (DisplaySetup*)mem_alloc(allocator, sizeof(DisplaySetup));
+    if (!setup) return NULL;
+
+    setup->count = 0;
+    setup->displays = NULL;
+    if (count > 0) {
+        setup->displays = (DisplayState*)mem_alloc(allocator, count * sizeof(DisplayState));
+        if (!setup->displays) {
+            mem_free(allocator, setup);
+            return NULL;
+        }
+    }
+    return setup;
+}
+
+DisplaySetup* capture_display_setup(const MonitorList* monitors, const MosDefAllocator* allocator) {
+    if (!monitors) return NULL;
+
+    DisplaySetup* setup = allocate_setup(monitors->count, allocator);
+    if (!setup) return NULL;
+
+    for (int i = 0; i < monitors->count; i++) {
+        const MonitorInfo* monitor = &monitors->monitors[i];
+        DisplayState state = {
+            monitor->stable_id, monitor->device_path, monitor->position_x, monitor->position_y,
+            monitor->width, monitor->height, monitor->orientation, monitor->refresh_hz
+        };
+
+        DisplayState* display = &setup->displays[setup->count++];
+        if (!copy_display_state(display, &state, allocator)) {
+            free_display_setup(setup, allocator);
+            return NULL;
+        }
+    }
+
+    return setup;
+}
+
+void free_display_setup(DisplaySetup* setup, const MosDefAllocator* allocator) {
+    if (!setup) return;
+
+    for (int i = 0; i < setup->count; i++) {
+        mem_free(allocator, setup->displays[i].stable_id);
+        mem_free(allocator, setup->displays[i].device_path);
+    }
+    mem_free(allocator, setup->displays);
+    mem_free(allocator, setup);
+}
+
+static DisplaySetup* clone_display_setup(const DisplaySetup* setup, const MosDefAllocator* allocator) {
+    DisplaySetup* copy = allocate_setup(setup->count, allocator);
+    if (!copy) return NULL;
+
+    for (int i = 0; i < setup->count; i++) {
+        if (!copy_display_state(&copy->displays[copy->count++], &setup->displays[i], allocator)) {
+            free_display_setup(copy, allocator);
+            return NULL;
+        }
+    }
+    return copy;
+}
+
+static bool same_display(const DisplayState* a, const DisplayState* b) {
+    return strcmp(a->stable_id, b->stable_id) == 0 && strcmp(a->device_path, b->device_path) == 0;
+}
+
+static BYTE changed_fields(const DisplayState* from, const DisplayState* to) {
+    BYTE mask = 0;
+    if (from->position_x != to->position_x) mask |= FIELD_POSITION_X;
+    if (from->position_y != to->position_y) mask |= FIELD_POSITION_Y;
+    if (from->width != to->width)           mask |= FIELD_WIDTH;
+    if (from->height != to->height)         mask |= FIELD_HEIGHT;
+    if (from->orientation != to->orientation) mask |= FIELD_ORIENTATION;
+    if (from->refresh_hz != to->refresh_hz) mask |= FIELD_REFRESH;
+    return mask;
+}
+
+// Encoding
+typedef struct {
+    BYTE* data;
+    size_t length;
+    size_t capacity;
+    bool failed;
+} Buffer;
+
+static void put_bytes(Buffer* buffer, const void* data, size_t size) {
+    if (buffer->failed) return;
+
+    if (buffer->length + size > buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity * 2 : 256;
+        while (capacity < buffer->length + size) {
+            capacity *= 2;
+        }
+        BYTE* grown = (BYTE*)realloc(buffer->data, capacity);
+        if (!grown) {
+            buffer->failed = true;
+            return;
+        }
+        buffer->data = grown;
+        buffer->capacity = capacity;
+    }
+
+    memcpy(buffer->data + buffer->length, data, size);
+    buffer->length += size;
+}
+
+static void put_u8(Buffer* buffer, BYTE value)     { put_bytes(buffer, &value, sizeof(value)); }
+static void put_u16(Buffer* buffer, WORD value)    { put_bytes(buffer, &value, sizeof(value)); }
+static void put_u32(Buffer* buffer, DWORD value)   { put_bytes(buffer, &value, sizeof(value)); }
+static void put_i32(Buffer* buffer, LONG value)    { put_bytes(buffer, &value, sizeof(value)); }
+static void put_u64(Buffer* buffer, ULONG64 value) { put_bytes(buffer, &value, sizeof(value)); }
+
+static void put_string(Buffer* buffer, const char* value) {
+    size_t length = value ? strlen(value) : 0;
+    if (length > 0xFFFF) {
+        buffer->failed = true;
+        return;
+    }
+    put_u16(buffer, (WORD)length);
+    put_bytes(buffer, value, length);
+}
+
+static void put_fields(Buffer* buffer, const DisplayState* display, BYTE mask) {
+    if (mask & FIELD_POSITION_X)  put_i32(buffer, display->position_x);
+    if (mask & FIELD_POSITION_Y)  put_i32(buffer, display->position_y);
+    if (mask & FIELD_WIDTH)       put_u32(buffer, display->width);
+    if (mask & FIELD_HEIGHT)      put_u32(buffer, display->height);
+    if (mask & FIELD_ORIENTATION) put_u32(buffer, display->orientation);
+    if (mask & FIELD_REFRESH)     put_u32(buffer, display->refresh_hz);
+}
+
+#define ALL_FIELDS 0x3F
+
+static void put_display(Buffer* buffer, const DisplayState* display, const DisplaySetup* base) {
+    if (base) {
+        for (int i = 0; i < base->count && i < NEW_DISPLAY; i++) {
+            if (same_display(&base->displays[i], display)) {
+                BYTE mask = changed_fields(&base->displays[i], display);
+                put_u16(buffer, (WORD)i);
+                put_u8(buffer, mask);
+                put_fields(buffer, display, mask);
+                return;
+            }
+        }
+        put_u16(buffer, NEW_DISPLAY);
+    }
+
+    put_string(buffer, display->stable_id);
+    put_string(buffer, display->device_path);
+    put_fields(buffer, display, ALL_FIELDS);
+}
+
+// Appends one framed record. base is the previous state record's setup, or
+// NULL to write a keyframe.
+static void put_record(Buffer* buffer, const StoreRecord* record, const DisplaySetup* base) {
+    Buffer body = { NULL, 0, 0, false };
+    const DisplaySetup* setup = record->setup;
+
+    put_u8(&body, record->kind);
+    put_u8(&body, base ? 0 : 1);
+    put_u64(&body, ((ULONG64)record->saved_at.dwHighDateTime << 32) | record->saved_at.dwLowDateTime);
+    put_string(&body, record->name);
+    put_u32(&body, record->undo_count);
+    put_u16(&body, (WORD)(setup ? setup->count : 0));
+    for (int i = 0; setup && i < setup->count; i++) {
+        put_display(&body, &setup->displays[i], base);
+    }
+
+    if (body.failed) {
+        buffer->failed = true;
+    } else {
+        put_u32(buffer, (DWORD)body.length);
+        put_u32(buffer, (DWORD)hash_bytes(HASH_SEED, body.data, body.length));
+        put_bytes(buffer, body.data, body.length);
+    }
+    free(body.data);
+}
+
+// Decoding
+typedef struct {
+    const BYTE* data;
+    size_t length;
+    size_t offset;
+    bool failed;
+} Reader;
+
+static void get_bytes(Reader* reader, void* out, size_t size) {
+    if (reader->failed || reader->length - reader->offset < size) {
+        reader->failed = true;
+        memset(out, 0, size);
+        return;
+    }
+    memcpy(out, reader->data + reader->offset, size);
+    reader->offset += size;
+}
+
+static BYTE get_u8(Reader* reader)     { BYTE v;    get_bytes(reader, &v, sizeof(v)); return v; }
+static WORD get_u16(Reader* reader)    { WORD v;    get_bytes(reader, &v, sizeof(v)); return v; }
+static DWORD get_u32(Reader* reader)   { DWORD v;   get_bytes(reader, &v, sizeof(v)); return v; }
+static LONG get_i32(Reader* reader)    { LONG v;    get_bytes(reader, &v, sizeof(v)); return v; }
+static ULONG64 get_u64(Reader* reader) { ULONG64 v; get_bytes(reader, &v, sizeof(v)); return v; }
+
+static char* get_string(Reader* reader) {
+    WORD length = get_u16(reader);
+    if (reader->failed || reader->length - reader->offset < length) {
+        reader->failed = true;
+        return NULL;
+    }
+
+    char* value = (char*)malloc((size_t)length + 1);
+    if (!value) {
+        reader->failed = true;
+        return NULL;
+    }
+    memcpy(value, reader->data + reader->offset, length);
+    value[length] = '\0';
+    reader->offset += length;
+    return value;
+}
+
+static void get_fields(Reader* reader, DisplayState* display, BYTE mask) {
+    if (mask & FIELD_POSITION_X)  display->position_x = get_i32(reader);
+    if (mask & FIELD_POSITION_Y)  display->position_y = get_i32(reader);
+    if (mask & FIELD_WIDTH)       display->width = get_u32(reader);
+    if (mask & FIELD_HEIGHT)      display->height = get_u32(reader);
+    if (mask & FIELD_ORIENTATION) display->orientation = get_u32(reader);
+    if (mask & FIELD_REFRESH)     display->refresh_hz = get_u32(reader);
+}
+
+static bool get_display(Reader* reader, DisplayState* display, const DisplaySetup* base) {
+    memset(display, 0, sizeof(DisplayState));
+
+    WORD base_index = base ? get_u16(reader) : NEW_DISPLAY;
+    if (base_index != NEW_DISPLAY) {
+        if (reader->failed || base_index >= base->count ||
+            !copy_display_state(display, &base->displays[base_index], NULL)) {
+            reader->failed = true;
+            return false;
+        }
+        get_fields(reader, display, get_u8(reader));
+        return !reader->failed;
+    }
+
+    display->stable_id = get_string(reader);
+    display->device_path = get_string(reader);
+    get_fields(reader, display, ALL_FIELDS);
+    return !reader->failed;
+}
+
+static bool get_record(Reader* reader, StoreRecord* record, const DisplaySetup* previous) {
+    memset(record, 0, sizeof(StoreRecord));
+
+    record->kind = get_u8(reader);
+    bool keyframe = get_u8(reader) != 0;
+    ULONG64 saved_at = get_u64(reader);
+    record->saved_at.dwLowDateTime = (DWORD)saved_at;
+    record->saved_at.dwHighDateTime = (DWORD)(saved_at >> 32);
+    record->name = get_string(reader);
+    record->undo_count = get_u32(reader);
+    WORD display_count = get_u16(reader);
+
+    if (reader->failed || record->kind < RECORD_SNAPSHOT || record->kind > RECORD_UNDO ||
+        (!keyframe && !previous)) {
+        return false;
+    }
+    if (record->kind == RECORD_UNDO) {
+        return true;
+    }
+
+    record->setup = allocate_setup(display_count, NULL);
+    if (!record->setup) return false;
+
+    for (WORD i = 0; i < display_count; i++) {
+        DisplayState* display = &record->setup->displays[record->setup->count];
+        bool ok = get_display(reader, display, keyframe ? NULL : previous);
+        record->setup->count++;     // Counted either way so partial strings are freed
+        if (!ok) return false;
+    }
+    return true;
+}
+
+static void free_record(StoreRecord* record) {
+    free(record->name);
+    free_display_setup(record->setup, NULL);
+}
+
+static void free_store(SnapshotStore* store) {
+    for (int i = 0; i < store->count; i++) {
+        free_record(&store->records[i]);
+    }
+    free(store->records);
+}
+
+static bool push_record(SnapshotStore* store, const StoreRecord* record) {
+    if (store->count == store->capacity) {
+        int capacity = store->capacity ? store->capacity * 2 : 32;
+        StoreRecord* records = (StoreRecord*)realloc(store->records, capacity * sizeof(StoreRecord));
+        if (!records) return false;
+        store->records = records;
+        store->capacity = capacity;
+    }
+    store->records[store->count++] = *record;
+    return true;
+}
+
+static const DisplaySetup* last_setup(const SnapshotStore* store) {
+    for (int i = store->count - 1; i >= 0; i--) {
+        if (store->records[i].setup) return store->records[i].setup;
+    }
+    return NULL;
+}
+
+// Store file
+static char* get_snapshot_store_path() {
+    return get_local_data_path("snapshots.db");
+}
+
+// Reads every intact record. A missing file is an empty store; a damaged
+// record ends the store there, as if the interrupted write never happened.
+static void load_store(const char* path, SnapshotStore* store) {
+    memset(store, 0, sizeof(SnapshotStore));
+
+    FILE* file = NULL;
+    if (fopen_s(&file, path, "rb") != 0 || !file) return;
+
+    fseek(file, 0, SEEK_END);
+    long file_size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    BYTE* data = (file_size > 0 && file_size <= SNAPSHOT_STORE_MAX_SIZE) ? (BYTE*)malloc((size_t)file_size) : NULL;
+    size_t size = data ? fread(data, 1, (size_t)file_size, file) : 0;
+    fclose(file);
+
+    Reader reader = { data, size, 0, false };
+    char magic[SNAPSHOT_STORE_MAGIC_SIZE];
+    get_bytes(&reader, magic, sizeof(magic));
+    DWORD version = get_u32(&reader);
+    if (reader.failed || memcmp(magic, SNAPSHOT_STORE_MAGIC, SNAPSHOT_STORE_MAGIC_SIZE) != 0 ||
+        version != SNAPSHOT_STORE_VERSION) {
+        if (data) log_error("Ignoring unrecognized snapshot store: %s", path);
+        free(data);
+        return;
+    }
+
+    while (reader.offset < reader.length) {
+        size_t record_start = reader.offset;
+        DWORD body_length = get_u32(&reader);
+        DWORD checksum = get_u32(&reader);
+        if (reader.failed || reader.length - reader.offset < body_length ||
+            (DWORD)hash_bytes(HASH_SEED, reader.data + reader.offset, body_length) != checksum) {
+            log_verbose("Snapshot store ends with a damaged record at offset %zu", record_start);
+            break;
+        }
+
+        Reader body = { reader.data + reader.offset, body_length, 0, false };
+        reader.offset += body_length;
+
+        StoreRecord record;
+        if (!get_record(&body, &record, last_setup(store)) || body.offset != body.length ||
+            !push_record(store, &record)) {
+            free_record(&record);
+            log_verbose("Snapshot store has an undecodable record at offset %zu", record_start);
+            break;
+        }
+
+        if (record.setup) {
+            store->since_keyframe = (body.data[1] != 0) ? 0 : store->since_keyframe + 1;
+        }
+        store->file_size = (long)reader.offset;
+    }
+
+    free(data);
+}
+
+// Record indices of the undo stack, oldest first
+static int* undo_stack(const SnapshotStore* store, int* out_depth) {
+    int* stack = (int*)malloc((store->count > 0 ? store->count : 1) * sizeof(int));
+    int depth = 0;
+
+    for (int i = 0; stack && i < store->count; i++) {
+        const StoreRecord* record = &store->records[i];
+        if (record->kind == RECORD_JOURNAL) {
+            stack[depth++] = i;
+        } else if (record->kind == RECORD_UNDO) {
+            depth -= (record->undo_count < (DWORD)depth) ? (int)record->undo_count : depth;
+        }
+    }
+
+    *out_depth = depth;
+    return stack;
+}
+
+static bool write_header(Buffer* buffer) {
+    DWORD version = SNAPSHOT_STORE_VERSION;
+    put_bytes(buffer, SNAPSHOT_STORE_MAGIC, SNAPSHOT_STORE_MAGIC_SIZE);
+    put_u32(buffer, version);
+    return !buffer->failed;
+}
+
+static bool write_file(const char* path, const char* mode, const Buffer* buffer) {
+    FILE* file = NULL;
+    if (fopen_s(&file, path, mode) != 0 || !file) return false;
+
+    bool success = fwrite(buffer->data, 1, buffer->length, file) == buffer->length;
+    return (fclose(file) == 0) && success;
+}
+
+// Rewrites the store with the latest snapshot of each name and the newest
+// undo entries, re-encoding the deltas, then swaps it in
+static bool compact_store(const char* path, const SnapshotStore* store, const StoreRecord* extra) {
+    int depth = 0;
+    int* stack = undo_stack(store, &depth);
+    bool* keep = (bool*)calloc(store->count > 0 ? store->count : 1, sizeof(bool));
+    if (!stack || !keep) {
+        free(stack);
+        free(keep);
+        return false;
+    }
+
+    // An undo that triggers compaction is not written itself; drop what it pops
+    if (extra && extra->kind == RECORD_UNDO) {
+        depth -= (extra->undo_count < (DWORD)depth) ? (int)extra->undo_count : depth;
+    }
+
+    for (int i = 0; i < store->count; i++) {
+        const StoreRecord* record = &store->records[i];
+        if (record->kind != RECORD_SNAPSHOT) continue;
+
+        bool superseded = false;
+        for (int j = i + 1; j < store->count && !superseded; j++) {
+            superseded = store->records[j].kind == RECORD_SNAPSHOT &&
+                         strcmp(store->records[j].name, record->name) == 0;
+        }
+        keep[i] = !superseded && !(extra && extra->kind == RECORD_SNAPSHOT && strcmp(extra->name, record->name) == 0);
+    }
+    for (int i = (depth > SNAPSHOT_STORE_KEEP_JOURNAL) ? depth - SNAPSHOT_STORE_KEEP_JOURNAL : 0; i < depth; i++) {
+        keep[stack[i]] = true;
+    }
+
+    Buffer buffer = { NULL, 0, 0, false };
+    write_header(&buffer);
+
+    const DisplaySetup* base = NULL;
+    int since_keyframe = 0;
+    for (int i = 0; i <= store->count; i++) {
+        const StoreRecord* record = (i < store->count) ? (keep[i] ? &store->records[i] : NULL) : extra;
+        if (!record || !record->setup) continue;
+
+        bool keyframe = !base || since_keyframe >= SNAPSHOT_KEYFRAME_INTERVAL - 1;
+        put_record(&buffer, record, keyframe ? NULL : base);
+        since_keyframe = keyframe ? 0 : since_keyframe + 1;
+        base = record->setup;
+    }
+
+    free(stack);
+    free(keep);
+
+    size_t temp_len = strlen(path) + 32;
+    char* temp_path = (char*)malloc(temp_len);
+    bool success = !buffer.failed && temp_path;
+    if (success) {
+        sprintf_s(temp_path, temp_len, "%s.%lu.tmp", path, GetCurrentProcessId());
+        success = write_file(temp_path, "wb", &buffer) &&
+                  MoveFileExA(temp_path, path, MOVEFILE_REPLACE_EXISTING);
+        if (!success) {
+            DeleteFileA(temp_path);
+        }
+    }
+
+    log_verbose("Compacted snapshot store to %zu bytes", buffer.length);
+    free(temp_path);
+    free(buffer.data);
+    return success;
+}
+
+static bool append_record(const StoreRecord* record) {
+    char* path = get_snapshot_store_path();
+    if (!path) return false;
+
+    SnapshotStore store;
+    load_store(path, &store);
+
+    bool success;
+    if (store.count + 1 > SNAPSHOT_STORE_COMPACT_RECORDS) {
+        success = compact_store(path, &store, record);
+    } else {
+        Buffer buffer = { NULL, 0, 0, false };
+        const DisplaySetup* base = last_setup(&store);
+        bool keyframe = !base || store.since_keyframe >= SNAPSHOT_KEYFRAME_INTERVAL - 1;
+
+        // A fresh or damaged store is rewritten from its intact prefix
+        bool rewrite = store.file_size == 0;
+        if (rewrite) {
+            write_header(&buffer);
+        }
+        put_record(&buffer, record, (keyframe || !record->setup) ? NULL : base);
+
+        success = !buffer.failed;
+        if (success && rewrite) {
+            success = write_file(path, "wb", &buffer);
+        } else if (success) {
+            // Drop any torn tail before appending
+            FILE* file = NULL;
+            success = fopen_s(&file, path, "r+b") == 0 && file;
+            if (success) {
+                success = fseek(file, store.file_size, SEEK_SET) == 0 &&
+                          fwrite(buffer.data, 1, buffer.length, file) == buffer.length;
+                success = (fclose(file) == 0) && success;
+            }
+        }
+        free(buffer.data);
+    }
+
+    if (!success) {
+        log_error("Failed to update snapshot store: %s", path);
+    }
+
+    free_store(&store);
+    free(path);
+    return success;
+}
+
+// Store operations
+bool snapshot_store_save(const char* name, const DisplaySetup* setup) {
+    if (!setup) return false;
+
+    StoreRecord record;
+    memset(&record, 0, sizeof(record));
+    record.kind = name ? RECORD_SNAPSHOT : RECORD_JOURNAL;
+    record.name = (char*)(name ? name : "");
+    record.setup = (DisplaySetup*)setup;
+    GetSystemTimeAsFileTime(&record.saved_at);
+
+    return append_record(&record);
+}
+
+DisplaySetup* snapshot_store_find(const char* name) {
+    char* path = get_snapshot_store_path();
+    if (!path) return NULL;
+
+    SnapshotStore store;
+    load_store(path, &store);
+
+    DisplaySetup* setup = NULL;
+    for (int i = store.count - 1; i >= 0; i--) {
+        const StoreRecord* record = &store.records[i];
+        if (record->kind == RECORD_SNAPSHOT && (!name || strcmp(record->name, name) == 0)) {
+            setup = clone_display_setup(record->setup, NULL);
+            break;
+        }
+    }
+
+    free_store(&store);
+    free(path);
+    return setup;
+}
+
+DisplaySetup* snapshot_store_undo_target(int depth, int* out_available) {
+    if (out_available) *out_available = 0;
+
+    char* path = get_snapshot_store_path();
+    if (!path) return NULL;
+
+    SnapshotStore store;
+    load_store(path, &store);
+
+    int available = 0;
+    int* stack = undo_stack(&store, &available);
+    DisplaySetup* setup = NULL;
+    if (stack && depth >= 1 && depth <= available) {
+        setup = clone_display_setup(store.records[stack[available - depth]].setup, NULL);
+    }
+    if (out_available) *out_available = available;
+
+    free(stack);
+    free_store(&store);
+    free(path);
+    return setup;
+}
+
+bool snapshot_store_pop_undo(int depth) {
+    if (depth < 1) return false;
+
+    StoreRecord record;
+    memset(&record, 0, sizeof(record));
+    record.kind = RECORD_UNDO;
+    record.name = "";
+    record.undo_count = (DWORD)depth;
+    GetSystemTimeAsFileTime(&record.saved_at);
+
+    return append_record(&record);
+}
+
+SnapshotListing* snapshot_store_list() {
+    char* path = get_snapshot_store_path();
+    if (!path) return NULL;
+
+    SnapshotStore store;
+    load_store(path, &store);
+
+    SnapshotListing* listing = (SnapshotListing*)calloc(1, sizeof(SnapshotListing));
+    if (listing && store.count > 0) {
+        listing->snapshots = (SnapshotSummary*)calloc(store.count, sizeof(SnapshotSummary));
+    }
+
+    for (int i = 0; listing && listing->snapshots && i < store.count; i++) {
+        const StoreRecord* record = &store.records[i];
+        if (record->kind != RECORD_SNAPSHOT) continue;
+
+        // Replace an older snapshot of the same name, keeping list order by save time
+        for (int j = 0; j < listing->count; j++) {
+            if (strcmp(listing->snapshots[j].name, record->name) == 0) {
+                free(listing->snapshots[j].name);
+                memmove(&listing->snapshots[j], &listing->snapshots[j + 1],
+                        (listing->count - j - 1) * sizeof(SnapshotSummary));
+                listing->count--;
+                break;
+            }
+        }
+
+        SnapshotSummary* summary = &listing->snapshots[listing->count];
+        summary->name = _strdup(record->name);
+        summary->saved_at = record->saved_at;
+        summary->display_count = record->setup->count;
+        if (summary->name) listing->count++;
+    }
+
+    if (listing) {
+        int* stack = undo_stack(&store, &listing->undo_depth);
+        free(stack);
+        listing->record_count = store.count;
+        listing->file_size = store.file_size;
+    }
+
+    free_store(&store);
+    free(path);
+    return listing;
+}
+
+void free_snapshot_listing(SnapshotListing* listing) {
+    if (!listing) return;
+
+    for (int i = 0; i < listing->count; i++) {
+        free(listing->snapshots[i].name);
+    }
+    free(listing->snapshots);
+    free(listing);
+}
+
+// Restore
+static const MonitorInfo* find_current_monitor(const MonitorList* current, const DisplayState* display) {
+    const MonitorInfo* monitor = find_monitor_by_stable_id(current, display->stable_id);
+    return monitor ? monitor : find_monitor_by_device_path(current, display->device_path);
+}
+
+static void log_staged_change(const MonitorInfo* monitor, const DisplayState* display, bool dry_run) {
+    log_info("%s %s: %lux%lu %s @%ldHz at (%ld,%ld)", dry_run ? "[DRY RUN] Would restore" : "Restoring",
+             monitor->id, display->width, display->height, get_orientation_string(display->orientation),
+             (long)display->refresh_hz, display->position_x, display->position_y);
+}
+
+bool restore_display_setup(const MonitorList* current, const DisplaySetup* target,
+                           bool dry_run, int* out_changed) {
+    if (out_changed) *out_changed = 0;
+    if (!current || !target) return false;
+
+    bool success = true;
+    int staged = 0;
+    HistoryEntry* changes = dry_run ? NULL : (HistoryEntry*)malloc(target->count * sizeof(HistoryEntry));
+    int change_count = 0;
+    if (!dry_run && !changes) {
+        log_error("Failed to allocate memory for history; these changes will not be recorded");
+    }
+
+    for (int i = 0; i < target->count; i++) {
+        const DisplayState* display = &target->displays[i];
+        const MonitorInfo* monitor = find_current_monitor(current, display);
+        if (!monitor) {
+            log_info("Skipping %s (%s): not connected", display->stable_id, display->device_path);
+            continue;
+        }
+
+        DisplayState now = {
+            monitor->stable_id, monitor->device_path, monitor->position_x, monitor->position_y,
+            monitor->width, monitor->height, monitor->orientation, monitor->refresh_hz
+        };
+        BYTE mask = changed_fields(&now, display);
+        if (mask == 0) continue;
+
+        log_staged_change(monitor, display, dry_run);
+        staged++;
+        if (dry_run) continue;
+
+        DEVMODEA devmode;
+        memset(&devmode, 0, sizeof(DEVMODEA));
+        devmode.dmSize = sizeof(DEVMODEA);
+        if (!EnumDisplaySettingsExA(monitor->device_path, ENUM_CURRENT_SETTINGS, &devmode, 0)) {
+            log_error("Failed to get current display settings for %s", monitor->device_path);
+            success = false;
+            continue;
+        }
+
+        devmode.dmFields = 0;
+        if (mask & (FIELD_POSITION_X | FIELD_POSITION_Y)) {
+            devmode.dmPosition.x = display->position_x;
+            devmode.dmPosition.y = display->position_y;
+            devmode.dmFields |= DM_POSITION;
+        }
+        if (mask & (FIELD_WIDTH | FIELD_HEIGHT)) {
+            devmode.dmPelsWidth = display->width;
+            devmode.dmPelsHeight = display->height;
+            devmode.dmFields |= DM_PELSWIDTH | DM_PELSHEIGHT;
+        }
+        if (mask & FIELD_ORIENTATION) {
+            devmode.dmDisplayOrientation = display->orientation;
+            devmode.dmFields |= DM_DISPLAYORIENTATION;
+        }
+        if (mask & FIELD_REFRESH) {
+            devmode.dmDisplayFrequency = display->refresh_hz;
+            devmode.dmFields |= DM_DISPLAYFREQUENCY;
+        }
+
+        // Staged in the registry only; committed together below
+        HistoryEntry change;
+        LONG64 started = history_begin(&change, HISTORY_RESTORE, monitor->device_path, monitor->stable_id);
+        LONG result = ChangeDisplaySettingsExA(monitor->device_path, &devmode, NULL,
+                                               CDS_UPDATEREGISTRY | CDS_GLOBAL | CDS_NORESET, NULL);
+        if (changes) {
+            history_finish(&change, started, result);
+            change.old_orientation = now.orientation;
+            change.old_width = now.width;
+            change.old_height = now.height;
+            change.new_orientation = display->orientation;
+            change.new_width = display->width;
+            change.new_height = display->height;
+            changes[change_count++] = change;
+        }
+        if (result != DISP_CHANGE_SUCCESSFUL) {
+            log_error("Failed to stage settings for %s: error code %ld", monitor->id, result);
+            success = false;
+        }
+    }
+
+    if (!dry_run && staged > 0) {
+        HistoryEntry commit;
+        LONG64 started = history_begin(&commit, HISTORY_RESTORE, NULL, NULL);
+        LONG result = ChangeDisplaySettingsExA(NULL, NULL, NULL, 0, NULL);
+        history_finish(&commit, started, result);
+        if (result != DISP_CHANGE_SUCCESSFUL) {
+            log_error("Failed to apply restored display settings: error code %ld", result);
+            success = false;
+        }
+
+        // Every staged monitor changes in the one commit, so each carries its cost
+        for (int i = 0; i < change_count; i++) {
+            changes[i].latency_us += commit.latency_us;
+            if (changes[i].error_code == DISP_CHANGE_SUCCESSFUL) {
+                changes[i].error_code = result;
+            }
+        }
+    }
+
+    history_append(changes, change_count);
+    free(changes);
+
+    if (out_changed) *out_changed = staged;
+    return success;
+}
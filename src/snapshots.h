@@ -0,0 +1,71 @@
+#ifndef SNAPSHOTS_H
+#define SNAPSHOTS_H
+
+#include <stdbool.h>
+#include "enum.h"
+#include "util.h"
+
+// Complete display state of one monitor, as saved and restored
+typedef struct {
+    char* stable_id;        // Preferred match on restore (survives M# renumbering)
+    char* device_path;      // Fallback match
+    LONG position_x;
+    LONG position_y;
+    DWORD width;
+    DWORD height;
+    DWORD orientation;      // DMDO_*
+    DWORD refresh_hz;
+} DisplayState;
+
+typedef struct {
+    DisplayState* displays;
+    int count;
+} DisplaySetup;
+
+// allocator: NULL = CRT heap. Setups returned by the store below use the CRT heap.
+DisplaySetup* capture_display_setup(const MonitorList* monitors, const MosDefAllocator* allocator);
+void free_display_setup(DisplaySetup* setup, const MosDefAllocator* allocator);
+
+// Snapshot store: an append-only file in %LOCALAPPDATA%\MOS-DEF\snapshots.db.
+// Every record holds a whole DisplaySetup, delta-encoded against the record
+// before it (only changed fields of changed monitors are written), with a
+// full keyframe every SNAPSHOT_KEYFRAME_INTERVAL records. Records carry a
+// length and checksum; a torn tail from an interrupted write is ignored.
+//
+// Named snapshots are saved by the user. Journal records hold the state
+// before each change and form the undo stack; undo pops them with a marker
+// record. Past SNAPSHOT_STORE_COMPACT_RECORDS records the file is rewritten
+// with the latest snapshot of each name and the newest undo entries.
+#define SNAPSHOT_KEYFRAME_INTERVAL 32
+#define SNAPSHOT_STORE_COMPACT_RECORDS 1024
+#define SNAPSHOT_STORE_KEEP_JOURNAL 64
+
+typedef struct {
+    char* name;
+    FILETIME saved_at;
+    int display_count;
+} SnapshotSummary;
+
+typedef struct {
+    SnapshotSummary* snapshots;     // Latest per name, oldest first
+    int count;
+    int undo_depth;                 // Journal entries available to undo
+    int record_count;
+    long file_size;
+} SnapshotListing;
+
+bool snapshot_store_save(const char* name, const DisplaySetup* setup);     // NULL name journals
+DisplaySetup* snapshot_store_find(const char* name);                       // NULL for the latest named
+DisplaySetup* snapshot_store_undo_target(int depth, int* out_available);   // depth 1 = last change
+bool snapshot_store_pop_undo(int depth);
+SnapshotListing* snapshot_store_list();
+void free_snapshot_listing(SnapshotListing* listing);
+
+// Restore: compares target with the current topology and stages only the
+// differing fields with CDS_NORESET, then commits them in one mode change.
+// Monitors not present in the current topology are skipped. Returns false if
+// any change failed; out_changed receives the number of monitors staged.
+bool restore_display_setup(const MonitorList* current, const DisplaySetup* target,
+                           bool dry_run, int* out_changed);
+
+#endif // SNAPSHOTS_H
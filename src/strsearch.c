@@ -0,0 +1,125 @@
+#include "strsearch.h"
+#include <windows.h>
+#include <string.h>
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// The vector kernels compare the needle's first and last bytes against 16 or
+// 32 candidate positions at once and only memcmp the positions where both
+// agree. x64 always has SSE2; AVX2 is used where the CPU and OS report it.
+
+#ifndef PF_AVX2_INSTRUCTIONS_AVAILABLE
+#define PF_AVX2_INSTRUCTIONS_AVAILABLE 40
+#endif
+
+#ifdef _MSC_VER
+#define STRSEARCH_TARGET_AVX2
+static unsigned lowest_bit(unsigned mask) {
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+}
+#else
+#define STRSEARCH_TARGET_AVX2 __attribute__((target("avx2")))
+static unsigned lowest_bit(unsigned mask) {
+    return (unsigned)__builtin_ctz(mask);
+}
+#endif
+
+void strsearch_fold(char* dst, const char* src, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        char c = src[i];
+        dst[i] = (c >= 'A' && c <= 'Z') ? (char)(c + ('a' - 'A')) : c;
+    }
+}
+
+bool strsearch_contains_scalar(const char* haystack, size_t haystack_length,
+                               const char* needle, size_t needle_length) {
+    if (needle_length == 0) return true;
+    if (needle_length > haystack_length) return false;
+
+    const char* end = haystack + haystack_length - needle_length + 1;
+    for (const char* p = haystack; p < end; p++) {
+        p = (const char*)memchr(p, needle[0], end - p);
+        if (!p) return false;
+        if (memcmp(p, needle, needle_length) == 0) return true;
+    }
+    return false;
+}
+
+// Checks the candidates in mask (bit i = position base + i)
+static bool verify_candidates(unsigned mask, const char* base, const char* needle, size_t needle_length) {
+    while (mask) {
+        unsigned bit = lowest_bit(mask);
+        if (memcmp(base + bit + 1, needle + 1, needle_length - 1) == 0) return true;
+        mask &= mask - 1;
+    }
+    return false;
+}
+
+bool strsearch_contains_sse2(const char* haystack, size_t haystack_length,
+                             const char* needle, size_t needle_length) {
+    if (needle_length == 0) return true;
+    if (needle_length > haystack_length) return false;
+
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[needle_length - 1]);
+    size_t candidates = haystack_length - needle_length + 1;
+
+    for (size_t i = 0; i < candidates; i += 16) {
+        __m128i block_first = _mm_loadu_si128((const __m128i*)(haystack + i));
+        __m128i block_last = _mm_loadu_si128((const __m128i*)(haystack + i + needle_length - 1));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, block_first),
+                                                                  _mm_cmpeq_epi8(last, block_last)));
+        if (candidates - i < 16) {
+            mask &= (1u << (candidates - i)) - 1;
+        }
+        if (verify_candidates(mask, haystack + i, needle, needle_length)) return true;
+    }
+    return false;
+}
+
+STRSEARCH_TARGET_AVX2
+bool strsearch_contains_avx2(const char* haystack, size_t haystack_length,
+                             const char* needle, size_t needle_length) {
+    if (needle_length == 0) return true;
+    if (needle_length > haystack_length) return false;
+
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[needle_length - 1]);
+    size_t candidates = haystack_length - needle_length + 1;
+
+    for (size_t i = 0; i < candidates; i += 32) {
+        __m256i block_first = _mm256_loadu_si256((const __m256i*)(haystack + i));
+        __m256i block_last = _mm256_loadu_si256((const __m256i*)(haystack + i + needle_length - 1));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(first, block_first),
+                                                                        _mm256_cmpeq_epi8(last, block_last)));
+        if (candidates - i < 32) {
+            mask &= (1u << (candidates - i)) - 1;
+        }
+        if (verify_candidates(mask, haystack + i, needle, needle_length)) return true;
+    }
+    return false;
+}
+
+bool strsearch_has_avx2() {
+    static volatile LONG s_has_avx2 = -1; // Unknown until first use; the race is benign
+    if (s_has_avx2 < 0) {
+        s_has_avx2 = IsProcessorFeaturePresent(PF_AVX2_INSTRUCTIONS_AVAILABLE) ? 1 : 0;
+    }
+    return s_has_avx2 == 1;
+}
+
+bool strsearch_folded_contains(const char* haystack, size_t haystack_length,
+                               const char* needle, size_t needle_length) {
+    // Short haystacks are cheaper without the vector setup
+    if (haystack_length < 16) {
+        return strsearch_contains_scalar(haystack, haystack_length, needle, needle_length);
+    }
+    if (haystack_length >= 32 && strsearch_has_avx2()) {
+        return strsearch_contains_avx2(haystack, haystack_length, needle, needle_length);
+    }
+    return strsearch_contains_sse2(haystack, haystack_length, needle, needle_length);
+}
@@ -0,0 +1,29 @@
+#ifndef STRSEARCH_H
+#define STRSEARCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Substring search over case-folded (ASCII lower-case) text. The haystack
+// must stay readable for STRSEARCH_PADDING bytes past its end, so vector
+// loads never need a scalar tail; interned name tables are laid out that way.
+#define STRSEARCH_PADDING 32
+
+// Lower-cases length bytes of src into dst (ASCII only, like str_to_lower)
+void strsearch_fold(char* dst, const char* src, size_t length);
+
+// Dispatches once to AVX2, SSE2 or the scalar loop. Both inputs are folded.
+bool strsearch_folded_contains(const char* haystack, size_t haystack_length,
+                               const char* needle, size_t needle_length);
+
+// Individual kernels, for differential checks against the scalar loop. The
+// AVX2 kernel must only run where strsearch_has_avx2() is true.
+bool strsearch_contains_scalar(const char* haystack, size_t haystack_length,
+                               const char* needle, size_t needle_length);
+bool strsearch_contains_sse2(const char* haystack, size_t haystack_length,
+                             const char* needle, size_t needle_length);
+bool strsearch_contains_avx2(const char* haystack, size_t haystack_length,
+                             const char* needle, size_t needle_length);
+bool strsearch_has_avx2();
+
+#endif // STRSEARCH_H
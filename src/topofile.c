@@ -0,0 +1,509 @@
+#include "topofile.h"
+#include "config.h"
+#include "util.h"
+#include "modeldb.h"
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TOPOLOGY_FILE_MAX_SIZE (16 * 1024 * 1024)
+
+// Export
+typedef struct {
+    char* data;
+    size_t length;
+    size_t capacity;
+    bool failed;
+} JsonWriter;
+
+static void write_text(JsonWriter* writer, const char* text, size_t size) {
+    if (writer->failed) return;
+
+    if (writer->length + size + 1 > writer->capacity) {
+        size_t capacity = writer->capacity ? writer->capacity * 2 : 1024;
+        while (capacity < writer->length + size + 1) {
+            capacity *= 2;
+        }
+        char* grown = (char*)realloc(writer->data, capacity);
+        if (!grown) {
+            writer->failed = true;
+            return;
+        }
+        writer->data = grown;
+        writer->capacity = capacity;
+    }
+
+    memcpy(writer->data + writer->length, text, size);
+    writer->length += size;
+    writer->data[writer->length] = '\0';
+}
+
+static void write_string_field(JsonWriter* writer, const char* name, const char* value, bool last) {
+    char* escaped = json_escape_string(value ? value : "");
+    if (!escaped) {
+        writer->failed = true;
+        return;
+    }
+
+    char prefix[48];
+    int len = sprintf_s(prefix, sizeof(prefix), "      \"%s\": ", name);
+    write_text(writer, prefix, (size_t)len);
+    write_text(writer, escaped, strlen(escaped));
+    write_text(writer, last ? "\n" : ",\n", last ? 1 : 2);
+    free(escaped);
+}
+
+static void write_number_field(JsonWriter* writer, const char* name, LONG64 value, bool last) {
+    char field[80];
+    int len = sprintf_s(field, sizeof(field), "      \"%s\": %lld%s\n", name, value, last ? "" : ",");
+    write_text(writer, field, (size_t)len);
+}
+
+char* topology_to_json(const MonitorList* monitors) {
+    if (!monitors) return NULL;
+
+    JsonWriter writer = { NULL, 0, 0, false };
+    char header[64];
+    int len = sprintf_s(header, sizeof(header), "{\n  \"version\": %d,\n  \"monitors\": [", TOPOLOGY_FILE_VERSION);
+    write_text(&writer, header, (size_t)len);
+
+    for (int i = 0; i < monitors->count; i++) {
+        const MonitorInfo* monitor = &monitors->monitors[i];
+
+        write_text(&writer, i > 0 ? ",\n    {\n" : "\n    {\n", i > 0 ? 8 : 7);
+        write_string_field(&writer, "id", monitor->id, false);
+        write_string_field(&writer, "device_name", monitor->device_name, false);
+        write_string_field(&writer, "device_path", monitor->device_path, false);
+        write_string_field(&writer, "device_id", monitor->device_id, false);
+        write_string_field(&writer, "monitor_interface", monitor->monitor_interface, false);
+        write_string_field(&writer, "stable_id", monitor->stable_id, false);
+        write_string_field(&writer, "model_name", monitor->model_name, false);
+        write_number_field(&writer, "width", monitor->width, false);
+        write_number_field(&writer, "height", monitor->height, false);
+        write_number_field(&writer, "orientation", get_orientation_degrees(monitor->orientation), false);
+        write_number_field(&writer, "position_x", monitor->position_x, false);
+        write_number_field(&writer, "position_y", monitor->position_y, false);
+        write_number_field(&writer, "refresh_hz", monitor->refresh_hz, false);
+        write_number_field(&writer, "native_width", monitor->native_width, false);
+        write_number_field(&writer, "native_height", monitor->native_height, false);
+        write_number_field(&writer, "width_mm", monitor->width_mm, false);
+        write_number_field(&writer, "height_mm", monitor->height_mm, false);
+        write_number_field(&writer, "preferred_orientation",
+                           monitor->preferred_orientation == MODEL_ORIENTATION_NONE
+                               ? -1 : (LONG64)get_orientation_degrees(monitor->preferred_orientation), false);
+        write_number_field(&writer, "model_flags", monitor->model_flags, true);
+        write_text(&writer, "    }", 5);
+    }
+
+    write_text(&writer, monitors->count > 0 ? "\n  ]\n}\n" : "]\n}\n", monitors->count > 0 ? 7 : 4);
+
+    if (writer.failed) {
+        log_error("Failed to encode topology");
+        free(writer.data);
+        return NULL;
+    }
+    return writer.data;
+}
+
+bool save_topology_file(const MonitorList* monitors, const char* path) {
+    if (!monitors || !path) return false;
+
+    char* json = topology_to_json(monitors);
+    if (!json) return false;
+
+    FILE* file = NULL;
+    if (fopen_s(&file, path, "wb") != 0 || !file) {
+        log_error("Failed to open topology file for writing: %s", path);
+        free(json);
+        return false;
+    }
+
+    size_t length = strlen(json);
+    bool success = fwrite(json, 1, length, file) == length;
+    success = (fclose(file) == 0) && success;
+    free(json);
+
+    if (!success) {
+        log_error("Failed to write topology file: %s", path);
+    }
+    return success;
+}
+
+// Import: a single-pass reader for the subset of JSON this format uses.
+// No intermediate tree; fields are decoded straight into MonitorInfo.
+typedef struct {
+    const char* p;
+    const char* end;
+    bool failed;
+} JsonCursor;
+
+static void skip_whitespace(JsonCursor* cursor) {
+    while (cursor->p < cursor->end &&
+           (*cursor->p == ' ' || *cursor->p == '\t' || *cursor->p == '\n' || *cursor->p == '\r')) {
+        cursor->p++;
+    }
+}
+
+static bool consume(JsonCursor* cursor, char c) {
+    skip_whitespace(cursor);
+    if (cursor->p < cursor->end && *cursor->p == c) {
+        cursor->p++;
+        return true;
+    }
+    return false;
+}
+
+static void expect(JsonCursor* cursor, char c) {
+    if (!consume(cursor, c)) {
+        cursor->failed = true;
+    }
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Decodes a string; escapes that are not ASCII become '?'. out may be NULL to skip.
+static void parse_string(JsonCursor* cursor, char** out) {
+    if (out) *out = NULL;
+    if (!consume(cursor, '"')) {
+        cursor->failed = true;
+        return;
+    }
+
+    const char* start = cursor->p;
+    while (cursor->p < cursor->end && *cursor->p != '"') {
+        cursor->p += (*cursor->p == '\\' && cursor->p + 1 < cursor->end) ? 2 : 1;
+    }
+    if (cursor->p >= cursor->end) {
+        cursor->failed = true;
+        return;
+    }
+    const char* stop = cursor->p++;
+    if (!out) return;
+
+    // Decoding never grows the text
+    char* value = (char*)malloc((size_t)(stop - start) + 1);
+    if (!value) {
+        cursor->failed = true;
+        return;
+    }
+
+    char* dest = value;
+    for (const char* s = start; s < stop; s++) {
+        if (*s != '\\') {
+            *dest++ = *s;
+            continue;
+        }
+
+        s++;
+        switch (*s) {
+            case 'n': *dest++ = '\n'; break;
+            case 'r': *dest++ = '\r'; break;
+            case 't': *dest++ = '\t'; break;
+            case 'b': *dest++ = '\b'; break;
+            case 'f': *dest++ = '\f'; break;
+            case 'u': {
+                int code = 0;
+                for (int i = 1; i <= 4 && code >= 0; i++) {
+                    int digit = (s + i < stop) ? hex_value(s[i]) : -1;
+                    code = (digit < 0) ? -1 : code * 16 + digit;
+                }
+                if (code < 0) {
+                    free(value);
+                    cursor->failed = true;
+                    return;
+                }
+                *dest++ = (code > 0 && code < 0x80) ? (char)code : '?';
+                s += 4;
+                break;
+            }
+            default: *dest++ = *s; break;   // \" \\ \/
+        }
+    }
+    *dest = '\0';
+    *out = value;
+}
+
+static LONG64 parse_number(JsonCursor* cursor) {
+    skip_whitespace(cursor);
+
+    bool negative = cursor->p < cursor->end && *cursor->p == '-';
+    if (negative) cursor->p++;
+
+    const char* digits = cursor->p;
+    LONG64 value = 0;
+    while (cursor->p < cursor->end && *cursor->p >= '0' && *cursor->p <= '9') {
+        if (value > (LLONG_MAX - 9) / 10) {
+            cursor->failed = true;
+            return 0;
+        }
+        value = value * 10 + (*cursor->p++ - '0');
+    }
+    if (cursor->p == digits) {
+        cursor->failed = true;
+        return 0;
+    }
+
+    // Fractions and exponents are accepted and truncated
+    while (cursor->p < cursor->end && strchr(".eE+-0123456789", *cursor->p)) {
+        cursor->p++;
+    }
+    return negative ? -value : value;
+}
+
+static void skip_value(JsonCursor* cursor, int depth);
+
+static void skip_container(JsonCursor* cursor, char close, bool keyed, int depth) {
+    if (consume(cursor, close)) return;
+
+    do {
+        if (keyed) {
+            parse_string(cursor, NULL);
+            expect(cursor, ':');
+        }
+        skip_value(cursor, depth + 1);
+    } while (!cursor->failed && consume(cursor, ','));
+
+    expect(cursor, close);
+}
+
+static void skip_value(JsonCursor* cursor, int depth) {
+    skip_whitespace(cursor);
+    if (cursor->failed || cursor->p >= cursor->end || depth > 32) {
+        cursor->failed = true;
+        return;
+    }
+
+    switch (*cursor->p) {
+        case '"': parse_string(cursor, NULL); return;
+        case '{': cursor->p++; skip_container(cursor, '}', true, depth); return;
+        case '[': cursor->p++; skip_container(cursor, ']', false, depth); return;
+    }
+
+    static const char* const literals[] = { "true", "false", "null" };
+    for (int i = 0; i < 3; i++) {
+        size_t len = strlen(literals[i]);
+        if ((size_t)(cursor->end - cursor->p) >= len && memcmp(cursor->p, literals[i], len) == 0) {
+            cursor->p += len;
+            return;
+        }
+    }
+    parse_number(cursor);
+}
+
+static bool key_is(const char* key, const char* name) {
+    return strcmp(key, name) == 0;
+}
+
+static void parse_monitor(JsonCursor* cursor, MonitorInfo* monitor) {
+    memset(monitor, 0, sizeof(MonitorInfo));
+    monitor->preferred_orientation = MODEL_ORIENTATION_NONE;
+    expect(cursor, '{');
+    if (cursor->failed || consume(cursor, '}')) return;
+
+    do {
+        char* key = NULL;
+        parse_string(cursor, &key);
+        expect(cursor, ':');
+        if (cursor->failed) {
+            free(key);
+            return;
+        }
+
+        char** text = key_is(key, "id") ? &monitor->id :
+                      key_is(key, "device_name") ? &monitor->device_name :
+                      key_is(key, "device_path") ? &monitor->device_path :
+                      key_is(key, "device_id") ? &monitor->device_id :
+                      key_is(key, "monitor_interface") ? &monitor->monitor_interface :
+                      key_is(key, "stable_id") ? &monitor->stable_id :
+                      key_is(key, "model_name") ? &monitor->model_name : NULL;
+
+        if (text) {
+            free(*text);
+            parse_string(cursor, text);
+        } else if (key_is(key, "position_x")) {
+            monitor->position_x = (LONG)parse_number(cursor);
+        } else if (key_is(key, "position_y")) {
+            monitor->position_y = (LONG)parse_number(cursor);
+        } else if (key_is(key, "preferred_orientation")) {
+            LONG64 degrees = parse_number(cursor);
+            monitor->preferred_orientation = degrees < 0 ? MODEL_ORIENTATION_NONE : (DWORD)degrees;
+        } else {
+            DWORD* number = key_is(key, "width") ? &monitor->width :
+                            key_is(key, "height") ? &monitor->height :
+                            key_is(key, "orientation") ? &monitor->orientation :
+                            key_is(key, "refresh_hz") ? &monitor->refresh_hz :
+                            key_is(key, "native_width") ? &monitor->native_width :
+                            key_is(key, "native_height") ? &monitor->native_height :
+                            key_is(key, "width_mm") ? &monitor->width_mm :
+                            key_is(key, "height_mm") ? &monitor->height_mm :
+                            key_is(key, "model_flags") ? &monitor->model_flags : NULL;
+            if (number) {
+                *number = (DWORD)parse_number(cursor);
+            } else {
+                skip_value(cursor, 0);
+            }
+        }
+        free(key);
+    } while (!cursor->failed && consume(cursor, ','));
+
+    expect(cursor, '}');
+}
+
+// Fills optional strings, checks required fields and converts degrees to DMDO_*
+static bool finish_monitor(MonitorInfo* monitor) {
+    if (!monitor->id || !monitor->device_path || monitor->width == 0 || monitor->height == 0) {
+        return false;
+    }
+
+    char** optional[] = { &monitor->device_name, &monitor->device_id, &monitor->monitor_interface,
+                          &monitor->stable_id, &monitor->model_name };
+    for (size_t i = 0; i < sizeof(optional) / sizeof(optional[0]); i++) {
+        if (!*optional[i] && !(*optional[i] = _strdup(""))) return false;
+    }
+
+    switch (monitor->orientation) {
+        case 0:   monitor->orientation = DMDO_DEFAULT; break;
+        case 90:  monitor->orientation = DMDO_90; break;
+        case 180: monitor->orientation = DMDO_180; break;
+        case 270: monitor->orientation = DMDO_270; break;
+        default:  return false;
+    }
+
+    switch (monitor->preferred_orientation) {
+        case 0:   monitor->preferred_orientation = DMDO_DEFAULT; break;
+        case 90:  monitor->preferred_orientation = DMDO_90; break;
+        case 180: monitor->preferred_orientation = DMDO_180; break;
+        case 270: monitor->preferred_orientation = DMDO_270; break;
+        case MODEL_ORIENTATION_NONE: break;
+        default:  return false;
+    }
+    return true;
+}
+
+static void free_monitor_strings(MonitorInfo* monitor) {
+    free(monitor->id);
+    free(monitor->device_name);
+    free(monitor->device_path);
+    free(monitor->device_id);
+    free(monitor->monitor_interface);
+    free(monitor->stable_id);
+    free(monitor->model_name);
+}
+
+static bool append_monitor(MonitorList* list, int* capacity, JsonCursor* cursor) {
+    if (list->count == *capacity) {
+        int new_capacity = *capacity ? *capacity * 2 : 8;
+        MonitorInfo* monitors = (MonitorInfo*)realloc(list->monitors, new_capacity * sizeof(MonitorInfo));
+        if (!monitors) return false;
+        list->monitors = monitors;
+        *capacity = new_capacity;
+    }
+
+    MonitorInfo* monitor = &list->monitors[list->count];
+    parse_monitor(cursor, monitor);
+    if (cursor->failed || !finish_monitor(monitor)) {
+        free_monitor_strings(monitor);
+        return false;
+    }
+
+    list->count++;
+    return true;
+}
+
+MonitorList* parse_topology_json(const char* json, size_t length) {
+    if (!json) return NULL;
+
+    MonitorList* list = (MonitorList*)malloc(sizeof(MonitorList));
+    if (!list) return NULL;
+    list->monitors = NULL;
+    list->count = 0;
+    list->index = NULL;
+
+    JsonCursor cursor = { json, json + length, false };
+    LONG64 version = -1;
+    bool has_monitors = false;
+    int capacity = 0;
+    bool ok = true;
+
+    expect(&cursor, '{');
+    if (!cursor.failed && !consume(&cursor, '}')) {
+        do {
+            char* key = NULL;
+            parse_string(&cursor, &key);
+            expect(&cursor, ':');
+
+            if (cursor.failed) {
+                // Fall through to the error below
+            } else if (key_is(key, "version")) {
+                version = parse_number(&cursor);
+            } else if (key_is(key, "monitors")) {
+                has_monitors = true;
+                expect(&cursor, '[');
+                if (!cursor.failed && !consume(&cursor, ']')) {
+                    do {
+                        ok = append_monitor(list, &capacity, &cursor);
+                    } while (ok && consume(&cursor, ','));
+                    expect(&cursor, ']');
+                }
+            } else {
+                skip_value(&cursor, 0);
+            }
+            free(key);
+        } while (ok && !cursor.failed && consume(&cursor, ','));
+        expect(&cursor, '}');
+    }
+
+    if (!ok || cursor.failed || !has_monitors || version != TOPOLOGY_FILE_VERSION) {
+        log_error("Invalid topology JSON near offset %lld%s", (long long)(cursor.p - json),
+                  (!cursor.failed && ok && version != TOPOLOGY_FILE_VERSION) ? " (unsupported version)" : "");
+        free_monitor_list(list);
+        return NULL;
+    }
+
+    if (!build_monitor_index(list, NULL)) {
+        log_verbose("Failed to build monitor index, falling back to linear lookups");
+    }
+    return list;
+}
+
+MonitorList* load_topology_file(const char* path) {
+    if (!path) return NULL;
+
+    FILE* file = NULL;
+    if (fopen_s(&file, path, "rb") != 0 || !file) {
+        log_error("Failed to open topology file: %s", path);
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long file_size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    if (file_size <= 0 || file_size > TOPOLOGY_FILE_MAX_SIZE) {
+        log_error("Topology file has an invalid size: %s", path);
+        fclose(file);
+        return NULL;
+    }
+
+    char* json = (char*)malloc((size_t)file_size);
+    if (!json) {
+        fclose(file);
+        return NULL;
+    }
+
+    size_t length = fread(json, 1, (size_t)file_size, file);
+    fclose(file);
+
+    MonitorList* monitors = parse_topology_json(json, length);
+    if (!monitors) {
+        log_error("Failed to load topology file: %s", path);
+    }
+    free(json);
+    return monitors;
+}
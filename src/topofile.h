@@ -0,0 +1,31 @@
+#ifndef TOPOFILE_H
+#define TOPOFILE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "enum.h"
+
+// Saved topologies for offline selection and planning. A topology file is the
+// JSON form of a MonitorList:
+//
+//   { "version": 1, "monitors": [ { "id": "M1", "device_path": "\\\\.\\DISPLAY1",
+//     "stable_id": "DEL4085-1A2B3C4D", "width": 2560, "height": 1440,
+//     "orientation": 0, "position_x": 0, ... }, ... ] }
+//
+// Orientation is in degrees, as is preferred_orientation (-1 for none).
+// Every MonitorInfo field is written; on load only id, device_path, width and
+// height are required, unknown keys are skipped and missing ones default to
+// empty, zero or no preference. Loaded lists are indexed and
+// owned by the CRT heap (free_monitor_list).
+
+#define TOPOLOGY_FILE_VERSION 1
+
+bool save_topology_file(const MonitorList* monitors, const char* path);
+MonitorList* load_topology_file(const char* path);
+
+// In-memory forms. topology_to_json returns a CRT-heap string; the text
+// passed to parse_topology_json need not be NUL-terminated.
+char* topology_to_json(const MonitorList* monitors);
+MonitorList* parse_topology_json(const char* json, size_t length);
+
+#endif // TOPOFILE_H
@@ -0,0 +1,168 @@
+#include "topology.h"
+#include "enum.h"
+#include "util.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Packed word layout: x64 user-mode addresses fit in 47 bits, which leaves
+// the low 16 bits for the number of readers currently pinning the snapshot.
+#define PIN_BITS 16
+#define PIN_MASK ((LONG64)TOPOLOGY_MAX_ACTIVE_PINS)
+
+static TopologySnapshot* unpack_snapshot(LONG64 word) {
+    return (TopologySnapshot*)(uintptr_t)((ULONG64)word >> PIN_BITS);
+}
+
+static LONG64 pack_snapshot(const TopologySnapshot* snapshot) {
+    return (LONG64)((ULONG64)(uintptr_t)snapshot << PIN_BITS);
+}
+
+static TopologySnapshot* create_snapshot(MonitorList* monitors, ULONG64 generation) {
+    TopologySnapshot* snapshot = (TopologySnapshot*)malloc(sizeof(TopologySnapshot));
+    if (!snapshot) return NULL;
+
+    if (((ULONG64)(uintptr_t)snapshot >> (64 - PIN_BITS)) != 0) {
+        log_error("Topology snapshot address does not fit the packed reference word");
+        free(snapshot);
+        return NULL;
+    }
+
+    snapshot->monitors = monitors;
+    snapshot->generation = generation;
+    snapshot->retired_refs = 0;
+    return snapshot;
+}
+
+static void free_snapshot(TopologySnapshot* snapshot) {
+    free_monitor_list(snapshot->monitors);
+    free(snapshot);
+}
+
+// Hands the pins still held on a replaced snapshot over to its own counter.
+// Whoever brings that counter back to zero frees the snapshot.
+static void retire_snapshot(LONG64 old_word) {
+    TopologySnapshot* snapshot = unpack_snapshot(old_word);
+    if (!snapshot) return;
+
+    LONG64 active_pins = old_word & PIN_MASK;
+    if (InterlockedAdd64(&snapshot->retired_refs, active_pins) == 0) {
+        free_snapshot(snapshot);
+    }
+}
+
+static MonitorList* create_empty_monitor_list() {
+    MonitorList* list = (MonitorList*)malloc(sizeof(MonitorList));
+    if (list) {
+        list->monitors = NULL;
+        list->count = 0;
+        list->index = NULL;
+    }
+    return list;
+}
+
+// Store lifetime
+TopologyStore* topology_store_create() {
+    TopologyStore* store = (TopologyStore*)malloc(sizeof(TopologyStore));
+    if (!store) return NULL;
+
+    InitializeSRWLock(&store->writer_lock);
+    store->next_generation = 1;
+
+    // Readers always find a snapshot, starting with an empty topology
+    MonitorList* empty = create_empty_monitor_list();
+    TopologySnapshot* snapshot = empty ? create_snapshot(empty, 0) : NULL;
+    if (!snapshot) {
+        free_monitor_list(empty);
+        free(store);
+        return NULL;
+    }
+
+    store->current = pack_snapshot(snapshot);
+    return store;
+}
+
+void topology_store_destroy(TopologyStore* store) {
+    if (!store) return;
+
+    retire_snapshot(InterlockedExchange64(&store->current, 0));
+    free(store);
+}
+
+// Readers
+const TopologySnapshot* topology_store_pin(TopologyStore* store) {
+    if (!store) return NULL;
+
+    // A plain add would carry into the pointer bits past the last pin, so
+    // at the cap wait for a reader to release or a writer to publish
+    LONG64 word = ReadAcquire64(&store->current);
+    for (;;) {
+        if ((word & PIN_MASK) == PIN_MASK) {
+            YieldProcessor();
+            Sleep(0);
+            word = ReadAcquire64(&store->current);
+            continue;
+        }
+
+        LONG64 seen = InterlockedCompareExchange64(&store->current, word + 1, word);
+        if (seen == word) return unpack_snapshot(word);
+        word = seen;
+    }
+}
+
+void topology_store_release(TopologyStore* store, const TopologySnapshot* snapshot) {
+    if (!store || !snapshot) return;
+
+    TopologySnapshot* pinned = (TopologySnapshot*)snapshot;
+
+    // Still current: drop the pin from the packed word
+    LONG64 word = ReadAcquire64(&store->current);
+    while (unpack_snapshot(word) == pinned) {
+        LONG64 seen = InterlockedCompareExchange64(&store->current, word - 1, word);
+        if (seen == word) return;
+        word = seen;
+    }
+
+    // Retired by a writer: the pin now lives in the snapshot's own counter
+    if (InterlockedDecrement64(&pinned->retired_refs) == 0) {
+        free_snapshot(pinned);
+    }
+}
+
+// Writers
+bool topology_store_publish(TopologyStore* store, MonitorList* monitors) {
+    if (!store || !monitors) {
+        free_monitor_list(monitors);
+        return false;
+    }
+
+    AcquireSRWLockExclusive(&store->writer_lock);
+
+    TopologySnapshot* snapshot = create_snapshot(monitors, store->next_generation);
+    if (!snapshot) {
+        ReleaseSRWLockExclusive(&store->writer_lock);
+        free_monitor_list(monitors);
+        return false;
+    }
+    store->next_generation++;
+
+    log_verbose("Publishing topology generation %llu (%d monitors)",
+               (unsigned long long)snapshot->generation, monitors->count);
+
+    LONG64 old_word = InterlockedExchange64(&store->current, pack_snapshot(snapshot));
+    ReleaseSRWLockExclusive(&store->writer_lock);
+
+    retire_snapshot(old_word);
+    return true;
+}
+
+bool topology_store_refresh(TopologyStore* store) {
+    if (!store) return false;
+
+    MonitorList* monitors = enumerate_monitors();
+    if (!monitors) {
+        log_error("Failed to enumerate monitors for topology refresh");
+        return false;
+    }
+
+    return topology_store_publish(store, monitors);
+}
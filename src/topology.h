@@ -0,0 +1,40 @@
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include "enum.h"
+#include "util.h"
+#include <windows.h>
+
+// Immutable topology snapshot. Never modified after publication; freed when
+// the store has replaced it and the last reader has released it.
+typedef struct {
+    MonitorList* monitors;
+    ULONG64 generation;
+    volatile LONG64 retired_refs;   // Internal: pins transferred at retirement minus releases
+} TopologySnapshot;
+
+// Publishes snapshots to lock-free readers. The current snapshot pointer and
+// its active pin count share one 64-bit word, so pinning is a single
+// compare-and-swap (split reference counting). A pin waits only while
+// TOPOLOGY_MAX_ACTIVE_PINS readers already hold the current snapshot.
+typedef struct {
+    volatile LONG64 current;        // (snapshot pointer << 16) | active pins
+    SRWLOCK writer_lock;            // Serializes writers only
+    ULONG64 next_generation;
+} TopologyStore;
+
+#define TOPOLOGY_MAX_ACTIVE_PINS 0xFFFF
+
+// Store lifetime. All pins must be released before destroying the store.
+TopologyStore* topology_store_create();
+void topology_store_destroy(TopologyStore* store);
+
+// Readers
+const TopologySnapshot* topology_store_pin(TopologyStore* store);
+void topology_store_release(TopologyStore* store, const TopologySnapshot* snapshot);
+
+// Writers. publish takes ownership of the monitor list, even on failure.
+bool topology_store_publish(TopologyStore* store, MonitorList* monitors);
+bool topology_store_refresh(TopologyStore* store);
+
+#endif // TOPOLOGY_H
@@ -1,12 +1,16 @@
 #include "util.h"
+#include "selexpr.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
 #include <ctype.h>
+#include <stdint.h>
 
 bool g_verbose = false;
 
+static MOSDEF_THREAD_LOCAL const LogSink* t_log_sink = NULL;
+
 // RDP detection
 bool is_rdp_session() {
     const char* session_name = getenv("SESSIONNAME");
@@ -32,6 +36,21 @@ bool str_contains(const char* str, const char* substring) {
     return strstr(str, substring) != NULL;
 }
 
+bool str_contains_nocase(const char* str, const char* substring) {
+    if (!str || !substring) return false;
+
+    for (;; str++) {
+        const char* s = str;
+        const char* p = substring;
+        while (*p && tolower((unsigned char)*s) == tolower((unsigned char)*p)) {
+            s++;
+            p++;
+        }
+        if (!*p) return true;
+        if (!*str) return false;
+    }
+}
+
 char* str_trim(char* str) {
     if (!str) return NULL;
 
@@ -105,115 +124,298 @@ void str_split(const char* str, const char* delim, char*** result, int* count) {
         token = strtok(NULL, delim);
     }
 
+    // strtok skips empty fields, so fewer parts than delimiters + 1 may exist
+    *count = i;
     free(copy);
 }
 
 // Selector parsing
-Selector* parse_selector(const char* selector_str) {
-    if (!selector_str) return NULL;
+// Selectors are parsed as views over the caller's text and copied once into a
+// single block: a list is its SelectorList header, then the Selector array,
+// then the NUL-terminated values, so one free releases it all.
+
+static bool selector_error(SelectorParseError* error, const char* text, const char* at, const char* message) {
+    if (error) {
+        error->column = (int)(at - text) + 1;
+        error->message = message;
+    }
+    return false;
+}
 
-    Selector* selector = (Selector*)malloc(sizeof(Selector));
-    if (!selector) return NULL;
+static bool view_starts_with(const char* start, const char* end, const char* prefix) {
+    size_t len = strlen(prefix);
+    return (size_t)(end - start) >= len && memcmp(start, prefix, len) == 0;
+}
 
-    selector->value = NULL;
+// End of the list element at p: the next comma outside double quotes, or the
+// terminator. \" inside quotes does not end them.
+static const char* selector_element_end(const char* p) {
+    bool quoted = false;
+    for (; *p; p++) {
+        if (*p == '\\' && quoted && p[1] == '"') {
+            p++;
+        } else if (*p == '"') {
+            quoted = !quoted;
+        } else if (*p == ',' && !quoted) {
+            break;
+        }
+    }
+    return p;
+}
 
-    // Check for monitor ID (M1, M2, etc.)
-    if (selector_str[0] == 'M' && isdigit((unsigned char)selector_str[1])) {
-        selector->type = SELECTOR_TYPE_MONITOR_ID;
-        selector->value = _strdup(selector_str);
+// Value of device:, name:, model: or edid:, either bare or in double quotes
+// with \" escapes
+static bool parse_selector_value(const char* text, const char* start, const char* end,
+                                 const char** out_value, const char** out_value_end, bool* out_escaped,
+                                 SelectorParseError* error) {
+    *out_escaped = false;
+    if (start == end) return selector_error(error, text, start, "missing value");
+
+    if (*start != '"') {
+        *out_value = start;
+        *out_value_end = end;
+        return true;
     }
-    // Check for device path (device:"\\.\\DISPLAYn")
-    else if (str_starts_with(selector_str, "device:\"")) {
-        selector->type = SELECTOR_TYPE_DEVICE_PATH;
-        // Extract the path from device:"path"
-        const char* start = selector_str + 8; // Skip device:"
-        const char* end = strrchr(start, '"');
-        if (end) {
-            size_t len = end - start;
-            selector->value = (char*)malloc(len + 1);
-            if (selector->value) {
-                memcpy(selector->value, start, len);
-                selector->value[len] = '\0';
-            }
+
+    const char* p = start + 1;
+    for (; p < end && *p != '"'; p++) {
+        if (*p == '\\' && p + 1 < end && p[1] == '"') {
+            *out_escaped = true;
+            p++;
         }
     }
-    // Check for device name (name:"substring")
-    else if (str_starts_with(selector_str, "name:\"")) {
+    if (p == end) return selector_error(error, text, start, "unterminated quote");
+    if (p + 1 != end) return selector_error(error, text, p + 1, "unexpected text after closing quote");
+
+    *out_value = start + 1;
+    *out_value_end = p;
+    return true;
+}
+
+static bool parse_dimension(const char** p, const char* end, unsigned long* out_value) {
+    unsigned long value = 0;
+    const char* start = *p;
+    while (*p < end && isdigit((unsigned char)**p) && value < 100000) {
+        value = value * 10 + (unsigned long)(**p - '0');
+        (*p)++;
+    }
+    *out_value = value;
+    return *p > start && value > 0;
+}
+
+// Parses the trimmed element [start, end) of text into selector, copying its
+// value to *cursor and advancing it. Expressions compile from that copy, so
+// the compiler gets a terminated string without another allocation.
+static bool parse_selector_element(const char* text, const char* start, const char* end,
+                                   Selector* selector, char** cursor, SelectorParseError* error) {
+    const char* value = start;
+    const char* value_end = end;
+    bool escaped = false;
+
+    selector->program = NULL;
+
+    if (start[0] == 'M' && end - start > 1 && isdigit((unsigned char)start[1])) {
+        selector->type = SELECTOR_TYPE_MONITOR_ID;
+    } else if (view_starts_with(start, end, "device:")) {
+        selector->type = SELECTOR_TYPE_DEVICE_PATH;
+        if (!parse_selector_value(text, start + 7, end, &value, &value_end, &escaped, error)) return false;
+    } else if (view_starts_with(start, end, "name:")) {
         selector->type = SELECTOR_TYPE_DEVICE_NAME;
-        // Extract the name from name:"name"
-        const char* start = selector_str + 6; // Skip name:"
-        const char* end = strrchr(start, '"');
-        if (end) {
-            size_t len = end - start;
-            selector->value = (char*)malloc(len + 1);
-            if (selector->value) {
-                memcpy(selector->value, start, len);
-                selector->value[len] = '\0';
-            }
+        if (!parse_selector_value(text, start + 5, end, &value, &value_end, &escaped, error)) return false;
+    } else if (view_starts_with(start, end, "edid:")) {
+        selector->type = SELECTOR_TYPE_EDID;
+        if (!parse_selector_value(text, start + 5, end, &value, &value_end, &escaped, error)) return false;
+    } else if (view_starts_with(start, end, "model:")) {
+        selector->type = SELECTOR_TYPE_MODEL;
+        if (!parse_selector_value(text, start + 6, end, &value, &value_end, &escaped, error)) return false;
+    } else if (view_starts_with(start, end, "native:")) {
+        selector->type = SELECTOR_TYPE_NATIVE;
+        value = start + 7;
+        const char* p = value;
+        unsigned long width = 0, height = 0;
+        if (!parse_dimension(&p, end, &width) || p == end || *p++ != 'x' ||
+            !parse_dimension(&p, end, &height) || p != end) {
+            return selector_error(error, text, value, "expected native:WIDTHxHEIGHT");
         }
-    }
-    // Default to monitor ID
-    else {
+    } else if (view_starts_with(start, end, "expr:")) {
+        selector->type = SELECTOR_TYPE_EXPRESSION;
+        value = start + 5;
+    } else if (view_starts_with(start, end, "group:")) {
+        selector->type = SELECTOR_TYPE_GROUP;
+        value = start + 6;
+        if (value == end) return selector_error(error, text, value, "missing group name");
+    } else {
         selector->type = SELECTOR_TYPE_MONITOR_ID;
-        selector->value = _strdup(selector_str);
     }
 
-    if (!selector->value) {
-        free(selector);
-        return NULL;
+    char* out = *cursor;
+    for (const char* p = value; p < value_end; p++) {
+        if (escaped && *p == '\\' && p + 1 < value_end && p[1] == '"') p++;
+        *out++ = *p;
+    }
+    *out++ = '\0';
+    selector->value = *cursor;
+    *cursor = out;
+
+    if (selector->type == SELECTOR_TYPE_EXPRESSION) {
+        int column = 0;
+        const char* message = NULL;
+        selector->program = selector_program_compile_with_error(selector->value, &column, &message);
+        if (!selector->program) {
+            return selector_error(error, text, value + (column > 0 ? column - 1 : 0),
+                                  message ? message : "invalid expression");
+        }
     }
+    return true;
+}
 
-    return selector;
+static void trim_selector_element(const char** start, const char** end) {
+    while (*start < *end && isspace((unsigned char)**start)) (*start)++;
+    while (*end > *start && isspace((unsigned char)(*end)[-1])) (*end)--;
 }
 
-SelectorList* parse_selector_list(const char* selector_list_str) {
-    if (!selector_list_str) return NULL;
+Selector* parse_selector_with_error(const char* selector_str, SelectorParseError* out_error) {
+    if (out_error) {
+        out_error->column = 0;
+        out_error->message = NULL;
+    }
+    if (!selector_str) return NULL;
 
-    SelectorList* list = (SelectorList*)malloc(sizeof(SelectorList));
-    if (!list) return NULL;
+    const char* start = selector_str;
+    const char* end = selector_str + strlen(selector_str);
+    trim_selector_element(&start, &end);
+    if (start == end) {
+        selector_error(out_error, selector_str, start, "empty selector");
+        return NULL;
+    }
 
-    char** parts = NULL;
-    int count = 0;
-    str_split(selector_list_str, ",", &parts, &count);
+    Selector* selector = (Selector*)malloc(sizeof(Selector) + (end - start) + 1);
+    if (!selector) {
+        selector_error(out_error, selector_str, start, "out of memory");
+        return NULL;
+    }
 
-    if (count == 0 || !parts) {
-        free(list);
+    char* cursor = (char*)(selector + 1);
+    if (!parse_selector_element(selector_str, start, end, selector, &cursor, out_error)) {
+        free(selector);
         return NULL;
     }
+    return selector;
+}
 
-    list->selectors = (Selector*)malloc(count * sizeof(Selector));
-    if (!list->selectors) {
-        for (int i = 0; i < count; i++) {
-            free(parts[i]);
-        }
-        free(parts);
-        free(list);
+SelectorList* parse_selector_list_with_error(const char* selector_list_str, SelectorParseError* out_error) {
+    if (out_error) {
+        out_error->column = 0;
+        out_error->message = NULL;
+    }
+    if (!selector_list_str) return NULL;
+
+    // Size the block: one Selector per element, values fit in the text plus
+    // one terminator each
+    int capacity = 0;
+    const char* p = selector_list_str;
+    for (;;) {
+        p = selector_element_end(p);
+        capacity++;
+        if (!*p) break;
+        p++;
+    }
+    size_t text_length = (size_t)(p - selector_list_str);
+
+    SelectorList* list = (SelectorList*)malloc(sizeof(SelectorList) + capacity * sizeof(Selector) +
+                                               text_length + capacity);
+    if (!list) {
+        selector_error(out_error, selector_list_str, selector_list_str, "out of memory");
         return NULL;
     }
 
+    list->selectors = (Selector*)(list + 1);
     list->count = 0;
-    for (int i = 0; i < count; i++) {
-        Selector* sel = parse_selector(parts[i]);
-        if (sel) {
-            list->selectors[list->count++] = *sel;
-            free(sel); // Free the temporary selector struct, but keep its contents
+    char* cursor = (char*)(list->selectors + capacity);
+
+    for (const char* start = selector_list_str; ; ) {
+        const char* next = selector_element_end(start);
+        const char* end = next;
+        trim_selector_element(&start, &end);
+        if (start < end &&
+            !parse_selector_element(selector_list_str, start, end, &list->selectors[list->count++],
+                                    &cursor, out_error)) {
+            list->count--;
+            free_selector_list(list);
+            return NULL;
         }
-        free(parts[i]);
+        if (!*next) break;
+        start = next + 1;
     }
-    free(parts);
 
     if (list->count == 0) {
-        free(list->selectors);
         free(list);
+        selector_error(out_error, selector_list_str, selector_list_str, "no selectors");
         return NULL;
     }
 
     return list;
 }
 
+void log_selector_error(const char* text, const SelectorParseError* error) {
+    if (!text || !error || !error->message) return;
+
+    log_error("Invalid selector at column %d: %s", error->column, error->message);
+    log_error("  %s", text);
+    log_error("  %*s^", error->column - 1, "");
+}
+
+Selector* parse_selector(const char* selector_str) {
+    SelectorParseError error;
+    Selector* selector = parse_selector_with_error(selector_str, &error);
+    if (!selector) log_selector_error(selector_str, &error);
+    return selector;
+}
+
+SelectorList* parse_selector_list(const char* selector_list_str) {
+    SelectorParseError error;
+    SelectorList* list = parse_selector_list_with_error(selector_list_str, &error);
+    if (!list) log_selector_error(selector_list_str, &error);
+    return list;
+}
+
+SelectorList* copy_selector_list(const SelectorList* list) {
+    if (!list || list->count <= 0) return NULL;
+
+    // The array and the values share one block; size it without wrapping
+    size_t count = (size_t)list->count;
+    size_t block_size = sizeof(SelectorList);
+    if (count > (SIZE_MAX - block_size) / sizeof(Selector)) return NULL;
+    block_size += count * sizeof(Selector);
+    for (size_t i = 0; i < count; i++) {
+        size_t len = strlen(list->selectors[i].value) + 1;
+        if (len > SIZE_MAX - block_size) return NULL;
+        block_size += len;
+    }
+
+    SelectorList* copy = (SelectorList*)malloc(block_size);
+    if (!copy) return NULL;
+
+    copy->selectors = (Selector*)(copy + 1);
+    copy->count = list->count;
+    char* cursor = (char*)(copy->selectors + count);
+    for (size_t i = 0; i < count; i++) {
+        const Selector* selector = &list->selectors[i];
+        size_t len = strlen(selector->value) + 1;
+        memcpy(cursor, selector->value, len);
+        copy->selectors[i].type = selector->type;
+        copy->selectors[i].value = cursor;
+        copy->selectors[i].program = selector_program_retain(selector->program);
+        cursor += len;
+    }
+
+    return copy;
+}
+
+// Selectors from the parsers own their values and the array in the same block
 void free_selector(Selector* selector) {
     if (selector) {
-        free(selector->value);
+        selector_program_release(selector->program);
         free(selector);
     }
 }
@@ -221,15 +423,15 @@ void free_selector(Selector* selector) {
 void free_selector_list(SelectorList* list) {
     if (list) {
         for (int i = 0; i < list->count; i++) {
-            free(list->selectors[i].value);
+            selector_program_release(list->selectors[i].program);
         }
-        free(list->selectors);
         free(list);
     }
 }
 
 // Monitor matching
-bool matches_monitor(const Selector* selector, const char* monitor_id, const char* device_path, const char* device_name) {
+bool matches_monitor(const Selector* selector, const char* monitor_id, const char* device_path,
+                     const char* device_name, const char* stable_id) {
     if (!selector || !selector->value) return false;
 
     switch (selector->type) {
@@ -239,24 +441,103 @@ bool matches_monitor(const Selector* selector, const char* monitor_id, const cha
         case SELECTOR_TYPE_DEVICE_PATH:
             return strcmp(device_path, selector->value) == 0;
 
-        case SELECTOR_TYPE_DEVICE_NAME: {
-            char* name_lower = str_to_lower(device_name);
-            char* selector_lower = str_to_lower(selector->value);
-            bool result = str_contains(name_lower, selector_lower);
-            free(name_lower);
-            free(selector_lower);
-            return result;
-        }
+        case SELECTOR_TYPE_DEVICE_NAME:
+            return str_contains_nocase(device_name, selector->value);
+
+        case SELECTOR_TYPE_EDID:
+            return stable_id && _stricmp(stable_id, selector->value) == 0;
 
         default:
             return false;
     }
 }
 
+// Memory allocation
+void* mem_alloc(const MosDefAllocator* allocator, size_t size) {
+    if (allocator && allocator->alloc) {
+        return allocator->alloc(size, allocator->user_data);
+    }
+    return malloc(size);
+}
+
+void mem_free(const MosDefAllocator* allocator, void* ptr) {
+    if (!ptr) return;
+    if (allocator && allocator->free) {
+        allocator->free(ptr, allocator->user_data);
+        return;
+    }
+    free(ptr);
+}
+
+// Local data files
+char* get_local_data_path(const char* file_name) {
+    char* local_path = NULL;
+    size_t local_len = 0;
+    if (_dupenv_s(&local_path, &local_len, "LOCALAPPDATA") != 0 || !local_path) {
+        log_verbose("LOCALAPPDATA is not set");
+        return NULL;
+    }
+
+    size_t total_len = strlen(local_path) + strlen(file_name) + sizeof("\\MOS-DEF\\");
+    char* path = (char*)malloc(total_len);
+    if (!path) {
+        free(local_path);
+        return NULL;
+    }
+
+    sprintf_s(path, total_len, "%s\\MOS-DEF", local_path);
+    CreateDirectoryA(path, NULL);
+    sprintf_s(path, total_len, "%s\\MOS-DEF\\%s", local_path, file_name);
+    free(local_path);
+    return path;
+}
+
+// Hashing
+ULONG64 hash_bytes(ULONG64 hash, const void* data, size_t size) {
+    const BYTE* bytes = (const BYTE*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+char* mem_strdup(const MosDefAllocator* allocator, const char* str) {
+    if (!str) return NULL;
+    size_t len = strlen(str) + 1;
+    char* copy = (char*)mem_alloc(allocator, len);
+    if (copy) {
+        memcpy(copy, str, len);
+    }
+    return copy;
+}
+
+// Log sinks
+const LogSink* log_set_thread_sink(const LogSink* sink) {
+    const LogSink* previous = t_log_sink;
+    t_log_sink = sink;
+    return previous;
+}
+
+const LogSink* log_get_thread_sink() {
+    return t_log_sink;
+}
+
+static void log_to_sink(const LogSink* sink, LogLevel level, const char* format, va_list args) {
+    char message[1024];
+    vsnprintf(message, sizeof(message), format, args);
+    sink->write(level, message, sink->user_data);
+}
+
 // Error handling
 void log_error(const char* format, ...) {
     va_list args;
     va_start(args, format);
+    if (t_log_sink) {
+        log_to_sink(t_log_sink, LOG_LEVEL_ERROR, format, args);
+        va_end(args);
+        return;
+    }
     fprintf(stderr, "ERROR: ");
     vfprintf(stderr, format, args);
     fprintf(stderr, "\n");
@@ -266,15 +547,25 @@ void log_error(const char* format, ...) {
 void log_info(const char* format, ...) {
     va_list args;
     va_start(args, format);
+    if (t_log_sink) {
+        log_to_sink(t_log_sink, LOG_LEVEL_INFO, format, args);
+        va_end(args);
+        return;
+    }
     vprintf(format, args);
     printf("\n");
     va_end(args);
 }
 
 void log_verbose(const char* format, ...) {
-    if (!g_verbose) return;
+    if (t_log_sink ? !t_log_sink->verbose : !g_verbose) return;
     va_list args;
     va_start(args, format);
+    if (t_log_sink) {
+        log_to_sink(t_log_sink, LOG_LEVEL_VERBOSE, format, args);
+        va_end(args);
+        return;
+    }
     printf("VERBOSE: ");
     vprintf(format, args);
     printf("\n");
@@ -4,6 +4,14 @@
 #include <windows.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <stddef.h>
+
+// Thread-local storage qualifier
+#ifdef _MSC_VER
+#define MOSDEF_THREAD_LOCAL __declspec(thread)
+#else
+#define MOSDEF_THREAD_LOCAL _Thread_local
+#endif
 
 // RDP detection
 bool is_rdp_session();
@@ -12,6 +20,7 @@ bool is_rdp_session();
 bool str_starts_with(const char* str, const char* prefix);
 bool str_ends_with(const char* str, const char* suffix);
 bool str_contains(const char* str, const char* substring);
+bool str_contains_nocase(const char* str, const char* substring);  // ASCII case folding, no allocation
 char* str_trim(char* str);
 char* str_to_lower(const char* str);
 void str_split(const char* str, const char* delim, char*** result, int* count);
@@ -20,12 +29,20 @@ void str_split(const char* str, const char* delim, char*** result, int* count);
 typedef enum {
     SELECTOR_TYPE_MONITOR_ID,
     SELECTOR_TYPE_DEVICE_PATH,
-    SELECTOR_TYPE_DEVICE_NAME
+    SELECTOR_TYPE_DEVICE_NAME,
+    SELECTOR_TYPE_EDID,
+    SELECTOR_TYPE_MODEL,     // Substring of the EDID model name
+    SELECTOR_TYPE_NATIVE,    // EDID preferred resolution, "WxH"
+    SELECTOR_TYPE_EXPRESSION, // expr:..., see selexpr.h
+    SELECTOR_TYPE_GROUP      // group:NAME from the config, see groups.h
 } SelectorType;
 
+struct SelectorProgram;
+
 typedef struct {
     SelectorType type;
     char* value;
+    struct SelectorProgram* program;  // Compiled expression (one reference), NULL for other types
 } Selector;
 
 typedef struct {
@@ -33,21 +50,74 @@ typedef struct {
     int count;
 } SelectorList;
 
-// Selector parsing
+// Where a selector failed to parse
+typedef struct {
+    int column;              // 1-based, within the parsed text
+    const char* message;     // Static string
+} SelectorParseError;
+
+// Selector parsing. The _with_error forms report the first error instead of
+// logging it; lists fail as a whole, so an invalid entry never widens or
+// narrows a selection. Results are single allocations, freed with
+// free_selector or free_selector_list.
 Selector* parse_selector(const char* selector_str);
 SelectorList* parse_selector_list(const char* selector_list_str);
+Selector* parse_selector_with_error(const char* selector_str, SelectorParseError* out_error);
+SelectorList* parse_selector_list_with_error(const char* selector_list_str, SelectorParseError* out_error);
+void log_selector_error(const char* text, const SelectorParseError* error);  // Message, text and a caret line
+SelectorList* copy_selector_list(const SelectorList* list);
 void free_selector(Selector* selector);
 void free_selector_list(SelectorList* list);
 
-// Monitor matching
-bool matches_monitor(const Selector* selector, const char* monitor_id, const char* device_path, const char* device_name);
+// Monitor matching (ID, path, name and EDID selectors; see monitor_matches_selector
+// in enum.h for selectors that need the full MonitorInfo)
+bool matches_monitor(const Selector* selector, const char* monitor_id, const char* device_path,
+                     const char* device_name, const char* stable_id);
+
+// Machine-local data file, %LOCALAPPDATA%\MOS-DEF\<file_name>. Creates the
+// directory; returns a CRT-heap path or NULL if LOCALAPPDATA is unset.
+char* get_local_data_path(const char* file_name);
+
+// 64-bit FNV-1a. Start from HASH_SEED and pass each result back in to hash
+// several fields as one stream.
+#define HASH_SEED 0xcbf29ce484222325ULL
+ULONG64 hash_bytes(ULONG64 hash, const void* data, size_t size);
+
+// Memory allocation (NULL allocator means the CRT heap)
+typedef struct {
+    void* (*alloc)(size_t size, void* user_data);
+    void (*free)(void* ptr, void* user_data);
+    void* user_data;
+} MosDefAllocator;
+
+void* mem_alloc(const MosDefAllocator* allocator, size_t size);
+void mem_free(const MosDefAllocator* allocator, void* ptr);
+char* mem_strdup(const MosDefAllocator* allocator, const char* str);
+
+// Log sinks
+typedef enum {
+    LOG_LEVEL_ERROR,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_VERBOSE
+} LogLevel;
+
+typedef struct {
+    void (*write)(LogLevel level, const char* message, void* user_data);
+    void* user_data;
+    bool verbose;
+} LogSink;
+
+// Route this thread's log output to a sink (NULL restores stdout/stderr).
+// Returns the previously installed sink.
+const LogSink* log_set_thread_sink(const LogSink* sink);
+const LogSink* log_get_thread_sink();
 
 // Error handling
 void log_error(const char* format, ...);
 void log_info(const char* format, ...);
 void log_verbose(const char* format, ...);
 
-// Global verbose flag
+// Global verbose flag (used when no thread sink is installed)
 extern bool g_verbose;
 
 #endif // UTIL_H
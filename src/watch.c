@@ -0,0 +1,188 @@
+#include "watch.h"
+#include "config.h"
+#include "diff.h"
+#include "event_ring.h"
+#include "listener.h"
+#include "util.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WATCH_EVENT_CAPACITY 256
+
+typedef struct {
+    MosDefContext* ctx;
+    EventRing* ring;
+    MonitorList* current;
+    unsigned long long sequence;
+    const LogSink* log_sink;    // Caller's sink, so diagnostics stay off stdout
+
+    // Wall clock anchor for converting QueryPerformanceCounter intake times
+    LONG64 anchor_ticks;
+    ULONGLONG anchor_filetime;
+} WatchSession;
+
+// Formats an intake timestamp as ISO 8601 UTC with milliseconds
+static void format_timestamp(const WatchSession* session, LONG64 ticks, char* buffer, size_t buffer_size) {
+    double elapsed_us = event_timestamp_elapsed_us(session->anchor_ticks, ticks);
+    ULONGLONG filetime = session->anchor_filetime + (ULONGLONG)(LONG64)(elapsed_us * 10.0);
+
+    FILETIME ft;
+    ft.dwLowDateTime = (DWORD)(filetime & 0xFFFFFFFF);
+    ft.dwHighDateTime = (DWORD)(filetime >> 32);
+
+    SYSTEMTIME st;
+    FileTimeToSystemTime(&ft, &st);
+    sprintf_s(buffer, buffer_size, "%04u-%02u-%02uT%02u:%02u:%02u.%03uZ",
+              st.wYear, st.wMonth, st.wDay, st.wHour, st.wMinute, st.wSecond, st.wMilliseconds);
+}
+
+static void print_record(WatchSession* session, const char* timestamp, const char* event,
+                         TopologyChangeType type, const MonitorInfo* before, const MonitorInfo* after) {
+    const MonitorInfo* monitor = after ? after : before;
+    char* id_json = json_escape_string(monitor->id);
+    char* stable_id_json = json_escape_string(monitor->stable_id);
+    char* device_json = json_escape_string(monitor->device_path);
+
+    printf("{\"ts\":\"%s\",\"seq\":%llu,\"event\":\"%s\",\"id\":%s,\"stable_id\":%s,\"device\":%s",
+           timestamp, ++session->sequence, event, id_json ? id_json : "null",
+           stable_id_json ? stable_id_json : "null", device_json ? device_json : "null");
+
+    if (before) {
+        printf(",\"before\":");
+        write_topology_change_fields(stdout, type, before);
+    }
+    if (after) {
+        printf(",\"after\":");
+        write_topology_change_fields(stdout, type, after);
+    }
+    printf("}\n");
+
+    free(id_json);
+    free(stable_id_json);
+    free(device_json);
+}
+
+// Re-probes the topology once for a batch of notifications and reports the diff
+static void process_topology_change(WatchSession* session, LONG64 intake) {
+    MonitorList* updated = NULL;
+    if (mosdef_enumerate(session->ctx, &updated) != MOSDEF_OK) {
+        log_error("Failed to re-enumerate monitors after display change");
+        return;
+    }
+
+    TopologyDiff* diff = diff_topologies(session->current, updated);
+    if (!diff) {
+        mosdef_free_monitor_list(session->ctx, updated);
+        return;
+    }
+
+    if (diff->count > 0) {
+        char timestamp[32];
+        format_timestamp(session, intake, timestamp, sizeof(timestamp));
+
+        for (int i = 0; i < diff->count; i++) {
+            const TopologyChange* change = &diff->changes[i];
+            print_record(session, timestamp, get_topology_change_name(change->type),
+                         change->type, change->before, change->after);
+        }
+        fflush(stdout);
+    } else {
+        log_verbose("Display notification without a topology change");
+    }
+
+    // The diff points into both lists; release it before the old list
+    free_topology_diff(diff);
+    mosdef_free_monitor_list(session->ctx, session->current);
+    session->current = updated;
+}
+
+static DWORD WINAPI watch_thread(LPVOID param) {
+    WatchSession* session = (WatchSession*)param;
+    DisplayEvent events[32];
+    log_set_thread_sink(session->log_sink);
+
+    for (;;) {
+        event_ring_wait(session->ring, INFINITE);
+
+        // Coalesce a burst of notifications into one re-probe, stamped with
+        // the first notification's intake time
+        LONG64 first_intake = 0;
+        bool changed = false;
+        bool shutdown = false;
+
+        int count;
+        while ((count = event_ring_drain(session->ring, events, 32)) > 0) {
+            for (int i = 0; i < count; i++) {
+                if (events[i].type == DISPLAY_EVENT_TOPOLOGY_CHANGED) {
+                    if (!changed) first_intake = events[i].timestamp;
+                    changed = true;
+                } else if (events[i].type == DISPLAY_EVENT_SHUTDOWN) {
+                    shutdown = true;
+                }
+            }
+        }
+
+        if (changed) {
+            process_topology_change(session, first_intake);
+        }
+        if (shutdown) {
+            return 0;
+        }
+    }
+}
+
+int run_watch(MosDefContext* ctx) {
+    WatchSession session;
+    memset(&session, 0, sizeof(session));
+    session.ctx = ctx;
+    session.log_sink = log_get_thread_sink();
+
+    FILETIME now;
+    GetSystemTimeAsFileTime(&now);
+    session.anchor_ticks = event_timestamp_now();
+    session.anchor_filetime = ((ULONGLONG)now.dwHighDateTime << 32) | now.dwLowDateTime;
+
+    if (mosdef_enumerate(ctx, &session.current) != MOSDEF_OK) {
+        log_error("Failed to enumerate monitors");
+        return 3;
+    }
+
+    session.ring = event_ring_create(WATCH_EVENT_CAPACITY);
+    DisplayListener* listener = session.ring ? display_listener_create(session.ring) : NULL;
+    if (!listener) {
+        event_ring_destroy(session.ring);
+        mosdef_free_monitor_list(ctx, session.current);
+        return 3;
+    }
+
+    // Baseline: one "present" record per monitor
+    char timestamp[32];
+    format_timestamp(&session, session.anchor_ticks, timestamp, sizeof(timestamp));
+    for (int i = 0; i < session.current->count; i++) {
+        print_record(&session, timestamp, "present", TOPOLOGY_CHANGE_ADDED, NULL, &session.current->monitors[i]);
+    }
+    fflush(stdout);
+
+    int result = 0;
+    HANDLE worker = CreateThread(NULL, 0, watch_thread, &session, 0, NULL);
+    if (!worker) {
+        log_error("Failed to start watch thread (error %lu)", GetLastError());
+        result = 3;
+    } else {
+        display_listener_run(listener);
+        WaitForSingleObject(worker, INFINITE);
+        CloseHandle(worker);
+    }
+
+    EventRingStats stats = event_ring_get_stats(session.ring);
+    if (stats.dropped > 0) {
+        log_verbose("Dropped %lld display notifications (backlog high water %lld)",
+                    stats.dropped, stats.high_water);
+    }
+
+    display_listener_destroy(listener);
+    event_ring_destroy(session.ring);
+    mosdef_free_monitor_list(ctx, session.current);
+    return result;
+}
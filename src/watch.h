@@ -0,0 +1,10 @@
+#ifndef WATCH_H
+#define WATCH_H
+
+#include "mosdef.h"
+
+// Streams topology changes to stdout as NDJSON, one record per change,
+// until Ctrl+C. Driven by display notifications; returns a process exit code.
+int run_watch(MosDefContext* ctx);
+
+#endif // WATCH_H
@@ -0,0 +1,157 @@
+// Winsock 2 must precede windows.h
+#include <winsock2.h>
+#include "agent_pool.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+#define AGENT_POOL_START_TIMEOUT_MS 60000
+
+static bool write_text(const char* path, const char* text) {
+    FILE* file = NULL;
+    if (fopen_s(&file, path, "wb") != 0 || !file) return false;
+    fputs(text, file);
+    return fclose(file) == 0;
+}
+
+// The caller's environment with the data directories pointed at directory
+static char** agent_environment(const char* directory, char* local, char* roaming, size_t size) {
+    int count = 0;
+    while (environ[count]) count++;
+    char** environment = (char**)calloc((size_t)count + 3, sizeof(char*));
+    if (!environment) return NULL;
+
+    int used = 0;
+    for (int i = 0; i < count; i++) {
+        if (strncmp(environ[i], "LOCALAPPDATA=", 13) != 0 && strncmp(environ[i], "APPDATA=", 8) != 0) {
+            environment[used++] = environ[i];
+        }
+    }
+    sprintf_s(local, size, "LOCALAPPDATA=%s", directory);
+    sprintf_s(roaming, size, "APPDATA=%s", directory);
+    environment[used++] = local;
+    environment[used++] = roaming;
+    return environment;
+}
+
+static bool spawn_agent(AgentPool* pool, const char* directory, int index) {
+    char data_directory[MAX_PATH];
+    sprintf_s(data_directory, sizeof(data_directory), "%s/agent%d", directory, index);
+    if (mkdir(data_directory, 0700) != 0 && errno != EEXIST) return false;
+
+    char local[MAX_PATH + 16];
+    char roaming[MAX_PATH + 16];
+    char** environment = agent_environment(data_directory, local, roaming, sizeof(local));
+    if (!environment) return false;
+
+    char address[32];
+    sprintf_s(address, sizeof(address), "127.0.0.1:%u", (unsigned)(pool->first_port + index));
+    char* argv[] = { MOSDEF_CLI_PATH, "agent", "--listen", address, "--key", pool->key_path, NULL };
+
+    // Each agent logs every request; keep the test output to the test's own
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+    int error = posix_spawn(&pool->pids[index], MOSDEF_CLI_PATH, &actions, NULL, argv, environment);
+    posix_spawn_file_actions_destroy(&actions);
+    free(environment);
+    if (error != 0) {
+        pool->pids[index] = 0;
+        fprintf(stderr, "Failed to start %s: %s\n", MOSDEF_CLI_PATH, strerror(error));
+        return false;
+    }
+    return true;
+}
+
+static bool agent_listening(USHORT port) {
+    SOCKET client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (client == INVALID_SOCKET) return false;
+    SOCKADDR_IN address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bool connected = connect(client, (SOCKADDR*)&address, sizeof(address)) != SOCKET_ERROR;
+    closesocket(client);
+    return connected;
+}
+
+static bool wait_for_agent(AgentPool* pool, int index, ULONGLONG deadline) {
+    USHORT port = (USHORT)(pool->first_port + index);
+    while (!agent_listening(port)) {
+        int status;
+        if (waitpid(pool->pids[index], &status, WNOHANG) == pool->pids[index]) {
+            pool->pids[index] = 0;
+            fprintf(stderr, "Agent on port %u exited during startup\n", (unsigned)port);
+            return false;
+        }
+        if (GetTickCount64() >= deadline) {
+            fprintf(stderr, "Agent on port %u did not start\n", (unsigned)port);
+            return false;
+        }
+        Sleep(10);
+    }
+    return true;
+}
+
+bool agent_pool_start(AgentPool* pool, const char* directory, int count) {
+    memset(pool, 0, sizeof(*pool));
+    pool->pids = (pid_t*)calloc((size_t)count, sizeof(pid_t));
+    if (!pool->pids) return false;
+    pool->count = count;
+    // Below test_fleet's ports and the ephemeral range, and distinct between
+    // concurrent runs
+    pool->first_port = (USHORT)(10000 + getpid() % 20 * 500);
+
+    sprintf_s(pool->key_path, sizeof(pool->key_path), "%s/fleet.key", directory);
+    sprintf_s(pool->hosts_path, sizeof(pool->hosts_path), "%s/hosts.txt", directory);
+    FILE* hosts = NULL;
+    bool ok = write_text(pool->key_path, "5f0c9d1e7a3b48c2a6d4e8f01b2c3d4e5f60718293a4b5c6d7e8f90a1b2c3d4e\n") &&
+              fopen_s(&hosts, pool->hosts_path, "w") == 0 && hosts;
+    for (int i = 0; ok && i < count; i++) {
+        fprintf(hosts, "127.0.0.1:%u\n", (unsigned)(pool->first_port + i));
+    }
+    if (hosts) ok = fclose(hosts) == 0 && ok;
+
+    for (int i = 0; ok && i < count; i++) {
+        ok = spawn_agent(pool, directory, i);
+    }
+    ULONGLONG deadline = GetTickCount64() + AGENT_POOL_START_TIMEOUT_MS;
+    for (int i = 0; ok && i < count; i++) {
+        ok = wait_for_agent(pool, i, deadline);
+    }
+
+    if (!ok) agent_pool_stop(pool);
+    return ok;
+}
+
+bool agent_pool_stop(AgentPool* pool) {
+    for (int i = 0; i < pool->count; i++) {
+        if (pool->pids[i] > 0) kill(pool->pids[i], SIGINT);
+    }
+
+    bool clean = true;
+    for (int i = 0; i < pool->count; i++) {
+        if (pool->pids[i] <= 0) continue;
+        int status = 0;
+        if (waitpid(pool->pids[i], &status, 0) != pool->pids[i] || !WIFEXITED(status) ||
+            WEXITSTATUS(status) != 0) {
+            clean = false;
+        }
+    }
+
+    free(pool->pids);
+    pool->pids = NULL;
+    pool->count = 0;
+    return clean;
+}
@@ -0,0 +1,30 @@
+#ifndef MOSDEF_AGENT_POOL_H
+#define MOSDEF_AGENT_POOL_H
+
+#include <windows.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+// A local fleet for the scale test and the fleet benchmark: count
+// "mos-def agent" processes on consecutive loopback ports, each with the
+// default simulated displays and a data directory of its own, sharing one
+// key file. Agents are separate processes so every one has its own
+// displays, as hosts in a real fleet do.
+
+typedef struct {
+    pid_t* pids;
+    int count;
+    USHORT first_port;
+    char key_path[MAX_PATH];
+    char hosts_path[MAX_PATH];  // One line per agent
+} AgentPool;
+
+// Starts the agents under directory, writes the key and hosts files there
+// and waits until every agent accepts connections. Returns false, with any
+// started agents stopped, if one fails to start.
+bool agent_pool_start(AgentPool* pool, const char* directory, int count);
+
+// Sends Ctrl+C to every agent and waits for it; true if all exited cleanly
+bool agent_pool_stop(AgentPool* pool);
+
+#endif // MOSDEF_AGENT_POOL_H
@@ -0,0 +1,79 @@
+#ifndef MOSDEF_TEST_H
+#define MOSDEF_TEST_H
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Minimal assertions shared by the test executables. A failed CHECK reports
+// its location and fails the run without stopping it, so one run shows every
+// broken expectation; REQUIRE also returns from the current function.
+
+static volatile LONG g_test_failures = 0;
+
+#define CHECK(condition)                                                        \
+    do {                                                                        \
+        if (!(condition)) {                                                     \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__,    \
+                    #condition);                                                \
+            InterlockedIncrement(&g_test_failures);                             \
+        }                                                                       \
+    } while (0)
+
+#define REQUIRE(condition)                                                      \
+    do {                                                                        \
+        if (!(condition)) {                                                     \
+            fprintf(stderr, "%s:%d: REQUIRE failed: %s\n", __FILE__, __LINE__,  \
+                    #condition);                                                \
+            InterlockedIncrement(&g_test_failures);                             \
+            return;                                                             \
+        }                                                                       \
+    } while (0)
+
+#define RUN_TEST(test)                                                          \
+    do {                                                                        \
+        LONG failures_before = g_test_failures;                                 \
+        test();                                                                 \
+        printf("%s %s\n", g_test_failures == failures_before ? "PASS" : "FAIL", \
+               #test);                                                          \
+    } while (0)
+
+#define TEST_EXIT_CODE() (g_test_failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE)
+
+#ifdef MOSDEF_FIXTURE_DIR
+// Reads tests/fixtures/<name> into buffer; returns the size, 0 on failure
+static inline DWORD test_read_fixture(const char* name, BYTE* buffer, DWORD buffer_size) {
+    char path[512];
+    sprintf_s(path, sizeof(path), "%s/%s", MOSDEF_FIXTURE_DIR, name);
+    FILE* file = NULL;
+    if (fopen_s(&file, path, "rb") != 0 || !file) {
+        fprintf(stderr, "Cannot open fixture %s\n", path);
+        return 0;
+    }
+    size_t size = fread(buffer, 1, buffer_size, file);
+    fclose(file);
+    return (DWORD)size;
+}
+#endif
+
+#ifndef _WIN32
+// Points the snapshot, history and cache stores and the sysfs EDID root at
+// a fresh directory, so a run never sees state left by an earlier one or
+// the host's real monitors
+static inline void test_isolate_data(void) {
+    char directory[] = "/tmp/mosdef-test-XXXXXX";
+    if (!mkdtemp(directory)) {
+        perror("mkdtemp");
+        exit(EXIT_FAILURE);
+    }
+    setenv("LOCALAPPDATA", directory, 1);
+    setenv("APPDATA", directory, 1);
+
+    char drm_root[sizeof(directory) + 8];
+    snprintf(drm_root, sizeof(drm_root), "%s/drm", directory);
+    setenv("MOSDEF_DRM_ROOT", drm_root, 1);
+}
+#endif
+
+#endif // MOSDEF_TEST_H
@@ -0,0 +1,180 @@
+#include "test.h"
+#include "mosdef.h"
+#include <sim.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// The apply thread: a context with apply_thread runs every apply and
+// rollback on one long-lived thread of its own, started by the first apply
+// and joined by mosdef_destroy. History is written afterwards by the caller.
+
+typedef struct {
+    DWORD caller;
+    DWORD loop_thread;          // Thread that logged the last "Rotating monitor"
+    int loop_threads_seen;      // Distinct loop threads other than the caller
+} ThreadLog;
+
+static void thread_log(LogLevel level, const char* message, void* user_data) {
+    (void)level;
+    ThreadLog* log = (ThreadLog*)user_data;
+    if (strncmp(message, "Rotating monitor ", 17) != 0) return;
+    DWORD thread = GetCurrentThreadId();
+    if (thread != log->caller && thread != log->loop_thread) log->loop_threads_seen++;
+    log->loop_thread = thread;
+}
+
+static int count_process_threads(void) {
+    DIR* directory = opendir("/proc/self/task");
+    if (!directory) return -1;
+    int count = 0;
+    struct dirent* entry;
+    while ((entry = readdir(directory)) != NULL) {
+        if (entry->d_name[0] != '.') count++;
+    }
+    closedir(directory);
+    return count;
+}
+
+// A joined thread signals its handle just before the pthread itself exits
+static bool wait_for_thread_count(int expected) {
+    for (int i = 0; i < 100; i++) {
+        if (count_process_threads() == expected) return true;
+        Sleep(10);
+    }
+    return false;
+}
+
+static void test_one_thread_per_context(void) {
+    sim_reset();
+    ThreadLog log = { GetCurrentThreadId(), 0, 0 };
+    MosDefOptions options = { 0 };
+    options.verbose = true;
+    options.apply_thread = true;
+    LogSink sink = { thread_log, &log, true };
+
+    int threads_before = count_process_threads();
+    MosDefContext* ctx = mosdef_create(&options, NULL, &sink);
+    REQUIRE(ctx);
+    CHECK(count_process_threads() == threads_before);
+
+    SelectorList* only = mosdef_parse_selectors(ctx, "M1,M2");
+    RotationPlan* plan = NULL;
+    REQUIRE(only && mosdef_plan(ctx, ROTATION_PORTRAIT, only, NULL, &plan) == MOSDEF_OK);
+    for (int round = 0; round < 5; round++) {
+        CHECK(mosdef_apply(ctx, plan, NULL) == MOSDEF_OK);
+        CHECK(mosdef_rollback(ctx, plan) == MOSDEF_OK);
+    }
+
+    // Ten loops, one thread, never the caller's
+    CHECK(log.loop_threads_seen == 1);
+    CHECK(log.loop_thread != 0 && log.loop_thread != log.caller);
+    CHECK(count_process_threads() == threads_before + 1);
+    CHECK(sim_change_count() == 20);
+
+    mosdef_free_plan(ctx, plan);
+    mosdef_free_selectors(ctx, only);
+    mosdef_destroy(ctx);
+    CHECK(wait_for_thread_count(threads_before));
+}
+
+static void test_inline_without_option(void) {
+    sim_reset();
+    ThreadLog log = { GetCurrentThreadId(), 0, 0 };
+    MosDefOptions options = { 0 };
+    options.verbose = true;
+    LogSink sink = { thread_log, &log, true };
+    MosDefContext* ctx = mosdef_create(&options, NULL, &sink);
+    REQUIRE(ctx);
+
+    SelectorList* only = mosdef_parse_selectors(ctx, "M1");
+    RotationPlan* plan = NULL;
+    REQUIRE(only && mosdef_plan(ctx, ROTATION_PORTRAIT, only, NULL, &plan) == MOSDEF_OK);
+    CHECK(mosdef_apply(ctx, plan, NULL) == MOSDEF_OK);
+    CHECK(log.loop_thread == log.caller && log.loop_threads_seen == 0);
+
+    mosdef_free_plan(ctx, plan);
+    mosdef_free_selectors(ctx, only);
+    mosdef_destroy(ctx);
+}
+
+typedef struct {
+    DWORD caller;
+    int caller_failures;        // "Failed to append" logged by the caller
+    int other_failures;         // ... and by any other thread
+} HistoryLog;
+
+static void history_log(LogLevel level, const char* message, void* user_data) {
+    (void)level;
+    HistoryLog* log = (HistoryLog*)user_data;
+    if (strncmp(message, "Failed to append ", 17) != 0) return;
+    if (GetCurrentThreadId() == log->caller) {
+        log->caller_failures++;
+    } else {
+        log->other_failures++;
+    }
+}
+
+static void remove_directory(const char* path) {
+    DIR* directory = opendir(path);
+    if (!directory) return;
+    struct dirent* entry;
+    while ((entry = readdir(directory)) != NULL) {
+        if (entry->d_name[0] == '.') continue;
+        char file[MAX_PATH];
+        sprintf_s(file, sizeof(file), "%s/%s", path, entry->d_name);
+        unlink(file);
+    }
+    closedir(directory);
+    rmdir(path);
+}
+
+static void test_history_written_by_caller(void) {
+    // A file where the history directory goes, so every append fails and says so
+    char path[MAX_PATH];
+    sprintf_s(path, sizeof(path), "%s/MOS-DEF", getenv("LOCALAPPDATA"));
+    mkdir(path, 0700);
+    strcat_s(path, sizeof(path), "/history");
+    remove_directory(path);
+    FILE* blocker = NULL;
+    REQUIRE(fopen_s(&blocker, path, "w") == 0 && blocker);
+    fclose(blocker);
+
+    sim_reset();
+    HistoryLog log = { GetCurrentThreadId(), 0, 0 };
+    MosDefOptions options = { 0 };
+    options.verbose = true;
+    options.apply_thread = true;
+    LogSink sink = { history_log, &log, true };
+    MosDefContext* ctx = mosdef_create(&options, NULL, &sink);
+    REQUIRE(ctx);
+
+    SelectorList* only = mosdef_parse_selectors(ctx, "M1");
+    RotationPlan* plan = NULL;
+    REQUIRE(only && mosdef_plan(ctx, ROTATION_PORTRAIT, only, NULL, &plan) == MOSDEF_OK);
+    CHECK(mosdef_apply(ctx, plan, NULL) == MOSDEF_OK);
+    CHECK(mosdef_rollback(ctx, plan) == MOSDEF_OK);
+    CHECK(log.caller_failures == 2);
+    CHECK(log.other_failures == 0);
+
+    mosdef_free_plan(ctx, plan);
+    mosdef_free_selectors(ctx, only);
+    mosdef_destroy(ctx);
+    unlink(path);
+}
+
+static void quiet_log(LogLevel level, const char* message, void* user_data) {
+    (void)level;
+    (void)message;
+    (void)user_data;
+}
+
+int main(void) {
+    test_isolate_data();
+    LogSink quiet = { quiet_log, NULL, false };
+    log_set_thread_sink(&quiet);
+    RUN_TEST(test_one_thread_per_context);
+    RUN_TEST(test_inline_without_option);
+    RUN_TEST(test_history_written_by_caller);
+    return TEST_EXIT_CODE();
+}
@@ -0,0 +1,194 @@
+#include "test.h"
+#include "mosdef.h"
+#include <sim.h>
+#include <poll.h>
+
+// Asynchronous operation state machine against the simulated backend:
+// pending cancellation, running cancellation, completion through the wait
+// handle and the poll descriptor, and a callback that destroys its context.
+
+static void quiet_log(LogLevel level, const char* message, void* user_data) {
+    (void)level;
+    (void)message;
+    (void)user_data;
+}
+
+static const LogSink g_quiet = { quiet_log, NULL, false };
+
+static bool fd_readable(int fd) {
+    struct pollfd poll_fd = { fd, POLLIN, 0 };
+    return poll(&poll_fd, 1, 0) == 1 && (poll_fd.revents & POLLIN);
+}
+
+static void test_pending_cancel_and_completion(void) {
+    sim_reset();
+    sim_set_change_latency(100);
+
+    MosDefContext* ctx = mosdef_create(NULL, NULL, &g_quiet);
+    REQUIRE(ctx);
+    RotationPlan* plan = NULL;
+    CHECK(mosdef_plan(ctx, ROTATION_PORTRAIT, NULL, NULL, &plan) == MOSDEF_OK);
+    if (!plan) {
+        mosdef_destroy(ctx);
+        return;
+    }
+
+    MosDefOperation* apply = mosdef_apply_async(ctx, plan, NULL, NULL);
+    MosDefOperation* enumerate = mosdef_enumerate_async(ctx, NULL, NULL);
+    CHECK(apply && enumerate);
+    if (apply && enumerate) {
+        // The apply holds the worker for two 100 ms mode changes
+        CHECK(!fd_readable(mosdef_operation_poll_fd(apply)));
+        CHECK(mosdef_operation_state(enumerate) == MOSDEF_OP_PENDING);
+        CHECK(mosdef_operation_cancel(enumerate));
+        CHECK(mosdef_operation_state(enumerate) == MOSDEF_OP_CANCELLED);
+        CHECK(mosdef_operation_status(enumerate) == MOSDEF_ERR_CANCELLED);
+        CHECK(WaitForSingleObject(mosdef_operation_wait_handle(enumerate), 0) == WAIT_OBJECT_0);
+        CHECK(fd_readable(mosdef_operation_poll_fd(enumerate)));
+        CHECK(mosdef_operation_take_monitors(enumerate) == NULL);
+        CHECK(!mosdef_operation_cancel(enumerate));
+
+        CHECK(mosdef_operation_wait(apply, 10000));
+        CHECK(fd_readable(mosdef_operation_poll_fd(apply)));
+        CHECK(mosdef_operation_state(apply) == MOSDEF_OP_COMPLETED);
+        CHECK(mosdef_operation_status(apply) == MOSDEF_OK);
+        BatchRotationResult result = mosdef_operation_take_result(apply);
+        CHECK(result.success_count == 2 && result.failure_count == 0 && result.cancelled_count == 0);
+        mosdef_free_result(ctx, &result);
+        CHECK(!mosdef_operation_cancel(apply));
+        CHECK(sim_change_count() == 2);
+    }
+    mosdef_operation_release(apply);
+    mosdef_operation_release(enumerate);
+
+    sim_set_change_latency(0);
+    CHECK(mosdef_rollback(ctx, plan) == MOSDEF_OK);
+    mosdef_free_plan(ctx, plan);
+    mosdef_destroy(ctx);
+}
+
+static void test_running_cancel(void) {
+    sim_reset();
+    sim_set_change_latency(150);
+
+    MosDefContext* ctx = mosdef_create(NULL, NULL, &g_quiet);
+    REQUIRE(ctx);
+    RotationPlan* plan = NULL;
+    CHECK(mosdef_plan(ctx, ROTATION_PORTRAIT, NULL, NULL, &plan) == MOSDEF_OK);
+    MosDefOperation* apply = plan ? mosdef_apply_async(ctx, plan, NULL, NULL) : NULL;
+    CHECK(apply != NULL);
+    if (apply) {
+        for (int i = 0; i < 1000 && mosdef_operation_state(apply) == MOSDEF_OP_PENDING; i++) {
+            Sleep(1);
+        }
+        CHECK(mosdef_operation_state(apply) == MOSDEF_OP_RUNNING);
+        CHECK(mosdef_operation_cancel(apply));
+        CHECK(mosdef_operation_wait(apply, 10000));
+        CHECK(mosdef_operation_state(apply) == MOSDEF_OP_COMPLETED);
+        CHECK(mosdef_operation_status(apply) == MOSDEF_ERR_CANCELLED);
+
+        BatchRotationResult result = mosdef_operation_take_result(apply);
+        CHECK(result.success_count == 1 && result.cancelled_count == 1);
+        mosdef_free_result(ctx, &result);
+        mosdef_operation_release(apply);
+    }
+
+    sim_set_change_latency(0);
+    if (plan) CHECK(mosdef_rollback(ctx, plan) == MOSDEF_OK);
+    mosdef_free_plan(ctx, plan);
+    mosdef_destroy(ctx);
+}
+
+// Allocator that tracks live blocks, to see the context torn down
+static volatile LONG g_live_blocks = 0;
+
+static void* counting_alloc(size_t size, void* user_data) {
+    (void)user_data;
+    void* block = malloc(size);
+    if (block) InterlockedIncrement(&g_live_blocks);
+    return block;
+}
+
+static void counting_free(void* block, void* user_data) {
+    (void)user_data;
+    if (block) InterlockedDecrement(&g_live_blocks);
+    free(block);
+}
+
+typedef struct {
+    MosDefContext* ctx;
+    HANDLE gate;
+    volatile LONG completed;
+    volatile LONG cancelled;
+} DestroyProbe;
+
+// Holds the worker until the test has queued everything behind it
+static void wait_for_gate(MosDefOperation* operation, void* user_data) {
+    DestroyProbe* probe = (DestroyProbe*)user_data;
+    WaitForSingleObject(probe->gate, 10000);
+    mosdef_operation_release(operation);
+}
+
+static void destroy_from_callback(MosDefOperation* operation, void* user_data) {
+    DestroyProbe* probe = (DestroyProbe*)user_data;
+    InterlockedIncrement(&probe->completed);
+    mosdef_operation_release(operation);
+    mosdef_destroy(probe->ctx);
+}
+
+static void record_cancelled(MosDefOperation* operation, void* user_data) {
+    DestroyProbe* probe = (DestroyProbe*)user_data;
+    if (mosdef_operation_state(operation) == MOSDEF_OP_CANCELLED) {
+        InterlockedIncrement(&probe->cancelled);
+    }
+    mosdef_operation_release(operation);
+}
+
+static bool wait_for_live_blocks(LONG expected) {
+    for (int i = 0; i < 5000; i++) {
+        if (ReadAcquire(&g_live_blocks) == expected) return true;
+        Sleep(1);
+    }
+    return false;
+}
+
+static void test_destroy_from_callback(void) {
+    sim_reset();
+
+    MosDefAllocator allocator = { counting_alloc, counting_free, NULL };
+    DestroyProbe probe = { NULL, CreateEventA(NULL, TRUE, FALSE, NULL), 0, 0 };
+    REQUIRE(probe.gate);
+    probe.ctx = mosdef_create(NULL, &allocator, &g_quiet);
+    REQUIRE(probe.ctx);
+
+    // The worker waits on the gate until everything is queued. The first
+    // operation's callback then destroys the context while the second and
+    // third are still queued behind it; the caller holds the third.
+    MosDefOperation* gate = mosdef_enumerate_async(probe.ctx, wait_for_gate, &probe);
+    MosDefOperation* first = mosdef_enumerate_async(probe.ctx, destroy_from_callback, &probe);
+    MosDefOperation* second = mosdef_enumerate_async(probe.ctx, record_cancelled, &probe);
+    MosDefOperation* held = mosdef_enumerate_async(probe.ctx, NULL, NULL);
+    CHECK(gate && first && second && held);
+    SetEvent(probe.gate);
+
+    CHECK(mosdef_operation_wait(held, 5000));
+    CHECK(mosdef_operation_state(held) == MOSDEF_OP_CANCELLED);
+    CHECK(mosdef_operation_status(held) == MOSDEF_ERR_CANCELLED);
+    CHECK(!mosdef_operation_cancel(held));
+    CHECK(probe.completed == 1);
+    CHECK(probe.cancelled == 1);
+
+    // The held operation keeps the context's memory alive until released
+    CHECK(ReadAcquire(&g_live_blocks) > 0);
+    mosdef_operation_release(held);
+    CHECK(wait_for_live_blocks(0));
+    CloseHandle(probe.gate);
+}
+
+int main(void) {
+    test_isolate_data();
+    RUN_TEST(test_pending_cancel_and_completion);
+    RUN_TEST(test_running_cancel);
+    RUN_TEST(test_destroy_from_callback);
+    return TEST_EXIT_CODE();
+}
@@ -0,0 +1,51 @@
+#include "test.h"
+#include "cli.h"
+
+// Numeric flags: parse_args accepts whole numbers within each flag's range
+// and fails on anything else instead of reading it as 0.
+
+static bool parses(const char* flag, const char* value, bool global) {
+    char* global_argv[] = { "mos-def", (char*)flag, (char*)value, "list" };
+    char* command_argv[] = { "mos-def", "fleet", "hosts.txt", "portrait", (char*)flag, (char*)value };
+    CliArgs* args = global ? parse_args(4, global_argv) : parse_args(6, command_argv);
+    bool ok = args != NULL;
+    free_cli_args(args);
+    return ok;
+}
+
+static void test_revert_seconds(void) {
+    CHECK(parses("--revert-seconds", "15", true));
+    CHECK(parses("--revert-seconds", "3600", true));
+    CHECK(!parses("--revert-seconds", "15s", true));
+    CHECK(!parses("--revert-seconds", "0", true));
+    CHECK(!parses("--revert-seconds", "-5", true));
+    CHECK(!parses("--revert-seconds", "3601", true));
+    CHECK(!parses("--revert-seconds", "99999999999999999999", true));
+}
+
+static void test_fleet_flags(void) {
+    CHECK(parses("--parallel", "64", false));
+    CHECK(!parses("--parallel", "", false));
+    CHECK(!parses("--parallel", "0", false));
+    CHECK(!parses("--parallel", "many", false));
+    CHECK(!parses("--parallel", "4097", false));
+
+    CHECK(parses("--deadline", "2500", false));
+    CHECK(!parses("--deadline", "2.5", false));
+    CHECK(!parses("--deadline", "-1", false));
+    CHECK(!parses("--deadline", "3600001", false));
+}
+
+static void quiet_log(LogLevel level, const char* message, void* user_data) {
+    (void)level;
+    (void)message;
+    (void)user_data;
+}
+
+int main(void) {
+    LogSink quiet = { quiet_log, NULL, false };
+    log_set_thread_sink(&quiet);
+    RUN_TEST(test_revert_seconds);
+    RUN_TEST(test_fleet_flags);
+    return TEST_EXIT_CODE();
+}
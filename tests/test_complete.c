@@ -0,0 +1,186 @@
+#include "test.h"
+#include "complete.h"
+#include "config.h"
+#include "groups.h"
+#include "topofile.h"
+#include <sim.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Shell completion: selectors come from the cached topology and group names
+// from the config, without enumerating displays or replacing the process's
+// group definitions, and each keypress stays well under a frame of typing
+// latency.
+
+#define OUTPUT_SIZE 8192
+
+static char g_output_path[MAX_PATH];
+
+static void quiet_log(LogLevel level, const char* message, void* user_data) {
+    (void)level;
+    (void)message;
+    (void)user_data;
+}
+
+// Runs "mos-def __complete <index> -- <words>" and captures its stdout
+static int complete(const char* words, int index, char* output) {
+    char buffer[512];
+    char index_text[16];
+    char* argv[24] = { "mos-def", "__complete", index_text, "--" };
+    int argc = 4;
+    sprintf_s(index_text, sizeof(index_text), "%d", index);
+    strcpy_s(buffer, sizeof(buffer), words);
+    char* context = NULL;
+    for (char* token = strtok_s(buffer, " ", &context); token && argc < 24; token = strtok_s(NULL, " ", &context)) {
+        argv[argc++] = token;
+    }
+
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    int capture = open(g_output_path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (saved < 0 || capture < 0) return -1;
+    dup2(capture, STDOUT_FILENO);
+    int result = run_complete(argc, argv);
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+
+    lseek(capture, 0, SEEK_SET);
+    ssize_t size = read(capture, output, OUTPUT_SIZE - 1);
+    close(capture);
+    output[size > 0 ? size : 0] = '\0';
+    return result;
+}
+
+static bool has_line(const char* output, const char* line) {
+    size_t length = strlen(line);
+    for (const char* p = output; (p = strstr(p, line)) != NULL; p++) {
+        if ((p == output || p[-1] == '\n') && p[length] == '\n') return true;
+    }
+    return false;
+}
+
+static void write_config(const char* text) {
+    char* path = get_config_file_path();
+    FILE* file = NULL;
+    if (path && fopen_s(&file, path, "w") == 0 && file) {
+        fputs(text, file);
+        fclose(file);
+    }
+    free(path);
+}
+
+static void test_candidates(void) {
+    char* output = (char*)malloc(OUTPUT_SIZE);
+    REQUIRE(output);
+
+    CHECK(complete("portrait --only g", 2, output) == 0);
+    CHECK(has_line(output, "group:wall") && has_line(output, "group:tv"));
+    CHECK(!has_line(output, "M1"));
+
+    CHECK(complete("portrait --include M1,M", 2, output) == 0);
+    CHECK(has_line(output, "M1,M1") && has_line(output, "M1,M2"));
+
+    CHECK(complete("history --device edid:", 2, output) == 0);
+    CHECK(strstr(output, "edid:DEL4085") != NULL && !strstr(output, "group:"));
+
+    CHECK(complete("fleet hosts.txt --", 2, output) == 0);
+    CHECK(has_line(output, "--key") && has_line(output, "--parallel"));
+    free(output);
+}
+
+// The cache answers even though the live topology has moved on
+static void test_serves_cache_not_displays(void) {
+    char* output = (char*)malloc(OUTPUT_SIZE);
+    REQUIRE(output);
+
+    SimMonitor monitors[3];
+    for (int i = 0; i < 2; i++) REQUIRE(sim_get_monitor(i, &monitors[i]));
+    monitors[2] = monitors[1];
+    monitors[2].connector = "card0-DP-2";
+    monitors[2].x = 4480;
+    REQUIRE(sim_set_monitors(monitors, 3));
+
+    CHECK(complete("portrait --only M", 2, output) == 0);
+    CHECK(has_line(output, "M2") && !has_line(output, "M3"));
+    sim_reset();
+    free(output);
+}
+
+static void test_definitions_untouched(void) {
+    char* output = (char*)malloc(OUTPUT_SIZE);
+    REQUIRE(output);
+
+    ConfigMap resident = { NULL, 0 };
+    REQUIRE(config_map_set(&resident, "resident", "M1"));
+    REQUIRE(monitor_groups_define(&resident));
+    config_map_clear(&resident);
+
+    CHECK(complete("toggle --only ", 2, output) == 0);
+    CHECK(has_line(output, "group:wall") && !has_line(output, "group:resident"));
+
+    // A resident process's groups survive a completion in the same process
+    char* cache_path = get_local_data_path("completion.json");
+    REQUIRE(cache_path);
+    MonitorList* cached = load_topology_file(cache_path);
+    free(cache_path);
+    REQUIRE(cached);
+    ULONG64 bits = 0;
+    CHECK(monitor_group_select("resident", cached, &bits) && bits == 0x1);
+    bits = 0;
+    CHECK(!monitor_group_select("wall", cached, &bits));
+    free_monitor_list(cached);
+    free(output);
+}
+
+static void test_latency(void) {
+    char* output = (char*)malloc(OUTPUT_SIZE);
+    REQUIRE(output);
+
+    enum { ROUNDS = 300 };
+    double samples[ROUNDS];
+    for (int i = 0; i < ROUNDS; i++) {
+        LARGE_INTEGER start, end, frequency;
+        QueryPerformanceCounter(&start);
+        complete("portrait --include M1,", 2, output);
+        QueryPerformanceCounter(&end);
+        QueryPerformanceFrequency(&frequency);
+        samples[i] = (double)(end.QuadPart - start.QuadPart) * 1000.0 / (double)frequency.QuadPart;
+    }
+
+    // Sorted by insertion; ROUNDS is small
+    for (int i = 1; i < ROUNDS; i++) {
+        double value = samples[i];
+        int j = i;
+        for (; j > 0 && samples[j - 1] > value; j--) samples[j] = samples[j - 1];
+        samples[j] = value;
+    }
+    double p50 = samples[ROUNDS / 2];
+    double p95 = samples[ROUNDS * 95 / 100];
+    printf("completion latency: p50 %.3f ms, p95 %.3f ms\n", p50, p95);
+    CHECK(p95 < 10.0);
+    free(output);
+}
+
+int main(void) {
+    test_isolate_data();
+    LogSink quiet = { quiet_log, NULL, false };
+    log_set_thread_sink(&quiet);
+    sprintf_s(g_output_path, sizeof(g_output_path), "%s/complete.out", getenv("LOCALAPPDATA"));
+
+    // A fresh cache, as the background refresh leaves it
+    char* cache_path = get_local_data_path("completion.json");
+    MonitorList* monitors = enumerate_monitors();
+    if (!cache_path || !monitors || !save_topology_file(monitors, cache_path)) return EXIT_FAILURE;
+    free_monitor_list(monitors);
+    free(cache_path);
+
+    write_config("{\"default_selector\":\"M1\",\"groups\":{\"wall\":\"M1,M2\",\"tv\":\"M2\"},"
+                 "\"hooks\":{\"post-apply\":\"echo done\"}}");
+
+    RUN_TEST(test_candidates);
+    RUN_TEST(test_serves_cache_not_displays);
+    RUN_TEST(test_definitions_untouched);
+    RUN_TEST(test_latency);
+    return TEST_EXIT_CODE();
+}
@@ -0,0 +1,160 @@
+#include "test.h"
+#include "mosdef.h"
+#include <sim.h>
+
+// Independent contexts used concurrently: each thread owns a context, a log
+// sink and one simulated monitor, and repeatedly enumerates, plans, applies
+// and rolls back. No context may see another's log output, and every
+// monitor must end each round where its own thread left it.
+
+#define THREAD_COUNT 4
+#define ROUNDS 40
+
+typedef struct {
+    int index;
+    char device_path[32];
+    char rotating[32];          // "Rotating monitor M<n> ", logged by this worker's applies
+    LONG rotations;
+    LONG foreign_rotations;     // Apply messages from another thread's context
+} Worker;
+
+static void worker_log(LogLevel level, const char* message, void* user_data) {
+    (void)level;
+    Worker* worker = (Worker*)user_data;
+    if (strncmp(message, "Rotating monitor ", 17) != 0) return;
+    if (strncmp(message, worker->rotating, strlen(worker->rotating)) == 0) {
+        InterlockedIncrement(&worker->rotations);
+    } else {
+        InterlockedIncrement(&worker->foreign_rotations);
+    }
+}
+
+static DWORD WINAPI worker_thread(LPVOID parameter) {
+    Worker* worker = (Worker*)parameter;
+    MosDefOptions options = { 0 };
+    options.verbose = true;
+    LogSink sink = { worker_log, worker, true };
+    MosDefContext* ctx = mosdef_create(&options, NULL, &sink);
+    CHECK(ctx != NULL);
+    if (!ctx) return 1;
+
+    char selector[8];
+    sprintf_s(selector, sizeof(selector), "M%d", worker->index + 1);
+    SelectorList* only = mosdef_parse_selectors(ctx, selector);
+    CHECK(only != NULL);
+
+    for (int round = 0; only && round < ROUNDS; round++) {
+        MonitorList* monitors = NULL;
+        CHECK(mosdef_enumerate(ctx, &monitors) == MOSDEF_OK);
+        if (monitors) {
+            CHECK(monitors->count == THREAD_COUNT);
+            mosdef_free_monitor_list(ctx, monitors);
+        }
+
+        RotationPlan* plan = NULL;
+        CHECK(mosdef_plan(ctx, ROTATION_PORTRAIT, only, NULL, &plan) == MOSDEF_OK);
+        if (!plan) break;
+        CHECK(plan->count == 1);
+        CHECK(plan->count == 1 && strcmp(plan->entries[0].device_path, worker->device_path) == 0);
+
+        BatchRotationResult result;
+        CHECK(mosdef_apply(ctx, plan, &result) == MOSDEF_OK);
+        CHECK(result.success_count == 1 && result.failure_count == 0);
+        mosdef_free_result(ctx, &result);
+
+        SimMonitor state;
+        CHECK(sim_get_monitor(worker->index, &state));
+        CHECK(state.orientation == DMDO_90 && state.width == 1080 && state.height == 1920);
+
+        CHECK(mosdef_rollback(ctx, plan) == MOSDEF_OK);
+        CHECK(sim_get_monitor(worker->index, &state));
+        CHECK(state.orientation == DMDO_DEFAULT && state.width == 1920 && state.height == 1080);
+        mosdef_free_plan(ctx, plan);
+    }
+
+    mosdef_free_selectors(ctx, only);
+    mosdef_destroy(ctx);
+    return 0;
+}
+
+static void test_independent_contexts(void) {
+    SimMonitor monitors[THREAD_COUNT];
+    static const char* connectors[THREAD_COUNT] = { "card0-DP-1", "card0-DP-2", "card0-DP-3", "card0-DP-4" };
+    for (int i = 0; i < THREAD_COUNT; i++) {
+        SimMonitor monitor = { "DEL4085", connectors[i], 1920, 1080, DMDO_DEFAULT, 60, 1920 * i, 0 };
+        monitors[i] = monitor;
+    }
+    REQUIRE(sim_set_monitors(monitors, THREAD_COUNT));
+
+    Worker workers[THREAD_COUNT];
+    HANDLE threads[THREAD_COUNT];
+    for (int i = 0; i < THREAD_COUNT; i++) {
+        memset(&workers[i], 0, sizeof(workers[i]));
+        workers[i].index = i;
+        sprintf_s(workers[i].device_path, sizeof(workers[i].device_path), "\\\\.\\DISPLAY%d", i + 1);
+        sprintf_s(workers[i].rotating, sizeof(workers[i].rotating), "Rotating monitor M%d ", i + 1);
+        threads[i] = CreateThread(NULL, 0, worker_thread, &workers[i], 0, NULL);
+        CHECK(threads[i] != NULL);
+    }
+
+    for (int i = 0; i < THREAD_COUNT; i++) {
+        if (!threads[i]) continue;
+        CHECK(WaitForSingleObject(threads[i], 60000) == WAIT_OBJECT_0);
+        CloseHandle(threads[i]);
+    }
+
+    LONG expected_changes = THREAD_COUNT * ROUNDS * 2;
+    CHECK(sim_change_count() == expected_changes);
+    for (int i = 0; i < THREAD_COUNT; i++) {
+        CHECK(workers[i].rotations == ROUNDS);
+        CHECK(workers[i].foreign_rotations == 0);
+    }
+}
+
+static void quiet_log(LogLevel level, const char* message, void* user_data) {
+    (void)level;
+    (void)message;
+    (void)user_data;
+}
+
+// A failure injected into one context's apply is reported there and leaves
+// the other contexts' results alone
+static void test_failure_stays_in_context(void) {
+    sim_reset();
+
+    LogSink quiet = { quiet_log, NULL, false };
+    MosDefContext* first = mosdef_create(NULL, NULL, &quiet);
+    MosDefContext* second = mosdef_create(NULL, NULL, &quiet);
+    REQUIRE(first && second);
+
+    RotationPlan* first_plan = NULL;
+    RotationPlan* second_plan = NULL;
+    CHECK(mosdef_plan(first, ROTATION_PORTRAIT, NULL, NULL, &first_plan) == MOSDEF_OK);
+    CHECK(mosdef_plan(second, ROTATION_PORTRAIT, NULL, NULL, &second_plan) == MOSDEF_OK);
+
+    if (first_plan && second_plan) {
+        sim_fail_changes(1, DISP_CHANGE_BADMODE);
+        BatchRotationResult failed;
+        CHECK(mosdef_apply(first, first_plan, &failed) != MOSDEF_OK || failed.failure_count == 1);
+        CHECK(failed.failure_count == 1 && failed.results[0].error_code == DISP_CHANGE_BADMODE);
+        mosdef_free_result(first, &failed);
+
+        BatchRotationResult applied;
+        CHECK(mosdef_apply(second, second_plan, &applied) == MOSDEF_OK);
+        CHECK(applied.success_count == second_plan->count && applied.failure_count == 0);
+        mosdef_free_result(second, &applied);
+        CHECK(mosdef_rollback(second, second_plan) == MOSDEF_OK);
+    }
+
+    mosdef_free_plan(first, first_plan);
+    mosdef_free_plan(second, second_plan);
+    mosdef_destroy(first);
+    mosdef_destroy(second);
+}
+
+int main(void) {
+    test_isolate_data();
+    RUN_TEST(test_independent_contexts);
+    RUN_TEST(test_failure_stays_in_context);
+    return TEST_EXIT_CODE();
+}
@@ -0,0 +1,247 @@
+#include "test.h"
+#include "dashboard.h"
+#include "screen.h"
+#include <sim.h>
+
+// Diff-based redraw and the live dashboard against a fake terminal. A small
+// VT emulator applies every write to a character grid, so the tests check
+// what a real terminal would show, not just the bytes sent.
+
+#define TERM_WIDTH 100
+#define TERM_HEIGHT 30
+
+typedef struct {
+    CRITICAL_SECTION lock;
+    char cells[TERM_HEIGHT][TERM_WIDTH + 1];
+    int row;
+    int col;
+    int writes;
+    size_t total_bytes;
+    bool alternate_screen;
+} Terminal;
+
+static void terminal_init(Terminal* terminal) {
+    memset(terminal, 0, sizeof(*terminal));
+    InitializeCriticalSection(&terminal->lock);
+    for (int row = 0; row < TERM_HEIGHT; row++) {
+        memset(terminal->cells[row], ' ', TERM_WIDTH);
+    }
+}
+
+// Handles the sequences screen.c and dashboard.c emit: CUP, SGR, ED 2 and
+// the private alternate screen and cursor modes
+static size_t apply_escape(Terminal* terminal, const char* data, size_t size) {
+    size_t i = 2;
+    bool private_mode = i < size && data[i] == '?';
+    if (private_mode) i++;
+
+    int params[4] = { 0, 0, 0, 0 };
+    int count = 0;
+    while (i < size && ((data[i] >= '0' && data[i] <= '9') || data[i] == ';')) {
+        if (data[i] == ';') {
+            if (count < 3) count++;
+        } else {
+            params[count] = params[count] * 10 + (data[i] - '0');
+        }
+        i++;
+    }
+    if (i >= size) return size;
+
+    switch (data[i]) {
+        case 'H':
+            terminal->row = params[0] > 0 ? params[0] - 1 : 0;
+            terminal->col = params[1] > 0 ? params[1] - 1 : 0;
+            break;
+        case 'J':
+            for (int row = 0; row < TERM_HEIGHT; row++) {
+                memset(terminal->cells[row], ' ', TERM_WIDTH);
+            }
+            break;
+        case 'h':
+        case 'l':
+            if (private_mode && params[0] == 1049) terminal->alternate_screen = data[i] == 'h';
+            break;
+        default:
+            break;
+    }
+    return i + 1;
+}
+
+static void terminal_write(const char* data, size_t size, void* user_data) {
+    Terminal* terminal = (Terminal*)user_data;
+    EnterCriticalSection(&terminal->lock);
+    terminal->writes++;
+    terminal->total_bytes += size;
+
+    size_t i = 0;
+    while (i < size) {
+        if (data[i] == '\x1b' && i + 1 < size && data[i + 1] == '[') {
+            i += apply_escape(terminal, data + i, size - i);
+            continue;
+        }
+        if (terminal->row < TERM_HEIGHT && terminal->col < TERM_WIDTH) {
+            terminal->cells[terminal->row][terminal->col] = data[i];
+        }
+        terminal->col++;
+        i++;
+    }
+    LeaveCriticalSection(&terminal->lock);
+}
+
+static bool terminal_row_contains(Terminal* terminal, int row, const char* text) {
+    EnterCriticalSection(&terminal->lock);
+    bool found = strstr(terminal->cells[row], text) != NULL;
+    LeaveCriticalSection(&terminal->lock);
+    return found;
+}
+
+static int terminal_find(Terminal* terminal, const char* text) {
+    for (int row = 0; row < TERM_HEIGHT; row++) {
+        if (terminal_row_contains(terminal, row, text)) return row;
+    }
+    return -1;
+}
+
+static bool wait_for_text(Terminal* terminal, const char* text) {
+    for (int i = 0; i < 500; i++) {
+        if (terminal_find(terminal, text) >= 0) return true;
+        Sleep(10);
+    }
+    fprintf(stderr, "Timed out waiting for '%s'\n", text);
+    return false;
+}
+
+// The emulated terminal matches the back buffer after every flush, and
+// flushes send only what changed
+static void test_screen_diff(void) {
+    Terminal terminal;
+    terminal_init(&terminal);
+    Screen* screen = screen_create(TERM_WIDTH, TERM_HEIGHT);
+    REQUIRE(screen);
+
+    screen_clear(screen);
+    for (int row = 0; row < TERM_HEIGHT; row++) {
+        char line[64];
+        sprintf_s(line, sizeof(line), "row %02d %s", row, row % 2 ? "odd" : "even");
+        screen_put_line(screen, row, line, row == 0 ? SCREEN_ATTR_REVERSE : SCREEN_ATTR_NORMAL);
+    }
+    size_t full = screen_flush(screen, terminal_write, &terminal);
+    CHECK(full > 0 && terminal.writes == 1);
+    CHECK(memcmp(terminal.cells[7], "row 07 odd ", 11) == 0);
+
+    // Nothing changed: nothing written
+    CHECK(screen_flush(screen, terminal_write, &terminal) == 0 && terminal.writes == 1);
+
+    // One cell: a cursor move and a byte
+    screen_put(screen, 12, 4, "X", SCREEN_ATTR_NORMAL);
+    size_t one = screen_flush(screen, terminal_write, &terminal);
+    CHECK(one > 0 && one <= 12 && terminal.writes == 2);
+    CHECK(memcmp(terminal.cells[12], "row X", 5) == 0);
+
+    // Rows redrawn identically except one word cost that word, not the rows
+    for (int row = 0; row < TERM_HEIGHT; row++) {
+        char line[64];
+        sprintf_s(line, sizeof(line), "row %02d %s", row, row == 20 ? "ODD!" : row % 2 ? "odd" : "even");
+        screen_put_line(screen, row, line, row == 0 ? SCREEN_ATTR_REVERSE : SCREEN_ATTR_NORMAL);
+    }
+    size_t word = screen_flush(screen, terminal_write, &terminal);
+    CHECK(word > 0 && word < 40 && terminal.writes == 3);
+    CHECK(memcmp(terminal.cells[20], "row 20 ODD!", 11) == 0);
+    CHECK(memcmp(terminal.cells[12], "row 12 even", 11) == 0);
+
+    // A resize redraws everything
+    CHECK(screen_resize(screen, TERM_WIDTH, TERM_HEIGHT - 1));
+    screen_clear(screen);
+    screen_put_line(screen, 3, "after resize", SCREEN_ATTR_BOLD);
+    CHECK(screen_flush(screen, terminal_write, &terminal) > 0);
+    CHECK(memcmp(terminal.cells[3], "after resize", 12) == 0);
+    CHECK(memcmp(terminal.cells[20], "    ", 4) == 0);
+
+    screen_destroy(screen);
+    DeleteCriticalSection(&terminal.lock);
+}
+
+static DWORD WINAPI dashboard_thread(LPVOID parameter) {
+    MosDefOptions options;
+    memset(&options, 0, sizeof(options));
+    *(int*)parameter = run_dashboard(&options);
+    return 0;
+}
+
+static bool wait_for_orientation(int index, DWORD orientation) {
+    for (int i = 0; i < 500; i++) {
+        SimMonitor monitor;
+        if (sim_get_monitor(index, &monitor) && monitor.orientation == orientation) return true;
+        Sleep(10);
+    }
+    return false;
+}
+
+static void test_live_dashboard(void) {
+    sim_reset();
+    Terminal terminal;
+    terminal_init(&terminal);
+    sim_set_terminal(TERM_WIDTH, TERM_HEIGHT, terminal_write, &terminal);
+
+    int exit_code = -1;
+    HANDLE thread = CreateThread(NULL, 0, dashboard_thread, &exit_code, 0, NULL);
+    REQUIRE(thread);
+
+    CHECK(wait_for_text(&terminal, "MOS-DEF top  2 monitor(s)"));
+    CHECK(terminal.alternate_screen);
+    int first = terminal_find(&terminal, "> M1");
+    CHECK(first == 2 && terminal_row_contains(&terminal, first, "2560x1440"));
+
+    // Select M2 and rotate it from the keyboard
+    sim_push_key(VK_DOWN);
+    CHECK(wait_for_text(&terminal, "> M2"));
+    sim_push_key('P');
+    CHECK(wait_for_orientation(1, DMDO_90));
+    CHECK(wait_for_text(&terminal, "portrait: success"));
+    CHECK(wait_for_text(&terminal, "modesets 1"));
+    CHECK(wait_for_text(&terminal, "1080x1920"));
+
+    // A hot-plug arrives as a notification, not by polling
+    EnterCriticalSection(&terminal.lock);
+    size_t bytes_before = terminal.total_bytes;
+    LeaveCriticalSection(&terminal.lock);
+    SimMonitor topology[3];
+    REQUIRE(sim_get_monitor(0, &topology[0]) && sim_get_monitor(1, &topology[1]));
+    SimMonitor samsung = { "SAM0F9E", "card0-DP-2", 1920, 1080, DMDO_DEFAULT, 60, 3640, 0 };
+    topology[2] = samsung;
+    CHECK(sim_set_monitors(topology, 3));
+    CHECK(wait_for_text(&terminal, "MOS-DEF top  3 monitor(s)"));
+    CHECK(wait_for_text(&terminal, "monitor_added (SAM0F9E)"));
+
+    // Incremental frames cost far less than the full first one
+    EnterCriticalSection(&terminal.lock);
+    size_t update_bytes = terminal.total_bytes - bytes_before;
+    LeaveCriticalSection(&terminal.lock);
+    CHECK(update_bytes > 0 && update_bytes < (size_t)TERM_WIDTH * TERM_HEIGHT / 2);
+
+    // Idle: no writes without events
+    EnterCriticalSection(&terminal.lock);
+    int writes = terminal.writes;
+    LeaveCriticalSection(&terminal.lock);
+    Sleep(200);
+    EnterCriticalSection(&terminal.lock);
+    CHECK(terminal.writes == writes);
+    LeaveCriticalSection(&terminal.lock);
+
+    sim_push_key('Q');
+    CHECK(WaitForSingleObject(thread, 10000) == WAIT_OBJECT_0);
+    CloseHandle(thread);
+    CHECK(exit_code == 0);
+    CHECK(!terminal.alternate_screen);
+
+    sim_set_terminal(0, 0, NULL, NULL);
+    DeleteCriticalSection(&terminal.lock);
+    sim_reset();
+}
+
+int main(void) {
+    test_isolate_data();
+    RUN_TEST(test_screen_diff);
+    RUN_TEST(test_live_dashboard);
+    return TEST_EXIT_CODE();
+}
@@ -0,0 +1,202 @@
+#include "test.h"
+#include "cli.h"
+#include <sim.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// mos-def diff against the simulated topology: every output line must be
+// valid JSON, including IDs from the expected file that need escaping, and
+// the exit code is 0 in sync, 5 drifted and 2 for an unreadable file.
+
+#define OUTPUT_SIZE 8192
+
+static char g_directory[MAX_PATH];
+
+static void quiet_log(LogLevel level, const char* message, void* user_data) {
+    (void)level;
+    (void)message;
+    (void)user_data;
+}
+
+// Runs "mos-def diff <path>" and captures its stdout
+static int run_diff(const char* path, char* output) {
+    char* argv[] = { "mos-def", "diff", (char*)path };
+    CliArgs* args = parse_args(3, argv);
+    LogSink quiet = { quiet_log, NULL, false };
+    MosDefContext* ctx = args ? mosdef_create(NULL, NULL, &quiet) : NULL;
+    if (!ctx) {
+        free_cli_args(args);
+        return -1;
+    }
+
+    char capture_path[MAX_PATH];
+    sprintf_s(capture_path, sizeof(capture_path), "%s/diff.out", g_directory);
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    int capture = open(capture_path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (saved < 0 || capture < 0) return -1;
+    dup2(capture, STDOUT_FILENO);
+    int result = handle_diff_command(ctx, args);
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+
+    lseek(capture, 0, SEEK_SET);
+    ssize_t size = read(capture, output, OUTPUT_SIZE - 1);
+    close(capture);
+    output[size > 0 ? size : 0] = '\0';
+
+    mosdef_destroy(ctx);
+    free_cli_args(args);
+    return result;
+}
+
+// Minimal JSON syntax check, enough for the NDJSON records diff writes
+static bool parse_value(const char** pos);
+
+static void skip_space(const char** pos) {
+    while (**pos == ' ') (*pos)++;
+}
+
+static bool parse_string(const char** pos) {
+    if (**pos != '"') return false;
+    for ((*pos)++; **pos != '"'; (*pos)++) {
+        unsigned char c = (unsigned char)**pos;
+        if (c < 0x20) return false;
+        if (c != '\\') continue;
+        (*pos)++;
+        if (**pos == 'u') {
+            for (int i = 1; i <= 4; i++) {
+                if (!isxdigit((unsigned char)(*pos)[i])) return false;
+            }
+            *pos += 4;
+        } else if (!strchr("\"\\/bfnrt", **pos) || **pos == '\0') {
+            return false;
+        }
+    }
+    (*pos)++;
+    return true;
+}
+
+static bool parse_object(const char** pos) {
+    (*pos)++;
+    skip_space(pos);
+    if (**pos == '}') {
+        (*pos)++;
+        return true;
+    }
+    for (;;) {
+        skip_space(pos);
+        if (!parse_string(pos)) return false;
+        skip_space(pos);
+        if (*(*pos)++ != ':' || !parse_value(pos)) return false;
+        skip_space(pos);
+        char next = *(*pos)++;
+        if (next == '}') return true;
+        if (next != ',') return false;
+    }
+}
+
+static bool parse_value(const char** pos) {
+    skip_space(pos);
+    if (**pos == '{') return parse_object(pos);
+    if (**pos == '"') return parse_string(pos);
+    for (const char* literal = "true\0false\0null\0"; *literal; literal += strlen(literal) + 1) {
+        if (strncmp(*pos, literal, strlen(literal)) == 0) {
+            *pos += strlen(literal);
+            return true;
+        }
+    }
+    const char* start = *pos;
+    if (**pos == '-') (*pos)++;
+    while (isdigit((unsigned char)**pos)) (*pos)++;
+    return *pos > start && isdigit((unsigned char)(*pos)[-1]);
+}
+
+static bool all_lines_json(const char* output, int* out_lines) {
+    int lines = 0;
+    for (const char* line = output; *line; lines++) {
+        const char* pos = line;
+        if (!parse_value(&pos) || *pos != '\n') {
+            fprintf(stderr, "invalid JSON line: %.*s\n", (int)strcspn(line, "\n"), line);
+            return false;
+        }
+        line = pos + 1;
+    }
+    *out_lines = lines;
+    return true;
+}
+
+// The live two-monitor topology, with M2 at second_degrees and extra_monitor
+// appended to the list
+static bool write_expected(const char* path, const char* extra_monitor, int second_degrees) {
+    FILE* file = NULL;
+    if (fopen_s(&file, path, "w") != 0 || !file) return false;
+    fprintf(file,
+            "{\"version\":1,\"monitors\":["
+            "{\"id\":\"M1\",\"device_name\":\"Simulated Display\",\"device_path\":\"\\\\\\\\.\\\\DISPLAY1\","
+            "\"stable_id\":\"DEL4085\",\"width\":2560,\"height\":1440,\"orientation\":0,"
+            "\"position_x\":0,\"position_y\":0,\"refresh_hz\":60},"
+            "{\"id\":\"M2\",\"device_name\":\"Simulated Display\",\"device_path\":\"\\\\\\\\.\\\\DISPLAY2\","
+            "\"stable_id\":\"GSM5B7F\",\"width\":%lu,\"height\":%lu,\"orientation\":%lu,"
+            "\"position_x\":2560,\"position_y\":0,\"refresh_hz\":60}%s]}\n",
+            (unsigned long)(second_degrees == 90 ? 1080 : 1920),
+            (unsigned long)(second_degrees == 90 ? 1920 : 1080),
+            (unsigned long)second_degrees, extra_monitor ? extra_monitor : "");
+    return fclose(file) == 0;
+}
+
+static void test_in_sync(void) {
+    sim_reset();
+    char path[MAX_PATH];
+    sprintf_s(path, sizeof(path), "%s/expected.json", g_directory);
+    REQUIRE(write_expected(path, NULL, 0));
+
+    char output[OUTPUT_SIZE];
+    CHECK(run_diff(path, output) == 0);
+    int lines = 0;
+    CHECK(all_lines_json(output, &lines) && lines == 1);
+    CHECK(strstr(output, "\"event\":\"summary\",\"in_sync\":true,\"expected\":2,\"actual\":2") != NULL);
+}
+
+static void test_drift_with_escaped_ids(void) {
+    sim_reset();
+    char path[MAX_PATH];
+    sprintf_s(path, sizeof(path), "%s/expected.json", g_directory);
+
+    // An expected monitor whose ID holds a quote, a backslash and a tab, and
+    // a rotated M2
+    const char* extra =
+        ",{\"id\":\"M\\\"3\\\\\\t\",\"device_name\":\"Side \\\"panel\\\"\",\"device_path\":\"\\\\\\\\.\\\\DISPLAY3\","
+        "\"stable_id\":\"SAM0F9E\",\"width\":1920,\"height\":1080,\"orientation\":0,"
+        "\"position_x\":4480,\"position_y\":0,\"refresh_hz\":60}";
+    REQUIRE(write_expected(path, extra, 90));
+
+    char output[OUTPUT_SIZE];
+    CHECK(run_diff(path, output) == 5);
+    int lines = 0;
+    CHECK(all_lines_json(output, &lines) && lines == 4);
+    CHECK(strstr(output, "\"event\":\"monitor_removed\",\"id\":\"M\\\"3\\\\\\t\",\"stable_id\":\"SAM0F9E\"") != NULL);
+    CHECK(strstr(output, "\"event\":\"orientation_changed\",\"id\":\"M2\"") != NULL);
+    CHECK(strstr(output, "\"in_sync\":false,\"expected\":3,\"actual\":2,\"removed\":1,\"added\":0,\"changed\":1") != NULL);
+}
+
+static void test_unreadable_file(void) {
+    char path[MAX_PATH];
+    sprintf_s(path, sizeof(path), "%s/missing.json", g_directory);
+    char output[OUTPUT_SIZE];
+    CHECK(run_diff(path, output) == 2);
+    CHECK(output[0] == '\0');
+}
+
+int main(void) {
+    test_isolate_data();
+    LogSink quiet = { quiet_log, NULL, false };
+    log_set_thread_sink(&quiet);
+    strcpy_s(g_directory, sizeof(g_directory), getenv("LOCALAPPDATA"));
+    RUN_TEST(test_in_sync);
+    RUN_TEST(test_drift_with_escaped_ids);
+    RUN_TEST(test_unreadable_file);
+    return TEST_EXIT_CODE();
+}
@@ -0,0 +1,196 @@
+#include "test.h"
+#include "mosdef.h"
+#include "edid.h"
+#include <sim.h>
+
+// EDID parsing over the fixture corpus, the sysfs source behind
+// edid_lookup_monitor, and least-recently-used eviction in the parse cache.
+
+#define INTERFACE_FORMAT "\\\\?\\DISPLAY#%s#%s#{e6f07b5f-ee97-4a90-b076-33f57bf4eaa7}"
+
+static bool parse_fixture(const char* fixture, EdidInfo* info) {
+    BYTE edid[EDID_MAX_SIZE];
+    DWORD size = test_read_fixture(fixture, edid, sizeof(edid));
+    return size > 0 && edid_parse(edid, size, info);
+}
+
+static void test_fixture_corpus(void) {
+    EdidInfo info;
+    CHECK(parse_fixture("edid/dell_u2720q.bin", &info));
+    CHECK(strcmp(info.model_name, "DELL U2720Q") == 0);
+    CHECK(info.native_width == 3840 && info.native_height == 2160 && info.native_refresh_hz == 60);
+    CHECK(info.width_mm == 597 && info.height_mm == 336);
+    CHECK(info.extension_count == 1 && info.has_cta_extension && !info.has_displayid_extension);
+    CHECK(info.checksum_valid);
+
+    CHECK(parse_fixture("edid/lg_no_serial.bin", &info));
+    CHECK(strcmp(info.model_name, "LG ULTRAFINE") == 0);
+    CHECK(info.native_width == 2560 && info.native_height == 1440);
+    CHECK(info.extension_count == 0 && info.checksum_valid);
+
+    // No base-block timing; the first CTA VIC (97) is the native mode
+    CHECK(parse_fixture("edid/cta_only_timing.bin", &info));
+    CHECK(strcmp(info.identity.manufacturer, "ACR") == 0 && info.identity.product_code == 0x0421);
+    CHECK(strcmp(info.model_name, "ACER XV") == 0);
+    CHECK(info.native_width == 3840 && info.native_height == 2160 && info.native_refresh_hz == 60);
+    CHECK(info.width_mm == 0 && info.has_cta_extension);
+
+    // The DisplayID preferred timing and product name win over the base block
+    CHECK(parse_fixture("edid/displayid_panel.bin", &info));
+    CHECK(strcmp(info.identity.manufacturer, "BOE") == 0 && info.identity.product_code == 0x0A1B);
+    CHECK(strcmp(info.model_name, "NE160WUM") == 0);
+    CHECK(info.native_width == 2560 && info.native_height == 1600 && info.native_refresh_hz == 120);
+    CHECK(info.width_mm == 302 && info.height_mm == 188);
+    CHECK(info.has_displayid_extension && !info.has_cta_extension);
+
+    // A bad checksum is reported but the data is still used
+    CHECK(parse_fixture("edid/bad_checksum.bin", &info));
+    CHECK(!info.checksum_valid && strcmp(info.model_name, "LG ULTRAFINE") == 0);
+
+    CHECK(!parse_fixture("edid/bad_header.bin", &info));
+    CHECK(!parse_fixture("edid/truncated.bin", &info));
+}
+
+// Writes <MOSDEF_DRM_ROOT>/<connector>/edid
+static void write_sysfs_edid(const char* connector, const BYTE* edid, DWORD size) {
+    char path[MAX_PATH];
+    snprintf(path, sizeof(path), "%s", getenv("MOSDEF_DRM_ROOT"));
+    CreateDirectoryA(path, NULL);
+    snprintf(path, sizeof(path), "%s/%s", getenv("MOSDEF_DRM_ROOT"), connector);
+    CreateDirectoryA(path, NULL);
+    snprintf(path, sizeof(path), "%s/%s/edid", getenv("MOSDEF_DRM_ROOT"), connector);
+
+    FILE* file = NULL;
+    REQUIRE(fopen_s(&file, path, "wb") == 0 && file);
+    CHECK(fwrite(edid, 1, size, file) == size);
+    fclose(file);
+}
+
+static void write_sysfs_fixture(const char* connector, const char* fixture) {
+    BYTE edid[EDID_MAX_SIZE];
+    DWORD size = test_read_fixture(fixture, edid, sizeof(edid));
+    REQUIRE(size > 0);
+    write_sysfs_edid(connector, edid, size);
+}
+
+static void quiet_log(LogLevel level, const char* message, void* user_data) {
+    (void)level;
+    (void)message;
+    (void)user_data;
+}
+
+static const MonitorInfo* monitor_on(const MonitorList* monitors, const char* connector) {
+    for (int i = 0; i < monitors->count; i++) {
+        if (strstr(monitors->monitors[i].monitor_interface, connector)) return &monitors->monitors[i];
+    }
+    return NULL;
+}
+
+static void test_sysfs_source(void) {
+    edid_cache_clear();
+    write_sysfs_fixture("card0-DP-1", "edid/dell_u2720q.bin");
+    // Disconnected connectors expose an empty attribute
+    write_sysfs_edid("card0-HDMI-A-1", NULL, 0);
+
+    BYTE edid[EDID_MAX_SIZE];
+    char name[256];
+    snprintf(name, sizeof(name), INTERFACE_FORMAT, "DEL4085", "card0-DP-1");
+    CHECK(edid_read_for_monitor(name, edid, sizeof(edid)) == 2 * EDID_BLOCK_SIZE);
+    snprintf(name, sizeof(name), INTERFACE_FORMAT, "GSM5B7F", "card0-HDMI-A-1");
+    CHECK(edid_read_for_monitor(name, edid, sizeof(edid)) == 0);
+    // The connector segment never escapes the DRM root
+    snprintf(name, sizeof(name), INTERFACE_FORMAT, "DEL4085", "..\\/card0-DP-1");
+    CHECK(edid_read_for_monitor(name, edid, sizeof(edid)) == 0);
+    CHECK(edid_read_for_monitor("DEL4085", edid, sizeof(edid)) == 0);
+
+    // Enumeration picks the sysfs EDID up for the simulated DP-1 panel
+    LogSink quiet = { quiet_log, NULL, false };
+    MosDefContext* ctx = mosdef_create(NULL, NULL, &quiet);
+    REQUIRE(ctx);
+    MonitorList* monitors = NULL;
+    REQUIRE(mosdef_enumerate(ctx, &monitors) == MOSDEF_OK);
+
+    const MonitorInfo* dell = monitor_on(monitors, "card0-DP-1#");
+    const MonitorInfo* lg = monitor_on(monitors, "card0-HDMI-A-1#");
+    CHECK(dell && strcmp(dell->model_name, "DELL U2720Q") == 0);
+    CHECK(dell && dell->native_width == 3840 && dell->native_height == 2160);
+    CHECK(dell && dell->width_mm == 597 && strcmp(dell->stable_id, "DEL4085-1A2B3C4D") == 0);
+    CHECK(lg && lg->model_name[0] == '\0' && lg->native_width == 0);
+    CHECK(lg && strcmp(lg->stable_id, "GSM5B7F") == 0);
+    mosdef_free_monitor_list(ctx, monitors);
+
+    // sysfs has no change stamp: a replaced blob is seen on the next enumeration
+    write_sysfs_fixture("card0-DP-1", "edid/lg_no_serial.bin");
+    REQUIRE(mosdef_enumerate(ctx, &monitors) == MOSDEF_OK);
+    dell = monitor_on(monitors, "card0-DP-1#");
+    CHECK(dell && strcmp(dell->model_name, "LG ULTRAFINE") == 0);
+    mosdef_free_monitor_list(ctx, monitors);
+
+    mosdef_destroy(ctx);
+    sim_reset();
+}
+
+#define EVICTION_PANELS 100
+
+// lg_no_serial.bin with serial number index + 1 and the checksum fixed up
+static void make_panel(const BYTE* base, BYTE* edid, int index) {
+    memcpy(edid, base, EDID_BLOCK_SIZE);
+    DWORD serial = (DWORD)index + 1;
+    memcpy(edid + 12, &serial, sizeof(serial));
+    BYTE sum = 0;
+    for (int i = 0; i < EDID_BLOCK_SIZE - 1; i++) sum += edid[i];
+    edid[EDID_BLOCK_SIZE - 1] = (BYTE)(0x100 - sum);
+}
+
+static bool lookup_panel(int index, EdidInfo* info) {
+    char connector[32];
+    char name[256];
+    snprintf(connector, sizeof(connector), "card1-DP-%d", index);
+    snprintf(name, sizeof(name), INTERFACE_FORMAT, "GSM5B7F", connector);
+    return edid_lookup_monitor(name, info);
+}
+
+// Filling the cache past its limit evicts the oldest entries one at a time
+// instead of dropping everything
+static void test_cache_evicts_least_recently_used(void) {
+    BYTE base[EDID_MAX_SIZE];
+    REQUIRE(test_read_fixture("edid/lg_no_serial.bin", base, sizeof(base)) == EDID_BLOCK_SIZE);
+    for (int i = 0; i < EVICTION_PANELS; i++) {
+        BYTE edid[EDID_BLOCK_SIZE];
+        char connector[32];
+        make_panel(base, edid, i);
+        snprintf(connector, sizeof(connector), "card1-DP-%d", i);
+        write_sysfs_edid(connector, edid, sizeof(edid));
+    }
+
+    edid_cache_clear();
+    EdidInfo info;
+    for (int i = 0; i < EVICTION_PANELS; i++) {
+        CHECK(lookup_panel(i, &info) && info.identity.serial_number == (DWORD)i + 1 && info.checksum_valid);
+    }
+    EdidCacheStats stats = edid_cache_get_stats();
+    CHECK(stats.parses == EVICTION_PANELS);
+    CHECK(stats.evictions > 0 && stats.evictions < EVICTION_PANELS);
+
+    // The most recent panels are all still cached
+    LONG64 cached = EVICTION_PANELS - stats.evictions;
+    for (int i = EVICTION_PANELS - (int)cached; i < EVICTION_PANELS; i++) {
+        CHECK(lookup_panel(i, &info) && info.identity.serial_number == (DWORD)i + 1);
+    }
+    CHECK(edid_cache_get_stats().parses == EVICTION_PANELS);
+
+    // The oldest was evicted and is parsed again
+    CHECK(lookup_panel(0, &info) && info.identity.serial_number == 1);
+    stats = edid_cache_get_stats();
+    CHECK(stats.parses == EVICTION_PANELS + 1);
+    CHECK(stats.lookups == EVICTION_PANELS + cached + 1);
+    edid_cache_clear();
+}
+
+int main(void) {
+    test_isolate_data();
+    RUN_TEST(test_fixture_corpus);
+    RUN_TEST(test_sysfs_source);
+    RUN_TEST(test_cache_evicts_least_recently_used);
+    return TEST_EXIT_CODE();
+}
@@ -0,0 +1,246 @@
+// Winsock 2 must precede windows.h
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include "test.h"
+#include "fleet.h"
+#include <sim.h>
+#include <unistd.h>
+
+// Fleet authentication and agent concurrency against a live agent on
+// loopback: a controller holding the agent's key rolls a rotation out, while
+// a wrong key, a forged MAC or a frame replayed onto a new connection is
+// rejected without touching the displays, and an idle client neither stalls
+// another controller nor holds its connection past the header deadline.
+
+// AGENT_HEADER_TIMEOUT_MS in agent.c
+#define AGENT_TEST_HEADER_MS 2000
+
+static char g_directory[MAX_PATH];
+static USHORT g_port;
+
+static void quiet_log(LogLevel level, const char* message, void* user_data) {
+    (void)level;
+    (void)message;
+    (void)user_data;
+}
+
+static DWORD WINAPI agent_thread(LPVOID parameter) {
+    (void)parameter;
+    LogSink quiet = { quiet_log, NULL, false };
+    log_set_thread_sink(&quiet);
+
+    MosDefOptions options;
+    memset(&options, 0, sizeof(options));
+    char address[32];
+    sprintf_s(address, sizeof(address), "127.0.0.1:%u", (unsigned)g_port);
+    // The default key path, so the agent creates the key on first start
+    return (DWORD)run_agent(&options, NULL, NULL, address, NULL);
+}
+
+static SOCKET connect_agent(void) {
+    SOCKET client = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    SOCKADDR_IN address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(g_port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (client != INVALID_SOCKET && connect(client, (SOCKADDR*)&address, sizeof(address)) == SOCKET_ERROR) {
+        closesocket(client);
+        client = INVALID_SOCKET;
+    }
+    return client;
+}
+
+static bool recv_exact(SOCKET socket, BYTE* buffer, DWORD length) {
+    for (DWORD received = 0; received < length;) {
+        int count = recv(socket, (char*)buffer + received, (int)(length - received), 0);
+        if (count <= 0) return false;
+        received += (DWORD)count;
+    }
+    return true;
+}
+
+static bool read_challenge(SOCKET client, BYTE* challenge) {
+    BYTE frame[FLEET_HEADER_SIZE + FLEET_CHALLENGE_SIZE];
+    FleetMessageType type;
+    BYTE flags;
+    DWORD length;
+    if (!recv_exact(client, frame, sizeof(frame)) || !fleet_parse_header(frame, &type, &flags, &length) ||
+        type != FLEET_CHALLENGE || length != FLEET_CHALLENGE_SIZE) {
+        return false;
+    }
+    memcpy(challenge, frame + FLEET_HEADER_SIZE, FLEET_CHALLENGE_SIZE);
+    return true;
+}
+
+// Sends header and payload as given and reads the response header; returns
+// its flags, or -1 if the exchange failed
+static int exchange(SOCKET client, const BYTE* header, const char* payload) {
+    BYTE response[FLEET_HEADER_SIZE];
+    FleetMessageType type;
+    BYTE flags;
+    DWORD length;
+    if (send(client, (const char*)header, FLEET_HEADER_SIZE, 0) != FLEET_HEADER_SIZE ||
+        send(client, payload, (int)strlen(payload), 0) != (int)strlen(payload) ||
+        !recv_exact(client, response, sizeof(response)) ||
+        !fleet_parse_header(response, &type, &flags, &length) || type != FLEET_RESPONSE) {
+        return -1;
+    }
+    return flags;
+}
+
+static bool write_file(const char* name, const char* text, char* path, size_t size) {
+    sprintf_s(path, size, "%s/%s", g_directory, name);
+    FILE* file = NULL;
+    if (fopen_s(&file, path, "wb") != 0 || !file) return false;
+    fputs(text, file);
+    fclose(file);
+    return true;
+}
+
+static int run_rollout(const char* action, const char* key_path) {
+    char hosts[MAX_PATH];
+    char line[64];
+    sprintf_s(line, sizeof(line), "127.0.0.1:%u\n", (unsigned)g_port);
+    if (!write_file("hosts.txt", line, hosts, sizeof(hosts))) return -1;
+
+    LogSink quiet = { quiet_log, NULL, false };
+    MosDefContext* ctx = mosdef_create(NULL, NULL, &quiet);
+    if (!ctx) return -1;
+
+    FleetOptions options;
+    memset(&options, 0, sizeof(options));
+    options.hosts_path = hosts;
+    options.action = action;
+    options.window = 4;
+    options.deadline_ms = 5000;
+    options.key_path = key_path;
+
+    // Records go to stdout, which ctest captures
+    int result = run_fleet(ctx, &options);
+    mosdef_destroy(ctx);
+    return result;
+}
+
+static DWORD orientation_of(int index) {
+    SimMonitor monitor;
+    return sim_get_monitor(index, &monitor) ? monitor.orientation : (DWORD)-1;
+}
+
+static void test_signed_rollout(void) {
+    sim_reset();
+    CHECK(run_rollout("portrait --only M2", NULL) == 0);
+    CHECK(orientation_of(1) == DMDO_90);
+    CHECK(orientation_of(0) == DMDO_DEFAULT);
+}
+
+static void test_wrong_key(void) {
+    sim_reset();
+    char key_path[MAX_PATH];
+    REQUIRE(write_file("other.key", "0123456789abcdef0123456789abcdef\n", key_path, sizeof(key_path)));
+    CHECK(run_rollout("portrait --only M2", key_path) == 6);
+    CHECK(sim_change_count() == 0);
+}
+
+static void test_forged_mac(void) {
+    sim_reset();
+    const char* payload = "portrait --only M2";
+    SOCKET client = connect_agent();
+    REQUIRE(client != INVALID_SOCKET);
+
+    BYTE challenge[FLEET_CHALLENGE_SIZE];
+    BYTE header[FLEET_HEADER_SIZE];
+    CHECK(read_challenge(client, challenge));
+    fleet_write_header(header, FLEET_REQUEST_ROTATE, 0, (DWORD)strlen(payload));
+    memset(header + FLEET_SIGNED_HEADER_SIZE, 0xA5, FLEET_HEADER_SIZE - FLEET_SIGNED_HEADER_SIZE);
+
+    int flags = exchange(client, header, payload);
+    CHECK(flags >= 0 && (flags & FLEET_FLAG_REJECTED));
+    CHECK(sim_change_count() == 0);
+    closesocket(client);
+}
+
+static void test_replay_rejected(void) {
+    sim_reset();
+    FleetKey key;
+    REQUIRE(fleet_load_key(NULL, false, &key));
+    const char* payload = "portrait --only M2";
+
+    // A genuine request runs
+    SOCKET client = connect_agent();
+    REQUIRE(client != INVALID_SOCKET);
+    BYTE challenge[FLEET_CHALLENGE_SIZE];
+    BYTE header[FLEET_HEADER_SIZE];
+    CHECK(read_challenge(client, challenge));
+    fleet_write_header(header, FLEET_REQUEST_ROTATE, 0, (DWORD)strlen(payload));
+    fleet_sign_frame(&key, challenge, NULL, header, (const BYTE*)payload, (DWORD)strlen(payload));
+    CHECK(exchange(client, header, payload) == 0);
+    CHECK(sim_change_count() == 1);
+    closesocket(client);
+
+    // The same bytes on a new connection carry the old challenge's MAC
+    sim_reset();
+    client = connect_agent();
+    REQUIRE(client != INVALID_SOCKET);
+    CHECK(read_challenge(client, challenge));
+    int flags = exchange(client, header, payload);
+    CHECK(flags >= 0 && (flags & FLEET_FLAG_REJECTED));
+    CHECK(sim_change_count() == 0);
+    closesocket(client);
+}
+
+static void test_idle_client(void) {
+    sim_reset();
+    SOCKET idle = connect_agent();
+    REQUIRE(idle != INVALID_SOCKET);
+    BYTE challenge[FLEET_CHALLENGE_SIZE];
+    CHECK(read_challenge(idle, challenge));
+    ULONGLONG connected = GetTickCount64();
+
+    // Another controller is served while the idle one holds its connection
+    CHECK(run_rollout("portrait --only M2", NULL) == 0);
+    CHECK(GetTickCount64() - connected < AGENT_TEST_HEADER_MS);
+    CHECK(orientation_of(1) == DMDO_90);
+
+    // The agent closes the idle connection at the header deadline
+    char byte;
+    CHECK(recv(idle, &byte, 1, 0) <= 0);
+    ULONGLONG waited = GetTickCount64() - connected;
+    CHECK(waited >= AGENT_TEST_HEADER_MS - 500 && waited < AGENT_TEST_HEADER_MS + 3000);
+    closesocket(idle);
+}
+
+int main(void) {
+    test_isolate_data();
+    const char* local = getenv("LOCALAPPDATA");
+    strcpy_s(g_directory, sizeof(g_directory), local ? local : "/tmp");
+    g_port = (USHORT)(20000 + getpid() % 20000);
+
+    HANDLE agent = CreateThread(NULL, 0, agent_thread, NULL, 0, NULL);
+    if (!agent) return EXIT_FAILURE;
+
+    // Wait for the listener
+    SOCKET probe = INVALID_SOCKET;
+    for (int attempt = 0; attempt < 100 && probe == INVALID_SOCKET; attempt++) {
+        probe = connect_agent();
+        if (probe == INVALID_SOCKET) Sleep(20);
+    }
+    if (probe == INVALID_SOCKET) {
+        fprintf(stderr, "Agent did not start on port %u\n", (unsigned)g_port);
+        return EXIT_FAILURE;
+    }
+    closesocket(probe);
+
+    RUN_TEST(test_signed_rollout);
+    RUN_TEST(test_wrong_key);
+    RUN_TEST(test_forged_mac);
+    RUN_TEST(test_replay_rejected);
+    RUN_TEST(test_idle_client);
+
+    sim_send_ctrl_c();
+    CHECK(WaitForSingleObject(agent, 15000) == WAIT_OBJECT_0);
+    DWORD exit_code = 1;
+    CHECK(GetExitCodeThread(agent, &exit_code) && exit_code == 0);
+    CloseHandle(agent);
+    return TEST_EXIT_CODE();
+}
@@ -0,0 +1,141 @@
+#include "test.h"
+#include "fleet.h"
+#include "agent_pool.h"
+#include <fcntl.h>
+#include <unistd.h>
+
+// Rollouts across a few hundred local agents, each its own process with
+// its own simulated displays: every host reports its change once and only
+// once, stages split the fleet as requested, and a host that is down is
+// reported unreachable without holding up the rest.
+
+#define AGENT_COUNT 200
+#define ROLLOUT_WINDOW 64
+
+static char g_directory[MAX_PATH];
+static AgentPool g_pool;
+
+static void quiet_log(LogLevel level, const char* message, void* user_data) {
+    (void)level;
+    (void)message;
+    (void)user_data;
+}
+
+// Runs a rollout with its records captured; returns run_fleet's exit code
+// and a malloc'd copy of the records in *out_output
+static int run_rollout(const char* hosts_path, const char* action, const char* stages, char** out_output) {
+    *out_output = NULL;
+    LogSink quiet = { quiet_log, NULL, false };
+    MosDefContext* ctx = mosdef_create(NULL, NULL, &quiet);
+    if (!ctx) return -1;
+
+    FleetOptions options;
+    memset(&options, 0, sizeof(options));
+    options.hosts_path = hosts_path;
+    options.key_path = g_pool.key_path;
+    options.action = action;
+    options.window = ROLLOUT_WINDOW;
+    options.deadline_ms = 30000;
+    options.stages = stages;
+
+    char capture_path[MAX_PATH];
+    sprintf_s(capture_path, sizeof(capture_path), "%s/rollout.out", g_directory);
+    fflush(stdout);
+    int saved = dup(STDOUT_FILENO);
+    int capture = open(capture_path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (saved < 0 || capture < 0) return -1;
+    dup2(capture, STDOUT_FILENO);
+    int result = run_fleet(ctx, &options);
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+
+    off_t size = lseek(capture, 0, SEEK_END);
+    char* output = (char*)malloc((size_t)size + 1);
+    lseek(capture, 0, SEEK_SET);
+    if (output) {
+        ssize_t read_size = read(capture, output, (size_t)size);
+        output[read_size > 0 ? read_size : 0] = '\0';
+    }
+    close(capture);
+    mosdef_destroy(ctx);
+    *out_output = output;
+    return result;
+}
+
+static int count_occurrences(const char* text, const char* pattern) {
+    int count = 0;
+    for (const char* at = text; at && (at = strstr(at, pattern)) != NULL; at += strlen(pattern)) count++;
+    return count;
+}
+
+// Host records for distinct hosts: each port appears in exactly one record
+static bool one_record_per_host(const char* output, int extra_hosts) {
+    for (int i = 0; i < g_pool.count + extra_hosts; i++) {
+        char host[48];
+        sprintf_s(host, sizeof(host), "\"host\":\"127.0.0.1:%u\"", (unsigned)(g_pool.first_port + i));
+        if (count_occurrences(output, host) != 1) {
+            fprintf(stderr, "%s reported %d times\n", host, count_occurrences(output, host));
+            return false;
+        }
+    }
+    return true;
+}
+
+static void test_rollout(void) {
+    char* output = NULL;
+    CHECK(run_rollout(g_pool.hosts_path, "portrait --only M2", NULL, &output) == 0);
+    REQUIRE(output);
+    CHECK(one_record_per_host(output, 0));
+    CHECK(count_occurrences(output, "\"result\":\"ok\",\"status\":\"success\",\"exit\":0,\"changed\":1,") == AGENT_COUNT);
+    CHECK(strstr(output, "\"event\":\"summary\",\"hosts\":200,\"ok\":200,\"failed\":0,\"skipped\":0") != NULL);
+    free(output);
+}
+
+static void test_stages(void) {
+    char* output = NULL;
+    CHECK(run_rollout(g_pool.hosts_path, "landscape --only M2", "1,10%,100%", &output) == 0);
+    REQUIRE(output);
+    CHECK(one_record_per_host(output, 0));
+    CHECK(count_occurrences(output, "\"changed\":1,") == AGENT_COUNT);
+    CHECK(strstr(output, "{\"event\":\"stage\",\"stage\":1,\"hosts\":1,\"ok\":1,") != NULL);
+    CHECK(strstr(output, "{\"event\":\"stage\",\"stage\":2,\"hosts\":19,\"ok\":19,") != NULL);
+    CHECK(strstr(output, "{\"event\":\"stage\",\"stage\":3,\"hosts\":180,\"ok\":180,") != NULL);
+    free(output);
+}
+
+static void test_unreachable_host(void) {
+    // The fleet plus the next port, where nothing listens
+    char hosts_path[MAX_PATH];
+    sprintf_s(hosts_path, sizeof(hosts_path), "%s/hosts-down.txt", g_directory);
+    FILE* hosts = NULL;
+    REQUIRE(fopen_s(&hosts, hosts_path, "w") == 0 && hosts);
+    for (int i = 0; i <= g_pool.count; i++) fprintf(hosts, "127.0.0.1:%u\n", (unsigned)(g_pool.first_port + i));
+    fclose(hosts);
+
+    char* output = NULL;
+    CHECK(run_rollout(hosts_path, "portrait --only M2", NULL, &output) == 6);
+    REQUIRE(output);
+    CHECK(one_record_per_host(output, 1));
+    CHECK(count_occurrences(output, "\"changed\":1,") == AGENT_COUNT);
+    CHECK(count_occurrences(output, "\"result\":\"unreachable\"") == 1);
+    CHECK(strstr(output, "\"event\":\"summary\",\"hosts\":201,\"ok\":200,\"failed\":1,") != NULL);
+    free(output);
+}
+
+int main(void) {
+    test_isolate_data();
+    LogSink quiet = { quiet_log, NULL, false };
+    log_set_thread_sink(&quiet);
+    strcpy_s(g_directory, sizeof(g_directory), getenv("LOCALAPPDATA"));
+
+    if (!agent_pool_start(&g_pool, g_directory, AGENT_COUNT)) {
+        fprintf(stderr, "Failed to start %d agents\n", AGENT_COUNT);
+        return EXIT_FAILURE;
+    }
+    RUN_TEST(test_rollout);
+    RUN_TEST(test_stages);
+    RUN_TEST(test_unreachable_host);
+    CHECK(agent_pool_stop(&g_pool));
+    return TEST_EXIT_CODE();
+}
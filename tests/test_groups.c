@@ -0,0 +1,116 @@
+#include "test.h"
+#include "groups.h"
+#include "config.h"
+
+// Monitor groups: cached memberships follow redefinitions of the groups they
+// nest, and loading a config leaves the process-wide definitions alone until
+// a command registers them.
+
+static void quiet_log(LogLevel level, const char* message, void* user_data) {
+    (void)level;
+    (void)message;
+    (void)user_data;
+}
+
+static MonitorList* make_monitors(int count) {
+    static char* ids[] = { "M1", "M2", "M3" };
+    MonitorList* list = (MonitorList*)calloc(1, sizeof(MonitorList));
+    if (!list) return NULL;
+    list->monitors = (MonitorInfo*)calloc((size_t)count, sizeof(MonitorInfo));
+    list->count = count;
+    for (int i = 0; list->monitors && i < count; i++) {
+        MonitorInfo* monitor = &list->monitors[i];
+        monitor->id = ids[i];
+        monitor->device_name = monitor->device_path = monitor->device_id = "";
+        monitor->stable_id = monitor->monitor_interface = monitor->model_name = "";
+        monitor->width = 1920;
+        monitor->height = 1080;
+        monitor->position_x = 1920 * i;
+    }
+    return list;
+}
+
+static void free_monitors(MonitorList* list) {
+    free(list->monitors);
+    free(list);
+}
+
+static bool define(const char* a, const char* b) {
+    ConfigMap map = { NULL, 0 };
+    bool ok = config_map_set(&map, "A", a) && (!b || config_map_set(&map, "B", b)) &&
+              monitor_groups_define(&map);
+    config_map_clear(&map);
+    return ok;
+}
+
+// Bitset of the group's members, or ~0 if it fails to resolve
+static ULONG64 members_of(const char* name, const MonitorList* monitors) {
+    ULONG64 bits = 0;
+    return monitor_group_select(name, monitors, &bits) ? bits : ~0ULL;
+}
+
+static void test_nested_redefinition(void) {
+    MonitorList* monitors = make_monitors(3);
+    REQUIRE(monitors && monitors->monitors);
+
+    REQUIRE(define("group:B", "M1"));
+    CHECK(members_of("A", monitors) == 0x1);
+
+    // A's own definition is unchanged, but the group it nests moved
+    REQUIRE(define("group:B", "M2"));
+    CHECK(members_of("A", monitors) == 0x2);
+    CHECK(members_of("B", monitors) == 0x2);
+
+    REQUIRE(define("group:B", "M2,M3"));
+    CHECK(members_of("A", monitors) == 0x6);
+
+    // Dropping B leaves A unresolvable rather than stale
+    REQUIRE(define("group:B", NULL));
+    CHECK(members_of("A", monitors) == ~0ULL);
+
+    // An unchanged set of definitions still resolves correctly
+    REQUIRE(define("M3", "M1"));
+    CHECK(members_of("A", monitors) == 0x4);
+    REQUIRE(define("M3", "M1"));
+    CHECK(members_of("A", monitors) == 0x4);
+    free_monitors(monitors);
+}
+
+static void test_load_config_is_side_effect_free(void) {
+    MonitorList* monitors = make_monitors(3);
+    REQUIRE(monitors && monitors->monitors);
+    REQUIRE(define("M1", NULL));
+
+    char* path = get_config_file_path();
+    REQUIRE(path);
+    FILE* file = NULL;
+    REQUIRE(fopen_s(&file, path, "w") == 0 && file);
+    fputs("{\"groups\":{\"wall\":\"M2,M3\"}}", file);
+    fclose(file);
+    free(path);
+
+    MosDefConfig* config = load_config();
+    REQUIRE(config);
+    CHECK(config_map_get(&config->groups, "wall") != NULL);
+    CHECK(members_of("wall", monitors) == ~0ULL);
+    CHECK(members_of("A", monitors) == 0x1);
+
+    CHECK(register_config_definitions(config));
+    CHECK(members_of("wall", monitors) == 0x6);
+    CHECK(members_of("A", monitors) == ~0ULL);
+
+    CHECK(register_config_definitions(NULL));
+    CHECK(members_of("wall", monitors) == ~0ULL);
+
+    free_config(config);
+    free_monitors(monitors);
+}
+
+int main(void) {
+    test_isolate_data();
+    LogSink quiet = { quiet_log, NULL, false };
+    log_set_thread_sink(&quiet);
+    RUN_TEST(test_nested_redefinition);
+    RUN_TEST(test_load_config_is_side_effect_free);
+    return TEST_EXIT_CODE();
+}
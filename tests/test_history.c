@@ -0,0 +1,133 @@
+#include "test.h"
+#include "mosdef.h"
+#include "history.h"
+#include <sim.h>
+
+// Change history from the live paths: plan apply, rollback and layout
+// restore each record one entry per monitor changed, with the before and
+// after state and the driver's result. Dry runs record nothing.
+
+#define MAX_ENTRIES 32
+
+typedef struct {
+    HistoryEntry entries[MAX_ENTRIES];
+    char devices[MAX_ENTRIES][64];
+    int count;
+} Recorded;
+
+static bool collect(const HistoryEntry* entry, void* user_data) {
+    Recorded* recorded = (Recorded*)user_data;
+    if (recorded->count >= MAX_ENTRIES) return false;
+
+    recorded->entries[recorded->count] = *entry;
+    strcpy_s(recorded->devices[recorded->count], sizeof(recorded->devices[0]), entry->device_path);
+    recorded->entries[recorded->count].device_path = recorded->devices[recorded->count];
+    recorded->entries[recorded->count].stable_id = NULL;
+    recorded->count++;
+    return true;
+}
+
+static int read_history(Recorded* recorded, const char* device) {
+    memset(recorded, 0, sizeof(*recorded));
+    HistoryQuery query;
+    memset(&query, 0, sizeof(query));
+    query.device = device;
+    return history_query(&query, collect, recorded);
+}
+
+static void quiet_log(LogLevel level, const char* message, void* user_data) {
+    (void)level;
+    (void)message;
+    (void)user_data;
+}
+
+static RotationPlan* plan_for(MosDefContext* ctx, RotationCommand command, const char* only) {
+    SelectorList* selectors = mosdef_parse_selectors(ctx, only);
+    RotationPlan* plan = NULL;
+    mosdef_plan(ctx, command, selectors, NULL, &plan);
+    mosdef_free_selectors(ctx, selectors);
+    return plan;
+}
+
+static void test_live_paths(void) {
+    sim_reset();
+    LogSink quiet = { quiet_log, NULL, false };
+    MosDefContext* ctx = mosdef_create(NULL, NULL, &quiet);
+    REQUIRE(ctx);
+    MonitorList* layout = NULL;
+    REQUIRE(mosdef_enumerate(ctx, &layout) == MOSDEF_OK);
+
+    // Apply
+    RotationPlan* plan = plan_for(ctx, ROTATION_PORTRAIT, "M2");
+    REQUIRE(plan && plan->count == 1);
+    CHECK(mosdef_apply(ctx, plan, NULL) == MOSDEF_OK);
+
+    Recorded recorded;
+    CHECK(read_history(&recorded, NULL) == 1);
+    const HistoryEntry* entry = &recorded.entries[0];
+    CHECK(entry->action == HISTORY_ROTATE && strcmp(entry->device_path, plan->entries[0].device_path) == 0);
+    CHECK(entry->old_orientation == DMDO_DEFAULT && entry->old_width == 1920 && entry->old_height == 1080);
+    CHECK(entry->new_orientation == DMDO_90 && entry->new_width == 1080 && entry->new_height == 1920);
+    CHECK(entry->error_code == DISP_CHANGE_SUCCESSFUL);
+
+    // Rollback
+    CHECK(mosdef_rollback(ctx, plan) == MOSDEF_OK);
+    CHECK(read_history(&recorded, NULL) == 2);
+    entry = &recorded.entries[1];
+    CHECK(entry->action == HISTORY_ROLLBACK && entry->old_orientation == DMDO_90 &&
+          entry->new_orientation == DMDO_DEFAULT && entry->new_width == 1920);
+
+    // A failed change is recorded with the driver's error
+    sim_fail_changes(1, DISP_CHANGE_BADMODE);
+    CHECK(mosdef_apply(ctx, plan, NULL) == MOSDEF_ERR_API_FAILURE);
+    CHECK(read_history(&recorded, NULL) == 3);
+    CHECK(recorded.entries[2].action == HISTORY_ROTATE && recorded.entries[2].error_code == DISP_CHANGE_BADMODE);
+
+    // Restore records each staged monitor, not the untouched one
+    CHECK(mosdef_apply(ctx, plan, NULL) == MOSDEF_OK);
+    int changed = 0;
+    CHECK(mosdef_restore_layout(ctx, layout, &changed) == MOSDEF_OK && changed == 1);
+    CHECK(read_history(&recorded, NULL) == 5);
+    entry = &recorded.entries[4];
+    CHECK(entry->action == HISTORY_RESTORE && strcmp(entry->device_path, plan->entries[0].device_path) == 0 &&
+          entry->old_orientation == DMDO_90 && entry->new_orientation == DMDO_DEFAULT &&
+          entry->error_code == DISP_CHANGE_SUCCESSFUL);
+
+    // Entries are found by device
+    CHECK(read_history(&recorded, layout->monitors[0].device_path) == 0);
+    CHECK(read_history(&recorded, plan->entries[0].device_path) == 5);
+
+    mosdef_free_plan(ctx, plan);
+    mosdef_free_monitor_list(ctx, layout);
+    mosdef_destroy(ctx);
+}
+
+static void test_dry_run_records_nothing(void) {
+    sim_reset();
+    Recorded recorded;
+    int before = read_history(&recorded, NULL);
+
+    MosDefOptions options;
+    memset(&options, 0, sizeof(options));
+    options.dry_run = true;
+    LogSink quiet = { quiet_log, NULL, false };
+    MosDefContext* ctx = mosdef_create(&options, NULL, &quiet);
+    REQUIRE(ctx);
+
+    RotationPlan* plan = plan_for(ctx, ROTATION_PORTRAIT, "M1,M2");
+    REQUIRE(plan && plan->count == 2);
+    CHECK(mosdef_apply(ctx, plan, NULL) == MOSDEF_OK);
+    CHECK(mosdef_rollback(ctx, plan) == MOSDEF_OK);
+    CHECK(sim_change_count() == 0);
+    CHECK(read_history(&recorded, NULL) == before);
+
+    mosdef_free_plan(ctx, plan);
+    mosdef_destroy(ctx);
+}
+
+int main(void) {
+    test_isolate_data();
+    RUN_TEST(test_live_paths);
+    RUN_TEST(test_dry_run_records_nothing);
+    return TEST_EXIT_CODE();
+}
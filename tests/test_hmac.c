@@ -0,0 +1,147 @@
+#include "test.h"
+#include "hmac.h"
+
+// Known-answer tests for the SHA-256 and HMAC-SHA256 behind fleet frame
+// signing: the FIPS 180-4 example messages, and every test case of RFC 4231
+// (case 5 compares the first 128 bits, as the RFC does). Each input is also
+// fed one byte at a time, since frames are hashed in parts.
+
+typedef struct {
+    const char* key;            // Hex
+    const char* data;           // Hex
+    const char* mac;            // Hex; may be a truncation
+} HmacVector;
+
+static const HmacVector k_rfc4231[] = {
+    // 1
+    { "0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b",
+      "4869205468657265",
+      "b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7" },
+    // 2: a key shorter than the output
+    { "4a656665",
+      "7768617420646f2079612077616e7420666f72206e6f7468696e673f",
+      "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843" },
+    // 3
+    { "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa",
+      "dddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddddd",
+      "773ea91e36800e46854db8ebd09181a72959098b3ef8c122d9635514ced565fe" },
+    // 4
+    { "0102030405060708090a0b0c0d0e0f10111213141516171819",
+      "cdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcdcd",
+      "82558a389a443c0ea4cc819899f2083a85f0faa3e578f8077a2e3ff46729665b" },
+    // 5: truncated to 128 bits
+    { "0c0c0c0c0c0c0c0c0c0c0c0c0c0c0c0c0c0c0c0c",
+      "546573742057697468205472756e636174696f6e",
+      "a3b6167473100ee06e0c796c2955552b" },
+    // 6: a key longer than the block, hashed first
+    { "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+      "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+      "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa",
+      "54657374205573696e67204c6172676572205468616e20426c6f636b2d53697a65204b6579202d2048617368204b6579"
+      "204669727374",
+      "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54" },
+    // 7: key and data both longer than the block
+    { "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+      "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa"
+      "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa",
+      "5468697320697320612074657374207573696e672061206c6172676572207468616e20626c6f636b2d73697a65206b65"
+      "7920616e642061206c6172676572207468616e20626c6f636b2d73697a6520646174612e20546865206b6579206e6565"
+      "647320746f20626520686173686564206265666f7265206265696e6720757365642062792074686520484d414320616c"
+      "676f726974686d2e",
+      "9b09ffa71b942fcb27635fbcd5b0e944bfdc63644f0713938a7f51535c3a35e2" },
+};
+
+static BYTE hex_digit(char c) {
+    return (BYTE)(c <= '9' ? c - '0' : c - 'a' + 10);
+}
+
+// Decodes lowercase hex into buffer; returns the byte count
+static size_t from_hex(const char* hex, BYTE* buffer, size_t buffer_size) {
+    size_t size = strlen(hex) / 2;
+    if (size > buffer_size) size = buffer_size;
+    for (size_t i = 0; i < size; i++) {
+        buffer[i] = (BYTE)(hex_digit(hex[2 * i]) << 4 | hex_digit(hex[2 * i + 1]));
+    }
+    return size;
+}
+
+static bool matches(const BYTE* digest, const char* expected_hex) {
+    BYTE expected[SHA256_SIZE];
+    size_t size = from_hex(expected_hex, expected, sizeof(expected));
+    return memcmp(digest, expected, size) == 0;
+}
+
+static bool sha256_matches(const void* data, size_t size, const char* expected_hex) {
+    BYTE whole[SHA256_SIZE];
+    Sha256 sha;
+    sha256_init(&sha);
+    sha256_update(&sha, data, size);
+    sha256_final(&sha, whole);
+
+    BYTE parts[SHA256_SIZE];
+    sha256_init(&sha);
+    for (size_t i = 0; i < size; i++) sha256_update(&sha, (const BYTE*)data + i, 1);
+    sha256_final(&sha, parts);
+    return matches(whole, expected_hex) && matches(parts, expected_hex);
+}
+
+static void test_sha256(void) {
+    CHECK(sha256_matches("", 0, "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"));
+    CHECK(sha256_matches("abc", 3, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"));
+
+    // 56 bytes: the length no longer fits the first block
+    const char* two_blocks = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    CHECK(sha256_matches(two_blocks, strlen(two_blocks),
+                         "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"));
+
+    BYTE* million = (BYTE*)malloc(1000000);
+    REQUIRE(million);
+    memset(million, 'a', 1000000);
+    CHECK(sha256_matches(million, 1000000, "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0"));
+    free(million);
+}
+
+static void test_rfc4231(void) {
+    for (size_t v = 0; v < sizeof(k_rfc4231) / sizeof(k_rfc4231[0]); v++) {
+        BYTE key[256];
+        BYTE data[256];
+        size_t key_size = from_hex(k_rfc4231[v].key, key, sizeof(key));
+        size_t data_size = from_hex(k_rfc4231[v].data, data, sizeof(data));
+
+        BYTE whole[SHA256_SIZE];
+        HmacSha256 hmac;
+        hmac_sha256_init(&hmac, key, key_size);
+        hmac_sha256_update(&hmac, data, data_size);
+        hmac_sha256_final(&hmac, whole);
+
+        BYTE parts[SHA256_SIZE];
+        hmac_sha256_init(&hmac, key, key_size);
+        for (size_t i = 0; i < data_size; i++) hmac_sha256_update(&hmac, data + i, 1);
+        hmac_sha256_final(&hmac, parts);
+
+        if (!matches(whole, k_rfc4231[v].mac) || !matches(parts, k_rfc4231[v].mac)) {
+            fprintf(stderr, "RFC 4231 test case %zu failed\n", v + 1);
+            CHECK(false);
+        }
+    }
+}
+
+static void test_equal(void) {
+    BYTE a[SHA256_SIZE];
+    BYTE b[SHA256_SIZE];
+    memset(a, 0x5A, sizeof(a));
+    memcpy(b, a, sizeof(b));
+    CHECK(hmac_equal(a, b, sizeof(a)));
+    for (size_t i = 0; i < sizeof(b); i++) {
+        b[i] ^= 0x01;
+        CHECK(!hmac_equal(a, b, sizeof(a)));
+        b[i] ^= 0x01;
+    }
+}
+
+int main(void) {
+    RUN_TEST(test_sha256);
+    RUN_TEST(test_rfc4231);
+    RUN_TEST(test_equal);
+    return TEST_EXIT_CODE();
+}
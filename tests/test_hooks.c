@@ -0,0 +1,185 @@
+#include "test.h"
+#include "mosdef.h"
+#include "hooks.h"
+#include <sim.h>
+#include <unistd.h>
+
+// Config-declared hooks: no hook delays the modeset, pre-apply ones
+// included, timeouts and a full queue are logged, and destroying a context
+// waits only for the hooks it fired, whose results reach its own sink.
+
+typedef struct {
+    CRITICAL_SECTION lock;
+    char text[16384];
+} Captured;
+
+static void capture_log(LogLevel level, const char* message, void* user_data) {
+    (void)level;
+    Captured* captured = (Captured*)user_data;
+    EnterCriticalSection(&captured->lock);
+    size_t length = strlen(captured->text);
+    if (length + strlen(message) + 2 < sizeof(captured->text)) {
+        sprintf_s(captured->text + length, sizeof(captured->text) - length, "%s\n", message);
+    }
+    LeaveCriticalSection(&captured->lock);
+}
+
+static int count_lines(Captured* captured, const char* fragment) {
+    int count = 0;
+    EnterCriticalSection(&captured->lock);
+    for (const char* p = captured->text; (p = strstr(p, fragment)) != NULL; p++) {
+        count++;
+    }
+    LeaveCriticalSection(&captured->lock);
+    return count;
+}
+
+static MosDefContext* create_context(Captured* captured) {
+    InitializeCriticalSection(&captured->lock);
+    captured->text[0] = '\0';
+    MosDefOptions options = { 0 };
+    options.verbose = true;
+    LogSink sink = { capture_log, captured, true };
+    return mosdef_create(&options, NULL, &sink);
+}
+
+// Captures are read after mosdef_destroy, once no hook can still log, and
+// released last
+static void release_capture(Captured* captured) {
+    DeleteCriticalSection(&captured->lock);
+}
+
+// Defines the hooks from alternating key/value strings
+static void define_hooks(const char* const* pairs, int count) {
+    ConfigMap map = { NULL, 0 };
+    for (int i = 0; i < count; i++) {
+        config_map_set(&map, pairs[2 * i], pairs[2 * i + 1]);
+    }
+    CHECK(hooks_define(&map));
+    config_map_clear(&map);
+}
+
+static void define_numbered_hooks(const char* event, const char* command, int count) {
+    ConfigMap map = { NULL, 0 };
+    for (int i = 0; i < count; i++) {
+        char key[64];
+        sprintf_s(key, sizeof(key), "%s:%d", event, i);
+        config_map_set(&map, key, command);
+    }
+    CHECK(hooks_define(&map));
+    config_map_clear(&map);
+}
+
+// Rotates the selected monitors to portrait; returns the apply's wall time in ms
+static double apply_portrait(MosDefContext* ctx, const char* selector) {
+    SelectorList* only = mosdef_parse_selectors(ctx, selector);
+    RotationPlan* plan = NULL;
+    CHECK(only && mosdef_plan(ctx, ROTATION_PORTRAIT, only, NULL, &plan) == MOSDEF_OK);
+    mosdef_free_selectors(ctx, only);
+    if (!plan) return -1.0;
+
+    ULONGLONG started = GetTickCount64();
+    CHECK(mosdef_apply(ctx, plan, NULL) == MOSDEF_OK);
+    double elapsed = (double)(GetTickCount64() - started);
+    mosdef_free_plan(ctx, plan);
+    return elapsed;
+}
+
+static bool file_exists(const char* name) {
+    char path[MAX_PATH];
+    sprintf_s(path, sizeof(path), "%s/%s", getenv("LOCALAPPDATA"), name);
+    return access(path, F_OK) == 0;
+}
+
+static void test_pre_apply_does_not_delay(void) {
+    const char* hooks[] = {
+        "pre-apply", "sleep 0.5; [ \"$MOSDEF_MONITORS\" = M1 ] && touch \"$LOCALAPPDATA/pre\"",
+        "post-apply", "sleep 0.5; touch \"$LOCALAPPDATA/post\"",
+    };
+    define_hooks(hooks, 2);
+    sim_reset();
+    Captured captured;
+    MosDefContext* ctx = create_context(&captured);
+    REQUIRE(ctx);
+
+    int changes = sim_change_count();
+    CHECK(apply_portrait(ctx, "M1") < 250.0);
+    CHECK(sim_change_count() > changes);
+
+    // Both hooks are still running; destroy waits for them
+    CHECK(!file_exists("pre") && !file_exists("post"));
+    mosdef_destroy(ctx);
+    CHECK(file_exists("pre") && file_exists("post"));
+    CHECK(count_lines(&captured, "Hook pre-apply finished") == 1);
+    release_capture(&captured);
+}
+
+static void test_timeout(void) {
+    const char* hooks[] = { "post-apply", "timeout=300 sleep 5; touch \"$LOCALAPPDATA/survived\"" };
+    define_hooks(hooks, 1);
+    sim_reset();
+    Captured captured;
+    MosDefContext* ctx = create_context(&captured);
+    REQUIRE(ctx);
+
+    CHECK(apply_portrait(ctx, "M1") < 250.0);
+    ULONGLONG started = GetTickCount64();
+    mosdef_destroy(ctx);
+    CHECK(GetTickCount64() - started < 2000);
+    CHECK(count_lines(&captured, "timed out after 300 ms and was terminated") == 1);
+    Sleep(200);
+    CHECK(!file_exists("survived"));
+    release_capture(&captured);
+}
+
+static void test_overload(void) {
+    define_numbered_hooks("post-apply", "exit 0", HOOK_QUEUE_CAPACITY + 8);
+    sim_reset();
+    Captured captured;
+    MosDefContext* ctx = create_context(&captured);
+    REQUIRE(ctx);
+
+    // The whole fire happens under the pool lock, so exactly the overflow drops
+    apply_portrait(ctx, "M1");
+    mosdef_destroy(ctx);
+    CHECK(count_lines(&captured, "Hook queue full (32 pending); dropped 8 post-apply hook(s)") == 1);
+    CHECK(count_lines(&captured, " finished in ") == HOOK_QUEUE_CAPACITY);
+    release_capture(&captured);
+}
+
+// A's slow hook does not hold up destroying B, and each context's sink sees
+// only its own hooks
+static void test_scoped_drain(void) {
+    const char* hooks[] = {
+        "post-apply", "case \"$MOSDEF_MONITORS\" in M1) sleep 1.5;; esac",
+    };
+    define_hooks(hooks, 1);
+    sim_reset();
+    Captured captured_a, captured_b;
+    MosDefContext* a = create_context(&captured_a);
+    MosDefContext* b = create_context(&captured_b);
+    REQUIRE(a && b);
+
+    ULONGLONG started = GetTickCount64();
+    apply_portrait(a, "M1");
+    apply_portrait(b, "M2");
+    mosdef_destroy(b);
+    CHECK(GetTickCount64() - started < 1000);
+    CHECK(count_lines(&captured_b, "Hook post-apply finished") == 1);
+    CHECK(count_lines(&captured_a, "Hook post-apply finished") == 0);
+
+    mosdef_destroy(a);
+    CHECK(GetTickCount64() - started >= 1500);
+    CHECK(count_lines(&captured_a, "Hook post-apply finished") == 1);
+    release_capture(&captured_a);
+    release_capture(&captured_b);
+}
+
+int main(void) {
+    test_isolate_data();
+    RUN_TEST(test_pre_apply_does_not_delay);
+    RUN_TEST(test_timeout);
+    RUN_TEST(test_overload);
+    RUN_TEST(test_scoped_drain);
+    return TEST_EXIT_CODE();
+}
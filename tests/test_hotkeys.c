@@ -0,0 +1,160 @@
+#include "test.h"
+#include "hotkeys.h"
+#include <sim.h>
+
+// Hotkey chord parsing and the resident hotkey mode: bindings registered
+// from the config, presses delivered through the simulated backend turning
+// into modesets, and Ctrl+C unregistering everything.
+
+static void check_chord(const char* chord, UINT expected_modifiers, UINT expected_key) {
+    UINT modifiers = 0;
+    UINT key = 0;
+    bool parsed = parse_hotkey_chord(chord, &modifiers, &key);
+    if (!parsed || modifiers != expected_modifiers || key != expected_key) {
+        fprintf(stderr, "'%s': parsed %d, modifiers %x, key %x\n", chord, parsed, modifiers, key);
+    }
+    CHECK(parsed && modifiers == expected_modifiers && key == expected_key);
+}
+
+static void test_parse_chords(void) {
+    check_chord("Ctrl+Alt+P", MOD_CONTROL | MOD_ALT, 'P');
+    check_chord("win + shift + f9", MOD_WIN | MOD_SHIFT, VK_F1 + 8);
+    check_chord("Control+PageUp", MOD_CONTROL, VK_PRIOR);
+    check_chord("Alt+7", MOD_ALT, '7');
+    check_chord("F24", 0, VK_F24);
+
+    const char* invalid[] = { "", "Ctrl+Alt", "P+Ctrl", "Ctrl+F25", "Ctrl+F0", "Hyper+P", "Ctrl+P+Q", "Ctrl+Nope" };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        UINT modifiers = 0;
+        UINT key = 0;
+        if (parse_hotkey_chord(invalid[i], &modifiers, &key)) {
+            fprintf(stderr, "'%s' should not parse\n", invalid[i]);
+            CHECK(false);
+        }
+    }
+}
+
+typedef struct {
+    MosDefConfig* config;
+    char log[8192];
+    size_t log_length;
+    int exit_code;
+} HotkeyRun;
+
+static void capture_log(LogLevel level, const char* message, void* user_data) {
+    (void)level;
+    HotkeyRun* run = (HotkeyRun*)user_data;
+    int written = snprintf(run->log + run->log_length, sizeof(run->log) - run->log_length, "%s\n", message);
+    if (written > 0 && run->log_length + (size_t)written < sizeof(run->log)) {
+        run->log_length += (size_t)written;
+    }
+}
+
+static void quiet_log(LogLevel level, const char* message, void* user_data) {
+    (void)level;
+    (void)message;
+    (void)user_data;
+}
+
+static DWORD WINAPI hotkeys_thread(LPVOID parameter) {
+    HotkeyRun* run = (HotkeyRun*)parameter;
+    LogSink sink = { capture_log, run, false };
+    log_set_thread_sink(&sink);
+
+    MosDefContext* ctx = mosdef_create(NULL, NULL, &sink);
+    run->exit_code = ctx ? run_hotkeys(ctx, run->config) : -1;
+    mosdef_destroy(ctx);
+    log_set_thread_sink(NULL);
+    return 0;
+}
+
+// Presses until the chord is registered; false on timeout
+static bool press_when_registered(UINT modifiers, UINT key) {
+    for (int i = 0; i < 500; i++) {
+        if (sim_press_hotkey(modifiers, key)) return true;
+        Sleep(10);
+    }
+    return false;
+}
+
+static bool wait_for_orientation(int index, DWORD orientation) {
+    for (int i = 0; i < 500; i++) {
+        SimMonitor monitor;
+        if (sim_get_monitor(index, &monitor) && monitor.orientation == orientation) return true;
+        Sleep(10);
+    }
+    return false;
+}
+
+static void test_presses_apply_bindings(void) {
+    sim_reset();
+    HotkeyRun run;
+    memset(&run, 0, sizeof(run));
+    run.config = create_config();
+    REQUIRE(run.config);
+    config_map_set(&run.config->hotkeys, "Ctrl+Alt+P", "portrait --only M1");
+    config_map_set(&run.config->hotkeys, "Ctrl+Alt+T", "toggle --only M2");
+    config_map_set(&run.config->hotkeys, "Ctrl+Nope", "portrait");
+    config_map_set(&run.config->hotkeys, "Ctrl+Alt+R", "sideways");
+
+    HANDLE thread = CreateThread(NULL, 0, hotkeys_thread, &run, 0, NULL);
+    REQUIRE(thread);
+
+    CHECK(press_when_registered(MOD_CONTROL | MOD_ALT, 'P'));
+    CHECK(wait_for_orientation(0, DMDO_90));
+    CHECK(wait_for_orientation(1, DMDO_DEFAULT));
+
+    // Toggle plans are re-resolved after each press
+    CHECK(sim_press_hotkey(MOD_CONTROL | MOD_ALT, 'T'));
+    CHECK(wait_for_orientation(1, DMDO_90));
+    CHECK(sim_press_hotkey(MOD_CONTROL | MOD_ALT, 'T'));
+    CHECK(wait_for_orientation(1, DMDO_DEFAULT));
+    CHECK(wait_for_orientation(0, DMDO_90));
+
+    // Invalid bindings are reported and skipped
+    CHECK(!sim_press_hotkey(MOD_CONTROL | MOD_ALT, 'R'));
+    CHECK(!sim_press_hotkey(MOD_CONTROL, 'Q'));
+
+    sim_send_ctrl_c();
+    CHECK(WaitForSingleObject(thread, 10000) == WAIT_OBJECT_0);
+    CloseHandle(thread);
+
+    CHECK(run.exit_code == 0);
+    CHECK(strstr(run.log, "Invalid hotkey 'Ctrl+Nope'") != NULL);
+    CHECK(strstr(run.log, "Hotkey 'Ctrl+Alt+R': action must be") != NULL);
+    CHECK(strstr(run.log, "Registered Ctrl+Alt+P -> portrait --only M1") != NULL);
+    CHECK(strstr(run.log, "Ctrl+Alt+T: 2 press(es)") != NULL);
+
+    // Everything is unregistered on exit
+    CHECK(!sim_press_hotkey(MOD_CONTROL | MOD_ALT, 'P'));
+    free_config(run.config);
+    sim_reset();
+}
+
+static void test_no_bindings(void) {
+    MosDefConfig* config = create_config();
+    REQUIRE(config);
+    LogSink quiet = { quiet_log, NULL, false };
+    const LogSink* previous = log_set_thread_sink(&quiet);
+    MosDefContext* ctx = mosdef_create(NULL, NULL, &quiet);
+    REQUIRE(ctx);
+    CHECK(run_hotkeys(ctx, config) == 2);
+
+    // Nothing that parses is nothing to listen for
+    config_map_set(&config->hotkeys, "Ctrl+Alt+Nope", "portrait");
+    CHECK(run_hotkeys(ctx, config) == 3);
+
+    mosdef_destroy(ctx);
+    log_set_thread_sink(previous);
+    free_config(config);
+}
+
+int main(void) {
+    test_isolate_data();
+    // Never grab the real keyboard of a desktop session running the tests
+    unsetenv("DISPLAY");
+    RUN_TEST(test_parse_chords);
+    RUN_TEST(test_presses_apply_bindings);
+    RUN_TEST(test_no_bindings);
+    return TEST_EXIT_CODE();
+}
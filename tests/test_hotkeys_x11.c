@@ -0,0 +1,91 @@
+#include <X11/Xlib.h>
+#include <X11/keysym.h>
+#include <X11/extensions/XTest.h>
+#include "test.h"
+
+// RegisterHotKey on a real X server (run under xvfb-run): XTest key events
+// must arrive as WM_HOTKEY, held keys must not repeat with MOD_NOREPEAT, and
+// a chord another client grabbed must fail to register.
+
+static LRESULT CALLBACK window_proc(HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam) {
+    return DefWindowProcA(hwnd, message, wparam, lparam);
+}
+
+static void fake_key(Display* display, KeySym keysym, bool press) {
+    XTestFakeKeyEvent(display, XKeysymToKeycode(display, keysym), press ? True : False, CurrentTime);
+    XFlush(display);
+}
+
+static void press_chord(Display* display, KeySym key, int repeats) {
+    fake_key(display, XK_Control_L, true);
+    fake_key(display, XK_Alt_L, true);
+    for (int i = 0; i < repeats; i++) fake_key(display, key, true);
+    fake_key(display, key, false);
+    fake_key(display, XK_Alt_L, false);
+    fake_key(display, XK_Control_L, false);
+}
+
+// Counts WM_HOTKEY messages with the given ID for milliseconds
+static int collect_hotkeys(WPARAM id, DWORD milliseconds) {
+    int count = 0;
+    ULONGLONG deadline = GetTickCount64() + milliseconds;
+    while (GetTickCount64() < deadline) {
+        MsgWaitForMultipleObjects(0, NULL, FALSE, 20, QS_ALLINPUT);
+        MSG message;
+        while (PeekMessageA(&message, NULL, 0, 0, PM_REMOVE)) {
+            if (message.message == WM_HOTKEY && message.wParam == id) count++;
+        }
+    }
+    return count;
+}
+
+static void test_grabbed_chords(void) {
+    Display* other = XOpenDisplay(NULL);
+    REQUIRE(other);
+    int event_base, error_base, major, minor;
+    REQUIRE(XTestQueryExtension(other, &event_base, &error_base, &major, &minor));
+
+    // Another client owns Ctrl+Alt+G
+    XGrabKey(other, XKeysymToKeycode(other, XK_g), ControlMask | Mod1Mask, DefaultRootWindow(other),
+             False, GrabModeAsync, GrabModeAsync);
+    XSync(other, False);
+
+    WNDCLASSA window_class;
+    memset(&window_class, 0, sizeof(window_class));
+    window_class.lpfnWndProc = window_proc;
+    window_class.lpszClassName = "MosDefX11Test";
+    RegisterClassA(&window_class);
+    HWND window = CreateWindowExA(0, "MosDefX11Test", "", 0, 0, 0, 0, 0, HWND_MESSAGE, NULL, NULL, NULL);
+    REQUIRE(window);
+
+    CHECK(RegisterHotKey(window, 1, MOD_CONTROL | MOD_ALT | MOD_NOREPEAT, 'P'));
+    CHECK(!RegisterHotKey(window, 2, MOD_CONTROL | MOD_ALT, 'G'));
+    CHECK(GetLastError() == ERROR_HOTKEY_ALREADY_REGISTERED);
+
+    press_chord(other, XK_p, 1);
+    CHECK(collect_hotkeys(1, 1000) == 1);
+
+    // A held key repeats as presses without releases; only the first counts
+    press_chord(other, XK_p, 5);
+    CHECK(collect_hotkeys(1, 1000) == 1);
+
+    // Caps Lock does not hide the chord
+    fake_key(other, XK_Caps_Lock, true);
+    fake_key(other, XK_Caps_Lock, false);
+    press_chord(other, XK_p, 1);
+    CHECK(collect_hotkeys(1, 1000) == 1);
+    fake_key(other, XK_Caps_Lock, true);
+    fake_key(other, XK_Caps_Lock, false);
+
+    CHECK(UnregisterHotKey(window, 1));
+    press_chord(other, XK_p, 1);
+    CHECK(collect_hotkeys(1, 500) == 0);
+
+    DestroyWindow(window);
+    XCloseDisplay(other);
+}
+
+int main(void) {
+    RUN_TEST(test_grabbed_chords);
+    return TEST_EXIT_CODE();
+}
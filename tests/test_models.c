@@ -0,0 +1,131 @@
+#include "test.h"
+#include "mosdef.h"
+#include "edid.h"
+#include "modeldb.h"
+#include <sim.h>
+
+// Model database hints in planning: a panel whose model is marked no-rotate
+// is left out of plans that would rotate it, and still returned to landscape.
+// The database is written before the first enumeration, which maps it for
+// the rest of the process.
+
+static void write_model_db(void) {
+    ModelRecord record = { model_db_key("DEL", 0x4085), MODEL_ORIENTATION_NONE, 0, MODEL_FLAG_NO_ROTATE };
+    BYTE* image = NULL;
+    size_t size = 0;
+    REQUIRE(model_db_build(&record, 1, &image, &size));
+
+    char path[MAX_PATH];
+    sprintf_s(path, sizeof(path), "%s/MOS-DEF", getenv("LOCALAPPDATA"));
+    CreateDirectoryA(path, NULL);
+    strcat_s(path, sizeof(path), "/" MODEL_DB_FILE);
+    FILE* file = NULL;
+    REQUIRE(fopen_s(&file, path, "wb") == 0 && file);
+    CHECK(fwrite(image, 1, size, file) == size);
+    fclose(file);
+    free(image);
+}
+
+// The DELL U2720Q fixture (DEL4085) on card0-DP-1
+static void write_sysfs_edid(void) {
+    BYTE edid[EDID_MAX_SIZE];
+    DWORD size = test_read_fixture("edid/dell_u2720q.bin", edid, sizeof(edid));
+    REQUIRE(size > 0);
+
+    char path[MAX_PATH];
+    sprintf_s(path, sizeof(path), "%s", getenv("MOSDEF_DRM_ROOT"));
+    CreateDirectoryA(path, NULL);
+    strcat_s(path, sizeof(path), "/card0-DP-1");
+    CreateDirectoryA(path, NULL);
+    strcat_s(path, sizeof(path), "/edid");
+    FILE* file = NULL;
+    REQUIRE(fopen_s(&file, path, "wb") == 0 && file);
+    CHECK(fwrite(edid, 1, size, file) == size);
+    fclose(file);
+}
+
+typedef struct {
+    int skipped;                // "Skipping ... no-rotate" messages
+} SkipLog;
+
+static void skip_log(LogLevel level, const char* message, void* user_data) {
+    (void)level;
+    SkipLog* log = (SkipLog*)user_data;
+    if (strncmp(message, "Skipping ", 9) == 0 && strstr(message, "no-rotate")) log->skipped++;
+}
+
+static void set_topology(DWORD dell_orientation) {
+    bool portrait = dell_orientation == DMDO_90;
+    SimMonitor topology[2] = {
+        { "DEL4085", "card0-DP-1", portrait ? 2160 : 3840, portrait ? 3840 : 2160, dell_orientation, 60, 0, 0 },
+        { "GSM5B7F", "card0-HDMI-A-1", 1920, 1080, DMDO_DEFAULT, 60, 3840, 0 }
+    };
+    REQUIRE(sim_set_monitors(topology, 2));
+}
+
+static RotationPlan* plan_all(MosDefContext* ctx, RotationCommand command) {
+    RotationPlan* plan = NULL;
+    CHECK(mosdef_plan(ctx, command, NULL, NULL, &plan) == MOSDEF_OK);
+    return plan;
+}
+
+static bool plan_has(const RotationPlan* plan, const char* stable_id_prefix) {
+    for (int i = 0; plan && i < plan->count; i++) {
+        if (strncmp(plan->entries[i].stable_id, stable_id_prefix, strlen(stable_id_prefix)) == 0) return true;
+    }
+    return false;
+}
+
+static void test_no_rotate_skipped(void) {
+    SkipLog log = { 0 };
+    LogSink sink = { skip_log, &log, false };
+    MosDefContext* ctx = mosdef_create(NULL, NULL, &sink);
+    REQUIRE(ctx);
+
+    // Flagged from the database
+    set_topology(DMDO_DEFAULT);
+    MonitorList* monitors = NULL;
+    REQUIRE(mosdef_enumerate(ctx, &monitors) == MOSDEF_OK);
+    REQUIRE(monitors->count == 2);
+    CHECK((monitors->monitors[0].model_flags & MODEL_FLAG_NO_ROTATE) != 0);
+    CHECK((monitors->monitors[1].model_flags & MODEL_FLAG_NO_ROTATE) == 0);
+    mosdef_free_monitor_list(ctx, monitors);
+
+    // Portrait and toggle leave the panel where it is
+    RotationPlan* plan = plan_all(ctx, ROTATION_PORTRAIT);
+    CHECK(plan && plan->count == 1 && !plan_has(plan, "DEL4085") && plan_has(plan, "GSM5B7F"));
+    mosdef_free_plan(ctx, plan);
+    plan = plan_all(ctx, ROTATION_TOGGLE);
+    CHECK(plan && plan->count == 1 && !plan_has(plan, "DEL4085"));
+    mosdef_free_plan(ctx, plan);
+    CHECK(log.skipped == 2);
+
+    // Landscape needs no rotated mode, so the panel stays in the plan
+    plan = plan_all(ctx, ROTATION_LANDSCAPE);
+    CHECK(plan && plan->count == 2 && plan_has(plan, "DEL4085"));
+    mosdef_free_plan(ctx, plan);
+
+    // ... and one left in portrait some other way can be brought back
+    set_topology(DMDO_90);
+    plan = plan_all(ctx, ROTATION_LANDSCAPE);
+    CHECK(plan && plan_has(plan, "DEL4085"));
+    mosdef_free_plan(ctx, plan);
+    plan = plan_all(ctx, ROTATION_TOGGLE);
+    CHECK(plan && plan_has(plan, "DEL4085"));
+    mosdef_free_plan(ctx, plan);
+    plan = plan_all(ctx, ROTATION_PORTRAIT);
+    CHECK(plan && plan_has(plan, "DEL4085"));
+    mosdef_free_plan(ctx, plan);
+    CHECK(log.skipped == 2);
+
+    mosdef_destroy(ctx);
+    sim_reset();
+}
+
+int main(void) {
+    test_isolate_data();
+    write_model_db();
+    write_sysfs_edid();
+    RUN_TEST(test_no_rotate_skipped);
+    return TEST_EXIT_CODE();
+}
@@ -0,0 +1,183 @@
+#include "test.h"
+#include "cli.h"
+#include "edid.h"
+#include <sim.h>
+
+// Offline planning: list --export saves the live topology, and --topology
+// selects and plans against the file with no display API calls, honouring
+// edits to it. A plan saved offline applies on the machine only while the
+// live topology still matches the export.
+
+static char g_directory[MAX_PATH];
+
+static void quiet_log(LogLevel level, const char* message, void* user_data) {
+    (void)level;
+    (void)message;
+    (void)user_data;
+}
+
+static void data_path(char* path, size_t size, const char* name) {
+    sprintf_s(path, size, "%s/%s", g_directory, name);
+}
+
+static CliArgs* parse_command_line(const char* text, char* buffer, size_t size) {
+    char* argv[16] = { "mos-def" };
+    int argc = 1;
+    strcpy_s(buffer, size, text);
+    char* context = NULL;
+    for (char* token = strtok_s(buffer, " ", &context); token && argc < 16; token = strtok_s(NULL, " ", &context)) {
+        argv[argc++] = token;
+    }
+    return parse_args(argc, argv);
+}
+
+// As main does it: --topology implies --dry-run and loads the file
+static int run_command(const char* text) {
+    char buffer[512];
+    CliArgs* args = parse_command_line(text, buffer, sizeof(buffer));
+    if (!args) return -1;
+
+    if (args->topology_path) args->dry_run = true;
+    MosDefOptions options;
+    memset(&options, 0, sizeof(options));
+    options.dry_run = args->dry_run;
+    LogSink quiet = { quiet_log, NULL, false };
+    MosDefContext* ctx = mosdef_create(&options, NULL, &quiet);
+    int result = -1;
+    if (ctx && (!args->topology_path || mosdef_load_topology(ctx, args->topology_path) == MOSDEF_OK)) {
+        if (strcmp(args->command, "list") == 0) {
+            result = handle_list_command(ctx, args);
+        } else if (strcmp(args->command, "plan") == 0) {
+            result = handle_plan_command(ctx, args, NULL);
+        } else if (strcmp(args->command, "portrait") == 0) {
+            result = handle_rotation_command(ctx, ROTATION_PORTRAIT, args, NULL);
+        }
+    }
+
+    mosdef_destroy(ctx);
+    free_cli_args(args);
+    return result;
+}
+
+static RotationPlan* load_plan(MosDefContext* ctx, const char* name) {
+    char path[MAX_PATH];
+    data_path(path, sizeof(path), name);
+    RotationPlan* plan = NULL;
+    return mosdef_load_plan(ctx, path, &plan) == MOSDEF_OK ? plan : NULL;
+}
+
+static void test_plans_against_export(void) {
+    sim_reset();
+    char topology[MAX_PATH];
+    char command[512];
+    data_path(topology, sizeof(topology), "kiosk.json");
+
+    sprintf_s(command, sizeof(command), "list --export %s", topology);
+    REQUIRE(run_command(command) == 0);
+
+    // The machine moves on: the LG is unplugged
+    SimMonitor dell;
+    REQUIRE(sim_get_monitor(0, &dell));
+    REQUIRE(sim_set_monitors(&dell, 1));
+    LONG changes = sim_change_count();
+    LONG64 edid_lookups = edid_cache_get_stats().lookups;
+
+    // The export still has the LG as M2, and planning never enumerates
+    sprintf_s(command, sizeof(command), "--topology %s/kiosk.json plan portrait --only M2 -o %s/kiosk.plan",
+              g_directory, g_directory);
+    CHECK(run_command(command) == 0);
+    sprintf_s(command, sizeof(command), "--topology %s portrait --only M2", topology);
+    CHECK(run_command(command) == 0);
+    CHECK(sim_change_count() == changes);
+    CHECK(edid_cache_get_stats().lookups == edid_lookups);
+
+    LogSink quiet = { quiet_log, NULL, false };
+    MosDefContext* ctx = mosdef_create(NULL, NULL, &quiet);
+    REQUIRE(ctx);
+    RotationPlan* plan = load_plan(ctx, "kiosk.plan");
+    REQUIRE(plan);
+    CHECK(plan->count == 1 && plan->command == ROTATION_PORTRAIT);
+    CHECK(plan->count == 1 && strcmp(plan->entries[0].id, "M2") == 0 &&
+          plan->entries[0].current_width == 1920 && plan->entries[0].target_width == 1080 &&
+          plan->entries[0].target_orientation == DMDO_90);
+
+    // Not on this topology...
+    CHECK(mosdef_verify_plan(ctx, plan) == MOSDEF_ERR_STALE_PLAN);
+
+    // ...but once the LG is back, the saved plan applies as recorded
+    sim_reset();
+    CHECK(mosdef_verify_plan(ctx, plan) == MOSDEF_OK);
+    BatchRotationResult result = { 0, 0, NULL, 0 };
+    CHECK(mosdef_apply(ctx, plan, &result) == MOSDEF_OK && result.success_count == 1);
+    mosdef_free_result(ctx, &result);
+    SimMonitor lg;
+    CHECK(sim_get_monitor(1, &lg) && lg.orientation == DMDO_90 && lg.width == 1080);
+
+    mosdef_free_plan(ctx, plan);
+    mosdef_destroy(ctx);
+    sim_reset();
+}
+
+static void test_edited_topology(void) {
+    sim_reset();
+    char topology[MAX_PATH];
+    data_path(topology, sizeof(topology), "edited.json");
+
+    // Hand-written: a third monitor, only the required fields, orientation
+    // in degrees and an unknown key
+    FILE* file = NULL;
+    REQUIRE(fopen_s(&file, topology, "wb") == 0 && file);
+    fputs("{ \"version\": 1, \"site\": \"lobby\", \"monitors\": [\n"
+          "  { \"id\": \"M1\", \"device_path\": \"\\\\\\\\.\\\\DISPLAY1\", \"width\": 1080, \"height\": 1920, \"orientation\": 90 },\n"
+          "  { \"id\": \"M2\", \"device_path\": \"\\\\\\\\.\\\\DISPLAY2\", \"width\": 1920, \"height\": 1080, \"orientation\": 0 },\n"
+          "  { \"id\": \"M3\", \"device_path\": \"\\\\\\\\.\\\\DISPLAY7\", \"width\": 3840, \"height\": 2160, \"orientation\": 0,\n"
+          "    \"stable_id\": \"SAM0F9E-00000042\" }\n"
+          "] }\n", file);
+    fclose(file);
+
+    char command[512];
+    sprintf_s(command, sizeof(command), "--topology %s plan landscape -o %s/edited.plan", topology, g_directory);
+    CHECK(run_command(command) == 0);
+    sprintf_s(command, sizeof(command), "--topology %s plan portrait --only edid:SAM0F9E-00000042 -o %s/m3.plan",
+              topology, g_directory);
+    CHECK(run_command(command) == 0);
+    sprintf_s(command, sizeof(command), "--topology %s plan portrait --only M4", topology);
+    CHECK(run_command(command) == 2);
+    CHECK(sim_change_count() == 0);
+
+    LogSink quiet = { quiet_log, NULL, false };
+    MosDefContext* ctx = mosdef_create(NULL, NULL, &quiet);
+    REQUIRE(ctx);
+
+    // Landscape covers every monitor in the file; only M1 changes
+    RotationPlan* plan = load_plan(ctx, "edited.plan");
+    REQUIRE(plan);
+    CHECK(plan->count == 3 && strcmp(plan->entries[0].device_path, "\\\\.\\DISPLAY1") == 0 &&
+          plan->entries[0].target_width == 1920 && plan->entries[0].target_orientation == DMDO_DEFAULT);
+    CHECK(plan->count == 3 && plan->entries[2].target_width == plan->entries[2].current_width &&
+          plan->entries[2].target_orientation == DMDO_DEFAULT);
+    mosdef_free_plan(ctx, plan);
+
+    plan = load_plan(ctx, "m3.plan");
+    REQUIRE(plan);
+    CHECK(plan->count == 1 && strcmp(plan->entries[0].device_path, "\\\\.\\DISPLAY7") == 0 &&
+          plan->entries[0].target_width == 2160 && plan->entries[0].target_height == 3840);
+    mosdef_free_plan(ctx, plan);
+
+    // A broken file is refused rather than planned against
+    file = NULL;
+    REQUIRE(fopen_s(&file, topology, "wb") == 0 && file);
+    fputs("{ \"version\": 1, \"monitors\": [ { \"id\": \"M1\" ", file);
+    fclose(file);
+    CHECK(mosdef_load_topology(ctx, topology) != MOSDEF_OK);
+
+    mosdef_destroy(ctx);
+}
+
+int main(void) {
+    test_isolate_data();
+    sprintf_s(g_directory, sizeof(g_directory), "%s", getenv("LOCALAPPDATA"));
+    RUN_TEST(test_plans_against_export);
+    RUN_TEST(test_edited_topology);
+    return TEST_EXIT_CODE();
+}
@@ -0,0 +1,192 @@
+#include "test.h"
+#include "cli.h"
+#include "edid.h"
+#include <sim.h>
+
+// Plan cache: hits return the stored plan without EDID or selector work,
+// any topology change misses, each topology keeps its own entry, the oldest
+// entries are evicted, and the CLI rotation path uses it end to end.
+
+static void quiet_log(LogLevel level, const char* message, void* user_data) {
+    (void)level;
+    (void)message;
+    (void)user_data;
+}
+
+// Gives the simulated DP-1 panel an EDID, so enumeration does EDID lookups
+static void install_edid(void) {
+    BYTE edid[EDID_MAX_SIZE];
+    DWORD size = test_read_fixture("edid/dell_u2720q.bin", edid, sizeof(edid));
+    REQUIRE(size > 0);
+
+    char path[MAX_PATH];
+    sprintf_s(path, sizeof(path), "%s", getenv("MOSDEF_DRM_ROOT"));
+    CreateDirectoryA(path, NULL);
+    sprintf_s(path, sizeof(path), "%s/card0-DP-1", getenv("MOSDEF_DRM_ROOT"));
+    CreateDirectoryA(path, NULL);
+    sprintf_s(path, sizeof(path), "%s/card0-DP-1/edid", getenv("MOSDEF_DRM_ROOT"));
+    FILE* file = NULL;
+    REQUIRE(fopen_s(&file, path, "wb") == 0 && file);
+    fwrite(edid, 1, size, file);
+    fclose(file);
+}
+
+static RotationPlan* plan_for(MosDefContext* ctx, RotationCommand command, const char* only) {
+    SelectorList* selectors = mosdef_parse_selectors(ctx, only);
+    RotationPlan* plan = NULL;
+    MosDefStatus status = mosdef_plan(ctx, command, selectors, NULL, &plan);
+    mosdef_free_selectors(ctx, selectors);
+    return status == MOSDEF_OK ? plan : NULL;
+}
+
+static bool same_plan(const RotationPlan* a, const RotationPlan* b) {
+    if (!a || !b || a->command != b->command || a->count != b->count) return false;
+    for (int i = 0; i < a->count; i++) {
+        if (strcmp(a->entries[i].device_path, b->entries[i].device_path) != 0 ||
+            a->entries[i].target_orientation != b->entries[i].target_orientation ||
+            a->entries[i].target_width != b->entries[i].target_width ||
+            a->entries[i].target_height != b->entries[i].target_height) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool cache_hit(MosDefContext* ctx, const char* key, RotationPlan** out_plan) {
+    *out_plan = NULL;
+    return mosdef_lookup_cached_plan(ctx, key, out_plan) == MOSDEF_OK;
+}
+
+static void test_hits_follow_topology(void) {
+    sim_reset();
+    install_edid();
+    LogSink quiet = { quiet_log, NULL, false };
+    MosDefContext* ctx = mosdef_create(NULL, NULL, &quiet);
+    REQUIRE(ctx);
+
+    RotationPlan* docked = plan_for(ctx, ROTATION_PORTRAIT, "edid:GSM5B7F");
+    REQUIRE(docked && docked->count == 1);
+    RotationPlan* cached = NULL;
+    CHECK(!cache_hit(ctx, "portrait only=edid:GSM5B7F", &cached));
+    CHECK(mosdef_store_cached_plan(ctx, "portrait only=edid:GSM5B7F", docked) == MOSDEF_OK);
+
+    // A hit reads neither EDID nor selectors
+    EdidCacheStats before = edid_cache_get_stats();
+    CHECK(cache_hit(ctx, "portrait only=edid:GSM5B7F", &cached));
+    CHECK(same_plan(docked, cached));
+    CHECK(edid_cache_get_stats().lookups == before.lookups);
+    mosdef_free_plan(ctx, cached);
+
+    // Another command line is another entry
+    CHECK(!cache_hit(ctx, "portrait only=edid:DEL4085", &cached));
+
+    // Undocked: the LG is the only monitor, at another resolution
+    SimMonitor laptop = { "GSM5B7F", "card0-HDMI-A-1", 1920, 1200, DMDO_DEFAULT, 60, 0, 0 };
+    REQUIRE(sim_set_monitors(&laptop, 1));
+    CHECK(!cache_hit(ctx, "portrait only=edid:GSM5B7F", &cached));
+    RotationPlan* undocked = plan_for(ctx, ROTATION_PORTRAIT, "edid:GSM5B7F");
+    REQUIRE(undocked);
+    CHECK(mosdef_store_cached_plan(ctx, "portrait only=edid:GSM5B7F", undocked) == MOSDEF_OK);
+    CHECK(cache_hit(ctx, "portrait only=edid:GSM5B7F", &cached) && same_plan(undocked, cached));
+    mosdef_free_plan(ctx, cached);
+
+    // Docking again finds the first plan; each topology keeps its own entry
+    sim_reset();
+    CHECK(cache_hit(ctx, "portrait only=edid:GSM5B7F", &cached) && same_plan(docked, cached));
+    mosdef_free_plan(ctx, cached);
+
+    // A rotation done elsewhere changes the fingerprint too
+    SimMonitor rotated[2];
+    REQUIRE(sim_get_monitor(0, &rotated[0]) && sim_get_monitor(1, &rotated[1]));
+    rotated[0].orientation = DMDO_90;
+    rotated[0].width = 1440;
+    rotated[0].height = 2560;
+    REQUIRE(sim_set_monitors(rotated, 2));
+    CHECK(!cache_hit(ctx, "portrait only=edid:GSM5B7F", &cached));
+    sim_reset();
+
+    // The most recent PLAN_CACHE_MAX_ENTRIES entries survive
+    for (int i = 0; i < 40; i++) {
+        char key[64];
+        sprintf_s(key, sizeof(key), "portrait script=%d", i);
+        CHECK(mosdef_store_cached_plan(ctx, key, docked) == MOSDEF_OK);
+    }
+    CHECK(!cache_hit(ctx, "portrait script=0", &cached));
+    CHECK(!cache_hit(ctx, "portrait script=7", &cached));
+    CHECK(cache_hit(ctx, "portrait script=8", &cached));
+    mosdef_free_plan(ctx, cached);
+    CHECK(cache_hit(ctx, "portrait script=39", &cached));
+    mosdef_free_plan(ctx, cached);
+
+    mosdef_free_plan(ctx, docked);
+    mosdef_free_plan(ctx, undocked);
+    mosdef_destroy(ctx);
+}
+
+typedef struct {
+    int hits;
+    int misses;
+} CacheLog;
+
+static void count_cache_log(LogLevel level, const char* message, void* user_data) {
+    (void)level;
+    CacheLog* log = (CacheLog*)user_data;
+    if (strstr(message, "Plan cache hit")) log->hits++;
+    if (strstr(message, "Plan cache miss")) log->misses++;
+}
+
+static int run_rotation(MosDefContext* ctx, RotationCommand command, const char* only, bool no_cache) {
+    // Global flags come before the command
+    char* argv[6] = { "mos-def", "--no-confirm" };
+    int argc = 2;
+    if (no_cache) argv[argc++] = "--no-plan-cache";
+    argv[argc++] = (char*)get_rotation_command_name(command);
+    argv[argc++] = "--only";
+    argv[argc++] = (char*)only;
+    CliArgs* args = parse_args(argc, argv);
+    if (!args) return -1;
+    int result = handle_rotation_command(ctx, command, args, NULL);
+    free_cli_args(args);
+    return result;
+}
+
+static void test_cli_rotations(void) {
+    sim_reset();
+    CacheLog log = { 0, 0 };
+    LogSink sink = { count_cache_log, &log, true };
+    const LogSink* previous = log_set_thread_sink(&sink);
+    MosDefOptions options;
+    memset(&options, 0, sizeof(options));
+    options.verbose = true;
+    MosDefContext* ctx = mosdef_create(&options, NULL, &sink);
+    REQUIRE(ctx);
+
+    SimMonitor monitor;
+    CHECK(run_rotation(ctx, ROTATION_PORTRAIT, "M2", false) == 0);
+    CHECK(sim_get_monitor(1, &monitor) && monitor.orientation == DMDO_90);
+    CHECK(run_rotation(ctx, ROTATION_LANDSCAPE, "M2", false) == 0);
+    CHECK(sim_get_monitor(1, &monitor) && monitor.orientation == DMDO_DEFAULT);
+    CHECK(log.misses == 2 && log.hits == 0);
+
+    // Back on the first topology with the first command line: a hit that
+    // still rotates the right monitor
+    CHECK(run_rotation(ctx, ROTATION_PORTRAIT, "M2", false) == 0);
+    CHECK(sim_get_monitor(1, &monitor) && monitor.orientation == DMDO_90 && monitor.width == 1080);
+    CHECK(sim_get_monitor(0, &monitor) && monitor.orientation == DMDO_DEFAULT);
+    CHECK(log.misses == 2 && log.hits == 1);
+
+    // --no-plan-cache resolves from scratch
+    CHECK(run_rotation(ctx, ROTATION_LANDSCAPE, "M2", true) == 0);
+    CHECK(log.misses == 3 && log.hits == 1);
+
+    mosdef_destroy(ctx);
+    log_set_thread_sink(previous);
+    sim_reset();
+}
+
+int main(void) {
+    test_isolate_data();
+    RUN_TEST(test_hits_follow_topology);
+    RUN_TEST(test_cli_rotations);
+    return TEST_EXIT_CODE();
+}
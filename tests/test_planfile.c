@@ -0,0 +1,210 @@
+#include "test.h"
+#include "mosdef.h"
+#include "planfile.h"
+#include "util.h"
+#include <sim.h>
+
+// Plan files: a saved plan loads back exactly as resolved, and damaged,
+// truncated, foreign-version and out-of-range files are rejected before
+// anything reaches the display driver. A plan resolved against another
+// topology loads but fails verification.
+
+// Byte offsets in the encoding (planfile.h)
+#define OFFSET_VERSION 8
+#define OFFSET_FIRST_ENTRY 28
+#define ENTRY_TARGET_ORIENTATION 12
+#define ENTRY_TARGET_WIDTH 16
+#define ENTRY_CURRENT_HEIGHT 8
+
+static void quiet_log(LogLevel level, const char* message, void* user_data) {
+    (void)level;
+    (void)message;
+    (void)user_data;
+}
+
+static const LogSink g_quiet = { quiet_log, NULL, false };
+
+// Rewrites the checksum trailer so only the edit under test is wrong
+static void reseal(BYTE* data, size_t size) {
+    ULONG64 checksum = hash_bytes(HASH_SEED, data, size - sizeof(checksum));
+    memcpy(data + size - sizeof(checksum), &checksum, sizeof(checksum));
+}
+
+static void patch_u32(BYTE* data, size_t size, size_t offset, DWORD value) {
+    memcpy(data + offset, &value, sizeof(value));
+    reseal(data, size);
+}
+
+static bool rejects(MosDefContext* ctx, const BYTE* data, size_t size) {
+    RotationPlan* plan = NULL;
+    MosDefStatus status = mosdef_decode_plan(ctx, data, size, &plan);
+    mosdef_free_plan(ctx, plan);
+    return status == MOSDEF_ERR_BAD_PLAN && plan == NULL;
+}
+
+static bool read_file(const char* path, BYTE** out_data, size_t* out_size) {
+    FILE* file = NULL;
+    if (fopen_s(&file, path, "rb") != 0 || !file) return false;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    BYTE* data = size > 0 ? (BYTE*)malloc((size_t)size) : NULL;
+    bool read = data && fread(data, 1, (size_t)size, file) == (size_t)size;
+    fclose(file);
+    if (!read) {
+        free(data);
+        return false;
+    }
+    *out_data = data;
+    *out_size = (size_t)size;
+    return true;
+}
+
+static void plan_path(char* path, size_t size) {
+    sprintf_s(path, size, "%s/test.plan", getenv("LOCALAPPDATA"));
+}
+
+static void test_round_trip(void) {
+    sim_reset();
+    MosDefContext* ctx = mosdef_create(NULL, NULL, &g_quiet);
+    REQUIRE(ctx);
+    RotationPlan* plan = NULL;
+    REQUIRE(mosdef_plan(ctx, ROTATION_PORTRAIT, NULL, NULL, &plan) == MOSDEF_OK);
+
+    char path[512];
+    plan_path(path, sizeof(path));
+    CHECK(mosdef_save_plan(ctx, plan, path) == MOSDEF_OK);
+    RotationPlan* loaded = NULL;
+    CHECK(mosdef_load_plan(ctx, path, &loaded) == MOSDEF_OK);
+    if (loaded) {
+        CHECK(loaded->command == plan->command && loaded->count == plan->count);
+        CHECK(loaded->topology_fingerprint == plan->topology_fingerprint);
+        for (int i = 0; i < plan->count && i < loaded->count; i++) {
+            const RotationPlanEntry* a = &plan->entries[i];
+            const RotationPlanEntry* b = &loaded->entries[i];
+            CHECK(strcmp(a->id, b->id) == 0 && strcmp(a->device_path, b->device_path) == 0 &&
+                  strcmp(a->stable_id, b->stable_id) == 0);
+            CHECK(a->current_orientation == b->current_orientation && a->current_width == b->current_width &&
+                  a->current_height == b->current_height);
+            CHECK(a->target_orientation == b->target_orientation && a->target_width == b->target_width &&
+                  a->target_height == b->target_height);
+        }
+        CHECK(mosdef_verify_plan(ctx, loaded) == MOSDEF_OK);
+    }
+
+    mosdef_free_plan(ctx, loaded);
+    mosdef_free_plan(ctx, plan);
+    mosdef_destroy(ctx);
+}
+
+static void test_damaged_files(void) {
+    sim_reset();
+    MosDefContext* ctx = mosdef_create(NULL, NULL, &g_quiet);
+    REQUIRE(ctx);
+    RotationPlan* plan = NULL;
+    REQUIRE(mosdef_plan(ctx, ROTATION_PORTRAIT, NULL, NULL, &plan) == MOSDEF_OK);
+    char path[512];
+    plan_path(path, sizeof(path));
+    CHECK(mosdef_save_plan(ctx, plan, path) == MOSDEF_OK);
+    mosdef_free_plan(ctx, plan);
+
+    BYTE* data = NULL;
+    size_t size = 0;
+    REQUIRE(read_file(path, &data, &size));
+    BYTE* copy = (BYTE*)malloc(size);
+    REQUIRE(copy);
+
+    // Any flipped bit fails the checksum
+    for (size_t offset = 0; offset < size; offset++) {
+        memcpy(copy, data, size);
+        copy[offset] ^= 0x10;
+        if (!rejects(ctx, copy, size)) {
+            fprintf(stderr, "flipped byte %zu accepted\n", offset);
+            CHECK(false);
+            break;
+        }
+    }
+
+    // Every proper prefix, sealed or not
+    for (size_t length = 0; length < size; length++) {
+        memcpy(copy, data, size);
+        bool rejected = rejects(ctx, copy, length);
+        if (length >= OFFSET_FIRST_ENTRY + sizeof(ULONG64)) {
+            reseal(copy, length);
+            rejected = rejected && rejects(ctx, copy, length);
+        }
+        if (!rejected) {
+            fprintf(stderr, "%zu-byte prefix accepted\n", length);
+            CHECK(false);
+            break;
+        }
+    }
+
+    // A sealed file from another version
+    memcpy(copy, data, size);
+    patch_u32(copy, size, OFFSET_VERSION, PLAN_FILE_VERSION + 1);
+    CHECK(rejects(ctx, copy, size));
+
+    // Sealed entries the driver must never see
+    memcpy(copy, data, size);
+    patch_u32(copy, size, OFFSET_FIRST_ENTRY + ENTRY_TARGET_ORIENTATION, DMDO_270 + 1);
+    CHECK(rejects(ctx, copy, size));
+    memcpy(copy, data, size);
+    patch_u32(copy, size, OFFSET_FIRST_ENTRY + ENTRY_TARGET_WIDTH, 0);
+    CHECK(rejects(ctx, copy, size));
+    memcpy(copy, data, size);
+    patch_u32(copy, size, OFFSET_FIRST_ENTRY + ENTRY_TARGET_WIDTH, 0x80000000u);
+    CHECK(rejects(ctx, copy, size));
+    memcpy(copy, data, size);
+    patch_u32(copy, size, OFFSET_FIRST_ENTRY + ENTRY_CURRENT_HEIGHT, 0);
+    CHECK(rejects(ctx, copy, size));
+
+    // The untouched file still loads
+    RotationPlan* loaded = NULL;
+    CHECK(mosdef_decode_plan(ctx, data, size, &loaded) == MOSDEF_OK);
+    mosdef_free_plan(ctx, loaded);
+
+    free(copy);
+    free(data);
+    mosdef_destroy(ctx);
+}
+
+static void test_stale_fingerprint(void) {
+    sim_reset();
+    MosDefContext* ctx = mosdef_create(NULL, NULL, &g_quiet);
+    REQUIRE(ctx);
+    RotationPlan* plan = NULL;
+    REQUIRE(mosdef_plan(ctx, ROTATION_PORTRAIT, NULL, NULL, &plan) == MOSDEF_OK);
+    char path[512];
+    plan_path(path, sizeof(path));
+    CHECK(mosdef_save_plan(ctx, plan, path) == MOSDEF_OK);
+    mosdef_free_plan(ctx, plan);
+
+    // A third monitor joins; the saved plan still loads but no longer matches
+    SimMonitor monitors[3];
+    for (int i = 0; i < 2; i++) REQUIRE(sim_get_monitor(i, &monitors[i]));
+    monitors[2] = monitors[1];
+    monitors[2].model = "SAM0F9E";
+    monitors[2].connector = "card0-DP-3";
+    monitors[2].x += 4000;
+    REQUIRE(sim_set_monitors(monitors, 3));
+
+    RotationPlan* loaded = NULL;
+    CHECK(mosdef_load_plan(ctx, path, &loaded) == MOSDEF_OK);
+    if (loaded) {
+        CHECK(mosdef_verify_plan(ctx, loaded) == MOSDEF_ERR_STALE_PLAN);
+        sim_reset();
+        CHECK(mosdef_verify_plan(ctx, loaded) == MOSDEF_OK);
+    }
+    mosdef_free_plan(ctx, loaded);
+    mosdef_destroy(ctx);
+}
+
+int main(void) {
+    test_isolate_data();
+    log_set_thread_sink(&g_quiet);
+    RUN_TEST(test_round_trip);
+    RUN_TEST(test_damaged_files);
+    RUN_TEST(test_stale_fingerprint);
+    return TEST_EXIT_CODE();
+}
@@ -0,0 +1,84 @@
+#include "test.h"
+#include "selexpr.h"
+
+// Selector expressions: regex search semantics, anchors, and the error for an
+// anchored top-level alternation, whose meaning differs between dialects.
+
+static MonitorInfo make_monitor(char* name, DWORD width) {
+    MonitorInfo monitor;
+    memset(&monitor, 0, sizeof(monitor));
+    monitor.id = "M1";
+    monitor.device_name = name;
+    monitor.device_path = "\\\\.\\DISPLAY1";
+    monitor.device_id = "";
+    monitor.stable_id = "";
+    monitor.monitor_interface = "";
+    monitor.model_name = "";
+    monitor.width = width;
+    monitor.height = 1080;
+    return monitor;
+}
+
+// 1 if source matches name, 0 if not, -1 if it fails to compile
+static int matches(const char* source, char* name) {
+    int column = 0;
+    const char* error = NULL;
+    SelectorProgram* program = selector_program_compile_with_error(source, &column, &error);
+    if (!program) return -1;
+    MonitorInfo monitor = make_monitor(name, 2560);
+    int result = selector_program_matches(program, &monitor) ? 1 : 0;
+    selector_program_release(program);
+    return result;
+}
+
+static void test_regex_search(void) {
+    CHECK(matches("name~\"dell\"", "DELL U2720Q") == 1);
+    CHECK(matches("name~\"u27\\d\\d\"", "DELL U2720Q") == 1);
+    CHECK(matches("name~\"hp|dell\"", "DELL U2720Q") == 1);
+    CHECK(matches("name~\"hp|lg\"", "DELL U2720Q") == 0);
+    CHECK(matches("name!~\"hp|lg\"", "DELL U2720Q") == 1);
+    CHECK(matches("name~\"^dell\" && width>=2560", "DELL U2720Q") == 1);
+    CHECK(matches("name~\"^dell\" && width>2560", "DELL U2720Q") == 0);
+}
+
+static void test_anchors(void) {
+    CHECK(matches("name~\"^u27\"", "DELL U2720Q") == 0);
+    CHECK(matches("name~\"20q$\"", "DELL U2720Q") == 1);
+    CHECK(matches("name~\"u27$\"", "DELL U2720Q") == 0);
+    CHECK(matches("name~\"^dell u2720q$\"", "DELL U2720Q") == 1);
+
+    // Grouped alternations anchor every branch
+    CHECK(matches("name~\"^(hp|dell)\"", "DELL U2720Q") == 1);
+    CHECK(matches("name~\"^(hp|u27)\"", "DELL U2720Q") == 0);
+    CHECK(matches("name~\"(u27|hp)20q$\"", "DELL U2720Q") == 1);
+    CHECK(matches("name~\"^(lg|(hp|dell)) \"", "DELL U2720Q") == 1);
+
+    // An escaped $ is a literal, so nothing is anchored
+    CHECK(matches("name~\"x|q\\$\"", "PRICE Q$") == 1);
+}
+
+static void test_anchored_alternation_rejected(void) {
+    const char* sources[] = {
+        "name~\"^a|b\"",
+        "name~\"a|b$\"",
+        "name~\"^a|b$\"",
+        "name~\"^(a)|b\"",
+    };
+    for (size_t i = 0; i < sizeof(sources) / sizeof(sources[0]); i++) {
+        int column = 0;
+        const char* error = NULL;
+        SelectorProgram* program = selector_program_compile_with_error(sources[i], &column, &error);
+        CHECK(program == NULL);
+        CHECK(error && strstr(error, "top-level |"));
+        // The column points at the bar
+        CHECK(column > 0 && sources[i][column - 1] == '|');
+        selector_program_release(program);
+    }
+}
+
+int main(void) {
+    RUN_TEST(test_regex_search);
+    RUN_TEST(test_anchors);
+    RUN_TEST(test_anchored_alternation_rejected);
+    return TEST_EXIT_CODE();
+}
@@ -0,0 +1,84 @@
+#include "test.h"
+#include "snapshots.h"
+
+// Snapshot store round trips and compaction. Each journal entry is tagged
+// through its refresh rate so the tests can tell which one undo would
+// restore.
+
+static bool save_journal(DWORD tag) {
+    DisplayState state = { "DEL4085-1A2B3C4D", "\\\\.\\DISPLAY1", 0, 0, 2560, 1440, DMDO_DEFAULT, tag };
+    DisplaySetup setup = { &state, 1 };
+    return snapshot_store_save(NULL, &setup);
+}
+
+static DWORD undo_tag(int depth, int* out_available) {
+    DisplaySetup* setup = snapshot_store_undo_target(depth, out_available);
+    DWORD tag = (setup && setup->count == 1) ? setup->displays[0].refresh_hz : 0;
+    free_display_setup(setup, NULL);
+    return tag;
+}
+
+static void test_undo_stack(void) {
+    for (DWORD tag = 1; tag <= 5; tag++) {
+        REQUIRE(save_journal(tag));
+    }
+
+    int available = 0;
+    CHECK(undo_tag(1, &available) == 5 && available == 5);
+    CHECK(undo_tag(5, &available) == 1);
+    CHECK(undo_tag(6, &available) == 0);
+
+    CHECK(snapshot_store_pop_undo(2));
+    CHECK(undo_tag(1, &available) == 3 && available == 3);
+    CHECK(save_journal(6));
+    CHECK(undo_tag(1, &available) == 6 && available == 4);
+    CHECK(undo_tag(2, &available) == 3);
+}
+
+// An undo that is the record to cross the compaction threshold must still
+// pop: the rewritten store may not hand the same entry back
+static void test_undo_triggers_compaction(void) {
+    SnapshotListing* listing = snapshot_store_list();
+    REQUIRE(listing);
+    int records = listing->record_count;
+    free_snapshot_listing(listing);
+
+    DWORD tag = 100;
+    while (records < SNAPSHOT_STORE_COMPACT_RECORDS) {
+        REQUIRE(save_journal(++tag));
+        records++;
+    }
+
+    int available = 0;
+    CHECK(undo_tag(1, &available) == tag);
+    CHECK(snapshot_store_pop_undo(1));
+
+    listing = snapshot_store_list();
+    REQUIRE(listing);
+    CHECK(listing->record_count <= SNAPSHOT_STORE_KEEP_JOURNAL);
+    CHECK(listing->undo_depth == SNAPSHOT_STORE_KEEP_JOURNAL);
+    free_snapshot_listing(listing);
+
+    CHECK(undo_tag(1, &available) == tag - 1);
+    CHECK(available == SNAPSHOT_STORE_KEEP_JOURNAL);
+    CHECK(undo_tag(SNAPSHOT_STORE_KEEP_JOURNAL, &available) == tag - SNAPSHOT_STORE_KEEP_JOURNAL);
+
+    // Popping several at once drops all of them
+    while (true) {
+        listing = snapshot_store_list();
+        REQUIRE(listing);
+        records = listing->record_count;
+        free_snapshot_listing(listing);
+        if (records >= SNAPSHOT_STORE_COMPACT_RECORDS) break;
+        REQUIRE(save_journal(++tag));
+    }
+    CHECK(snapshot_store_pop_undo(3));
+    CHECK(undo_tag(1, &available) == tag - 3);
+}
+
+int main(void) {
+    test_isolate_data();
+    RUN_TEST(test_undo_stack);
+    RUN_TEST(test_undo_triggers_compaction);
+    return TEST_EXIT_CODE();
+}
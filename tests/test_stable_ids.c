@@ -0,0 +1,120 @@
+#include "test.h"
+#include "mosdef.h"
+#include "edid.h"
+#include <sim.h>
+
+// Stable monitor identity: EDID fixture blobs through the identity parser
+// and formatter, and suffixes for identical panels that must follow the
+// connector rather than enumeration order.
+
+static void check_fixture_id(const char* fixture, const char* expected) {
+    BYTE edid[EDID_MAX_SIZE];
+    DWORD size = test_read_fixture(fixture, edid, sizeof(edid));
+    REQUIRE(size > 0);
+
+    EdidIdentity identity;
+    CHECK(edid_parse_identity(edid, size, &identity));
+    char stable_id[64];
+    edid_format_stable_id(&identity, stable_id, sizeof(stable_id));
+    if (strcmp(stable_id, expected) != 0) {
+        fprintf(stderr, "%s: stable ID %s, expected %s\n", fixture, stable_id, expected);
+    }
+    CHECK(strcmp(stable_id, expected) == 0);
+}
+
+static void test_fixture_identities(void) {
+    check_fixture_id("edid/dell_u2720q.bin", "DEL4085-1A2B3C4D");
+    check_fixture_id("edid/lg_no_serial.bin", "GSM5B7F");
+    check_fixture_id("edid/samsung_string_serial.bin", "SAM0F9E-H4ZR900123");
+
+    BYTE edid[EDID_MAX_SIZE];
+    EdidIdentity identity;
+    DWORD size = test_read_fixture("edid/dell_u2720q.bin", edid, sizeof(edid));
+    CHECK(size == 2 * EDID_BLOCK_SIZE);
+    CHECK(edid_parse_identity(edid, size, &identity));
+    CHECK(strcmp(identity.manufacturer, "DEL") == 0);
+    CHECK(identity.product_code == 0x4085);
+    CHECK(identity.serial_number == 0x1A2B3C4D);
+    CHECK(strcmp(identity.serial_string, "7XYZ123") == 0);
+
+    size = test_read_fixture("edid/bad_header.bin", edid, sizeof(edid));
+    CHECK(size == EDID_BLOCK_SIZE && !edid_parse_identity(edid, size, &identity));
+    size = test_read_fixture("edid/truncated.bin", edid, sizeof(edid));
+    CHECK(size == 100 && !edid_parse_identity(edid, size, &identity));
+}
+
+static void quiet_log(LogLevel level, const char* message, void* user_data) {
+    (void)level;
+    (void)message;
+    (void)user_data;
+}
+
+// Stable ID of the monitor on a connector, NULL if absent
+static const char* stable_id_on(const MonitorList* monitors, const char* connector) {
+    for (int i = 0; i < monitors->count; i++) {
+        if (strstr(monitors->monitors[i].monitor_interface, connector)) {
+            return monitors->monitors[i].stable_id;
+        }
+    }
+    return NULL;
+}
+
+static void check_identical_panels(MosDefContext* ctx, const SimMonitor* topology, int count,
+                                   const char* second_connector) {
+    REQUIRE(sim_set_monitors(topology, count));
+
+    MonitorList* monitors = NULL;
+    REQUIRE(mosdef_enumerate(ctx, &monitors) == MOSDEF_OK);
+    const char* first = stable_id_on(monitors, "card0-DP-1#");
+    const char* second = stable_id_on(monitors, "card0-DP-2#");
+    CHECK(first && strcmp(first, "GSM5B7F") == 0);
+    CHECK(second && strcmp(second, "GSM5B7F#2") == 0);
+    CHECK(strcmp(stable_id_on(monitors, "card0-HDMI-A-1#"), "DEL4085") == 0);
+
+    // The suffixed ID selects the same panel whatever its M# is
+    SelectorList* selector = mosdef_parse_selectors(ctx, "edid:GSM5B7F#2");
+    RotationPlan* plan = NULL;
+    CHECK(selector && mosdef_plan(ctx, ROTATION_PORTRAIT, selector, NULL, &plan) == MOSDEF_OK);
+    if (plan) {
+        CHECK(plan->count == 1);
+        const char* path = plan->count == 1 ? plan->entries[0].device_path : "";
+        for (int i = 0; i < monitors->count; i++) {
+            if (strcmp(monitors->monitors[i].device_path, path) == 0) {
+                CHECK(strstr(monitors->monitors[i].monitor_interface, second_connector) != NULL);
+            }
+        }
+    }
+    mosdef_free_plan(ctx, plan);
+    mosdef_free_selectors(ctx, selector);
+    mosdef_free_monitor_list(ctx, monitors);
+}
+
+static void test_identical_panels_follow_connectors(void) {
+    LogSink quiet = { quiet_log, NULL, false };
+    MosDefContext* ctx = mosdef_create(NULL, NULL, &quiet);
+    REQUIRE(ctx);
+
+    // Same panels enumerated in both orders, with another panel in between
+    SimMonitor reversed[3] = {
+        { "GSM5B7F", "card0-DP-2", 2560, 1440, DMDO_DEFAULT, 60, 0, 0 },
+        { "DEL4085", "card0-HDMI-A-1", 1920, 1080, DMDO_DEFAULT, 60, 2560, 0 },
+        { "GSM5B7F", "card0-DP-1", 2560, 1440, DMDO_DEFAULT, 60, 4480, 0 }
+    };
+    SimMonitor ordered[3] = {
+        { "GSM5B7F", "card0-DP-1", 2560, 1440, DMDO_DEFAULT, 60, 0, 0 },
+        { "GSM5B7F", "card0-DP-2", 2560, 1440, DMDO_DEFAULT, 60, 2560, 0 },
+        { "DEL4085", "card0-HDMI-A-1", 1920, 1080, DMDO_DEFAULT, 60, 5120, 0 }
+    };
+    check_identical_panels(ctx, reversed, 3, "card0-DP-2#");
+    check_identical_panels(ctx, ordered, 3, "card0-DP-2#");
+
+    mosdef_destroy(ctx);
+    sim_reset();
+}
+
+int main(void) {
+    test_isolate_data();
+    RUN_TEST(test_fixture_identities);
+    RUN_TEST(test_identical_panels_follow_connectors);
+    return TEST_EXIT_CODE();
+}
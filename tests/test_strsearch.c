@@ -0,0 +1,157 @@
+#include "test.h"
+#include "strsearch.h"
+
+// Differential checks of the SSE2 and AVX2 kernels (and the dispatcher)
+// against strsearch_contains_scalar. Haystacks sit at varying offsets of an
+// aligned buffer so loads are unaligned, and the padding past the end is
+// filled with the needle, so a tail mask that lets a position past the last
+// candidate through reports a false match.
+
+#define MAX_HAYSTACK 300
+#define BUFFER_SIZE (64 + MAX_HAYSTACK + STRSEARCH_PADDING)
+
+static char* g_buffer;          // 64-byte aligned, BUFFER_SIZE bytes
+static ULONG g_seed = 0x5EA7C4u;
+
+static ULONG next_random(void) {
+    g_seed = g_seed * 1103515245u + 12345u;
+    return (g_seed >> 8) & 0xFFFFFF;
+}
+
+// Every kernel agrees with the scalar loop; false names the first that did not
+static bool kernels_agree(const char* haystack, size_t haystack_length,
+                          const char* needle, size_t needle_length, bool* out_expected) {
+    bool expected = strsearch_contains_scalar(haystack, haystack_length, needle, needle_length);
+    *out_expected = expected;
+    if (strsearch_contains_sse2(haystack, haystack_length, needle, needle_length) != expected) {
+        fprintf(stderr, "sse2 differs: length %zu, needle %zu\n", haystack_length, needle_length);
+        return false;
+    }
+    if (strsearch_has_avx2() &&
+        strsearch_contains_avx2(haystack, haystack_length, needle, needle_length) != expected) {
+        fprintf(stderr, "avx2 differs: length %zu, needle %zu\n", haystack_length, needle_length);
+        return false;
+    }
+    if (strsearch_folded_contains(haystack, haystack_length, needle, needle_length) != expected) {
+        fprintf(stderr, "dispatch differs: length %zu, needle %zu\n", haystack_length, needle_length);
+        return false;
+    }
+    return true;
+}
+
+// Places text at offset in buffer and fills the padding after it with the
+// needle repeated, starting from needle[phase]
+static const char* place(char* buffer, size_t offset, const char* text, size_t length,
+                         const char* needle, size_t needle_length, size_t phase) {
+    char* haystack = buffer + offset;
+    memcpy(haystack, text, length);
+    for (size_t i = 0; i < STRSEARCH_PADDING; i++) {
+        haystack[length + i] = needle_length ? needle[(phase + i) % needle_length] : 'x';
+    }
+    return haystack;
+}
+
+static void test_match_positions(void) {
+    char* buffer = g_buffer;
+    char text[MAX_HAYSTACK];
+    const char* needle = "dell";
+
+    // The needle at each position of haystacks straddling the 16- and
+    // 32-byte block boundaries, including the last candidate
+    size_t lengths[] = { 4, 15, 16, 17, 19, 20, 31, 32, 33, 35, 36, 47, 48, 63, 64, 65, 100 };
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+        size_t length = lengths[l];
+        for (size_t position = 0; position + 4 <= length; position++) {
+            memset(text, 'e', length);
+            memcpy(text + position, needle, 4);
+            for (size_t offset = 0; offset < 64; offset += 7) {
+                const char* haystack = place(buffer, offset, text, length, needle, 4, 0);
+                bool expected;
+                CHECK(kernels_agree(haystack, length, needle, 4, &expected));
+                CHECK(expected);
+            }
+        }
+    }
+}
+
+static void test_no_match_in_tail(void) {
+    char* buffer = g_buffer;
+    char text[MAX_HAYSTACK];
+
+    // Every proper prefix of the needle at the end, completed in the padding
+    const char* needle = "u2720q";
+    for (size_t length = 1; length < 80; length++) {
+        memset(text, 'u', length);
+        for (size_t cut = 1; cut < 6 && cut <= length; cut++) {
+            memcpy(text + length - cut, needle, cut);
+            for (size_t offset = 0; offset < 64; offset += 5) {
+                const char* haystack = place(buffer, offset, text, length, needle, 6, cut);
+                bool expected;
+                CHECK(kernels_agree(haystack, length, needle, 6, &expected));
+                CHECK(!expected);
+            }
+        }
+    }
+}
+
+static void test_edge_lengths(void) {
+    char* buffer = g_buffer;
+    const char* text = "samsung odyssey oled g8 samsung odyssey oled g9";
+    size_t length = strlen(text);
+    const char* haystack = place(buffer, 3, text, length, "9", 1, 0);
+    bool expected;
+
+    CHECK(kernels_agree(haystack, length, "", 0, &expected) && expected);
+    CHECK(kernels_agree(haystack, length, text, length, &expected) && expected);
+    CHECK(kernels_agree(haystack, length - 1, text, length, &expected) && !expected);
+    CHECK(kernels_agree(haystack, length, "g9", 2, &expected) && expected);
+    CHECK(kernels_agree(haystack, length - 1, "g9", 2, &expected) && !expected);
+    CHECK(kernels_agree(haystack, length, "s", 1, &expected) && expected);
+    CHECK(kernels_agree(haystack, length, "q", 1, &expected) && !expected);
+    CHECK(kernels_agree(haystack, 0, "s", 1, &expected) && !expected);
+}
+
+// Random haystacks over a three-letter alphabet, so partial matches are
+// everywhere; needles are cut from the haystack or random
+static void test_random(void) {
+    char* buffer = g_buffer;
+    char text[MAX_HAYSTACK];
+    char needle[48];
+    int matches = 0;
+    int rounds = 20000;
+
+    for (int round = 0; round < rounds; round++) {
+        size_t length = next_random() % MAX_HAYSTACK;
+        for (size_t i = 0; i < length; i++) text[i] = "abc"[next_random() % 3];
+
+        size_t needle_length = 1 + next_random() % (sizeof(needle) - 1);
+        if (length >= needle_length && next_random() % 2) {
+            memcpy(needle, text + next_random() % (length - needle_length + 1), needle_length);
+        } else {
+            for (size_t i = 0; i < needle_length; i++) needle[i] = "abc"[next_random() % 3];
+        }
+
+        const char* haystack = place(buffer, next_random() % 64, text, length, needle, needle_length, 0);
+        bool expected;
+        if (!kernels_agree(haystack, length, needle, needle_length, &expected)) {
+            CHECK(false);
+            break;
+        }
+        matches += expected ? 1 : 0;
+    }
+
+    // Both outcomes were exercised
+    CHECK(matches > rounds / 10 && matches < rounds - rounds / 10);
+}
+
+int main(void) {
+    g_buffer = (char*)_aligned_malloc(BUFFER_SIZE, 64);
+    if (!g_buffer) return EXIT_FAILURE;
+    printf("AVX2 %s\n", strsearch_has_avx2() ? "available" : "not available; checking SSE2 only");
+    RUN_TEST(test_match_positions);
+    RUN_TEST(test_no_match_in_tail);
+    RUN_TEST(test_edge_lengths);
+    RUN_TEST(test_random);
+    _aligned_free(g_buffer);
+    return TEST_EXIT_CODE();
+}
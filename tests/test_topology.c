@@ -0,0 +1,124 @@
+#include "test.h"
+#include "topology.h"
+
+// Topology snapshot store: the active pin cap and a reader/writer stress run.
+// Snapshots published here carry generation % 3 monitors, so a reader that
+// sees a freed or half-built snapshot fails the count check.
+
+static MonitorList* make_monitors(int count) {
+    MonitorList* list = (MonitorList*)malloc(sizeof(MonitorList));
+    if (!list) return NULL;
+    list->count = count;
+    list->index = NULL;
+    list->monitors = count > 0 ? (MonitorInfo*)calloc((size_t)count, sizeof(MonitorInfo)) : NULL;
+    return list;
+}
+
+typedef struct {
+    TopologyStore* store;
+    const TopologySnapshot* pinned;
+} PinRequest;
+
+static DWORD WINAPI pin_thread(LPVOID parameter) {
+    PinRequest* request = (PinRequest*)parameter;
+    request->pinned = topology_store_pin(request->store);
+    return 0;
+}
+
+// The 65536th pin must wait for a release instead of carrying into the
+// snapshot pointer
+static void test_pin_cap(void) {
+    TopologyStore* store = topology_store_create();
+    REQUIRE(store);
+    CHECK(topology_store_publish(store, make_monitors(2)));
+
+    const TopologySnapshot* snapshot = topology_store_pin(store);
+    REQUIRE(snapshot && snapshot->monitors->count == 2);
+    for (int i = 1; i < TOPOLOGY_MAX_ACTIVE_PINS; i++) {
+        CHECK(topology_store_pin(store) == snapshot);
+    }
+
+    PinRequest request = { store, NULL };
+    HANDLE thread = CreateThread(NULL, 0, pin_thread, &request, 0, NULL);
+    REQUIRE(thread);
+    CHECK(WaitForSingleObject(thread, 200) == WAIT_TIMEOUT);
+    CHECK(request.pinned == NULL);
+
+    topology_store_release(store, snapshot);
+    CHECK(WaitForSingleObject(thread, 10000) == WAIT_OBJECT_0);
+    CloseHandle(thread);
+    CHECK(request.pinned == snapshot);
+
+    for (int i = 0; i < TOPOLOGY_MAX_ACTIVE_PINS; i++) {
+        topology_store_release(store, snapshot);
+    }
+
+    // The word is back to zero pins on the same snapshot
+    const TopologySnapshot* again = topology_store_pin(store);
+    CHECK(again == snapshot && again->generation == snapshot->generation);
+    topology_store_release(store, again);
+    topology_store_destroy(store);
+}
+
+#define STRESS_READERS 4
+#define STRESS_PINS 200000
+#define STRESS_PUBLISHES 20000
+
+typedef struct {
+    TopologyStore* store;
+    LONG errors;
+} StressReader;
+
+static DWORD WINAPI stress_reader(LPVOID parameter) {
+    StressReader* reader = (StressReader*)parameter;
+    ULONG64 last_generation = 0;
+    for (int i = 0; i < STRESS_PINS; i++) {
+        const TopologySnapshot* snapshot = topology_store_pin(reader->store);
+        if (!snapshot || !snapshot->monitors || snapshot->generation < last_generation ||
+            snapshot->monitors->count != (int)(snapshot->generation % 3)) {
+            reader->errors++;
+        }
+        if (snapshot) {
+            last_generation = snapshot->generation;
+            topology_store_release(reader->store, snapshot);
+        }
+    }
+    return 0;
+}
+
+static void test_reader_writer_stress(void) {
+    TopologyStore* store = topology_store_create();
+    REQUIRE(store);
+
+    StressReader readers[STRESS_READERS];
+    HANDLE threads[STRESS_READERS];
+    for (int i = 0; i < STRESS_READERS; i++) {
+        readers[i].store = store;
+        readers[i].errors = 0;
+        threads[i] = CreateThread(NULL, 0, stress_reader, &readers[i], 0, NULL);
+        CHECK(threads[i] != NULL);
+    }
+
+    // Generation g carries g % 3 monitors; generation 0 is the empty initial one
+    for (ULONG64 generation = 1; generation <= STRESS_PUBLISHES; generation++) {
+        CHECK(topology_store_publish(store, make_monitors((int)(generation % 3))));
+    }
+
+    for (int i = 0; i < STRESS_READERS; i++) {
+        if (!threads[i]) continue;
+        CHECK(WaitForSingleObject(threads[i], 60000) == WAIT_OBJECT_0);
+        CloseHandle(threads[i]);
+        CHECK(readers[i].errors == 0);
+    }
+
+    const TopologySnapshot* last = topology_store_pin(store);
+    CHECK(last && last->generation == STRESS_PUBLISHES);
+    topology_store_release(store, last);
+    topology_store_destroy(store);
+}
+
+int main(void) {
+    RUN_TEST(test_pin_cap);
+    RUN_TEST(test_reader_writer_stress);
+    return TEST_EXIT_CODE();
+}
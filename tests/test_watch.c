@@ -0,0 +1,178 @@
+#include "test.h"
+#include "watch.h"
+#include <sim.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// mos-def watch against a replayed sequence of topology changes: the NDJSON
+// stream must carry one record per change, in diff order (removals, then
+// additions and changes in enumeration order), with consecutive sequence
+// numbers, non-decreasing timestamps and the right before/after values.
+
+#define MAX_RECORDS 64
+
+typedef struct {
+    char path[64];
+    int saved_stdout;
+    char text[16384];
+    char* lines[MAX_RECORDS];
+    int count;
+} Capture;
+
+static bool capture_start(Capture* capture) {
+    memset(capture, 0, sizeof(*capture));
+    strcpy_s(capture->path, sizeof(capture->path), "/tmp/mosdef-watch-XXXXXX");
+    int fd = mkstemp(capture->path);
+    if (fd < 0) return false;
+
+    fflush(stdout);
+    capture->saved_stdout = dup(STDOUT_FILENO);
+    dup2(fd, STDOUT_FILENO);
+    close(fd);
+    return true;
+}
+
+static void capture_stop(Capture* capture) {
+    fflush(stdout);
+    dup2(capture->saved_stdout, STDOUT_FILENO);
+    close(capture->saved_stdout);
+    unlink(capture->path);
+}
+
+// Re-reads the stream and splits it into lines
+static int capture_read(Capture* capture) {
+    FILE* file = NULL;
+    if (fopen_s(&file, capture->path, "rb") != 0 || !file) return 0;
+    size_t size = fread(capture->text, 1, sizeof(capture->text) - 1, file);
+    fclose(file);
+    capture->text[size] = '\0';
+
+    capture->count = 0;
+    char* context = NULL;
+    for (char* line = strtok_s(capture->text, "\n", &context); line && capture->count < MAX_RECORDS;
+         line = strtok_s(NULL, "\n", &context)) {
+        capture->lines[capture->count++] = line;
+    }
+    return capture->count;
+}
+
+static bool wait_for_records(Capture* capture, int count) {
+    for (int i = 0; i < 500; i++) {
+        if (capture_read(capture) >= count) return true;
+        Sleep(10);
+    }
+    return false;
+}
+
+static void quiet_log(LogLevel level, const char* message, void* user_data) {
+    (void)level;
+    (void)message;
+    (void)user_data;
+}
+
+static DWORD WINAPI watch_thread(LPVOID parameter) {
+    LogSink quiet = { quiet_log, NULL, false };
+    log_set_thread_sink(&quiet);
+    MosDefContext* ctx = mosdef_create(NULL, NULL, &quiet);
+    *(int*)parameter = ctx ? run_watch(ctx) : -1;
+    mosdef_destroy(ctx);
+    return 0;
+}
+
+static void check_record(const Capture* capture, int index, const char* event, const char* id,
+                         const char* before, const char* after) {
+    if (index >= capture->count) {
+        fprintf(stderr, "record %d missing, expected %s\n", index + 1, event);
+        CHECK(false);
+        return;
+    }
+
+    const char* line = capture->lines[index];
+    char expected[128];
+    sprintf_s(expected, sizeof(expected), "\"seq\":%d,\"event\":\"%s\",\"id\":\"%s\"", index + 1, event, id);
+    bool ok = strstr(line, expected) != NULL;
+    if (before) {
+        sprintf_s(expected, sizeof(expected), "\"before\":%s", before);
+        ok = ok && strstr(line, expected) != NULL;
+    }
+    if (after) {
+        sprintf_s(expected, sizeof(expected), "\"after\":%s", after);
+        ok = ok && strstr(line, expected) != NULL;
+    }
+    if (!ok) fprintf(stderr, "record %d: %s\n", index + 1, line);
+    CHECK(ok);
+
+    // ISO 8601 timestamps compare as strings
+    if (index > 0) CHECK(strncmp(capture->lines[index - 1], line, 31) <= 0);
+}
+
+static void test_replayed_changes(void) {
+    SimMonitor dell = { "DEL4085", "card0-DP-1", 2560, 1440, DMDO_DEFAULT, 60, 0, 0 };
+    SimMonitor lg = { "GSM5B7F", "card0-HDMI-A-1", 1920, 1080, DMDO_DEFAULT, 60, 2560, 0 };
+    SimMonitor samsung = { "SAM0F9E", "card0-DP-2", 1920, 1080, DMDO_DEFAULT, 60, 4480, 0 };
+    SimMonitor topology[3] = { dell, lg };
+    REQUIRE(sim_set_monitors(topology, 2));
+
+    Capture capture;
+    REQUIRE(capture_start(&capture));
+    int exit_code = -1;
+    HANDLE thread = CreateThread(NULL, 0, watch_thread, &exit_code, 0, NULL);
+    REQUIRE(thread);
+
+    // Baseline
+    CHECK(wait_for_records(&capture, 2));
+
+    // Step 1: the LG turns portrait
+    topology[1].width = 1080;
+    topology[1].height = 1920;
+    topology[1].orientation = DMDO_90;
+    CHECK(sim_set_monitors(topology, 2));
+    CHECK(wait_for_records(&capture, 4));
+
+    // Step 2: a Samsung is plugged in
+    topology[2] = samsung;
+    CHECK(sim_set_monitors(topology, 3));
+    CHECK(wait_for_records(&capture, 5));
+
+    // A notification without a change emits nothing
+    CHECK(sim_set_monitors(topology, 3));
+    Sleep(100);
+
+    // Step 3: the Dell is unplugged and the others slide left
+    topology[0] = topology[1];
+    topology[0].x = 0;
+    topology[1] = samsung;
+    topology[1].x = 1080;
+    topology[1].refresh_hz = 75;
+    CHECK(sim_set_monitors(topology, 2));
+    CHECK(wait_for_records(&capture, 9));
+
+    sim_send_ctrl_c();
+    CHECK(WaitForSingleObject(thread, 10000) == WAIT_OBJECT_0);
+    CloseHandle(thread);
+    capture_read(&capture);
+    capture_stop(&capture);
+
+    CHECK(exit_code == 0);
+    CHECK(capture.count == 9);
+    check_record(&capture, 0, "present", "M1", NULL, NULL);
+    check_record(&capture, 1, "present", "M2", NULL,
+                 "{\"name\":\"Simulated Display\",\"width\":1920,\"height\":1080,\"orientation\":0,\"x\":2560");
+    check_record(&capture, 2, "orientation_changed", "M2", "{\"orientation\":0}", "{\"orientation\":90}");
+    check_record(&capture, 3, "resolution_changed", "M2", "{\"width\":1920,\"height\":1080}",
+                 "{\"width\":1080,\"height\":1920}");
+    check_record(&capture, 4, "monitor_added", "M3", NULL,
+                 "{\"name\":\"Simulated Display\",\"width\":1920,\"height\":1080,\"orientation\":0,\"x\":4480");
+    check_record(&capture, 5, "monitor_removed", "M1",
+                 "{\"name\":\"Simulated Display\",\"width\":2560,\"height\":1440", NULL);
+    check_record(&capture, 6, "position_changed", "M1", "{\"x\":2560,\"y\":0}", "{\"x\":0,\"y\":0}");
+    check_record(&capture, 7, "position_changed", "M2", "{\"x\":4480,\"y\":0}", "{\"x\":1080,\"y\":0}");
+    check_record(&capture, 8, "refresh_changed", "M2", "{\"refresh_hz\":60}", "{\"refresh_hz\":75}");
+    sim_reset();
+}
+
+int main(void) {
+    test_isolate_data();
+    RUN_TEST(test_replayed_changes);
+    return TEST_EXIT_CODE();
+}